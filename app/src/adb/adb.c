@@ -6,6 +6,7 @@
 #include <string.h>
 #include <sys/types.h>
 
+#include "adb/adb_client.h"
 #include "adb/adb_device.h"
 #include "adb/adb_parser.h"
 #include "util/env.h"
@@ -27,12 +28,61 @@
 #define SC_ADB_COMMAND(...) { sc_adb_get_executable(), __VA_ARGS__, NULL }
 
 static char *adb_executable;
+// sc_adb_init() may be called once per server (several devices may be mirrored
+// from the same process), the state is released by the last sc_adb_destroy()
+static unsigned adb_init_count;
+
+// The port of the adb server for the native client, or 0 if it must not be
+// used
+static uint16_t adb_server_port;
+// Set once the adb server is known to be running
+static bool adb_native;
+
+static void
+init_adb_server_port(void) {
+    adb_server_port = SC_ADB_SERVER_PORT_DEFAULT;
+    adb_native = false;
+
+    char *server_socket = sc_get_env("ADB_SERVER_SOCKET");
+    if (server_socket) {
+        // Custom server address, only supported by the adb executable
+        LOGD("ADB_SERVER_SOCKET is set, not using the native adb client");
+        free(server_socket);
+        adb_server_port = 0;
+        return;
+    }
+
+    char *port = sc_get_env("ANDROID_ADB_SERVER_PORT");
+    if (port) {
+        long value;
+        bool ok = sc_str_parse_integer(port, &value);
+        if (ok && value > 0 && value <= 0xFFFF) {
+            adb_server_port = value;
+        } else {
+            LOGW("Invalid ANDROID_ADB_SERVER_PORT: %s", port);
+            adb_server_port = 0;
+        }
+        free(port);
+    }
+}
+
+// If the native client returned SC_ADB_CLIENT_UNAVAILABLE, the caller falls
+// back to executing an adb process
+#define NATIVE_DONE(res) ((res) != SC_ADB_CLIENT_UNAVAILABLE)
 
 bool
 sc_adb_init(void) {
+    if (adb_init_count) {
+        ++adb_init_count;
+        return true;
+    }
+
+    init_adb_server_port();
+
     adb_executable = sc_get_env("ADB");
     if (adb_executable) {
         LOGD("Using adb: %s", adb_executable);
+        adb_init_count = 1;
         return true;
     }
 
@@ -55,12 +105,19 @@ sc_adb_init(void) {
     LOGD("Using adb (portable): %s", adb_executable);
 #endif
 
+    adb_init_count = 1;
     return true;
 }
 
 void
 sc_adb_destroy(void) {
+    assert(adb_init_count);
+    if (--adb_init_count) {
+        return;
+    }
+
     free(adb_executable);
+    adb_executable = NULL;
 }
 
 const char *
@@ -234,13 +291,21 @@ sc_adb_start_server(struct sc_intr *intr, unsigned flags) {
     const char *const argv[] = SC_ADB_COMMAND("start-server");
 
     sc_pid pid = sc_adb_execute(argv, flags);
-    return process_check_success_intr(intr, pid, "adb start-server", flags);
+    bool ok = process_check_success_intr(intr, pid, "adb start-server", flags);
+
+    // The adb executable starts the server (or restarts it if its version
+    // does not match), then the subsequent commands may be executed
+    // in-process
+    adb_native = ok && adb_server_port;
+    return ok;
 }
 
 bool
 sc_adb_kill_server(struct sc_intr *intr, unsigned flags) {
     const char *const argv[] = SC_ADB_COMMAND("kill-server");
 
+    adb_native = false;
+
     sc_pid pid = sc_adb_execute(argv, flags);
     return process_check_success_intr(intr, pid, "adb kill-server", flags);
 }
@@ -262,6 +327,15 @@ sc_adb_forward(struct sc_intr *intr, const char *serial, uint16_t local_port,
     }
 
     assert(serial);
+    if (adb_native) {
+        enum sc_adb_client_result res =
+            sc_adb_client_forward(intr, adb_server_port, serial, local, remote,
+                                  flags);
+        if (NATIVE_DONE(res)) {
+            return res == SC_ADB_CLIENT_OK;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "forward", local, remote);
 
@@ -278,6 +352,15 @@ sc_adb_forward_remove(struct sc_intr *intr, const char *serial,
     (void) r;
 
     assert(serial);
+    if (adb_native) {
+        enum sc_adb_client_result res =
+            sc_adb_client_forward_remove(intr, adb_server_port, serial, local,
+                                         flags);
+        if (NATIVE_DONE(res)) {
+            return res == SC_ADB_CLIENT_OK;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "forward", "--remove", local);
 
@@ -302,6 +385,15 @@ sc_adb_reverse(struct sc_intr *intr, const char *serial,
     }
 
     assert(serial);
+    if (adb_native) {
+        enum sc_adb_client_result res =
+            sc_adb_client_reverse(intr, adb_server_port, serial, remote, local,
+                                  flags);
+        if (NATIVE_DONE(res)) {
+            return res == SC_ADB_CLIENT_OK;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "reverse", remote, local);
 
@@ -321,6 +413,15 @@ sc_adb_reverse_remove(struct sc_intr *intr, const char *serial,
     }
 
     assert(serial);
+    if (adb_native) {
+        enum sc_adb_client_result res =
+            sc_adb_client_reverse_remove(intr, adb_server_port, serial, remote,
+                                         flags);
+        if (NATIVE_DONE(res)) {
+            return res == SC_ADB_CLIENT_OK;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "reverse", "--remove", remote);
 
@@ -330,7 +431,18 @@ sc_adb_reverse_remove(struct sc_intr *intr, const char *serial,
 
 bool
 sc_adb_push(struct sc_intr *intr, const char *serial, const char *local,
-            const char *remote, unsigned flags) {
+            const char *remote, unsigned flags,
+            sc_adb_progress_fn on_progress, void *userdata) {
+    assert(serial);
+    if (adb_native) {
+        enum sc_adb_client_result res =
+            sc_adb_client_push(intr, adb_server_port, serial, local, remote,
+                               flags, on_progress, userdata);
+        if (NATIVE_DONE(res)) {
+            return res == SC_ADB_CLIENT_OK;
+        }
+    }
+
 #ifdef _WIN32
     // Windows will parse the string, so the paths must be quoted
     // (see sys/win/command.c)
@@ -345,7 +457,6 @@ sc_adb_push(struct sc_intr *intr, const char *serial, const char *local,
     }
 #endif
 
-    assert(serial);
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "push", local, remote);
 
@@ -454,6 +565,21 @@ sc_adb_disconnect(struct sc_intr *intr, const char *ip_port, unsigned flags) {
 static bool
 sc_adb_list_devices(struct sc_intr *intr, unsigned flags,
                     struct sc_vec_adb_devices *out_vec) {
+    if (adb_native) {
+        char *devices;
+        enum sc_adb_client_result res =
+            sc_adb_client_list_devices(intr, adb_server_port, flags, &devices);
+        if (NATIVE_DONE(res)) {
+            if (res != SC_ADB_CLIENT_OK) {
+                return false;
+            }
+
+            bool ok = sc_adb_parse_devices(devices, out_vec);
+            free(devices);
+            return ok;
+        }
+    }
+
     const char *const argv[] = SC_ADB_COMMAND("devices", "-l");
 
 #define BUFSIZE 65536
@@ -696,29 +822,68 @@ sc_adb_select_device(struct sc_intr *intr,
     return true;
 }
 
-char *
-sc_adb_getprop(struct sc_intr *intr, const char *serial, const char *prop,
-               unsigned flags) {
+// Execute `adb -s <serial> shell <arg1> [<arg2>]` and read its output (at
+// most len bytes)
+//
+// Return the number of bytes read, or -1 on error.
+static ssize_t
+sc_adb_shell_read(struct sc_intr *intr, const char *serial, const char *arg1,
+                  const char *arg2, const char *name, unsigned flags,
+                  char *buf, size_t len) {
     assert(serial);
+    if (adb_native) {
+        char command[512];
+        int r = arg2 ? snprintf(command, sizeof(command), "%s %s", arg1, arg2)
+                     : snprintf(command, sizeof(command), "%s", arg1);
+        if (r < 0 || (size_t) r >= sizeof(command)) {
+            LOGE("Command too long: %s", name);
+            return -1;
+        }
+
+        size_t read;
+        enum sc_adb_client_result res =
+            sc_adb_client_shell(intr, adb_server_port, serial, command, flags,
+                                buf, len, &read);
+        if (NATIVE_DONE(res)) {
+            return res == SC_ADB_CLIENT_OK ? (ssize_t) read : -1;
+        }
+    }
+
     const char *const argv[] =
-        SC_ADB_COMMAND("-s", serial, "shell", "getprop", prop);
+        SC_ADB_COMMAND("-s", serial, "shell", arg1, arg2);
 
     sc_pipe pout;
     sc_pid pid = sc_adb_execute_p(argv, flags, &pout);
     if (pid == SC_PROCESS_NONE) {
-        LOGE("Could not execute \"adb getprop\"");
-        return NULL;
+        LOGD("Could not execute \"%s\"", name);
+        return -1;
     }
 
-    char buf[128];
-    ssize_t r = sc_pipe_read_all_intr(intr, pid, pout, buf, sizeof(buf) - 1);
+    ssize_t r = sc_pipe_read_all_intr(intr, pid, pout, buf, len);
     sc_pipe_close(pout);
 
-    bool ok = process_check_success_intr(intr, pid, "adb getprop", flags);
+    bool ok = process_check_success_intr(intr, pid, name, flags);
     if (!ok) {
-        return NULL;
+        return -1;
     }
 
+    return r;
+}
+
+ssize_t
+sc_adb_shell(struct sc_intr *intr, const char *serial, const char *command,
+             unsigned flags, char *buf, size_t len) {
+    // A NULL arg2 terminates the argv array
+    return sc_adb_shell_read(intr, serial, command, NULL, "adb shell", flags,
+                             buf, len);
+}
+
+char *
+sc_adb_getprop(struct sc_intr *intr, const char *serial, const char *prop,
+               unsigned flags) {
+    char buf[128];
+    ssize_t r = sc_adb_shell_read(intr, serial, "getprop", prop, "adb getprop",
+                                  flags, buf, sizeof(buf) - 1);
     if (r == -1) {
         return NULL;
     }
@@ -733,27 +898,10 @@ sc_adb_getprop(struct sc_intr *intr, const char *serial, const char *prop,
 
 char *
 sc_adb_get_device_ip(struct sc_intr *intr, const char *serial, unsigned flags) {
-    assert(serial);
-    const char *const argv[] =
-        SC_ADB_COMMAND("-s", serial, "shell", "ip", "route");
-
-    sc_pipe pout;
-    sc_pid pid = sc_adb_execute_p(argv, flags, &pout);
-    if (pid == SC_PROCESS_NONE) {
-        LOGD("Could not execute \"ip route\"");
-        return NULL;
-    }
-
     // "adb shell ip route" output should contain only a few lines
     char buf[1024];
-    ssize_t r = sc_pipe_read_all_intr(intr, pid, pout, buf, sizeof(buf) - 1);
-    sc_pipe_close(pout);
-
-    bool ok = process_check_success_intr(intr, pid, "ip route", flags);
-    if (!ok) {
-        return NULL;
-    }
-
+    ssize_t r = sc_adb_shell_read(intr, serial, "ip", "route", "ip route",
+                                  flags, buf, sizeof(buf) - 1);
     if (r == -1) {
         return NULL;
     }
@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <inttypes.h>
 
+#include "adb/adb_client.h"
 #include "adb/adb_device.h"
 #include "util/intr.h"
 
@@ -62,9 +63,16 @@ bool
 sc_adb_reverse_remove(struct sc_intr *intr, const char *serial,
                       const char *device_socket_name, unsigned flags);
 
+/**
+ * Push a local file to the device
+ *
+ * The progress is only reported (if on_progress is not NULL) when the push is
+ * executed in-process (see adb_client.h), not by an adb process.
+ */
 bool
 sc_adb_push(struct sc_intr *intr, const char *serial, const char *local,
-            const char *remote, unsigned flags);
+            const char *remote, unsigned flags,
+            sc_adb_progress_fn on_progress, void *userdata);
 
 bool
 sc_adb_install(struct sc_intr *intr, const char *serial, const char *local,
@@ -104,6 +112,17 @@ sc_adb_select_device(struct sc_intr *intr,
                      const struct sc_adb_device_selector *selector,
                      unsigned flags, struct sc_adb_device *out_device);
 
+/**
+ * Execute `adb -s <serial> shell <command>` and read its output
+ *
+ * The command is interpreted by the device shell.
+ *
+ * Return the number of bytes read (at most len), or -1 on error.
+ */
+ssize_t
+sc_adb_shell(struct sc_intr *intr, const char *serial, const char *command,
+             unsigned flags, char *buf, size_t len);
+
 /**
  * Execute `adb getprop <prop>`
  */
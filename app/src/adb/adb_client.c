@@ -0,0 +1,618 @@
+#include "adb_client.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "adb/adb.h"
+#include "util/binary.h"
+#include "util/file.h"
+#include "util/log.h"
+#include "util/net_intr.h"
+#include "util/str.h"
+
+// A request is prefixed by its length as 4 hexadecimal digits
+#define REQUEST_MAX_LEN 0xFFFF
+// Large enough for any forward or reverse request
+#define SERVICE_MAX_LEN 1024
+// The max size of a DATA packet of the sync protocol
+#define SYNC_DATA_MAX_SIZE (64 * 1024)
+// 0100644 in decimal (a regular file, rw-r--r--)
+#define SYNC_FILE_MODE "33188"
+// File type bits of a mode returned by STAT
+#define SYNC_MODE_TYPE_MASK 0170000
+#define SYNC_MODE_TYPE_DIR 0040000
+
+#define HEADER "List of devices attached\n"
+
+static ssize_t
+recv_some(struct sc_intr *intr, sc_socket socket, void *buf, size_t len) {
+    return intr ? net_recv_intr(intr, socket, buf, len)
+                : net_recv(socket, buf, len);
+}
+
+static bool
+recv_all(struct sc_intr *intr, sc_socket socket, void *buf, size_t len) {
+    ssize_t r = intr ? net_recv_all_intr(intr, socket, buf, len)
+                     : net_recv_all(socket, buf, len);
+    return r == (ssize_t) len;
+}
+
+static bool
+send_all(struct sc_intr *intr, sc_socket socket, const void *buf, size_t len) {
+    ssize_t r = intr ? net_send_all_intr(intr, socket, buf, len)
+                     : net_send_all(socket, buf, len);
+    return r == (ssize_t) len;
+}
+
+static sc_socket
+connect_server(struct sc_intr *intr, uint16_t port) {
+    sc_socket socket = net_socket();
+    if (socket == SC_SOCKET_NONE) {
+        return SC_SOCKET_NONE;
+    }
+
+    bool ok = intr ? net_connect_intr(intr, socket, IPV4_LOCALHOST, port)
+                   : net_connect(socket, IPV4_LOCALHOST, port);
+    if (!ok) {
+        net_close(socket);
+        return SC_SOCKET_NONE;
+    }
+
+    // The requests are small and each one waits for its response
+    net_set_tcp_nodelay(socket, true);
+
+    return socket;
+}
+
+static bool
+parse_hex4(const char *s, size_t *out) {
+    size_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = s[i];
+        unsigned digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        value = (value << 4) | digit;
+    }
+
+    *out = value;
+    return true;
+}
+
+// Read a string prefixed by its length as 4 hexadecimal digits
+static char *
+recv_string(struct sc_intr *intr, sc_socket socket) {
+    char hex[4];
+    if (!recv_all(intr, socket, hex, sizeof(hex))) {
+        return NULL;
+    }
+
+    size_t len;
+    if (!parse_hex4(hex, &len)) {
+        LOGE("adb: invalid length prefix");
+        return NULL;
+    }
+
+    char *s = malloc(len + 1);
+    if (!s) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    if (len && !recv_all(intr, socket, s, len)) {
+        free(s);
+        return NULL;
+    }
+
+    s[len] = '\0';
+    return s;
+}
+
+static bool
+send_request(struct sc_intr *intr, sc_socket socket, const char *service) {
+    size_t len = strlen(service);
+    if (len > REQUEST_MAX_LEN) {
+        LOGE("adb: request too long");
+        return false;
+    }
+
+    // Send the request in a single write
+    char *buf = malloc(4 + len + 1);
+    if (!buf) {
+        LOG_OOM();
+        return false;
+    }
+
+    int r = snprintf(buf, 4 + len + 1, "%04x%s", (unsigned) len, service);
+    assert(r == (int) (4 + len));
+    (void) r;
+
+    bool ok = send_all(intr, socket, buf, 4 + len);
+    free(buf);
+    return ok;
+}
+
+// Read "OKAY", or "FAIL" followed by an error message
+static bool
+recv_status(struct sc_intr *intr, sc_socket socket, const char *service,
+            unsigned flags) {
+    char status[4];
+    if (!recv_all(intr, socket, status, sizeof(status))) {
+        if (!(flags & SC_ADB_NO_LOGERR)) {
+            LOGE("adb: no response to \"%s\"", service);
+        }
+        return false;
+    }
+
+    if (!memcmp(status, "OKAY", 4)) {
+        return true;
+    }
+
+    if (!memcmp(status, "FAIL", 4)) {
+        char *msg = recv_string(intr, socket);
+        if (!(flags & SC_ADB_NO_LOGERR)) {
+            LOGE("adb: \"%s\" failed: %s", service, msg ? msg : "?");
+        }
+        free(msg);
+        return false;
+    }
+
+    if (!(flags & SC_ADB_NO_LOGERR)) {
+        LOGE("adb: unexpected response to \"%s\"", service);
+    }
+    return false;
+}
+
+static bool
+request(struct sc_intr *intr, sc_socket socket, const char *service,
+        unsigned flags) {
+    return send_request(intr, socket, service)
+        && recv_status(intr, socket, service, flags);
+}
+
+// Redirect the connection to the device (all the subsequent requests on this
+// connection are handled by the device)
+static bool
+switch_transport(struct sc_intr *intr, sc_socket socket, const char *serial,
+                 unsigned flags) {
+    assert(serial);
+    char *service = sc_str_concat("host:transport:", serial);
+    if (!service) {
+        LOG_OOM();
+        return false;
+    }
+
+    bool ok = request(intr, socket, service, flags);
+    free(service);
+    return ok;
+}
+
+// Connect to the adb server, optionally redirected to a device, and send the
+// request
+static enum sc_adb_client_result
+open_service(struct sc_intr *intr, uint16_t port, const char *serial,
+             const char *service, unsigned flags, sc_socket *out_socket) {
+    sc_socket socket = connect_server(intr, port);
+    if (socket == SC_SOCKET_NONE) {
+        return SC_ADB_CLIENT_UNAVAILABLE;
+    }
+
+    if (serial && !switch_transport(intr, socket, serial, flags)) {
+        net_close(socket);
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    if (!request(intr, socket, service, flags)) {
+        net_close(socket);
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    *out_socket = socket;
+    return SC_ADB_CLIENT_OK;
+}
+
+// Execute a request on a new connection, and read an additional status (for
+// the requests which reply a first OKAY once connected, then a second one
+// with the result, like forward and reverse)
+static enum sc_adb_client_result
+execute_command(struct sc_intr *intr, uint16_t port, const char *serial,
+                const char *service, unsigned flags) {
+    sc_socket socket;
+    enum sc_adb_client_result res =
+        open_service(intr, port, serial, service, flags, &socket);
+    if (res != SC_ADB_CLIENT_OK) {
+        return res;
+    }
+
+    bool ok = recv_status(intr, socket, service, flags);
+    net_close(socket);
+    return ok ? SC_ADB_CLIENT_OK : SC_ADB_CLIENT_ERROR;
+}
+
+enum sc_adb_client_result
+sc_adb_client_version(struct sc_intr *intr, uint16_t port, unsigned flags,
+                      unsigned *version) {
+    sc_socket socket;
+    enum sc_adb_client_result res =
+        open_service(intr, port, NULL, "host:version", flags, &socket);
+    if (res != SC_ADB_CLIENT_OK) {
+        return res;
+    }
+
+    char *s = recv_string(intr, socket);
+    net_close(socket);
+    if (!s) {
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    size_t value;
+    bool ok = strlen(s) == 4 && parse_hex4(s, &value);
+    free(s);
+    if (!ok) {
+        LOGE("adb: invalid version");
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    *version = value;
+    return SC_ADB_CLIENT_OK;
+}
+
+enum sc_adb_client_result
+sc_adb_client_list_devices(struct sc_intr *intr, uint16_t port,
+                           unsigned flags, char **out) {
+    sc_socket socket;
+    enum sc_adb_client_result res =
+        open_service(intr, port, NULL, "host:devices-l", flags, &socket);
+    if (res != SC_ADB_CLIENT_OK) {
+        return res;
+    }
+
+    char *devices = recv_string(intr, socket);
+    net_close(socket);
+    if (!devices) {
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    // Unlike `adb devices -l`, the adb server does not send the header
+    char *s = sc_str_concat(HEADER, devices);
+    free(devices);
+    if (!s) {
+        LOG_OOM();
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    *out = s;
+    return SC_ADB_CLIENT_OK;
+}
+
+enum sc_adb_client_result
+sc_adb_client_shell(struct sc_intr *intr, uint16_t port, const char *serial,
+                    const char *command, unsigned flags, char *buf, size_t len,
+                    size_t *out_len) {
+    char *service = sc_str_concat("shell:", command);
+    if (!service) {
+        LOG_OOM();
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    sc_socket socket;
+    enum sc_adb_client_result res =
+        open_service(intr, port, serial, service, flags, &socket);
+    free(service);
+    if (res != SC_ADB_CLIENT_OK) {
+        return res;
+    }
+
+    // The output is sent raw until the end of stream
+    size_t total = 0;
+    while (total < len) {
+        ssize_t r = recv_some(intr, socket, &buf[total], len - total);
+        if (r < 0) {
+            net_close(socket);
+            return SC_ADB_CLIENT_ERROR;
+        }
+        if (!r) {
+            break;
+        }
+        total += r;
+    }
+
+    net_close(socket);
+
+    *out_len = total;
+    return SC_ADB_CLIENT_OK;
+}
+
+// Send a sync request: 4-byte id, 32-bit little-endian length (or value),
+// data
+//
+// The data must already be written in buf after the 8-byte header.
+static bool
+sync_send(struct sc_intr *intr, sc_socket socket, uint8_t *buf,
+          const char *id, uint32_t value, size_t len) {
+    memcpy(buf, id, 4);
+    sc_write32le(&buf[4], value);
+    return send_all(intr, socket, buf, 8 + len);
+}
+
+static bool
+sync_recv_status(struct sc_intr *intr, sc_socket socket, const char *remote,
+                 unsigned flags) {
+    uint8_t header[8];
+    if (!recv_all(intr, socket, header, sizeof(header))) {
+        return false;
+    }
+
+    if (!memcmp(header, "OKAY", 4)) {
+        return true;
+    }
+
+    if (!memcmp(header, "FAIL", 4)) {
+        uint32_t len = sc_read32le(&header[4]);
+        char *msg = malloc(len + 1);
+        if (!msg) {
+            LOG_OOM();
+            return false;
+        }
+        if (recv_all(intr, socket, msg, len)) {
+            msg[len] = '\0';
+            if (!(flags & SC_ADB_NO_LOGERR)) {
+                LOGE("adb: could not push to %s: %s", remote, msg);
+            }
+        }
+        free(msg);
+        return false;
+    }
+
+    if (!(flags & SC_ADB_NO_LOGERR)) {
+        LOGE("adb: unexpected sync response");
+    }
+    return false;
+}
+
+// Request the mode of a remote path (0 if it does not exist)
+static bool
+sync_stat(struct sc_intr *intr, sc_socket socket, const char *remote,
+          uint8_t *buf, unsigned flags, uint32_t *mode) {
+    size_t len = strlen(remote);
+    if (len >= SYNC_DATA_MAX_SIZE) {
+        LOGE("adb: remote path too long");
+        return false;
+    }
+
+    memcpy(&buf[8], remote, len);
+    if (!sync_send(intr, socket, buf, "STAT", len, len)) {
+        return false;
+    }
+
+    // "STAT", then the mode, the size and the modification time
+    uint8_t response[16];
+    if (!recv_all(intr, socket, response, sizeof(response))) {
+        return false;
+    }
+
+    if (memcmp(response, "STAT", 4)) {
+        if (!(flags & SC_ADB_NO_LOGERR)) {
+            LOGE("adb: unexpected sync response");
+        }
+        return false;
+    }
+
+    *mode = sc_read32le(&response[4]);
+    return true;
+}
+
+static const char *
+get_file_name(const char *path) {
+    const char *name = path;
+    for (const char *p = path; *p; ++p) {
+        if (*p == '/' || *p == SC_PATH_SEPARATOR) {
+            name = p + 1;
+        }
+    }
+    return name;
+}
+
+// Like "adb push", if the remote path is a directory (it ends with '/' or
+// STAT says so), push the file into it, under its local name
+static char *
+sync_get_remote_path(struct sc_intr *intr, sc_socket socket,
+                     const char *local, const char *remote, uint8_t *buf,
+                     unsigned flags) {
+    size_t len = strlen(remote);
+    bool trailing_slash = len && remote[len - 1] == '/';
+    if (!trailing_slash) {
+        uint32_t mode;
+        if (!sync_stat(intr, socket, remote, buf, flags, &mode)) {
+            return NULL;
+        }
+
+        if ((mode & SYNC_MODE_TYPE_MASK) != SYNC_MODE_TYPE_DIR) {
+            char *path = strdup(remote);
+            if (!path) {
+                LOG_OOM();
+            }
+            return path;
+        }
+    }
+
+    const char *name = get_file_name(local);
+    size_t size = len + 1 + strlen(name) + 1;
+    char *path = malloc(size);
+    if (!path) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    snprintf(path, size, "%s%s%s", remote, trailing_slash ? "" : "/", name);
+    return path;
+}
+
+static bool
+sync_push_file(struct sc_intr *intr, sc_socket socket, FILE *file,
+               const char *remote, uint8_t *buf, unsigned flags,
+               sc_adb_progress_fn on_progress, void *userdata) {
+    // SEND "<remote>,<mode>"
+    int len = snprintf((char *) &buf[8], SYNC_DATA_MAX_SIZE, "%s,%s", remote,
+                       SYNC_FILE_MODE);
+    if (len < 0 || len >= SYNC_DATA_MAX_SIZE) {
+        LOGE("adb: remote path too long");
+        return false;
+    }
+
+    if (!sync_send(intr, socket, buf, "SEND", len, len)) {
+        return false;
+    }
+
+    uint64_t sent = 0;
+    for (;;) {
+        size_t r = fread(&buf[8], 1, SYNC_DATA_MAX_SIZE, file);
+        if (r) {
+            if (!sync_send(intr, socket, buf, "DATA", r, r)) {
+                return false;
+            }
+            sent += r;
+            if (on_progress) {
+                on_progress(sent, userdata);
+            }
+        }
+        if (r < SYNC_DATA_MAX_SIZE) {
+            break;
+        }
+    }
+
+    if (ferror(file)) {
+        LOGE("adb: could not read the local file");
+        return false;
+    }
+
+    // DONE with the modification time in place of the length
+    if (!sync_send(intr, socket, buf, "DONE", (uint32_t) time(NULL), 0)) {
+        return false;
+    }
+
+    return sync_recv_status(intr, socket, remote, flags);
+}
+
+enum sc_adb_client_result
+sc_adb_client_push(struct sc_intr *intr, uint16_t port, const char *serial,
+                   const char *local, const char *remote, unsigned flags,
+                   sc_adb_progress_fn on_progress, void *userdata) {
+    if (!sc_file_is_regular(local)) {
+        // Directories are not supported, let the adb process push them (it
+        // also reports the error if the file does not exist)
+        return SC_ADB_CLIENT_UNAVAILABLE;
+    }
+
+    FILE *file = sc_file_open(local, "rb");
+    if (!file) {
+        LOGE("Could not open %s", local);
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    // Header + data
+    uint8_t *buf = malloc(8 + SYNC_DATA_MAX_SIZE);
+    if (!buf) {
+        LOG_OOM();
+        fclose(file);
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    sc_socket socket;
+    enum sc_adb_client_result res =
+        open_service(intr, port, serial, "sync:", flags, &socket);
+    if (res != SC_ADB_CLIENT_OK) {
+        free(buf);
+        fclose(file);
+        return res;
+    }
+
+    bool ok = false;
+    char *path = sync_get_remote_path(intr, socket, local, remote, buf, flags);
+    if (path) {
+        ok = sync_push_file(intr, socket, file, path, buf, flags, on_progress,
+                            userdata);
+        free(path);
+    }
+    fclose(file);
+
+    if (ok) {
+        // Not an error if the server closes the connection first
+        sync_send(intr, socket, buf, "QUIT", 0, 0);
+    }
+
+    free(buf);
+    net_close(socket);
+    return ok ? SC_ADB_CLIENT_OK : SC_ADB_CLIENT_ERROR;
+}
+
+enum sc_adb_client_result
+sc_adb_client_forward(struct sc_intr *intr, uint16_t port, const char *serial,
+                      const char *local, const char *remote, unsigned flags) {
+    assert(serial);
+    char service[SERVICE_MAX_LEN];
+    int r = snprintf(service, sizeof(service), "host-serial:%s:forward:%s;%s",
+                     serial, local, remote);
+    if (r < 0 || (size_t) r >= sizeof(service)) {
+        LOGE("adb: request too long");
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    return execute_command(intr, port, NULL, service, flags);
+}
+
+enum sc_adb_client_result
+sc_adb_client_forward_remove(struct sc_intr *intr, uint16_t port,
+                             const char *serial, const char *local,
+                             unsigned flags) {
+    assert(serial);
+    char service[SERVICE_MAX_LEN];
+    int r = snprintf(service, sizeof(service), "host-serial:%s:killforward:%s",
+                     serial, local);
+    if (r < 0 || (size_t) r >= sizeof(service)) {
+        LOGE("adb: request too long");
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    return execute_command(intr, port, NULL, service, flags);
+}
+
+enum sc_adb_client_result
+sc_adb_client_reverse(struct sc_intr *intr, uint16_t port, const char *serial,
+                      const char *remote, const char *local, unsigned flags) {
+    char service[SERVICE_MAX_LEN];
+    int r = snprintf(service, sizeof(service), "reverse:forward:%s;%s", remote,
+                     local);
+    if (r < 0 || (size_t) r >= sizeof(service)) {
+        LOGE("adb: request too long");
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    return execute_command(intr, port, serial, service, flags);
+}
+
+enum sc_adb_client_result
+sc_adb_client_reverse_remove(struct sc_intr *intr, uint16_t port,
+                             const char *serial, const char *remote,
+                             unsigned flags) {
+    char service[SERVICE_MAX_LEN];
+    int r = snprintf(service, sizeof(service), "reverse:killforward:%s",
+                     remote);
+    if (r < 0 || (size_t) r >= sizeof(service)) {
+        LOGE("adb: request too long");
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    return execute_command(intr, port, serial, service, flags);
+}
@@ -0,0 +1,112 @@
+#ifndef SC_ADB_CLIENT_H
+#define SC_ADB_CLIENT_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/intr.h"
+
+#define SC_ADB_SERVER_PORT_DEFAULT 5037
+
+/**
+ * Client for the host protocol of the adb server
+ *
+ * It executes the adb commands in-process, by talking directly to the adb
+ * server listening on localhost, instead of executing an adb client process
+ * for each command.
+ *
+ * All the functions accept the same flags as the functions from adb.h.
+ */
+
+enum sc_adb_client_result {
+    SC_ADB_CLIENT_OK,
+    // The adb server returned an error (or the connection failed afterwards)
+    SC_ADB_CLIENT_ERROR,
+    // The adb server could not be reached (the caller may fall back to
+    // executing an adb process)
+    SC_ADB_CLIENT_UNAVAILABLE,
+};
+
+/**
+ * Request "host:version"
+ */
+enum sc_adb_client_result
+sc_adb_client_version(struct sc_intr *intr, uint16_t port, unsigned flags,
+                      unsigned *version);
+
+/**
+ * Request "host:devices-l"
+ *
+ * Return the device list in the same format as `adb devices -l` (with its
+ * header), as a NUL-terminated string to be freed by the caller.
+ */
+enum sc_adb_client_result
+sc_adb_client_list_devices(struct sc_intr *intr, uint16_t port,
+                           unsigned flags, char **out);
+
+/**
+ * Execute a command on the device via the "shell:" service
+ *
+ * Read at most len bytes of output into buf, and write the number of bytes
+ * read to out_len.
+ */
+enum sc_adb_client_result
+sc_adb_client_shell(struct sc_intr *intr, uint16_t port, const char *serial,
+                    const char *command, unsigned flags, char *buf, size_t len,
+                    size_t *out_len);
+
+/**
+ * Callback to report the progress of a push
+ *
+ * It is called from the pushing thread with the number of bytes sent so far.
+ */
+typedef void (*sc_adb_progress_fn)(uint64_t sent, void *userdata);
+
+/**
+ * Push a local file to the device via the "sync:" service
+ *
+ * If the remote path is a directory, the file is pushed into it (like
+ * `adb push`). Local directories are not supported: the result is
+ * SC_ADB_CLIENT_UNAVAILABLE, so that the caller falls back to the adb process.
+ *
+ * The progress callback may be NULL.
+ */
+enum sc_adb_client_result
+sc_adb_client_push(struct sc_intr *intr, uint16_t port, const char *serial,
+                   const char *local, const char *remote, unsigned flags,
+                   sc_adb_progress_fn on_progress, void *userdata);
+
+/**
+ * Request "host-serial:<serial>:forward:<local>;<remote>"
+ */
+enum sc_adb_client_result
+sc_adb_client_forward(struct sc_intr *intr, uint16_t port, const char *serial,
+                      const char *local, const char *remote, unsigned flags);
+
+/**
+ * Request "host-serial:<serial>:killforward:<local>"
+ */
+enum sc_adb_client_result
+sc_adb_client_forward_remove(struct sc_intr *intr, uint16_t port,
+                             const char *serial, const char *local,
+                             unsigned flags);
+
+/**
+ * Request "reverse:forward:<remote>;<local>" on the device
+ */
+enum sc_adb_client_result
+sc_adb_client_reverse(struct sc_intr *intr, uint16_t port, const char *serial,
+                      const char *remote, const char *local, unsigned flags);
+
+/**
+ * Request "reverse:killforward:<remote>" on the device
+ */
+enum sc_adb_client_result
+sc_adb_client_reverse_remove(struct sc_intr *intr, uint16_t port,
+                             const char *serial, const char *remote,
+                             unsigned flags);
+
+#endif
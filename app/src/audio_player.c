@@ -1,6 +1,8 @@
 #include "audio_player.h"
 
 #include "util/log.h"
+#include "util/thread.h"
+#include "util/trace.h"
 #include "SDL3/SDL_hints.h"
 
 /** Downcast frame_sink to sc_audio_player */
@@ -23,8 +25,14 @@ sc_audio_player_stream_callback(void *userdata, SDL_AudioStream *stream,
     while (len) {
         size_t chunk_size = MIN(ap->aout_buffer_size, len);
         uint32_t out_samples = chunk_size / ap->audioreg.sample_size;
-        sc_audio_regulator_pull(&ap->audioreg, ap->aout_buffer,
-                                out_samples);
+        sc_tick trace = sc_trace_begin();
+        uint32_t silence = sc_audio_regulator_pull(&ap->audioreg,
+                                                   ap->aout_buffer,
+                                                   out_samples);
+        sc_trace_end("sc_audio_regulator_pull", trace);
+        if (silence && ap->metrics) {
+            sc_metrics_add_audio_underflow(ap->metrics, silence);
+        }
 
         assert(chunk_size <= len);
         len -= chunk_size;
@@ -42,7 +50,11 @@ sc_audio_player_frame_sink_push(struct sc_frame_sink *sink,
                                 const AVFrame *frame) {
     struct sc_audio_player *ap = DOWNCAST(sink);
 
-    return sc_audio_regulator_push(&ap->audioreg, frame);
+    sc_tick trace = sc_trace_begin();
+    bool ok = sc_audio_regulator_push(&ap->audioreg, frame);
+    sc_trace_end("sc_audio_regulator_push", trace);
+
+    return ok;
 }
 
 static bool
@@ -107,9 +119,15 @@ sc_audio_player_frame_sink_open(struct sc_frame_sink *sink,
         .channels = nb_channels,
     };
 
+    // The SDL audio thread, created by this call, inherits the CPU affinity
+    // of the current (media) thread, but it must not be pinned
+    bool pinned = sc_thread_unpin();
     ap->stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK,
                                            &spec,
                                            sc_audio_player_stream_callback, ap);
+    if (pinned) {
+        sc_thread_pin();
+    }
     if (!ap->stream) {
         LOGE("Could not open audio device: %s", SDL_GetError());
         free(ap->aout_buffer);
@@ -150,9 +168,11 @@ sc_audio_player_frame_sink_close(struct sc_frame_sink *sink) {
 
 void
 sc_audio_player_init(struct sc_audio_player *ap, sc_tick target_buffering,
-                     sc_tick output_buffer_duration) {
+                     sc_tick output_buffer_duration,
+                     struct sc_metrics *metrics) {
     ap->target_buffering_delay = target_buffering;
     ap->output_buffer_duration = output_buffer_duration;
+    ap->metrics = metrics;
 
     static const struct sc_frame_sink_ops ops = {
         .open = sc_audio_player_frame_sink_open,
@@ -6,6 +6,7 @@
 #include <SDL3/SDL_audio.h>
 
 #include "audio_regulator.h"
+#include "metrics.h"
 #include "trait/frame_sink.h"
 #include "util/tick.h"
 
@@ -28,10 +29,12 @@ struct sc_audio_player {
     SDL_AudioStream *stream;
     SDL_AudioDeviceID device; // owned by the audio stream
     struct sc_audio_regulator audioreg;
+
+    struct sc_metrics *metrics; // optional
 };
 
 void
 sc_audio_player_init(struct sc_audio_player *ap, sc_tick target_buffering,
-                     sc_tick audio_output_buffer);
+                     sc_tick audio_output_buffer, struct sc_metrics *metrics);
 
 #endif
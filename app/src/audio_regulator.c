@@ -59,7 +59,7 @@
 #define TO_BYTES(SAMPLES) sc_audiobuf_to_bytes(&ar->buf, (SAMPLES))
 #define TO_SAMPLES(BYTES) sc_audiobuf_to_samples(&ar->buf, (BYTES))
 
-void
+uint32_t
 sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
                         uint32_t out_samples) {
 #ifdef SC_AUDIO_REGULATOR_DEBUG
@@ -85,7 +85,7 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
             // arbitrary margin value).
             memset(out, 0, out_samples * ar->sample_size);
             sc_mutex_unlock(&ar->mutex);
-            return;
+            return 0;
         }
     }
 
@@ -93,6 +93,8 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
 
     sc_mutex_unlock(&ar->mutex);
 
+    uint32_t underflow = 0;
+
     if (read < out_samples) {
         uint32_t silence = out_samples - read;
         // Insert silence. In theory, the inserted silent samples replace the
@@ -112,10 +114,12 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
             // Inserting additional samples immediately increases buffering
             atomic_fetch_add_explicit(&ar->underflow, silence,
                                       memory_order_relaxed);
+            underflow = silence;
         }
     }
 
     atomic_store_explicit(&ar->played, true, memory_order_relaxed);
+    return underflow;
 }
 
 static uint8_t *
@@ -72,7 +72,9 @@ sc_audio_regulator_destroy(struct sc_audio_regulator *ar);
 bool
 sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame);
 
-void
+// Return the number of silent samples inserted on underflow (the silence
+// inserted before the first samples are received is not an underflow)
+uint32_t
 sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
                         uint32_t samples);
 
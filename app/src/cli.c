@@ -116,6 +116,28 @@ enum {
     OPT_DISPLAY_IME_POLICY,
     OPT_CAMERA_TORCH,
     OPT_CAMERA_ZOOM,
+    OPT_LATENCY_PROBE,
+    OPT_COMPACT_CONTROL,
+    OPT_NO_SERVER_CACHE,
+    OPT_STARTUP_PROFILE,
+    OPT_NO_SESSION_CACHE,
+    OPT_SERIALS,
+    OPT_VIDEO_WALL,
+    OPT_PUSH_WORKERS,
+    OPT_RECONNECT,
+    OPT_VIDEO_SOCKET_TUNING,
+    OPT_AUDIO_SOCKET_TUNING,
+    OPT_CONTROL_SOCKET_TUNING,
+    OPT_METRICS_PORT,
+    OPT_THREAD_PRIORITY,
+    OPT_CPU_AFFINITY,
+    OPT_HID_REPORT_RATE,
+    OPT_ASYNC_LOG,
+    OPT_TRACE,
+    OPT_FRAME_PACING,
+    OPT_LATE_LATCH,
+    OPT_DOWNSCALE_FILTER,
+    OPT_V4L2_ORIENTATION,
 };
 
 struct sc_option {
@@ -164,6 +186,17 @@ static const struct sc_option options[] = {
         .text = "Rotate the video content by a custom angle, in degrees "
                 "(clockwise).",
     },
+    {
+        .longopt_id = OPT_ASYNC_LOG,
+        .longopt = "async-log",
+        .text = "Write the logs from a background thread, so that logging "
+                "(even verbose) does not slow down the other threads. Each "
+                "message is prefixed by the date it was logged at, in seconds "
+                "since the start.\n"
+                "If the logs are produced faster than they can be written, "
+                "the verbose, debug and info messages are dropped (their "
+                "count is reported).",
+    },
     {
         .longopt_id = OPT_AUDIO_BIT_RATE,
         .longopt = "audio-bit-rate",
@@ -215,6 +248,13 @@ static const struct sc_option options[] = {
                 "codec provided by --audio-codec).\n"
                 "The available encoders can be listed by --list-encoders.",
     },
+    {
+        .longopt_id = OPT_AUDIO_SOCKET_TUNING,
+        .longopt = "audio-socket-tuning",
+        .argdesc = "option[,...]",
+        .text = "Tune the audio socket on the computer side.\n"
+                "See --video-socket-tuning.",
+    },
     {
         .longopt_id = OPT_AUDIO_SOURCE,
         .longopt = "audio-source",
@@ -358,6 +398,33 @@ static const struct sc_option options[] = {
         .longopt = "codec-options",
         .argdesc = "key[:type]=value[,...]",
     },
+    {
+        .longopt_id = OPT_COMPACT_CONTROL,
+        .longopt = "compact-control",
+        .text = "Send touch events in a compact form, relative to the "
+                "previous event of the same pointer.\n"
+                "It reduces the bandwidth used by multi-touch gestures "
+                "(typically from 32 to about 5 bytes per move event).",
+    },
+    {
+        .longopt_id = OPT_CONTROL_SOCKET_TUNING,
+        .longopt = "control-socket-tuning",
+        .argdesc = "option[,...]",
+        .text = "Tune the control socket on the computer side.\n"
+                "See --video-socket-tuning.",
+    },
+    {
+        .longopt_id = OPT_CPU_AFFINITY,
+        .longopt = "cpu-affinity",
+        .argdesc = "cpus",
+        .text = "Run the media (receiving, decoding, buffering) and rendering "
+                "threads only on the given CPUs, as a comma-separated list of "
+                "CPU numbers or ranges, for example \"2,4-7\".\n"
+                "Pinning them to dedicated cores reduces the jitter caused by "
+                "migrations and by other processes.\n"
+                "Only CPUs 0 to 63 can be selected. This is not supported on "
+                "macOS.",
+    },
     {
         .longopt_id = OPT_CROP,
         .longopt = "crop",
@@ -422,6 +489,19 @@ static const struct sc_option options[] = {
                 "before the rotation.\n"
                 "Default is 0.",
     },
+    {
+        .longopt_id = OPT_DOWNSCALE_FILTER,
+        .longopt = "downscale-filter",
+        .argdesc = "filter",
+        .text = "Select the filter used to scale the video to the window "
+                "size.\n"
+                "Possible values are \"trilinear\" (using mipmaps, see "
+                "--no-mipmaps), \"bicubic\" and \"lanczos\".\n"
+                "The \"bicubic\" and \"lanczos\" filters convert the colors "
+                "and scale the frame in a single shader pass. They require "
+                "an OpenGL 3.3+ or OpenGL ES 3.0+ renderer.\n"
+                "Default is trilinear.",
+    },
     {
         .shortopt = 'e',
         .longopt = "select-tcpip",
@@ -450,6 +530,18 @@ static const struct sc_option options[] = {
         .longopt_id = OPT_FORWARD_ALL_CLICKS,
         .longopt = "forward-all-clicks",
     },
+    {
+        .longopt_id = OPT_FRAME_PACING,
+        .longopt = "frame-pacing",
+        .argdesc = "ms",
+        .text = "Present video frames at a steady rate, aligned on the display "
+                "refresh, to reduce judder caused by network jitter.\n"
+                "Frames are delayed by an adaptive delay computed from the "
+                "jitter, which never exceeds the given value (in "
+                "milliseconds).\n"
+                "This trades a small latency increase for smoother motion.\n"
+                "Default is 0 (no frame pacing).",
+    },
     {
         .shortopt = 'G',
         .text = "Same as --gamepad=uhid, or --gamepad=aoa if --otg is set.",
@@ -472,6 +564,17 @@ static const struct sc_option options[] = {
         .longopt = "help",
         .text = "Print this help.",
     },
+    {
+        .longopt_id = OPT_HID_REPORT_RATE,
+        .longopt = "hid-report-rate",
+        .argdesc = "value",
+        .text = "Limit the rate of the HID mouse and gamepad reports (in "
+                "reports per second) in UHID and AOA modes.\n"
+                "Within a report period, the relative mouse motion is "
+                "accumulated and only the last gamepad axes values are sent. "
+                "Button changes are always sent immediately.\n"
+                "Default is 0 (unlimited).",
+    },
     {
         .shortopt = 'K',
         .text = "Same as --keyboard=uhid, or --keyboard=aoa if --otg is set.",
@@ -511,6 +614,24 @@ static const struct sc_option options[] = {
         .longopt_id = OPT_HID_KEYBOARD_DEPRECATED,
         .longopt = "hid-keyboard",
     },
+    {
+        .longopt_id = OPT_LATE_LATCH,
+        .longopt = "late-latch",
+        .text = "Render the newest decoded frame shortly before the next "
+                "vsync, rather than as soon as a frame is decoded, to reduce "
+                "the age of the frames when they are displayed.\n"
+                "The frame age statistics are printed on exit.",
+    },
+    {
+        .longopt_id = OPT_LATENCY_PROBE,
+        .longopt = "latency-probe",
+        .text = "Measure the input-to-frame latency.\n"
+                "Each key press, mouse click and touch down is followed by a "
+                "request acknowledged by the device once the event is "
+                "injected. The delay until the first frame whose content "
+                "changed is recorded, and the statistics are printed on "
+                "exit.",
+    },
     {
         .longopt_id = OPT_LEGACY_PASTE,
         .longopt = "legacy-paste",
@@ -576,6 +697,16 @@ static const struct sc_option options[] = {
         .text = "Limit the frame rate of screen capture (officially supported "
                 "since Android 10, but may work on earlier versions).",
     },
+    {
+        .longopt_id = OPT_METRICS_PORT,
+        .longopt = "metrics-port",
+        .argdesc = "port",
+        .text = "Expose the session metrics (bit rate, packet rate, key frame "
+                "interval, decoding and rendering time, skipped frames, audio "
+                "underflows...) in Prometheus text format at "
+                "http://127.0.0.1:<port>/metrics.\n"
+                "The endpoint is only reachable from the local computer.",
+    },
     {
         .longopt_id = OPT_MOUSE,
         .longopt = "mouse",
@@ -707,6 +838,24 @@ static const struct sc_option options[] = {
         .longopt = "no-power-on",
         .text = "Do not power on the device on start.",
     },
+    {
+        .longopt_id = OPT_NO_SERVER_CACHE,
+        .longopt = "no-server-cache",
+        .text = "By default, scrcpy keeps a copy of the server on the device, "
+                "identified by the hash of its content, to avoid pushing it "
+                "again on the next start if it did not change.\n"
+                "This option disables this cache (the server is always "
+                "pushed).",
+    },
+    {
+        .longopt_id = OPT_NO_SESSION_CACHE,
+        .longopt = "no-session-cache",
+        .text = "By default, scrcpy remembers the video codec and size of the "
+                "last session with each device (in the user cache directory), "
+                "to open the decoder and show the window before the first "
+                "frame is received.\n"
+                "This option disables this cache.",
+    },
     {
         .longopt_id = OPT_NO_VD_DESTROY_CONTENT,
         .longopt = "no-vd-destroy-content",
@@ -741,7 +890,7 @@ static const struct sc_option options[] = {
         .longopt = "orientation",
         .argdesc = "value",
         .text = "Same as --display-orientation=value "
-                "--record-orientation=value.",
+                "--record-orientation=value --v4l2-orientation=value.",
     },
     {
         .longopt_id = OPT_OTG,
@@ -808,6 +957,26 @@ static const struct sc_option options[] = {
                 "drag & drop. It is passed as is to \"adb push\".\n"
                 "Default is \"/sdcard/Download/\".",
     },
+    {
+        .longopt_id = OPT_PUSH_WORKERS,
+        .longopt = "push-workers",
+        .argdesc = "n",
+        .text = "Set the maximum number of files pushed or APKs installed "
+                "concurrently, when several files are dropped onto the "
+                "window.\n"
+                "Identical requests are ignored while pending, and "
+                "MOD+Shift+Backspace cancels all the pending requests.\n"
+                "Default is 2.",
+    },
+    {
+        .longopt_id = OPT_RECONNECT,
+        .longopt = "reconnect",
+        .text = "Reconnect automatically when the connection with the device "
+                "is lost or stalls (no packet received for 5 seconds), "
+                "without closing the window nor the recording.\n"
+                "The server is restarted, and the streams are resumed where "
+                "they stopped.",
+    },
     {
         .shortopt = 'r',
         .longopt = "record",
@@ -867,6 +1036,21 @@ static const struct sc_option options[] = {
         .text = "The device serial number. Mandatory only if several devices "
                 "are connected to adb.",
     },
+    {
+        .longopt_id = OPT_SERIALS,
+        .longopt = "serials",
+        .argdesc = "serial[,...]",
+        .text = "Mirror several devices from a single process, each in its "
+                "own window.\n"
+                "The devices share the same adb server connection and the "
+                "same event loop. On exit, the amount of data received and "
+                "the decoding time are logged for each device.\n"
+                "Only the options which apply to each device independently "
+                "are supported (in particular, recording, V4L2, AOA, gamepads "
+                "and device selectors are not).\n"
+                "For example:\n"
+                "    scrcpy --serials=0123456789abcdef,192.168.1.2:5555",
+    },
     {
         .shortopt = 'S',
         .longopt = "turn-screen-off",
@@ -906,6 +1090,13 @@ static const struct sc_option options[] = {
                 "Both prefixes can be used, in that order:\n"
                 "    scrcpy --start-app=+?firefox",
     },
+    {
+        .longopt_id = OPT_STARTUP_PROFILE,
+        .longopt = "startup-profile",
+        .text = "Log the duration of each startup phase (adb commands, server "
+                "push and start, initialization), and the time to the first "
+                "frame.",
+    },
     {
         .shortopt = 't',
         .longopt = "show-touches",
@@ -928,12 +1119,39 @@ static const struct sc_option options[] = {
                 "this address before starting.\n"
                 "Prefix the address with a '+' to force a reconnection.",
     },
+    {
+        .longopt_id = OPT_THREAD_PRIORITY,
+        .longopt = "thread-priority",
+        .argdesc = "value",
+        .text = "Select the scheduling policy of the scrcpy threads.\n"
+                "Possible values are \"normal\", \"high\" and "
+                "\"realtime\".\n"
+                "\"high\" raises the priority of the media, rendering and "
+                "control threads.\n"
+                "\"realtime\" additionally runs the media threads with a "
+                "real-time policy (SCHED_FIFO on Linux), so that they are "
+                "never delayed by normal threads. On Linux, this requires the "
+                "CAP_SYS_NICE capability or an RLIMIT_RTPRIO limit (see "
+                "/etc/security/limits.conf); otherwise scrcpy falls back to "
+                "\"high\".\n"
+                "Recording and file pushing always run with a low priority.\n"
+                "Default is normal.",
+    },
     {
         .longopt_id = OPT_TIME_LIMIT,
         .longopt = "time-limit",
         .argdesc = "seconds",
         .text = "Set the maximum mirroring time, in seconds.",
     },
+    {
+        .longopt_id = OPT_TRACE,
+        .longopt = "trace",
+        .argdesc = "file",
+        .text = "Record the duration of the main processing stages "
+                "(receiving, decoding, rendering, audio buffering, sending "
+                "control messages) of all the threads to a file, in the Chrome "
+                "trace format (to be opened in Perfetto or chrome://tracing).",
+    },
     {
         .longopt_id = OPT_TUNNEL_HOST,
         .longopt = "tunnel-host",
@@ -987,6 +1205,18 @@ static const struct sc_option options[] = {
                 "Default is 0 (no buffering).\n"
                 "This option is only available on Linux.",
     },
+    {
+        .longopt_id = OPT_V4L2_ORIENTATION,
+        .longopt = "v4l2-orientation",
+        .argdesc = "value",
+        .text = "Set the orientation of the video sent to the V4L2 sink.\n"
+                "Possible values are 0, 90, 180, 270, flip0, flip90, flip180 "
+                "and flip270. The number represents the clockwise rotation "
+                "in degrees; the \"flip\" keyword applies a horizontal flip "
+                "before the rotation.\n"
+                "Default is 0.\n"
+                "This option is only available on Linux.",
+    },
     {
         .longopt_id = OPT_VIDEO_BUFFER,
         .longopt = "video-buffer",
@@ -1023,6 +1253,27 @@ static const struct sc_option options[] = {
                 "codec provided by --video-codec).\n"
                 "The available encoders can be listed by --list-encoders.",
     },
+    {
+        .longopt_id = OPT_VIDEO_SOCKET_TUNING,
+        .longopt = "video-socket-tuning",
+        .argdesc = "option[,...]",
+        .text = "Tune the video socket on the computer side.\n"
+                "This socket is connected to the local adb server (or to "
+                "--tunnel-host): the options do not affect the link between "
+                "the adb server and the device.\n"
+                "The value is a comma-separated list of:\n"
+                " - \"rcvbuf=N\": the receive buffer size (SO_RCVBUF), in "
+                "bytes (suffixes K and M are accepted)\n"
+                " - \"sndbuf=N\": the send buffer size (SO_SNDBUF)\n"
+                " - \"rcvlowat=N\": the minimal number of bytes to wake up a "
+                "blocked read (SO_RCVLOWAT)\n"
+                " - \"busy-poll=USEC\": busy poll the device queue for reads "
+                "(SO_BUSY_POLL, Linux only)\n"
+                " - \"quickack\": acknowledge immediately (TCP_QUICKACK, "
+                "Linux only)\n"
+                "The options not specified keep the system defaults.\n"
+                "For example: --video-socket-tuning=rcvbuf=4M,quickack",
+    },
     {
         .longopt_id = OPT_VIDEO_SOURCE,
         .longopt = "video-source",
@@ -1031,6 +1282,15 @@ static const struct sc_option options[] = {
                 "Camera mirroring requires Android 12+.\n"
                 "Default is display.",
     },
+    {
+        .longopt_id = OPT_VIDEO_WALL,
+        .longopt = "video-wall",
+        .text = "Render all the devices mirrored by --serials in tiles, in a "
+                "single window, instead of one window per device.\n"
+                "This is a monitoring view: inputs are not forwarded to the "
+                "devices. Double-click on a tile to display it alone, and "
+                "double-click again to restore the grid.",
+    },
     {
         .shortopt = 'w',
         .longopt = "stay-awake",
@@ -1220,6 +1480,10 @@ static const struct sc_shortcut shortcuts[] = {
         .shortcuts = { "Drag & drop non-APK file" },
         .text = "Push file to device (see --push-target)",
     },
+    {
+        .shortcuts = { "MOD+Shift+Backspace" },
+        .text = "Cancel the pending file pushes and APK installations",
+    },
     {
         .shortcuts = { "MOD+t" },
         .text = "Turn on the camera torch (camera mode only)",
@@ -1662,6 +1926,19 @@ parse_buffering_time(const char *s, sc_tick *tick) {
     return true;
 }
 
+static bool
+parse_frame_pacing(const char *s, sc_tick *tick) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 1000,
+                                "frame pacing delay");
+    if (!ok) {
+        return false;
+    }
+
+    *tick = SC_TICK_FROM_MS(value);
+    return true;
+}
+
 static bool
 parse_audio_output_buffer(const char *s, sc_tick *tick) {
     long value;
@@ -1941,6 +2218,232 @@ sc_parse_shortcut_mods(const char *s, uint8_t *mods) {
 }
 #endif
 
+static bool
+parse_socket_tuning_item(const char *item, size_t len,
+                         struct sc_socket_tuning *tuning) {
+    const char *eq = memchr(item, '=', len);
+    size_t key_len = eq ? (size_t) (eq - item) : len;
+
+#define KEYEQ(literal) \
+    ((sizeof(literal)-1 == key_len) && !memcmp(literal, item, key_len))
+
+    if (KEYEQ("quickack")) {
+        if (eq) {
+            LOGE("Socket option quickack does not take a value");
+            return false;
+        }
+        tuning->quickack = true;
+        return true;
+    }
+
+    uint32_t *target;
+    bool accept_suffix = true;
+    if (KEYEQ("rcvbuf")) {
+        target = &tuning->recv_buffer_size;
+    } else if (KEYEQ("sndbuf")) {
+        target = &tuning->send_buffer_size;
+    } else if (KEYEQ("rcvlowat")) {
+        target = &tuning->recv_lowat;
+    } else if (KEYEQ("busy-poll")) {
+        target = &tuning->busy_poll;
+        accept_suffix = false;
+    } else {
+        LOGE("Unknown socket option: %.*s "
+             "(must be one of: rcvbuf, sndbuf, rcvlowat, busy-poll, quickack)",
+             (int) key_len, item);
+        return false;
+    }
+#undef KEYEQ
+
+    if (!eq) {
+        LOGE("Socket option %.*s requires a value", (int) key_len, item);
+        return false;
+    }
+
+    // parse_integer_arg() requires a NUL-terminated string
+    char value_str[32];
+    size_t value_len = len - key_len - 1;
+    if (!value_len || value_len >= sizeof(value_str)) {
+        LOGE("Invalid value for socket option %.*s", (int) key_len, item);
+        return false;
+    }
+    memcpy(value_str, eq + 1, value_len);
+    value_str[value_len] = '\0';
+
+    long value;
+    bool ok = parse_integer_arg(value_str, &value, accept_suffix, 1,
+                                0x7FFFFFFF, "socket option value");
+    if (!ok) {
+        return false;
+    }
+
+    *target = (uint32_t) value;
+    return true;
+}
+
+static bool
+parse_socket_tuning(const char *s, struct sc_socket_tuning *tuning) {
+    struct sc_socket_tuning result = {0};
+
+    // A list of socket options, for example "rcvbuf=4M,quickack"
+
+    for (;;) {
+        char *comma = strchr(s, ',');
+        size_t limit = comma ? (size_t) (comma - s) : strlen(s);
+        if (!limit) {
+            LOGE("Empty socket option");
+            return false;
+        }
+
+        if (!parse_socket_tuning_item(s, limit, &result)) {
+            return false;
+        }
+
+        if (!comma) {
+            break;
+        }
+
+        s = comma + 1;
+    }
+
+    *tuning = result;
+    return true;
+}
+
+#ifdef SC_TEST
+// expose the function to unit-tests
+bool
+sc_parse_socket_tuning(const char *s, struct sc_socket_tuning *tuning) {
+    return parse_socket_tuning(s, tuning);
+}
+#endif
+
+static bool
+parse_thread_priority(const char *s, enum sc_thread_sched *sched) {
+    if (!strcmp(s, "normal")) {
+        *sched = SC_THREAD_SCHED_NORMAL;
+        return true;
+    }
+
+    if (!strcmp(s, "high")) {
+        *sched = SC_THREAD_SCHED_HIGH;
+        return true;
+    }
+
+    if (!strcmp(s, "realtime")) {
+        *sched = SC_THREAD_SCHED_REALTIME;
+        return true;
+    }
+
+    LOGE("Unsupported thread priority: %s (expected normal, high or "
+         "realtime)", s);
+    return false;
+}
+
+static bool
+parse_cpu_affinity_item(const char *item, size_t len, uint64_t *mask) {
+    // parse_integer_arg() requires a NUL-terminated string
+    char buf[16];
+    if (len >= sizeof(buf)) {
+        LOGE("Invalid CPU: %.*s", (int) len, item);
+        return false;
+    }
+    memcpy(buf, item, len);
+    buf[len] = '\0';
+
+    long first;
+    long last;
+    char *dash = strchr(buf, '-');
+    if (dash) {
+        *dash = '\0';
+        if (!parse_integer_arg(buf, &first, false, 0, 63, "CPU")
+                || !parse_integer_arg(dash + 1, &last, false, 0, 63, "CPU")) {
+            return false;
+        }
+        if (first > last) {
+            LOGE("Invalid CPU range: %ld-%ld", first, last);
+            return false;
+        }
+    } else {
+        if (!parse_integer_arg(buf, &first, false, 0, 63, "CPU")) {
+            return false;
+        }
+        last = first;
+    }
+
+    for (long i = first; i <= last; ++i) {
+        *mask |= UINT64_C(1) << i;
+    }
+
+    return true;
+}
+
+static bool
+parse_cpu_affinity(const char *s, uint64_t *cpu_affinity) {
+    uint64_t mask = 0;
+
+    // A list of CPUs or ranges of CPUs, for example "2,4-7"
+
+    for (;;) {
+        char *comma = strchr(s, ',');
+        size_t limit = comma ? (size_t) (comma - s) : strlen(s);
+        if (!limit) {
+            LOGE("Empty CPU in --cpu-affinity");
+            return false;
+        }
+
+        if (!parse_cpu_affinity_item(s, limit, &mask)) {
+            return false;
+        }
+
+        if (!comma) {
+            break;
+        }
+
+        s = comma + 1;
+    }
+
+    assert(mask);
+    *cpu_affinity = mask;
+    return true;
+}
+
+#ifdef SC_TEST
+// expose the function to unit-tests
+bool
+sc_parse_cpu_affinity(const char *s, uint64_t *cpu_affinity) {
+    return parse_cpu_affinity(s, cpu_affinity);
+}
+#endif
+
+static bool
+parse_serials(const char *s) {
+    // A list of serials, for example "0123456789abcdef,192.168.1.2:5555"
+    unsigned count = 0;
+
+    for (;;) {
+        const char *comma = strchr(s, ',');
+        size_t len = comma ? (size_t) (comma - s) : strlen(s);
+        if (!len) {
+            LOGE("Empty serial in --serials");
+            return false;
+        }
+
+        if (++count > SC_MAX_SERIALS) {
+            LOGE("Too many serials (max %d)", SC_MAX_SERIALS);
+            return false;
+        }
+
+        if (!comma) {
+            break;
+        }
+
+        s = comma + 1;
+    }
+
+    return true;
+}
+
 static enum sc_record_format
 get_record_format(const char *name) {
     if (!strcmp(name, "mp4")) {
@@ -2158,6 +2661,29 @@ parse_camera_facing(const char *optarg, enum sc_camera_facing *facing) {
     return false;
 }
 
+static bool
+parse_downscale_filter(const char *optarg,
+                       enum sc_downscale_filter *filter) {
+    if (!strcmp(optarg, "trilinear")) {
+        *filter = SC_DOWNSCALE_FILTER_TRILINEAR;
+        return true;
+    }
+
+    if (!strcmp(optarg, "bicubic")) {
+        *filter = SC_DOWNSCALE_FILTER_BICUBIC;
+        return true;
+    }
+
+    if (!strcmp(optarg, "lanczos")) {
+        *filter = SC_DOWNSCALE_FILTER_LANCZOS;
+        return true;
+    }
+
+    LOGE("Unsupported downscale filter: %s (expected trilinear, bicubic or "
+         "lanczos)", optarg);
+    return false;
+}
+
 static bool
 parse_camera_fps(const char *s, uint16_t *camera_fps) {
     long value;
@@ -2170,6 +2696,31 @@ parse_camera_fps(const char *s, uint16_t *camera_fps) {
     return true;
 }
 
+static bool
+parse_hid_report_rate(const char *s, uint16_t *report_rate) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 1000, "HID report rate");
+    if (!ok) {
+        return false;
+    }
+
+    *report_rate = (uint16_t) value;
+    return true;
+}
+
+static bool
+parse_push_workers(const char *s, uint8_t *push_workers) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 1, SC_MAX_PUSH_WORKERS,
+                                "push workers");
+    if (!ok) {
+        return false;
+    }
+
+    *push_workers = (uint8_t) value;
+    return true;
+}
+
 static bool
 parse_keyboard(const char *optarg, enum sc_keyboard_input_mode *mode) {
     if (!strcmp(optarg, "disabled")) {
@@ -2572,6 +3123,11 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_PUSH_TARGET:
                 opts->push_target = optarg;
                 break;
+            case OPT_PUSH_WORKERS:
+                if (!parse_push_workers(optarg, &opts->push_workers)) {
+                    return false;
+                }
+                break;
             case OPT_PREFER_TEXT:
                 if (opts->key_inject_mode != SC_KEY_INJECT_MODE_MIXED) {
                     LOGE("--prefer-text is incompatible with --raw-key-events");
@@ -2607,6 +3163,9 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                 }
                 opts->display_orientation = orientation;
                 opts->record_orientation = orientation;
+#ifdef HAVE_V4L2
+                opts->v4l2_orientation = orientation;
+#endif
                 break;
             }
             case OPT_RENDER_DRIVER:
@@ -2615,6 +3174,11 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_NO_MIPMAPS:
                 opts->mipmaps = false;
                 break;
+            case OPT_DOWNSCALE_FILTER:
+                if (!parse_downscale_filter(optarg, &opts->downscale_filter)) {
+                    return false;
+                }
+                break;
             case OPT_NO_KEY_REPEAT:
                 opts->forward_key_repeat = false;
                 break;
@@ -2668,6 +3232,11 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_FRAME_PACING:
+                if (!parse_frame_pacing(optarg, &opts->frame_pacing)) {
+                    return false;
+                }
+                break;
             case OPT_NO_CLIPBOARD_AUTOSYNC:
                 opts->clipboard_autosync = false;
                 break;
@@ -2690,6 +3259,12 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_NO_POWER_ON:
                 opts->power_on = false;
                 break;
+            case OPT_NO_SERVER_CACHE:
+                opts->server_cache = false;
+                break;
+            case OPT_NO_SESSION_CACHE:
+                opts->session_cache = false;
+                break;
             case OPT_PRINT_FPS:
                 opts->start_fps_counter = true;
                 break;
@@ -2734,6 +3309,17 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                 LOGE("V4L2 (--v4l2-buffer) is disabled (or unsupported on this "
                      "platform).");
                 return false;
+#endif
+            case OPT_V4L2_ORIENTATION:
+#ifdef HAVE_V4L2
+                if (!parse_orientation(optarg, &opts->v4l2_orientation)) {
+                    return false;
+                }
+                break;
+#else
+                LOGE("V4L2 (--v4l2-orientation) is disabled (or unsupported on "
+                     "this platform).");
+                return false;
 #endif
             case OPT_LIST_ENCODERS:
                 opts->list |= SC_OPTION_LIST_ENCODERS;
@@ -2815,6 +3401,76 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_CAMERA_ZOOM:
                 opts->camera_zoom = optarg;
                 break;
+            case OPT_LATENCY_PROBE:
+                opts->latency_probe = true;
+                break;
+            case OPT_LATE_LATCH:
+                opts->late_latch = true;
+                break;
+            case OPT_METRICS_PORT:
+                if (!parse_port(optarg, &opts->metrics_port)) {
+                    return false;
+                }
+                if (!opts->metrics_port) {
+                    LOGE("The metrics port must not be 0");
+                    return false;
+                }
+                break;
+            case OPT_THREAD_PRIORITY:
+                if (!parse_thread_priority(optarg, &opts->thread_sched)) {
+                    return false;
+                }
+                break;
+            case OPT_CPU_AFFINITY:
+                if (!parse_cpu_affinity(optarg, &opts->cpu_affinity)) {
+                    return false;
+                }
+                break;
+            case OPT_HID_REPORT_RATE:
+                if (!parse_hid_report_rate(optarg, &opts->hid_report_rate)) {
+                    return false;
+                }
+                break;
+            case OPT_ASYNC_LOG:
+                opts->async_log = true;
+                break;
+            case OPT_TRACE:
+                opts->trace_file = optarg;
+                break;
+            case OPT_COMPACT_CONTROL:
+                opts->compact_control = true;
+                break;
+            case OPT_STARTUP_PROFILE:
+                opts->startup_profile = true;
+                break;
+            case OPT_SERIALS:
+                if (!parse_serials(optarg)) {
+                    return false;
+                }
+                opts->serials = optarg;
+                break;
+            case OPT_RECONNECT:
+                opts->reconnect = true;
+                break;
+            case OPT_VIDEO_SOCKET_TUNING:
+                if (!parse_socket_tuning(optarg, &opts->video_socket_tuning)) {
+                    return false;
+                }
+                break;
+            case OPT_AUDIO_SOCKET_TUNING:
+                if (!parse_socket_tuning(optarg, &opts->audio_socket_tuning)) {
+                    return false;
+                }
+                break;
+            case OPT_CONTROL_SOCKET_TUNING:
+                if (!parse_socket_tuning(optarg,
+                                         &opts->control_socket_tuning)) {
+                    return false;
+                }
+                break;
+            case OPT_VIDEO_WALL:
+                opts->video_wall = true;
+                break;
             case OPT_NO_WINDOW:
                 opts->window = false;
                 break;
@@ -3321,6 +3977,137 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         opts->start_fps_counter = false;
     }
 
+    if (opts->frame_pacing && (!opts->video_playback || !opts->window)) {
+        LOGW("--frame-pacing has no effect without video playback");
+        opts->frame_pacing = 0;
+    }
+
+    if (opts->late_latch && (!opts->video_playback || !opts->window)) {
+        LOGW("--late-latch has no effect without video playback");
+        opts->late_latch = false;
+    }
+
+    if (opts->latency_probe && (!opts->control || !opts->video_playback
+                                || !opts->window)) {
+        LOGE("--latency-probe requires control, video playback and a window");
+        return false;
+    }
+
+    if (opts->compact_control && !opts->control) {
+        LOGE("--compact-control requires control");
+        return false;
+    }
+
+    if (opts->latency_probe && opts->video_source == SC_VIDEO_SOURCE_CAMERA) {
+        LOGE("--latency-probe is not supported for camera");
+        return false;
+    }
+
+    if (opts->serials) {
+        // Several devices are mirrored from a single process, so only the
+        // options which apply to each device independently are supported
+        if (selectors || opts->tcpip) {
+            LOGE("--serials is incompatible with device selectors (-s, -d, -e "
+                 "and --tcpip)");
+            return false;
+        }
+        if (otg) {
+            LOGE("--serials is incompatible with OTG mode");
+            return false;
+        }
+        if (opts->list) {
+            LOGE("--serials is incompatible with --list-*");
+            return false;
+        }
+        if (opts->record_filename) {
+            LOGE("--serials is incompatible with --record");
+            return false;
+        }
+        if (v4l2) {
+            LOGE("--serials is incompatible with --v4l2-sink");
+            return false;
+        }
+        if (opts->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_AOA
+                || opts->mouse_input_mode == SC_MOUSE_INPUT_MODE_AOA) {
+            LOGE("--serials is incompatible with AOA input modes");
+            return false;
+        }
+        if (opts->gamepad_input_mode != SC_GAMEPAD_INPUT_MODE_DISABLED) {
+            LOGE("--serials is incompatible with gamepad forwarding");
+            return false;
+        }
+        if (opts->time_limit) {
+            LOGE("--serials is incompatible with --time-limit");
+            return false;
+        }
+        if (opts->latency_probe || opts->startup_profile) {
+            LOGE("--serials is incompatible with --latency-probe and "
+                 "--startup-profile");
+            return false;
+        }
+        if (opts->metrics_port) {
+            LOGE("--serials is incompatible with --metrics-port");
+            return false;
+        }
+        if (opts->frame_pacing) {
+            LOGE("--serials is incompatible with --frame-pacing");
+            return false;
+        }
+        if (opts->late_latch) {
+            LOGE("--serials is incompatible with --late-latch");
+            return false;
+        }
+        if (opts->kill_adb_on_close) {
+            LOGE("--serials is incompatible with --kill-adb-on-close");
+            return false;
+        }
+    }
+
+    if (opts->reconnect) {
+        if (opts->serials || otg || opts->list) {
+            LOGE("--reconnect is incompatible with --serials, OTG mode and "
+                 "--list-*");
+            return false;
+        }
+        if (!opts->video && !opts->audio) {
+            // The streams are used to detect a stalled connection
+            LOGE("--reconnect requires video or audio");
+            return false;
+        }
+        if (opts->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_UHID
+                || opts->mouse_input_mode == SC_MOUSE_INPUT_MODE_UHID
+                || opts->gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_UHID) {
+            // The UHID devices would not be recreated on the new connection
+            LOGE("--reconnect is incompatible with UHID input modes");
+            return false;
+        }
+        if (opts->power_off_on_close) {
+            // The device would be powered off on each disconnection
+            LOGE("--reconnect is incompatible with --power-off-on-close");
+            return false;
+        }
+    }
+
+    if (opts->metrics_port && (otg || opts->list)) {
+        LOGE("--metrics-port is incompatible with OTG mode and --list-*");
+        return false;
+    }
+
+    if (opts->video_wall) {
+        if (!opts->serials) {
+            LOGE("--video-wall requires --serials");
+            return false;
+        }
+        if (!opts->video_playback) {
+            LOGE("--video-wall requires video playback");
+            return false;
+        }
+        if (opts->downscale_filter != SC_DOWNSCALE_FILTER_TRILINEAR) {
+            LOGW("--downscale-filter is not supported by --video-wall");
+            opts->downscale_filter = SC_DOWNSCALE_FILTER_TRILINEAR;
+        }
+    }
+
     if (otg) {
         // OTG mode is compatible with only very few options.
         // Only report obvious errors.
@@ -29,6 +29,12 @@ scrcpy_parse_args(struct scrcpy_cli_args *args, int argc, char *argv[]);
 #ifdef SC_TEST
 bool
 sc_parse_shortcut_mods(const char *s, uint8_t *shortcut_mods);
+
+bool
+sc_parse_socket_tuning(const char *s, struct sc_socket_tuning *tuning);
+
+bool
+sc_parse_cpu_affinity(const char *s, uint64_t *cpu_affinity);
 #endif
 
 #endif
@@ -0,0 +1,563 @@
+#include "compositor.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "events.h"
+#include "icon.h"
+#include "util/log.h"
+#include "util/sdl.h"
+
+#define DOWNCAST(SINK) \
+    container_of(SINK, struct sc_compositor_tile, frame_sink)
+
+#define SC_COMPOSITOR_DEFAULT_WIDTH 1280
+#define SC_COMPOSITOR_DEFAULT_HEIGHT 720
+
+// Content size used for the layout until a first frame is received
+static const struct sc_size sc_compositor_default_content_size = {
+    .width = 1080,
+    .height = 1920,
+};
+
+static inline struct sc_size
+get_oriented_size(struct sc_size size, enum sc_orientation orientation) {
+    struct sc_size oriented_size;
+    if (sc_orientation_is_swap(orientation)) {
+        oriented_size.width = size.height;
+        oriented_size.height = size.width;
+    } else {
+        oriented_size.width = size.width;
+        oriented_size.height = size.height;
+    }
+    return oriented_size;
+}
+
+static inline bool
+is_tile_visible(struct sc_compositor *compositor, unsigned index) {
+    assert(index < compositor->count);
+    if (compositor->tiles[index].removed) {
+        return false;
+    }
+
+    return compositor->solo == -1 || (unsigned) compositor->solo == index;
+}
+
+static void
+sc_compositor_update_layout(struct sc_compositor *compositor) {
+    struct sc_size render_size =
+        sc_sdl_get_render_output_size(compositor->renderer);
+
+    // Use the content size of the first visible tile as a reference
+    struct sc_size content_size = sc_compositor_default_content_size;
+    unsigned count = 0;
+    for (unsigned i = 0; i < compositor->count; ++i) {
+        if (!is_tile_visible(compositor, i)) {
+            continue;
+        }
+        struct sc_compositor_tile *tile = &compositor->tiles[i];
+        if (!count && tile->has_frame) {
+            content_size = tile->content_size;
+        }
+        ++count;
+    }
+
+    compositor->visible_count = count;
+    if (!count) {
+        return;
+    }
+
+    compositor->grid = sc_tile_grid_compute(render_size, count, content_size);
+
+    unsigned layout_index = 0;
+    for (unsigned i = 0; i < compositor->count; ++i) {
+        if (!is_tile_visible(compositor, i)) {
+            continue;
+        }
+        struct sc_compositor_tile *tile = &compositor->tiles[i];
+
+        SDL_FRect cell;
+        sc_tile_grid_get_cell(compositor->grid, render_size, layout_index++,
+                              &cell);
+        if (tile->has_frame) {
+            sc_tile_fit(&cell, tile->content_size, &tile->rect);
+        } else {
+            tile->rect = cell;
+        }
+    }
+}
+
+// Upload the pending frames of the visible tiles.
+//
+// The frames of the hidden tiles are kept in their frame buffer, they will be
+// uploaded once visible.
+static void
+sc_compositor_update_tiles(struct sc_compositor *compositor) {
+    sc_tick start = sc_tick_now();
+    bool layout_changed = false;
+
+    for (unsigned i = 0; i < compositor->count; ++i) {
+        if (!is_tile_visible(compositor, i)) {
+            continue;
+        }
+
+        struct sc_compositor_tile *tile = &compositor->tiles[i];
+        bool pending = atomic_exchange_explicit(&tile->frame_pending, false,
+                                                memory_order_acq_rel);
+        if (!pending) {
+            // No new frame for this tile
+            continue;
+        }
+
+        AVFrame *frame = tile->frame;
+        sc_frame_buffer_consume(&tile->fb, frame);
+
+        struct sc_size frame_size = {frame->width, frame->height};
+        if (!tile->has_frame
+                || tile->frame_size.width != frame_size.width
+                || tile->frame_size.height != frame_size.height) {
+            tile->frame_size = frame_size;
+            tile->content_size =
+                get_oriented_size(frame_size, compositor->orientation);
+            tile->has_frame = true;
+            layout_changed = true;
+        }
+
+        bool ok = sc_texture_set_from_frame(&tile->tex, frame);
+        av_frame_unref(frame);
+        if (!ok) {
+            LOGE("Tile %u: could not update texture", i);
+            continue;
+        }
+
+        ++tile->upload_count;
+    }
+
+    compositor->upload_time += sc_tick_now() - start;
+
+    if (layout_changed) {
+        sc_compositor_update_layout(compositor);
+    }
+}
+
+static void
+sc_compositor_render(struct sc_compositor *compositor) {
+    sc_tick start = sc_tick_now();
+
+    SDL_Renderer *renderer = compositor->renderer;
+    sc_sdl_render_clear(renderer);
+
+    for (unsigned i = 0; i < compositor->count; ++i) {
+        struct sc_compositor_tile *tile = &compositor->tiles[i];
+        if (!is_tile_visible(compositor, i) || !tile->tex.texture) {
+            continue;
+        }
+
+        sc_texture_render(&tile->tex, &tile->rect, compositor->orientation);
+    }
+
+    sc_sdl_render_present(renderer);
+
+    compositor->render_time += sc_tick_now() - start;
+    ++compositor->render_count;
+}
+
+static void
+sc_compositor_refresh(struct sc_compositor *compositor) {
+    if (!compositor->window_visible) {
+        // Nothing to upload or render until the window is visible again
+        return;
+    }
+
+    sc_compositor_update_tiles(compositor);
+    sc_compositor_render(compositor);
+}
+
+static bool
+sc_compositor_frame_sink_open(struct sc_frame_sink *sink,
+                              const AVCodecContext *ctx,
+                              const struct sc_stream_session *session) {
+    assert(ctx->pix_fmt == AV_PIX_FMT_YUV420P);
+    (void) sink;
+    (void) session;
+
+    if (ctx->width <= 0 || ctx->width > 0xFFFF
+            || ctx->height <= 0 || ctx->height > 0xFFFF) {
+        LOGE("Invalid video size: %dx%d", ctx->width, ctx->height);
+        return false;
+    }
+
+    // nothing to do, the compositor is already open on the main thread
+    return true;
+}
+
+static void
+sc_compositor_frame_sink_close(struct sc_frame_sink *sink) {
+    (void) sink;
+
+    // nothing to do, the compositor lifecycle is not managed by the frame
+    // producer
+}
+
+static bool
+sc_compositor_frame_sink_push(struct sc_frame_sink *sink,
+                              const AVFrame *frame) {
+    struct sc_compositor_tile *tile = DOWNCAST(sink);
+    struct sc_compositor *compositor = tile->compositor;
+
+    bool previous_skipped;
+    bool ok = sc_frame_buffer_push(&tile->fb, frame, &previous_skipped);
+    if (!ok) {
+        return false;
+    }
+
+    if (previous_skipped) {
+        // The previous frame has not been consumed yet, the new frame will be
+        // consumed instead
+        return true;
+    }
+
+    atomic_store_explicit(&tile->frame_pending, true, memory_order_release);
+
+    // Post a single event for all the tiles updated in the meantime
+    bool requested = atomic_exchange_explicit(&compositor->update_requested,
+                                              true, memory_order_acq_rel);
+    if (!requested) {
+        ok = sc_push_event_with_data(SC_EVENT_NEW_TILE_FRAME, compositor);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool
+sc_compositor_tile_init(struct sc_compositor_tile *tile,
+                        struct sc_compositor *compositor) {
+    tile->compositor = compositor;
+    tile->has_frame = false;
+    tile->removed = false;
+    tile->upload_count = 0;
+    atomic_init(&tile->frame_pending, false);
+
+    bool ok = sc_frame_buffer_init(&tile->fb);
+    if (!ok) {
+        return false;
+    }
+
+    tile->frame = av_frame_alloc();
+    if (!tile->frame) {
+        LOG_OOM();
+        sc_frame_buffer_destroy(&tile->fb);
+        return false;
+    }
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_compositor_frame_sink_open,
+        .close = sc_compositor_frame_sink_close,
+        .push = sc_compositor_frame_sink_push,
+    };
+
+    tile->frame_sink.ops = &ops;
+
+    return true;
+}
+
+static void
+sc_compositor_tile_destroy(struct sc_compositor_tile *tile) {
+    sc_texture_destroy(&tile->tex);
+    av_frame_free(&tile->frame);
+    sc_frame_buffer_destroy(&tile->fb);
+}
+
+bool
+sc_compositor_init(struct sc_compositor *compositor,
+                   const struct sc_compositor_params *params) {
+    assert(params->tile_count);
+
+    compositor->count = params->tile_count;
+    compositor->orientation = params->orientation;
+    compositor->window_visible = true;
+    compositor->solo = -1;
+    compositor->visible_count = 0;
+    compositor->render_count = 0;
+    compositor->upload_time = 0;
+    compositor->render_time = 0;
+    atomic_init(&compositor->update_requested, false);
+
+    if (compositor->orientation != SC_ORIENTATION_0) {
+        LOGI("Initial display orientation set to %s",
+             sc_orientation_get_name(compositor->orientation));
+    }
+
+    compositor->tiles = calloc(compositor->count, sizeof(*compositor->tiles));
+    if (!compositor->tiles) {
+        LOG_OOM();
+        return false;
+    }
+
+    // Create the window hidden, it is shown once the tiles are initialized
+    uint32_t window_flags = SDL_WINDOW_HIGH_PIXEL_DENSITY
+                          | SDL_WINDOW_RESIZABLE
+                          | SDL_WINDOW_HIDDEN;
+    if (params->always_on_top) {
+        window_flags |= SDL_WINDOW_ALWAYS_ON_TOP;
+    }
+    if (params->window_borderless) {
+        window_flags |= SDL_WINDOW_BORDERLESS;
+    }
+
+    const char *title = params->window_title;
+    assert(title);
+
+    int x = SDL_WINDOWPOS_CENTERED;
+    int y = SDL_WINDOWPOS_CENTERED;
+    int width = SC_COMPOSITOR_DEFAULT_WIDTH;
+    int height = SC_COMPOSITOR_DEFAULT_HEIGHT;
+    if (params->window_x != SC_WINDOW_POSITION_UNDEFINED) {
+        x = params->window_x;
+    }
+    if (params->window_y != SC_WINDOW_POSITION_UNDEFINED) {
+        y = params->window_y;
+    }
+    if (params->window_width) {
+        width = params->window_width;
+    }
+    if (params->window_height) {
+        height = params->window_height;
+    }
+
+    compositor->window =
+        sc_sdl_create_window(title, x, y, width, height, window_flags);
+    if (!compositor->window) {
+        LOGE("Could not create window: %s", SDL_GetError());
+        goto error_free_tiles;
+    }
+
+    compositor->renderer = SDL_CreateRenderer(compositor->window, NULL);
+    if (!compositor->renderer) {
+        LOGE("Could not create renderer: %s", SDL_GetError());
+        goto error_destroy_window;
+    }
+
+#ifdef SC_COMPOSITOR_FORCE_OPENGL_CORE_PROFILE
+    compositor->gl_context = NULL;
+
+    // starts with "opengl"
+    const char *renderer_name = SDL_GetRendererName(compositor->renderer);
+    bool use_opengl = renderer_name && !strncmp(renderer_name, "opengl", 6);
+    if (use_opengl) {
+        // Persuade macOS to give us something better than OpenGL 2.1.
+        // If we create a Core Profile context, we get the best OpenGL version.
+        bool ok = SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
+                                      SDL_GL_CONTEXT_PROFILE_CORE);
+        if (!ok) {
+            LOGW("Could not set a GL Core Profile Context");
+        }
+
+        LOGD("Creating OpenGL Core Profile context");
+        compositor->gl_context = SDL_GL_CreateContext(compositor->window);
+        if (!compositor->gl_context) {
+            LOGE("Could not create OpenGL context: %s", SDL_GetError());
+            goto error_destroy_renderer;
+        }
+    }
+#endif
+
+    // All the tiles share the same renderer, initialize the texture once (to
+    // log the renderer properties once)
+    struct sc_texture tex;
+    // The tiles are copies of this texture, which could not share the
+    // ownership of the downscale filter shaders: use trilinear filtering
+    bool ok = sc_texture_init(&tex, compositor->renderer, params->mipmaps,
+                              SC_DOWNSCALE_FILTER_TRILINEAR);
+    if (!ok) {
+        goto error_destroy_gl_context;
+    }
+
+    unsigned initialized = 0;
+    for (; initialized < compositor->count; ++initialized) {
+        struct sc_compositor_tile *tile = &compositor->tiles[initialized];
+        if (!sc_compositor_tile_init(tile, compositor)) {
+            goto error_destroy_tiles;
+        }
+        // The texture is not created yet, it can be copied
+        assert(!tex.texture);
+        tile->tex = tex;
+    }
+
+    SDL_Surface *icon = sc_icon_load(SC_ICON_FILENAME_SCRCPY);
+    if (icon) {
+        if (!SDL_SetWindowIcon(compositor->window, icon)) {
+            LOGW("Could not set window icon: %s", SDL_GetError());
+        }
+        sc_icon_destroy(icon);
+    } else {
+        // not fatal
+        LOGE("Could not load icon");
+    }
+
+    if (params->fullscreen) {
+        if (!SDL_SetWindowFullscreen(compositor->window, true)) {
+            LOGW("Could not switch to fullscreen: %s", SDL_GetError());
+        }
+    }
+
+    sc_sdl_show_window(compositor->window);
+    sc_compositor_update_layout(compositor);
+    sc_compositor_render(compositor);
+
+    return true;
+
+error_destroy_tiles:
+    for (unsigned i = 0; i < initialized; ++i) {
+        sc_compositor_tile_destroy(&compositor->tiles[i]);
+    }
+error_destroy_gl_context:
+#ifdef SC_COMPOSITOR_FORCE_OPENGL_CORE_PROFILE
+    if (compositor->gl_context) {
+        SDL_GL_DestroyContext(compositor->gl_context);
+    }
+error_destroy_renderer:
+#endif
+    SDL_DestroyRenderer(compositor->renderer);
+error_destroy_window:
+    SDL_DestroyWindow(compositor->window);
+error_free_tiles:
+    free(compositor->tiles);
+
+    return false;
+}
+
+void
+sc_compositor_destroy(struct sc_compositor *compositor) {
+    for (unsigned i = 0; i < compositor->count; ++i) {
+        sc_compositor_tile_destroy(&compositor->tiles[i]);
+    }
+#ifdef SC_COMPOSITOR_FORCE_OPENGL_CORE_PROFILE
+    SDL_GL_DestroyContext(compositor->gl_context);
+#endif
+    SDL_DestroyRenderer(compositor->renderer);
+    SDL_DestroyWindow(compositor->window);
+    free(compositor->tiles);
+}
+
+void
+sc_compositor_remove_tile(struct sc_compositor *compositor, unsigned index) {
+    assert(index < compositor->count);
+
+    struct sc_compositor_tile *tile = &compositor->tiles[index];
+    if (tile->removed) {
+        return;
+    }
+
+    tile->removed = true;
+    if (compositor->solo == (int) index) {
+        compositor->solo = -1;
+    }
+
+    sc_compositor_update_layout(compositor);
+    sc_compositor_refresh(compositor);
+}
+
+static void
+sc_compositor_toggle_solo(struct sc_compositor *compositor, float x, float y) {
+    if (compositor->solo != -1) {
+        // Restore the grid
+        compositor->solo = -1;
+    } else {
+        if (!compositor->visible_count) {
+            return;
+        }
+
+        // Events are expressed in window coordinates, but the layout is
+        // expressed in drawable coordinates
+        struct sc_size window_size =
+            sc_sdl_get_window_size(compositor->window);
+        struct sc_size render_size =
+            sc_sdl_get_render_output_size(compositor->renderer);
+        if (!window_size.width || !window_size.height) {
+            return;
+        }
+        x = x * render_size.width / window_size.width;
+        y = y * render_size.height / window_size.height;
+
+        int layout_index =
+            sc_tile_grid_get_index_at(compositor->grid, render_size,
+                                      compositor->visible_count, x, y);
+        if (layout_index == -1) {
+            return;
+        }
+
+        // Find the tile at this position in the layout
+        for (unsigned i = 0; i < compositor->count; ++i) {
+            if (is_tile_visible(compositor, i) && !layout_index--) {
+                compositor->solo = i;
+                break;
+            }
+        }
+    }
+
+    sc_compositor_update_layout(compositor);
+    sc_compositor_refresh(compositor);
+}
+
+void
+sc_compositor_handle_event(struct sc_compositor *compositor,
+                           const SDL_Event *event) {
+    switch (event->type) {
+        case SC_EVENT_NEW_TILE_FRAME:
+            // Reset before consuming the frames, so that a frame pushed in
+            // the meantime posts a new event
+            atomic_store_explicit(&compositor->update_requested, false,
+                                  memory_order_release);
+            sc_compositor_refresh(compositor);
+            break;
+        case SDL_EVENT_WINDOW_MINIMIZED:
+        case SDL_EVENT_WINDOW_HIDDEN:
+        case SDL_EVENT_WINDOW_OCCLUDED:
+            LOGD("Video wall hidden, tile updates paused");
+            compositor->window_visible = false;
+            break;
+        case SDL_EVENT_WINDOW_RESTORED:
+        case SDL_EVENT_WINDOW_SHOWN:
+        case SDL_EVENT_WINDOW_EXPOSED:
+            compositor->window_visible = true;
+            sc_compositor_update_layout(compositor);
+            sc_compositor_refresh(compositor);
+            break;
+        case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+            sc_compositor_update_layout(compositor);
+            sc_compositor_refresh(compositor);
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+            if (event->button.button == SDL_BUTTON_LEFT
+                    && event->button.clicks == 2) {
+                sc_compositor_toggle_solo(compositor, event->button.x,
+                                          event->button.y);
+            }
+            break;
+    }
+}
+
+void
+sc_compositor_log_stats(struct sc_compositor *compositor) {
+    if (!compositor->render_count) {
+        return;
+    }
+
+    uint64_t upload_count = 0;
+    for (unsigned i = 0; i < compositor->count; ++i) {
+        upload_count += compositor->tiles[i].upload_count;
+    }
+
+    LOGI("Video wall: %" PRIu64 " frames uploaded in %" PRItick " ms, %"
+         PRIu64 " renderings in %" PRItick " ms (%" PRItick " us/rendering)",
+         upload_count, SC_TICK_TO_MS(compositor->upload_time),
+         compositor->render_count, SC_TICK_TO_MS(compositor->render_time),
+         SC_TICK_TO_US(compositor->render_time) /
+            (sc_tick) compositor->render_count);
+}
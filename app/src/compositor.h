@@ -0,0 +1,139 @@
+#ifndef SC_COMPOSITOR_H
+#define SC_COMPOSITOR_H
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL3/SDL.h>
+#include <libavutil/frame.h>
+
+#include "coords.h"
+#include "frame_buffer.h"
+#include "options.h"
+#include "texture.h"
+#include "tile_layout.h"
+#include "trait/frame_sink.h"
+#include "util/tick.h"
+
+#ifdef __APPLE__
+# define SC_COMPOSITOR_FORCE_OPENGL_CORE_PROFILE
+#endif
+
+struct sc_compositor;
+
+struct sc_compositor_tile {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    struct sc_compositor *compositor;
+
+    struct sc_frame_buffer fb;
+    // Set by the producer when a new frame is pushed to the frame buffer,
+    // reset by the main thread when it is consumed
+    atomic_bool frame_pending;
+
+    struct sc_texture tex;
+    AVFrame *frame;
+    bool has_frame;
+
+    struct sc_size frame_size;
+    struct sc_size content_size; // rotated frame_size
+
+    // A removed tile is not part of the layout anymore (e.g. the device is
+    // disconnected)
+    bool removed;
+    // Content rectangle, only valid if the tile is visible (not removed, and
+    // no other tile is displayed alone)
+    SDL_FRect rect;
+
+    uint64_t upload_count;
+};
+
+/**
+ * Render several video streams, in tiles, in a single window
+ *
+ * Each tile is a frame sink. A new frame is uploaded to its texture only when
+ * the tile is visible, and all the tiles updated at the same time are
+ * rendered once.
+ */
+struct sc_compositor {
+    SDL_Window *window;
+    SDL_Renderer *renderer;
+#ifdef SC_COMPOSITOR_FORCE_OPENGL_CORE_PROFILE
+    SDL_GLContext gl_context;
+#endif
+
+    struct sc_compositor_tile *tiles;
+    unsigned count;
+
+    enum sc_orientation orientation;
+
+    // Set when an update event has been posted and not handled yet, to post
+    // at most one event for all the tiles
+    atomic_bool update_requested;
+
+    // false while the window is minimized or occluded
+    bool window_visible;
+
+    // Index of the tile displayed alone (on double-click), or -1
+    int solo;
+
+    struct sc_tile_grid grid;
+    unsigned visible_count;
+
+    // For the resource accounting
+    uint64_t render_count;
+    sc_tick upload_time;
+    sc_tick render_time;
+};
+
+struct sc_compositor_params {
+    const char *window_title;
+    unsigned tile_count;
+
+    bool always_on_top;
+
+    int16_t window_x; // accepts SC_WINDOW_POSITION_UNDEFINED
+    int16_t window_y; // accepts SC_WINDOW_POSITION_UNDEFINED
+    uint16_t window_width;
+    uint16_t window_height;
+
+    bool window_borderless;
+
+    enum sc_orientation orientation;
+    bool mipmaps;
+
+    bool fullscreen;
+};
+
+// create the window, the renderer and the tiles
+bool
+sc_compositor_init(struct sc_compositor *compositor,
+                   const struct sc_compositor_params *params);
+
+void
+sc_compositor_destroy(struct sc_compositor *compositor);
+
+static inline struct sc_frame_sink *
+sc_compositor_get_frame_sink(struct sc_compositor *compositor,
+                             unsigned index) {
+    assert(index < compositor->count);
+    return &compositor->tiles[index].frame_sink;
+}
+
+// Remove a tile from the layout (e.g. on device disconnection)
+void
+sc_compositor_remove_tile(struct sc_compositor *compositor, unsigned index);
+
+// react to SDL events
+void
+sc_compositor_handle_event(struct sc_compositor *compositor,
+                           const SDL_Event *event);
+
+// log the resource accounting
+void
+sc_compositor_log_stats(struct sc_compositor *compositor);
+
+#endif
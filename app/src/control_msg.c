@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "util/acksync.h"
 #include "util/binary.h"
 #include "util/log.h"
 #include "util/str.h"
@@ -44,6 +45,13 @@ static const char *const android_motionevent_action_labels[] = {
     "btn-release",
 };
 
+// Compact touch event header: the action in the low 4 bits, and flags
+#define COMPACT_ACTION_MASK 0x0f
+#define COMPACT_FLAG_NEW_POINTER 0x10 // the pointer id follows the slot
+#define COMPACT_FLAG_SCREEN_SIZE 0x20
+#define COMPACT_FLAG_PRESSURE 0x40
+#define COMPACT_FLAG_BUTTONS 0x80
+
 static const char *const copy_key_labels[] = {
     "none",
     "copy",
@@ -185,6 +193,9 @@ sc_control_msg_serialize(const struct sc_control_msg *msg, uint8_t *buf) {
         case SC_CONTROL_MSG_TYPE_CAMERA_SET_TORCH:
             buf[1] = msg->camera_set_torch.on ? 1 : 0;
             return 2;
+        case SC_CONTROL_MSG_TYPE_LATENCY_PROBE:
+            sc_write64be(&buf[1], msg->latency_probe.sequence);
+            return 9;
         case SC_CONTROL_MSG_TYPE_EXPAND_NOTIFICATION_PANEL:
         case SC_CONTROL_MSG_TYPE_EXPAND_SETTINGS_PANEL:
         case SC_CONTROL_MSG_TYPE_COLLAPSE_PANELS:
@@ -201,6 +212,147 @@ sc_control_msg_serialize(const struct sc_control_msg *msg, uint8_t *buf) {
     }
 }
 
+void
+sc_control_msg_encoder_init(struct sc_control_msg_encoder *encoder) {
+    encoder->pointer_count = 0;
+    encoder->next_slot = 0;
+}
+
+// Return the slot index of the pointer, or assign a new one (in that case,
+// the state is reset to zero)
+static unsigned
+get_pointer_slot(struct sc_control_msg_encoder *encoder, uint64_t pointer_id,
+                 bool *new_pointer) {
+    for (unsigned i = 0; i < encoder->pointer_count; ++i) {
+        if (encoder->pointers[i].pointer_id == pointer_id) {
+            *new_pointer = false;
+            return i;
+        }
+    }
+
+    unsigned slot;
+    if (encoder->pointer_count < SC_CONTROL_MSG_COMPACT_POINTERS) {
+        slot = encoder->pointer_count++;
+    } else {
+        // Reuse the slots in turn
+        slot = encoder->next_slot;
+        encoder->next_slot =
+            (encoder->next_slot + 1) % SC_CONTROL_MSG_COMPACT_POINTERS;
+    }
+
+    struct sc_control_msg_pointer_state *state = &encoder->pointers[slot];
+    memset(state, 0, sizeof(*state));
+    state->pointer_id = pointer_id;
+
+    *new_pointer = true;
+    return slot;
+}
+
+// Format:
+//  - type (1 byte)
+//  - action and flags (1 byte)
+//  - pointer slot (1 byte)
+//  - pointer id (zigzag varint), only if COMPACT_FLAG_NEW_POINTER
+//  - x and y deltas (2 zigzag varints)
+//  - screen width and height (2 varints), only if COMPACT_FLAG_SCREEN_SIZE
+//  - pressure (2 bytes), only if COMPACT_FLAG_PRESSURE
+//  - action button and buttons (2 varints), only if COMPACT_FLAG_BUTTONS
+static size_t
+serialize_touch_event_compact(const struct sc_control_msg *msg,
+                              struct sc_control_msg_encoder *encoder,
+                              uint8_t *buf) {
+    assert(msg->type == SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+
+    const struct sc_position *position = &msg->inject_touch_event.position;
+    uint16_t pressure = sc_float_to_u16fp(msg->inject_touch_event.pressure);
+
+    bool new_pointer;
+    unsigned slot = get_pointer_slot(encoder,
+                                     msg->inject_touch_event.pointer_id,
+                                     &new_pointer);
+    struct sc_control_msg_pointer_state *state = &encoder->pointers[slot];
+
+    uint8_t header = msg->inject_touch_event.action;
+    if (new_pointer) {
+        header |= COMPACT_FLAG_NEW_POINTER;
+    }
+    if (position->screen_size.width != state->screen_width
+            || position->screen_size.height != state->screen_height) {
+        header |= COMPACT_FLAG_SCREEN_SIZE;
+    }
+    if (pressure != state->pressure) {
+        header |= COMPACT_FLAG_PRESSURE;
+    }
+    if (msg->inject_touch_event.action_button != state->action_button
+            || msg->inject_touch_event.buttons != state->buttons) {
+        header |= COMPACT_FLAG_BUTTONS;
+    }
+
+    buf[0] = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT_COMPACT;
+    buf[1] = header;
+    buf[2] = slot;
+    size_t len = 3;
+
+    if (new_pointer) {
+        int64_t pointer_id = (int64_t) msg->inject_touch_event.pointer_id;
+        len += sc_write_varint(&buf[len], sc_zigzag_encode(pointer_id));
+    }
+
+    int64_t dx = (int64_t) position->point.x - state->x;
+    int64_t dy = (int64_t) position->point.y - state->y;
+    len += sc_write_varint(&buf[len], sc_zigzag_encode(dx));
+    len += sc_write_varint(&buf[len], sc_zigzag_encode(dy));
+
+    if (header & COMPACT_FLAG_SCREEN_SIZE) {
+        len += sc_write_varint(&buf[len], position->screen_size.width);
+        len += sc_write_varint(&buf[len], position->screen_size.height);
+    }
+
+    if (header & COMPACT_FLAG_PRESSURE) {
+        sc_write16be(&buf[len], pressure);
+        len += 2;
+    }
+
+    if (header & COMPACT_FLAG_BUTTONS) {
+        len += sc_write_varint(&buf[len],
+                               msg->inject_touch_event.action_button);
+        len += sc_write_varint(&buf[len], msg->inject_touch_event.buttons);
+    }
+
+    state->x = position->point.x;
+    state->y = position->point.y;
+    state->screen_width = position->screen_size.width;
+    state->screen_height = position->screen_size.height;
+    state->pressure = pressure;
+    state->action_button = msg->inject_touch_event.action_button;
+    state->buttons = msg->inject_touch_event.buttons;
+
+    return len;
+}
+
+size_t
+sc_control_msg_serialize_compact(const struct sc_control_msg *msg,
+                                 struct sc_control_msg_encoder *encoder,
+                                 uint8_t *buf) {
+    if (msg->type == SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT
+            && msg->inject_touch_event.action <= COMPACT_ACTION_MASK) {
+        return serialize_touch_event_compact(msg, encoder, buf);
+    }
+
+    return sc_control_msg_serialize(msg, buf);
+}
+
+size_t
+sc_control_msg_serialize_fragment(const uint8_t *data, size_t len, bool last,
+                                  uint8_t *buf) {
+    assert(len <= SC_CONTROL_MSG_FRAGMENT_MAX_PAYLOAD_SIZE);
+    buf[0] = SC_CONTROL_MSG_TYPE_FRAGMENT;
+    buf[1] = last ? 1 : 0;
+    sc_write16be(&buf[2], len);
+    memcpy(&buf[4], data, len);
+    return 4 + len;
+}
+
 void
 sc_control_msg_log(const struct sc_control_msg *msg) {
 #define LOG_CMSG(fmt, ...) LOGV("input: " fmt, ## __VA_ARGS__)
@@ -333,6 +485,10 @@ sc_control_msg_log(const struct sc_control_msg *msg) {
         case SC_CONTROL_MSG_TYPE_CAMERA_ZOOM_OUT:
             LOG_CMSG("camera zoom out");
             break;
+        case SC_CONTROL_MSG_TYPE_LATENCY_PROBE:
+            LOG_CMSG("latency probe sequence=%" PRIu64_,
+                     msg->latency_probe.sequence);
+            break;
         default:
             LOG_CMSG("unknown type: %u", (unsigned) msg->type);
             break;
@@ -349,6 +505,25 @@ sc_control_msg_is_droppable(const struct sc_control_msg *msg) {
         && msg->type != SC_CONTROL_MSG_TYPE_UHID_DESTROY;
 }
 
+bool
+sc_control_msg_is_bulk(const struct sc_control_msg *msg) {
+    switch (msg->type) {
+        case SC_CONTROL_MSG_TYPE_START_APP:
+            return true;
+        case SC_CONTROL_MSG_TYPE_SET_CLIPBOARD:
+            // A SET_CLIPBOARD message with the paste flag makes the device
+            // paste its content: it must not be reordered with respect to the
+            // input events, unless the client waits for the device
+            // acknowledgement (sequence).
+            return !msg->set_clipboard.paste
+                || msg->set_clipboard.sequence != SC_SEQUENCE_INVALID;
+        default:
+            // INJECT_TEXT is small and must not be reordered with respect to
+            // the key events
+            return false;
+    }
+}
+
 void
 sc_control_msg_destroy(struct sc_control_msg *msg) {
     switch (msg->type) {
@@ -18,12 +18,22 @@
 // type: 1 byte; sequence: 8 bytes; paste flag: 1 byte; length: 4 bytes
 #define SC_CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH (SC_CONTROL_MSG_MAX_SIZE - 14)
 
+// Large bulk messages are sent in fragments of at most this payload size, so
+// that interactive messages may be interleaved
+#define SC_CONTROL_MSG_FRAGMENT_MAX_PAYLOAD_SIZE 8192
+// type: 1 byte; last flag: 1 byte; length: 2 bytes
+#define SC_CONTROL_MSG_FRAGMENT_MAX_SIZE \
+    (4 + SC_CONTROL_MSG_FRAGMENT_MAX_PAYLOAD_SIZE)
+
 #define SC_POINTER_ID_MOUSE UINT64_C(-1)
 #define SC_POINTER_ID_GENERIC_FINGER UINT64_C(-2)
 
 // Used for injecting an additional virtual pointer for pinch-to-zoom
 #define SC_POINTER_ID_VIRTUAL_FINGER UINT64_C(-3)
 
+// Number of pointers tracked by the compact encoding of touch events
+#define SC_CONTROL_MSG_COMPACT_POINTERS 16
+
 enum sc_control_msg_type {
     SC_CONTROL_MSG_TYPE_INJECT_KEYCODE,
     SC_CONTROL_MSG_TYPE_INJECT_TEXT,
@@ -46,6 +56,12 @@ enum sc_control_msg_type {
     SC_CONTROL_MSG_TYPE_CAMERA_SET_TORCH,
     SC_CONTROL_MSG_TYPE_CAMERA_ZOOM_IN,
     SC_CONTROL_MSG_TYPE_CAMERA_ZOOM_OUT,
+    // Fragment of a serialized message (not a message by itself)
+    SC_CONTROL_MSG_TYPE_FRAGMENT,
+    SC_CONTROL_MSG_TYPE_LATENCY_PROBE,
+    // INJECT_TOUCH_EVENT encoded relative to the previous event of the same
+    // pointer (only if the compact encoding is enabled)
+    SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT_COMPACT,
 };
 
 enum sc_copy_key {
@@ -117,14 +133,59 @@ struct sc_control_msg {
         struct {
             bool on;
         } camera_set_torch;
+        struct {
+            uint64_t sequence;
+        } latency_probe;
     };
 };
 
+struct sc_control_msg_pointer_state {
+    uint64_t pointer_id;
+    int32_t x;
+    int32_t y;
+    uint16_t screen_width;
+    uint16_t screen_height;
+    uint16_t pressure; // fixed-point
+    uint32_t action_button;
+    uint32_t buttons;
+};
+
+/**
+ * State of the compact encoding of touch events
+ *
+ * A compact touch event only contains the differences with the previous event
+ * of the same pointer. The device tracks the same state, so the messages must
+ * be sent in the order they are serialized.
+ */
+struct sc_control_msg_encoder {
+    struct sc_control_msg_pointer_state pointers[
+        SC_CONTROL_MSG_COMPACT_POINTERS];
+    unsigned pointer_count;
+    unsigned next_slot; // the slot to reuse once all are used
+};
+
+void
+sc_control_msg_encoder_init(struct sc_control_msg_encoder *encoder);
+
 // buf size must be at least CONTROL_MSG_MAX_SIZE
 // return the number of bytes written
 size_t
 sc_control_msg_serialize(const struct sc_control_msg *msg, uint8_t *buf);
 
+// Same as sc_control_msg_serialize(), but encode the touch events in the
+// compact form
+size_t
+sc_control_msg_serialize_compact(const struct sc_control_msg *msg,
+                                 struct sc_control_msg_encoder *encoder,
+                                 uint8_t *buf);
+
+// Write a fragment of a serialized message
+// buf size must be at least SC_CONTROL_MSG_FRAGMENT_MAX_SIZE
+// return the number of bytes written
+size_t
+sc_control_msg_serialize_fragment(const uint8_t *data, size_t len, bool last,
+                                  uint8_t *buf);
+
 void
 sc_control_msg_log(const struct sc_control_msg *msg);
 
@@ -133,6 +194,11 @@ sc_control_msg_log(const struct sc_control_msg *msg);
 bool
 sc_control_msg_is_droppable(const struct sc_control_msg *msg);
 
+// Bulk messages may be large and are not latency-sensitive. They may be
+// delayed (and fragmented) in favor of interactive messages.
+bool
+sc_control_msg_is_bulk(const struct sc_control_msg *msg);
+
 void
 sc_control_msg_destroy(struct sc_control_msg *msg);
 
@@ -1,11 +1,27 @@
 #include "controller.h"
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "util/log.h"
+#include "util/trace.h"
 
 // Drop droppable events above this limit
 #define SC_CONTROL_MSG_QUEUE_LIMIT 60
+#define SC_CONTROL_MSG_BULK_QUEUE_LIMIT 16
+
+// The capacity (a power of 2) leaves room for non-droppable events above the
+// limit (if it is exceeded anyway, they are stored in an overflow)
+#define SC_CONTROL_MSG_QUEUE_CAPACITY 256
+#define SC_CONTROL_MSG_BULK_QUEUE_CAPACITY 64
+
+// Maximum number of messages dequeued at once to be sent in a single write
+#define SC_CONTROL_MSG_BATCH_LIMIT 64
+
+// The serialization buffer must be able to store at least one message of the
+// maximum size; the remaining space is used to batch smaller messages
+#define SC_CONTROL_MSG_BATCH_BUFFER_SIZE (2 * SC_CONTROL_MSG_MAX_SIZE)
 
 static void
 sc_controller_receiver_on_ended(struct sc_receiver *receiver, bool error,
@@ -17,19 +33,106 @@ sc_controller_receiver_on_ended(struct sc_receiver *receiver, bool error,
     controller->cbs->on_ended(controller, error, controller->cbs_userdata);
 }
 
+static bool
+sc_controller_lane_init(struct sc_controller_lane *lane, size_t limit,
+                        size_t capacity) {
+    assert(limit < capacity);
+
+    bool ok = sc_mpsc_queue_init(&lane->queue, capacity,
+                                 sizeof(struct sc_queued_control_msg));
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_mutex_init(&lane->overflow_mutex);
+    if (!ok) {
+        sc_mpsc_queue_destroy(&lane->queue);
+        return false;
+    }
+
+    sc_vecdeque_init(&lane->overflow);
+    atomic_init(&lane->overflow_size, 0);
+    lane->limit = limit;
+    sc_histogram_init(&lane->delays);
+
+    return true;
+}
+
+// Pop the next message, from the queue or else from the overflow (consumer
+// only)
+static bool
+sc_controller_lane_pop(struct sc_controller_lane *lane,
+                       struct sc_queued_control_msg *qmsg) {
+    if (sc_mpsc_queue_pop(&lane->queue, qmsg)) {
+        return true;
+    }
+
+    if (!atomic_load_explicit(&lane->overflow_size, memory_order_acquire)) {
+        return false;
+    }
+
+    // While the overflow is not empty, the messages are not pushed to the
+    // queue, so the overflow messages are after all the messages of the queue
+    sc_mutex_lock(&lane->overflow_mutex);
+    bool popped = !sc_vecdeque_is_empty(&lane->overflow);
+    if (popped) {
+        *qmsg = sc_vecdeque_pop(&lane->overflow);
+        atomic_store_explicit(&lane->overflow_size,
+                              sc_vecdeque_size(&lane->overflow),
+                              memory_order_release);
+    }
+    sc_mutex_unlock(&lane->overflow_mutex);
+
+    return popped;
+}
+
+static bool
+sc_controller_lane_is_empty(struct sc_controller_lane *lane) {
+    return sc_mpsc_queue_is_empty(&lane->queue)
+        && !atomic_load_explicit(&lane->overflow_size, memory_order_acquire);
+}
+
+static void
+sc_controller_lane_destroy(struct sc_controller_lane *lane) {
+    struct sc_queued_control_msg qmsg;
+    while (sc_controller_lane_pop(lane, &qmsg)) {
+        sc_control_msg_destroy(&qmsg.msg);
+    }
+    sc_vecdeque_destroy(&lane->overflow);
+    sc_mutex_destroy(&lane->overflow_mutex);
+    sc_mpsc_queue_destroy(&lane->queue);
+}
+
 bool
 sc_controller_init(struct sc_controller *controller, sc_socket control_socket,
                    const struct sc_controller_callbacks *cbs,
                    void *cbs_userdata) {
-    sc_vecdeque_init(&controller->queue);
-
-    // Add 4 to support 4 non-droppable events without re-allocation
-    bool ok = sc_vecdeque_reserve(&controller->queue,
-                                  SC_CONTROL_MSG_QUEUE_LIMIT + 4);
+    bool ok = sc_controller_lane_init(&controller->interactive,
+                                      SC_CONTROL_MSG_QUEUE_LIMIT,
+                                      SC_CONTROL_MSG_QUEUE_CAPACITY);
     if (!ok) {
         return false;
     }
 
+    ok = sc_controller_lane_init(&controller->bulk,
+                                 SC_CONTROL_MSG_BULK_QUEUE_LIMIT,
+                                 SC_CONTROL_MSG_BULK_QUEUE_CAPACITY);
+    if (!ok) {
+        goto error_destroy_interactive;
+    }
+
+    controller->serialized = malloc(SC_CONTROL_MSG_BATCH_BUFFER_SIZE);
+    if (!controller->serialized) {
+        LOG_OOM();
+        goto error_destroy_bulk;
+    }
+
+    controller->bulk_serialized = malloc(SC_CONTROL_MSG_MAX_SIZE);
+    if (!controller->bulk_serialized) {
+        LOG_OOM();
+        goto error_free_serialized;
+    }
+
     static const struct sc_receiver_callbacks receiver_cbs = {
         .on_ended = sc_controller_receiver_on_ended,
     };
@@ -37,54 +140,66 @@ sc_controller_init(struct sc_controller *controller, sc_socket control_socket,
     ok = sc_receiver_init(&controller->receiver, control_socket, &receiver_cbs,
                           controller);
     if (!ok) {
-        sc_vecdeque_destroy(&controller->queue);
-        return false;
+        goto error_free_bulk_serialized;
     }
 
-    ok = sc_mutex_init(&controller->mutex);
+    ok = sc_notifier_init(&controller->notifier);
     if (!ok) {
-        sc_receiver_destroy(&controller->receiver);
-        sc_vecdeque_destroy(&controller->queue);
-        return false;
-    }
-
-    ok = sc_cond_init(&controller->msg_cond);
-    if (!ok) {
-        sc_receiver_destroy(&controller->receiver);
-        sc_mutex_destroy(&controller->mutex);
-        sc_vecdeque_destroy(&controller->queue);
-        return false;
+        goto error_destroy_receiver;
     }
 
     controller->control_socket = control_socket;
-    controller->stopped = false;
+    atomic_init(&controller->stopped, false);
+    controller->bulk_len = 0;
+    controller->bulk_sent = 0;
+    controller->bulk_push_date = 0;
+    controller->compact = false;
+    sc_control_msg_encoder_init(&controller->encoder);
 
     assert(cbs && cbs->on_ended);
     controller->cbs = cbs;
     controller->cbs_userdata = cbs_userdata;
 
     return true;
+
+error_destroy_receiver:
+    sc_receiver_destroy(&controller->receiver);
+error_free_bulk_serialized:
+    free(controller->bulk_serialized);
+error_free_serialized:
+    free(controller->serialized);
+error_destroy_bulk:
+    sc_controller_lane_destroy(&controller->bulk);
+error_destroy_interactive:
+    sc_controller_lane_destroy(&controller->interactive);
+
+    return false;
 }
 
 void
 sc_controller_configure(struct sc_controller *controller,
                         struct sc_acksync *acksync,
-                        struct sc_uhid_devices *uhid_devices) {
+                        struct sc_uhid_devices *uhid_devices,
+                        struct sc_latency_probe *latency_probe) {
     controller->receiver.acksync = acksync;
     controller->receiver.uhid_devices = uhid_devices;
+    controller->receiver.latency_probe = latency_probe;
+}
+
+void
+sc_controller_enable_compact_encoding(struct sc_controller *controller) {
+    controller->compact = true;
 }
 
 void
 sc_controller_destroy(struct sc_controller *controller) {
-    sc_cond_destroy(&controller->msg_cond);
-    sc_mutex_destroy(&controller->mutex);
+    sc_notifier_destroy(&controller->notifier);
 
-    while (!sc_vecdeque_is_empty(&controller->queue)) {
-        struct sc_control_msg *msg = sc_vecdeque_popref(&controller->queue);
-        assert(msg);
-        sc_control_msg_destroy(msg);
-    }
-    sc_vecdeque_destroy(&controller->queue);
+    sc_controller_lane_destroy(&controller->interactive);
+    sc_controller_lane_destroy(&controller->bulk);
+
+    free(controller->bulk_serialized);
+    free(controller->serialized);
 
     sc_receiver_destroy(&controller->receiver);
 }
@@ -92,83 +207,265 @@ sc_controller_destroy(struct sc_controller *controller) {
 bool
 sc_controller_push_msg(struct sc_controller *controller,
                        const struct sc_control_msg *msg) {
-    if (sc_get_log_level() <= SC_LOG_LEVEL_VERBOSE) {
-        sc_control_msg_log(msg);
-    }
+    struct sc_controller_lane *lane = sc_control_msg_is_bulk(msg)
+                                    ? &controller->bulk
+                                    : &controller->interactive;
 
-    bool pushed = false;
+    struct sc_queued_control_msg qmsg = {
+        .msg = *msg,
+        .push_date = sc_tick_now(),
+    };
 
-    sc_mutex_lock(&controller->mutex);
-    size_t size = sc_vecdeque_size(&controller->queue);
-    if (size < SC_CONTROL_MSG_QUEUE_LIMIT) {
-        bool was_empty = sc_vecdeque_is_empty(&controller->queue);
-        sc_vecdeque_push_noresize(&controller->queue, *msg);
-        pushed = true;
-        if (was_empty) {
-            sc_cond_signal(&controller->msg_cond);
+    // The size is approximate if other threads push concurrently, which is
+    // fine for a drop threshold
+    size_t overflow_size =
+        atomic_load_explicit(&lane->overflow_size, memory_order_acquire);
+    size_t size = sc_mpsc_queue_size(&lane->queue) + overflow_size;
+    if (size >= lane->limit && sc_control_msg_is_droppable(msg)) {
+        // The msg is discarded
+        return false;
+    }
+
+    // Once a message is in the overflow, the next ones must follow it
+    bool pushed = !overflow_size && sc_mpsc_queue_push(&lane->queue, &qmsg);
+    if (!pushed) {
+        // The queue is full (only non-droppable messages may exceed the
+        // limit), or the overflow is not empty
+        sc_mutex_lock(&lane->overflow_mutex);
+        pushed = sc_vecdeque_push(&lane->overflow, qmsg);
+        if (pushed) {
+            atomic_store_explicit(&lane->overflow_size,
+                                  sc_vecdeque_size(&lane->overflow),
+                                  memory_order_release);
         }
-    } else if (!sc_control_msg_is_droppable(msg)) {
-        bool ok = sc_vecdeque_push(&controller->queue, *msg);
-        if (ok) {
-            pushed = true;
-        } else {
+        sc_mutex_unlock(&lane->overflow_mutex);
+
+        if (!pushed) {
             // A non-droppable event must be dropped anyway
             LOG_OOM();
+            return false;
         }
     }
-    // Otherwise, the msg is discarded
 
-    sc_mutex_unlock(&controller->mutex);
+    sc_notifier_notify(&controller->notifier);
+
+    return true;
+}
+
+// The messages are logged from the controller thread, to not slow down the
+// thread pushing them
+static void
+sc_controller_log_msg(const struct sc_control_msg *msg) {
+    if (sc_get_log_level() <= SC_LOG_LEVEL_VERBOSE) {
+        sc_control_msg_log(msg);
+    }
+}
+
+static bool
+flush_msgs(struct sc_controller *controller, size_t len, bool *eos) {
+    ssize_t w = net_send_all(controller->control_socket,
+                             controller->serialized, len);
+    if ((size_t) w != len) {
+        *eos = true;
+        return false;
+    }
+
+    return true;
+}
+
+// Append the next part of the current bulk message (either the whole message
+// if it is small, or its next fragment), and return the new length
+static size_t
+append_bulk_part(struct sc_controller *controller, size_t len) {
+    assert(controller->bulk_len);
+    assert(controller->bulk_sent < controller->bulk_len);
+
+    uint8_t *buf = &controller->serialized[len];
+    size_t remaining = controller->bulk_len - controller->bulk_sent;
+
+    if (controller->bulk_len <= SC_CONTROL_MSG_FRAGMENT_MAX_PAYLOAD_SIZE) {
+        // Small enough to be sent as is
+        memcpy(buf, controller->bulk_serialized, controller->bulk_len);
+        controller->bulk_sent = controller->bulk_len;
+        return len + controller->bulk_len;
+    }
+
+    size_t payload_len = MIN(remaining,
+                             SC_CONTROL_MSG_FRAGMENT_MAX_PAYLOAD_SIZE);
+    bool last = payload_len == remaining;
+    const uint8_t *payload =
+        &controller->bulk_serialized[controller->bulk_sent];
+    size_t r =
+        sc_control_msg_serialize_fragment(payload, payload_len, last, buf);
+    controller->bulk_sent += payload_len;
 
-    return pushed;
+    return len + r;
 }
 
+// Serialize all the messages in order, followed by the next part of the
+// current bulk message (if any), and send them with as few writes as possible
+// (a single one unless the batch contains large messages)
 static bool
-process_msg(struct sc_controller *controller,
-            const struct sc_control_msg *msg, bool *eos) {
-    static uint8_t serialized_msg[SC_CONTROL_MSG_MAX_SIZE];
-    size_t length = sc_control_msg_serialize(msg, serialized_msg);
-    if (!length) {
-        *eos = false;
+process_msgs(struct sc_controller *controller,
+             const struct sc_queued_control_msg *qmsgs, size_t count,
+             bool *eos) {
+    size_t len = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (SC_CONTROL_MSG_BATCH_BUFFER_SIZE - len < SC_CONTROL_MSG_MAX_SIZE) {
+            // Not enough space to serialize the next message
+            if (!flush_msgs(controller, len, eos)) {
+                return false;
+            }
+            len = 0;
+        }
+
+        const struct sc_control_msg *msg = &qmsgs[i].msg;
+        sc_controller_log_msg(msg);
+
+        uint8_t *buf = &controller->serialized[len];
+        size_t r = controller->compact
+                 ? sc_control_msg_serialize_compact(msg, &controller->encoder,
+                                                    buf)
+                 : sc_control_msg_serialize(msg, buf);
+        if (!r) {
+            *eos = false;
+            return false;
+        }
+        len += r;
+    }
+
+    bool bulk_completed = false;
+    if (controller->bulk_len) {
+        // A bulk message part never exceeds the maximum message size
+        if (SC_CONTROL_MSG_BATCH_BUFFER_SIZE - len < SC_CONTROL_MSG_MAX_SIZE) {
+            if (!flush_msgs(controller, len, eos)) {
+                return false;
+            }
+            len = 0;
+        }
+
+        len = append_bulk_part(controller, len);
+        bulk_completed = controller->bulk_sent == controller->bulk_len;
+    }
+
+    assert(len);
+    if (!flush_msgs(controller, len, eos)) {
         return false;
     }
 
-    ssize_t w =
-        net_send_all(controller->control_socket, serialized_msg, length);
-    if ((size_t) w != length) {
-        *eos = true;
+    sc_tick now = sc_tick_now();
+    for (size_t i = 0; i < count; ++i) {
+        sc_histogram_add(&controller->interactive.delays,
+                         now - qmsgs[i].push_date);
+    }
+    if (bulk_completed) {
+        sc_histogram_add(&controller->bulk.delays,
+                         now - controller->bulk_push_date);
+        controller->bulk_len = 0;
+        controller->bulk_sent = 0;
+    }
+
+    return true;
+}
+
+// Serialize a new bulk message to be sent in parts
+static bool
+start_bulk_msg(struct sc_controller *controller,
+               const struct sc_queued_control_msg *qmsg) {
+    assert(!controller->bulk_len);
+
+    sc_controller_log_msg(&qmsg->msg);
+
+    size_t r = sc_control_msg_serialize(&qmsg->msg,
+                                        controller->bulk_serialized);
+    if (!r) {
         return false;
     }
 
+    controller->bulk_len = r;
+    controller->bulk_sent = 0;
+    controller->bulk_push_date = qmsg->push_date;
     return true;
 }
 
+static bool
+is_idle(struct sc_controller *controller) {
+    return sc_controller_lane_is_empty(&controller->interactive)
+        && sc_controller_lane_is_empty(&controller->bulk)
+        && !controller->bulk_len;
+}
+
+static bool
+is_stopped(struct sc_controller *controller) {
+    return atomic_load_explicit(&controller->stopped, memory_order_relaxed);
+}
+
+// Wait until there is something to do, return false if stopped
+static bool
+wait_msgs(struct sc_controller *controller) {
+    while (!is_stopped(controller) && is_idle(controller)) {
+        sc_notifier_prepare_wait(&controller->notifier);
+        // Check again, a producer might have pushed a message meanwhile
+        if (is_stopped(controller) || !is_idle(controller)) {
+            sc_notifier_cancel_wait(&controller->notifier);
+        } else {
+            sc_notifier_wait(&controller->notifier);
+        }
+    }
+
+    return !is_stopped(controller);
+}
+
 static int
 run_controller(void *data) {
     struct sc_controller *controller = data;
 
+    sc_thread_apply_role(SC_THREAD_ROLE_CONTROL); // errors already logged
+
     bool error = false;
 
+    struct sc_queued_control_msg qmsgs[SC_CONTROL_MSG_BATCH_LIMIT];
+
     for (;;) {
-        sc_mutex_lock(&controller->mutex);
-        while (!controller->stopped
-                && sc_vecdeque_is_empty(&controller->queue)) {
-            sc_cond_wait(&controller->msg_cond, &controller->mutex);
-        }
-        if (controller->stopped) {
+        if (!wait_msgs(controller)) {
             // stop immediately, do not process further msgs
-            sc_mutex_unlock(&controller->mutex);
             LOGD("Controller stopped");
             break;
         }
 
-        assert(!sc_vecdeque_is_empty(&controller->queue));
-        struct sc_control_msg msg = sc_vecdeque_pop(&controller->queue);
-        sc_mutex_unlock(&controller->mutex);
+        // Drain all the pending interactive messages (up to the batch limit),
+        // so that bursts of events are sent in a single write
+        struct sc_controller_lane *lane = &controller->interactive;
+        size_t count = 0;
+        while (count < SC_CONTROL_MSG_BATCH_LIMIT
+                && sc_controller_lane_pop(lane, &qmsgs[count])) {
+            ++count;
+        }
+
+        // Start the next bulk message if none is being sent
+        struct sc_queued_control_msg bulk_qmsg;
+        bool has_bulk = !controller->bulk_len
+                     && sc_controller_lane_pop(&controller->bulk, &bulk_qmsg);
+
+        bool ok = true;
+        bool eos = false;
+        if (has_bulk) {
+            ok = start_bulk_msg(controller, &bulk_qmsg);
+            sc_control_msg_destroy(&bulk_qmsg.msg);
+        }
+
+        if (ok) {
+            // At most one part of the bulk message is sent per iteration, so
+            // that it never delays the interactive messages for long
+            sc_tick trace = sc_trace_begin();
+            ok = process_msgs(controller, qmsgs, count, &eos);
+            sc_trace_end("process_msgs", trace);
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            sc_control_msg_destroy(&qmsgs[i].msg);
+        }
 
-        bool eos;
-        bool ok = process_msg(controller, &msg, &eos);
-        sc_control_msg_destroy(&msg);
         if (!ok) {
             if (eos) {
                 LOGD("Controller stopped (socket closed)");
@@ -178,6 +475,11 @@ run_controller(void *data) {
         }
     }
 
+    sc_histogram_log(&controller->interactive.delays, SC_LOG_LEVEL_DEBUG,
+                     "Control msg queue delays (interactive)");
+    sc_histogram_log(&controller->bulk.delays, SC_LOG_LEVEL_DEBUG,
+                     "Control msg queue delays (bulk)");
+
     controller->cbs->on_ended(controller, error, controller->cbs_userdata);
 
     return 0;
@@ -203,12 +505,27 @@ sc_controller_start(struct sc_controller *controller) {
     return true;
 }
 
+bool
+sc_controller_restart(struct sc_controller *controller,
+                      sc_socket control_socket) {
+    // The pending messages are kept, they will be sent to the new connection
+    controller->control_socket = control_socket;
+    atomic_store_explicit(&controller->stopped, false, memory_order_relaxed);
+    // A bulk message partially sent is lost
+    controller->bulk_len = 0;
+    controller->bulk_sent = 0;
+    // The server does not know the previous touch events
+    sc_control_msg_encoder_init(&controller->encoder);
+
+    sc_receiver_reset(&controller->receiver, control_socket);
+
+    return sc_controller_start(controller);
+}
+
 void
 sc_controller_stop(struct sc_controller *controller) {
-    sc_mutex_lock(&controller->mutex);
-    controller->stopped = true;
-    sc_cond_signal(&controller->msg_cond);
-    sc_mutex_unlock(&controller->mutex);
+    atomic_store_explicit(&controller->stopped, true, memory_order_relaxed);
+    sc_notifier_notify(&controller->notifier);
 }
 
 void
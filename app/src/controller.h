@@ -3,26 +3,72 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "control_msg.h"
 #include "receiver.h"
 #include "util/acksync.h"
+#include "util/histogram.h"
+#include "util/mpsc_queue.h"
 #include "util/net.h"
+#include "util/notifier.h"
 #include "util/thread.h"
+#include "util/tick.h"
 #include "util/vecdeque.h"
 
-struct sc_control_msg_queue SC_VECDEQUE(struct sc_control_msg);
+struct sc_queued_control_msg {
+    struct sc_control_msg msg;
+    sc_tick push_date;
+};
+
+struct sc_queued_control_msg_deque SC_VECDEQUE(struct sc_queued_control_msg);
+
+struct sc_controller_lane {
+    // Queue of struct sc_queued_control_msg, pushed from any thread without
+    // locking
+    struct sc_mpsc_queue queue;
+    // Non-droppable messages must never be lost: if the queue is full, they
+    // are stored in this unbounded overflow, consumed once the queue is empty.
+    // The next messages are also stored in the overflow until it is empty, to
+    // preserve the order.
+    sc_mutex overflow_mutex;
+    struct sc_queued_control_msg_deque overflow; // protected by overflow_mutex
+    atomic_size_t overflow_size;
+    size_t limit; // drop droppable messages above this limit
+    struct sc_histogram delays; // from push to write, only accessed by the
+                                // controller thread
+};
 
 struct sc_controller {
     sc_socket control_socket;
     sc_thread thread;
-    sc_mutex mutex;
-    sc_cond msg_cond;
-    bool stopped;
-    struct sc_control_msg_queue queue;
+    // Wake up the controller thread on new message or stop
+    struct sc_notifier notifier;
+    atomic_bool stopped;
+
+    // Messages are sent by priority: latency-sensitive messages (input events)
+    // are always sent before pending bulk messages (clipboard, etc.), which
+    // are sent in fragments interleaved with the interactive messages.
+    struct sc_controller_lane interactive;
+    struct sc_controller_lane bulk;
+
     struct sc_receiver receiver;
 
+    uint8_t *serialized; // buffer to serialize batches of messages
+
+    // Touch events are sent relative to the previous ones (only accessed by
+    // the controller thread)
+    bool compact;
+    struct sc_control_msg_encoder encoder;
+
+    // The bulk message being sent (only accessed by the controller thread)
+    uint8_t *bulk_serialized;
+    size_t bulk_len; // 0 if no bulk message is being sent
+    size_t bulk_sent;
+    sc_tick bulk_push_date;
+
     const struct sc_controller_callbacks *cbs;
     void *cbs_userdata;
 };
@@ -40,7 +86,13 @@ sc_controller_init(struct sc_controller *controller, sc_socket control_socket,
 void
 sc_controller_configure(struct sc_controller *controller,
                         struct sc_acksync *acksync,
-                        struct sc_uhid_devices *uhid_devices);
+                        struct sc_uhid_devices *uhid_devices,
+                        struct sc_latency_probe *latency_probe);
+
+// Must be called before sc_controller_start(), and only if the server has
+// been started with the compact encoding enabled
+void
+sc_controller_enable_compact_encoding(struct sc_controller *controller);
 
 void
 sc_controller_destroy(struct sc_controller *controller);
@@ -48,6 +100,16 @@ sc_controller_destroy(struct sc_controller *controller);
 bool
 sc_controller_start(struct sc_controller *controller);
 
+/**
+ * Restart a controller on a new connection
+ *
+ * Must be called after sc_controller_join(). The pending messages are sent to
+ * the new connection.
+ */
+bool
+sc_controller_restart(struct sc_controller *controller,
+                      sc_socket control_socket);
+
 void
 sc_controller_stop(struct sc_controller *controller);
 
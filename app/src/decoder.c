@@ -5,6 +5,7 @@
 #include <libavutil/avutil.h>
 
 #include "util/log.h"
+#include "util/trace.h"
 
 /** Downcast packet_sink to decoder */
 #define DOWNCAST(SINK) container_of(SINK, struct sc_decoder, packet_sink)
@@ -51,7 +52,11 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         return true;
     }
 
+    sc_tick start = sc_tick_now();
     int ret = avcodec_send_packet(decoder->ctx, packet);
+    sc_tick send_time = sc_tick_now() - start;
+    decoder->decode_time += send_time;
+    sc_trace_add("avcodec_send_packet", start, send_time);
     if (ret < 0 && ret != AVERROR(EAGAIN)) {
         LOGE("Decoder '%s': could not send video packet: %d",
              decoder->name, ret);
@@ -59,7 +64,11 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
     }
 
     for (;;) {
+        start = sc_tick_now();
         ret = avcodec_receive_frame(decoder->ctx, decoder->frame);
+        sc_tick receive_time = sc_tick_now() - start;
+        decoder->decode_time += receive_time;
+        sc_trace_add("avcodec_receive_frame", start, receive_time);
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             break;
         }
@@ -71,6 +80,13 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         }
 
         // a frame was received
+        ++decoder->frame_count;
+        if (decoder->metrics) {
+            // Attribute the time to send the packet to its first frame
+            sc_stream_metrics_add_decoded_frame(decoder->metrics,
+                                                send_time + receive_time);
+            send_time = 0;
+        }
 
         if (decoder->ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
             assert(decoder->frame->width >= 0);
@@ -145,8 +161,12 @@ sc_decoder_packet_sink_push_session(struct sc_packet_sink *sink,
 }
 
 void
-sc_decoder_init(struct sc_decoder *decoder, const char *name) {
+sc_decoder_init(struct sc_decoder *decoder, const char *name,
+                struct sc_stream_metrics *metrics) {
     decoder->name = name; // statically allocated
+    decoder->frame_count = 0;
+    decoder->decode_time = 0;
+    decoder->metrics = metrics;
     sc_frame_source_init(&decoder->frame_source);
 
     static const struct sc_packet_sink_ops ops = {
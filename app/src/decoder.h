@@ -6,8 +6,10 @@
 #include <libavcodec/avcodec.h>
 
 #include "coords.h"
+#include "metrics.h"
 #include "trait/frame_source.h"
 #include "trait/packet_sink.h"
+#include "util/tick.h"
 
 struct sc_decoder {
     struct sc_packet_sink packet_sink; // packet sink trait
@@ -20,10 +22,18 @@ struct sc_decoder {
 
     struct sc_stream_session session; // only initialized for video stream
     struct sc_size frame_size;
+
+    // Number of frames decoded and time spent in the decoder (to be read once
+    // the packet source is stopped)
+    uint64_t frame_count;
+    sc_tick decode_time;
+
+    struct sc_stream_metrics *metrics; // optional
 };
 
 // The name must be statically allocated (e.g. a string literal)
 void
-sc_decoder_init(struct sc_decoder *decoder, const char *name);
+sc_decoder_init(struct sc_decoder *decoder, const char *name,
+                struct sc_stream_metrics *metrics);
 
 #endif
@@ -47,6 +47,8 @@ static int
 run_buffering(void *data) {
     struct sc_delay_buffer *db = data;
 
+    sc_thread_apply_role(SC_THREAD_ROLE_MEDIA); // errors already logged
+
     assert(db->delay > 0);
 
     for (;;) {
@@ -8,6 +8,7 @@
 #include "packet_merger.h"
 #include "util/binary.h"
 #include "util/log.h"
+#include "util/trace.h"
 
 #define SC_PACKET_HEADER_SIZE 12
 
@@ -161,10 +162,214 @@ sc_demuxer_recv_packet(struct sc_demuxer *demuxer, const uint8_t *header,
     return true;
 }
 
+static AVCodecContext *
+sc_demuxer_open_codec(const AVCodec *codec, uint32_t raw_codec_id,
+                      const struct sc_stream_session *session) {
+    AVCodecContext *codec_ctx = avcodec_alloc_context3(codec);
+    if (!codec_ctx) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+
+    if (codec->type == AVMEDIA_TYPE_VIDEO) {
+        assert(session);
+        codec_ctx->width = session->video.width;
+        codec_ctx->height = session->video.height;
+        codec_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    } else {
+        // Hardcoded audio properties
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+        codec_ctx->ch_layout = (AVChannelLayout) AV_CHANNEL_LAYOUT_STEREO;
+#else
+        codec_ctx->channel_layout = AV_CH_LAYOUT_STEREO;
+        codec_ctx->channels = 2;
+#endif
+        codec_ctx->sample_rate = 48000;
+
+        if (raw_codec_id == SC_CODEC_ID_FLAC) {
+            // The sample_fmt is not set by the FLAC decoder
+            codec_ctx->sample_fmt = AV_SAMPLE_FMT_S16;
+        }
+    }
+
+    if (avcodec_open2(codec_ctx, codec, NULL) < 0) {
+        avcodec_free_context(&codec_ctx);
+        return NULL;
+    }
+
+    return codec_ctx;
+}
+
+AVCodecContext *
+sc_demuxer_preopen_video_codec(uint32_t codec_id,
+                               const struct sc_stream_session *session) {
+    enum AVCodecID av_codec_id = sc_demuxer_to_avcodec_id(codec_id);
+    if (av_codec_id == AV_CODEC_ID_NONE) {
+        return NULL;
+    }
+
+    const AVCodec *codec = avcodec_find_decoder(av_codec_id);
+    if (!codec || codec->type != AVMEDIA_TYPE_VIDEO) {
+        return NULL;
+    }
+
+    return sc_demuxer_open_codec(codec, codec_id, session);
+}
+
+// Return the preopened codec context if it matches, or NULL
+static AVCodecContext *
+sc_demuxer_take_preopened_codec(struct sc_demuxer *demuxer,
+                                enum AVCodecID codec_id,
+                                const struct sc_stream_session *session) {
+    AVCodecContext *ctx = demuxer->preopened_ctx;
+    if (!ctx) {
+        return NULL;
+    }
+
+    demuxer->preopened_ctx = NULL;
+
+    if (ctx->codec_id != codec_id || !session
+            || (uint32_t) ctx->width != session->video.width
+            || (uint32_t) ctx->height != session->video.height) {
+        LOGD("Demuxer '%s': preopened codec does not match, discarded",
+             demuxer->name);
+        avcodec_free_context(&ctx);
+        return NULL;
+    }
+
+    LOGD("Demuxer '%s': using preopened codec", demuxer->name);
+    return ctx;
+}
+
+static void
+sc_demuxer_set_interrupted(struct sc_demuxer *demuxer, bool interrupted) {
+    sc_mutex_lock(&demuxer->mutex);
+    demuxer->interrupted = interrupted;
+    sc_mutex_unlock(&demuxer->mutex);
+}
+
+// Return the new socket, or SC_SOCKET_NONE if the demuxer is stopped
+static sc_socket
+sc_demuxer_await_socket(struct sc_demuxer *demuxer) {
+    sc_mutex_lock(&demuxer->mutex);
+    demuxer->interrupted = true;
+    sc_mutex_unlock(&demuxer->mutex);
+
+    // The socket is not used anymore, the listener may close it
+    demuxer->cbs->on_interrupted(demuxer, demuxer->cbs_userdata);
+
+    sc_mutex_lock(&demuxer->mutex);
+    while (!demuxer->stopped && demuxer->next_socket == SC_SOCKET_NONE) {
+        sc_cond_wait(&demuxer->resume_cond, &demuxer->mutex);
+    }
+    sc_socket socket = demuxer->next_socket;
+    demuxer->next_socket = SC_SOCKET_NONE;
+    if (demuxer->stopped) {
+        socket = SC_SOCKET_NONE;
+    } else {
+        demuxer->interrupted = false;
+    }
+    sc_mutex_unlock(&demuxer->mutex);
+
+    return socket;
+}
+
+// Wait for a new connection and receive its stream header
+//
+// Return false if the demuxer is stopped or on error.
+static bool
+sc_demuxer_resume_stream(struct sc_demuxer *demuxer, uint32_t raw_codec_id,
+                         struct sc_stream_session *session) {
+    for (;;) {
+        sc_socket socket = sc_demuxer_await_socket(demuxer);
+        if (socket == SC_SOCKET_NONE) {
+            LOGD("Demuxer '%s': stopped while interrupted", demuxer->name);
+            return false;
+        }
+
+        demuxer->socket = socket;
+
+        uint32_t codec_id;
+        if (!sc_demuxer_recv_codec_id(demuxer, &codec_id)) {
+            // Interrupted again
+            continue;
+        }
+
+        if (codec_id != raw_codec_id) {
+            LOGE("Demuxer '%s': the codec changed on resume (0x%08" PRIx32
+                 " instead of 0x%08" PRIx32 ")", demuxer->name, codec_id,
+                 raw_codec_id);
+            return false;
+        }
+
+        if (session) {
+            uint8_t header[SC_PACKET_HEADER_SIZE];
+            if (!sc_demuxer_recv_header(demuxer, header)) {
+                continue;
+            }
+
+            if (!sc_demuxer_is_session(header)) {
+                LOGE("Unexpected packet (not a session header)");
+                return false;
+            }
+
+            struct sc_stream_session new_session;
+            sc_demuxer_parse_session(header, &new_session);
+            if (new_session.video.width != session->video.width
+                    || new_session.video.height != session->video.height) {
+                *session = new_session;
+                demuxer->session = new_session;
+                if (!sc_packet_source_sinks_push_session(
+                        &demuxer->packet_source, session)) {
+                    return false;
+                }
+            }
+        }
+
+        ++demuxer->resume_count;
+        demuxer->pts_offset_pending = true;
+        LOGI("Demuxer '%s': stream resumed", demuxer->name);
+        return true;
+    }
+}
+
+static void
+sc_demuxer_update_pts(struct sc_demuxer *demuxer, AVPacket *packet) {
+    if (packet->pts == AV_NOPTS_VALUE) {
+        // Config packet
+        return;
+    }
+
+    sc_tick now = sc_tick_now();
+
+    if (demuxer->pts_offset_pending) {
+        // Shift the new stream after the last packet of the previous one, by
+        // the duration of the interruption
+        sc_tick last_date = sc_demuxer_get_last_progress_date(demuxer);
+        int64_t gap = MAX(now - last_date, 1);
+        demuxer->pts_offset = demuxer->last_pts + gap - packet->pts;
+        demuxer->pts_offset_pending = false;
+    }
+
+    packet->pts += demuxer->pts_offset;
+    packet->dts = packet->pts;
+
+    if (packet->pts > demuxer->last_pts) {
+        demuxer->last_pts = packet->pts;
+        atomic_store_explicit(&demuxer->last_progress_date, now,
+                              memory_order_relaxed);
+    }
+}
+
 static int
 run_demuxer(void *data) {
     struct sc_demuxer *demuxer = data;
 
+    // The packets are also decoded from this thread (errors already logged)
+    sc_thread_apply_role(SC_THREAD_ROLE_MEDIA);
+
     // Flag to report end-of-stream (i.e. device disconnected)
     enum sc_demuxer_status status = SC_DEMUXER_STATUS_ERROR;
 
@@ -206,14 +411,6 @@ run_demuxer(void *data) {
         goto end;
     }
 
-    AVCodecContext *codec_ctx = avcodec_alloc_context3(codec);
-    if (!codec_ctx) {
-        LOG_OOM();
-        goto end;
-    }
-
-    codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
-
     uint8_t header[SC_PACKET_HEADER_SIZE];
     struct sc_stream_session session_data;
 
@@ -221,40 +418,30 @@ run_demuxer(void *data) {
     if (codec->type == AVMEDIA_TYPE_VIDEO) {
         bool ok = sc_demuxer_recv_header(demuxer, header);
         if (!ok) {
-            goto finally_free_context;
+            goto end;
         }
 
         if (!sc_demuxer_is_session(header)) {
             LOGE("Unexpected packet (not a session header)");
-            goto finally_free_context;
+            goto end;
         }
 
         session = &session_data;
         sc_demuxer_parse_session(header, session);
 
-        codec_ctx->width = session_data.video.width;
-        codec_ctx->height = session_data.video.height;
-        codec_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-
-    } else {
-        // Hardcoded audio properties
-#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
-        codec_ctx->ch_layout = (AVChannelLayout) AV_CHANNEL_LAYOUT_STEREO;
-#else
-        codec_ctx->channel_layout = AV_CH_LAYOUT_STEREO;
-        codec_ctx->channels = 2;
-#endif
-        codec_ctx->sample_rate = 48000;
-
-        if (raw_codec_id == SC_CODEC_ID_FLAC) {
-            // The sample_fmt is not set by the FLAC decoder
-            codec_ctx->sample_fmt = AV_SAMPLE_FMT_S16;
-        }
+        demuxer->codec_id = raw_codec_id;
+        demuxer->session = session_data;
+        demuxer->has_session = true;
     }
 
-    if (avcodec_open2(codec_ctx, codec, NULL) < 0) {
-        LOGE("Demuxer '%s': could not open codec", demuxer->name);
-        goto finally_free_context;
+    AVCodecContext *codec_ctx =
+        sc_demuxer_take_preopened_codec(demuxer, codec_id, session);
+    if (!codec_ctx) {
+        codec_ctx = sc_demuxer_open_codec(codec, raw_codec_id, session);
+        if (!codec_ctx) {
+            LOGE("Demuxer '%s': could not open codec", demuxer->name);
+            goto end;
+        }
     }
 
     if (!sc_packet_source_sinks_open(&demuxer->packet_source, codec_ctx,
@@ -281,14 +468,35 @@ run_demuxer(void *data) {
 
     for (;;) {
         bool ok = sc_demuxer_recv_header(demuxer, header);
+        bool is_session = ok && sc_demuxer_is_session(header);
+        if (ok && !is_session) {
+            sc_tick trace = sc_trace_begin();
+            ok = sc_demuxer_recv_packet(demuxer, header, packet);
+            sc_trace_end("sc_demuxer_recv_packet", trace);
+        }
+
         if (!ok) {
+            if (demuxer->resumable) {
+                if (must_merge_config_packet) {
+                    // Do not merge a config packet from the previous stream
+                    sc_packet_merger_destroy(&merger);
+                    sc_packet_merger_init(&merger);
+                }
+
+                if (sc_demuxer_resume_stream(demuxer, raw_codec_id,
+                                             session)) {
+                    continue;
+                }
+            }
+
             // end of stream
             status = SC_DEMUXER_STATUS_EOS;
             break;
         }
 
-        if (sc_demuxer_is_session(header)) {
+        if (is_session) {
             sc_demuxer_parse_session(header, &session_data);
+            demuxer->session = session_data;
             ok = sc_packet_source_sinks_push_session(&demuxer->packet_source,
                                                      &session_data);
             if (!ok) {
@@ -296,7 +504,9 @@ run_demuxer(void *data) {
                 break;
             }
         } else {
-            sc_demuxer_recv_packet(demuxer, header, packet);
+            sc_demuxer_update_pts(demuxer, packet);
+            ++demuxer->packet_count;
+            demuxer->byte_count += packet->size;
 
             if (must_merge_config_packet) {
                 // Prepend any config packet to the next media packet
@@ -328,6 +538,13 @@ finally_close_sinks:
 finally_free_context:
     avcodec_free_context(&codec_ctx);
 end:
+    // If it has not been used
+    avcodec_free_context(&demuxer->preopened_ctx);
+
+    if (demuxer->resumable) {
+        sc_demuxer_set_interrupted(demuxer, true);
+    }
+
     demuxer->cbs->on_ended(demuxer, status, demuxer->cbs_userdata);
 
     return 0;
@@ -340,6 +557,16 @@ sc_demuxer_init(struct sc_demuxer *demuxer, const char *name, sc_socket socket,
 
     demuxer->name = name; // statically allocated
     demuxer->socket = socket;
+    demuxer->preopened_ctx = NULL;
+    demuxer->has_session = false;
+    demuxer->packet_count = 0;
+    demuxer->byte_count = 0;
+    atomic_init(&demuxer->last_progress_date, sc_tick_now());
+    demuxer->resumable = false;
+    demuxer->resume_count = 0;
+    demuxer->pts_offset = 0;
+    demuxer->last_pts = 0;
+    demuxer->pts_offset_pending = false;
     sc_packet_source_init(&demuxer->packet_source);
 
     assert(cbs && cbs->on_ended);
@@ -356,12 +583,80 @@ sc_demuxer_start(struct sc_demuxer *demuxer) {
                                demuxer);
     if (!ok) {
         LOGE("Demuxer '%s': could not start thread", demuxer->name);
+        avcodec_free_context(&demuxer->preopened_ctx);
         return false;
     }
     return true;
 }
 
+void
+sc_demuxer_set_preopened_codec(struct sc_demuxer *demuxer,
+                               AVCodecContext *ctx) {
+    assert(!demuxer->preopened_ctx);
+    demuxer->preopened_ctx = ctx;
+}
+
+bool
+sc_demuxer_enable_resume(struct sc_demuxer *demuxer) {
+    assert(demuxer->cbs->on_interrupted);
+
+    bool ok = sc_mutex_init(&demuxer->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&demuxer->resume_cond);
+    if (!ok) {
+        sc_mutex_destroy(&demuxer->mutex);
+        return false;
+    }
+
+    demuxer->next_socket = SC_SOCKET_NONE;
+    demuxer->stopped = false;
+    demuxer->interrupted = false;
+    demuxer->resumable = true;
+
+    return true;
+}
+
+void
+sc_demuxer_resume(struct sc_demuxer *demuxer, sc_socket socket) {
+    assert(demuxer->resumable);
+    assert(socket != SC_SOCKET_NONE);
+
+    sc_mutex_lock(&demuxer->mutex);
+    demuxer->next_socket = socket;
+    sc_cond_signal(&demuxer->resume_cond);
+    sc_mutex_unlock(&demuxer->mutex);
+}
+
+bool
+sc_demuxer_is_interrupted(struct sc_demuxer *demuxer) {
+    assert(demuxer->resumable);
+
+    sc_mutex_lock(&demuxer->mutex);
+    bool interrupted = demuxer->interrupted;
+    sc_mutex_unlock(&demuxer->mutex);
+
+    return interrupted;
+}
+
+void
+sc_demuxer_stop(struct sc_demuxer *demuxer) {
+    assert(demuxer->resumable);
+
+    sc_mutex_lock(&demuxer->mutex);
+    demuxer->stopped = true;
+    sc_cond_signal(&demuxer->resume_cond);
+    sc_mutex_unlock(&demuxer->mutex);
+}
+
 void
 sc_demuxer_join(struct sc_demuxer *demuxer) {
     sc_thread_join(&demuxer->thread, NULL);
+
+    if (demuxer->resumable) {
+        sc_cond_destroy(&demuxer->resume_cond);
+        sc_mutex_destroy(&demuxer->mutex);
+    }
 }
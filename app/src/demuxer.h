@@ -3,11 +3,16 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
 
+#include "trait/packet_sink.h"
 #include "trait/packet_source.h"
 #include "util/net.h"
 #include "util/thread.h"
+#include "util/tick.h"
 
 struct sc_demuxer {
     struct sc_packet_source packet_source; // packet source trait
@@ -17,6 +22,42 @@ struct sc_demuxer {
     sc_socket socket;
     sc_thread thread;
 
+    // Codec context opened in advance (may be NULL), owned by the demuxer
+    AVCodecContext *preopened_ctx;
+
+    // The codec and the last session received from the device (to be read
+    // after sc_demuxer_join(), only valid if has_session is set)
+    bool has_session;
+    uint32_t codec_id;
+    struct sc_stream_session session;
+
+    // Number of packets and of bytes received (to be read after
+    // sc_demuxer_join())
+    uint64_t packet_count;
+    uint64_t byte_count;
+
+    // Date of the last packet advancing the PTS, to detect stalls from
+    // another thread
+    atomic_int_least64_t last_progress_date;
+
+    // Only initialized if sc_demuxer_enable_resume() has been called
+    bool resumable;
+    sc_mutex mutex;
+    sc_cond resume_cond;
+    sc_socket next_socket; // set by sc_demuxer_resume()
+    bool stopped;
+    // The socket is not used anymore (the demuxer waits for a new one, or it
+    // has ended)
+    bool interrupted;
+    unsigned resume_count;
+
+    // The device restarts the PTS from 0 on each connection: the PTS of the
+    // packets received after a resumption are shifted to remain monotonic
+    // (only accessed by the demuxer thread)
+    int64_t pts_offset;
+    int64_t last_pts;
+    bool pts_offset_pending;
+
     const struct sc_demuxer_callbacks *cbs;
     void *cbs_userdata;
 };
@@ -30,6 +71,15 @@ enum sc_demuxer_status {
 struct sc_demuxer_callbacks {
     void (*on_ended)(struct sc_demuxer *demuxer, enum sc_demuxer_status,
                      void *userdata);
+
+    /**
+     * Called when the stream is interrupted, if the demuxer is resumable
+     *
+     * The demuxer does not use its socket anymore, it waits for a new one
+     * (see sc_demuxer_resume()). It may be called again if the new connection
+     * is interrupted before the stream is resumed.
+     */
+    void (*on_interrupted)(struct sc_demuxer *demuxer, void *userdata);
 };
 
 // The name must be statically allocated (e.g. a string literal)
@@ -37,6 +87,74 @@ void
 sc_demuxer_init(struct sc_demuxer *demuxer, const char *name, sc_socket socket,
                 const struct sc_demuxer_callbacks *cbs, void *cbs_userdata);
 
+/**
+ * Open a video codec context in advance, for the expected codec id (as sent by
+ * the device) and session (typically those of the last session with the same
+ * device)
+ *
+ * It does not require the demuxer, so it may be called while the server is
+ * starting.
+ *
+ * Return NULL on error.
+ */
+AVCodecContext *
+sc_demuxer_preopen_video_codec(uint32_t codec_id,
+                               const struct sc_stream_session *session);
+
+/**
+ * Give a codec context opened by sc_demuxer_preopen_video_codec()
+ *
+ * The demuxer takes ownership. It is used only if it matches the codec and
+ * the session actually received from the device, otherwise it is discarded.
+ *
+ * Must be called before sc_demuxer_start().
+ */
+void
+sc_demuxer_set_preopened_codec(struct sc_demuxer *demuxer,
+                               AVCodecContext *ctx);
+
+/**
+ * Keep the sinks open on end-of-stream, and wait for a new connection
+ *
+ * Instead of ending, the demuxer calls on_interrupted(), then waits for
+ * sc_demuxer_resume() or sc_demuxer_stop(). The stream from the new
+ * connection must use the same codec; its packets are pushed to the same
+ * sinks (the decoders, the recorder...), as if the stream was not
+ * interrupted.
+ *
+ * Must be called before sc_demuxer_start(). The resources are released by
+ * sc_demuxer_join().
+ */
+bool
+sc_demuxer_enable_resume(struct sc_demuxer *demuxer);
+
+/**
+ * Resume the stream from a new socket (the caller keeps the ownership)
+ */
+void
+sc_demuxer_resume(struct sc_demuxer *demuxer, sc_socket socket);
+
+/**
+ * Indicate whether the socket is not used anymore by a resumable demuxer
+ * (it waits to be resumed, or it has ended)
+ */
+bool
+sc_demuxer_is_interrupted(struct sc_demuxer *demuxer);
+
+/**
+ * Stop a resumable demuxer
+ *
+ * A non-resumable demuxer stops by itself on end-of-stream.
+ */
+void
+sc_demuxer_stop(struct sc_demuxer *demuxer);
+
+static inline sc_tick
+sc_demuxer_get_last_progress_date(struct sc_demuxer *demuxer) {
+    return atomic_load_explicit(&demuxer->last_progress_date,
+                                memory_order_relaxed);
+}
+
 bool
 sc_demuxer_start(struct sc_demuxer *demuxer);
 
@@ -1,5 +1,6 @@
 #include "device_msg.h"
 
+#include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,13 +8,57 @@
 #include "util/binary.h"
 #include "util/log.h"
 
+// The header (type and fixed-size fields) of any message fits in 17 bytes
+#define DEVICE_MSG_HEADER_MAX_SIZE 17
+
+struct sc_split_input {
+    const uint8_t *buf1;
+    size_t len1;
+    const uint8_t *buf2;
+    size_t len2;
+};
+
+// Copy len bytes at offset, which may span both parts
+static void
+copy_from_input(const struct sc_split_input *input, size_t offset,
+                uint8_t *to, size_t len) {
+    assert(offset + len <= input->len1 + input->len2);
+
+    if (offset < input->len1) {
+        size_t n = MIN(len, input->len1 - offset);
+        memcpy(to, &input->buf1[offset], n);
+        to += n;
+        len -= n;
+        offset = 0;
+    } else {
+        offset -= input->len1;
+    }
+
+    if (len) {
+        memcpy(to, &input->buf2[offset], len);
+    }
+}
+
 ssize_t
-sc_device_msg_deserialize(const uint8_t *buf, size_t len,
-                          struct sc_device_msg *msg) {
+sc_device_msg_deserialize_split(const uint8_t *buf1, size_t len1,
+                                const uint8_t *buf2, size_t len2,
+                                struct sc_device_msg *msg) {
+    const struct sc_split_input input = {
+        .buf1 = buf1,
+        .len1 = len1,
+        .buf2 = buf2,
+        .len2 = len2,
+    };
+
+    size_t len = len1 + len2;
     if (!len) {
         return 0; // no message
     }
 
+    // Copy the header so that it can be read contiguously
+    uint8_t buf[DEVICE_MSG_HEADER_MAX_SIZE];
+    copy_from_input(&input, 0, buf, MIN(len, sizeof(buf)));
+
     msg->type = buf[0];
     switch (msg->type) {
         case DEVICE_MSG_TYPE_CLIPBOARD: {
@@ -31,7 +76,7 @@ sc_device_msg_deserialize(const uint8_t *buf, size_t len,
                 return -1;
             }
             if (clipboard_len) {
-                memcpy(text, &buf[5], clipboard_len);
+                copy_from_input(&input, 5, (uint8_t *) text, clipboard_len);
             }
             text[clipboard_len] = '\0';
 
@@ -62,7 +107,7 @@ sc_device_msg_deserialize(const uint8_t *buf, size_t len,
                 return -1;
             }
             if (size) {
-                memcpy(data, &buf[5], size);
+                copy_from_input(&input, 5, data, size);
             }
 
             msg->uhid_output.id = id;
@@ -71,12 +116,26 @@ sc_device_msg_deserialize(const uint8_t *buf, size_t len,
 
             return 5 + size;
         }
+        case DEVICE_MSG_TYPE_LATENCY_PROBE_ACK: {
+            if (len < 17) {
+                return 0; // no complete message
+            }
+            msg->latency_probe_ack.sequence = sc_read64be(&buf[1]);
+            msg->latency_probe_ack.timestamp = sc_read64be(&buf[9]);
+            return 17;
+        }
         default:
             LOGW("Unknown device message type: %d", (int) msg->type);
             return -1; // error, we cannot recover
     }
 }
 
+ssize_t
+sc_device_msg_deserialize(const uint8_t *buf, size_t len,
+                          struct sc_device_msg *msg) {
+    return sc_device_msg_deserialize_split(buf, len, NULL, 0, msg);
+}
+
 void
 sc_device_msg_destroy(struct sc_device_msg *msg) {
     switch (msg->type) {
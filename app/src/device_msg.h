@@ -15,6 +15,7 @@ enum sc_device_msg_type {
     DEVICE_MSG_TYPE_CLIPBOARD,
     DEVICE_MSG_TYPE_ACK_CLIPBOARD,
     DEVICE_MSG_TYPE_UHID_OUTPUT,
+    DEVICE_MSG_TYPE_LATENCY_PROBE_ACK,
 };
 
 struct sc_device_msg {
@@ -31,6 +32,10 @@ struct sc_device_msg {
             uint16_t size;
             uint8_t *data; // owned, to be freed by free()
         } uhid_output;
+        struct {
+            uint64_t sequence;
+            uint64_t timestamp; // in microseconds, device clock (same as PTS)
+        } latency_probe_ack;
     };
 };
 
@@ -39,6 +44,13 @@ ssize_t
 sc_device_msg_deserialize(const uint8_t *buf, size_t len,
                           struct sc_device_msg *msg);
 
+// same as sc_device_msg_deserialize(), but the input is split in two parts
+// (typically the content of a ring buffer wrapping around its end)
+ssize_t
+sc_device_msg_deserialize_split(const uint8_t *buf1, size_t len1,
+                                const uint8_t *buf2, size_t len2,
+                                struct sc_device_msg *msg);
+
 void
 sc_device_msg_destroy(struct sc_device_msg *msg);
 
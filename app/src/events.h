@@ -20,6 +20,10 @@ enum {
     SC_EVENT_AOA_OPEN_ERROR,
     SC_EVENT_DISCONNECTED_ICON_LOADED,
     SC_EVENT_DISCONNECTED_TIMEOUT,
+    SC_EVENT_NEW_TILE_FRAME,
+    SC_EVENT_LINK_INTERRUPTED,
+    SC_EVENT_LINK_STALLED,
+    SC_EVENT_RECONNECT,
 };
 
 bool
@@ -1,23 +1,53 @@
 #include "file_pusher.h"
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "adb/adb.h"
+#include "util/file.h"
 #include "util/log.h"
+#include "util/tick.h"
 
 #define DEFAULT_PUSH_TARGET "/sdcard/Download/"
 
+// Minimal interval between two progress logs of the same file
+#define PROGRESS_LOG_INTERVAL SC_TICK_FROM_SEC(2)
+
+struct sc_file_pusher_progress {
+    const char *file;
+    uint64_t size; // 0 if unknown
+    sc_tick start;
+    sc_tick next_log;
+};
+
 static void
 sc_file_pusher_request_destroy(struct sc_file_pusher_request *req) {
     free(req->file);
 }
 
+static const char *
+get_action_name(enum sc_file_pusher_action action) {
+    return action == SC_FILE_PUSHER_ACTION_INSTALL_APK ? "install" : "push";
+}
+
+static double
+to_mb(uint64_t bytes) {
+    return (double) bytes / 1000000;
+}
+
+static double
+get_throughput(uint64_t bytes, sc_tick duration) {
+    // In MB/s
+    return duration ? to_mb(bytes) * SC_TICK_FREQ / duration : 0;
+}
+
 bool
 sc_file_pusher_init(struct sc_file_pusher *fp, const char *serial,
-                    const char *push_target) {
+                    const char *push_target, unsigned max_workers) {
     assert(serial);
+    assert(max_workers && max_workers <= SC_MAX_PUSH_WORKERS);
 
     sc_vecdeque_init(&fp->queue);
 
@@ -32,24 +62,18 @@ sc_file_pusher_init(struct sc_file_pusher *fp, const char *serial,
         return false;
     }
 
-    ok = sc_intr_init(&fp->intr);
-    if (!ok) {
-        sc_cond_destroy(&fp->event_cond);
-        sc_mutex_destroy(&fp->mutex);
-        return false;
-    }
-
     fp->serial = strdup(serial);
     if (!fp->serial) {
         LOG_OOM();
-        sc_intr_destroy(&fp->intr);
         sc_cond_destroy(&fp->event_cond);
         sc_mutex_destroy(&fp->mutex);
         return false;
     }
 
-    // lazy initialization
-    fp->initialized = false;
+    // The workers are started on demand
+    fp->max_workers = max_workers;
+    fp->worker_count = 0;
+    fp->idle_count = 0;
 
     fp->stopped = false;
 
@@ -58,132 +82,295 @@ sc_file_pusher_init(struct sc_file_pusher *fp, const char *serial,
     return true;
 }
 
+static void
+sc_file_pusher_clear_queue(struct sc_file_pusher *fp) {
+    while (!sc_vecdeque_is_empty(&fp->queue)) {
+        struct sc_file_pusher_request *req = sc_vecdeque_popref(&fp->queue);
+        assert(req);
+        sc_file_pusher_request_destroy(req);
+    }
+}
+
 void
 sc_file_pusher_destroy(struct sc_file_pusher *fp) {
     sc_cond_destroy(&fp->event_cond);
     sc_mutex_destroy(&fp->mutex);
-    sc_intr_destroy(&fp->intr);
     free(fp->serial);
 
-    while (!sc_vecdeque_is_empty(&fp->queue)) {
-        struct sc_file_pusher_request *req = sc_vecdeque_popref(&fp->queue);
-        assert(req);
-        sc_file_pusher_request_destroy(req);
-    }
+    sc_file_pusher_clear_queue(fp);
+    sc_vecdeque_destroy(&fp->queue);
 }
 
-bool
-sc_file_pusher_request(struct sc_file_pusher *fp,
-                       enum sc_file_pusher_action action, char *file) {
-    // start file_pusher if it's used for the first time
-    if (!fp->initialized) {
-        if (!sc_file_pusher_start(fp)) {
-            return false;
+static bool
+sc_file_pusher_is_requested(struct sc_file_pusher *fp,
+                            enum sc_file_pusher_action action,
+                            const char *file) {
+    sc_mutex_assert(&fp->mutex);
+
+    size_t size = sc_vecdeque_size(&fp->queue);
+    for (size_t i = 0; i < size; ++i) {
+        struct sc_file_pusher_request *req =
+            sc_vecdeque_getref(&fp->queue, i);
+        if (req->action == action && !strcmp(req->file, file)) {
+            return true;
         }
-        fp->initialized = true;
     }
 
-    LOGI("Request to %s %s", action == SC_FILE_PUSHER_ACTION_INSTALL_APK
-                                 ? "install" : "push",
-                             file);
-    struct sc_file_pusher_request req = {
-        .action = action,
-        .file = file,
-    };
-
-    sc_mutex_lock(&fp->mutex);
-    bool was_empty = sc_vecdeque_is_empty(&fp->queue);
-    bool res = sc_vecdeque_push(&fp->queue, req);
-    if (!res) {
-        LOG_OOM();
-        sc_mutex_unlock(&fp->mutex);
-        return false;
+    for (unsigned i = 0; i < fp->worker_count; ++i) {
+        struct sc_file_pusher_worker *worker = &fp->workers[i];
+        if (worker->busy && worker->req.action == action
+                && !strcmp(worker->req.file, file)) {
+            return true;
+        }
     }
 
-    if (was_empty) {
-        sc_cond_signal(&fp->event_cond);
+    return false;
+}
+
+static void
+on_push_progress(uint64_t sent, void *userdata) {
+    struct sc_file_pusher_progress *progress = userdata;
+
+    sc_tick now = sc_tick_now();
+    if (now < progress->next_log || !progress->size
+            || sent >= progress->size) {
+        // The completion is logged separately
+        return;
     }
-    sc_mutex_unlock(&fp->mutex);
 
-    return true;
-}
+    progress->next_log = now + PROGRESS_LOG_INTERVAL;
 
-static int
-run_file_pusher(void *data) {
-    struct sc_file_pusher *fp = data;
-    struct sc_intr *intr = &fp->intr;
+    unsigned percent = sent * 100 / progress->size;
+    LOGI("Pushing %s: %u%% (%.1f/%.1f MB, %.1f MB/s)", progress->file,
+         percent, to_mb(sent), to_mb(progress->size),
+         get_throughput(sent, now - progress->start));
+}
 
+static void
+process_request(struct sc_file_pusher *fp, struct sc_intr *intr,
+                const struct sc_file_pusher_request *req) {
     const char *serial = fp->serial;
     assert(serial);
 
     const char *push_target = fp->push_target;
     assert(push_target);
 
+    struct sc_file_pusher_progress progress = {
+        .file = req->file,
+        .size = 0,
+    };
+
+    // The size is unknown for a directory, the throughput is not reported
+    // in that case
+    if (!sc_file_get_size(req->file, &progress.size)) {
+        progress.size = 0;
+    }
+
+    progress.start = sc_tick_now();
+    progress.next_log = progress.start + PROGRESS_LOG_INTERVAL;
+
+    bool ok;
+    if (req->action == SC_FILE_PUSHER_ACTION_INSTALL_APK) {
+        LOGI("Installing %s...", req->file);
+        ok = sc_adb_install(intr, serial, req->file, 0);
+    } else {
+        LOGI("Pushing %s...", req->file);
+        ok = sc_adb_push(intr, serial, req->file, push_target, 0,
+                         on_push_progress, &progress);
+    }
+
+    sc_tick duration = sc_tick_now() - progress.start;
+
+    if (sc_intr_is_interrupted(intr)) {
+        LOGI("Cancelled %s of %s", get_action_name(req->action), req->file);
+        return;
+    }
+
+    if (!ok) {
+        if (req->action == SC_FILE_PUSHER_ACTION_INSTALL_APK) {
+            LOGE("Failed to install %s", req->file);
+        } else {
+            LOGE("Failed to push %s to %s", req->file, push_target);
+        }
+        return;
+    }
+
+    char stats[64];
+    double seconds = (double) duration / SC_TICK_FREQ;
+    if (progress.size) {
+        snprintf(stats, sizeof(stats), "%.1f MB in %.1f s, %.1f MB/s",
+                 to_mb(progress.size), seconds,
+                 get_throughput(progress.size, duration));
+    } else {
+        snprintf(stats, sizeof(stats), "in %.1f s", seconds);
+    }
+
+    if (req->action == SC_FILE_PUSHER_ACTION_INSTALL_APK) {
+        LOGI("%s successfully installed (%s)", req->file, stats);
+    } else {
+        LOGI("%s successfully pushed to %s (%s)", req->file, push_target,
+             stats);
+    }
+}
+
+static int
+run_file_pusher_worker(void *data) {
+    struct sc_file_pusher_worker *worker = data;
+    struct sc_file_pusher *fp = worker->fp;
+
+    // Pushing files is a background task
+    sc_thread_apply_role(SC_THREAD_ROLE_BACKGROUND);
+
     for (;;) {
+        // An interruptor is used for a single request: once interrupted, it
+        // cannot be reused
+        struct sc_intr intr;
+        if (!sc_intr_init(&intr)) {
+            break;
+        }
+
         sc_mutex_lock(&fp->mutex);
+        ++fp->idle_count;
         while (!fp->stopped && sc_vecdeque_is_empty(&fp->queue)) {
             sc_cond_wait(&fp->event_cond, &fp->mutex);
         }
+        --fp->idle_count;
         if (fp->stopped) {
             // stop immediately, do not process further events
             sc_mutex_unlock(&fp->mutex);
+            sc_intr_destroy(&intr);
             break;
         }
 
         assert(!sc_vecdeque_is_empty(&fp->queue));
-        struct sc_file_pusher_request req = sc_vecdeque_pop(&fp->queue);
+        worker->req = sc_vecdeque_pop(&fp->queue);
+        worker->busy = true;
+        worker->intr = &intr;
         sc_mutex_unlock(&fp->mutex);
 
-        if (req.action == SC_FILE_PUSHER_ACTION_INSTALL_APK) {
-            LOGI("Installing %s...", req.file);
-            bool ok = sc_adb_install(intr, serial, req.file, 0);
-            if (ok) {
-                LOGI("%s successfully installed", req.file);
-            } else {
-                LOGE("Failed to install %s", req.file);
-            }
-        } else {
-            LOGI("Pushing %s...", req.file);
-            bool ok = sc_adb_push(intr, serial, req.file, push_target, 0);
-            if (ok) {
-                LOGI("%s successfully pushed to %s", req.file, push_target);
-            } else {
-                LOGE("Failed to push %s to %s", req.file, push_target);
-            }
-        }
+        process_request(fp, &intr, &worker->req);
+
+        sc_mutex_lock(&fp->mutex);
+        worker->intr = NULL;
+        worker->busy = false;
+        sc_mutex_unlock(&fp->mutex);
 
-        sc_file_pusher_request_destroy(&req);
+        sc_file_pusher_request_destroy(&worker->req);
+        sc_intr_destroy(&intr);
     }
+
     return 0;
 }
 
-bool
-sc_file_pusher_start(struct sc_file_pusher *fp) {
-    LOGD("Starting file_pusher thread");
+static bool
+sc_file_pusher_start_worker(struct sc_file_pusher *fp) {
+    assert(fp->worker_count < fp->max_workers);
 
-    bool ok = sc_thread_create(&fp->thread, run_file_pusher, "scrcpy-file", fp);
+    struct sc_file_pusher_worker *worker = &fp->workers[fp->worker_count];
+    worker->fp = fp;
+    worker->busy = false;
+    worker->intr = NULL;
+
+    LOGD("Starting file_pusher worker %u", fp->worker_count);
+
+    bool ok = sc_thread_create(&worker->thread, run_file_pusher_worker,
+                               "scrcpy-file", worker);
     if (!ok) {
         LOGE("Could not start file_pusher thread");
         return false;
     }
 
+    ++fp->worker_count;
     return true;
 }
 
-void
-sc_file_pusher_stop(struct sc_file_pusher *fp) {
-    if (fp->initialized) {
-        sc_mutex_lock(&fp->mutex);
-        fp->stopped = true;
-        sc_cond_signal(&fp->event_cond);
-        sc_intr_interrupt(&fp->intr);
+bool
+sc_file_pusher_request(struct sc_file_pusher *fp,
+                       enum sc_file_pusher_action action, char *file) {
+    sc_mutex_lock(&fp->mutex);
+    bool requested = sc_file_pusher_is_requested(fp, action, file);
+    // Start a new worker if all of them will be busy
+    bool need_worker = !requested
+                    && fp->idle_count <= sc_vecdeque_size(&fp->queue);
+    sc_mutex_unlock(&fp->mutex);
+
+    if (requested) {
+        LOGI("Request to %s %s ignored (already pending)",
+             get_action_name(action), file);
+        free(file);
+        return true;
+    }
+
+    if (need_worker && fp->worker_count < fp->max_workers) {
+        // Only the main thread starts workers, so worker_count is not
+        // accessed concurrently
+        if (!sc_file_pusher_start_worker(fp) && !fp->worker_count) {
+            return false;
+        }
+    }
+
+    LOGI("Request to %s %s", get_action_name(action), file);
+    struct sc_file_pusher_request req = {
+        .action = action,
+        .file = file,
+    };
+
+    sc_mutex_lock(&fp->mutex);
+    bool res = sc_vecdeque_push(&fp->queue, req);
+    if (!res) {
+        LOG_OOM();
         sc_mutex_unlock(&fp->mutex);
+        return false;
     }
+
+    sc_cond_signal(&fp->event_cond);
+    sc_mutex_unlock(&fp->mutex);
+
+    return true;
+}
+
+static unsigned
+sc_file_pusher_interrupt_workers(struct sc_file_pusher *fp) {
+    sc_mutex_assert(&fp->mutex);
+
+    unsigned count = 0;
+    for (unsigned i = 0; i < fp->worker_count; ++i) {
+        struct sc_file_pusher_worker *worker = &fp->workers[i];
+        if (worker->intr) {
+            sc_intr_interrupt(worker->intr);
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+void
+sc_file_pusher_cancel(struct sc_file_pusher *fp) {
+    sc_mutex_lock(&fp->mutex);
+    size_t pending = sc_vecdeque_size(&fp->queue);
+    sc_file_pusher_clear_queue(fp);
+    unsigned in_progress = sc_file_pusher_interrupt_workers(fp);
+    sc_mutex_unlock(&fp->mutex);
+
+    if (pending || in_progress) {
+        LOGI("Cancelling %u file request(s) in progress, %" SC_PRIsizet
+             " pending", in_progress, pending);
+    }
+}
+
+void
+sc_file_pusher_stop(struct sc_file_pusher *fp) {
+    sc_mutex_lock(&fp->mutex);
+    fp->stopped = true;
+    sc_cond_broadcast(&fp->event_cond);
+    sc_file_pusher_interrupt_workers(fp);
+    sc_mutex_unlock(&fp->mutex);
 }
 
 void
 sc_file_pusher_join(struct sc_file_pusher *fp) {
-    if (fp->initialized) {
-        sc_thread_join(&fp->thread, NULL);
+    for (unsigned i = 0; i < fp->worker_count; ++i) {
+        sc_thread_join(&fp->workers[i].thread, NULL);
     }
 }
@@ -5,6 +5,7 @@
 
 #include <stdbool.h>
 
+#include "options.h"
 #include "util/intr.h"
 #include "util/thread.h"
 #include "util/vecdeque.h"
@@ -21,29 +22,47 @@ struct sc_file_pusher_request {
 
 struct sc_file_pusher_request_queue SC_VECDEQUE(struct sc_file_pusher_request);
 
+struct sc_file_pusher_worker {
+    struct sc_file_pusher *fp;
+    sc_thread thread;
+
+    // The request in progress, if any (to detect duplicates)
+    bool busy;
+    struct sc_file_pusher_request req;
+
+    // Interruptor of the request in progress, to cancel it (NULL if idle)
+    struct sc_intr *intr;
+};
+
+/**
+ * Push files and install APKs (dropped onto the window) in the background
+ *
+ * The requests are processed concurrently by a pool of worker threads,
+ * started on demand.
+ */
 struct sc_file_pusher {
     char *serial;
     const char *push_target;
-    sc_thread thread;
     sc_mutex mutex;
     sc_cond event_cond;
     bool stopped;
-    bool initialized;
     struct sc_file_pusher_request_queue queue;
 
-    struct sc_intr intr;
+    unsigned max_workers;
+    // Only accessed from the main thread
+    unsigned worker_count;
+    // Number of workers waiting for a request
+    unsigned idle_count;
+    struct sc_file_pusher_worker workers[SC_MAX_PUSH_WORKERS];
 };
 
 bool
 sc_file_pusher_init(struct sc_file_pusher *fp, const char *serial,
-                    const char *push_target);
+                    const char *push_target, unsigned max_workers);
 
 void
 sc_file_pusher_destroy(struct sc_file_pusher *fp);
 
-bool
-sc_file_pusher_start(struct sc_file_pusher *fp);
-
 void
 sc_file_pusher_stop(struct sc_file_pusher *fp);
 
@@ -51,8 +70,14 @@ void
 sc_file_pusher_join(struct sc_file_pusher *fp);
 
 // take ownership of file, and will free() it
+//
+// A request identical to a pending one (or to one in progress) is ignored.
 bool
 sc_file_pusher_request(struct sc_file_pusher *fp,
                        enum sc_file_pusher_action action, char *file);
 
+// drop the pending requests and interrupt the ones in progress
+void
+sc_file_pusher_cancel(struct sc_file_pusher *fp);
+
 #endif
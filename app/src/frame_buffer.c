@@ -3,6 +3,7 @@
 #include <assert.h>
 
 #include "util/log.h"
+#include "util/trace.h"
 
 bool
 sc_frame_buffer_init(struct sc_frame_buffer *fb) {
@@ -49,6 +50,8 @@ swap_frames(AVFrame **lhs, AVFrame **rhs) {
 bool
 sc_frame_buffer_push(struct sc_frame_buffer *fb, const AVFrame *frame,
                      bool *previous_frame_skipped) {
+    sc_tick trace = sc_trace_begin();
+
     // Use a temporary frame to preserve pending_frame in case of error.
     // tmp_frame is an empty frame, no need to call av_frame_unref() beforehand.
     int r = av_frame_ref(fb->tmp_frame, frame);
@@ -68,13 +71,16 @@ sc_frame_buffer_push(struct sc_frame_buffer *fb, const AVFrame *frame,
         *previous_frame_skipped = !fb->pending_frame_consumed;
     }
     fb->pending_frame_consumed = false;
+    fb->pending_frame_date = sc_tick_now();
 
     sc_mutex_unlock(&fb->mutex);
 
+    sc_trace_end("sc_frame_buffer_push", trace);
+
     return true;
 }
 
-void
+sc_tick
 sc_frame_buffer_consume(struct sc_frame_buffer *fb, AVFrame *dst) {
     sc_mutex_lock(&fb->mutex);
     assert(!fb->pending_frame_consumed);
@@ -84,5 +90,9 @@ sc_frame_buffer_consume(struct sc_frame_buffer *fb, AVFrame *dst) {
     // av_frame_move_ref() resets its source frame, so no need to call
     // av_frame_unref()
 
+    sc_tick date = fb->pending_frame_date;
+
     sc_mutex_unlock(&fb->mutex);
+
+    return date;
 }
@@ -7,6 +7,7 @@
 #include <libavutil/frame.h>
 
 #include "util/thread.h"
+#include "util/tick.h"
 
 // forward declarations
 typedef struct AVFrame AVFrame;
@@ -23,6 +24,7 @@ typedef struct AVFrame AVFrame;
 struct sc_frame_buffer {
     AVFrame *pending_frame;
     AVFrame *tmp_frame; // To preserve the pending frame on error
+    sc_tick pending_frame_date; // date of the push of the pending frame
 
     sc_mutex mutex;
 
@@ -39,7 +41,8 @@ bool
 sc_frame_buffer_push(struct sc_frame_buffer *fb, const AVFrame *frame,
                      bool *skipped);
 
-void
+// Return the date at which the frame was pushed
+sc_tick
 sc_frame_buffer_consume(struct sc_frame_buffer *fb, AVFrame *dst);
 
 #endif
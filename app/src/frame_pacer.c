@@ -0,0 +1,431 @@
+#include "frame_pacer.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <libavcodec/avcodec.h>
+
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_frame_pacer */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_frame_pacer, frame_sink)
+
+// Weight of a new sample in the jitter moving average (1/N)
+#define SC_FRAME_PACER_JITTER_RANGE 16
+// The delay absorbs the frames up to N times the average deviation late
+#define SC_FRAME_PACER_JITTER_FACTOR 2
+
+static bool
+sc_paced_packet_init_frame(struct sc_paced_packet *ppacket,
+                           const AVFrame *frame) {
+    ppacket->type = SC_PACED_PACKET_TYPE_FRAME;
+    ppacket->frame = av_frame_alloc();
+    if (!ppacket->frame) {
+        LOG_OOM();
+        return false;
+    }
+
+    if (av_frame_ref(ppacket->frame, frame)) {
+        LOG_OOM();
+        av_frame_free(&ppacket->frame);
+        return false;
+    }
+
+    return true;
+}
+
+static void
+sc_paced_packet_init_session(struct sc_paced_packet *ppacket,
+                             const struct sc_stream_session *session) {
+    ppacket->type = SC_PACED_PACKET_TYPE_SESSION;
+    ppacket->session = *session;
+}
+
+static void
+sc_paced_packet_destroy(struct sc_paced_packet *ppacket) {
+    if (ppacket->type == SC_PACED_PACKET_TYPE_FRAME) {
+        av_frame_unref(ppacket->frame);
+        av_frame_free(&ppacket->frame);
+    }
+}
+
+sc_tick
+sc_frame_pacer_next_vsync(sc_tick date, sc_tick vsync_date,
+                          sc_tick refresh_interval) {
+    if (!vsync_date || !refresh_interval) {
+        return date;
+    }
+
+    // The division truncates towards 0, so it already rounds up if date is
+    // before vsync_date
+    sc_tick delta = date - vsync_date;
+    sc_tick n = delta / refresh_interval;
+    if (n * refresh_interval < delta) {
+        ++n;
+    }
+
+    return vsync_date + n * refresh_interval;
+}
+
+sc_tick
+sc_frame_pacer_select_vsync(sc_tick target, sc_tick vsync_date,
+                            sc_tick refresh_interval, sc_tick last_vsync,
+                            sc_tick pts_interval) {
+    sc_tick vsync =
+        sc_frame_pacer_next_vsync(target, vsync_date, refresh_interval);
+    if (!refresh_interval || last_vsync == SC_TICK_NONE
+            || pts_interval < 0) {
+        return vsync;
+    }
+
+    // Keep the cadence of the previous frames (the number of refresh
+    // intervals closest to the PTS interval), unless it drifted too far from
+    // the target: not more than half a refresh interval earlier (the frame
+    // might not be received yet), not more than one vsync later (to keep the
+    // latency bounded)
+    sc_tick n = (pts_interval + refresh_interval / 2) / refresh_interval;
+    sc_tick cadence_vsync = last_vsync + n * refresh_interval;
+    if (cadence_vsync >= target - refresh_interval / 2
+            && cadence_vsync <= vsync + refresh_interval) {
+        return cadence_vsync;
+    }
+
+    return vsync;
+}
+
+// Return the vsync on which the frame must be presented
+static sc_tick
+sc_frame_pacer_get_vsync(struct sc_frame_pacer *fp, sc_tick pts,
+                         sc_tick max_deadline) {
+    sc_tick target = sc_clock_to_system_time(&fp->clock, pts) + fp->delay;
+    if (target > max_deadline) {
+        target = max_deadline;
+    }
+
+    sc_tick vsync_date = atomic_load_explicit(&fp->last_present_date,
+                                              memory_order_relaxed);
+    sc_tick refresh_interval = atomic_load_explicit(&fp->refresh_interval,
+                                                    memory_order_relaxed);
+    // The frame is released half a refresh interval before the vsync
+    target += refresh_interval / 2;
+
+    sc_tick pts_interval = fp->last_pts != SC_TICK_NONE ? pts - fp->last_pts
+                                                        : -1;
+    return sc_frame_pacer_select_vsync(target, vsync_date, refresh_interval,
+                                       fp->last_vsync, pts_interval);
+}
+
+static int
+run_pacing(void *data) {
+    struct sc_frame_pacer *fp = data;
+
+    sc_thread_apply_role(SC_THREAD_ROLE_MEDIA); // errors already logged
+
+    for (;;) {
+        sc_mutex_lock(&fp->mutex);
+
+        while (!fp->stopped && sc_vecdeque_is_empty(&fp->queue)) {
+            sc_cond_wait(&fp->queue_cond, &fp->mutex);
+        }
+
+        if (fp->stopped) {
+            sc_mutex_unlock(&fp->mutex);
+            goto stopped;
+        }
+
+        struct sc_paced_packet ppacket = sc_vecdeque_pop(&fp->queue);
+
+        bool ok;
+        if (ppacket.type == SC_PACED_PACKET_TYPE_FRAME) {
+            sc_tick max_deadline = ppacket.push_date + fp->max_delay;
+            // PTS (written by the server) are expressed in microseconds
+            sc_tick pts = SC_TICK_FROM_US(ppacket.frame->pts);
+
+            // The deadline is recomputed on every clock update
+            sc_tick vsync = SC_TICK_NONE;
+            bool timed_out = false;
+            while (!fp->stopped && !timed_out) {
+                vsync = sc_frame_pacer_get_vsync(fp, pts, max_deadline);
+                // Leave half a refresh interval to the main thread to upload
+                // and render the frame before the vsync
+                sc_tick refresh_interval =
+                    atomic_load_explicit(&fp->refresh_interval,
+                                         memory_order_relaxed);
+                sc_tick deadline = vsync - refresh_interval / 2;
+                timed_out =
+                    !sc_cond_timedwait(&fp->wait_cond, &fp->mutex, deadline);
+            }
+
+            fp->last_pts = pts;
+            fp->last_vsync = vsync;
+
+            bool stopped = fp->stopped;
+            sc_mutex_unlock(&fp->mutex);
+
+            if (stopped) {
+                sc_paced_packet_destroy(&ppacket);
+                goto stopped;
+            }
+
+            ok = sc_frame_source_sinks_push(&fp->frame_source, ppacket.frame);
+        } else {
+            assert(ppacket.type == SC_PACED_PACKET_TYPE_SESSION);
+            sc_mutex_unlock(&fp->mutex);
+            ok = sc_frame_source_sinks_push_session(&fp->frame_source,
+                                                    &ppacket.session);
+        }
+
+        sc_paced_packet_destroy(&ppacket);
+        if (!ok) {
+            LOGE("Paced packet could not be pushed, stopping");
+            sc_mutex_lock(&fp->mutex);
+            // Prevent to push any new packet
+            fp->stopped = true;
+            sc_mutex_unlock(&fp->mutex);
+            goto stopped;
+        }
+    }
+
+stopped:
+    assert(fp->stopped);
+
+    // Flush queue
+    while (!sc_vecdeque_is_empty(&fp->queue)) {
+        struct sc_paced_packet *ppacket = sc_vecdeque_popref(&fp->queue);
+        sc_paced_packet_destroy(ppacket);
+    }
+
+    LOGD("Frame pacing thread ended");
+
+    return 0;
+}
+
+static bool
+sc_frame_pacer_frame_sink_open(struct sc_frame_sink *sink,
+                               const AVCodecContext *ctx,
+                               const struct sc_stream_session *session) {
+    struct sc_frame_pacer *fp = DOWNCAST(sink);
+
+    bool ok = sc_mutex_init(&fp->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&fp->queue_cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    ok = sc_cond_init(&fp->wait_cond);
+    if (!ok) {
+        goto error_destroy_queue_cond;
+    }
+
+    sc_clock_init(&fp->clock);
+    sc_vecdeque_init(&fp->queue);
+    fp->jitter = 0;
+    fp->delay = 0;
+    fp->last_pts = SC_TICK_NONE;
+    fp->last_vsync = SC_TICK_NONE;
+    fp->stopped = false;
+
+    if (!sc_frame_source_sinks_open(&fp->frame_source, ctx, session)) {
+        goto error_destroy_wait_cond;
+    }
+
+    ok = sc_thread_create(&fp->thread, run_pacing, "scrcpy-pacer", fp);
+    if (!ok) {
+        LOGE("Could not start frame pacing thread");
+        goto error_close_sinks;
+    }
+
+    return true;
+
+error_close_sinks:
+    sc_frame_source_sinks_close(&fp->frame_source);
+error_destroy_wait_cond:
+    sc_cond_destroy(&fp->wait_cond);
+error_destroy_queue_cond:
+    sc_cond_destroy(&fp->queue_cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&fp->mutex);
+
+    return false;
+}
+
+static void
+sc_frame_pacer_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_frame_pacer *fp = DOWNCAST(sink);
+
+    sc_mutex_lock(&fp->mutex);
+    fp->stopped = true;
+    sc_cond_signal(&fp->queue_cond);
+    sc_cond_signal(&fp->wait_cond);
+    sc_mutex_unlock(&fp->mutex);
+
+    sc_thread_join(&fp->thread, NULL);
+
+    sc_frame_source_sinks_close(&fp->frame_source);
+
+    sc_cond_destroy(&fp->wait_cond);
+    sc_cond_destroy(&fp->queue_cond);
+    sc_mutex_destroy(&fp->mutex);
+}
+
+static void
+sc_frame_pacer_update_delay(struct sc_frame_pacer *fp, sc_tick now,
+                            sc_tick pts) {
+    if (fp->clock.range) {
+        // Deviation of the arrival date from the date predicted by the clock
+        sc_tick expected = sc_clock_to_system_time(&fp->clock, pts);
+        sc_tick deviation = now > expected ? now - expected : expected - now;
+        fp->jitter += (deviation - fp->jitter) / SC_FRAME_PACER_JITTER_RANGE;
+
+        sc_tick delay = fp->jitter * SC_FRAME_PACER_JITTER_FACTOR;
+        fp->delay = MIN(delay, fp->max_delay);
+    }
+
+    sc_clock_update(&fp->clock, now, pts);
+}
+
+static bool
+sc_frame_pacer_frame_sink_push(struct sc_frame_sink *sink,
+                               const AVFrame *frame) {
+    struct sc_frame_pacer *fp = DOWNCAST(sink);
+
+    sc_mutex_lock(&fp->mutex);
+
+    if (fp->stopped) {
+        sc_mutex_unlock(&fp->mutex);
+        return false;
+    }
+
+    sc_tick now = sc_tick_now();
+    sc_frame_pacer_update_delay(fp, now, SC_TICK_FROM_US(frame->pts));
+    sc_cond_signal(&fp->wait_cond);
+
+    if (fp->clock.range == 1) {
+        // Do not delay the first frame
+        sc_mutex_unlock(&fp->mutex);
+        return sc_frame_source_sinks_push(&fp->frame_source, frame);
+    }
+
+    struct sc_paced_packet *ppacket = sc_vecdeque_push_hole(&fp->queue);
+    if (!ppacket) {
+        sc_mutex_unlock(&fp->mutex);
+        LOG_OOM();
+        return false;
+    }
+
+    bool ok = sc_paced_packet_init_frame(ppacket, frame);
+    if (!ok) {
+        sc_mutex_unlock(&fp->mutex);
+        LOG_OOM();
+        return false;
+    }
+
+    ppacket->push_date = now;
+
+    sc_cond_signal(&fp->queue_cond);
+
+    sc_mutex_unlock(&fp->mutex);
+
+    return true;
+}
+
+static bool
+sc_frame_pacer_frame_sink_push_session(struct sc_frame_sink *sink,
+                                      const struct sc_stream_session *session) {
+    struct sc_frame_pacer *fp = DOWNCAST(sink);
+
+    sc_mutex_lock(&fp->mutex);
+
+    if (fp->stopped) {
+        sc_mutex_unlock(&fp->mutex);
+        return false;
+    }
+
+    struct sc_paced_packet *ppacket = sc_vecdeque_push_hole(&fp->queue);
+    if (!ppacket) {
+        sc_mutex_unlock(&fp->mutex);
+        LOG_OOM();
+        return false;
+    }
+
+    sc_paced_packet_init_session(ppacket, session);
+    ppacket->push_date = sc_tick_now();
+
+    sc_cond_signal(&fp->queue_cond);
+
+    sc_mutex_unlock(&fp->mutex);
+
+    return true;
+}
+
+void
+sc_frame_pacer_init(struct sc_frame_pacer *fp, sc_tick max_delay) {
+    assert(max_delay > 0);
+
+    fp->max_delay = max_delay;
+    atomic_init(&fp->refresh_interval, 0);
+    atomic_init(&fp->last_present_date, 0);
+
+    sc_frame_source_init(&fp->frame_source);
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_frame_pacer_frame_sink_open,
+        .close = sc_frame_pacer_frame_sink_close,
+        .push = sc_frame_pacer_frame_sink_push,
+        .push_session = sc_frame_pacer_frame_sink_push_session,
+    };
+
+    fp->frame_sink.ops = &ops;
+}
+
+void
+sc_frame_pacer_set_refresh_interval(struct sc_frame_pacer *fp,
+                                    sc_tick refresh_interval) {
+    atomic_store_explicit(&fp->refresh_interval, refresh_interval,
+                          memory_order_relaxed);
+}
+
+void
+sc_frame_pacer_on_present(struct sc_frame_pacer *fp, sc_tick date) {
+    atomic_store_explicit(&fp->last_present_date, date, memory_order_relaxed);
+}
+
+void
+sc_frame_intervals_init(struct sc_frame_intervals *fi) {
+    fi->last_date = SC_TICK_NONE;
+    fi->count = 0;
+    fi->mean = 0;
+    fi->m2 = 0;
+    fi->max = 0;
+}
+
+void
+sc_frame_intervals_add(struct sc_frame_intervals *fi, sc_tick date) {
+    if (fi->last_date != SC_TICK_NONE) {
+        sc_tick interval = date - fi->last_date;
+        if (interval > fi->max) {
+            fi->max = interval;
+        }
+
+        // Welford's online algorithm
+        ++fi->count;
+        double delta = interval - fi->mean;
+        fi->mean += delta / fi->count;
+        fi->m2 += delta * (interval - fi->mean);
+    }
+
+    fi->last_date = date;
+}
+
+double
+sc_frame_intervals_get_stddev(const struct sc_frame_intervals *fi) {
+    if (fi->count < 2) {
+        return 0;
+    }
+
+    return sqrt(fi->m2 / (fi->count - 1));
+}
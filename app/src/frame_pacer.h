@@ -0,0 +1,145 @@
+#ifndef SC_FRAME_PACER_H
+#define SC_FRAME_PACER_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <libavutil/frame.h>
+
+#include "clock.h"
+#include "trait/frame_source.h"
+#include "trait/frame_sink.h"
+#include "util/thread.h"
+#include "util/tick.h"
+#include "util/vecdeque.h"
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+
+enum sc_paced_packet_type {
+    SC_PACED_PACKET_TYPE_FRAME,
+    SC_PACED_PACKET_TYPE_SESSION,
+};
+
+struct sc_paced_packet {
+    enum sc_paced_packet_type type;
+    union {
+        AVFrame *frame;
+        struct sc_stream_session session;
+    };
+    sc_tick push_date;
+};
+
+struct sc_paced_packet_queue SC_VECDEQUE(struct sc_paced_packet);
+
+/**
+ * A frame pacer releases the frames at a steady rate, aligned on the display
+ * refresh, rather than as soon as they are decoded.
+ *
+ * Each frame is delayed according to its PTS by a small adaptive delay,
+ * computed from the jitter of the frame arrival dates, so that frames
+ * received late can still be presented on time. The delay never exceeds
+ * max_delay.
+ *
+ * The frame is then released so that it is rendered just before a vsync (the
+ * presentation dates are reported by the screen, which renders with vsync
+ * enabled), keeping the cadence of the previous frames as long as possible.
+ */
+struct sc_frame_pacer {
+    struct sc_frame_source frame_source; // frame source trait
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    sc_tick max_delay;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond queue_cond;
+    sc_cond wait_cond;
+
+    // The following fields are protected by the mutex
+    struct sc_clock clock;
+    struct sc_paced_packet_queue queue;
+    sc_tick jitter; // moving average of the arrival date deviations
+    sc_tick delay; // current adaptive delay, in [0, max_delay]
+    bool stopped;
+
+    // Only accessed by the pacing thread
+    sc_tick last_pts; // SC_TICK_NONE if no frame has been released yet
+    sc_tick last_vsync;
+
+    // Written by the main thread (0 if unknown)
+    atomic_int_least64_t refresh_interval;
+    atomic_int_least64_t last_present_date;
+};
+
+/**
+ * Statistics of the intervals between consecutive frame presentations
+ *
+ * The standard deviation measures the judder: it is 0 if the frames are
+ * presented at a perfectly steady rate.
+ */
+struct sc_frame_intervals {
+    sc_tick last_date; // SC_TICK_NONE if no frame has been presented yet
+    uint64_t count; // number of intervals
+    double mean; // in ticks
+    double m2; // sum of squared deviations from the mean (Welford)
+    sc_tick max;
+};
+
+/**
+ * Initialize a frame pacer.
+ *
+ * \param max_delay a (strictly) positive maximum delay
+ */
+void
+sc_frame_pacer_init(struct sc_frame_pacer *fp, sc_tick max_delay);
+
+// To be called by the main thread when the display refresh rate changes
+void
+sc_frame_pacer_set_refresh_interval(struct sc_frame_pacer *fp,
+                                    sc_tick refresh_interval);
+
+// To be called by the main thread after a frame has been presented
+void
+sc_frame_pacer_on_present(struct sc_frame_pacer *fp, sc_tick date);
+
+/**
+ * Return the first vsync at or after date, vsync_date being the date of any
+ * vsync.
+ *
+ * If the vsync phase or the refresh interval is unknown (0), return date
+ * unchanged.
+ */
+sc_tick
+sc_frame_pacer_next_vsync(sc_tick date, sc_tick vsync_date,
+                          sc_tick refresh_interval);
+
+/**
+ * Select the vsync on which to present a frame expected at target.
+ *
+ * To avoid judder, the frame is presented pts_interval after the previous
+ * frame (presented on last_vsync), rounded to a number of refresh intervals,
+ * as long as this is within one refresh interval of the first vsync after
+ * target.
+ *
+ * last_vsync is SC_TICK_NONE and pts_interval is negative if there is no
+ * previous frame.
+ */
+sc_tick
+sc_frame_pacer_select_vsync(sc_tick target, sc_tick vsync_date,
+                            sc_tick refresh_interval, sc_tick last_vsync,
+                            sc_tick pts_interval);
+
+void
+sc_frame_intervals_init(struct sc_frame_intervals *fi);
+
+void
+sc_frame_intervals_add(struct sc_frame_intervals *fi, sc_tick date);
+
+// Return the standard deviation of the intervals, in ticks
+double
+sc_frame_intervals_get_stddev(const struct sc_frame_intervals *fi);
+
+#endif
@@ -0,0 +1,387 @@
+#include "gl_scaler.h"
+
+#include <assert.h>
+
+#include "util/log.h"
+
+#define SC_GL_SCALER_ATTRIB_POSITION 0
+#define SC_GL_SCALER_ATTRIB_TEXCOORD 1
+
+static const char *const sc_gl_scaler_header_gl = "#version 330 core\n";
+static const char *const sc_gl_scaler_header_gles =
+    "#version 300 es\n"
+    "precision highp float;\n"
+    "precision highp int;\n"
+    "precision highp sampler2D;\n";
+
+static const char *const sc_gl_scaler_vertex_shader =
+    "in vec2 a_position;\n"
+    "in vec2 a_texcoord;\n"
+    "out vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    v_texcoord = a_texcoord;\n"
+    "    gl_Position = vec4(a_position, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *const sc_gl_scaler_fragment_shader =
+    "in vec2 v_texcoord;\n"
+    "out vec4 frag_color;\n"
+    "uniform sampler2D u_tex_y;\n"
+    "uniform sampler2D u_tex_u;\n"
+    "uniform sampler2D u_tex_v;\n"
+    // Luma texels per output pixel, along the texture axes
+    "uniform vec2 u_ratio;\n"
+    "uniform mat3 u_yuv_to_rgb;\n"
+    "uniform vec3 u_yuv_offset;\n"
+    "const float PI = 3.14159265358979;\n"
+    // Limit the number of taps for large downscaling ratios
+    "const float MAX_SCALE = 4.0;\n"
+    "#ifdef SC_LANCZOS\n"
+    "const float RADIUS = 3.0;\n"
+    "float kernel(float x) {\n"
+    "    x = abs(x);\n"
+    "    if (x < 1e-5) return 1.0;\n"
+    "    if (x >= RADIUS) return 0.0;\n"
+    "    float px = PI * x;\n"
+    "    return RADIUS * sin(px) * sin(px / RADIUS) / (px * px);\n"
+    "}\n"
+    "#else\n"
+    // Catmull-Rom
+    "const float RADIUS = 2.0;\n"
+    "float kernel(float x) {\n"
+    "    x = abs(x);\n"
+    "    if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;\n"
+    "    if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;\n"
+    "    return 0.0;\n"
+    "}\n"
+    "#endif\n"
+    "float sample_plane(sampler2D tex) {\n"
+    "    ivec2 size = textureSize(tex, 0);\n"
+    "    vec2 plane_ratio = vec2(size) / vec2(textureSize(u_tex_y, 0));\n"
+    // Widen the kernel to downscale, but not to upscale
+    "    vec2 scale = clamp(u_ratio * plane_ratio, 1.0, MAX_SCALE);\n"
+    "    vec2 pos = v_texcoord * vec2(size) - 0.5;\n"
+    "    ivec2 first = ivec2(floor(pos - RADIUS * scale)) + 1;\n"
+    "    ivec2 last = ivec2(floor(pos + RADIUS * scale));\n"
+    "    float sum = 0.0;\n"
+    "    float weight_sum = 0.0;\n"
+    "    for (int y = first.y; y <= last.y; ++y) {\n"
+    "        float wy = kernel((float(y) - pos.y) / scale.y);\n"
+    "        int ty = clamp(y, 0, size.y - 1);\n"
+    "        for (int x = first.x; x <= last.x; ++x) {\n"
+    "            float w = wy * kernel((float(x) - pos.x) / scale.x);\n"
+    "            int tx = clamp(x, 0, size.x - 1);\n"
+    "            sum += w * texelFetch(tex, ivec2(tx, ty), 0).r;\n"
+    "            weight_sum += w;\n"
+    "        }\n"
+    "    }\n"
+    "    return sum / weight_sum;\n"
+    "}\n"
+    "void main() {\n"
+    "    vec3 yuv = vec3(sample_plane(u_tex_y), sample_plane(u_tex_u),\n"
+    "                    sample_plane(u_tex_v));\n"
+    "    vec3 rgb = u_yuv_to_rgb * (yuv - u_yuv_offset);\n"
+    "    frag_color = vec4(clamp(rgb, 0.0, 1.0), 1.0);\n"
+    "}\n";
+
+static GLuint
+sc_gl_scaler_compile(struct sc_gl_scaler *scaler, GLenum type,
+                     const char *source) {
+    struct sc_opengl *gl = scaler->gl;
+
+    const char *header = gl->is_opengles ? sc_gl_scaler_header_gles
+                                         : sc_gl_scaler_header_gl;
+    const char *define = scaler->filter == SC_DOWNSCALE_FILTER_LANCZOS
+                       ? "#define SC_LANCZOS\n"
+                       : "";
+    const GLchar *sources[] = {header, define, source};
+
+    GLuint shader = gl->CreateShader(type);
+    if (!shader) {
+        LOGE("Could not create shader");
+        return 0;
+    }
+
+    gl->ShaderSource(shader, ARRAY_LEN(sources), sources, NULL);
+    gl->CompileShader(shader);
+
+    GLint status;
+    gl->GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        char info[512];
+        gl->GetShaderInfoLog(shader, sizeof(info), NULL, info);
+        LOGE("Could not compile shader: %s", info);
+        gl->DeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+static GLuint
+sc_gl_scaler_link(struct sc_gl_scaler *scaler) {
+    struct sc_opengl *gl = scaler->gl;
+
+    GLuint vs = sc_gl_scaler_compile(scaler, GL_VERTEX_SHADER,
+                                     sc_gl_scaler_vertex_shader);
+    if (!vs) {
+        return 0;
+    }
+
+    GLuint fs = sc_gl_scaler_compile(scaler, GL_FRAGMENT_SHADER,
+                                     sc_gl_scaler_fragment_shader);
+    if (!fs) {
+        gl->DeleteShader(vs);
+        return 0;
+    }
+
+    GLuint program = gl->CreateProgram();
+    if (!program) {
+        LOGE("Could not create shader program");
+        goto end;
+    }
+
+    gl->AttachShader(program, vs);
+    gl->AttachShader(program, fs);
+    gl->BindAttribLocation(program, SC_GL_SCALER_ATTRIB_POSITION,
+                           "a_position");
+    gl->BindAttribLocation(program, SC_GL_SCALER_ATTRIB_TEXCOORD,
+                           "a_texcoord");
+    gl->LinkProgram(program);
+
+    GLint status;
+    gl->GetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status) {
+        char info[512];
+        gl->GetProgramInfoLog(program, sizeof(info), NULL, info);
+        LOGE("Could not link shader program: %s", info);
+        gl->DeleteProgram(program);
+        program = 0;
+    }
+
+end:
+    // The shaders are released along with the program
+    gl->DeleteShader(vs);
+    gl->DeleteShader(fs);
+
+    return program;
+}
+
+bool
+sc_gl_scaler_init(struct sc_gl_scaler *scaler, struct sc_opengl *gl,
+                  enum sc_downscale_filter filter) {
+    assert(filter == SC_DOWNSCALE_FILTER_BICUBIC
+        || filter == SC_DOWNSCALE_FILTER_LANCZOS);
+
+    if (!sc_opengl_has_shader_functions(gl)) {
+        LOGE("Missing OpenGL functions for shaders");
+        return false;
+    }
+
+    scaler->gl = gl;
+    scaler->filter = filter;
+
+    scaler->program = sc_gl_scaler_link(scaler);
+    if (!scaler->program) {
+        return false;
+    }
+
+    GLuint program = scaler->program;
+    scaler->tex_y_location = gl->GetUniformLocation(program, "u_tex_y");
+    scaler->tex_u_location = gl->GetUniformLocation(program, "u_tex_u");
+    scaler->tex_v_location = gl->GetUniformLocation(program, "u_tex_v");
+    scaler->ratio_location = gl->GetUniformLocation(program, "u_ratio");
+    scaler->yuv_to_rgb_location =
+        gl->GetUniformLocation(program, "u_yuv_to_rgb");
+    scaler->yuv_offset_location =
+        gl->GetUniformLocation(program, "u_yuv_offset");
+
+    gl->GenVertexArrays(1, &scaler->vao);
+    gl->GenBuffers(1, &scaler->vbo);
+
+    gl->BindVertexArray(scaler->vao);
+    gl->BindBuffer(GL_ARRAY_BUFFER, scaler->vbo);
+    // Interleaved position (x, y) and texture coordinates (s, t)
+    GLsizei stride = 4 * sizeof(GLfloat);
+    gl->VertexAttribPointer(SC_GL_SCALER_ATTRIB_POSITION, 2, GL_FLOAT,
+                            GL_FALSE, stride, (const void *) 0);
+    gl->VertexAttribPointer(SC_GL_SCALER_ATTRIB_TEXCOORD, 2, GL_FLOAT,
+                            GL_FALSE, stride,
+                            (const void *) (2 * sizeof(GLfloat)));
+    gl->EnableVertexAttribArray(SC_GL_SCALER_ATTRIB_POSITION);
+    gl->EnableVertexAttribArray(SC_GL_SCALER_ATTRIB_TEXCOORD);
+    gl->BindVertexArray(0);
+    gl->BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return true;
+}
+
+void
+sc_gl_scaler_destroy(struct sc_gl_scaler *scaler) {
+    struct sc_opengl *gl = scaler->gl;
+    gl->DeleteBuffers(1, &scaler->vbo);
+    gl->DeleteVertexArrays(1, &scaler->vao);
+    gl->DeleteProgram(scaler->program);
+}
+
+void
+sc_gl_scaler_get_yuv_to_rgb(enum AVColorSpace color_space,
+                            enum AVColorRange color_range, float matrix[9],
+                            float offset[3]) {
+    bool full_range = color_range == AVCOL_RANGE_JPEG;
+
+    // Same mapping as sc_texture_to_sdl_color_space()
+    float kr;
+    float kb;
+    switch (color_space) {
+        case AVCOL_SPC_BT709:
+        case AVCOL_SPC_RGB:
+            kr = 0.2126f;
+            kb = 0.0722f;
+            break;
+        case AVCOL_SPC_BT2020_NCL:
+        case AVCOL_SPC_BT2020_CL:
+            kr = 0.2627f;
+            kb = 0.0593f;
+            break;
+        case AVCOL_SPC_BT470BG:
+        case AVCOL_SPC_SMPTE170M:
+            kr = 0.299f;
+            kb = 0.114f;
+            break;
+        default:
+            // JPEG
+            kr = 0.299f;
+            kb = 0.114f;
+            full_range = true;
+            break;
+    }
+    float kg = 1.f - kr - kb;
+
+    float y_scale;
+    float c_scale;
+    if (full_range) {
+        y_scale = 1.f;
+        c_scale = 1.f;
+        offset[0] = 0.f;
+    } else {
+        y_scale = 255.f / 219.f;
+        c_scale = 255.f / 224.f;
+        offset[0] = 16.f / 255.f;
+    }
+    offset[1] = 128.f / 255.f;
+    offset[2] = 128.f / 255.f;
+
+    // R = Y + 2(1-Kr) Cr
+    matrix[0] = y_scale;
+    matrix[1] = 0.f;
+    matrix[2] = c_scale * 2.f * (1.f - kr);
+    // G = Y - 2Kb(1-Kb)/Kg Cb - 2Kr(1-Kr)/Kg Cr
+    matrix[3] = y_scale;
+    matrix[4] = -c_scale * 2.f * kb * (1.f - kb) / kg;
+    matrix[5] = -c_scale * 2.f * kr * (1.f - kr) / kg;
+    // B = Y + 2(1-Kb) Cb
+    matrix[6] = y_scale;
+    matrix[7] = c_scale * 2.f * (1.f - kb);
+    matrix[8] = 0.f;
+}
+
+void
+sc_gl_scaler_get_texcoords(enum sc_orientation orientation,
+                           float texcoords[8]) {
+    static const float corners[4][2] = {{0, 0}, {1, 0}, {0, 1}, {1, 1}};
+
+    unsigned cw_rotation = sc_orientation_get_rotation(orientation);
+    bool mirror = sc_orientation_is_mirror(orientation);
+
+    // The content is the texture flipped (if mirror), then rotated clockwise:
+    // apply the inverse transformation to each corner of the content
+    for (unsigned i = 0; i < 4; ++i) {
+        float x = corners[i][0];
+        float y = corners[i][1];
+        for (unsigned r = 0; r < cw_rotation; ++r) {
+            float tmp = x;
+            x = y;
+            y = 1.f - tmp;
+        }
+        if (mirror) {
+            x = 1.f - x;
+        }
+        texcoords[2 * i] = x;
+        texcoords[2 * i + 1] = y;
+    }
+}
+
+void
+sc_gl_scaler_render(struct sc_gl_scaler *scaler,
+                    const struct sc_gl_scaler_planes *planes,
+                    struct sc_size frame_size, enum AVColorSpace color_space,
+                    enum AVColorRange color_range, const SDL_FRect *geometry,
+                    enum sc_orientation orientation,
+                    struct sc_size drawable_size) {
+    struct sc_opengl *gl = scaler->gl;
+
+    float texcoords[8];
+    sc_gl_scaler_get_texcoords(orientation, texcoords);
+
+    // Triangle strip: top-left, top-right, bottom-left, bottom-right
+    static const float positions[8] = {-1, 1, 1, 1, -1, -1, 1, -1};
+    GLfloat vertices[16];
+    for (unsigned i = 0; i < 4; ++i) {
+        vertices[4 * i] = positions[2 * i];
+        vertices[4 * i + 1] = positions[2 * i + 1];
+        vertices[4 * i + 2] = texcoords[2 * i];
+        vertices[4 * i + 3] = texcoords[2 * i + 1];
+    }
+
+    float matrix[9];
+    float offset[3];
+    sc_gl_scaler_get_yuv_to_rgb(color_space, color_range, matrix, offset);
+
+    // Source texels per output pixel, along the texture axes
+    bool swap = sc_orientation_is_swap(orientation);
+    float content_w = swap ? geometry->h : geometry->w;
+    float content_h = swap ? geometry->w : geometry->h;
+    float ratio_x = content_w > 0 ? frame_size.width / content_w : 1.f;
+    float ratio_y = content_h > 0 ? frame_size.height / content_h : 1.f;
+
+    // The OpenGL viewport origin is the bottom-left corner
+    GLint x = SDL_lroundf(geometry->x);
+    GLint y = SDL_lroundf(drawable_size.height - geometry->y - geometry->h);
+    GLsizei w = SDL_lroundf(geometry->w);
+    GLsizei h = SDL_lroundf(geometry->h);
+
+    gl->Viewport(x, y, w, h);
+    gl->Disable(GL_BLEND);
+    gl->Disable(GL_SCISSOR_TEST);
+
+    gl->UseProgram(scaler->program);
+    gl->Uniform1i(scaler->tex_y_location, 0);
+    gl->Uniform1i(scaler->tex_u_location, 1);
+    gl->Uniform1i(scaler->tex_v_location, 2);
+    gl->Uniform2f(scaler->ratio_location, ratio_x, ratio_y);
+    gl->UniformMatrix3fv(scaler->yuv_to_rgb_location, 1, GL_TRUE, matrix);
+    gl->Uniform3fv(scaler->yuv_offset_location, 1, offset);
+
+    const GLuint textures[] = {planes->y, planes->u, planes->v};
+    for (unsigned i = 0; i < ARRAY_LEN(textures); ++i) {
+        gl->ActiveTexture(GL_TEXTURE0 + i);
+        gl->BindTexture(GL_TEXTURE_2D, textures[i]);
+    }
+
+    gl->BindVertexArray(scaler->vao);
+    gl->BindBuffer(GL_ARRAY_BUFFER, scaler->vbo);
+    gl->BufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices,
+                   GL_STREAM_DRAW);
+    gl->DrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    // Leave a clean state for the SDL renderer (which has invalidated its
+    // cached state on flush)
+    gl->BindBuffer(GL_ARRAY_BUFFER, 0);
+    gl->BindVertexArray(0);
+    for (unsigned i = ARRAY_LEN(textures); i > 0; --i) {
+        gl->ActiveTexture(GL_TEXTURE0 + i - 1);
+        gl->BindTexture(GL_TEXTURE_2D, 0);
+    }
+    gl->UseProgram(0);
+}
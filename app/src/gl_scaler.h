@@ -0,0 +1,89 @@
+#ifndef SC_GL_SCALER_H
+#define SC_GL_SCALER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <libavutil/pixfmt.h>
+#include <SDL3/SDL.h>
+
+#include "coords.h"
+#include "opengl.h"
+#include "options.h"
+
+/**
+ * Shader converting YUV 4:2:0 planes to RGB and scaling them in a single pass
+ *
+ * Unlike trilinear filtering, it does not require to regenerate the mipmaps
+ * on every frame: each output pixel is computed directly from the source
+ * texels, using a bicubic (Catmull-Rom) or Lanczos (3 lobes) kernel widened
+ * by the downscaling ratio.
+ *
+ * It draws directly on the framebuffer of the SDL OpenGL renderer, which must
+ * be flushed beforehand.
+ */
+struct sc_gl_scaler {
+    struct sc_opengl *gl; // owned by the caller
+    enum sc_downscale_filter filter;
+
+    GLuint program;
+    GLuint vao;
+    GLuint vbo;
+
+    GLint tex_y_location;
+    GLint tex_u_location;
+    GLint tex_v_location;
+    GLint ratio_location;
+    GLint yuv_to_rgb_location;
+    GLint yuv_offset_location;
+};
+
+struct sc_gl_scaler_planes {
+    GLuint y;
+    GLuint u;
+    GLuint v;
+};
+
+/**
+ * Compile the shaders for the given filter (bicubic or lanczos)
+ *
+ * The OpenGL context of the renderer must be current. It requires OpenGL 3.3+
+ * or OpenGL ES 3.0+.
+ */
+bool
+sc_gl_scaler_init(struct sc_gl_scaler *scaler, struct sc_opengl *gl,
+                  enum sc_downscale_filter filter);
+
+void
+sc_gl_scaler_destroy(struct sc_gl_scaler *scaler);
+
+/**
+ * Render the planes (of a frame of the given size) into the geometry (in
+ * drawable coordinates) of a drawable of the given size
+ */
+void
+sc_gl_scaler_render(struct sc_gl_scaler *scaler,
+                    const struct sc_gl_scaler_planes *planes,
+                    struct sc_size frame_size, enum AVColorSpace color_space,
+                    enum AVColorRange color_range, const SDL_FRect *geometry,
+                    enum sc_orientation orientation,
+                    struct sc_size drawable_size);
+
+/**
+ * Compute the matrix (row-major) and the offset to convert normalized YUV
+ * values to RGB: rgb = matrix * (yuv - offset)
+ */
+void
+sc_gl_scaler_get_yuv_to_rgb(enum AVColorSpace color_space,
+                            enum AVColorRange color_range, float matrix[9],
+                            float offset[3]);
+
+/**
+ * Compute the texture coordinates of the 4 corners of the geometry (top-left,
+ * top-right, bottom-left, bottom-right) for the given orientation
+ */
+void
+sc_gl_scaler_get_texcoords(enum sc_orientation orientation,
+                           float texcoords[8]);
+
+#endif
@@ -0,0 +1,221 @@
+#include "hid_coalescer.h"
+
+#include <assert.h>
+
+#include "hid/hid_mouse.h"
+#include "util/log.h"
+
+static bool
+sc_hid_coalescer_accepts(uint16_t hid_id) {
+    return hid_id == SC_HID_ID_MOUSE
+        || (hid_id >= SC_HID_ID_GAMEPAD_FIRST
+            && hid_id <= SC_HID_ID_GAMEPAD_LAST);
+}
+
+static bool
+sc_hid_coalescer_merge(struct sc_hid_input *pending,
+                       const struct sc_hid_input *next) {
+    if (next->hid_id == SC_HID_ID_MOUSE) {
+        return sc_hid_mouse_merge_input(pending, next);
+    }
+
+    return sc_hid_gamepad_merge_input(pending, next);
+}
+
+static void
+sc_hid_coalescer_emit(struct sc_hid_coalescer *coalescer,
+                      const struct sc_hid_input *hid_input) {
+    coalescer->cbs->on_input(coalescer, hid_input, coalescer->cbs_userdata);
+}
+
+static void
+sc_hid_coalescer_push_locked(struct sc_hid_coalescer *coalescer,
+                             const struct sc_hid_input *hid_input,
+                             sc_tick now) {
+    uint16_t hid_id = hid_input->hid_id;
+    if (!coalescer->period || coalescer->stopped
+            || !sc_hid_coalescer_accepts(hid_id)) {
+        sc_hid_coalescer_emit(coalescer, hid_input);
+        return;
+    }
+
+    assert(hid_id <= SC_HID_COALESCER_MAX_ID);
+    struct sc_hid_coalescer_slot *slot = &coalescer->slots[hid_id];
+
+    if (slot->pending) {
+        if (sc_hid_coalescer_merge(&slot->input, hid_input)) {
+            // It will be emitted on the next period
+            return;
+        }
+
+        // The buttons state changed (or the accumulated motion does not fit
+        // in a single report): emit both reports immediately, in order
+        sc_hid_coalescer_emit(coalescer, &slot->input);
+        slot->pending = false;
+        sc_hid_coalescer_emit(coalescer, hid_input);
+        slot->next_date = now + coalescer->period;
+        return;
+    }
+
+    if (now >= slot->next_date) {
+        sc_hid_coalescer_emit(coalescer, hid_input);
+        slot->next_date = now + coalescer->period;
+        return;
+    }
+
+    slot->input = *hid_input;
+    slot->pending = true;
+    sc_cond_signal(&coalescer->cond);
+}
+
+static sc_tick
+sc_hid_coalescer_process_locked(struct sc_hid_coalescer *coalescer,
+                                sc_tick now) {
+    sc_tick next = SC_TICK_NONE;
+
+    for (unsigned i = 0; i < ARRAY_LEN(coalescer->slots); ++i) {
+        struct sc_hid_coalescer_slot *slot = &coalescer->slots[i];
+        if (!slot->pending) {
+            continue;
+        }
+
+        if (now >= slot->next_date) {
+            sc_hid_coalescer_emit(coalescer, &slot->input);
+            slot->pending = false;
+            slot->next_date = now + coalescer->period;
+        } else if (next == SC_TICK_NONE || slot->next_date < next) {
+            next = slot->next_date;
+        }
+    }
+
+    return next;
+}
+
+static int
+run_hid_coalescer(void *data) {
+    struct sc_hid_coalescer *coalescer = data;
+
+    sc_mutex_lock(&coalescer->mutex);
+    while (!coalescer->stopped) {
+        sc_tick next =
+            sc_hid_coalescer_process_locked(coalescer, sc_tick_now());
+        if (next == SC_TICK_NONE) {
+            sc_cond_wait(&coalescer->cond, &coalescer->mutex);
+        } else {
+            sc_cond_timedwait(&coalescer->cond, &coalescer->mutex, next);
+        }
+    }
+    sc_mutex_unlock(&coalescer->mutex);
+
+    LOGD("HID coalescer stopped");
+    return 0;
+}
+
+bool
+sc_hid_coalescer_init(struct sc_hid_coalescer *coalescer, uint16_t report_rate,
+                      const struct sc_hid_coalescer_callbacks *cbs,
+                      void *cbs_userdata) {
+    bool ok = sc_mutex_init(&coalescer->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&coalescer->cond);
+    if (!ok) {
+        sc_mutex_destroy(&coalescer->mutex);
+        return false;
+    }
+
+    coalescer->period = report_rate ? SC_TICK_FREQ / report_rate : 0;
+    coalescer->stopped = false;
+
+    for (unsigned i = 0; i < ARRAY_LEN(coalescer->slots); ++i) {
+        coalescer->slots[i].pending = false;
+        coalescer->slots[i].next_date = SC_TICK_NONE;
+    }
+
+    assert(cbs && cbs->on_input);
+    coalescer->cbs = cbs;
+    coalescer->cbs_userdata = cbs_userdata;
+
+    return true;
+}
+
+void
+sc_hid_coalescer_destroy(struct sc_hid_coalescer *coalescer) {
+    sc_cond_destroy(&coalescer->cond);
+    sc_mutex_destroy(&coalescer->mutex);
+}
+
+bool
+sc_hid_coalescer_start(struct sc_hid_coalescer *coalescer) {
+    if (!coalescer->period) {
+        // Nothing is ever delayed, no thread is needed
+        return true;
+    }
+
+    LOGD("Starting HID coalescer thread");
+
+    bool ok = sc_thread_create(&coalescer->thread, run_hid_coalescer,
+                               "scrcpy-hid", coalescer);
+    if (!ok) {
+        LOGE("Could not start HID coalescer thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_hid_coalescer_stop(struct sc_hid_coalescer *coalescer) {
+    sc_mutex_lock(&coalescer->mutex);
+    coalescer->stopped = true;
+    sc_cond_signal(&coalescer->cond);
+    sc_mutex_unlock(&coalescer->mutex);
+}
+
+void
+sc_hid_coalescer_join(struct sc_hid_coalescer *coalescer) {
+    if (coalescer->period) {
+        sc_thread_join(&coalescer->thread, NULL);
+    }
+}
+
+void
+sc_hid_coalescer_push(struct sc_hid_coalescer *coalescer,
+                      const struct sc_hid_input *hid_input) {
+    sc_mutex_lock(&coalescer->mutex);
+    sc_hid_coalescer_push_locked(coalescer, hid_input, sc_tick_now());
+    sc_mutex_unlock(&coalescer->mutex);
+}
+
+void
+sc_hid_coalescer_flush(struct sc_hid_coalescer *coalescer, uint16_t hid_id) {
+    assert(hid_id <= SC_HID_COALESCER_MAX_ID);
+
+    sc_mutex_lock(&coalescer->mutex);
+    struct sc_hid_coalescer_slot *slot = &coalescer->slots[hid_id];
+    if (slot->pending) {
+        sc_hid_coalescer_emit(coalescer, &slot->input);
+        slot->pending = false;
+    }
+    sc_mutex_unlock(&coalescer->mutex);
+}
+
+#ifdef SC_TEST
+void
+sc_hid_coalescer_push_at(struct sc_hid_coalescer *coalescer,
+                         const struct sc_hid_input *hid_input, sc_tick now) {
+    sc_mutex_lock(&coalescer->mutex);
+    sc_hid_coalescer_push_locked(coalescer, hid_input, now);
+    sc_mutex_unlock(&coalescer->mutex);
+}
+
+sc_tick
+sc_hid_coalescer_process_at(struct sc_hid_coalescer *coalescer, sc_tick now) {
+    sc_mutex_lock(&coalescer->mutex);
+    sc_tick next = sc_hid_coalescer_process_locked(coalescer, now);
+    sc_mutex_unlock(&coalescer->mutex);
+    return next;
+}
+#endif
@@ -0,0 +1,106 @@
+#ifndef SC_HID_COALESCER_H
+#define SC_HID_COALESCER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hid/hid_event.h"
+#include "hid/hid_gamepad.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * HID input reports coalescer
+ *
+ * Limit the rate of the HID input reports sent to the device, per HID id.
+ *
+ * Within a report period, mouse reports accumulate their relative motion and
+ * gamepad reports keep the last axes values. A report changing the buttons
+ * state is never merged: the pending report (if any) and the new one are
+ * emitted immediately, in order, so that no button transition is lost.
+ *
+ * Reports which cannot be coalesced (keyboard) are emitted immediately.
+ *
+ * A report rate of 0 disables the coalescing: all the reports are emitted
+ * immediately.
+ */
+
+#define SC_HID_COALESCER_MAX_ID SC_HID_ID_GAMEPAD_LAST
+
+struct sc_hid_coalescer_slot {
+    struct sc_hid_input input;
+    bool pending;
+    // Date before which a new report must be delayed
+    sc_tick next_date;
+};
+
+struct sc_hid_coalescer {
+    sc_tick period; // 0 if disabled
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+
+    struct sc_hid_coalescer_slot slots[SC_HID_COALESCER_MAX_ID + 1];
+
+    const struct sc_hid_coalescer_callbacks *cbs;
+    void *cbs_userdata;
+};
+
+struct sc_hid_coalescer_callbacks {
+    // Called with the coalescer lock held, it must not call the coalescer
+    void (*on_input)(struct sc_hid_coalescer *coalescer,
+                     const struct sc_hid_input *hid_input, void *userdata);
+};
+
+bool
+sc_hid_coalescer_init(struct sc_hid_coalescer *coalescer, uint16_t report_rate,
+                      const struct sc_hid_coalescer_callbacks *cbs,
+                      void *cbs_userdata);
+
+void
+sc_hid_coalescer_destroy(struct sc_hid_coalescer *coalescer);
+
+bool
+sc_hid_coalescer_start(struct sc_hid_coalescer *coalescer);
+
+void
+sc_hid_coalescer_stop(struct sc_hid_coalescer *coalescer);
+
+void
+sc_hid_coalescer_join(struct sc_hid_coalescer *coalescer);
+
+/**
+ * Push a HID input report
+ *
+ * It is either emitted immediately (from the caller thread) or delayed until
+ * the next report period (from the coalescer thread).
+ */
+void
+sc_hid_coalescer_push(struct sc_hid_coalescer *coalescer,
+                      const struct sc_hid_input *hid_input);
+
+/**
+ * Emit the pending report for hid_id immediately, if any
+ *
+ * It must be called before closing the HID device.
+ */
+void
+sc_hid_coalescer_flush(struct sc_hid_coalescer *coalescer, uint16_t hid_id);
+
+#ifdef SC_TEST
+// Same as sc_hid_coalescer_push(), with an explicit date
+void
+sc_hid_coalescer_push_at(struct sc_hid_coalescer *coalescer,
+                         const struct sc_hid_input *hid_input, sc_tick now);
+
+// Emit the pending reports due at the given date, return the date of the next
+// pending report (or SC_TICK_NONE if there is none)
+sc_tick
+sc_hid_coalescer_process_at(struct sc_hid_coalescer *coalescer, sc_tick now);
+#endif
+
+#endif
@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <stddef.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include "util/binary.h"
@@ -452,3 +453,20 @@ sc_hid_gamepad_generate_input_from_axis(struct sc_hid_gamepad *hid,
 
     return true;
 }
+
+bool
+sc_hid_gamepad_merge_input(struct sc_hid_input *hid_input,
+                           const struct sc_hid_input *next) {
+    assert(hid_input->hid_id == next->hid_id);
+    assert(hid_input->size == SC_HID_GAMEPAD_EVENT_SIZE);
+    assert(next->size == SC_HID_GAMEPAD_EVENT_SIZE);
+
+    // A change of the buttons (or dpad) state must be reported separately
+    if (memcmp(&hid_input->data[12], &next->data[12], 3)) {
+        return false;
+    }
+
+    // The report contains the absolute state, the last one wins
+    memcpy(hid_input->data, next->data, SC_HID_GAMEPAD_EVENT_SIZE);
+    return true;
+}
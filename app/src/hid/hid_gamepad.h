@@ -51,4 +51,13 @@ sc_hid_gamepad_generate_input_from_axis(struct sc_hid_gamepad *hid,
                                         struct sc_hid_input *hid_input,
                                 const struct sc_gamepad_axis_event *event);
 
+/**
+ * Replace the axes state of hid_input by the one of next
+ *
+ * Return false (and leave hid_input unchanged) if the buttons state differs.
+ */
+bool
+sc_hid_gamepad_merge_input(struct sc_hid_input *hid_input,
+                           const struct sc_hid_input *next);
+
 #endif
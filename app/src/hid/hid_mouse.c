@@ -1,6 +1,8 @@
 #include "hid_mouse.h"
 
+#include <assert.h>
 #include <stdint.h>
+#include <string.h>
 
 // 1 byte for buttons + padding, 1 byte for X position, 1 byte for Y position,
 // 1 byte for wheel motion, 1 byte for hozizontal scrolling
@@ -232,6 +234,43 @@ sc_hid_mouse_generate_input_from_scroll(struct sc_hid_mouse *hid,
     return true;
 }
 
+static bool
+sc_hid_mouse_add_axis(uint8_t *value, uint8_t delta) {
+    int sum = (int8_t) *value + (int8_t) delta;
+    if (sum < -127 || sum > 127) {
+        return false;
+    }
+    *value = (int8_t) sum;
+    return true;
+}
+
+bool
+sc_hid_mouse_merge_input(struct sc_hid_input *hid_input,
+                         const struct sc_hid_input *next) {
+    assert(hid_input->hid_id == SC_HID_ID_MOUSE);
+    assert(next->hid_id == SC_HID_ID_MOUSE);
+
+    const uint8_t *src = next->data;
+    uint8_t *dst = hid_input->data;
+
+    // A change of the buttons state must be reported separately
+    if (src[0] != dst[0]) {
+        return false;
+    }
+
+    // Do not modify the report if the merge fails
+    uint8_t merged[SC_HID_MOUSE_INPUT_SIZE];
+    memcpy(merged, dst, SC_HID_MOUSE_INPUT_SIZE);
+    for (unsigned i = 1; i < SC_HID_MOUSE_INPUT_SIZE; ++i) {
+        if (!sc_hid_mouse_add_axis(&merged[i], src[i])) {
+            return false;
+        }
+    }
+
+    memcpy(dst, merged, SC_HID_MOUSE_INPUT_SIZE);
+    return true;
+}
+
 void sc_hid_mouse_generate_open(struct sc_hid_open *hid_open) {
     hid_open->hid_id = SC_HID_ID_MOUSE;
     hid_open->report_desc = SC_HID_MOUSE_REPORT_DESC;
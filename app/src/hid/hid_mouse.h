@@ -34,4 +34,14 @@ sc_hid_mouse_generate_input_from_scroll(struct sc_hid_mouse *hid,
                                         struct sc_hid_input *hid_input,
                                     const struct sc_mouse_scroll_event *event);
 
+/**
+ * Merge the relative motion and scrolling of next into hid_input
+ *
+ * Return false (and leave hid_input unchanged) if the buttons state differs
+ * or if the accumulated values do not fit in a single report.
+ */
+bool
+sc_hid_mouse_merge_input(struct sc_hid_input *hid_input,
+                         const struct sc_hid_input *next);
+
 #endif
@@ -8,6 +8,7 @@
 #include "android/input.h"
 #include "android/keycodes.h"
 #include "input_events.h"
+#include "latency_probe.h"
 #include "screen.h"
 #include "shortcut_mod.h"
 #include "util/log.h"
@@ -24,6 +25,7 @@ sc_input_manager_init(struct sc_input_manager *im,
     im->controller = params->controller;
     im->fp = params->fp;
     im->screen = params->screen;
+    im->latency_probe = params->latency_probe;
     im->kp = params->kp;
     im->mp = params->mp;
     im->gp = params->gp;
@@ -48,6 +50,29 @@ sc_input_manager_init(struct sc_input_manager *im,
     im->next_sequence = 1; // 0 is reserved for SC_SEQUENCE_INVALID
 }
 
+static void
+probe_latency(struct sc_input_manager *im) {
+    if (!im->latency_probe) {
+        return;
+    }
+
+    assert(im->controller);
+
+    // Sent after the input event, so that the device acknowledges it once the
+    // event is injected
+    uint64_t sequence =
+        sc_latency_probe_push_input(im->latency_probe, sc_tick_now());
+
+    struct sc_control_msg msg;
+    msg.type = SC_CONTROL_MSG_TYPE_LATENCY_PROBE;
+    msg.latency_probe.sequence = sequence;
+
+    if (!sc_controller_push_msg(im->controller, &msg)) {
+        LOGW("Could not request 'latency probe'");
+        sc_latency_probe_cancel_input(im->latency_probe, sequence);
+    }
+}
+
 static void
 send_keycode(struct sc_input_manager *im, enum android_keycode keycode,
              enum sc_action action, const char *name) {
@@ -529,8 +554,15 @@ sc_input_manager_process_key(struct sc_input_manager *im,
                         action_home(im, action);
                     }
                     return;
-                case SDLK_B: // fall-through
                 case SDLK_BACKSPACE:
+                    if (shift) {
+                        if (!repeat && down) {
+                            sc_file_pusher_cancel(im->fp);
+                        }
+                        return;
+                    }
+                    // fall-through
+                case SDLK_B:
                     if (im->kp && !shift && !repeat && !paused) {
                         action_back(im, action);
                     }
@@ -696,6 +728,10 @@ sc_input_manager_process_key(struct sc_input_manager *im,
 
     assert(im->kp->ops->process_key);
     im->kp->ops->process_key(im->kp, &evt, ack_to_wait);
+
+    if (evt.action == SC_ACTION_DOWN && !evt.repeat) {
+        probe_latency(im);
+    }
 }
 
 static struct sc_position
@@ -785,6 +821,10 @@ sc_input_manager_process_touch(struct sc_input_manager *im,
     };
 
     im->mp->ops->process_touch(im->mp, &evt);
+
+    if (evt.action == SC_TOUCH_ACTION_DOWN) {
+        probe_latency(im);
+    }
 }
 
 static enum sc_mouse_binding
@@ -927,6 +967,10 @@ sc_input_manager_process_mouse_button(struct sc_input_manager *im,
     assert(im->mp->ops->process_mouse_click);
     im->mp->ops->process_mouse_click(im->mp, &evt);
 
+    if (down) {
+        probe_latency(im);
+    }
+
     if (im->mp->relative_mode) {
         assert(!im->vfinger_down); // vfinger must not be used in relative mode
         // No pinch-to-zoom simulation
@@ -19,6 +19,7 @@ struct sc_input_manager {
     struct sc_controller *controller;
     struct sc_file_pusher *fp;
     struct sc_screen *screen;
+    struct sc_latency_probe *latency_probe; // NULL if disabled
 
     struct sc_key_processor *kp;
     struct sc_mouse_processor *mp;
@@ -52,6 +53,7 @@ struct sc_input_manager_params {
     struct sc_controller *controller;
     struct sc_file_pusher *fp;
     struct sc_screen *screen;
+    struct sc_latency_probe *latency_probe;
     struct sc_key_processor *kp;
     struct sc_mouse_processor *mp;
     struct sc_gamepad_processor *gp;
@@ -0,0 +1,185 @@
+#include "late_latch.h"
+
+#include <assert.h>
+
+#include "frame_pacer.h"
+#include "util/log.h"
+
+#define SC_LATE_LATCH_INITIAL_MARGIN SC_TICK_FROM_MS(4)
+#define SC_LATE_LATCH_MIN_MARGIN SC_TICK_FROM_MS(1)
+// Increase the margin quickly on a missed vsync, decrease it slowly otherwise
+#define SC_LATE_LATCH_MARGIN_INC SC_TICK_FROM_MS(1)
+#define SC_LATE_LATCH_MARGIN_DEC SC_TICK_FROM_US(50)
+
+sc_tick
+sc_late_latch_adapt_margin(sc_tick margin, sc_tick target_vsync,
+                           sc_tick present_date, sc_tick refresh_interval) {
+    if (!refresh_interval) {
+        return margin;
+    }
+
+    // With vsync enabled, the present returns just after the vsync: if it
+    // returns significantly later, the targeted vsync has been missed
+    bool missed = present_date - target_vsync > refresh_interval / 2;
+    if (missed) {
+        margin += SC_LATE_LATCH_MARGIN_INC;
+        // Latching one refresh interval early is never useful
+        return MIN(margin, refresh_interval);
+    }
+
+    margin -= SC_LATE_LATCH_MARGIN_DEC;
+    return MAX(margin, SC_LATE_LATCH_MIN_MARGIN);
+}
+
+static int
+run_late_latch(void *data) {
+    struct sc_late_latch *latch = data;
+
+    sc_mutex_lock(&latch->mutex);
+
+    for (;;) {
+        while (!latch->interrupted && !latch->pending) {
+            sc_cond_wait(&latch->cond, &latch->mutex);
+        }
+
+        if (latch->interrupted) {
+            break;
+        }
+
+        // Wait until shortly before the next vsync, so that the newest frame
+        // is rendered (recompute the deadline on every wakeup)
+        sc_tick vsync = SC_TICK_NONE;
+        bool timed_out = false;
+        while (!latch->interrupted && !timed_out) {
+            sc_tick refresh_interval =
+                atomic_load_explicit(&latch->refresh_interval,
+                                     memory_order_relaxed);
+            sc_tick vsync_date =
+                atomic_load_explicit(&latch->last_present_date,
+                                     memory_order_relaxed);
+            if (!refresh_interval || !vsync_date) {
+                // The vsync is unknown, latch immediately
+                break;
+            }
+
+            sc_tick date = sc_tick_now() + latch->margin;
+            vsync = sc_frame_pacer_next_vsync(date, vsync_date,
+                                              refresh_interval);
+            sc_tick deadline = vsync - latch->margin;
+            timed_out =
+                !sc_cond_timedwait(&latch->cond, &latch->mutex, deadline);
+        }
+
+        if (latch->interrupted) {
+            break;
+        }
+
+        latch->pending = false;
+        latch->target_vsync = vsync;
+
+        sc_mutex_unlock(&latch->mutex);
+        latch->cbs->on_latch(latch, latch->cbs_userdata);
+        sc_mutex_lock(&latch->mutex);
+    }
+
+    sc_mutex_unlock(&latch->mutex);
+
+    LOGD("Late latch thread ended");
+
+    return 0;
+}
+
+bool
+sc_late_latch_start(struct sc_late_latch *latch,
+                    const struct sc_late_latch_callbacks *cbs,
+                    void *cbs_userdata) {
+    bool ok = sc_mutex_init(&latch->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&latch->cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    latch->interrupted = false;
+    latch->pending = false;
+    latch->target_vsync = SC_TICK_NONE;
+    latch->margin = SC_LATE_LATCH_INITIAL_MARGIN;
+    atomic_init(&latch->refresh_interval, 0);
+    atomic_init(&latch->last_present_date, 0);
+
+    assert(cbs && cbs->on_latch);
+    latch->cbs = cbs;
+    latch->cbs_userdata = cbs_userdata;
+
+    ok = sc_thread_create(&latch->thread, run_late_latch, "scrcpy-latch",
+                          latch);
+    if (!ok) {
+        LOGE("Could not start late latch thread");
+        goto error_destroy_cond;
+    }
+
+    return true;
+
+error_destroy_cond:
+    sc_cond_destroy(&latch->cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&latch->mutex);
+
+    return false;
+}
+
+void
+sc_late_latch_interrupt(struct sc_late_latch *latch) {
+    sc_mutex_lock(&latch->mutex);
+    latch->interrupted = true;
+    sc_cond_signal(&latch->cond);
+    sc_mutex_unlock(&latch->mutex);
+}
+
+void
+sc_late_latch_join(struct sc_late_latch *latch) {
+    sc_thread_join(&latch->thread, NULL);
+}
+
+void
+sc_late_latch_destroy(struct sc_late_latch *latch) {
+    sc_cond_destroy(&latch->cond);
+    sc_mutex_destroy(&latch->mutex);
+}
+
+void
+sc_late_latch_set_refresh_interval(struct sc_late_latch *latch,
+                                   sc_tick refresh_interval) {
+    atomic_store_explicit(&latch->refresh_interval, refresh_interval,
+                          memory_order_relaxed);
+}
+
+void
+sc_late_latch_notify_frame(struct sc_late_latch *latch) {
+    sc_mutex_lock(&latch->mutex);
+    assert(!latch->pending);
+    latch->pending = true;
+    sc_cond_signal(&latch->cond);
+    sc_mutex_unlock(&latch->mutex);
+}
+
+void
+sc_late_latch_on_present(struct sc_late_latch *latch, sc_tick date) {
+    atomic_store_explicit(&latch->last_present_date, date,
+                          memory_order_relaxed);
+
+    sc_mutex_lock(&latch->mutex);
+    if (latch->target_vsync != SC_TICK_NONE) {
+        sc_tick refresh_interval =
+            atomic_load_explicit(&latch->refresh_interval,
+                                 memory_order_relaxed);
+        latch->margin = sc_late_latch_adapt_margin(latch->margin,
+                                                   latch->target_vsync, date,
+                                                   refresh_interval);
+        latch->target_vsync = SC_TICK_NONE;
+    }
+    sc_mutex_unlock(&latch->mutex);
+}
@@ -0,0 +1,84 @@
+#ifndef SC_LATE_LATCH_H
+#define SC_LATE_LATCH_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Tool to latch the newest frame as late as possible before the next vsync
+ *
+ * Instead of rendering a new frame as soon as it is decoded (and blocking on
+ * vsync on present, while more recent frames may be decoded meanwhile), the
+ * frame is latched shortly before the next vsync: the frame buffer only keeps
+ * the last frame, so the newest one is rendered.
+ *
+ * The margin before the vsync adapts to the time needed to upload and render
+ * a frame: it increases when a vsync is missed, and slowly decreases
+ * otherwise.
+ */
+struct sc_late_latch {
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+
+    // The following fields are protected by the mutex
+    bool interrupted;
+    bool pending; // a new frame is waiting to be latched
+    sc_tick target_vsync; // SC_TICK_NONE if no latched frame is in flight
+    sc_tick margin;
+
+    // Written by the main thread (0 if unknown)
+    atomic_int_least64_t refresh_interval;
+    atomic_int_least64_t last_present_date;
+
+    const struct sc_late_latch_callbacks *cbs;
+    void *cbs_userdata;
+};
+
+struct sc_late_latch_callbacks {
+    // Called from the latch thread when the pending frame must be rendered
+    void (*on_latch)(struct sc_late_latch *latch, void *userdata);
+};
+
+bool
+sc_late_latch_start(struct sc_late_latch *latch,
+                    const struct sc_late_latch_callbacks *cbs,
+                    void *cbs_userdata);
+
+void
+sc_late_latch_interrupt(struct sc_late_latch *latch);
+
+void
+sc_late_latch_join(struct sc_late_latch *latch);
+
+void
+sc_late_latch_destroy(struct sc_late_latch *latch);
+
+// To be called by the main thread when the display refresh rate changes
+void
+sc_late_latch_set_refresh_interval(struct sc_late_latch *latch,
+                                   sc_tick refresh_interval);
+
+// To be called when a new frame is available (the latch is not already
+// pending)
+void
+sc_late_latch_notify_frame(struct sc_late_latch *latch);
+
+// To be called by the main thread after a latched frame has been presented
+void
+sc_late_latch_on_present(struct sc_late_latch *latch, sc_tick date);
+
+/**
+ * Return the new margin after a frame targeting target_vsync has been
+ * presented at present_date
+ */
+sc_tick
+sc_late_latch_adapt_margin(sc_tick margin, sc_tick target_vsync,
+                           sc_tick present_date, sc_tick refresh_interval);
+
+#endif
@@ -0,0 +1,270 @@
+#include "latency_probe.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+#include <libavutil/frame.h>
+
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_latency_probe */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_latency_probe, frame_sink)
+
+#define FNV1A_64_OFFSET_BASIS UINT64_C(0xcbf29ce484222325)
+#define FNV1A_64_PRIME UINT64_C(0x100000001b3)
+
+// Above this difference, the frame PTS and the injection timestamp are
+// considered not to share the same time base
+#define DEVICE_CLOCK_MAX_DIFF SC_TICK_FROM_SEC(10)
+
+static inline struct sc_latency_probe_event *
+get_event(struct sc_latency_probe *probe, unsigned i) {
+    assert(i < probe->count);
+    return &probe->events[(probe->head + i) % SC_LATENCY_PROBE_MAX_PENDING];
+}
+
+static void
+pop_event(struct sc_latency_probe *probe) {
+    assert(probe->count);
+    probe->head = (probe->head + 1) % SC_LATENCY_PROBE_MAX_PENDING;
+    --probe->count;
+}
+
+static bool
+is_captured_after_injection(const struct sc_latency_probe_event *event,
+                            int64_t pts) {
+    if (pts < 0) {
+        // Unknown, assume it is
+        return true;
+    }
+
+    int64_t diff = pts - (int64_t) event->inject_timestamp;
+    if (diff < -DEVICE_CLOCK_MAX_DIFF || diff > DEVICE_CLOCK_MAX_DIFF) {
+        // Not comparable
+        return true;
+    }
+
+    return diff >= 0;
+}
+
+static uint64_t
+hash_plane(uint64_t hash, const uint8_t *data, int linesize, int width,
+           int height) {
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *row = &data[(ptrdiff_t) y * linesize];
+        int x = 0;
+        for (; x + 8 <= width; x += 8) {
+            uint64_t word;
+            memcpy(&word, &row[x], sizeof(word));
+            hash = (hash ^ word) * FNV1A_64_PRIME;
+        }
+        for (; x < width; ++x) {
+            hash = (hash ^ row[x]) * FNV1A_64_PRIME;
+        }
+    }
+    return hash;
+}
+
+static uint64_t
+hash_frame(const AVFrame *frame) {
+    // The luma plane is sufficient to detect a content change
+    assert(frame->data[0]);
+    return hash_plane(FNV1A_64_OFFSET_BASIS, frame->data[0],
+                      frame->linesize[0], frame->width, frame->height);
+}
+
+static bool
+sc_latency_probe_frame_sink_open(struct sc_frame_sink *sink,
+                                 const AVCodecContext *ctx,
+                                 const struct sc_stream_session *session) {
+    (void) sink;
+    (void) ctx;
+    (void) session;
+    return true;
+}
+
+static void
+sc_latency_probe_frame_sink_close(struct sc_frame_sink *sink) {
+    (void) sink;
+}
+
+static bool
+sc_latency_probe_frame_sink_push(struct sc_frame_sink *sink,
+                                 const AVFrame *frame) {
+    struct sc_latency_probe *probe = DOWNCAST(sink);
+
+    sc_tick now = sc_tick_now();
+    uint64_t hash = hash_frame(frame);
+    int64_t pts = frame->pts != AV_NOPTS_VALUE ? frame->pts : -1;
+    sc_latency_probe_push_frame(probe, hash, pts, now);
+
+    return true;
+}
+
+bool
+sc_latency_probe_init(struct sc_latency_probe *probe) {
+    bool ok = sc_mutex_init(&probe->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    probe->head = 0;
+    probe->count = 0;
+    probe->next_sequence = 0;
+    probe->has_frame_hash = false;
+    probe->frame_hash = 0;
+    probe->lost = 0;
+
+    sc_histogram_init(&probe->ack_latency);
+    sc_histogram_init(&probe->device_latency);
+    sc_histogram_init(&probe->frame_latency);
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_latency_probe_frame_sink_open,
+        .close = sc_latency_probe_frame_sink_close,
+        .push = sc_latency_probe_frame_sink_push,
+    };
+
+    probe->frame_sink.ops = &ops;
+
+    return true;
+}
+
+void
+sc_latency_probe_destroy(struct sc_latency_probe *probe) {
+    sc_mutex_destroy(&probe->mutex);
+}
+
+uint64_t
+sc_latency_probe_push_input(struct sc_latency_probe *probe, sc_tick date) {
+    sc_mutex_lock(&probe->mutex);
+
+    if (probe->count == SC_LATENCY_PROBE_MAX_PENDING) {
+        // Forget the oldest event
+        pop_event(probe);
+        ++probe->lost;
+    }
+
+    uint64_t sequence = probe->next_sequence++;
+
+    ++probe->count;
+    struct sc_latency_probe_event *event = get_event(probe, probe->count - 1);
+    event->sequence = sequence;
+    event->input_date = date;
+    event->acked = false;
+    event->ack_date = 0;
+    event->inject_timestamp = 0;
+
+    sc_mutex_unlock(&probe->mutex);
+
+    return sequence;
+}
+
+void
+sc_latency_probe_cancel_input(struct sc_latency_probe *probe,
+                              uint64_t sequence) {
+    sc_mutex_lock(&probe->mutex);
+
+    if (probe->count) {
+        struct sc_latency_probe_event *last =
+            get_event(probe, probe->count - 1);
+        if (last->sequence == sequence) {
+            --probe->count;
+        }
+    }
+
+    sc_mutex_unlock(&probe->mutex);
+}
+
+void
+sc_latency_probe_ack(struct sc_latency_probe *probe, uint64_t sequence,
+                     uint64_t inject_timestamp, sc_tick date) {
+    sc_mutex_lock(&probe->mutex);
+
+    if (!probe->count) {
+        goto end;
+    }
+
+    // The sequences of the pending events are consecutive
+    uint64_t first = get_event(probe, 0)->sequence;
+    if (sequence < first || sequence - first >= probe->count) {
+        // Unknown or forgotten event
+        LOGD("Latency probe: unexpected ack sequence=%" PRIu64_, sequence);
+        goto end;
+    }
+
+    struct sc_latency_probe_event *event = get_event(probe, sequence - first);
+    if (event->acked) {
+        LOGD("Latency probe: duplicate ack sequence=%" PRIu64_, sequence);
+        goto end;
+    }
+
+    event->acked = true;
+    event->ack_date = date;
+    event->inject_timestamp = inject_timestamp;
+    sc_histogram_add(&probe->ack_latency, date - event->input_date);
+
+end:
+    sc_mutex_unlock(&probe->mutex);
+}
+
+void
+sc_latency_probe_push_frame(struct sc_latency_probe *probe,
+                            uint64_t content_hash, int64_t pts, sc_tick date) {
+    sc_mutex_lock(&probe->mutex);
+
+    bool changed = probe->has_frame_hash && content_hash != probe->frame_hash;
+    probe->has_frame_hash = true;
+    probe->frame_hash = content_hash;
+
+    // Forget the events having no visible effect
+    while (probe->count) {
+        struct sc_latency_probe_event *event = get_event(probe, 0);
+        if (date - event->input_date < SC_LATENCY_PROBE_TIMEOUT) {
+            break;
+        }
+        pop_event(probe);
+        ++probe->lost;
+    }
+
+    if (changed) {
+        // The acks are received in order, so the acknowledged events are at
+        // the beginning
+        while (probe->count) {
+            struct sc_latency_probe_event *event = get_event(probe, 0);
+            if (!event->acked || !is_captured_after_injection(event, pts)) {
+                break;
+            }
+
+            sc_histogram_add(&probe->frame_latency, date - event->input_date);
+            if (pts >= (int64_t) event->inject_timestamp) {
+                sc_tick device_latency = pts - event->inject_timestamp;
+                if (device_latency < DEVICE_CLOCK_MAX_DIFF) {
+                    sc_histogram_add(&probe->device_latency,
+                                     SC_TICK_FROM_US(device_latency));
+                }
+            }
+
+            pop_event(probe);
+        }
+    }
+
+    sc_mutex_unlock(&probe->mutex);
+}
+
+void
+sc_latency_probe_log_stats(struct sc_latency_probe *probe) {
+    sc_mutex_lock(&probe->mutex);
+
+    LOGI("Latency probe: %" PRIu64 " events measured, %" PRIu64 " lost",
+         probe->frame_latency.count, probe->lost);
+    sc_histogram_log(&probe->ack_latency, SC_LOG_LEVEL_INFO,
+                     "Input to injection ack");
+    sc_histogram_log(&probe->device_latency, SC_LOG_LEVEL_INFO,
+                     "Injection to capture (device)");
+    sc_histogram_log(&probe->frame_latency, SC_LOG_LEVEL_INFO,
+                     "Input to frame");
+
+    sc_mutex_unlock(&probe->mutex);
+}
@@ -0,0 +1,106 @@
+#ifndef SC_LATENCY_PROBE_H
+#define SC_LATENCY_PROBE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "trait/frame_sink.h"
+#include "util/histogram.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+// Maximum number of input events waiting for their result
+#define SC_LATENCY_PROBE_MAX_PENDING 64
+
+// An input event not reflected on screen after this delay is considered to
+// have no visible effect
+#define SC_LATENCY_PROBE_TIMEOUT SC_TICK_FROM_SEC(2)
+
+struct sc_latency_probe_event {
+    uint64_t sequence;
+    sc_tick input_date; // local clock
+    bool acked;
+    sc_tick ack_date; // local clock
+    uint64_t inject_timestamp; // device clock, in microseconds
+};
+
+/**
+ * Input-to-photon latency probe
+ *
+ * Each probed input event is followed by a LATENCY_PROBE control message
+ * carrying a sequence number. Once the previous events are injected, the
+ * device replies with the sequence and its current timestamp. The first
+ * subsequent frame whose content changed is considered to be the result of
+ * the events injected before.
+ *
+ * It is a frame sink, and the other functions may be called from any thread.
+ */
+struct sc_latency_probe {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    sc_mutex mutex;
+
+    // Events sent, waiting for their ack and for a frame change (a ring
+    // buffer, in sequence order)
+    struct sc_latency_probe_event events[SC_LATENCY_PROBE_MAX_PENDING];
+    unsigned head; // index of the oldest event
+    unsigned count;
+    uint64_t next_sequence;
+
+    bool has_frame_hash;
+    uint64_t frame_hash;
+
+    // From input to device injection ack (round-trip)
+    struct sc_histogram ack_latency;
+    // From device injection to frame capture (device clock)
+    struct sc_histogram device_latency;
+    // From input to the first frame with changed content
+    struct sc_histogram frame_latency;
+    // Events with no visible effect (or dropped)
+    uint64_t lost;
+};
+
+bool
+sc_latency_probe_init(struct sc_latency_probe *probe);
+
+void
+sc_latency_probe_destroy(struct sc_latency_probe *probe);
+
+/**
+ * Register an input event sent at the given date
+ *
+ * Return the sequence number to send in the LATENCY_PROBE control message.
+ */
+uint64_t
+sc_latency_probe_push_input(struct sc_latency_probe *probe, sc_tick date);
+
+/**
+ * Forget the last input event (if its LATENCY_PROBE message could not be sent)
+ */
+void
+sc_latency_probe_cancel_input(struct sc_latency_probe *probe,
+                              uint64_t sequence);
+
+/**
+ * Handle the acknowledgement of a LATENCY_PROBE message
+ */
+void
+sc_latency_probe_ack(struct sc_latency_probe *probe, uint64_t sequence,
+                     uint64_t inject_timestamp, sc_tick date);
+
+/**
+ * Handle a new frame
+ *
+ * The content_hash identifies the frame content, and pts is the frame
+ * timestamp on the device clock (in microseconds), or -1 if unknown.
+ */
+void
+sc_latency_probe_push_frame(struct sc_latency_probe *probe,
+                            uint64_t content_hash, int64_t pts, sc_tick date);
+
+void
+sc_latency_probe_log_stats(struct sc_latency_probe *probe);
+
+#endif
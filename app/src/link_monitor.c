@@ -0,0 +1,203 @@
+#include "link_monitor.h"
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include "util/log.h"
+
+#define SC_LINK_MONITOR_RETRY_DELAY_MIN SC_TICK_FROM_SEC(1)
+#define SC_LINK_MONITOR_RETRY_DELAY_MAX SC_TICK_FROM_SEC(16)
+
+bool
+sc_link_monitor_init(struct sc_link_monitor *monitor, sc_tick stall_timeout,
+                     const struct sc_link_monitor_callbacks *cbs,
+                     void *cbs_userdata) {
+    assert(stall_timeout > 0);
+    assert(cbs && cbs->on_stalled && cbs->on_retry);
+
+    bool ok = sc_mutex_init(&monitor->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&monitor->cond);
+    if (!ok) {
+        sc_mutex_destroy(&monitor->mutex);
+        return false;
+    }
+
+    monitor->stopped = false;
+    monitor->demuxer_count = 0;
+    monitor->stall_timeout = stall_timeout;
+    monitor->armed = false;
+    monitor->armed_date = 0;
+    monitor->retry_deadline = 0;
+    monitor->recovery_count = 0;
+    monitor->total_downtime = 0;
+    monitor->max_downtime = 0;
+
+    monitor->cbs = cbs;
+    monitor->cbs_userdata = cbs_userdata;
+
+    return true;
+}
+
+void
+sc_link_monitor_destroy(struct sc_link_monitor *monitor) {
+    sc_cond_destroy(&monitor->cond);
+    sc_mutex_destroy(&monitor->mutex);
+}
+
+void
+sc_link_monitor_add_demuxer(struct sc_link_monitor *monitor,
+                            struct sc_demuxer *demuxer) {
+    assert(monitor->demuxer_count < SC_LINK_MONITOR_MAX_DEMUXERS);
+    monitor->demuxers[monitor->demuxer_count++] = demuxer;
+}
+
+static sc_tick
+sc_link_monitor_get_last_progress_date(struct sc_link_monitor *monitor) {
+    sc_mutex_assert(&monitor->mutex);
+
+    sc_tick date = monitor->armed_date;
+    for (unsigned i = 0; i < monitor->demuxer_count; ++i) {
+        sc_tick progress_date =
+            sc_demuxer_get_last_progress_date(monitor->demuxers[i]);
+        date = MAX(date, progress_date);
+    }
+
+    return date;
+}
+
+static int
+run_link_monitor(void *data) {
+    struct sc_link_monitor *monitor = data;
+
+    // Check several times per stall_timeout, for accuracy
+    sc_tick period = monitor->stall_timeout / 4;
+
+    sc_mutex_lock(&monitor->mutex);
+    while (!monitor->stopped) {
+        sc_tick now = sc_tick_now();
+        sc_tick deadline = now + period;
+        if (monitor->retry_deadline && monitor->retry_deadline < deadline) {
+            deadline = monitor->retry_deadline;
+        }
+
+        sc_cond_timedwait(&monitor->cond, &monitor->mutex, deadline);
+        if (monitor->stopped) {
+            break;
+        }
+
+        now = sc_tick_now();
+
+        if (monitor->retry_deadline && now >= monitor->retry_deadline) {
+            monitor->retry_deadline = 0;
+            sc_mutex_unlock(&monitor->mutex);
+            monitor->cbs->on_retry(monitor, monitor->cbs_userdata);
+            sc_mutex_lock(&monitor->mutex);
+            continue;
+        }
+
+        if (monitor->armed) {
+            sc_tick elapsed =
+                now - sc_link_monitor_get_last_progress_date(monitor);
+            if (elapsed >= monitor->stall_timeout) {
+                // Report a stall only once
+                monitor->armed = false;
+                sc_mutex_unlock(&monitor->mutex);
+                monitor->cbs->on_stalled(monitor, elapsed,
+                                         monitor->cbs_userdata);
+                sc_mutex_lock(&monitor->mutex);
+            }
+        }
+    }
+    sc_mutex_unlock(&monitor->mutex);
+
+    return 0;
+}
+
+bool
+sc_link_monitor_start(struct sc_link_monitor *monitor) {
+    LOGD("Starting link monitor thread");
+
+    bool ok = sc_thread_create(&monitor->thread, run_link_monitor,
+                               "scrcpy-link", monitor);
+    if (!ok) {
+        LOGE("Could not start link monitor thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_link_monitor_stop(struct sc_link_monitor *monitor) {
+    sc_mutex_lock(&monitor->mutex);
+    monitor->stopped = true;
+    sc_cond_signal(&monitor->cond);
+    sc_mutex_unlock(&monitor->mutex);
+}
+
+void
+sc_link_monitor_join(struct sc_link_monitor *monitor) {
+    sc_thread_join(&monitor->thread, NULL);
+}
+
+void
+sc_link_monitor_arm(struct sc_link_monitor *monitor) {
+    sc_mutex_lock(&monitor->mutex);
+    monitor->armed = true;
+    monitor->armed_date = sc_tick_now();
+    sc_mutex_unlock(&monitor->mutex);
+}
+
+void
+sc_link_monitor_disarm(struct sc_link_monitor *monitor) {
+    sc_mutex_lock(&monitor->mutex);
+    monitor->armed = false;
+    sc_mutex_unlock(&monitor->mutex);
+}
+
+void
+sc_link_monitor_schedule_retry(struct sc_link_monitor *monitor,
+                               sc_tick deadline) {
+    assert(deadline);
+
+    sc_mutex_lock(&monitor->mutex);
+    monitor->retry_deadline = deadline;
+    sc_cond_signal(&monitor->cond);
+    sc_mutex_unlock(&monitor->mutex);
+}
+
+sc_tick
+sc_link_monitor_get_retry_delay(unsigned attempt) {
+    sc_tick delay = SC_LINK_MONITOR_RETRY_DELAY_MIN;
+    while (attempt-- && delay < SC_LINK_MONITOR_RETRY_DELAY_MAX) {
+        delay *= 2;
+    }
+
+    return MIN(delay, SC_LINK_MONITOR_RETRY_DELAY_MAX);
+}
+
+void
+sc_link_monitor_record_recovery(struct sc_link_monitor *monitor,
+                                sc_tick downtime) {
+    ++monitor->recovery_count;
+    monitor->total_downtime += downtime;
+    monitor->max_downtime = MAX(monitor->max_downtime, downtime);
+
+    LOGI("Connection recovered in %" PRItick " ms", downtime / 1000);
+}
+
+void
+sc_link_monitor_log_stats(struct sc_link_monitor *monitor) {
+    if (!monitor->recovery_count) {
+        return;
+    }
+
+    LOGI("Connection recovered %u time(s): %" PRItick " ms on average, %"
+         PRItick " ms max", monitor->recovery_count,
+         monitor->total_downtime / monitor->recovery_count / 1000,
+         monitor->max_downtime / 1000);
+}
@@ -0,0 +1,108 @@
+#ifndef SC_LINK_MONITOR_H
+#define SC_LINK_MONITOR_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "demuxer.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define SC_LINK_MONITOR_MAX_DEMUXERS 2
+
+/**
+ * Monitor the health of the connection with the device
+ *
+ * The streams are the heartbeat: the device produces video packets even if
+ * the content does not change (the encoder repeats the previous frame), and
+ * audio packets even on silence. If none of the monitored demuxers advances
+ * its PTS for a given duration while the monitor is armed, the connection is
+ * considered stalled.
+ *
+ * The monitor also schedules the reconnection attempts, with an exponential
+ * backoff.
+ */
+struct sc_link_monitor {
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+
+    struct sc_demuxer *demuxers[SC_LINK_MONITOR_MAX_DEMUXERS];
+    unsigned demuxer_count;
+
+    sc_tick stall_timeout;
+
+    bool armed;
+    sc_tick armed_date;
+
+    sc_tick retry_deadline; // 0 if no retry is scheduled
+
+    // Recovery statistics (only accessed from the main thread)
+    unsigned recovery_count;
+    sc_tick total_downtime;
+    sc_tick max_downtime;
+
+    const struct sc_link_monitor_callbacks *cbs;
+    void *cbs_userdata;
+};
+
+struct sc_link_monitor_callbacks {
+    // Called (once per arming) when no progress has been made for
+    // stall_timeout
+    void (*on_stalled)(struct sc_link_monitor *monitor, sc_tick elapsed,
+                       void *userdata);
+
+    // Called when the deadline of sc_link_monitor_schedule_retry() is reached
+    void (*on_retry)(struct sc_link_monitor *monitor, void *userdata);
+};
+
+bool
+sc_link_monitor_init(struct sc_link_monitor *monitor, sc_tick stall_timeout,
+                     const struct sc_link_monitor_callbacks *cbs,
+                     void *cbs_userdata);
+
+void
+sc_link_monitor_destroy(struct sc_link_monitor *monitor);
+
+// Must be called before sc_link_monitor_start()
+void
+sc_link_monitor_add_demuxer(struct sc_link_monitor *monitor,
+                            struct sc_demuxer *demuxer);
+
+bool
+sc_link_monitor_start(struct sc_link_monitor *monitor);
+
+void
+sc_link_monitor_stop(struct sc_link_monitor *monitor);
+
+void
+sc_link_monitor_join(struct sc_link_monitor *monitor);
+
+// Start (or restart) the stall detection, from now
+void
+sc_link_monitor_arm(struct sc_link_monitor *monitor);
+
+void
+sc_link_monitor_disarm(struct sc_link_monitor *monitor);
+
+void
+sc_link_monitor_schedule_retry(struct sc_link_monitor *monitor,
+                               sc_tick deadline);
+
+/**
+ * Return the delay before the reconnection attempt (attempt starts at 0)
+ */
+sc_tick
+sc_link_monitor_get_retry_delay(unsigned attempt);
+
+// Record a successful recovery (to be called from the main thread)
+void
+sc_link_monitor_record_recovery(struct sc_link_monitor *monitor,
+                                sc_tick downtime);
+
+void
+sc_link_monitor_log_stats(struct sc_link_monitor *monitor);
+
+#endif
@@ -10,12 +10,15 @@
 #include "cli.h"
 #include "options.h"
 #include "scrcpy.h"
+#include "scrcpy_multi.h"
 #ifdef HAVE_USB
 # include "usb/scrcpy_otg.h"
 #endif
 #include "util/log.h"
+#include "util/log_async.h"
 #include "util/net.h"
 #include "util/thread.h"
+#include "util/trace.h"
 #include "version.h"
 
 #ifdef _WIN32
@@ -47,6 +50,8 @@ main_scrcpy(int argc, char *argv[]) {
 #endif
 
     enum scrcpy_exit_code ret;
+    bool async_log = false;
+    bool trace = false;
 
     if (!scrcpy_parse_args(&args, argc, argv)) {
         ret = SCRCPY_EXIT_FAILURE;
@@ -70,6 +75,15 @@ main_scrcpy(int argc, char *argv[]) {
     // The current thread is the main thread
     SC_MAIN_THREAD_ID = sc_thread_get_id();
 
+    // Must be set before any other thread is started. The role of the main
+    // thread is applied once SDL is initialized, so that the threads created
+    // by SDL do not inherit its CPU affinity.
+    struct sc_thread_policy thread_policy = {
+        .sched = args.opts.thread_sched,
+        .cpu_affinity = args.opts.cpu_affinity,
+    };
+    sc_thread_set_policy(&thread_policy);
+
 #ifdef SCRCPY_LAVF_REQUIRES_REGISTER_ALL
     av_register_all();
 #endif
@@ -87,13 +101,40 @@ main_scrcpy(int argc, char *argv[]) {
 
     sc_log_configure();
 
+    if (args.opts.async_log) {
+        async_log = sc_log_async_start();
+        if (!async_log) {
+            LOGW("Could not enable asynchronous logs");
+        }
+    }
+
+    if (args.opts.trace_file) {
+        trace = sc_trace_start(args.opts.trace_file);
+        if (!trace) {
+            ret = SCRCPY_EXIT_FAILURE;
+            goto end;
+        }
+    }
+
 #ifdef HAVE_USB
-    ret = args.opts.otg ? scrcpy_otg(&args.opts) : scrcpy(&args.opts);
-#else
-    ret = scrcpy(&args.opts);
+    if (args.opts.otg) {
+        ret = scrcpy_otg(&args.opts);
+        goto end;
+    }
 #endif
 
+    ret = args.opts.serials ? scrcpy_multi(&args.opts) : scrcpy(&args.opts);
+
 end:
+    if (trace) {
+        // All the other threads have been joined
+        sc_trace_stop();
+    }
+
+    if (async_log) {
+        sc_log_async_stop();
+    }
+
     if (args.pause_on_exit == SC_PAUSE_ON_EXIT_TRUE ||
             (args.pause_on_exit == SC_PAUSE_ON_EXIT_IF_ERROR &&
                 ret != SCRCPY_EXIT_SUCCESS)) {
@@ -0,0 +1,364 @@
+#include "metrics.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "util/log.h"
+
+#define SC_METRICS_AGGREGATION_PERIOD SC_TICK_FROM_SEC(1)
+
+#define DOWNCAST(SINK) container_of(SINK, struct sc_stream_metrics, packet_sink)
+
+static bool
+sc_stream_metrics_packet_sink_open(struct sc_packet_sink *sink,
+                                   AVCodecContext *ctx,
+                                   const struct sc_stream_session *session) {
+    (void) sink;
+    (void) ctx;
+    (void) session;
+    return true;
+}
+
+static void
+sc_stream_metrics_packet_sink_close(struct sc_packet_sink *sink) {
+    (void) sink;
+}
+
+static bool
+sc_stream_metrics_packet_sink_push(struct sc_packet_sink *sink,
+                                   const AVPacket *packet) {
+    struct sc_stream_metrics *sm = DOWNCAST(sink);
+
+    sc_metrics_counter_add(&sm->packets, 1);
+    sc_metrics_counter_add(&sm->bytes, packet->size);
+    atomic_store_explicit(&sm->last_packet_date, sc_tick_now(),
+                          memory_order_relaxed);
+
+    uint32_t size = packet->size;
+    uint32_t max = atomic_load_explicit(&sm->max_packet_size,
+                                        memory_order_relaxed);
+    while (size > max
+            && !atomic_compare_exchange_weak_explicit(&sm->max_packet_size,
+                                                      &max, size,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+        // max has been updated, retry
+    }
+
+    bool is_config = packet->pts == AV_NOPTS_VALUE;
+    if (!is_config && packet->flags & AV_PKT_FLAG_KEY) {
+        sc_metrics_counter_add(&sm->key_frames, 1);
+        if (sm->last_key_frame_pts != AV_NOPTS_VALUE) {
+            int64_t interval = packet->pts - sm->last_key_frame_pts;
+            atomic_store_explicit(&sm->key_frame_interval, interval,
+                                  memory_order_relaxed);
+        }
+        sm->last_key_frame_pts = packet->pts;
+    }
+
+    return true;
+}
+
+static void
+sc_stream_metrics_init(struct sc_stream_metrics *sm, const char *name,
+                       bool enabled) {
+    sm->name = name;
+    sm->enabled = enabled;
+
+    atomic_init(&sm->packets, 0);
+    atomic_init(&sm->bytes, 0);
+    atomic_init(&sm->key_frames, 0);
+    atomic_init(&sm->key_frame_interval, 0);
+    atomic_init(&sm->last_packet_date, 0);
+    atomic_init(&sm->max_packet_size, 0);
+    atomic_init(&sm->decoded_frames, 0);
+    atomic_init(&sm->decode_time, 0);
+
+    sm->last_key_frame_pts = AV_NOPTS_VALUE;
+
+    static const struct sc_packet_sink_ops ops = {
+        .open = sc_stream_metrics_packet_sink_open,
+        .close = sc_stream_metrics_packet_sink_close,
+        .push = sc_stream_metrics_packet_sink_push,
+    };
+
+    sm->packet_sink.ops = &ops;
+}
+
+bool
+sc_metrics_init(struct sc_metrics *metrics, bool video, bool audio) {
+    bool ok = sc_mutex_init(&metrics->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&metrics->cond);
+    if (!ok) {
+        sc_mutex_destroy(&metrics->mutex);
+        return false;
+    }
+
+    sc_stream_metrics_init(&metrics->video, "video", video);
+    sc_stream_metrics_init(&metrics->audio, "audio", audio);
+
+    atomic_init(&metrics->rendered_frames, 0);
+    atomic_init(&metrics->render_time, 0);
+    atomic_init(&metrics->frame_age, 0);
+    atomic_init(&metrics->skipped_frames, 0);
+    atomic_init(&metrics->audio_underflows, 0);
+    atomic_init(&metrics->audio_underflow_samples, 0);
+
+    metrics->stopped = false;
+    metrics->video_rates = (struct sc_stream_metrics_rates) {0};
+    metrics->audio_rates = (struct sc_stream_metrics_rates) {0};
+
+    metrics->last_aggregation_date = sc_tick_now();
+    metrics->last_video_packets = 0;
+    metrics->last_video_bytes = 0;
+    metrics->last_audio_packets = 0;
+    metrics->last_audio_bytes = 0;
+
+    return true;
+}
+
+void
+sc_metrics_destroy(struct sc_metrics *metrics) {
+    sc_cond_destroy(&metrics->cond);
+    sc_mutex_destroy(&metrics->mutex);
+}
+
+static void
+sc_stream_metrics_aggregate(struct sc_stream_metrics *sm, sc_tick duration,
+                            uint64_t *last_packets, uint64_t *last_bytes,
+                            struct sc_stream_metrics_rates *rates) {
+    uint64_t packets = atomic_load_explicit(&sm->packets,
+                                            memory_order_relaxed);
+    uint64_t bytes = atomic_load_explicit(&sm->bytes, memory_order_relaxed);
+
+    rates->packets_per_second =
+        (double) (packets - *last_packets) * SC_TICK_FREQ / duration;
+    rates->bytes_per_second =
+        (double) (bytes - *last_bytes) * SC_TICK_FREQ / duration;
+    rates->max_packet_size = atomic_exchange_explicit(&sm->max_packet_size, 0,
+                                                      memory_order_relaxed);
+
+    *last_packets = packets;
+    *last_bytes = bytes;
+}
+
+void
+sc_metrics_aggregate(struct sc_metrics *metrics, sc_tick now) {
+    sc_tick duration = now - metrics->last_aggregation_date;
+    if (duration <= 0) {
+        return;
+    }
+
+    struct sc_stream_metrics_rates video_rates;
+    struct sc_stream_metrics_rates audio_rates;
+    sc_stream_metrics_aggregate(&metrics->video, duration,
+                                &metrics->last_video_packets,
+                                &metrics->last_video_bytes, &video_rates);
+    sc_stream_metrics_aggregate(&metrics->audio, duration,
+                                &metrics->last_audio_packets,
+                                &metrics->last_audio_bytes, &audio_rates);
+    metrics->last_aggregation_date = now;
+
+    sc_mutex_lock(&metrics->mutex);
+    metrics->video_rates = video_rates;
+    metrics->audio_rates = audio_rates;
+    sc_mutex_unlock(&metrics->mutex);
+}
+
+static int
+run_metrics(void *data) {
+    struct sc_metrics *metrics = data;
+
+    sc_tick deadline = sc_tick_now() + SC_METRICS_AGGREGATION_PERIOD;
+
+    sc_mutex_lock(&metrics->mutex);
+    while (!metrics->stopped) {
+        bool timed_out = !sc_cond_timedwait(&metrics->cond, &metrics->mutex,
+                                            deadline);
+        if (metrics->stopped) {
+            break;
+        }
+
+        if (timed_out) {
+            sc_mutex_unlock(&metrics->mutex);
+            sc_tick now = sc_tick_now();
+            sc_metrics_aggregate(metrics, now);
+            sc_mutex_lock(&metrics->mutex);
+            deadline = now + SC_METRICS_AGGREGATION_PERIOD;
+        }
+    }
+    sc_mutex_unlock(&metrics->mutex);
+
+    return 0;
+}
+
+bool
+sc_metrics_start(struct sc_metrics *metrics) {
+    LOGD("Starting metrics thread");
+
+    metrics->last_aggregation_date = sc_tick_now();
+
+    bool ok = sc_thread_create(&metrics->thread, run_metrics, "scrcpy-metrics",
+                               metrics);
+    if (!ok) {
+        LOGE("Could not start metrics thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_metrics_stop(struct sc_metrics *metrics) {
+    sc_mutex_lock(&metrics->mutex);
+    metrics->stopped = true;
+    sc_cond_signal(&metrics->cond);
+    sc_mutex_unlock(&metrics->mutex);
+}
+
+void
+sc_metrics_join(struct sc_metrics *metrics) {
+    sc_thread_join(&metrics->thread, NULL);
+}
+
+static bool
+sc_metrics_append(struct sc_strbuf *buf, const char *fmt, ...) {
+    char line[256];
+
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+
+    if (len < 0 || (size_t) len >= sizeof(line)) {
+        // should never happen, the lines are short
+        assert(!"metrics line too long");
+        return false;
+    }
+
+    return sc_strbuf_append(buf, line, len);
+}
+
+static bool
+sc_metrics_append_header(struct sc_strbuf *buf, const char *name,
+                         const char *type, const char *help) {
+    return sc_metrics_append(buf, "# HELP %s %s\n# TYPE %s %s\n", name, help,
+                             name, type);
+}
+
+#define LOAD(X) atomic_load_explicit(X, memory_order_relaxed)
+
+bool
+sc_metrics_format(struct sc_metrics *metrics, struct sc_strbuf *buf) {
+    sc_mutex_lock(&metrics->mutex);
+    struct sc_stream_metrics_rates video_rates = metrics->video_rates;
+    struct sc_stream_metrics_rates audio_rates = metrics->audio_rates;
+    sc_mutex_unlock(&metrics->mutex);
+
+    struct {
+        struct sc_stream_metrics *sm;
+        const struct sc_stream_metrics_rates *rates;
+    } streams[] = {
+        {&metrics->video, &video_rates},
+        {&metrics->audio, &audio_rates},
+    };
+
+    sc_tick now = sc_tick_now();
+
+    // A stream metric: one line per enabled stream
+#define STREAM_METRIC(NAME, TYPE, HELP, FMT, EXPR) \
+    do { \
+        if (!sc_metrics_append_header(buf, NAME, TYPE, HELP)) { \
+            return false; \
+        } \
+        for (size_t i = 0; i < ARRAY_LEN(streams); ++i) { \
+            struct sc_stream_metrics *sm = streams[i].sm; \
+            const struct sc_stream_metrics_rates *rates = streams[i].rates; \
+            (void) rates; \
+            if (sm->enabled && !sc_metrics_append(buf, \
+                    NAME "{stream=\"%s\"} " FMT "\n", sm->name, EXPR)) { \
+                return false; \
+            } \
+        } \
+    } while (0)
+
+    // A global metric
+#define METRIC(NAME, TYPE, HELP, FMT, EXPR) \
+    do { \
+        if (!sc_metrics_append_header(buf, NAME, TYPE, HELP) \
+                || !sc_metrics_append(buf, NAME " " FMT "\n", EXPR)) { \
+            return false; \
+        } \
+    } while (0)
+
+    STREAM_METRIC("scrcpy_stream_packets_total", "counter",
+                  "Packets received from the device.",
+                  "%" PRIu64, (uint64_t) LOAD(&sm->packets));
+    STREAM_METRIC("scrcpy_stream_bytes_total", "counter",
+                  "Bytes of packets received from the device.",
+                  "%" PRIu64, (uint64_t) LOAD(&sm->bytes));
+    STREAM_METRIC("scrcpy_stream_packets_per_second", "gauge",
+                  "Packets received during the last second.",
+                  "%.1f", rates->packets_per_second);
+    STREAM_METRIC("scrcpy_stream_bytes_per_second", "gauge",
+                  "Bytes received during the last second.",
+                  "%.1f", rates->bytes_per_second);
+    STREAM_METRIC("scrcpy_stream_max_packet_size_bytes", "gauge",
+                  "Largest packet received during the last second.",
+                  "%" PRIu32, rates->max_packet_size);
+    STREAM_METRIC("scrcpy_stream_key_frames_total", "counter",
+                  "Key frames received from the device.",
+                  "%" PRIu64, (uint64_t) LOAD(&sm->key_frames));
+    STREAM_METRIC("scrcpy_stream_key_frame_interval_seconds", "gauge",
+                  "Interval between the last two key frames.",
+                  "%.3f", (double) LOAD(&sm->key_frame_interval) / 1000000);
+    STREAM_METRIC("scrcpy_stream_last_packet_age_seconds", "gauge",
+                  "Time elapsed since the last packet (-1 if none).",
+                  "%.3f", LOAD(&sm->last_packet_date)
+                      ? (double) (now - LOAD(&sm->last_packet_date))
+                          / SC_TICK_FREQ
+                      : -1.0);
+    STREAM_METRIC("scrcpy_decoded_frames_total", "counter",
+                  "Frames decoded.",
+                  "%" PRIu64, (uint64_t) LOAD(&sm->decoded_frames));
+    STREAM_METRIC("scrcpy_decode_seconds_total", "counter",
+                  "Time spent in the decoder.",
+                  "%.6f", (double) LOAD(&sm->decode_time) / SC_TICK_FREQ);
+
+    if (metrics->video.enabled) {
+        METRIC("scrcpy_rendered_frames_total", "counter",
+               "Video frames rendered.",
+               "%" PRIu64, (uint64_t) LOAD(&metrics->rendered_frames));
+        METRIC("scrcpy_render_seconds_total", "counter",
+               "Time spent rendering the video frames.",
+               "%.6f", (double) LOAD(&metrics->render_time) / SC_TICK_FREQ);
+        METRIC("scrcpy_frame_age_seconds_total", "counter",
+               "Sum of the ages of the video frames when presented (since "
+               "they were decoded).",
+               "%.6f", (double) LOAD(&metrics->frame_age) / SC_TICK_FREQ);
+        METRIC("scrcpy_skipped_frames_total", "counter",
+               "Video frames decoded but never rendered.",
+               "%" PRIu64, (uint64_t) LOAD(&metrics->skipped_frames));
+    }
+
+    if (metrics->audio.enabled) {
+        METRIC("scrcpy_audio_underflows_total", "counter",
+               "Audio output buffer underflows.",
+               "%" PRIu64, (uint64_t) LOAD(&metrics->audio_underflows));
+        METRIC("scrcpy_audio_underflow_samples_total", "counter",
+               "Silent samples inserted on audio buffer underflow.",
+               "%" PRIu64,
+               (uint64_t) LOAD(&metrics->audio_underflow_samples));
+    }
+
+#undef METRIC
+#undef STREAM_METRIC
+
+    return true;
+}
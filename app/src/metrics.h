@@ -0,0 +1,155 @@
+#ifndef SC_METRICS_H
+#define SC_METRICS_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "trait/packet_sink.h"
+#include "util/strbuf.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Per-stream counters, fed by the demuxer (as a packet sink) and the decoder
+ *
+ * Each counter is written by a single thread (the demuxer thread of the
+ * stream), so it is updated by a relaxed load and store rather than an atomic
+ * read-modify-write. They are read concurrently by the aggregation thread and
+ * the metrics server.
+ */
+struct sc_stream_metrics {
+    struct sc_packet_sink packet_sink; // packet sink trait
+
+    const char *name; // must be statically allocated (e.g. a string literal)
+    bool enabled;
+
+    atomic_uint_least64_t packets;
+    atomic_uint_least64_t bytes;
+    atomic_uint_least64_t key_frames;
+    atomic_int_least64_t key_frame_interval; // in microseconds (PTS clock)
+    atomic_int_least64_t last_packet_date; // 0 if no packet yet
+    // Maximum packet size since the last aggregation (also reset by the
+    // aggregation thread, so it requires a compare-and-swap)
+    atomic_uint_least32_t max_packet_size;
+
+    atomic_uint_least64_t decoded_frames;
+    atomic_uint_least64_t decode_time; // in ticks
+
+    int64_t last_key_frame_pts; // only accessed by the demuxer thread
+};
+
+// Values computed by the aggregation thread for the last period
+struct sc_stream_metrics_rates {
+    double bytes_per_second;
+    double packets_per_second;
+    uint32_t max_packet_size;
+};
+
+/**
+ * Telemetry of a session, exported in Prometheus text format
+ *
+ * The counters are updated on the hot paths with negligible overhead (no
+ * lock, no atomic read-modify-write). A separate thread aggregates them
+ * periodically to compute the rates.
+ */
+struct sc_metrics {
+    struct sc_stream_metrics video;
+    struct sc_stream_metrics audio;
+
+    // Written only by the main thread
+    atomic_uint_least64_t rendered_frames;
+    atomic_uint_least64_t render_time; // in ticks
+    // Sum of the ages of the frames when presented (since they were decoded)
+    atomic_uint_least64_t frame_age; // in ticks
+    // Written only by the video decoder thread (via the screen frame sink)
+    atomic_uint_least64_t skipped_frames;
+    // Written only by the audio output thread
+    atomic_uint_least64_t audio_underflows;
+    atomic_uint_least64_t audio_underflow_samples;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+
+    // Protected by the mutex
+    struct sc_stream_metrics_rates video_rates;
+    struct sc_stream_metrics_rates audio_rates;
+
+    // Only accessed by the aggregation thread
+    sc_tick last_aggregation_date;
+    uint64_t last_video_packets;
+    uint64_t last_video_bytes;
+    uint64_t last_audio_packets;
+    uint64_t last_audio_bytes;
+};
+
+bool
+sc_metrics_init(struct sc_metrics *metrics, bool video, bool audio);
+
+void
+sc_metrics_destroy(struct sc_metrics *metrics);
+
+bool
+sc_metrics_start(struct sc_metrics *metrics);
+
+void
+sc_metrics_stop(struct sc_metrics *metrics);
+
+void
+sc_metrics_join(struct sc_metrics *metrics);
+
+/**
+ * Compute the rates since the previous aggregation
+ *
+ * This is called periodically by the aggregation thread.
+ */
+void
+sc_metrics_aggregate(struct sc_metrics *metrics, sc_tick now);
+
+/**
+ * Append the metrics in Prometheus text exposition format
+ */
+bool
+sc_metrics_format(struct sc_metrics *metrics, struct sc_strbuf *buf);
+
+// Add a value to a counter written by a single thread
+static inline void
+sc_metrics_counter_add(atomic_uint_least64_t *counter, uint64_t value) {
+    uint64_t v = atomic_load_explicit(counter, memory_order_relaxed);
+    atomic_store_explicit(counter, v + value, memory_order_relaxed);
+}
+
+// To be called by the decoder thread for each decoded frame
+static inline void
+sc_stream_metrics_add_decoded_frame(struct sc_stream_metrics *sm,
+                                    sc_tick decode_time) {
+    sc_metrics_counter_add(&sm->decoded_frames, 1);
+    sc_metrics_counter_add(&sm->decode_time, decode_time);
+}
+
+// To be called by the main thread for each rendered frame
+static inline void
+sc_metrics_add_rendered_frame(struct sc_metrics *metrics,
+                              sc_tick render_time, sc_tick frame_age) {
+    sc_metrics_counter_add(&metrics->rendered_frames, 1);
+    sc_metrics_counter_add(&metrics->render_time, render_time);
+    sc_metrics_counter_add(&metrics->frame_age, frame_age);
+}
+
+static inline void
+sc_metrics_add_skipped_frame(struct sc_metrics *metrics) {
+    sc_metrics_counter_add(&metrics->skipped_frames, 1);
+}
+
+// To be called by the audio output thread on buffer underflow
+static inline void
+sc_metrics_add_audio_underflow(struct sc_metrics *metrics, uint32_t samples) {
+    sc_metrics_counter_add(&metrics->audio_underflows, 1);
+    sc_metrics_counter_add(&metrics->audio_underflow_samples, samples);
+}
+
+#endif
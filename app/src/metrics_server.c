@@ -0,0 +1,212 @@
+#include "metrics_server.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/log.h"
+#include "util/strbuf.h"
+
+#define SC_METRICS_SERVER_REQUEST_MAX_SIZE 1024
+
+static const char *
+sc_metrics_server_read_request_path(sc_socket socket, char *buf, size_t size) {
+    // Read until the end of the headers (the request has no body)
+    size_t len = 0;
+    for (;;) {
+        if (len == size - 1) {
+            LOGW("Metrics: request too large");
+            return NULL;
+        }
+
+        ssize_t r = net_recv(socket, buf + len, size - 1 - len);
+        if (r <= 0) {
+            return NULL;
+        }
+        len += r;
+        buf[len] = '\0';
+
+        if (strstr(buf, "\r\n\r\n") || strstr(buf, "\n\n")) {
+            break;
+        }
+    }
+
+    // Request line: "GET /metrics HTTP/1.1"
+    if (strncmp(buf, "GET ", 4)) {
+        return "";
+    }
+
+    char *path = buf + 4;
+    char *end = strpbrk(path, " \r\n");
+    if (!end) {
+        return "";
+    }
+    *end = '\0';
+
+    return path;
+}
+
+static bool
+sc_metrics_server_send_response(sc_socket socket, const char *status,
+                                const char *content, size_t len) {
+    char header[256];
+    int r = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %s\r\n"
+                     "Content-Type: text/plain; version=0.0.4; "
+                     "charset=utf-8\r\n"
+                     "Content-Length: %" SC_PRIsizet "\r\n"
+                     "Connection: close\r\n"
+                     "\r\n", status, len);
+    assert(r > 0 && (size_t) r < sizeof(header));
+
+    if (net_send_all(socket, header, r) != r) {
+        return false;
+    }
+
+    return net_send_all(socket, content, len) == (ssize_t) len;
+}
+
+static void
+sc_metrics_server_handle(struct sc_metrics_server *ms, sc_socket socket) {
+    char request[SC_METRICS_SERVER_REQUEST_MAX_SIZE];
+    const char *path =
+        sc_metrics_server_read_request_path(socket, request, sizeof(request));
+    if (!path) {
+        return;
+    }
+
+    if (strcmp(path, "/metrics") && strcmp(path, "/")) {
+        static const char not_found[] = "Not found\n";
+        sc_metrics_server_send_response(socket, "404 Not Found", not_found,
+                                        sizeof(not_found) - 1);
+        return;
+    }
+
+    struct sc_strbuf buf;
+    if (!sc_strbuf_init(&buf, 4096)) {
+        LOG_OOM();
+        return;
+    }
+
+    if (!sc_metrics_format(ms->metrics, &buf)) {
+        LOG_OOM();
+        free(buf.s);
+        return;
+    }
+
+    sc_metrics_server_send_response(socket, "200 OK", buf.s, buf.len);
+    free(buf.s);
+}
+
+static int
+run_metrics_server(void *data) {
+    struct sc_metrics_server *ms = data;
+
+    for (;;) {
+        sc_socket socket = net_accept(ms->server_socket);
+        if (socket == SC_SOCKET_NONE) {
+            // interrupted (or failed)
+            break;
+        }
+
+        sc_mutex_lock(&ms->mutex);
+        bool stopped = ms->stopped;
+        if (!stopped) {
+            ms->client_socket = socket;
+        }
+        sc_mutex_unlock(&ms->mutex);
+
+        if (!stopped) {
+            sc_metrics_server_handle(ms, socket);
+
+            sc_mutex_lock(&ms->mutex);
+            ms->client_socket = SC_SOCKET_NONE;
+            sc_mutex_unlock(&ms->mutex);
+        }
+
+        net_close(socket);
+
+        if (stopped) {
+            break;
+        }
+    }
+
+    LOGD("Metrics server stopped");
+    return 0;
+}
+
+bool
+sc_metrics_server_init(struct sc_metrics_server *ms,
+                       struct sc_metrics *metrics, uint16_t port) {
+    ms->metrics = metrics;
+    ms->stopped = false;
+    ms->client_socket = SC_SOCKET_NONE;
+
+    bool ok = sc_mutex_init(&ms->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ms->server_socket = net_socket();
+    if (ms->server_socket == SC_SOCKET_NONE) {
+        LOGE("Metrics: could not create socket");
+        goto error_destroy_mutex;
+    }
+
+    // Only expose the metrics locally
+    ok = net_listen(ms->server_socket, IPV4_LOCALHOST, port, 1);
+    if (!ok) {
+        LOGE("Metrics: could not listen on port %" PRIu16, port);
+        goto error_close_socket;
+    }
+
+    LOGI("Metrics available at http://127.0.0.1:%" PRIu16 "/metrics", port);
+    return true;
+
+error_close_socket:
+    net_close(ms->server_socket);
+error_destroy_mutex:
+    sc_mutex_destroy(&ms->mutex);
+
+    return false;
+}
+
+void
+sc_metrics_server_destroy(struct sc_metrics_server *ms) {
+    net_close(ms->server_socket);
+    sc_mutex_destroy(&ms->mutex);
+}
+
+bool
+sc_metrics_server_start(struct sc_metrics_server *ms) {
+    LOGD("Starting metrics server thread");
+
+    bool ok = sc_thread_create(&ms->thread, run_metrics_server,
+                               "scrcpy-metricsd", ms);
+    if (!ok) {
+        LOGE("Could not start metrics server thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_metrics_server_stop(struct sc_metrics_server *ms) {
+    sc_mutex_lock(&ms->mutex);
+    ms->stopped = true;
+    if (ms->client_socket != SC_SOCKET_NONE) {
+        // Do not wait for a slow client
+        net_interrupt(ms->client_socket);
+    }
+    sc_mutex_unlock(&ms->mutex);
+
+    net_interrupt(ms->server_socket);
+}
+
+void
+sc_metrics_server_join(struct sc_metrics_server *ms) {
+    sc_thread_join(&ms->thread, NULL);
+}
@@ -0,0 +1,48 @@
+#ifndef SC_METRICS_SERVER_H
+#define SC_METRICS_SERVER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "metrics.h"
+#include "util/net.h"
+#include "util/thread.h"
+
+/**
+ * Minimal HTTP server exposing the metrics on localhost
+ *
+ * It serves "GET /metrics" in Prometheus text format, one request per
+ * connection.
+ */
+struct sc_metrics_server {
+    struct sc_metrics *metrics;
+
+    sc_socket server_socket;
+    sc_thread thread;
+
+    sc_mutex mutex;
+    bool stopped;
+    // The connection being served, to interrupt it on stop
+    sc_socket client_socket;
+};
+
+bool
+sc_metrics_server_init(struct sc_metrics_server *ms,
+                       struct sc_metrics *metrics, uint16_t port);
+
+void
+sc_metrics_server_destroy(struct sc_metrics_server *ms);
+
+bool
+sc_metrics_server_start(struct sc_metrics_server *ms);
+
+// Interrupt the server thread (it must be joined then)
+void
+sc_metrics_server_stop(struct sc_metrics_server *ms);
+
+void
+sc_metrics_server_join(struct sc_metrics_server *ms);
+
+#endif
@@ -27,6 +27,105 @@ sc_opengl_init(struct sc_opengl *gl) {
     gl->GenerateMipmap = (void (*)(GLenum))
                          SDL_GL_GetProcAddress("glGenerateMipmap");
 
+    gl->ActiveTexture = (void (*)(GLenum))
+                        SDL_GL_GetProcAddress("glActiveTexture");
+
+    gl->Viewport = (void (*)(GLint, GLint, GLsizei, GLsizei))
+                   SDL_GL_GetProcAddress("glViewport");
+
+    gl->Disable = (void (*)(GLenum))
+                  SDL_GL_GetProcAddress("glDisable");
+
+    gl->DrawArrays = (void (*)(GLenum, GLint, GLsizei))
+                     SDL_GL_GetProcAddress("glDrawArrays");
+
+    gl->CreateShader = (GLuint (*)(GLenum))
+                       SDL_GL_GetProcAddress("glCreateShader");
+
+    gl->ShaderSource = (void (*)(GLuint, GLsizei, const GLchar *const *,
+                                 const GLint *))
+                       SDL_GL_GetProcAddress("glShaderSource");
+
+    gl->CompileShader = (void (*)(GLuint))
+                        SDL_GL_GetProcAddress("glCompileShader");
+
+    gl->GetShaderiv = (void (*)(GLuint, GLenum, GLint *))
+                      SDL_GL_GetProcAddress("glGetShaderiv");
+
+    gl->GetShaderInfoLog = (void (*)(GLuint, GLsizei, GLsizei *, GLchar *))
+                           SDL_GL_GetProcAddress("glGetShaderInfoLog");
+
+    gl->DeleteShader = (void (*)(GLuint))
+                       SDL_GL_GetProcAddress("glDeleteShader");
+
+    gl->CreateProgram = (GLuint (*)(void))
+                        SDL_GL_GetProcAddress("glCreateProgram");
+
+    gl->AttachShader = (void (*)(GLuint, GLuint))
+                       SDL_GL_GetProcAddress("glAttachShader");
+
+    gl->BindAttribLocation = (void (*)(GLuint, GLuint, const GLchar *))
+                             SDL_GL_GetProcAddress("glBindAttribLocation");
+
+    gl->LinkProgram = (void (*)(GLuint))
+                      SDL_GL_GetProcAddress("glLinkProgram");
+
+    gl->GetProgramiv = (void (*)(GLuint, GLenum, GLint *))
+                       SDL_GL_GetProcAddress("glGetProgramiv");
+
+    gl->GetProgramInfoLog = (void (*)(GLuint, GLsizei, GLsizei *, GLchar *))
+                            SDL_GL_GetProcAddress("glGetProgramInfoLog");
+
+    gl->DeleteProgram = (void (*)(GLuint))
+                        SDL_GL_GetProcAddress("glDeleteProgram");
+
+    gl->UseProgram = (void (*)(GLuint))
+                     SDL_GL_GetProcAddress("glUseProgram");
+
+    gl->GetUniformLocation = (GLint (*)(GLuint, const GLchar *))
+                             SDL_GL_GetProcAddress("glGetUniformLocation");
+
+    gl->Uniform1i = (void (*)(GLint, GLint))
+                    SDL_GL_GetProcAddress("glUniform1i");
+
+    gl->Uniform2f = (void (*)(GLint, GLfloat, GLfloat))
+                    SDL_GL_GetProcAddress("glUniform2f");
+
+    gl->Uniform3fv = (void (*)(GLint, GLsizei, const GLfloat *))
+                     SDL_GL_GetProcAddress("glUniform3fv");
+
+    gl->UniformMatrix3fv = (void (*)(GLint, GLsizei, GLboolean,
+                                     const GLfloat *))
+                           SDL_GL_GetProcAddress("glUniformMatrix3fv");
+
+    gl->GenVertexArrays = (void (*)(GLsizei, GLuint *))
+                          SDL_GL_GetProcAddress("glGenVertexArrays");
+
+    gl->BindVertexArray = (void (*)(GLuint))
+                          SDL_GL_GetProcAddress("glBindVertexArray");
+
+    gl->DeleteVertexArrays = (void (*)(GLsizei, const GLuint *))
+                             SDL_GL_GetProcAddress("glDeleteVertexArrays");
+
+    gl->GenBuffers = (void (*)(GLsizei, GLuint *))
+                     SDL_GL_GetProcAddress("glGenBuffers");
+
+    gl->BindBuffer = (void (*)(GLenum, GLuint))
+                     SDL_GL_GetProcAddress("glBindBuffer");
+
+    gl->BufferData = (void (*)(GLenum, GLsizeiptr, const void *, GLenum))
+                     SDL_GL_GetProcAddress("glBufferData");
+
+    gl->DeleteBuffers = (void (*)(GLsizei, const GLuint *))
+                        SDL_GL_GetProcAddress("glDeleteBuffers");
+
+    gl->VertexAttribPointer = (void (*)(GLuint, GLint, GLenum, GLboolean,
+                                        GLsizei, const void *))
+                              SDL_GL_GetProcAddress("glVertexAttribPointer");
+
+    gl->EnableVertexAttribArray =
+        (void (*)(GLuint)) SDL_GL_GetProcAddress("glEnableVertexAttribArray");
+
     const char *version = (const char *) gl->GetString(GL_VERSION);
     assert(version);
     gl->version = version;
@@ -48,6 +147,42 @@ sc_opengl_init(struct sc_opengl *gl) {
     }
 }
 
+bool
+sc_opengl_has_shader_functions(struct sc_opengl *gl) {
+    return gl->ActiveTexture
+        && gl->Viewport
+        && gl->Disable
+        && gl->DrawArrays
+        && gl->CreateShader
+        && gl->ShaderSource
+        && gl->CompileShader
+        && gl->GetShaderiv
+        && gl->GetShaderInfoLog
+        && gl->DeleteShader
+        && gl->CreateProgram
+        && gl->AttachShader
+        && gl->BindAttribLocation
+        && gl->LinkProgram
+        && gl->GetProgramiv
+        && gl->GetProgramInfoLog
+        && gl->DeleteProgram
+        && gl->UseProgram
+        && gl->GetUniformLocation
+        && gl->Uniform1i
+        && gl->Uniform2f
+        && gl->Uniform3fv
+        && gl->UniformMatrix3fv
+        && gl->GenVertexArrays
+        && gl->BindVertexArray
+        && gl->DeleteVertexArrays
+        && gl->GenBuffers
+        && gl->BindBuffer
+        && gl->BufferData
+        && gl->DeleteBuffers
+        && gl->VertexAttribPointer
+        && gl->EnableVertexAttribArray;
+}
+
 bool
 sc_opengl_version_at_least(struct sc_opengl *gl,
                            int minver_major, int minver_minor,
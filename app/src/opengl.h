@@ -26,11 +26,122 @@ struct sc_opengl {
 
     void
     (*GenerateMipmap)(GLenum target);
+
+    // The following functions are optional (only used by the shaders)
+
+    void
+    (*ActiveTexture)(GLenum texture);
+
+    void
+    (*Viewport)(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    void
+    (*Disable)(GLenum cap);
+
+    void
+    (*DrawArrays)(GLenum mode, GLint first, GLsizei count);
+
+    GLuint
+    (*CreateShader)(GLenum type);
+
+    void
+    (*ShaderSource)(GLuint shader, GLsizei count, const GLchar *const *string,
+                    const GLint *length);
+
+    void
+    (*CompileShader)(GLuint shader);
+
+    void
+    (*GetShaderiv)(GLuint shader, GLenum pname, GLint *params);
+
+    void
+    (*GetShaderInfoLog)(GLuint shader, GLsizei max_length, GLsizei *length,
+                        GLchar *info_log);
+
+    void
+    (*DeleteShader)(GLuint shader);
+
+    GLuint
+    (*CreateProgram)(void);
+
+    void
+    (*AttachShader)(GLuint program, GLuint shader);
+
+    void
+    (*BindAttribLocation)(GLuint program, GLuint index, const GLchar *name);
+
+    void
+    (*LinkProgram)(GLuint program);
+
+    void
+    (*GetProgramiv)(GLuint program, GLenum pname, GLint *params);
+
+    void
+    (*GetProgramInfoLog)(GLuint program, GLsizei max_length, GLsizei *length,
+                         GLchar *info_log);
+
+    void
+    (*DeleteProgram)(GLuint program);
+
+    void
+    (*UseProgram)(GLuint program);
+
+    GLint
+    (*GetUniformLocation)(GLuint program, const GLchar *name);
+
+    void
+    (*Uniform1i)(GLint location, GLint v0);
+
+    void
+    (*Uniform2f)(GLint location, GLfloat v0, GLfloat v1);
+
+    void
+    (*Uniform3fv)(GLint location, GLsizei count, const GLfloat *value);
+
+    void
+    (*UniformMatrix3fv)(GLint location, GLsizei count, GLboolean transpose,
+                        const GLfloat *value);
+
+    void
+    (*GenVertexArrays)(GLsizei n, GLuint *arrays);
+
+    void
+    (*BindVertexArray)(GLuint array);
+
+    void
+    (*DeleteVertexArrays)(GLsizei n, const GLuint *arrays);
+
+    void
+    (*GenBuffers)(GLsizei n, GLuint *buffers);
+
+    void
+    (*BindBuffer)(GLenum target, GLuint buffer);
+
+    void
+    (*BufferData)(GLenum target, GLsizeiptr size, const void *data,
+                  GLenum usage);
+
+    void
+    (*DeleteBuffers)(GLsizei n, const GLuint *buffers);
+
+    void
+    (*VertexAttribPointer)(GLuint index, GLint size, GLenum type,
+                           GLboolean normalized, GLsizei stride,
+                           const void *pointer);
+
+    void
+    (*EnableVertexAttribArray)(GLuint index);
 };
 
 void
 sc_opengl_init(struct sc_opengl *gl);
 
+/**
+ * Return true if all the functions required by the shaders are available
+ */
+bool
+sc_opengl_has_shader_functions(struct sc_opengl *gl);
+
 bool
 sc_opengl_version_at_least(struct sc_opengl *gl,
                            int minver_major, int minver_minor,
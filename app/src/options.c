@@ -4,10 +4,12 @@
 
 const struct scrcpy_options scrcpy_options_default = {
     .serial = NULL,
+    .serials = NULL,
     .crop = NULL,
     .record_filename = NULL,
     .window_title = NULL,
     .push_target = NULL,
+    .push_workers = 2,
     .render_driver = NULL,
     .video_codec_options = NULL,
     .audio_codec_options = NULL,
@@ -46,6 +48,9 @@ const struct scrcpy_options scrcpy_options_default = {
         .first = DEFAULT_LOCAL_PORT_RANGE_FIRST,
         .last = DEFAULT_LOCAL_PORT_RANGE_LAST,
     },
+    .video_socket_tuning = {0},
+    .audio_socket_tuning = {0},
+    .control_socket_tuning = {0},
     .tunnel_host = 0,
     .tunnel_port = 0,
     .shortcut_mods = SC_SHORTCUT_MOD_LALT | SC_SHORTCUT_MOD_LSUPER,
@@ -64,6 +69,7 @@ const struct scrcpy_options scrcpy_options_default = {
     .window_height = 0,
     .display_id = 0,
     .video_buffer = 0,
+    .frame_pacing = 0,
     .audio_buffer = -1, // depends on the audio format,
     .audio_output_buffer = SC_TICK_FROM_MS(5),
     .time_limit = 0,
@@ -71,6 +77,7 @@ const struct scrcpy_options scrcpy_options_default = {
 #ifdef HAVE_V4L2
     .v4l2_device = NULL,
     .v4l2_buffer = 0,
+    .v4l2_orientation = SC_ORIENTATION_0,
 #endif
 #ifdef HAVE_USB
     .otg = false,
@@ -85,6 +92,7 @@ const struct scrcpy_options scrcpy_options_default = {
     .key_inject_mode = SC_KEY_INJECT_MODE_MIXED,
     .window_borderless = false,
     .mipmaps = true,
+    .downscale_filter = SC_DOWNSCALE_FILTER_TRILINEAR,
     .stay_awake = false,
     .force_adb_forward = false,
     .disable_screensaver = false,
@@ -98,7 +106,19 @@ const struct scrcpy_options scrcpy_options_default = {
     .select_tcpip = false,
     .select_usb = false,
     .cleanup = true,
+    .server_cache = true,
+    .session_cache = true,
     .start_fps_counter = false,
+    .latency_probe = false,
+    .late_latch = false,
+    .metrics_port = 0,
+    .thread_sched = SC_THREAD_SCHED_NORMAL,
+    .cpu_affinity = 0,
+    .hid_report_rate = 0,
+    .async_log = false,
+    .trace_file = NULL,
+    .startup_profile = false,
+    .compact_control = false,
     .power_on = true,
     .video = true,
     .audio = true,
@@ -115,6 +135,8 @@ const struct scrcpy_options scrcpy_options_default = {
     .vd_destroy_content = true,
     .vd_system_decorations = true,
     .camera_torch = false,
+    .video_wall = false,
+    .reconnect = false,
 };
 
 enum sc_orientation
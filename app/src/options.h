@@ -7,6 +7,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "util/thread.h"
 #include "util/tick.h"
 
 enum sc_log_level {
@@ -150,6 +151,12 @@ sc_orientation_get_name(enum sc_orientation orientation) {
     }
 }
 
+enum sc_downscale_filter {
+    SC_DOWNSCALE_FILTER_TRILINEAR, // mipmaps, unless disabled
+    SC_DOWNSCALE_FILTER_BICUBIC,
+    SC_DOWNSCALE_FILTER_LANCZOS,
+};
+
 enum sc_keyboard_input_mode {
     SC_KEYBOARD_INPUT_MODE_AUTO,
     SC_KEYBOARD_INPUT_MODE_UHID_OR_AOA, // normal vs otg mode
@@ -225,10 +232,26 @@ struct sc_port_range {
     uint16_t last;
 };
 
+// Tuning of a client socket (0 or false to keep the OS default)
+struct sc_socket_tuning {
+    uint32_t recv_buffer_size; // SO_RCVBUF
+    uint32_t send_buffer_size; // SO_SNDBUF
+    uint32_t recv_lowat; // SO_RCVLOWAT
+    uint32_t busy_poll; // SO_BUSY_POLL, in microseconds
+    bool quickack; // TCP_QUICKACK
+};
+
 #define SC_WINDOW_POSITION_UNDEFINED (-0x8000)
 
+// Maximum number of devices mirrored from a single process (--serials)
+#define SC_MAX_SERIALS 32
+
+// Maximum number of files pushed or installed concurrently (--push-workers)
+#define SC_MAX_PUSH_WORKERS 16
+
 struct scrcpy_options {
     const char *serial;
+    const char *serials; // comma-separated list of serials
     const char *crop;
     const char *record_filename;
     const char *window_title;
@@ -255,9 +278,13 @@ struct scrcpy_options {
     struct sc_mouse_bindings mouse_bindings;
     enum sc_camera_facing camera_facing;
     struct sc_port_range port_range;
+    struct sc_socket_tuning video_socket_tuning;
+    struct sc_socket_tuning audio_socket_tuning;
+    struct sc_socket_tuning control_socket_tuning;
     uint32_t tunnel_host;
     uint16_t tunnel_port;
     uint8_t shortcut_mods; // OR of enum sc_shortcut_mod values
+    uint8_t push_workers;
     uint16_t max_size;
     uint32_t video_bit_rate;
     uint32_t audio_bit_rate;
@@ -274,6 +301,7 @@ struct scrcpy_options {
     uint16_t window_height;
     uint32_t display_id;
     sc_tick video_buffer;
+    sc_tick frame_pacing; // maximum pacing delay, 0 if disabled
     sc_tick audio_buffer;
     sc_tick audio_output_buffer;
     sc_tick time_limit;
@@ -281,6 +309,7 @@ struct scrcpy_options {
 #ifdef HAVE_V4L2
     const char *v4l2_device;
     sc_tick v4l2_buffer;
+    enum sc_orientation v4l2_orientation;
 #endif
 #ifdef HAVE_USB
     bool otg;
@@ -295,6 +324,7 @@ struct scrcpy_options {
     enum sc_key_inject_mode key_inject_mode;
     bool window_borderless;
     bool mipmaps;
+    enum sc_downscale_filter downscale_filter;
     bool stay_awake;
     bool force_adb_forward;
     bool disable_screensaver;
@@ -308,7 +338,19 @@ struct scrcpy_options {
     bool select_usb;
     bool select_tcpip;
     bool cleanup;
+    bool server_cache;
+    bool session_cache;
     bool start_fps_counter;
+    bool latency_probe;
+    bool late_latch;
+    uint16_t metrics_port; // 0 to disable
+    enum sc_thread_sched thread_sched;
+    uint64_t cpu_affinity; // bit i for CPU i, 0 for no affinity
+    uint16_t hid_report_rate; // 0 for unlimited
+    bool async_log;
+    const char *trace_file;
+    bool startup_profile;
+    bool compact_control;
     bool power_on;
     bool video;
     bool audio;
@@ -329,6 +371,8 @@ struct scrcpy_options {
     bool vd_destroy_content;
     bool vd_system_decorations;
     bool camera_torch;
+    bool video_wall;
+    bool reconnect;
 };
 
 extern const struct scrcpy_options scrcpy_options_default;
@@ -7,6 +7,7 @@
 
 #include "device_msg.h"
 #include "events.h"
+#include "latency_probe.h"
 #include "util/log.h"
 #include "util/str.h"
 #include "util/thread.h"
@@ -26,9 +27,16 @@ sc_receiver_init(struct sc_receiver *receiver, sc_socket control_socket,
         return false;
     }
 
+    ok = sc_bytebuf_init(&receiver->buf, DEVICE_MSG_MAX_SIZE);
+    if (!ok) {
+        sc_mutex_destroy(&receiver->mutex);
+        return false;
+    }
+
     receiver->control_socket = control_socket;
     receiver->acksync = NULL;
     receiver->uhid_devices = NULL;
+    receiver->latency_probe = NULL;
 
     assert(cbs && cbs->on_ended);
     receiver->cbs = cbs;
@@ -39,9 +47,17 @@ sc_receiver_init(struct sc_receiver *receiver, sc_socket control_socket,
 
 void
 sc_receiver_destroy(struct sc_receiver *receiver) {
+    sc_bytebuf_destroy(&receiver->buf);
     sc_mutex_destroy(&receiver->mutex);
 }
 
+void
+sc_receiver_reset(struct sc_receiver *receiver, sc_socket control_socket) {
+    receiver->control_socket = control_socket;
+    // Drop any partial message from the previous connection
+    sc_bytebuf_skip(&receiver->buf, sc_bytebuf_can_read(&receiver->buf));
+}
+
 static void
 task_set_clipboard(void *userdata) {
     assert(sc_thread_get_id() == SC_MAIN_THREAD_ID);
@@ -154,31 +170,49 @@ process_msg(struct sc_receiver *receiver, struct sc_device_msg *msg) {
                 return;
             }
 
+            break;
+        case DEVICE_MSG_TYPE_LATENCY_PROBE_ACK:
+            if (!receiver->latency_probe) {
+                LOGE("Received unexpected latency probe ack");
+                return;
+            }
+
+            sc_latency_probe_ack(receiver->latency_probe,
+                                 msg->latency_probe_ack.sequence,
+                                 msg->latency_probe_ack.timestamp,
+                                 sc_tick_now());
+            // No allocation to free in the msg
             break;
     }
 }
 
-static ssize_t
-process_msgs(struct sc_receiver *receiver, const uint8_t *buf, size_t len) {
-    size_t head = 0;
+static bool
+process_msgs(struct sc_receiver *receiver) {
+    struct sc_bytebuf *buf = &receiver->buf;
+
     for (;;) {
+        // The data is parsed in place, even if it wraps around the end of the
+        // ring buffer, so it is never shifted
+        const uint8_t *part1;
+        const uint8_t *part2;
+        size_t len1;
+        size_t len2;
+        sc_bytebuf_read_parts(buf, &part1, &len1, &part2, &len2);
+
         struct sc_device_msg msg;
-        ssize_t r = sc_device_msg_deserialize(&buf[head], len - head, &msg);
+        ssize_t r = sc_device_msg_deserialize_split(part1, len1, part2, len2,
+                                                    &msg);
         if (r == -1) {
-            return -1;
+            return false;
         }
         if (r == 0) {
-            return head;
+            return true;
         }
 
         process_msg(receiver, &msg);
         // the device msg must be destroyed by process_msg()
 
-        head += r;
-        assert(head <= len);
-        if (head == len) {
-            return head;
-        }
+        sc_bytebuf_skip(buf, r);
     }
 }
 
@@ -186,34 +220,33 @@ static int
 run_receiver(void *data) {
     struct sc_receiver *receiver = data;
 
-    static uint8_t buf[DEVICE_MSG_MAX_SIZE];
-    size_t head = 0;
+    sc_thread_apply_role(SC_THREAD_ROLE_CONTROL); // errors already logged
 
     bool error = false;
 
     for (;;) {
-        assert(head < DEVICE_MSG_MAX_SIZE);
-        ssize_t r = net_recv(receiver->control_socket, buf + head,
-                             DEVICE_MSG_MAX_SIZE - head);
+        // A message never exceeds the buffer capacity, so if the buffer is
+        // full, then at least one message has been processed
+        assert(sc_bytebuf_can_write(&receiver->buf));
+
+        size_t len;
+        uint8_t *ptr = sc_bytebuf_prepare_write(&receiver->buf, &len);
+        assert(len);
+
+        ssize_t r = net_recv(receiver->control_socket, ptr, len);
         if (r <= 0) {
             LOGD("Receiver stopped");
             // device disconnected: keep error=false
             break;
         }
 
-        head += r;
-        ssize_t consumed = process_msgs(receiver, buf, head);
-        if (consumed == -1) {
+        sc_bytebuf_commit_write(&receiver->buf, r);
+        bool ok = process_msgs(receiver);
+        if (!ok) {
             // an error occurred
             error = true;
             break;
         }
-
-        if (consumed) {
-            head -= consumed;
-            // shift the remaining data in the buffer
-            memmove(buf, &buf[consumed], head);
-        }
     }
 
     receiver->cbs->on_ended(receiver, error, receiver->cbs_userdata);
@@ -7,6 +7,7 @@
 
 #include "uhid/uhid_output.h"
 #include "util/acksync.h"
+#include "util/bytebuf.h"
 #include "util/net.h"
 #include "util/thread.h"
 
@@ -17,8 +18,12 @@ struct sc_receiver {
     sc_thread thread;
     sc_mutex mutex;
 
+    // received data not processed yet (a partial message)
+    struct sc_bytebuf buf;
+
     struct sc_acksync *acksync;
     struct sc_uhid_devices *uhid_devices;
+    struct sc_latency_probe *latency_probe;
 
     const struct sc_receiver_callbacks *cbs;
     void *cbs_userdata;
@@ -35,6 +40,10 @@ sc_receiver_init(struct sc_receiver *receiver, sc_socket control_socket,
 void
 sc_receiver_destroy(struct sc_receiver *receiver);
 
+// Must be called while the receiver thread is not running
+void
+sc_receiver_reset(struct sc_receiver *receiver, sc_socket control_socket);
+
 bool
 sc_receiver_start(struct sc_receiver *receiver);
 
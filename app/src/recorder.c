@@ -475,7 +475,7 @@ run_recorder(void *data) {
     struct sc_recorder *recorder = data;
 
     // Recording is a background task
-    bool ok = sc_thread_set_priority(SC_THREAD_PRIORITY_LOW);
+    bool ok = sc_thread_apply_role(SC_THREAD_ROLE_BACKGROUND);
     (void) ok; // We don't care if it worked
 
     bool success = sc_recorder_record(recorder);
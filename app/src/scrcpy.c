@@ -21,11 +21,18 @@
 #include "demuxer.h"
 #include "events.h"
 #include "file_pusher.h"
+#include "frame_pacer.h"
 #include "keyboard_sdk.h"
+#include "latency_probe.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include "link_monitor.h"
 #include "mouse_sdk.h"
 #include "recorder.h"
 #include "screen.h"
 #include "server.h"
+#include "session_cache.h"
+#include "startup_profile.h"
 #include "uhid/gamepad_uhid.h"
 #include "uhid/keyboard_uhid.h"
 #include "uhid/mouse_uhid.h"
@@ -39,14 +46,29 @@
 #include "util/acksync.h"
 #include "util/log.h"
 #include "util/rand.h"
+#include "util/thread.h"
 #include "util/timeout.h"
 #include "util/tick.h"
 #ifdef HAVE_V4L2
 # include "v4l2_sink.h"
 #endif
 
+// Delay without any packet before the connection is considered stalled
+#define SC_LINK_STALL_TIMEOUT SC_TICK_FROM_SEC(5)
+
+enum sc_link_state {
+    SC_LINK_STATE_UP,
+    // The connection is lost, waiting for the components to release it
+    SC_LINK_STATE_INTERRUPTED,
+    // A new server is starting (or will start after a delay)
+    SC_LINK_STATE_CONNECTING,
+};
+
 struct scrcpy {
+    const struct scrcpy_options *options;
     struct sc_server server;
+    bool server_initialized;
+    bool server_started; // the server thread is started and not joined
     struct sc_screen screen;
     struct sc_audio_player audio_player;
     struct sc_demuxer video_demuxer;
@@ -55,12 +77,17 @@ struct scrcpy {
     struct sc_decoder audio_decoder;
     struct sc_recorder recorder;
     struct sc_delay_buffer video_buffer;
+    struct sc_frame_pacer frame_pacer;
 #ifdef HAVE_V4L2
     struct sc_v4l2_sink v4l2_sink;
     struct sc_delay_buffer v4l2_buffer;
 #endif
     struct sc_controller controller;
+    bool controller_running; // the controller is started and not joined
     struct sc_file_pusher file_pusher;
+    struct sc_latency_probe latency_probe;
+    struct sc_metrics metrics;
+    struct sc_metrics_server metrics_server;
 #ifdef HAVE_USB
     struct sc_usb usb;
     struct sc_aoa aoa;
@@ -89,6 +116,19 @@ struct scrcpy {
 #endif
     };
     struct sc_timeout timeout;
+    struct sc_startup_profile startup_profile;
+    // Set while the startup profile is waiting for the first frame
+    struct sc_startup_profile *pending_startup_profile;
+
+    // Automatic reconnection (only used if --reconnect is set)
+    struct sc_link_monitor link_monitor;
+    enum sc_link_state link_state;
+    struct sc_server_params reconnect_params;
+    char *reconnect_serial;
+    sc_tick link_lost_date;
+    unsigned reconnect_attempt;
+    bool video_demuxer_started;
+    bool audio_demuxer_started;
 };
 
 #ifdef _WIN32
@@ -101,8 +141,8 @@ static BOOL WINAPI windows_ctrl_handler(DWORD ctrl_type) {
 }
 #endif // _WIN32
 
-static void
-sdl_set_hints(const char *render_driver) {
+void
+scrcpy_sdl_set_hints(const char *render_driver) {
     if (render_driver && !SDL_SetHint(SDL_HINT_RENDER_DRIVER, render_driver)) {
         LOGW("Could not set render driver");
     }
@@ -139,8 +179,8 @@ sdl_set_hints(const char *render_driver) {
     }
 }
 
-static void
-sdl_configure(bool video_playback, bool disable_screensaver) {
+void
+scrcpy_sdl_configure(bool video_playback, bool disable_screensaver) {
 #ifdef _WIN32
     // Clean up properly on Ctrl+C on Windows
     bool ok = SetConsoleCtrlHandler(windows_ctrl_handler, TRUE);
@@ -166,11 +206,26 @@ sdl_configure(bool video_playback, bool disable_screensaver) {
     }
 }
 
+static bool
+scrcpy_handle_link_event(struct scrcpy *s, const SDL_Event *event);
+
 static enum scrcpy_exit_code
 event_loop(struct scrcpy *s, bool has_screen, bool disconnected) {
     SDL_Event event;
     while (SDL_WaitEvent(&event)) {
         switch (event.type) {
+            case SC_EVENT_LINK_INTERRUPTED:
+            case SC_EVENT_LINK_STALLED:
+            case SC_EVENT_RECONNECT:
+            case SC_EVENT_SERVER_CONNECTED:
+            case SC_EVENT_SERVER_CONNECTION_FAILED:
+                if (disconnected || !s->options->reconnect) {
+                    break;
+                }
+                if (!scrcpy_handle_link_event(s, &event)) {
+                    return SCRCPY_EXIT_FAILURE;
+                }
+                break;
             case SC_EVENT_DEVICE_DISCONNECTED:
                 if (disconnected) {
                     break;
@@ -219,6 +274,20 @@ event_loop(struct scrcpy *s, bool has_screen, bool disconnected) {
                 run(userdata);
                 break;
             }
+            case SC_EVENT_NEW_FRAME:
+                if (has_screen && !sc_screen_handle_event(&s->screen, &event)) {
+                    return SCRCPY_EXIT_FAILURE;
+                }
+                if (s->pending_startup_profile) {
+                    // The first frame has been rendered
+                    struct sc_startup_profile *profile =
+                        s->pending_startup_profile;
+                    sc_startup_profile_end(profile,
+                                           SC_STARTUP_PHASE_FIRST_FRAME);
+                    sc_startup_profile_log(profile);
+                    s->pending_startup_profile = NULL;
+                }
+                break;
             default:
                 if (has_screen && !sc_screen_handle_event(&s->screen, &event)) {
                     return SCRCPY_EXIT_FAILURE;
@@ -244,6 +313,21 @@ terminate_event_loop(void) {
     }
 }
 
+// Return the serial of the device which will be selected, if it is known
+// before the server thread selects it
+static const char *
+get_expected_serial(const struct scrcpy_options *options) {
+    if (options->serial) {
+        return options->serial;
+    }
+
+    if (options->select_usb || options->select_tcpip || options->tcpip) {
+        return NULL;
+    }
+
+    return getenv("ANDROID_SERIAL");
+}
+
 // Return true on success, false on error
 static bool
 await_for_server(bool *connected) {
@@ -316,16 +400,27 @@ sc_audio_demuxer_on_ended(struct sc_demuxer *demuxer,
     }
 }
 
+static void
+sc_demuxer_on_interrupted(struct sc_demuxer *demuxer, void *userdata) {
+    (void) demuxer;
+    (void) userdata;
+
+    sc_push_event(SC_EVENT_LINK_INTERRUPTED);
+}
+
 static void
 sc_controller_on_ended(struct sc_controller *controller, bool error,
                        void *userdata) {
     // Note: this function may be called twice, once from the controller thread
     // and once from the receiver thread
     (void) controller;
-    (void) userdata;
+
+    const struct scrcpy_options *options = userdata;
 
     if (error) {
         sc_push_event(SC_EVENT_CONTROLLER_ERROR);
+    } else if (options->reconnect) {
+        sc_push_event(SC_EVENT_LINK_INTERRUPTED);
     } else {
         sc_push_event(SC_EVENT_DEVICE_DISCONNECTED);
     }
@@ -357,6 +452,12 @@ sc_server_on_disconnected(struct sc_server *server, void *userdata) {
     // event
 }
 
+static const struct sc_server_callbacks server_cbs = {
+    .on_connection_failed = sc_server_on_connection_failed,
+    .on_connected = sc_server_on_connected,
+    .on_disconnected = sc_server_on_disconnected,
+};
+
 static void
 sc_timeout_on_timeout(struct sc_timeout *timeout, void *userdata) {
     (void) timeout;
@@ -365,6 +466,24 @@ sc_timeout_on_timeout(struct sc_timeout *timeout, void *userdata) {
     sc_push_event(SC_EVENT_TIME_LIMIT_REACHED);
 }
 
+static void
+sc_link_monitor_on_stalled(struct sc_link_monitor *monitor, sc_tick elapsed,
+                           void *userdata) {
+    (void) monitor;
+    (void) userdata;
+
+    LOGW("No packet received for %" PRItick " ms", elapsed / 1000);
+    sc_push_event(SC_EVENT_LINK_STALLED);
+}
+
+static void
+sc_link_monitor_on_retry(struct sc_link_monitor *monitor, void *userdata) {
+    (void) monitor;
+    (void) userdata;
+
+    sc_push_event(SC_EVENT_RECONNECT);
+}
+
 // Generate a scrcpy id to differentiate multiple running scrcpy instances
 static uint32_t
 scrcpy_generate_scid(void) {
@@ -374,6 +493,236 @@ scrcpy_generate_scid(void) {
     return sc_rand_u32(&rand) & 0x7FFFFFFF;
 }
 
+void
+scrcpy_init_server_params(struct sc_server_params *params,
+                          const struct scrcpy_options *options) {
+    *params = (struct sc_server_params) {
+        .scid = scrcpy_generate_scid(),
+        .req_serial = options->serial,
+        .select_usb = options->select_usb,
+        .select_tcpip = options->select_tcpip,
+        .log_level = options->log_level,
+        .video_codec = options->video_codec,
+        .audio_codec = options->audio_codec,
+        .video_source = options->video_source,
+        .audio_source = options->audio_source,
+        .camera_facing = options->camera_facing,
+        .crop = options->crop,
+        .port_range = options->port_range,
+        .video_socket_tuning = options->video_socket_tuning,
+        .audio_socket_tuning = options->audio_socket_tuning,
+        .control_socket_tuning = options->control_socket_tuning,
+        .tunnel_host = options->tunnel_host,
+        .tunnel_port = options->tunnel_port,
+        .max_size = options->max_size,
+        .video_bit_rate = options->video_bit_rate,
+        .audio_bit_rate = options->audio_bit_rate,
+        .max_fps = options->max_fps,
+        .angle = options->angle,
+        .screen_off_timeout = options->screen_off_timeout,
+        .capture_orientation = options->capture_orientation,
+        .capture_orientation_lock = options->capture_orientation_lock,
+        .control = options->control,
+        .display_id = options->display_id,
+        .new_display = options->new_display,
+        .display_ime_policy = options->display_ime_policy,
+        .video = options->video,
+        .audio = options->audio,
+        .audio_dup = options->audio_dup,
+        .show_touches = options->show_touches,
+        .stay_awake = options->stay_awake,
+        .video_codec_options = options->video_codec_options,
+        .audio_codec_options = options->audio_codec_options,
+        .video_encoder = options->video_encoder,
+        .audio_encoder = options->audio_encoder,
+        .camera_id = options->camera_id,
+        .camera_size = options->camera_size,
+        .camera_ar = options->camera_ar,
+        .camera_fps = options->camera_fps,
+        .force_adb_forward = options->force_adb_forward,
+        .power_off_on_close = options->power_off_on_close,
+        .clipboard_autosync = options->clipboard_autosync,
+        .compact_control = options->compact_control,
+        .downsize_on_error = options->downsize_on_error,
+        .tcpip = options->tcpip,
+        .tcpip_dst = options->tcpip_dst,
+        .cleanup = options->cleanup,
+        .server_cache = options->server_cache,
+        .power_on = options->power_on,
+        .kill_adb_on_close = options->kill_adb_on_close,
+        .camera_high_speed = options->camera_high_speed,
+        .camera_torch = options->camera_torch,
+        .camera_zoom = options->camera_zoom,
+        .vd_destroy_content = options->vd_destroy_content,
+        .vd_system_decorations = options->vd_system_decorations,
+        .list = options->list,
+    };
+}
+
+// Join the stopped server, and start a new one on the same device
+static bool
+scrcpy_restart_server(struct scrcpy *s) {
+    assert(s->server_initialized && s->server_started);
+
+    // The server is already stopped (or it failed to connect), so it does not
+    // take long
+    sc_server_join(&s->server);
+    s->server_started = false;
+    sc_server_destroy(&s->server);
+    s->server_initialized = false;
+
+    // A new scid, so that the device socket of the previous server (which
+    // may not be dead yet) is not reused
+    s->reconnect_params.scid = scrcpy_generate_scid();
+
+    if (!sc_server_init(&s->server, &s->reconnect_params, &server_cbs, NULL)) {
+        return false;
+    }
+    s->server_initialized = true;
+
+    if (!sc_server_start(&s->server)) {
+        return false;
+    }
+    s->server_started = true;
+
+    s->link_state = SC_LINK_STATE_CONNECTING;
+    return true;
+}
+
+static bool
+scrcpy_is_link_released(struct scrcpy *s) {
+    // The demuxers read the sockets owned by the server, it must not be
+    // destroyed before they release them
+    if (s->video_demuxer_started
+            && !sc_demuxer_is_interrupted(&s->video_demuxer)) {
+        return false;
+    }
+    if (s->audio_demuxer_started
+            && !sc_demuxer_is_interrupted(&s->audio_demuxer)) {
+        return false;
+    }
+    return true;
+}
+
+static bool
+scrcpy_try_reconnect(struct scrcpy *s) {
+    assert(s->link_state == SC_LINK_STATE_INTERRUPTED);
+
+    if (!scrcpy_is_link_released(s)) {
+        // Wait for the next SC_EVENT_LINK_INTERRUPTED
+        return true;
+    }
+
+    if (s->controller_running) {
+        // Its sockets have been interrupted by sc_server_stop()
+        sc_controller_join(&s->controller);
+        s->controller_running = false;
+    }
+
+    return scrcpy_restart_server(s);
+}
+
+static bool
+scrcpy_on_link_lost(struct scrcpy *s) {
+    assert(s->link_state == SC_LINK_STATE_UP);
+
+    LOGW("Connection lost, reconnecting...");
+
+    s->link_state = SC_LINK_STATE_INTERRUPTED;
+    s->link_lost_date = sc_tick_now();
+    s->reconnect_attempt = 0;
+
+    sc_link_monitor_disarm(&s->link_monitor);
+
+    if (s->controller_running) {
+        sc_controller_stop(&s->controller);
+    }
+
+    // Do not kill adb on a reconnection (the params are read by the server
+    // thread only once stopped)
+    s->server.params.kill_adb_on_close = false;
+
+    // Interrupt the sockets, to wake up the demuxers and the receiver
+    sc_server_stop(&s->server);
+
+    return scrcpy_try_reconnect(s);
+}
+
+static bool
+scrcpy_on_reconnected(struct scrcpy *s) {
+    assert(s->link_state == SC_LINK_STATE_CONNECTING);
+
+    if (s->video_demuxer_started) {
+        sc_demuxer_resume(&s->video_demuxer, s->server.video_socket);
+    }
+    if (s->audio_demuxer_started) {
+        sc_demuxer_resume(&s->audio_demuxer, s->server.audio_socket);
+    }
+
+    if (s->options->control) {
+        if (!sc_controller_restart(&s->controller,
+                                   s->server.control_socket)) {
+            return false;
+        }
+        s->controller_running = true;
+
+        if (s->options->turn_screen_off) {
+            // The screen has been restored by the previous server
+            struct sc_control_msg msg;
+            msg.type = SC_CONTROL_MSG_TYPE_SET_DISPLAY_POWER;
+            msg.set_display_power.on = false;
+
+            if (!sc_controller_push_msg(&s->controller, &msg)) {
+                LOGW("Could not request 'set display power'");
+            }
+        }
+    }
+
+    s->link_state = SC_LINK_STATE_UP;
+    sc_link_monitor_record_recovery(&s->link_monitor,
+                                    sc_tick_now() - s->link_lost_date);
+    sc_link_monitor_arm(&s->link_monitor);
+
+    return true;
+}
+
+// Return false on unrecoverable error
+static bool
+scrcpy_handle_link_event(struct scrcpy *s, const SDL_Event *event) {
+    switch (event->type) {
+        case SC_EVENT_LINK_INTERRUPTED:
+        case SC_EVENT_LINK_STALLED:
+            if (s->link_state == SC_LINK_STATE_UP) {
+                return scrcpy_on_link_lost(s);
+            }
+            if (s->link_state == SC_LINK_STATE_INTERRUPTED) {
+                return scrcpy_try_reconnect(s);
+            }
+            // Late events from the previous connection
+            return true;
+        case SC_EVENT_SERVER_CONNECTED:
+            assert(s->link_state == SC_LINK_STATE_CONNECTING);
+            return scrcpy_on_reconnected(s);
+        case SC_EVENT_SERVER_CONNECTION_FAILED: {
+            assert(s->link_state == SC_LINK_STATE_CONNECTING);
+            sc_tick delay =
+                sc_link_monitor_get_retry_delay(s->reconnect_attempt++);
+            LOGW("Could not reconnect, retrying in %" PRItick " ms",
+                 delay / 1000);
+            sc_link_monitor_schedule_retry(&s->link_monitor,
+                                           sc_tick_now() + delay);
+            return true;
+        }
+        case SC_EVENT_RECONNECT:
+            assert(s->link_state == SC_LINK_STATE_CONNECTING);
+            LOGI("Reconnecting (attempt %u)...", s->reconnect_attempt + 1);
+            return scrcpy_restart_server(s);
+        default:
+            assert(!"unexpected link event");
+            return true;
+    }
+}
+
 static void
 init_sdl_gamepads(void) {
     // Trigger a SDL_EVENT_GAMEPAD_ADDED event for all gamepads already
@@ -405,6 +754,15 @@ scrcpy(struct scrcpy_options *options) {
 #endif
     struct scrcpy *s = &scrcpy;
 
+    s->options = options;
+    s->server_initialized = false;
+    s->server_started = false;
+    s->controller_running = false;
+    s->video_demuxer_started = false;
+    s->audio_demuxer_started = false;
+    s->reconnect_serial = NULL;
+    s->link_state = SC_LINK_STATE_UP;
+
     // Minimal SDL initialization
     if (!SDL_Init(SDL_INIT_EVENTS)) {
         LOGE("Could not initialize SDL: %s", SDL_GetError());
@@ -413,25 +771,39 @@ scrcpy(struct scrcpy_options *options) {
 
     atexit(SDL_Quit);
 
+    struct sc_startup_profile *startup_profile = NULL;
+    if (options->startup_profile) {
+        if (!sc_startup_profile_init(&s->startup_profile)) {
+            return SCRCPY_EXIT_FAILURE;
+        }
+        startup_profile = &s->startup_profile;
+    }
+    s->pending_startup_profile = NULL;
+
     enum scrcpy_exit_code ret = SCRCPY_EXIT_FAILURE;
 
-    bool server_started = false;
     bool file_pusher_initialized = false;
     bool recorder_initialized = false;
     bool recorder_started = false;
 #ifdef HAVE_V4L2
     bool v4l2_sink_initialized = false;
 #endif
-    bool video_demuxer_started = false;
-    bool audio_demuxer_started = false;
+    bool link_monitor_initialized = false;
+    bool link_monitor_started = false;
 #ifdef HAVE_USB
     bool aoa_hid_initialized = false;
     bool keyboard_aoa_initialized = false;
     bool mouse_aoa_initialized = false;
     bool gamepad_aoa_initialized = false;
 #endif
+    bool mouse_uhid_initialized = false;
+    bool gamepad_uhid_initialized = false;
     bool controller_initialized = false;
-    bool controller_started = false;
+    bool latency_probe_initialized = false;
+    bool metrics_initialized = false;
+    bool metrics_started = false;
+    bool metrics_server_initialized = false;
+    bool metrics_server_started = false;
     bool screen_initialized = false;
     bool timeout_initialized = false;
     bool timeout_started = false;
@@ -439,85 +811,37 @@ scrcpy(struct scrcpy_options *options) {
 
     struct sc_acksync *acksync = NULL;
 
-    uint32_t scid = scrcpy_generate_scid();
-
-    struct sc_server_params params = {
-        .scid = scid,
-        .req_serial = options->serial,
-        .select_usb = options->select_usb,
-        .select_tcpip = options->select_tcpip,
-        .log_level = options->log_level,
-        .video_codec = options->video_codec,
-        .audio_codec = options->audio_codec,
-        .video_source = options->video_source,
-        .audio_source = options->audio_source,
-        .camera_facing = options->camera_facing,
-        .crop = options->crop,
-        .port_range = options->port_range,
-        .tunnel_host = options->tunnel_host,
-        .tunnel_port = options->tunnel_port,
-        .max_size = options->max_size,
-        .video_bit_rate = options->video_bit_rate,
-        .audio_bit_rate = options->audio_bit_rate,
-        .max_fps = options->max_fps,
-        .angle = options->angle,
-        .screen_off_timeout = options->screen_off_timeout,
-        .capture_orientation = options->capture_orientation,
-        .capture_orientation_lock = options->capture_orientation_lock,
-        .control = options->control,
-        .display_id = options->display_id,
-        .new_display = options->new_display,
-        .display_ime_policy = options->display_ime_policy,
-        .video = options->video,
-        .audio = options->audio,
-        .audio_dup = options->audio_dup,
-        .show_touches = options->show_touches,
-        .stay_awake = options->stay_awake,
-        .video_codec_options = options->video_codec_options,
-        .audio_codec_options = options->audio_codec_options,
-        .video_encoder = options->video_encoder,
-        .audio_encoder = options->audio_encoder,
-        .camera_id = options->camera_id,
-        .camera_size = options->camera_size,
-        .camera_ar = options->camera_ar,
-        .camera_fps = options->camera_fps,
-        .force_adb_forward = options->force_adb_forward,
-        .power_off_on_close = options->power_off_on_close,
-        .clipboard_autosync = options->clipboard_autosync,
-        .downsize_on_error = options->downsize_on_error,
-        .tcpip = options->tcpip,
-        .tcpip_dst = options->tcpip_dst,
-        .cleanup = options->cleanup,
-        .power_on = options->power_on,
-        .kill_adb_on_close = options->kill_adb_on_close,
-        .camera_high_speed = options->camera_high_speed,
-        .camera_torch = options->camera_torch,
-        .camera_zoom = options->camera_zoom,
-        .vd_destroy_content = options->vd_destroy_content,
-        .vd_system_decorations = options->vd_system_decorations,
-        .list = options->list,
-    };
-
-    static const struct sc_server_callbacks cbs = {
-        .on_connection_failed = sc_server_on_connection_failed,
-        .on_connected = sc_server_on_connected,
-        .on_disconnected = sc_server_on_disconnected,
-    };
-    if (!sc_server_init(&s->server, &params, &cbs, NULL)) {
+    // The properties of the last session with the device, to initialize the
+    // decoder and the window speculatively
+    char *session_cache_path = NULL;
+    const char *session_hint_serial = NULL; // the serial of the loaded hint
+    struct sc_session_hint session_hint;
+    bool has_session_hint = false;
+    AVCodecContext *preopened_video_codec = NULL;
+
+    struct sc_server_params params;
+    scrcpy_init_server_params(&params, options);
+    params.startup_profile = startup_profile;
+
+    if (!sc_server_init(&s->server, &params, &server_cbs, NULL)) {
+        if (startup_profile) {
+            sc_startup_profile_destroy(startup_profile);
+        }
         return SCRCPY_EXIT_FAILURE;
     }
+    s->server_initialized = true;
 
     if (options->window) {
         // Set hints before starting the server thread to avoid race conditions
         // in SDL
-        sdl_set_hints(options->render_driver);
+        scrcpy_sdl_set_hints(options->render_driver);
     }
 
     if (!sc_server_start(&s->server)) {
         goto end;
     }
 
-    server_started = true;
+    s->server_started = true;
 
     if (options->list) {
         bool ok = await_for_server(NULL);
@@ -529,6 +853,10 @@ scrcpy(struct scrcpy_options *options) {
     assert(!options->video_playback || options->video);
     assert(!options->audio_playback || options->audio);
 
+    // The SDL subsystems are initialized while the server thread is starting
+    // the server
+    sc_startup_profile_begin(startup_profile, SC_STARTUP_PHASE_SDL_INIT);
+
     if (options->window ||
             (options->control && options->clipboard_autosync)) {
         // Initialize the video subsystem even if --no-video or
@@ -560,7 +888,38 @@ scrcpy(struct scrcpy_options *options) {
         }
     }
 
-    sdl_configure(options->video_playback, options->disable_screensaver);
+    scrcpy_sdl_configure(options->video_playback,
+                         options->disable_screensaver);
+
+    sc_startup_profile_end(startup_profile, SC_STARTUP_PHASE_SDL_INIT);
+
+    // The main thread uploads and renders the frames. It is pinned (if
+    // requested) only now, so that the threads created internally by SDL
+    // during its initialization are not.
+    sc_thread_apply_role(SC_THREAD_ROLE_RENDER);
+
+    if (options->session_cache && options->video) {
+        session_cache_path = sc_session_cache_get_path();
+        const char *expected_serial = get_expected_serial(options);
+        if (session_cache_path && expected_serial) {
+            // Open the decoder while the server is starting
+            session_hint_serial = expected_serial;
+            has_session_hint = sc_session_cache_load(session_cache_path,
+                                                     expected_serial,
+                                                     &session_hint);
+            if (has_session_hint) {
+                struct sc_stream_session session = {
+                    .video = {
+                        .width = session_hint.width,
+                        .height = session_hint.height,
+                    },
+                };
+                preopened_video_codec =
+                    sc_demuxer_preopen_video_codec(session_hint.codec_id,
+                                                   &session);
+            }
+        }
+    }
 
     // Await for server without blocking Ctrl+C handling
     bool connected;
@@ -578,17 +937,56 @@ scrcpy(struct scrcpy_options *options) {
 
     LOGD("Server connected");
 
+    sc_startup_profile_begin(startup_profile, SC_STARTUP_PHASE_INIT_COMPONENTS);
+
     // It is necessarily initialized here, since the device is connected
     struct sc_server_info *info = &s->server.info;
 
     const char *serial = s->server.serial;
     assert(serial);
 
+    if (options->reconnect) {
+        // The server (and its serial) is replaced on reconnection
+        s->reconnect_serial = strdup(serial);
+        if (!s->reconnect_serial) {
+            LOG_OOM();
+            goto end;
+        }
+        serial = s->reconnect_serial;
+
+        // Reconnect to the selected device, without configuring it again
+        s->reconnect_params = params;
+        s->reconnect_params.req_serial = serial;
+        s->reconnect_params.select_usb = false;
+        s->reconnect_params.select_tcpip = false;
+        s->reconnect_params.tcpip = false;
+        s->reconnect_params.tcpip_dst = NULL;
+        s->reconnect_params.kill_adb_on_close = false;
+        s->reconnect_params.startup_profile = NULL;
+    }
+
+    if (session_cache_path
+            && (!session_hint_serial || strcmp(session_hint_serial, serial))) {
+        // The serial was not known in advance, or it changed (--tcpip)
+        if (preopened_video_codec) {
+            avcodec_free_context(&preopened_video_codec);
+        }
+        session_hint_serial = serial;
+        has_session_hint = sc_session_cache_load(session_cache_path, serial,
+                                                 &session_hint);
+    }
+
+    if (has_session_hint) {
+        LOGD("Last session: %" PRIu32 "x%" PRIu32, session_hint.width,
+             session_hint.height);
+    }
+
     struct sc_file_pusher *fp = NULL;
 
     if (options->window && options->control) {
         if (!sc_file_pusher_init(&s->file_pusher, serial,
-                                 options->push_target)) {
+                                 options->push_target,
+                                 options->push_workers)) {
             goto end;
         }
         fp = &s->file_pusher;
@@ -598,6 +996,7 @@ scrcpy(struct scrcpy_options *options) {
     if (options->video) {
         static const struct sc_demuxer_callbacks video_demuxer_cbs = {
             .on_ended = sc_video_demuxer_on_ended,
+            .on_interrupted = sc_demuxer_on_interrupted,
         };
         sc_demuxer_init(&s->video_demuxer, "video", s->server.video_socket,
                         &video_demuxer_cbs, NULL);
@@ -606,23 +1005,60 @@ scrcpy(struct scrcpy_options *options) {
     if (options->audio) {
         static const struct sc_demuxer_callbacks audio_demuxer_cbs = {
             .on_ended = sc_audio_demuxer_on_ended,
+            .on_interrupted = sc_demuxer_on_interrupted,
         };
         sc_demuxer_init(&s->audio_demuxer, "audio", s->server.audio_socket,
                         &audio_demuxer_cbs, options);
     }
 
+    struct sc_metrics *metrics = NULL;
+    if (options->metrics_port) {
+        if (!sc_metrics_init(&s->metrics, options->video, options->audio)) {
+            goto end;
+        }
+        metrics_initialized = true;
+        metrics = &s->metrics;
+
+        if (!sc_metrics_start(metrics)) {
+            goto end;
+        }
+        metrics_started = true;
+
+        if (!sc_metrics_server_init(&s->metrics_server, metrics,
+                                    options->metrics_port)) {
+            goto end;
+        }
+        metrics_server_initialized = true;
+
+        if (!sc_metrics_server_start(&s->metrics_server)) {
+            goto end;
+        }
+        metrics_server_started = true;
+
+        if (options->video) {
+            sc_packet_source_add_sink(&s->video_demuxer.packet_source,
+                                      &metrics->video.packet_sink);
+        }
+        if (options->audio) {
+            sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
+                                      &metrics->audio.packet_sink);
+        }
+    }
+
     bool needs_video_decoder = options->video_playback;
     bool needs_audio_decoder = options->audio_playback;
 #ifdef HAVE_V4L2
     needs_video_decoder |= !!options->v4l2_device;
 #endif
     if (needs_video_decoder) {
-        sc_decoder_init(&s->video_decoder, "video");
+        sc_decoder_init(&s->video_decoder, "video",
+                        metrics ? &metrics->video : NULL);
         sc_packet_source_add_sink(&s->video_demuxer.packet_source,
                                   &s->video_decoder.packet_sink);
     }
     if (needs_audio_decoder) {
-        sc_decoder_init(&s->audio_decoder, "audio");
+        sc_decoder_init(&s->audio_decoder, "audio",
+                        metrics ? &metrics->audio : NULL);
         sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
                                   &s->audio_decoder.packet_sink);
     }
@@ -658,6 +1094,7 @@ scrcpy(struct scrcpy_options *options) {
     struct sc_key_processor *kp = NULL;
     struct sc_mouse_processor *mp = NULL;
     struct sc_gamepad_processor *gp = NULL;
+    struct sc_latency_probe *latency_probe = NULL;
 
     if (options->control) {
         static const struct sc_controller_callbacks controller_cbs = {
@@ -665,7 +1102,7 @@ scrcpy(struct scrcpy_options *options) {
         };
 
         if (!sc_controller_init(&s->controller, s->server.control_socket,
-            &controller_cbs, NULL)) {
+            &controller_cbs, options)) {
             goto end;
         }
         controller_initialized = true;
@@ -735,7 +1172,8 @@ scrcpy(struct scrcpy_options *options) {
             }
 
             if (use_mouse_aoa) {
-                if (sc_mouse_aoa_init(&s->mouse_aoa, &s->aoa)) {
+                if (sc_mouse_aoa_init(&s->mouse_aoa, &s->aoa,
+                                      options->hid_report_rate)) {
                     mouse_aoa_initialized = true;
                     mp = &s->mouse_aoa.mouse_processor;
                 } else {
@@ -746,13 +1184,25 @@ scrcpy(struct scrcpy_options *options) {
             }
 
             if (use_gamepad_aoa) {
-                sc_gamepad_aoa_init(&s->gamepad_aoa, &s->aoa);
-                gp = &s->gamepad_aoa.gamepad_processor;
-                gamepad_aoa_initialized = true;
+                if (sc_gamepad_aoa_init(&s->gamepad_aoa, &s->aoa,
+                                        options->hid_report_rate)) {
+                    gamepad_aoa_initialized = true;
+                    gp = &s->gamepad_aoa.gamepad_processor;
+                } else {
+                    LOGE("Could not initialize HID gamepad");
+                    aoa_fail = true;
+                    goto aoa_complete;
+                }
             }
 
 aoa_complete:
             if (aoa_fail || !sc_aoa_start(&s->aoa)) {
+                if (mouse_aoa_initialized) {
+                    sc_mouse_aoa_destroy(&s->mouse_aoa);
+                }
+                if (gamepad_aoa_initialized) {
+                    sc_gamepad_aoa_destroy(&s->gamepad_aoa);
+                }
                 sc_acksync_destroy(&s->acksync);
                 sc_usb_disconnect(&s->usb);
                 sc_usb_destroy(&s->usb);
@@ -791,15 +1241,22 @@ aoa_complete:
                               options->mouse_hover);
             mp = &s->mouse_sdk.mouse_processor;
         } else if (options->mouse_input_mode == SC_MOUSE_INPUT_MODE_UHID) {
-            bool ok = sc_mouse_uhid_init(&s->mouse_uhid, &s->controller);
+            bool ok = sc_mouse_uhid_init(&s->mouse_uhid, &s->controller,
+                                         options->hid_report_rate);
             if (!ok) {
                 goto end;
             }
+            mouse_uhid_initialized = true;
             mp = &s->mouse_uhid.mouse_processor;
         }
 
         if (options->gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_UHID) {
-            sc_gamepad_uhid_init(&s->gamepad_uhid, &s->controller);
+            bool ok = sc_gamepad_uhid_init(&s->gamepad_uhid, &s->controller,
+                                           options->hid_report_rate);
+            if (!ok) {
+                goto end;
+            }
+            gamepad_uhid_initialized = true;
             gp = &s->gamepad_uhid.gamepad_processor;
         }
 
@@ -809,12 +1266,25 @@ aoa_complete:
             uhid_devices = &s->uhid_devices;
         }
 
-        sc_controller_configure(&s->controller, acksync, uhid_devices);
+        if (options->latency_probe) {
+            if (!sc_latency_probe_init(&s->latency_probe)) {
+                goto end;
+            }
+            latency_probe_initialized = true;
+            latency_probe = &s->latency_probe;
+        }
+
+        sc_controller_configure(&s->controller, acksync, uhid_devices,
+                                latency_probe);
+
+        if (options->compact_control) {
+            sc_controller_enable_compact_encoding(&s->controller);
+        }
 
         if (!sc_controller_start(&s->controller)) {
             goto end;
         }
-        controller_started = true;
+        s->controller_running = true;
     }
 
     // There is a controller if and only if control is enabled
@@ -824,11 +1294,20 @@ aoa_complete:
         const char *window_title =
             options->window_title ? options->window_title : info->device_name;
 
+        struct sc_frame_pacer *frame_pacer = NULL;
+        if (options->video_playback && options->frame_pacing) {
+            sc_frame_pacer_init(&s->frame_pacer, options->frame_pacing);
+            frame_pacer = &s->frame_pacer;
+        }
+
         struct sc_screen_params screen_params = {
             .video = options->video_playback,
             .camera = options->video_source == SC_VIDEO_SOURCE_CAMERA,
             .controller = controller,
             .fp = fp,
+            .latency_probe = latency_probe,
+            .metrics = metrics,
+            .frame_pacer = frame_pacer,
             .kp = kp,
             .mp = mp,
             .gp = gp,
@@ -845,8 +1324,10 @@ aoa_complete:
             .window_borderless = options->window_borderless,
             .orientation = options->display_orientation,
             .mipmaps = options->mipmaps,
+            .downscale_filter = options->downscale_filter,
             .fullscreen = options->fullscreen,
             .start_fps_counter = options->start_fps_counter,
+            .late_latch = options->late_latch,
         };
 
         if (!sc_screen_init(&s->screen, &screen_params)) {
@@ -854,6 +1335,17 @@ aoa_complete:
         }
         screen_initialized = true;
 
+        if (has_session_hint && options->video_playback) {
+            // Show the window without waiting for the first frame
+            struct sc_size frame_size = {
+                .width = session_hint.width,
+                .height = session_hint.height,
+            };
+            sc_screen_prepare_video(&s->screen, frame_size,
+                                    session_hint.color_space,
+                                    session_hint.color_range);
+        }
+
         if (options->video_playback) {
             struct sc_frame_source *src = &s->video_decoder.frame_source;
             if (options->video_buffer) {
@@ -863,20 +1355,31 @@ aoa_complete:
                 src = &s->video_buffer.frame_source;
             }
 
+            if (frame_pacer) {
+                sc_frame_source_add_sink(src, &frame_pacer->frame_sink);
+                src = &frame_pacer->frame_source;
+            }
+
             sc_frame_source_add_sink(src, &s->screen.frame_sink);
+
+            if (latency_probe) {
+                // Frames are considered when they are sent to the screen
+                sc_frame_source_add_sink(src, &latency_probe->frame_sink);
+            }
         }
     }
 
     if (options->audio_playback) {
         sc_audio_player_init(&s->audio_player, options->audio_buffer,
-                             options->audio_output_buffer);
+                             options->audio_output_buffer, metrics);
         sc_frame_source_add_sink(&s->audio_decoder.frame_source,
                                  &s->audio_player.frame_sink);
     }
 
 #ifdef HAVE_V4L2
     if (options->v4l2_device) {
-        if (!sc_v4l2_sink_init(&s->v4l2_sink, options->v4l2_device)) {
+        if (!sc_v4l2_sink_init(&s->v4l2_sink, options->v4l2_device,
+                               options->v4l2_orientation)) {
             goto end;
         }
 
@@ -893,21 +1396,74 @@ aoa_complete:
     }
 #endif
 
+    if (options->reconnect) {
+        static const struct sc_link_monitor_callbacks link_monitor_cbs = {
+            .on_stalled = sc_link_monitor_on_stalled,
+            .on_retry = sc_link_monitor_on_retry,
+        };
+        if (!sc_link_monitor_init(&s->link_monitor, SC_LINK_STALL_TIMEOUT,
+                                  &link_monitor_cbs, NULL)) {
+            goto end;
+        }
+        link_monitor_initialized = true;
+
+        // Keep the sinks open when the connection is lost
+        if (options->video) {
+            if (!sc_demuxer_enable_resume(&s->video_demuxer)) {
+                goto end;
+            }
+            sc_link_monitor_add_demuxer(&s->link_monitor, &s->video_demuxer);
+        }
+        if (options->audio) {
+            if (!sc_demuxer_enable_resume(&s->audio_demuxer)) {
+                goto end;
+            }
+            sc_link_monitor_add_demuxer(&s->link_monitor, &s->audio_demuxer);
+        }
+    }
+
     // Now that the header values have been consumed, the socket(s) will
     // receive the stream(s). Start the demuxer(s).
 
     if (options->video) {
+        if (preopened_video_codec) {
+            // The demuxer takes ownership
+            sc_demuxer_set_preopened_codec(&s->video_demuxer,
+                                           preopened_video_codec);
+            preopened_video_codec = NULL;
+        }
+
         if (!sc_demuxer_start(&s->video_demuxer)) {
             goto end;
         }
-        video_demuxer_started = true;
+        s->video_demuxer_started = true;
     }
 
     if (options->audio) {
         if (!sc_demuxer_start(&s->audio_demuxer)) {
             goto end;
         }
-        audio_demuxer_started = true;
+        s->audio_demuxer_started = true;
+    }
+
+    if (link_monitor_initialized) {
+        if (!sc_link_monitor_start(&s->link_monitor)) {
+            goto end;
+        }
+        link_monitor_started = true;
+        sc_link_monitor_arm(&s->link_monitor);
+    }
+
+    sc_startup_profile_end(startup_profile, SC_STARTUP_PHASE_INIT_COMPONENTS);
+    if (startup_profile) {
+        if (options->window && options->video_playback) {
+            // Log on first frame
+            sc_startup_profile_begin(startup_profile,
+                                     SC_STARTUP_PHASE_FIRST_FRAME);
+            s->pending_startup_profile = startup_profile;
+        } else {
+            sc_startup_profile_log(startup_profile);
+        }
     }
 
     // If the device screen is to be turned off, send the control message after
@@ -975,20 +1531,25 @@ end:
     if (timeout_started) {
         sc_timeout_stop(&s->timeout);
     }
+    if (link_monitor_started) {
+        sc_link_monitor_stop(&s->link_monitor);
+    }
 
-    // The demuxer is not stopped explicitly, because it will stop by itself on
-    // end-of-stream
+    // A non-resumable demuxer is not stopped explicitly, because it will stop
+    // by itself on end-of-stream
+    if (options->reconnect) {
+        if (s->video_demuxer_started) {
+            sc_demuxer_stop(&s->video_demuxer);
+        }
+        if (s->audio_demuxer_started) {
+            sc_demuxer_stop(&s->audio_demuxer);
+        }
+    }
 #ifdef HAVE_USB
     if (aoa_hid_initialized) {
         if (keyboard_aoa_initialized) {
             sc_keyboard_aoa_destroy(&s->keyboard_aoa);
         }
-        if (mouse_aoa_initialized) {
-            sc_mouse_aoa_destroy(&s->mouse_aoa);
-        }
-        if (gamepad_aoa_initialized) {
-            sc_gamepad_aoa_destroy(&s->gamepad_aoa);
-        }
         sc_aoa_stop(&s->aoa);
         sc_usb_stop(&s->usb);
     }
@@ -996,12 +1557,18 @@ end:
         sc_acksync_destroy(acksync);
     }
 #endif
-    if (controller_started) {
+    if (s->controller_running) {
         sc_controller_stop(&s->controller);
     }
     if (file_pusher_initialized) {
         sc_file_pusher_stop(&s->file_pusher);
     }
+    if (metrics_server_started) {
+        sc_metrics_server_stop(&s->metrics_server);
+    }
+    if (metrics_started) {
+        sc_metrics_stop(&s->metrics);
+    }
     if (recorder_initialized) {
         sc_recorder_stop(&s->recorder);
     }
@@ -1009,7 +1576,12 @@ end:
         sc_screen_interrupt(&s->screen);
     }
 
-    if (server_started) {
+    if (s->server_started) {
+        if (options->reconnect) {
+            // It may have been disabled for the reconnections
+            s->server.params.kill_adb_on_close = options->kill_adb_on_close;
+        }
+
         // shutdown the sockets and kill the server
         sc_server_stop(&s->server);
     }
@@ -1040,13 +1612,67 @@ end:
         sc_timeout_destroy(&s->timeout);
     }
 
+    // Destroy the HID processors (which may own a coalescer thread) once no
+    // input event may be received anymore, but before their sinks
+    if (mouse_uhid_initialized) {
+        sc_mouse_uhid_destroy(&s->mouse_uhid);
+    }
+    if (gamepad_uhid_initialized) {
+        sc_gamepad_uhid_destroy(&s->gamepad_uhid);
+    }
+#ifdef HAVE_USB
+    if (aoa_hid_initialized) {
+        if (mouse_aoa_initialized) {
+            sc_mouse_aoa_destroy(&s->mouse_aoa);
+        }
+        if (gamepad_aoa_initialized) {
+            sc_gamepad_aoa_destroy(&s->gamepad_aoa);
+        }
+    }
+#endif
+
+    if (link_monitor_started) {
+        sc_link_monitor_join(&s->link_monitor);
+    }
+    if (link_monitor_initialized) {
+        sc_link_monitor_log_stats(&s->link_monitor);
+        sc_link_monitor_destroy(&s->link_monitor);
+    }
+
     // now that the sockets are shutdown, the demuxer and controller are
     // interrupted, we can join them
-    if (video_demuxer_started) {
+    if (s->video_demuxer_started) {
         sc_demuxer_join(&s->video_demuxer);
+
+        if (session_cache_path && s->video_demuxer.has_session) {
+            struct sc_demuxer *demuxer = &s->video_demuxer;
+            struct sc_session_hint hint = {
+                .codec_id = demuxer->codec_id,
+                .width = demuxer->session.video.width,
+                .height = demuxer->session.video.height,
+                .color_space = 0,
+                .color_range = 0,
+            };
+            if (screen_initialized && s->screen.has_frame) {
+                hint.color_space = s->screen.tex.color_space;
+                hint.color_range = s->screen.tex.color_range;
+            }
+
+            if (!has_session_hint
+                    || memcmp(&hint, &session_hint, sizeof(hint))) {
+                assert(session_hint_serial);
+                sc_session_cache_save(session_cache_path, session_hint_serial,
+                                      &hint);
+            }
+        }
+    }
+
+    if (preopened_video_codec) {
+        // Not used
+        avcodec_free_context(&preopened_video_codec);
     }
 
-    if (audio_demuxer_started) {
+    if (s->audio_demuxer_started) {
         sc_demuxer_join(&s->audio_demuxer);
     }
 
@@ -1074,13 +1700,35 @@ end:
         sc_screen_destroy(&s->screen);
     }
 
-    if (controller_started) {
+    if (s->controller_running) {
         sc_controller_join(&s->controller);
     }
     if (controller_initialized) {
         sc_controller_destroy(&s->controller);
     }
 
+    // Destroy the latency probe once the receiver (in the controller) and the
+    // video demuxer (which pushes the frames) are joined
+    if (latency_probe_initialized) {
+        sc_latency_probe_log_stats(&s->latency_probe);
+        sc_latency_probe_destroy(&s->latency_probe);
+    }
+
+    // The metrics are fed by the demuxers, the screen and the audio player,
+    // destroy them once they are all joined
+    if (metrics_server_started) {
+        sc_metrics_server_join(&s->metrics_server);
+    }
+    if (metrics_server_initialized) {
+        sc_metrics_server_destroy(&s->metrics_server);
+    }
+    if (metrics_started) {
+        sc_metrics_join(&s->metrics);
+    }
+    if (metrics_initialized) {
+        sc_metrics_destroy(&s->metrics);
+    }
+
     if (recorder_started) {
         sc_recorder_join(&s->recorder);
     }
@@ -1093,11 +1741,23 @@ end:
         sc_file_pusher_destroy(&s->file_pusher);
     }
 
-    if (server_started) {
+    if (s->server_started) {
         sc_server_join(&s->server);
     }
+    if (s->server_initialized) {
+        sc_server_destroy(&s->server);
+    }
 
-    sc_server_destroy(&s->server);
+    free(session_cache_path);
+    free(s->reconnect_serial);
+
+    if (startup_profile) {
+        if (s->pending_startup_profile) {
+            // No frame has been received, log the phases anyway
+            sc_startup_profile_log(startup_profile);
+        }
+        sc_startup_profile_destroy(startup_profile);
+    }
 
     return ret;
 }
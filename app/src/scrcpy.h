@@ -3,7 +3,10 @@
 
 #include "common.h"
 
+#include <stdbool.h>
+
 #include "options.h"
+#include "server.h"
 
 enum scrcpy_exit_code {
     // Normal program termination
@@ -19,4 +22,19 @@ enum scrcpy_exit_code {
 enum scrcpy_exit_code
 scrcpy(struct scrcpy_options *options);
 
+/**
+ * Initialize the server parameters from the options
+ *
+ * A new scrcpy id is generated on each call.
+ */
+void
+scrcpy_init_server_params(struct sc_server_params *params,
+                          const struct scrcpy_options *options);
+
+void
+scrcpy_sdl_set_hints(const char *render_driver);
+
+void
+scrcpy_sdl_configure(bool video_playback, bool disable_screensaver);
+
 #endif
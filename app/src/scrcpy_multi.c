@@ -0,0 +1,1003 @@
+#include "scrcpy_multi.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL3/SDL.h>
+
+#include "adb/adb.h"
+#include "audio_player.h"
+#include "compositor.h"
+#include "controller.h"
+#include "decoder.h"
+#include "delay_buffer.h"
+#include "demuxer.h"
+#include "events.h"
+#include "file_pusher.h"
+#include "keyboard_sdk.h"
+#include "mouse_sdk.h"
+#include "screen.h"
+#include "server.h"
+#include "uhid/keyboard_uhid.h"
+#include "uhid/mouse_uhid.h"
+#include "util/log.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+enum sc_device_session_state {
+    // The server is not started
+    SC_DEVICE_SESSION_STATE_NONE,
+    // The server is started, waiting for the device connection
+    SC_DEVICE_SESSION_STATE_CONNECTING,
+    SC_DEVICE_SESSION_STATE_RUNNING,
+    // The session is interrupted, it will be joined on exit
+    SC_DEVICE_SESSION_STATE_ENDED,
+};
+
+struct sc_device_session {
+    const struct scrcpy_options *options;
+    const char *req_serial;
+
+    enum sc_device_session_state state;
+    enum scrcpy_exit_code exit_code; // valid once ended
+
+    struct sc_server server;
+    struct sc_screen screen;
+    struct sc_audio_player audio_player;
+    struct sc_demuxer video_demuxer;
+    struct sc_demuxer audio_demuxer;
+    struct sc_decoder video_decoder;
+    struct sc_decoder audio_decoder;
+    struct sc_delay_buffer video_buffer;
+    struct sc_controller controller;
+    struct sc_file_pusher file_pusher;
+    struct sc_uhid_devices uhid_devices;
+    union {
+        struct sc_keyboard_sdk keyboard_sdk;
+        struct sc_keyboard_uhid keyboard_uhid;
+    };
+    union {
+        struct sc_mouse_sdk mouse_sdk;
+        struct sc_mouse_uhid mouse_uhid;
+    };
+
+    bool server_initialized;
+    bool file_pusher_initialized;
+    bool video_demuxer_started;
+    bool audio_demuxer_started;
+    bool video_decoder_initialized;
+    bool audio_decoder_initialized;
+    bool controller_initialized;
+    bool controller_started;
+    bool screen_initialized;
+
+    char *window_title; // owned, NULL if --window-title is set
+
+    // The tile of the video wall (only used with --video-wall)
+    struct sc_frame_sink *tile_sink;
+
+    // For the resource accounting
+    sc_tick start_date;
+    sc_tick end_date;
+};
+
+struct scrcpy_multi {
+    struct sc_device_session *sessions;
+    unsigned count;
+    // Number of sessions not ended
+    unsigned active;
+
+    struct sc_compositor compositor; // only used with --video-wall
+    bool compositor_initialized;
+};
+
+static void
+sc_video_demuxer_on_ended(struct sc_demuxer *demuxer,
+                          enum sc_demuxer_status status, void *userdata) {
+    (void) demuxer;
+
+    struct sc_device_session *s = userdata;
+
+    // The device may not decide to disable the video
+    assert(status != SC_DEMUXER_STATUS_DISABLED);
+
+    if (status == SC_DEMUXER_STATUS_EOS) {
+        sc_push_event_with_data(SC_EVENT_DEVICE_DISCONNECTED, s);
+    } else {
+        sc_push_event_with_data(SC_EVENT_DEMUXER_ERROR, s);
+    }
+}
+
+static void
+sc_audio_demuxer_on_ended(struct sc_demuxer *demuxer,
+                          enum sc_demuxer_status status, void *userdata) {
+    (void) demuxer;
+
+    struct sc_device_session *s = userdata;
+
+    // Contrary to the video demuxer, keep mirroring if only the audio fails
+    // (unless --require-audio is set).
+    if (status == SC_DEMUXER_STATUS_EOS) {
+        sc_push_event_with_data(SC_EVENT_DEVICE_DISCONNECTED, s);
+    } else if (status == SC_DEMUXER_STATUS_ERROR
+            || (status == SC_DEMUXER_STATUS_DISABLED
+                && s->options->require_audio)) {
+        sc_push_event_with_data(SC_EVENT_DEMUXER_ERROR, s);
+    }
+}
+
+static void
+sc_controller_on_ended(struct sc_controller *controller, bool error,
+                       void *userdata) {
+    // Note: this function may be called twice, once from the controller thread
+    // and once from the receiver thread
+    (void) controller;
+
+    struct sc_device_session *s = userdata;
+
+    if (error) {
+        sc_push_event_with_data(SC_EVENT_CONTROLLER_ERROR, s);
+    } else {
+        sc_push_event_with_data(SC_EVENT_DEVICE_DISCONNECTED, s);
+    }
+}
+
+static void
+sc_server_on_connection_failed(struct sc_server *server, void *userdata) {
+    (void) server;
+
+    sc_push_event_with_data(SC_EVENT_SERVER_CONNECTION_FAILED, userdata);
+}
+
+static void
+sc_server_on_connected(struct sc_server *server, void *userdata) {
+    (void) server;
+
+    sc_push_event_with_data(SC_EVENT_SERVER_CONNECTED, userdata);
+}
+
+static void
+sc_server_on_disconnected(struct sc_server *server, void *userdata) {
+    (void) server;
+    (void) userdata;
+
+    LOGD("Server disconnected");
+    // Do nothing, the disconnection will be handled by the "stream stopped"
+    // event
+}
+
+static bool
+sc_device_session_start(struct sc_device_session *s,
+                        const struct scrcpy_options *options,
+                        const char *serial) {
+    struct sc_server_params params;
+    scrcpy_init_server_params(&params, options);
+    params.req_serial = serial;
+    // Started once for all the devices
+    params.adb_server_started = true;
+
+    static const struct sc_server_callbacks cbs = {
+        .on_connection_failed = sc_server_on_connection_failed,
+        .on_connected = sc_server_on_connected,
+        .on_disconnected = sc_server_on_disconnected,
+    };
+    if (!sc_server_init(&s->server, &params, &cbs, s)) {
+        return false;
+    }
+    s->server_initialized = true;
+
+    if (!sc_server_start(&s->server)) {
+        return false;
+    }
+
+    s->state = SC_DEVICE_SESSION_STATE_CONNECTING;
+    return true;
+}
+
+// Called once the server is connected
+static bool
+sc_device_session_init_components(struct sc_device_session *s) {
+    const struct scrcpy_options *options = s->options;
+
+    // It is necessarily initialized here, since the device is connected
+    struct sc_server_info *info = &s->server.info;
+
+    const char *serial = s->server.serial;
+    assert(serial);
+
+    LOGI("Device %s connected: %s", serial, info->device_name);
+
+    struct sc_file_pusher *fp = NULL;
+
+    // The video wall is a monitoring view, it does not forward any input
+    bool forward_inputs = !options->video_wall;
+
+    if (forward_inputs && options->window && options->control) {
+        if (!sc_file_pusher_init(&s->file_pusher, serial,
+                                 options->push_target,
+                                 options->push_workers)) {
+            return false;
+        }
+        fp = &s->file_pusher;
+        s->file_pusher_initialized = true;
+    }
+
+    if (options->video) {
+        static const struct sc_demuxer_callbacks video_demuxer_cbs = {
+            .on_ended = sc_video_demuxer_on_ended,
+        };
+        sc_demuxer_init(&s->video_demuxer, "video", s->server.video_socket,
+                        &video_demuxer_cbs, s);
+    }
+
+    if (options->audio) {
+        static const struct sc_demuxer_callbacks audio_demuxer_cbs = {
+            .on_ended = sc_audio_demuxer_on_ended,
+        };
+        sc_demuxer_init(&s->audio_demuxer, "audio", s->server.audio_socket,
+                        &audio_demuxer_cbs, s);
+    }
+
+    if (options->video_playback) {
+        sc_decoder_init(&s->video_decoder, "video", NULL);
+        sc_packet_source_add_sink(&s->video_demuxer.packet_source,
+                                  &s->video_decoder.packet_sink);
+        s->video_decoder_initialized = true;
+    }
+    if (options->audio_playback) {
+        sc_decoder_init(&s->audio_decoder, "audio", NULL);
+        sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
+                                  &s->audio_decoder.packet_sink);
+        s->audio_decoder_initialized = true;
+    }
+
+    struct sc_controller *controller = NULL;
+    struct sc_key_processor *kp = NULL;
+    struct sc_mouse_processor *mp = NULL;
+
+    if (options->control) {
+        static const struct sc_controller_callbacks controller_cbs = {
+            .on_ended = sc_controller_on_ended,
+        };
+
+        if (!sc_controller_init(&s->controller, s->server.control_socket,
+                                &controller_cbs, s)) {
+            return false;
+        }
+        s->controller_initialized = true;
+
+        controller = &s->controller;
+
+        // AOA and gamepads are rejected by the command line parser
+        assert(options->keyboard_input_mode != SC_KEYBOARD_INPUT_MODE_AOA);
+        assert(options->mouse_input_mode != SC_MOUSE_INPUT_MODE_AOA);
+        assert(options->gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_DISABLED);
+
+        struct sc_keyboard_uhid *uhid_keyboard = NULL;
+
+        if (forward_inputs
+                && options->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_SDK) {
+            sc_keyboard_sdk_init(&s->keyboard_sdk, &s->controller,
+                                 options->key_inject_mode,
+                                 options->forward_key_repeat);
+            kp = &s->keyboard_sdk.key_processor;
+        } else if (forward_inputs && options->keyboard_input_mode
+                == SC_KEYBOARD_INPUT_MODE_UHID) {
+            bool ok = sc_keyboard_uhid_init(&s->keyboard_uhid, &s->controller);
+            if (!ok) {
+                return false;
+            }
+            kp = &s->keyboard_uhid.key_processor;
+            uhid_keyboard = &s->keyboard_uhid;
+        }
+
+        if (forward_inputs
+                && options->mouse_input_mode == SC_MOUSE_INPUT_MODE_SDK) {
+            sc_mouse_sdk_init(&s->mouse_sdk, &s->controller,
+                              options->mouse_hover);
+            mp = &s->mouse_sdk.mouse_processor;
+        } else if (forward_inputs
+                && options->mouse_input_mode == SC_MOUSE_INPUT_MODE_UHID) {
+            bool ok = sc_mouse_uhid_init(&s->mouse_uhid, &s->controller,
+                                         options->hid_report_rate);
+            if (!ok) {
+                return false;
+            }
+            mp = &s->mouse_uhid.mouse_processor;
+        }
+
+        struct sc_uhid_devices *uhid_devices = NULL;
+        if (uhid_keyboard) {
+            sc_uhid_devices_init(&s->uhid_devices, uhid_keyboard);
+            uhid_devices = &s->uhid_devices;
+        }
+
+        sc_controller_configure(&s->controller, NULL, uhid_devices, NULL);
+
+        if (options->compact_control) {
+            sc_controller_enable_compact_encoding(&s->controller);
+        }
+
+        if (!sc_controller_start(&s->controller)) {
+            return false;
+        }
+        s->controller_started = true;
+    }
+
+    struct sc_frame_sink *video_sink = NULL;
+
+    if (options->video_wall) {
+        assert(s->tile_sink);
+        video_sink = s->tile_sink;
+    } else if (options->window) {
+        const char *window_title = options->window_title;
+        if (!window_title) {
+            // Several devices may have the same name, add the serial
+            size_t len = strlen(info->device_name) + strlen(serial) + 4;
+            s->window_title = malloc(len);
+            if (!s->window_title) {
+                LOG_OOM();
+                return false;
+            }
+            snprintf(s->window_title, len, "%s (%s)", info->device_name,
+                     serial);
+            window_title = s->window_title;
+        }
+
+        struct sc_screen_params screen_params = {
+            .video = options->video_playback,
+            .camera = options->video_source == SC_VIDEO_SOURCE_CAMERA,
+            .controller = controller,
+            .fp = fp,
+            .latency_probe = NULL,
+            .metrics = NULL,
+            .kp = kp,
+            .mp = mp,
+            .gp = NULL,
+            .mouse_bindings = options->mouse_bindings,
+            .legacy_paste = options->legacy_paste,
+            .clipboard_autosync = options->clipboard_autosync,
+            .shortcut_mods = options->shortcut_mods,
+            .window_title = window_title,
+            .always_on_top = options->always_on_top,
+            .window_x = options->window_x,
+            .window_y = options->window_y,
+            .window_width = options->window_width,
+            .window_height = options->window_height,
+            .window_borderless = options->window_borderless,
+            .orientation = options->display_orientation,
+            .mipmaps = options->mipmaps,
+            .downscale_filter = options->downscale_filter,
+            .fullscreen = options->fullscreen,
+            .start_fps_counter = options->start_fps_counter,
+        };
+
+        if (!sc_screen_init(&s->screen, &screen_params)) {
+            return false;
+        }
+        s->screen_initialized = true;
+
+        if (options->video_playback) {
+            video_sink = &s->screen.frame_sink;
+        }
+    }
+
+    if (video_sink) {
+        struct sc_frame_source *src = &s->video_decoder.frame_source;
+        if (options->video_buffer) {
+            sc_delay_buffer_init(&s->video_buffer, options->video_buffer,
+                                 true);
+            sc_frame_source_add_sink(src, &s->video_buffer.frame_sink);
+            src = &s->video_buffer.frame_source;
+        }
+
+        sc_frame_source_add_sink(src, video_sink);
+    }
+
+    if (options->audio_playback) {
+        sc_audio_player_init(&s->audio_player, options->audio_buffer,
+                             options->audio_output_buffer, NULL);
+        sc_frame_source_add_sink(&s->audio_decoder.frame_source,
+                                 &s->audio_player.frame_sink);
+    }
+
+    // Now that the header values have been consumed, the socket(s) will
+    // receive the stream(s). Start the demuxer(s).
+
+    if (options->video) {
+        if (!sc_demuxer_start(&s->video_demuxer)) {
+            return false;
+        }
+        s->video_demuxer_started = true;
+    }
+
+    if (options->audio) {
+        if (!sc_demuxer_start(&s->audio_demuxer)) {
+            return false;
+        }
+        s->audio_demuxer_started = true;
+    }
+
+    s->start_date = sc_tick_now();
+
+    // If the device screen is to be turned off, send the control message after
+    // everything is set up
+    if (options->control && options->turn_screen_off) {
+        struct sc_control_msg msg;
+        msg.type = SC_CONTROL_MSG_TYPE_SET_DISPLAY_POWER;
+        msg.set_display_power.on = false;
+
+        if (!sc_controller_push_msg(&s->controller, &msg)) {
+            LOGW("Could not request 'set display power'");
+        }
+    }
+
+    if (options->control && options->start_app) {
+        assert(controller);
+
+        char *name = strdup(options->start_app);
+        if (!name) {
+            LOG_OOM();
+            return false;
+        }
+
+        struct sc_control_msg msg;
+        msg.type = SC_CONTROL_MSG_TYPE_START_APP;
+        msg.start_app.name = name;
+
+        if (!sc_controller_push_msg(controller, &msg)) {
+            LOGW("Could not request start app '%s'", name);
+            free(name);
+        }
+    }
+
+    s->state = SC_DEVICE_SESSION_STATE_RUNNING;
+    return true;
+}
+
+// Stop the session without blocking, the other devices are still mirrored
+static void
+sc_device_session_interrupt(struct sc_device_session *s) {
+    if (s->controller_started) {
+        sc_controller_stop(&s->controller);
+    }
+    if (s->file_pusher_initialized) {
+        sc_file_pusher_stop(&s->file_pusher);
+    }
+    if (s->screen_initialized) {
+        sc_screen_interrupt(&s->screen);
+        sc_screen_hide_window(&s->screen);
+    }
+    if (s->state != SC_DEVICE_SESSION_STATE_NONE) {
+        // shutdown the sockets and kill the server
+        sc_server_stop(&s->server);
+    }
+
+    if (s->start_date) {
+        s->end_date = sc_tick_now();
+    }
+}
+
+static void
+sc_device_session_log_stats(struct sc_device_session *s) {
+    const char *serial = s->server.serial ? s->server.serial : s->req_serial;
+
+    sc_tick duration = s->end_date - s->start_date;
+    LOGI("Device %s: mirrored for %" PRItick " s", serial,
+         SC_TICK_TO_SEC(duration));
+
+    if (s->video_demuxer_started) {
+        struct sc_demuxer *demuxer = &s->video_demuxer;
+        LOGI("Device %s: video: %" PRIu64 " packets (%" PRIu64 " KiB)",
+             serial, demuxer->packet_count, demuxer->byte_count / 1024);
+    }
+
+    if (s->video_decoder_initialized && s->video_decoder.frame_count) {
+        struct sc_decoder *decoder = &s->video_decoder;
+        LOGI("Device %s: video: %" PRIu64 " frames decoded in %" PRItick
+             " ms (%" PRItick " us/frame)", serial, decoder->frame_count,
+             SC_TICK_TO_MS(decoder->decode_time),
+             SC_TICK_TO_US(decoder->decode_time) /
+                (sc_tick) decoder->frame_count);
+    }
+
+    if (s->audio_demuxer_started) {
+        struct sc_demuxer *demuxer = &s->audio_demuxer;
+        LOGI("Device %s: audio: %" PRIu64 " packets (%" PRIu64 " KiB)",
+             serial, demuxer->packet_count, demuxer->byte_count / 1024);
+    }
+}
+
+static void
+sc_device_session_destroy(struct sc_device_session *s) {
+    // now that the sockets are shutdown, the demuxer and controller are
+    // interrupted, we can join them
+    if (s->video_demuxer_started) {
+        sc_demuxer_join(&s->video_demuxer);
+    }
+
+    if (s->audio_demuxer_started) {
+        sc_demuxer_join(&s->audio_demuxer);
+    }
+
+    // Destroy the screen only after the video demuxer is guaranteed to be
+    // finished, because otherwise the screen could receive new frames after
+    // destruction
+    if (s->screen_initialized) {
+        sc_screen_join(&s->screen);
+        sc_screen_destroy(&s->screen);
+    }
+
+    if (s->controller_started) {
+        sc_controller_join(&s->controller);
+    }
+    if (s->controller_initialized) {
+        sc_controller_destroy(&s->controller);
+    }
+
+    if (s->file_pusher_initialized) {
+        sc_file_pusher_join(&s->file_pusher);
+        sc_file_pusher_destroy(&s->file_pusher);
+    }
+
+    // The decoders are not used anymore once the demuxers are joined
+    if (s->start_date) {
+        sc_device_session_log_stats(s);
+    }
+
+    if (s->state != SC_DEVICE_SESSION_STATE_NONE) {
+        sc_server_join(&s->server);
+    }
+    if (s->server_initialized) {
+        sc_server_destroy(&s->server);
+    }
+
+    free(s->window_title);
+}
+
+static void
+end_session(struct scrcpy_multi *m, struct sc_device_session *s,
+            enum scrcpy_exit_code exit_code) {
+    assert(s->state == SC_DEVICE_SESSION_STATE_CONNECTING
+        || s->state == SC_DEVICE_SESSION_STATE_RUNNING);
+
+    sc_device_session_interrupt(s);
+    s->state = SC_DEVICE_SESSION_STATE_ENDED;
+    s->exit_code = exit_code;
+
+    if (m->compositor_initialized) {
+        sc_compositor_remove_tile(&m->compositor, s - m->sessions);
+    }
+
+    assert(m->active);
+    --m->active;
+}
+
+static struct sc_device_session *
+get_session_from_event(const SDL_Event *event) {
+    struct sc_device_session *s = event->user.data1;
+    assert(s);
+    return s;
+}
+
+static struct sc_device_session *
+get_session_from_window(struct scrcpy_multi *m, SDL_Window *window) {
+    for (unsigned i = 0; i < m->count; ++i) {
+        struct sc_device_session *s = &m->sessions[i];
+        if (s->screen_initialized && s->screen.window == window) {
+            return s;
+        }
+    }
+
+    return NULL;
+}
+
+static bool
+is_session_running(struct sc_device_session *s) {
+    return s->state == SC_DEVICE_SESSION_STATE_RUNNING;
+}
+
+static void
+handle_screen_event(struct scrcpy_multi *m, struct sc_device_session *s,
+                    const SDL_Event *event) {
+    if (!is_session_running(s) || !s->screen_initialized) {
+        // ignore
+        return;
+    }
+
+    if (!sc_screen_handle_event(&s->screen, event)) {
+        end_session(m, s, SCRCPY_EXIT_FAILURE);
+    }
+}
+
+static bool
+is_input_event(uint32_t type) {
+    switch (type) {
+        case SDL_EVENT_KEY_DOWN:
+        case SDL_EVENT_KEY_UP:
+        case SDL_EVENT_TEXT_EDITING:
+        case SDL_EVENT_TEXT_INPUT:
+        case SDL_EVENT_MOUSE_MOTION:
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+        case SDL_EVENT_MOUSE_WHEEL:
+        case SDL_EVENT_FINGER_DOWN:
+        case SDL_EVENT_FINGER_UP:
+        case SDL_EVENT_FINGER_MOTION:
+        case SDL_EVENT_DROP_FILE:
+        case SDL_EVENT_DROP_TEXT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void
+dispatch_event(struct scrcpy_multi *m, const SDL_Event *event) {
+    SDL_Window *window = SDL_GetWindowFromEvent(event);
+    if (window && m->compositor_initialized
+            && window == m->compositor.window) {
+        sc_compositor_handle_event(&m->compositor, event);
+        return;
+    }
+
+    if (window) {
+        struct sc_device_session *s = get_session_from_window(m, window);
+        if (s) {
+            handle_screen_event(m, s, event);
+        }
+        return;
+    }
+
+    if (is_input_event(event->type)) {
+        // An input event without window must not be forwarded to all the
+        // devices
+        return;
+    }
+
+    // Global events (clipboard, display changes...) concern all the screens
+    for (unsigned i = 0; i < m->count; ++i) {
+        handle_screen_event(m, &m->sessions[i], event);
+    }
+}
+
+static enum scrcpy_exit_code
+get_exit_code(struct scrcpy_multi *m) {
+    // Report the worst exit code
+    enum scrcpy_exit_code ret = SCRCPY_EXIT_SUCCESS;
+    for (unsigned i = 0; i < m->count; ++i) {
+        struct sc_device_session *s = &m->sessions[i];
+        assert(s->state == SC_DEVICE_SESSION_STATE_ENDED);
+        if (s->exit_code == SCRCPY_EXIT_FAILURE) {
+            return SCRCPY_EXIT_FAILURE;
+        }
+        if (s->exit_code == SCRCPY_EXIT_DISCONNECTED) {
+            ret = SCRCPY_EXIT_DISCONNECTED;
+        }
+    }
+    return ret;
+}
+
+static enum scrcpy_exit_code
+event_loop(struct scrcpy_multi *m) {
+    SDL_Event event;
+    while (m->active) {
+        if (!SDL_WaitEvent(&event)) {
+            LOGE("SDL_WaitEvent() error: %s", SDL_GetError());
+            return SCRCPY_EXIT_FAILURE;
+        }
+
+        switch (event.type) {
+            case SDL_EVENT_QUIT:
+                LOGD("User requested to quit");
+                return SCRCPY_EXIT_SUCCESS;
+            case SC_EVENT_RUN_ON_MAIN_THREAD: {
+                sc_runnable_fn run = event.user.data1;
+                void *userdata = event.user.data2;
+                run(userdata);
+                break;
+            }
+            case SC_EVENT_SERVER_CONNECTED: {
+                struct sc_device_session *s = get_session_from_event(&event);
+                if (s->state != SC_DEVICE_SESSION_STATE_CONNECTING) {
+                    break;
+                }
+                if (!sc_device_session_init_components(s)) {
+                    end_session(m, s, SCRCPY_EXIT_FAILURE);
+                }
+                break;
+            }
+            case SC_EVENT_SERVER_CONNECTION_FAILED: {
+                struct sc_device_session *s = get_session_from_event(&event);
+                if (s->state != SC_DEVICE_SESSION_STATE_CONNECTING) {
+                    break;
+                }
+                LOGE("Device %s: server connection failed", s->req_serial);
+                end_session(m, s, SCRCPY_EXIT_FAILURE);
+                break;
+            }
+            case SC_EVENT_DEVICE_DISCONNECTED: {
+                struct sc_device_session *s = get_session_from_event(&event);
+                if (!is_session_running(s)) {
+                    break;
+                }
+                LOGW("Device %s disconnected", s->server.serial);
+                end_session(m, s, SCRCPY_EXIT_DISCONNECTED);
+                break;
+            }
+            case SC_EVENT_DEMUXER_ERROR: {
+                struct sc_device_session *s = get_session_from_event(&event);
+                if (!is_session_running(s)) {
+                    break;
+                }
+                LOGE("Device %s: demuxer error", s->server.serial);
+                end_session(m, s, SCRCPY_EXIT_FAILURE);
+                break;
+            }
+            case SC_EVENT_CONTROLLER_ERROR: {
+                struct sc_device_session *s = get_session_from_event(&event);
+                if (!is_session_running(s)) {
+                    break;
+                }
+                LOGE("Device %s: controller error", s->server.serial);
+                end_session(m, s, SCRCPY_EXIT_FAILURE);
+                break;
+            }
+            case SC_EVENT_NEW_FRAME: {
+                struct sc_screen *screen = event.user.data1;
+                assert(screen);
+                struct sc_device_session *s =
+                    container_of(screen, struct sc_device_session, screen);
+                handle_screen_event(m, s, &event);
+                break;
+            }
+            case SC_EVENT_NEW_TILE_FRAME:
+                assert(m->compositor_initialized);
+                sc_compositor_handle_event(&m->compositor, &event);
+                break;
+            case SDL_EVENT_WINDOW_CLOSE_REQUESTED: {
+                SDL_Window *window = SDL_GetWindowFromEvent(&event);
+                if (m->compositor_initialized
+                        && window == m->compositor.window) {
+                    LOGD("User requested to quit");
+                    return SCRCPY_EXIT_SUCCESS;
+                }
+
+                // With several windows, closing one of them does not quit
+                struct sc_device_session *s =
+                    get_session_from_window(m, window);
+                if (s && is_session_running(s)) {
+                    LOGI("Device %s: window closed", s->server.serial);
+                    end_session(m, s, SCRCPY_EXIT_SUCCESS);
+                }
+                break;
+            }
+            default:
+                dispatch_event(m, &event);
+                break;
+        }
+    }
+
+    // All the sessions are ended
+    return get_exit_code(m);
+}
+
+static void
+terminate_event_loop(void) {
+    sc_reject_new_runnables();
+
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SC_EVENT_RUN_ON_MAIN_THREAD) {
+            // Make sure all posted runnables are run, to avoid memory leaks
+            sc_runnable_fn run = event.user.data1;
+            void *userdata = event.user.data2;
+            run(userdata);
+        }
+    }
+}
+
+enum scrcpy_exit_code
+scrcpy_multi(struct scrcpy_options *options) {
+    static struct scrcpy_multi scrcpy_multi;
+    struct scrcpy_multi *m = &scrcpy_multi;
+
+    assert(options->serials);
+
+    // Minimal SDL initialization
+    if (!SDL_Init(SDL_INIT_EVENTS)) {
+        LOGE("Could not initialize SDL: %s", SDL_GetError());
+        return SCRCPY_EXIT_FAILURE;
+    }
+
+    atexit(SDL_Quit);
+
+    enum scrcpy_exit_code ret = SCRCPY_EXIT_FAILURE;
+
+    // The serials must remain valid until the end (they are referenced by the
+    // server params)
+    char *serials = strdup(options->serials);
+    if (!serials) {
+        LOG_OOM();
+        return SCRCPY_EXIT_FAILURE;
+    }
+
+    const char *serial_list[SC_MAX_SERIALS];
+    unsigned count = 0;
+    for (char *s = serials;;) {
+        // The list has been validated by the command line parser
+        assert(count < SC_MAX_SERIALS);
+        serial_list[count++] = s;
+        char *comma = strchr(s, ',');
+        if (!comma) {
+            break;
+        }
+        *comma = '\0';
+        s = comma + 1;
+    }
+
+    m->sessions = calloc(count, sizeof(*m->sessions));
+    if (!m->sessions) {
+        LOG_OOM();
+        free(serials);
+        return SCRCPY_EXIT_FAILURE;
+    }
+    m->count = count;
+    m->active = 0;
+    m->compositor_initialized = false;
+
+    bool adb_initialized = false;
+
+    if (!sc_adb_init()) {
+        goto end;
+    }
+    adb_initialized = true;
+
+    // Start the adb server once for all the devices, so that all the adb
+    // commands are then executed in-process by the native adb client
+    // (uninterruptible (intr == NULL), but in practice it's very quick)
+    if (!sc_adb_start_server(NULL, 0)) {
+        LOGE("Could not start adb server");
+        goto end;
+    }
+
+    if (options->window) {
+        // Set hints before starting the server threads to avoid race
+        // conditions in SDL
+        scrcpy_sdl_set_hints(options->render_driver);
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+        struct sc_device_session *s = &m->sessions[i];
+        s->options = options;
+        s->req_serial = serial_list[i];
+        s->state = SC_DEVICE_SESSION_STATE_NONE;
+        s->exit_code = SCRCPY_EXIT_FAILURE;
+
+        if (!sc_device_session_start(s, options, serial_list[i])) {
+            LOGE("Device %s: could not start the server", serial_list[i]);
+            goto end;
+        }
+        ++m->active;
+    }
+
+    LOGI("Mirroring %u devices", count);
+
+    // The SDL subsystems are initialized while the server threads are starting
+    // the servers
+    if (options->window ||
+            (options->control && options->clipboard_autosync)) {
+        if (!SDL_Init(SDL_INIT_VIDEO)) {
+            // If it fails, it is an error only if video playback is enabled
+            if (options->video_playback) {
+                LOGE("Could not initialize SDL video: %s", SDL_GetError());
+                goto end;
+            } else {
+                LOGW("Could not initialize SDL video: %s", SDL_GetError());
+            }
+        }
+    }
+
+    if (options->audio_playback) {
+        if (!SDL_Init(SDL_INIT_AUDIO)) {
+            LOGE("Could not initialize SDL audio: %s", SDL_GetError());
+            goto end;
+        }
+    }
+
+    scrcpy_sdl_configure(options->video_playback,
+                         options->disable_screensaver);
+
+    // The main thread uploads and renders the frames (see scrcpy())
+    sc_thread_apply_role(SC_THREAD_ROLE_RENDER);
+
+    if (options->video_wall) {
+        struct sc_compositor_params compositor_params = {
+            .window_title = options->window_title ? options->window_title
+                                                  : "scrcpy",
+            .tile_count = count,
+            .always_on_top = options->always_on_top,
+            .window_x = options->window_x,
+            .window_y = options->window_y,
+            .window_width = options->window_width,
+            .window_height = options->window_height,
+            .window_borderless = options->window_borderless,
+            .orientation = options->display_orientation,
+            .mipmaps = options->mipmaps,
+            .fullscreen = options->fullscreen,
+        };
+
+        if (!sc_compositor_init(&m->compositor, &compositor_params)) {
+            goto end;
+        }
+        m->compositor_initialized = true;
+
+        // The sessions are initialized on the main thread once connected, so
+        // the tiles are available before they are used
+        for (unsigned i = 0; i < count; ++i) {
+            m->sessions[i].tile_sink =
+                sc_compositor_get_frame_sink(&m->compositor, i);
+        }
+    }
+
+    ret = event_loop(m);
+    terminate_event_loop();
+
+end:
+    for (unsigned i = 0; i < m->count; ++i) {
+        struct sc_device_session *s = &m->sessions[i];
+        if (s->state == SC_DEVICE_SESSION_STATE_CONNECTING
+                || s->state == SC_DEVICE_SESSION_STATE_RUNNING) {
+            sc_device_session_interrupt(s);
+        }
+    }
+
+    LOGD("Quit...");
+
+    unsigned connected = 0;
+    uint64_t total_bytes = 0;
+    uint64_t total_frames = 0;
+    sc_tick total_decode_time = 0;
+    for (unsigned i = 0; i < m->count; ++i) {
+        struct sc_device_session *s = &m->sessions[i];
+        sc_device_session_destroy(s);
+
+        if (s->start_date) {
+            ++connected;
+        }
+        if (s->video_demuxer_started) {
+            total_bytes += s->video_demuxer.byte_count;
+        }
+        if (s->audio_demuxer_started) {
+            total_bytes += s->audio_demuxer.byte_count;
+        }
+        if (s->video_decoder_initialized) {
+            total_frames += s->video_decoder.frame_count;
+            total_decode_time += s->video_decoder.decode_time;
+        }
+    }
+
+    // Destroy the compositor only once all the video demuxers are joined
+    if (m->compositor_initialized) {
+        sc_compositor_log_stats(&m->compositor);
+        sc_compositor_destroy(&m->compositor);
+    }
+
+    if (connected > 1) {
+        LOGI("%u devices: %" PRIu64 " KiB received, %" PRIu64 " video frames "
+             "decoded in %" PRItick " ms", connected, total_bytes / 1024,
+             total_frames, SC_TICK_TO_MS(total_decode_time));
+    }
+
+    if (adb_initialized) {
+        sc_adb_destroy();
+    }
+
+    free(m->sessions);
+    free(serials);
+
+    return ret;
+}
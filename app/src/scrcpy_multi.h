@@ -0,0 +1,19 @@
+#ifndef SCRCPY_MULTI_H
+#define SCRCPY_MULTI_H
+
+#include "common.h"
+
+#include "options.h"
+#include "scrcpy.h"
+
+/**
+ * Mirror several devices (options->serials) from a single process
+ *
+ * Each device has its own server, demuxers, decoders, controller and window,
+ * but they share the adb server connection, the SDL initialization and the
+ * event loop.
+ */
+enum scrcpy_exit_code
+scrcpy_multi(struct scrcpy_options *options);
+
+#endif
@@ -1,6 +1,7 @@
 #include "screen.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <string.h>
 #include <SDL3/SDL.h>
 
@@ -9,6 +10,7 @@
 #include "options.h"
 #include "util/log.h"
 #include "util/sdl.h"
+#include "util/trace.h"
 
 #define DISPLAY_MARGINS 96
 
@@ -192,6 +194,34 @@ sc_screen_update_content_rect(struct sc_screen *screen) {
                          &screen->rect);
 }
 
+static void
+sc_screen_update_refresh_interval(struct sc_screen *screen) {
+    if (!screen->frame_pacer && !screen->late_latch_enabled) {
+        return;
+    }
+
+    sc_tick refresh_interval = 0; // unknown
+    SDL_DisplayID display = SDL_GetDisplayForWindow(screen->window);
+    const SDL_DisplayMode *mode =
+        display ? SDL_GetCurrentDisplayMode(display) : NULL;
+    if (mode && mode->refresh_rate > 0) {
+        LOGD("Display refresh rate: %.2f Hz", mode->refresh_rate);
+        refresh_interval = SC_TICK_FREQ / mode->refresh_rate;
+    } else {
+        LOGW("Could not get display refresh rate, frames will not be "
+             "synchronized with vsync");
+    }
+
+    if (screen->frame_pacer) {
+        sc_frame_pacer_set_refresh_interval(screen->frame_pacer,
+                                            refresh_interval);
+    }
+    if (screen->late_latch_enabled) {
+        sc_late_latch_set_refresh_interval(&screen->late_latch,
+                                           refresh_interval);
+    }
+}
+
 // render the texture to the renderer
 //
 // Set the update_content_rect flag if the window or content size may have
@@ -200,6 +230,8 @@ static void
 sc_screen_render(struct sc_screen *screen, bool update_content_rect) {
     assert(!screen->video || screen->has_video_window);
 
+    sc_tick trace = sc_trace_begin();
+
     if (update_content_rect) {
         sc_screen_update_content_rect(screen);
     }
@@ -207,7 +239,12 @@ sc_screen_render(struct sc_screen *screen, bool update_content_rect) {
     SDL_Renderer *renderer = screen->renderer;
     sc_sdl_render_clear(renderer);
 
-    bool ok = false;
+    if (screen->video && !screen->has_frame && !screen->disconnected) {
+        // The window has been shown before the first frame (see
+        // sc_screen_prepare_video()), there is nothing to draw yet
+        goto end;
+    }
+
     SDL_Texture *texture = screen->tex.texture;
     if (!texture) {
         if (!screen->disconnected) {
@@ -216,40 +253,12 @@ sc_screen_render(struct sc_screen *screen, bool update_content_rect) {
         goto end;
     }
 
-    SDL_FRect *geometry = &screen->rect;
-    enum sc_orientation orientation = screen->orientation;
-
-    if (orientation == SC_ORIENTATION_0) {
-        ok = SDL_RenderTexture(renderer, texture, NULL, geometry);
-    } else {
-        unsigned cw_rotation = sc_orientation_get_rotation(orientation);
-        double angle = 90 * cw_rotation;
-
-        const SDL_FRect *dstrect = NULL;
-        SDL_FRect rect;
-        if (sc_orientation_is_swap(orientation)) {
-            rect.x = geometry->x + (geometry->w - geometry->h) / 2.f;
-            rect.y = geometry->y + (geometry->h - geometry->w) / 2.f;
-            rect.w = geometry->h;
-            rect.h = geometry->w;
-            dstrect = &rect;
-        } else {
-            dstrect = geometry;
-        }
-
-        SDL_FlipMode flip = sc_orientation_is_mirror(orientation)
-                              ? SDL_FLIP_HORIZONTAL : 0;
-
-        ok = SDL_RenderTextureRotated(renderer, texture, NULL, dstrect, angle,
-                                      NULL, flip);
-    }
-
-    if (!ok) {
-        LOGE("Could not render texture: %s", SDL_GetError());
-    }
+    sc_texture_render(&screen->tex, &screen->rect, screen->orientation);
 
 end:
     sc_sdl_render_present(renderer);
+
+    sc_trace_end("sc_screen_render", trace);
 }
 
 #if defined(__APPLE__) || defined(_WIN32)
@@ -326,11 +335,18 @@ sc_screen_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
 
     if (previous_skipped) {
         sc_fps_counter_add_skipped_frame(&screen->fps_counter);
+        if (screen->metrics) {
+            sc_metrics_add_skipped_frame(screen->metrics);
+        }
         // The SC_EVENT_NEW_FRAME triggered for the previous frame will consume
         // this new frame instead
+    } else if (screen->late_latch_enabled) {
+        // The SC_EVENT_NEW_FRAME will be posted shortly before the next vsync
+        sc_late_latch_notify_frame(&screen->late_latch);
     } else {
-        // Post the event on the UI thread
-        bool ok = sc_push_event(SC_EVENT_NEW_FRAME);
+        // Post the event on the UI thread (the screen is passed so that the
+        // event can be dispatched when several screens exist)
+        bool ok = sc_push_event_with_data(SC_EVENT_NEW_FRAME, screen);
         if (!ok) {
             return false;
         }
@@ -339,6 +355,15 @@ sc_screen_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
     return true;
 }
 
+static void
+sc_screen_on_latch(struct sc_late_latch *latch, void *userdata) {
+    (void) latch;
+    struct sc_screen *screen = userdata;
+
+    bool ok = sc_push_event_with_data(SC_EVENT_NEW_FRAME, screen);
+    (void) ok; // ignore failure (the event queue is full or closed)
+}
+
 bool
 sc_screen_init(struct sc_screen *screen,
                const struct sc_screen_params *params) {
@@ -360,6 +385,11 @@ sc_screen_init(struct sc_screen *screen,
     screen->req.height = params->window_height;
     screen->req.fullscreen = params->fullscreen;
     screen->req.start_fps_counter = params->start_fps_counter;
+    screen->metrics = params->metrics;
+    screen->frame_pacer = params->frame_pacer;
+    screen->late_latch_enabled = params->late_latch;
+    sc_frame_intervals_init(&screen->present_intervals);
+    sc_histogram_init(&screen->frame_ages);
 
     bool ok = sc_frame_buffer_init(&screen->fb);
     if (!ok) {
@@ -425,6 +455,15 @@ sc_screen_init(struct sc_screen *screen,
         goto error_destroy_window;
     }
 
+    if (screen->frame_pacer || screen->late_latch_enabled) {
+        // Frame pacing and late latching need the presentation to be
+        // synchronized with the display refresh
+        bool ok = SDL_SetRenderVSync(screen->renderer, 1);
+        if (!ok) {
+            LOGW("Could not enable vsync: %s", SDL_GetError());
+        }
+    }
+
 #ifdef SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
     screen->gl_context = NULL;
 
@@ -450,7 +489,8 @@ sc_screen_init(struct sc_screen *screen,
 #endif
 
     bool mipmaps = params->video;
-    ok = sc_texture_init(&screen->tex, screen->renderer, mipmaps);
+    ok = sc_texture_init(&screen->tex, screen->renderer, mipmaps,
+                         params->downscale_filter);
     if (!ok) {
         goto error_destroy_renderer;
     }
@@ -498,6 +538,7 @@ sc_screen_init(struct sc_screen *screen,
         .controller = params->controller,
         .fp = params->fp,
         .screen = screen,
+        .latency_probe = params->latency_probe,
         .kp = params->kp,
         .mp = params->mp,
         .gp = params->gp,
@@ -513,6 +554,16 @@ sc_screen_init(struct sc_screen *screen,
     // Initialize even if not used for simplicity
     sc_mouse_capture_init(&screen->mc, screen->window, params->shortcut_mods);
 
+    if (screen->late_latch_enabled) {
+        static const struct sc_late_latch_callbacks latch_cbs = {
+            .on_latch = sc_screen_on_latch,
+        };
+        ok = sc_late_latch_start(&screen->late_latch, &latch_cbs, screen);
+        if (!ok) {
+            goto error_free_frame;
+        }
+    }
+
 #ifdef CONTINUOUS_RESIZING_WORKAROUND
     if (screen->video) {
         ok = SDL_AddEventWatch(event_watcher, screen);
@@ -547,6 +598,8 @@ sc_screen_init(struct sc_screen *screen,
 
     return true;
 
+error_free_frame:
+    av_frame_free(&screen->frame);
 error_destroy_texture:
     sc_texture_destroy(&screen->tex);
 error_destroy_renderer:
@@ -595,6 +648,44 @@ sc_screen_show_initial_window(struct sc_screen *screen) {
 
     sc_sdl_show_window(screen->window);
     sc_screen_update_content_rect(screen);
+    sc_screen_update_refresh_interval(screen);
+}
+
+static void
+sc_screen_show_video_window(struct sc_screen *screen) {
+    assert(screen->video);
+    assert(!screen->has_video_window);
+
+    screen->has_video_window = true;
+    sc_screen_show_initial_window(screen);
+
+    if (sc_screen_is_relative_mode(screen)) {
+        // Capture mouse on start
+        sc_mouse_capture_set_active(&screen->mc, true);
+    }
+}
+
+void
+sc_screen_prepare_video(struct sc_screen *screen, struct sc_size frame_size,
+                        enum AVColorSpace color_space,
+                        enum AVColorRange color_range) {
+    assert(screen->video);
+    assert(!screen->has_frame);
+    assert(!screen->has_video_window);
+    assert(frame_size.width && frame_size.height);
+
+    bool ok = sc_texture_prepare_frame(&screen->tex, frame_size, color_space,
+                                       color_range);
+    if (!ok) {
+        // Not fatal, it will be created on first frame
+        LOGW("Could not prepare texture");
+    }
+
+    screen->frame_size = frame_size;
+    screen->content_size = get_oriented_size(frame_size, screen->orientation);
+
+    sc_screen_show_video_window(screen);
+    sc_screen_render(screen, false);
 }
 
 void
@@ -605,6 +696,9 @@ sc_screen_hide_window(struct sc_screen *screen) {
 void
 sc_screen_interrupt(struct sc_screen *screen) {
     sc_fps_counter_interrupt(&screen->fps_counter);
+    if (screen->late_latch_enabled) {
+        sc_late_latch_interrupt(&screen->late_latch);
+    }
 }
 
 void
@@ -617,19 +711,47 @@ sc_screen_interrupt_disconnect(struct sc_screen *screen) {
 void
 sc_screen_join(struct sc_screen *screen) {
     sc_fps_counter_join(&screen->fps_counter);
+    if (screen->late_latch_enabled) {
+        sc_late_latch_join(&screen->late_latch);
+    }
     if (screen->disconnect_started) {
         sc_disconnect_join(&screen->disconnect);
     }
 }
 
+static void
+sc_screen_log_present_stats(struct sc_screen *screen) {
+    struct sc_frame_intervals *fi = &screen->present_intervals;
+    if (!fi->count) {
+        return;
+    }
+
+    // The standard deviation of the intervals measures the judder
+    double stddev = sc_frame_intervals_get_stddev(fi);
+    enum sc_log_level level = screen->frame_pacer ? SC_LOG_LEVEL_INFO
+                                                  : SC_LOG_LEVEL_DEBUG;
+    LOG(level, "Frame presentation intervals: mean %.2f ms, stddev %.2f ms, "
+               "max %.2f ms (%" PRIu64 " intervals)",
+        fi->mean / SC_TICK_FROM_MS(1), stddev / SC_TICK_FROM_MS(1),
+        (double) fi->max / SC_TICK_FROM_MS(1), fi->count);
+
+    level = screen->late_latch_enabled ? SC_LOG_LEVEL_INFO
+                                       : SC_LOG_LEVEL_DEBUG;
+    sc_histogram_log(&screen->frame_ages, level, "Frame age at present");
+}
+
 void
 sc_screen_destroy(struct sc_screen *screen) {
 #ifndef NDEBUG
     assert(!screen->open);
 #endif
+    sc_screen_log_present_stats(screen);
     if (screen->disconnect_started) {
         sc_disconnect_destroy(&screen->disconnect);
     }
+    if (screen->late_latch_enabled) {
+        sc_late_latch_destroy(&screen->late_latch);
+    }
     sc_texture_destroy(&screen->tex);
     av_frame_free(&screen->frame);
 #ifdef SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
@@ -706,10 +828,14 @@ sc_screen_set_orientation(struct sc_screen *screen,
     sc_screen_render(screen, true);
 }
 
+// frame_date is the date at which the frame was decoded (SC_TICK_NONE if
+// unknown)
 static bool
-sc_screen_apply_frame(struct sc_screen *screen) {
+sc_screen_apply_frame(struct sc_screen *screen, sc_tick frame_date) {
     assert(screen->video);
 
+    sc_tick start = sc_tick_now();
+
     sc_fps_counter_add_rendered_frame(&screen->fps_counter);
 
     AVFrame *frame = screen->frame;
@@ -730,7 +856,16 @@ sc_screen_apply_frame(struct sc_screen *screen) {
         } else {
             // This is the first frame
             screen->has_frame = true;
-            screen->content_size = new_content_size;
+            if (!screen->has_video_window) {
+                screen->content_size = new_content_size;
+            } else if (screen->content_size.width != new_content_size.width
+                    || screen->content_size.height
+                            != new_content_size.height) {
+                // The window has been prepared for another frame size
+                LOGD("Unexpected initial frame size, resizing");
+                set_content_size(screen, new_content_size);
+                sc_screen_update_content_rect(screen);
+            }
         }
     }
 
@@ -741,17 +876,32 @@ sc_screen_apply_frame(struct sc_screen *screen) {
 
     assert(screen->has_frame);
     if (!screen->has_video_window) {
-        screen->has_video_window = true;
         // this is the very first frame, show the window
-        sc_screen_show_initial_window(screen);
-
-        if (sc_screen_is_relative_mode(screen)) {
-            // Capture mouse on start
-            sc_mouse_capture_set_active(&screen->mc, true);
-        }
+        sc_screen_show_video_window(screen);
     }
 
     sc_screen_render(screen, false);
+
+    sc_tick now = sc_tick_now();
+    sc_frame_intervals_add(&screen->present_intervals, now);
+    if (screen->frame_pacer) {
+        sc_frame_pacer_on_present(screen->frame_pacer, now);
+    }
+    if (screen->late_latch_enabled) {
+        sc_late_latch_on_present(&screen->late_latch, now);
+    }
+
+    sc_tick frame_age = 0;
+    if (frame_date != SC_TICK_NONE) {
+        frame_age = now - frame_date;
+        sc_histogram_add(&screen->frame_ages, frame_age);
+    }
+
+    if (screen->metrics) {
+        // Texture upload and rendering
+        sc_metrics_add_rendered_frame(screen->metrics, now - start, frame_age);
+    }
+
     return true;
 }
 
@@ -774,8 +924,8 @@ sc_screen_update_frame(struct sc_screen *screen) {
     }
 
     av_frame_unref(screen->frame);
-    sc_frame_buffer_consume(&screen->fb, screen->frame);
-    return sc_screen_apply_frame(screen);
+    sc_tick frame_date = sc_frame_buffer_consume(&screen->fb, screen->frame);
+    return sc_screen_apply_frame(screen, frame_date);
 }
 
 void
@@ -793,7 +943,8 @@ sc_screen_set_paused(struct sc_screen *screen, bool paused) {
         av_frame_free(&screen->frame);
         screen->frame = screen->resume_frame;
         screen->resume_frame = NULL;
-        bool ok = sc_screen_apply_frame(screen);
+        // The resume frame may be arbitrarily old, do not measure its age
+        bool ok = sc_screen_apply_frame(screen, SC_TICK_NONE);
         if (!ok) {
             LOGE("Resume frame update failed");
         }
@@ -911,6 +1062,9 @@ sc_screen_handle_event(struct sc_screen *screen, const SDL_Event *event) {
                 sc_screen_render(screen, true);
             }
             return true;
+        case SDL_EVENT_WINDOW_DISPLAY_CHANGED:
+            sc_screen_update_refresh_interval(screen);
+            return true;
         case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
             if (screen->has_video_window) {
                 sc_screen_render(screen, true);
@@ -15,13 +15,17 @@
 #include "disconnect.h"
 #include "fps_counter.h"
 #include "frame_buffer.h"
+#include "frame_pacer.h"
 #include "input_manager.h"
+#include "late_latch.h"
+#include "metrics.h"
 #include "mouse_capture.h"
 #include "options.h"
 #include "texture.h"
 #include "trait/key_processor.h"
 #include "trait/frame_sink.h"
 #include "trait/mouse_processor.h"
+#include "util/histogram.h"
 
 #ifdef __APPLE__
 # define SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
@@ -42,6 +46,15 @@ struct sc_screen {
     struct sc_mouse_capture mc; // only used in mouse relative mode
     struct sc_frame_buffer fb;
     struct sc_fps_counter fps_counter;
+    struct sc_metrics *metrics; // optional
+    struct sc_frame_pacer *frame_pacer; // optional
+    // Intervals between consecutive frame presentations, to measure judder
+    struct sc_frame_intervals present_intervals;
+    // Age of the frames when presented (since they were decoded)
+    struct sc_histogram frame_ages;
+
+    bool late_latch_enabled;
+    struct sc_late_latch late_latch;
 
     // The initial requested window properties
     struct {
@@ -90,6 +103,9 @@ struct sc_screen_params {
 
     struct sc_controller *controller;
     struct sc_file_pusher *fp;
+    struct sc_latency_probe *latency_probe;
+    struct sc_metrics *metrics; // optional
+    struct sc_frame_pacer *frame_pacer; // optional
     struct sc_key_processor *kp;
     struct sc_mouse_processor *mp;
     struct sc_gamepad_processor *gp;
@@ -111,15 +127,29 @@ struct sc_screen_params {
 
     enum sc_orientation orientation;
     bool mipmaps;
+    enum sc_downscale_filter downscale_filter;
 
     bool fullscreen;
     bool start_fps_counter;
+    bool late_latch;
 };
 
 // initialize screen, create window, renderer and texture (window is hidden)
 bool
 sc_screen_init(struct sc_screen *screen, const struct sc_screen_params *params);
 
+/**
+ * Show the window before the first frame, sized for the expected frames
+ * (typically those of the last session with the same device)
+ *
+ * The texture is also created in advance. If the actual frames differ, the
+ * window and the texture are corrected on the first frame.
+ */
+void
+sc_screen_prepare_video(struct sc_screen *screen, struct sc_size frame_size,
+                        enum AVColorSpace color_space,
+                        enum AVColorRange color_range);
+
 // request to interrupt any inner thread
 // must be called before sc_screen_join()
 void
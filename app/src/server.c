@@ -19,6 +19,13 @@
 
 #define SC_SERVER_PATH_DEFAULT PREFIX "/share/scrcpy/" SC_SERVER_FILENAME
 #define SC_DEVICE_SERVER_PATH "/data/local/tmp/scrcpy-server.jar"
+// Followed by the hash of the server content and an extension:
+//  - ".jar": the cached server
+//  - ".us": the duration of the push which created it (in microseconds)
+#define SC_DEVICE_SERVER_CACHE_PREFIX "/data/local/tmp/scrcpy-server-cache-"
+
+#define FNV1A_64_OFFSET_BASIS UINT64_C(0xcbf29ce484222325)
+#define FNV1A_64_PRIME UINT64_C(0x100000001b3)
 
 #define SC_ADB_PORT_DEFAULT 5555
 #define SC_SOCKET_NAME_PREFIX "scrcpy_"
@@ -54,7 +61,151 @@ get_server_path(void) {
 }
 
 static bool
-push_server(struct sc_intr *intr, const char *serial) {
+hash_file(const char *path, uint64_t *out_hash) {
+    FILE *file = sc_file_open(path, "rb");
+    if (!file) {
+        LOGE("Could not open %s", path);
+        return false;
+    }
+
+    uint64_t hash = FNV1A_64_OFFSET_BASIS;
+    uint8_t buf[4096];
+    size_t r;
+    while ((r = fread(buf, 1, sizeof(buf), file)) > 0) {
+        for (size_t i = 0; i < r; ++i) {
+            hash = (hash ^ buf[i]) * FNV1A_64_PRIME;
+        }
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+    if (!ok) {
+        LOGE("Could not read %s", path);
+        return false;
+    }
+
+    *out_hash = hash;
+    return true;
+}
+
+// Copy the cached server (if any) to SC_DEVICE_SERVER_PATH, in a single shell
+// round-trip
+//
+// Return true on cache hit, and write the duration of the push it saved (or 0
+// if unknown) to saved.
+static bool
+restore_cached_server(struct sc_intr *intr, const char *serial,
+                      const char *cache_path, sc_tick *saved) {
+    char cmd[256];
+    int r = snprintf(cmd, sizeof(cmd),
+                     "cp %s.jar " SC_DEVICE_SERVER_PATH " 2>/dev/null"
+                     " && echo hit $(cat %s.us 2>/dev/null)",
+                     cache_path, cache_path);
+    if (r < 0 || (size_t) r >= sizeof(cmd)) {
+        return false;
+    }
+
+    char out[64];
+    ssize_t len = sc_adb_shell(intr, serial, cmd, SC_ADB_SILENT, out,
+                               sizeof(out) - 1);
+    if (len == -1) {
+        return false;
+    }
+    out[len] = '\0';
+    out[strcspn(out, "\r\n")] = '\0';
+
+    // Expected output: "hit <push_us>"
+    if (strncmp(out, "hit", 3)) {
+        return false;
+    }
+
+    long push_us;
+    if (out[3] == ' ' && sc_str_parse_integer(&out[4], &push_us)
+            && push_us > 0) {
+        *saved = SC_TICK_FROM_US(push_us);
+    } else {
+        *saved = 0;
+    }
+    return true;
+}
+
+// Store SC_DEVICE_SERVER_PATH as the cached server, replacing any previous one
+static bool
+store_cached_server(struct sc_intr *intr, const char *serial,
+                    const char *cache_path, sc_tick push_duration) {
+    // Copy to a temporary file first, so that an interrupted copy never
+    // results in a corrupted cache hit
+    char cmd[512];
+    int r = snprintf(cmd, sizeof(cmd),
+                     "rm -f " SC_DEVICE_SERVER_CACHE_PREFIX "*"
+                     "; cp " SC_DEVICE_SERVER_PATH " %s.tmp"
+                     " && mv %s.tmp %s.jar"
+                     " && echo %" PRItick " > %s.us"
+                     " && echo ok",
+                     cache_path, cache_path, cache_path,
+                     SC_TICK_TO_US(push_duration), cache_path);
+    if (r < 0 || (size_t) r >= sizeof(cmd)) {
+        return false;
+    }
+
+    char out[16];
+    ssize_t len = sc_adb_shell(intr, serial, cmd, SC_ADB_SILENT, out,
+                               sizeof(out) - 1);
+    if (len == -1) {
+        return false;
+    }
+    out[len] = '\0';
+
+    return !strncmp(out, "ok", 2);
+}
+
+static bool
+push_server_cached(struct sc_intr *intr, const char *serial,
+                   const char *server_path) {
+    uint64_t hash;
+    if (!hash_file(server_path, &hash)) {
+        return false;
+    }
+
+    char cache_path[sizeof(SC_DEVICE_SERVER_CACHE_PREFIX) + 16];
+    snprintf(cache_path, sizeof(cache_path),
+             SC_DEVICE_SERVER_CACHE_PREFIX "%016" PRIx64, hash);
+
+    sc_tick start = sc_tick_now();
+    sc_tick saved;
+    if (restore_cached_server(intr, serial, cache_path, &saved)) {
+        sc_tick duration = sc_tick_now() - start;
+        if (saved > duration) {
+            LOGI("Server already on the device, push skipped (saved %"
+                 PRItick " ms)", SC_TICK_TO_MS(saved - duration));
+        } else {
+            LOGI("Server already on the device, push skipped");
+        }
+        return true;
+    }
+
+    LOGD("Server not cached on the device");
+
+    start = sc_tick_now();
+    bool ok = sc_adb_push(intr, serial, server_path, SC_DEVICE_SERVER_PATH, 0,
+                          NULL, NULL);
+    if (!ok) {
+        return false;
+    }
+    sc_tick push_duration = sc_tick_now() - start;
+    LOGD("Server pushed in %" PRItick " ms", SC_TICK_TO_MS(push_duration));
+
+    // The cache is an optimization, failing to store it is not an error
+    if (!store_cached_server(intr, serial, cache_path, push_duration)) {
+        LOGW("Could not cache the server on the device");
+    }
+
+    return true;
+}
+
+static bool
+push_server(struct sc_intr *intr, const char *serial,
+            const struct sc_server_params *params) {
     char *server_path = get_server_path();
     if (!server_path) {
         return false;
@@ -64,11 +215,37 @@ push_server(struct sc_intr *intr, const char *serial) {
         free(server_path);
         return false;
     }
-    bool ok = sc_adb_push(intr, serial, server_path, SC_DEVICE_SERVER_PATH, 0);
+
+    sc_startup_profile_begin(params->startup_profile,
+                             SC_STARTUP_PHASE_PUSH_SERVER);
+    bool ok;
+    if (params->server_cache) {
+        ok = push_server_cached(intr, serial, server_path);
+    } else {
+        ok = sc_adb_push(intr, serial, server_path, SC_DEVICE_SERVER_PATH, 0,
+                         NULL, NULL);
+    }
+    sc_startup_profile_end(params->startup_profile,
+                           SC_STARTUP_PHASE_PUSH_SERVER);
     free(server_path);
     return ok;
 }
 
+struct sc_server_push {
+    struct sc_server *server;
+    bool success;
+};
+
+static int
+run_push_server(void *data) {
+    struct sc_server_push *push = data;
+    struct sc_server *server = push->server;
+
+    push->success =
+        push_server(&server->push_intr, server->serial, &server->params);
+    return 0;
+}
+
 static const char *
 log_level_to_server_string(enum sc_log_level level) {
     switch (level) {
@@ -398,6 +575,9 @@ execute_server(struct sc_server *server,
         // By default, clipboard_autosync is true
         ADD_PARAM("clipboard_autosync=false");
     }
+    if (params->compact_control) {
+        ADD_PARAM("compact_control=true");
+    }
     if (!params->downsize_on_error) {
         // By default, downsize_on_error is true
         ADD_PARAM("downsize_on_error=false");
@@ -555,6 +735,15 @@ sc_server_init(struct sc_server *server, const struct sc_server_params *params,
         return false;
     }
 
+    ok = sc_intr_init(&server->push_intr);
+    if (!ok) {
+        sc_intr_destroy(&server->intr);
+        sc_cond_destroy(&server->cond_stopped);
+        sc_mutex_destroy(&server->mutex);
+        sc_adb_destroy();
+        return false;
+    }
+
     server->serial = NULL;
     server->device_socket_name = NULL;
     server->stopped = false;
@@ -592,6 +781,36 @@ device_read_info(struct sc_intr *intr, sc_socket device_socket,
     return true;
 }
 
+// The sockets are connected to the local adb server (or to the tunnel host),
+// so the tuning only affects this hop, not the link to the device
+static void
+sc_server_tune_socket(sc_socket socket, const struct sc_socket_tuning *tuning,
+                      const char *name) {
+    // The options are applied once connected: the TCP window scale is
+    // negotiated for the maximal buffer size allowed by the system anyway.
+    // On failure, the error is already logged, and the socket is still usable.
+    if (tuning->recv_buffer_size) {
+        net_set_recv_buffer_size(socket, tuning->recv_buffer_size);
+    }
+    if (tuning->send_buffer_size) {
+        net_set_send_buffer_size(socket, tuning->send_buffer_size);
+    }
+    if (tuning->recv_lowat) {
+        net_set_recv_lowat(socket, tuning->recv_lowat);
+    }
+    if (tuning->busy_poll) {
+        net_set_busy_poll(socket, tuning->busy_poll);
+    }
+    if (tuning->quickack) {
+        net_set_tcp_quickack(socket, true);
+    }
+
+    int size;
+    if (net_get_recv_buffer_size(socket, &size)) {
+        LOGD("%s socket receive buffer: %d bytes", name, size);
+    }
+}
+
 static bool
 sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
     struct sc_adb_tunnel *tunnel = &server->tunnel;
@@ -694,6 +913,20 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
         // for the other sockets)
         bool ok = net_set_tcp_nodelay(control_socket, true);
         (void) ok; // error already logged
+
+        sc_server_tune_socket(control_socket,
+                              &server->params.control_socket_tuning,
+                              "Control");
+    }
+
+    if (video_socket != SC_SOCKET_NONE) {
+        sc_server_tune_socket(video_socket,
+                              &server->params.video_socket_tuning, "Video");
+    }
+
+    if (audio_socket != SC_SOCKET_NONE) {
+        sc_server_tune_socket(audio_socket,
+                              &server->params.audio_socket_tuning, "Audio");
     }
 
     // we don't need the adb tunnel anymore
@@ -949,14 +1182,20 @@ run_server(void *data) {
     struct sc_server *server = data;
 
     const struct sc_server_params *params = &server->params;
+    struct sc_startup_profile *profile = params->startup_profile;
 
     // Execute "adb start-server" before "adb devices" so that daemon starting
     // output/errors is correctly printed in the console ("adb devices" output
     // is parsed, so it is not output)
-    bool ok = sc_adb_start_server(&server->intr, 0);
-    if (!ok) {
-        LOGE("Could not start adb server");
-        goto error_connection_failed;
+    bool ok;
+    if (!params->adb_server_started) {
+        sc_startup_profile_begin(profile, SC_STARTUP_PHASE_ADB_START_SERVER);
+        ok = sc_adb_start_server(&server->intr, 0);
+        sc_startup_profile_end(profile, SC_STARTUP_PHASE_ADB_START_SERVER);
+        if (!ok) {
+            LOGE("Could not start adb server");
+            goto error_connection_failed;
+        }
     }
 
     // params->tcpip_dst implies params->tcpip
@@ -971,6 +1210,8 @@ run_server(void *data) {
     // exist, and scrcpy will execute "adb connect").
     bool need_initial_serial = !params->tcpip_dst;
 
+    sc_startup_profile_begin(profile, SC_STARTUP_PHASE_SELECT_DEVICE);
+
     if (need_initial_serial) {
         // At most one of the 3 following parameters may be set
         assert(!!params->req_serial
@@ -1031,18 +1272,20 @@ run_server(void *data) {
         }
     }
 
+    sc_startup_profile_end(profile, SC_STARTUP_PHASE_SELECT_DEVICE);
+
     const char *serial = server->serial;
     assert(serial);
     LOGD("Device serial: %s", serial);
 
-    ok = push_server(&server->intr, serial);
-    if (!ok) {
-        goto error_connection_failed;
-    }
-
     // If --list-* is passed, then the server just prints the requested data
     // then exits.
     if (params->list) {
+        ok = push_server(&server->intr, serial, params);
+        if (!ok) {
+            goto error_connection_failed;
+        }
+
         sc_pid pid = execute_server(server, params);
         if (pid == SC_PROCESS_NONE) {
             goto error_connection_failed;
@@ -1063,13 +1306,40 @@ run_server(void *data) {
     assert(r == sizeof(SC_SOCKET_NAME_PREFIX) - 1 + 8);
     assert(server->device_socket_name);
 
+    // The server push and the tunnel setup are independent (both are mostly
+    // waiting for the device), so execute them in parallel
+    struct sc_server_push push = {
+        .server = server,
+        .success = false,
+    };
+    sc_thread push_thread;
+    ok = sc_thread_create(&push_thread, run_push_server, "scrcpy-push", &push);
+    if (!ok) {
+        LOGE("Could not create push thread");
+        goto error_connection_failed;
+    }
+
+    sc_startup_profile_begin(profile, SC_STARTUP_PHASE_OPEN_TUNNEL);
     ok = sc_adb_tunnel_open(&server->tunnel, &server->intr, serial,
                             server->device_socket_name, params->port_range,
                             params->force_adb_forward);
+    sc_startup_profile_end(profile, SC_STARTUP_PHASE_OPEN_TUNNEL);
     if (!ok) {
+        // The push result is not needed anymore
+        sc_intr_interrupt(&server->push_intr);
+        sc_thread_join(&push_thread, NULL);
         goto error_connection_failed;
     }
 
+    sc_thread_join(&push_thread, NULL);
+    if (!push.success) {
+        sc_adb_tunnel_close(&server->tunnel, &server->intr, serial,
+                            server->device_socket_name);
+        goto error_connection_failed;
+    }
+
+    sc_startup_profile_begin(profile, SC_STARTUP_PHASE_START_SERVER);
+
     // server will connect to our server socket
     sc_pid pid = execute_server(server, params);
     if (pid == SC_PROCESS_NONE) {
@@ -1101,6 +1371,8 @@ run_server(void *data) {
         goto error_connection_failed;
     }
 
+    sc_startup_profile_end(profile, SC_STARTUP_PHASE_START_SERVER);
+
     // Now connected
     server->cbs->on_connected(server, server->cbs_userdata);
 
@@ -1177,6 +1449,7 @@ sc_server_stop(struct sc_server *server) {
     server->stopped = true;
     sc_cond_signal(&server->cond_stopped);
     sc_intr_interrupt(&server->intr);
+    sc_intr_interrupt(&server->push_intr);
     sc_mutex_unlock(&server->mutex);
 }
 
@@ -1199,6 +1472,7 @@ sc_server_destroy(struct sc_server *server) {
 
     free(server->serial);
     free(server->device_socket_name);
+    sc_intr_destroy(&server->push_intr);
     sc_intr_destroy(&server->intr);
     sc_cond_destroy(&server->cond_stopped);
     sc_mutex_destroy(&server->mutex);
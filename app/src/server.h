@@ -8,6 +8,7 @@
 
 #include "adb/adb_tunnel.h"
 #include "options.h"
+#include "startup_profile.h"
 #include "util/intr.h"
 #include "util/net.h"
 #include "util/thread.h"
@@ -38,6 +39,9 @@ struct sc_server_params {
     const char *camera_zoom;
     uint16_t camera_fps;
     struct sc_port_range port_range;
+    struct sc_socket_tuning video_socket_tuning;
+    struct sc_socket_tuning audio_socket_tuning;
+    struct sc_socket_tuning control_socket_tuning;
     uint32_t tunnel_host;
     uint16_t tunnel_port;
     uint16_t max_size;
@@ -60,19 +64,25 @@ struct sc_server_params {
     bool force_adb_forward;
     bool power_off_on_close;
     bool clipboard_autosync;
+    bool compact_control;
     bool downsize_on_error;
     bool tcpip;
     const char *tcpip_dst;
     bool select_usb;
     bool select_tcpip;
     bool cleanup;
+    bool server_cache;
     bool power_on;
     bool kill_adb_on_close;
+    // "adb start-server" has already been executed (by the caller)
+    bool adb_server_started;
     bool camera_high_speed;
     bool camera_torch;
     bool vd_destroy_content;
     bool vd_system_decorations;
     uint8_t list;
+    // NULL if --startup-profile is not set
+    struct sc_startup_profile *startup_profile;
 };
 
 struct sc_server {
@@ -89,6 +99,9 @@ struct sc_server {
     bool stopped;
 
     struct sc_intr intr;
+    // The server push is executed in parallel with the tunnel setup, so it
+    // needs its own interruptor
+    struct sc_intr push_intr;
     struct sc_adb_tunnel tunnel;
 
     sc_socket video_socket;
@@ -0,0 +1,154 @@
+#include "session_cache.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/file.h"
+#include "util/log.h"
+
+#define SC_SESSION_CACHE_FILENAME "sessions"
+
+// Each line is:
+//     <serial> <codec_id> <width> <height> <color_space> <color_range>
+// with the codec id in hexadecimal
+#define SC_SESSION_CACHE_LINE_MAX 512
+#define SC_SERIAL_MAX 256
+
+char *
+sc_session_cache_get_path(void) {
+    char *dir = sc_file_get_cache_dir();
+    if (!dir) {
+        return NULL;
+    }
+
+    char *path = sc_file_build_path(dir, SC_SESSION_CACHE_FILENAME);
+    free(dir);
+    return path;
+}
+
+static bool
+parse_line(const char *line, char *serial, struct sc_session_hint *hint) {
+    // 255 is SC_SERIAL_MAX - 1
+    int r = sscanf(line, "%255s %" SCNx32 " %" SCNu32 " %" SCNu32 " %d %d",
+                   serial, &hint->codec_id, &hint->width, &hint->height,
+                   &hint->color_space, &hint->color_range);
+    if (r != 6) {
+        return false;
+    }
+
+    return hint->width && hint->width <= 0xFFFF
+        && hint->height && hint->height <= 0xFFFF;
+}
+
+bool
+sc_session_cache_load(const char *path, const char *serial,
+                      struct sc_session_hint *hint) {
+    FILE *file = sc_file_open(path, "r");
+    if (!file) {
+        // Not an error, the file may not exist yet
+        return false;
+    }
+
+    bool found = false;
+
+    char line[SC_SESSION_CACHE_LINE_MAX];
+    while (fgets(line, sizeof(line), file)) {
+        char line_serial[SC_SERIAL_MAX];
+        struct sc_session_hint line_hint;
+        if (!parse_line(line, line_serial, &line_hint)) {
+            // Ignore invalid lines
+            continue;
+        }
+
+        if (!strcmp(line_serial, serial)) {
+            *hint = line_hint;
+            found = true;
+            // There is at most one entry per serial
+            break;
+        }
+    }
+
+    fclose(file);
+    return found;
+}
+
+bool
+sc_session_cache_save(const char *path, const char *serial,
+                      const struct sc_session_hint *hint) {
+    if (strlen(serial) >= SC_SERIAL_MAX || strpbrk(serial, " \t\r\n")) {
+        LOGW("Could not store session for serial: %s", serial);
+        return false;
+    }
+
+    // Keep the other entries, oldest first (the oldest is dropped if there
+    // are too many)
+    char *lines[SC_SESSION_CACHE_MAX_ENTRIES - 1];
+    size_t count = 0;
+
+    FILE *file = sc_file_open(path, "r");
+    if (file) {
+        char line[SC_SESSION_CACHE_LINE_MAX];
+        while (fgets(line, sizeof(line), file)) {
+            char line_serial[SC_SERIAL_MAX];
+            struct sc_session_hint line_hint;
+            if (!parse_line(line, line_serial, &line_hint)
+                    || !strcmp(line_serial, serial)) {
+                continue;
+            }
+
+            char *copy = strdup(line);
+            if (!copy) {
+                LOG_OOM();
+                continue;
+            }
+
+            if (count == ARRAY_LEN(lines)) {
+                free(lines[0]);
+                memmove(&lines[0], &lines[1], (count - 1) * sizeof(*lines));
+                --count;
+            }
+            lines[count++] = copy;
+        }
+
+        fclose(file);
+    }
+
+    bool ok = false;
+
+    file = sc_file_open(path, "w");
+    if (!file) {
+        LOGW("Could not open %s", path);
+        goto end;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        fputs(lines[i], file);
+        size_t len = strlen(lines[i]);
+        if (lines[i][len - 1] != '\n') {
+            // The last line of the file may not be terminated
+            fputc('\n', file);
+        }
+    }
+
+    fprintf(file, "%s %08" PRIx32 " %" PRIu32 " %" PRIu32 " %d %d\n", serial,
+            hint->codec_id, hint->width, hint->height, hint->color_space,
+            hint->color_range);
+
+    ok = !ferror(file);
+    if (fclose(file)) {
+        ok = false;
+    }
+    if (!ok) {
+        LOGW("Could not write %s", path);
+    }
+
+end:
+    for (size_t i = 0; i < count; ++i) {
+        free(lines[i]);
+    }
+
+    return ok;
+}
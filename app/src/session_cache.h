@@ -0,0 +1,53 @@
+#ifndef SC_SESSION_CACHE_H
+#define SC_SESSION_CACHE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Number of devices remembered (the least recently saved are forgotten)
+#define SC_SESSION_CACHE_MAX_ENTRIES 64
+
+/**
+ * Properties of the video stream of the last session with a device
+ *
+ * They are used to initialize the decoder and the window speculatively, before
+ * the actual session is received from the device.
+ */
+struct sc_session_hint {
+    uint32_t codec_id; // as sent by the device (e.g. "h264" in ASCII)
+    // Frame size (the device orientation is implied)
+    uint32_t width;
+    uint32_t height;
+    // enum AVColorSpace and enum AVColorRange of the frames (0 if unknown)
+    int color_space;
+    int color_range;
+};
+
+/**
+ * Return the path of the session cache file (in the user cache directory)
+ *
+ * The result must be freed by the caller using free(). It may return NULL on
+ * error.
+ */
+char *
+sc_session_cache_get_path(void);
+
+/**
+ * Load the hint stored for the device serial
+ *
+ * Return false if there is none (or on error).
+ */
+bool
+sc_session_cache_load(const char *path, const char *serial,
+                      struct sc_session_hint *hint);
+
+/**
+ * Store the hint for the device serial, replacing any previous one
+ */
+bool
+sc_session_cache_save(const char *path, const char *serial,
+                      const struct sc_session_hint *hint);
+
+#endif
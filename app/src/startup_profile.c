@@ -0,0 +1,108 @@
+#include "startup_profile.h"
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include "util/log.h"
+
+static const char *const phase_names[] = {
+    [SC_STARTUP_PHASE_ADB_START_SERVER] = "adb start-server",
+    [SC_STARTUP_PHASE_SELECT_DEVICE] = "device selection",
+    [SC_STARTUP_PHASE_PUSH_SERVER] = "server push",
+    [SC_STARTUP_PHASE_OPEN_TUNNEL] = "tunnel setup",
+    [SC_STARTUP_PHASE_START_SERVER] = "server start",
+    [SC_STARTUP_PHASE_SDL_INIT] = "SDL initialization",
+    [SC_STARTUP_PHASE_INIT_COMPONENTS] = "components init",
+    [SC_STARTUP_PHASE_FIRST_FRAME] = "first frame",
+};
+
+static_assert(ARRAY_LEN(phase_names) == SC_STARTUP_PHASE_COUNT_,
+              "missing phase name");
+
+bool
+sc_startup_profile_init(struct sc_startup_profile *profile) {
+    bool ok = sc_mutex_init(&profile->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    profile->origin = sc_tick_now();
+    for (unsigned i = 0; i < SC_STARTUP_PHASE_COUNT_; ++i) {
+        profile->phases[i].start = 0;
+        profile->phases[i].end = 0;
+    }
+
+    return true;
+}
+
+void
+sc_startup_profile_destroy(struct sc_startup_profile *profile) {
+    sc_mutex_destroy(&profile->mutex);
+}
+
+void
+sc_startup_profile_begin(struct sc_startup_profile *profile,
+                         enum sc_startup_phase phase) {
+    if (!profile) {
+        return;
+    }
+
+    assert(phase < SC_STARTUP_PHASE_COUNT_);
+    sc_tick now = sc_tick_now();
+
+    sc_mutex_lock(&profile->mutex);
+    profile->phases[phase].start = now;
+    sc_mutex_unlock(&profile->mutex);
+}
+
+void
+sc_startup_profile_end(struct sc_startup_profile *profile,
+                       enum sc_startup_phase phase) {
+    if (!profile) {
+        return;
+    }
+
+    assert(phase < SC_STARTUP_PHASE_COUNT_);
+    sc_tick now = sc_tick_now();
+
+    sc_mutex_lock(&profile->mutex);
+    assert(profile->phases[phase].start);
+    profile->phases[phase].end = now;
+    sc_mutex_unlock(&profile->mutex);
+}
+
+void
+sc_startup_profile_log(struct sc_startup_profile *profile) {
+    sc_mutex_lock(&profile->mutex);
+
+    LOGI("Startup profile (start and duration, in ms):");
+
+    sc_tick last_end = 0;
+    for (unsigned i = 0; i < SC_STARTUP_PHASE_COUNT_; ++i) {
+        sc_tick start = profile->phases[i].start;
+        sc_tick end = profile->phases[i].end;
+        if (!start || !end) {
+            // Not executed (or not finished)
+            continue;
+        }
+
+        LOGI("    %-20s %6" PRItick " %6" PRItick, phase_names[i],
+             SC_TICK_TO_MS(start - profile->origin),
+             SC_TICK_TO_MS(end - start));
+
+        if (end > last_end) {
+            last_end = end;
+        }
+    }
+
+    if (profile->phases[SC_STARTUP_PHASE_FIRST_FRAME].end) {
+        sc_tick first_frame = profile->phases[SC_STARTUP_PHASE_FIRST_FRAME].end;
+        LOGI("Time to first frame: %" PRItick " ms",
+             SC_TICK_TO_MS(first_frame - profile->origin));
+    } else if (last_end) {
+        LOGI("Startup time: %" PRItick " ms",
+             SC_TICK_TO_MS(last_end - profile->origin));
+    }
+
+    sc_mutex_unlock(&profile->mutex);
+}
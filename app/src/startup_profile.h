@@ -0,0 +1,73 @@
+#ifndef SC_STARTUP_PROFILE_H
+#define SC_STARTUP_PROFILE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "util/thread.h"
+#include "util/tick.h"
+
+enum sc_startup_phase {
+    SC_STARTUP_PHASE_ADB_START_SERVER,
+    SC_STARTUP_PHASE_SELECT_DEVICE,
+    SC_STARTUP_PHASE_PUSH_SERVER,
+    SC_STARTUP_PHASE_OPEN_TUNNEL,
+    // Execute the server and connect to it
+    SC_STARTUP_PHASE_START_SERVER,
+    SC_STARTUP_PHASE_SDL_INIT,
+    SC_STARTUP_PHASE_INIT_COMPONENTS,
+    // From the demuxers start to the first frame rendered
+    SC_STARTUP_PHASE_FIRST_FRAME,
+    SC_STARTUP_PHASE_COUNT_,
+};
+
+/**
+ * Duration of each startup phase
+ *
+ * The phases are recorded from several threads (the server thread and the
+ * main thread), and some of them overlap.
+ */
+struct sc_startup_profile {
+    sc_mutex mutex;
+    sc_tick origin;
+    struct {
+        sc_tick start; // 0 if not started
+        sc_tick end; // 0 if not ended
+    } phases[SC_STARTUP_PHASE_COUNT_];
+};
+
+/**
+ * Initialize the profile, with the current time as origin
+ */
+bool
+sc_startup_profile_init(struct sc_startup_profile *profile);
+
+void
+sc_startup_profile_destroy(struct sc_startup_profile *profile);
+
+/**
+ * Record the start of a phase
+ *
+ * The profile may be NULL, in that case this function does nothing.
+ */
+void
+sc_startup_profile_begin(struct sc_startup_profile *profile,
+                         enum sc_startup_phase phase);
+
+/**
+ * Record the end of a phase
+ *
+ * The profile may be NULL, in that case this function does nothing.
+ */
+void
+sc_startup_profile_end(struct sc_startup_profile *profile,
+                       enum sc_startup_phase phase);
+
+/**
+ * Log the duration of the recorded phases
+ */
+void
+sc_startup_profile_log(struct sc_startup_profile *profile);
+
+#endif
@@ -1,5 +1,6 @@
 #include "util/file.h"
 
+#include <errno.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -94,3 +95,73 @@ sc_file_is_regular(const char *path) {
     return S_ISREG(path_stat.st_mode);
 }
 
+bool
+sc_file_get_size(const char *path, uint64_t *size) {
+    struct stat path_stat;
+
+    if (stat(path, &path_stat)) {
+        LOGE("Could not stat %s: %s", path, strerror(errno));
+        return false;
+    }
+    if (!S_ISREG(path_stat.st_mode)) {
+        return false;
+    }
+    *size = path_stat.st_size;
+    return true;
+}
+
+FILE *
+sc_file_open(const char *path, const char *mode) {
+    return fopen(path, mode);
+}
+
+static bool
+create_dir(const char *path) {
+    if (mkdir(path, 0700) && errno != EEXIST) {
+        LOGE("Could not create directory %s: %s", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+char *
+sc_file_get_cache_dir(void) {
+    char *cache_home;
+    const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+    if (xdg_cache_home && *xdg_cache_home) {
+        cache_home = strdup(xdg_cache_home);
+        if (!cache_home) {
+            LOG_OOM();
+            return NULL;
+        }
+    } else {
+        const char *home = getenv("HOME");
+        if (!home) {
+            LOGE("Could not determine the home directory");
+            return NULL;
+        }
+        cache_home = sc_file_build_path(home, ".cache");
+        if (!cache_home) {
+            return NULL;
+        }
+    }
+
+    char *dir = NULL;
+    if (!create_dir(cache_home)) {
+        goto end;
+    }
+
+    dir = sc_file_build_path(cache_home, "scrcpy");
+    if (!dir) {
+        goto end;
+    }
+
+    if (!create_dir(dir)) {
+        free(dir);
+        dir = NULL;
+    }
+
+end:
+    free(cache_home);
+    return dir;
+}
@@ -2,8 +2,12 @@
 
 #include <windows.h>
 
+#include <direct.h>
+#include <errno.h>
+#include <string.h>
 #include <sys/stat.h>
 
+#include "util/env.h"
 #include "util/log.h"
 #include "util/str.h"
 
@@ -41,3 +45,78 @@ sc_file_is_regular(const char *path) {
     return S_ISREG(path_stat.st_mode);
 }
 
+bool
+sc_file_get_size(const char *path, uint64_t *size) {
+    wchar_t *wide_path = sc_str_to_wchars(path);
+    if (!wide_path) {
+        LOG_OOM();
+        return false;
+    }
+
+    struct _stat64 path_stat;
+    int r = _wstat64(wide_path, &path_stat);
+    free(wide_path);
+
+    if (r) {
+        LOGE("Could not stat %s: %s", path, strerror(errno));
+        return false;
+    }
+    if (!S_ISREG(path_stat.st_mode)) {
+        return false;
+    }
+    *size = path_stat.st_size;
+    return true;
+}
+
+FILE *
+sc_file_open(const char *path, const char *mode) {
+    wchar_t *wide_path = sc_str_to_wchars(path);
+    if (!wide_path) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    wchar_t *wide_mode = sc_str_to_wchars(mode);
+    if (!wide_mode) {
+        LOG_OOM();
+        free(wide_path);
+        return NULL;
+    }
+
+    FILE *file = _wfopen(wide_path, wide_mode);
+    free(wide_mode);
+    free(wide_path);
+    return file;
+}
+
+char *
+sc_file_get_cache_dir(void) {
+    char *local_app_data = sc_get_env("LOCALAPPDATA");
+    if (!local_app_data) {
+        LOGE("Could not determine the local application data directory");
+        return NULL;
+    }
+
+    char *dir = sc_file_build_path(local_app_data, "scrcpy");
+    free(local_app_data);
+    if (!dir) {
+        return NULL;
+    }
+
+    wchar_t *wide_dir = sc_str_to_wchars(dir);
+    if (!wide_dir) {
+        LOG_OOM();
+        free(dir);
+        return NULL;
+    }
+
+    int r = _wmkdir(wide_dir);
+    free(wide_dir);
+    if (r && errno != EEXIST) {
+        LOGE("Could not create directory %s", dir);
+        free(dir);
+        return NULL;
+    }
+
+    return dir;
+}
@@ -6,13 +6,56 @@
 #include <libavutil/pixfmt.h>
 
 #include "util/log.h"
+#include "util/trace.h"
+
+static const char *
+sc_texture_get_downscale_filter_name(enum sc_downscale_filter filter) {
+    switch (filter) {
+        case SC_DOWNSCALE_FILTER_TRILINEAR:
+            return "trilinear";
+        case SC_DOWNSCALE_FILTER_BICUBIC:
+            return "bicubic";
+        case SC_DOWNSCALE_FILTER_LANCZOS:
+            return "lanczos";
+        default:
+            return "(unknown)";
+    }
+}
+
+static bool
+sc_texture_init_gl_scaler(struct sc_texture *tex,
+                          enum sc_downscale_filter filter) {
+    const char *name = sc_texture_get_downscale_filter_name(filter);
+    struct sc_opengl *gl = &tex->gl;
+
+    bool supports_shaders =
+        sc_opengl_version_at_least(gl, 3, 3, /* OpenGL 3.3+ */
+                                       3, 0  /* OpenGL ES 3.0+ */);
+    if (!supports_shaders) {
+        LOGW("Downscale filter %s disabled "
+             "(OpenGL 3.3+ or ES 3.0+ required)", name);
+        return false;
+    }
+
+    bool ok = sc_gl_scaler_init(&tex->gl_scaler, gl, filter);
+    if (!ok) {
+        LOGW("Downscale filter %s disabled (could not initialize shaders)",
+             name);
+        return false;
+    }
+
+    LOGI("Downscale filter: %s", name);
+    return true;
+}
 
 bool
-sc_texture_init(struct sc_texture *tex, SDL_Renderer *renderer, bool mipmaps) {
+sc_texture_init(struct sc_texture *tex, SDL_Renderer *renderer, bool mipmaps,
+                enum sc_downscale_filter downscale_filter) {
     const char *renderer_name = SDL_GetRendererName(renderer);
     LOGI("Renderer: %s", renderer_name ? renderer_name : "(unknown)");
 
     tex->mipmaps = false;
+    tex->gl_scaler_enabled = false;
 
     // starts with "opengl"
     bool use_opengl = renderer_name && !strncmp(renderer_name, "opengl", 6);
@@ -22,7 +65,15 @@ sc_texture_init(struct sc_texture *tex, SDL_Renderer *renderer, bool mipmaps) {
 
         LOGI("OpenGL version: %s", gl->version);
 
-        if (mipmaps) {
+        if (downscale_filter != SC_DOWNSCALE_FILTER_TRILINEAR) {
+            tex->gl_scaler_enabled =
+                sc_texture_init_gl_scaler(tex, downscale_filter);
+        }
+
+        if (tex->gl_scaler_enabled) {
+            // The shader samples the full resolution texture directly
+            LOGD("Trilinear filtering disabled (replaced by the shader)");
+        } else if (mipmaps) {
             bool supports_mipmaps =
                 sc_opengl_version_at_least(gl, 3, 0, /* OpenGL 3.0+ */
                                                2, 0  /* OpenGL ES 2.0+ */);
@@ -36,8 +87,14 @@ sc_texture_init(struct sc_texture *tex, SDL_Renderer *renderer, bool mipmaps) {
         } else {
             LOGI("Trilinear filtering disabled");
         }
-    } else if (mipmaps) {
-        LOGD("Trilinear filtering disabled (not an OpenGL renderer)");
+    } else {
+        if (downscale_filter != SC_DOWNSCALE_FILTER_TRILINEAR) {
+            LOGW("Downscale filter %s disabled (not an OpenGL renderer)",
+                 sc_texture_get_downscale_filter_name(downscale_filter));
+        }
+        if (mipmaps) {
+            LOGD("Trilinear filtering disabled (not an OpenGL renderer)");
+        }
     }
 
     tex->renderer = renderer;
@@ -50,6 +107,12 @@ sc_texture_destroy(struct sc_texture *tex) {
     if (tex->texture) {
         SDL_DestroyTexture(tex->texture);
     }
+
+    if (tex->gl_scaler_enabled) {
+        // Make sure the OpenGL context of the renderer is current
+        SDL_FlushRenderer(tex->renderer);
+        sc_gl_scaler_destroy(&tex->gl_scaler);
+    }
 }
 
 static enum SDL_Colorspace
@@ -115,9 +178,7 @@ sc_texture_create_frame_texture(struct sc_texture *tex,
         return NULL;
     }
 
-    if (tex->mipmaps) {
-        struct sc_opengl *gl = &tex->gl;
-
+    if (tex->mipmaps || tex->gl_scaler_enabled) {
         SDL_PropertiesID props = SDL_GetTextureProperties(texture);
         if (!props) {
             LOGE("Could not get texture properties: %s", SDL_GetError());
@@ -126,11 +187,19 @@ sc_texture_create_frame_texture(struct sc_texture *tex,
         }
 
         const char *renderer_name = SDL_GetRendererName(tex->renderer);
-        const char *key = !renderer_name || !strcmp(renderer_name, "opengl")
-                        ? SDL_PROP_TEXTURE_OPENGL_TEXTURE_NUMBER
-                        : SDL_PROP_TEXTURE_OPENGLES2_TEXTURE_NUMBER;
+        bool gles = renderer_name && strcmp(renderer_name, "opengl");
+
+        // The Y plane is the main texture
+        const char *key = gles ? SDL_PROP_TEXTURE_OPENGLES2_TEXTURE_NUMBER
+                               : SDL_PROP_TEXTURE_OPENGL_TEXTURE_NUMBER;
+        const char *key_u = gles ? SDL_PROP_TEXTURE_OPENGLES2_TEXTURE_U_NUMBER
+                                 : SDL_PROP_TEXTURE_OPENGL_TEXTURE_U_NUMBER;
+        const char *key_v = gles ? SDL_PROP_TEXTURE_OPENGLES2_TEXTURE_V_NUMBER
+                                 : SDL_PROP_TEXTURE_OPENGL_TEXTURE_V_NUMBER;
 
         int64_t texture_id = SDL_GetNumberProperty(props, key, 0);
+        int64_t texture_u_id = SDL_GetNumberProperty(props, key_u, 0);
+        int64_t texture_v_id = SDL_GetNumberProperty(props, key_v, 0);
         SDL_DestroyProperties(props);
         if (!texture_id) {
             LOGE("Could not get texture id: %s", SDL_GetError());
@@ -138,8 +207,29 @@ sc_texture_create_frame_texture(struct sc_texture *tex,
             return NULL;
         }
 
-        assert(!(texture_id & ~0xFFFFFFFF)); // fits in uint32_t
+        // fit in uint32_t
+        assert(!(texture_id & ~0xFFFFFFFF));
+        assert(!(texture_u_id & ~0xFFFFFFFF));
+        assert(!(texture_v_id & ~0xFFFFFFFF));
+
+        if (tex->gl_scaler_enabled) {
+            if (!texture_u_id || !texture_v_id) {
+                LOGE("Could not get texture planes: %s", SDL_GetError());
+                SDL_DestroyTexture(texture);
+                return NULL;
+            }
+
+            tex->planes.y = texture_id;
+            tex->planes.u = texture_u_id;
+            tex->planes.v = texture_v_id;
+        }
+
         tex->texture_id = texture_id;
+    }
+
+    if (tex->mipmaps) {
+        struct sc_opengl *gl = &tex->gl;
+
         gl->BindTexture(GL_TEXTURE_2D, tex->texture_id);
 
         // Enable trilinear filtering for downscaling
@@ -154,42 +244,56 @@ sc_texture_create_frame_texture(struct sc_texture *tex,
 }
 
 bool
-sc_texture_set_from_frame(struct sc_texture *tex, const AVFrame *frame) {
-
-    struct sc_size size = {frame->width, frame->height};
+sc_texture_prepare_frame(struct sc_texture *tex, struct sc_size size,
+                         enum AVColorSpace color_space,
+                         enum AVColorRange color_range) {
     assert(size.width && size.height);
 
-    if (!tex->texture
-            || tex->texture_type != SC_TEXTURE_TYPE_FRAME
-            || tex->texture_size.width != size.width
-            || tex->texture_size.height != size.height) {
-        // Incompatible texture, recreate it
-        enum AVColorSpace color_space = frame->colorspace;
-        enum AVColorRange color_range = frame->color_range;
+    if (tex->texture
+            && tex->texture_type == SC_TEXTURE_TYPE_FRAME
+            && tex->texture_size.width == size.width
+            && tex->texture_size.height == size.height
+            && tex->color_space == color_space
+            && tex->color_range == color_range) {
+        // Compatible texture
+        return true;
+    }
 
-        if (tex->texture) {
-            SDL_DestroyTexture(tex->texture);
-        }
+    if (tex->texture) {
+        SDL_DestroyTexture(tex->texture);
+    }
 
-        tex->texture = sc_texture_create_frame_texture(tex, size, color_space,
-                                                       color_range);
-        if (!tex->texture) {
-            return false;
-        }
+    tex->texture = sc_texture_create_frame_texture(tex, size, color_space,
+                                                   color_range);
+    if (!tex->texture) {
+        return false;
+    }
 
-        tex->texture_size = size;
-        tex->texture_type = SC_TEXTURE_TYPE_FRAME;
+    tex->texture_size = size;
+    tex->texture_type = SC_TEXTURE_TYPE_FRAME;
+    tex->color_space = color_space;
+    tex->color_range = color_range;
+
+    LOGI("Texture: %" PRIu16 "x%" PRIu16, size.width, size.height);
+    return true;
+}
 
-        LOGI("Texture: %" PRIu16 "x%" PRIu16, size.width, size.height);
+static bool
+sc_texture_update_frame(struct sc_texture *tex, const AVFrame *frame) {
+    struct sc_size size = {frame->width, frame->height};
+    bool ok = sc_texture_prepare_frame(tex, size, frame->colorspace,
+                                       frame->color_range);
+    if (!ok) {
+        return false;
     }
 
     assert(tex->texture);
     assert(tex->texture_type == SC_TEXTURE_TYPE_FRAME);
 
-    bool ok = SDL_UpdateYUVTexture(tex->texture, NULL,
-                                   frame->data[0], frame->linesize[0],
-                                   frame->data[1], frame->linesize[1],
-                                   frame->data[2], frame->linesize[2]);
+    ok = SDL_UpdateYUVTexture(tex->texture, NULL,
+                               frame->data[0], frame->linesize[0],
+                               frame->data[1], frame->linesize[1],
+                               frame->data[2], frame->linesize[2]);
     if (!ok) {
         LOGD("Could not update texture: %s", SDL_GetError());
         return false;
@@ -207,6 +311,14 @@ sc_texture_set_from_frame(struct sc_texture *tex, const AVFrame *frame) {
     return true;
 }
 
+bool
+sc_texture_set_from_frame(struct sc_texture *tex, const AVFrame *frame) {
+    sc_tick trace = sc_trace_begin();
+    bool ok = sc_texture_update_frame(tex, frame);
+    sc_trace_end("sc_texture_set_from_frame", trace);
+    return ok;
+}
+
 bool
 sc_texture_set_from_surface(struct sc_texture *tex, SDL_Surface *surface) {
     if (tex->texture) {
@@ -233,3 +345,77 @@ sc_texture_reset(struct sc_texture *tex) {
         tex->texture = NULL;
     }
 }
+
+static bool
+sc_texture_render_gl_scaler(struct sc_texture *tex, const SDL_FRect *geometry,
+                            enum sc_orientation orientation) {
+    SDL_Renderer *renderer = tex->renderer;
+
+    int w;
+    int h;
+    bool ok = SDL_GetCurrentRenderOutputSize(renderer, &w, &h);
+    if (!ok) {
+        LOGE("Could not get render output size: %s", SDL_GetError());
+        return false;
+    }
+
+    // Execute the pending commands (e.g. the clear) before drawing directly
+    ok = SDL_FlushRenderer(renderer);
+    if (!ok) {
+        LOGE("Could not flush renderer: %s", SDL_GetError());
+        return false;
+    }
+
+    struct sc_size drawable_size = {w, h};
+    sc_gl_scaler_render(&tex->gl_scaler, &tex->planes, tex->texture_size,
+                        tex->color_space, tex->color_range, geometry,
+                        orientation, drawable_size);
+    return true;
+}
+
+bool
+sc_texture_render(struct sc_texture *tex, const SDL_FRect *geometry,
+                  enum sc_orientation orientation) {
+    assert(tex->texture);
+
+    SDL_Renderer *renderer = tex->renderer;
+    SDL_Texture *texture = tex->texture;
+
+    // The shader draws on the window framebuffer
+    if (tex->gl_scaler_enabled && tex->texture_type == SC_TEXTURE_TYPE_FRAME
+            && !SDL_GetRenderTarget(renderer)) {
+        return sc_texture_render_gl_scaler(tex, geometry, orientation);
+    }
+
+    bool ok;
+    if (orientation == SC_ORIENTATION_0) {
+        ok = SDL_RenderTexture(renderer, texture, NULL, geometry);
+    } else {
+        unsigned cw_rotation = sc_orientation_get_rotation(orientation);
+        double angle = 90 * cw_rotation;
+
+        const SDL_FRect *dstrect = NULL;
+        SDL_FRect rect;
+        if (sc_orientation_is_swap(orientation)) {
+            rect.x = geometry->x + (geometry->w - geometry->h) / 2.f;
+            rect.y = geometry->y + (geometry->h - geometry->w) / 2.f;
+            rect.w = geometry->h;
+            rect.h = geometry->w;
+            dstrect = &rect;
+        } else {
+            dstrect = geometry;
+        }
+
+        SDL_FlipMode flip = sc_orientation_is_mirror(orientation)
+                              ? SDL_FLIP_HORIZONTAL : 0;
+
+        ok = SDL_RenderTextureRotated(renderer, texture, NULL, dstrect, angle,
+                                      NULL, flip);
+    }
+
+    if (!ok) {
+        LOGE("Could not render texture: %s", SDL_GetError());
+    }
+
+    return ok;
+}
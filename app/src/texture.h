@@ -9,7 +9,9 @@
 #include <SDL3/SDL.h>
 
 #include "coords.h"
+#include "gl_scaler.h"
 #include "opengl.h"
+#include "options.h"
 
 enum sc_texture_type {
     SC_TEXTURE_TYPE_FRAME,
@@ -22,19 +24,46 @@ struct sc_texture {
     // Only valid if texture != NULL
     struct sc_size texture_size;
     enum sc_texture_type texture_type;
+    // Only valid if texture_type == SC_TEXTURE_TYPE_FRAME
+    enum AVColorSpace color_space;
+    enum AVColorRange color_range;
 
     struct sc_opengl gl;
 
     bool mipmaps;
-    uint32_t texture_id; // only set if mipmaps is enabled
+    uint32_t texture_id; // only set if mipmaps or gl_scaler is enabled
+
+    // If enabled, the frames are converted and scaled by a custom shader
+    bool gl_scaler_enabled;
+    struct sc_gl_scaler gl_scaler;
+    // Only set if gl_scaler_enabled and texture_type == SC_TEXTURE_TYPE_FRAME
+    struct sc_gl_scaler_planes planes;
 };
 
+/**
+ * Initialize the texture
+ *
+ * The downscale filter (other than trilinear) is only supported by OpenGL
+ * renderers. On failure, it falls back to trilinear filtering (if mipmaps are
+ * enabled).
+ */
 bool
-sc_texture_init(struct sc_texture *tex, SDL_Renderer *renderer, bool mipmaps);
+sc_texture_init(struct sc_texture *tex, SDL_Renderer *renderer, bool mipmaps,
+                enum sc_downscale_filter downscale_filter);
 
 void
 sc_texture_destroy(struct sc_texture *tex);
 
+/**
+ * Create the frame texture in advance, for frames of the given properties
+ *
+ * If the actual frames do not match, the texture is recreated.
+ */
+bool
+sc_texture_prepare_frame(struct sc_texture *tex, struct sc_size size,
+                         enum AVColorSpace color_space,
+                         enum AVColorRange color_range);
+
 bool
 sc_texture_set_from_frame(struct sc_texture *tex, const AVFrame *frame);
 
@@ -44,4 +73,14 @@ sc_texture_set_from_surface(struct sc_texture *tex, SDL_Surface *surface);
 void
 sc_texture_reset(struct sc_texture *tex);
 
+/**
+ * Render the texture into the given rectangle of the renderer
+ *
+ * The geometry is the rectangle of the content (i.e. of the oriented texture),
+ * expressed in drawable coordinates.
+ */
+bool
+sc_texture_render(struct sc_texture *tex, const SDL_FRect *geometry,
+                  enum sc_orientation orientation);
+
 #endif
@@ -0,0 +1,99 @@
+#include "tile_layout.h"
+
+#include <assert.h>
+#include <stdbool.h>
+
+struct sc_tile_grid
+sc_tile_grid_compute(struct sc_size render_size, unsigned count,
+                     struct sc_size content_size) {
+    assert(count);
+    assert(content_size.width && content_size.height);
+
+    struct sc_tile_grid best = {
+        .columns = 1,
+        .rows = count,
+    };
+    float best_scale = -1;
+
+    for (unsigned columns = 1; columns <= count; ++columns) {
+        unsigned rows = (count + columns - 1) / columns;
+        float cell_width = (float) render_size.width / columns;
+        float cell_height = (float) render_size.height / rows;
+
+        float scale_x = cell_width / content_size.width;
+        float scale_y = cell_height / content_size.height;
+        float scale = scale_x < scale_y ? scale_x : scale_y;
+
+        // On equality, keep the grid with fewer columns
+        if (scale > best_scale) {
+            best.columns = columns;
+            best.rows = rows;
+            best_scale = scale;
+        }
+    }
+
+    return best;
+}
+
+void
+sc_tile_grid_get_cell(struct sc_tile_grid grid, struct sc_size render_size,
+                      unsigned index, SDL_FRect *cell) {
+    assert(grid.columns && grid.rows);
+    assert(index < grid.columns * grid.rows);
+
+    unsigned column = index % grid.columns;
+    unsigned row = index / grid.columns;
+
+    cell->w = (float) render_size.width / grid.columns;
+    cell->h = (float) render_size.height / grid.rows;
+    cell->x = column * cell->w;
+    cell->y = row * cell->h;
+}
+
+void
+sc_tile_fit(const SDL_FRect *cell, struct sc_size content_size,
+            SDL_FRect *rect) {
+    assert(content_size.width && content_size.height);
+
+    bool keep_width = content_size.width * cell->h
+                    > content_size.height * cell->w;
+    if (keep_width) {
+        rect->x = cell->x;
+        rect->w = cell->w;
+        rect->h = cell->w * content_size.height / content_size.width;
+        rect->y = cell->y + (cell->h - rect->h) / 2.f;
+    } else {
+        rect->y = cell->y;
+        rect->h = cell->h;
+        rect->w = cell->h * content_size.width / content_size.height;
+        rect->x = cell->x + (cell->w - rect->w) / 2.f;
+    }
+}
+
+int
+sc_tile_grid_get_index_at(struct sc_tile_grid grid, struct sc_size render_size,
+                          unsigned count, float x, float y) {
+    assert(grid.columns && grid.rows);
+
+    if (x < 0 || y < 0 || x >= render_size.width || y >= render_size.height) {
+        return -1;
+    }
+
+    unsigned column = x * grid.columns / render_size.width;
+    unsigned row = y * grid.rows / render_size.height;
+    // Protect against float rounding near the right and bottom edges
+    if (column >= grid.columns) {
+        column = grid.columns - 1;
+    }
+    if (row >= grid.rows) {
+        row = grid.rows - 1;
+    }
+
+    unsigned index = row * grid.columns + column;
+    if (index >= count) {
+        // empty cell in the last row
+        return -1;
+    }
+
+    return index;
+}
@@ -0,0 +1,52 @@
+#ifndef SC_TILE_LAYOUT_H
+#define SC_TILE_LAYOUT_H
+
+#include "common.h"
+
+#include <SDL3/SDL_rect.h>
+
+#include "coords.h"
+
+/**
+ * Grid of tiles, to render several contents in a single window
+ *
+ * All the cells have the same size, each content is scaled to fit its cell
+ * (preserving its aspect ratio).
+ */
+struct sc_tile_grid {
+    unsigned columns;
+    unsigned rows;
+};
+
+/**
+ * Compute the grid maximizing the size of the contents
+ *
+ * The content_size is the expected size of the contents (typically the size
+ * of the first frame), it is used to select the best number of columns.
+ */
+struct sc_tile_grid
+sc_tile_grid_compute(struct sc_size render_size, unsigned count,
+                     struct sc_size content_size);
+
+/**
+ * Get the rectangle of the cell at the given index (in row-major order)
+ */
+void
+sc_tile_grid_get_cell(struct sc_tile_grid grid, struct sc_size render_size,
+                      unsigned index, SDL_FRect *cell);
+
+/**
+ * Compute the rectangle of a content scaled to fit (and centered in) a cell
+ */
+void
+sc_tile_fit(const SDL_FRect *cell, struct sc_size content_size,
+            SDL_FRect *rect);
+
+/**
+ * Return the index of the cell containing the point, or -1 if none
+ */
+int
+sc_tile_grid_get_index_at(struct sc_tile_grid grid, struct sc_size render_size,
+                          unsigned count, float x, float y);
+
+#endif
@@ -18,9 +18,12 @@
 #define SC_GAMEPAD_UHID_NAME "Microsoft X-Box 360 Pad"
 
 static void
-sc_gamepad_uhid_send_input(struct sc_gamepad_uhid *gamepad,
-                           const struct sc_hid_input *hid_input,
-                           const char *name) {
+sc_gamepad_uhid_on_input(struct sc_hid_coalescer *coalescer,
+                         const struct sc_hid_input *hid_input,
+                         void *userdata) {
+    (void) coalescer;
+    struct sc_gamepad_uhid *gamepad = userdata;
+
     struct sc_control_msg msg;
     msg.type = SC_CONTROL_MSG_TYPE_UHID_INPUT;
     msg.uhid_input.id = hid_input->hid_id;
@@ -30,7 +33,7 @@ sc_gamepad_uhid_send_input(struct sc_gamepad_uhid *gamepad,
     msg.uhid_input.size = hid_input->size;
 
     if (!sc_controller_push_msg(gamepad->controller, &msg)) {
-        LOGE("Could not push UHID_INPUT message (%s)", name);
+        LOGE("Could not push UHID_INPUT message (gamepad)");
     }
 }
 
@@ -95,6 +98,9 @@ sc_gamepad_processor_process_gamepad_removed(struct sc_gamepad_processor *gp,
 
     LOGI("Gamepad removed: [%" PRIu32 "]", event->gamepad_id);
 
+    // Do not send a pending report after the close
+    sc_hid_coalescer_flush(&gamepad->coalescer, hid_close.hid_id);
+
     sc_gamepad_uhid_send_close(gamepad, &hid_close);
 }
 
@@ -109,7 +115,7 @@ sc_gamepad_processor_process_gamepad_axis(struct sc_gamepad_processor *gp,
         return;
     }
 
-    sc_gamepad_uhid_send_input(gamepad, &hid_input, "gamepad axis");
+    sc_hid_coalescer_push(&gamepad->coalescer, &hid_input);
 }
 
 static void
@@ -123,13 +129,28 @@ sc_gamepad_processor_process_gamepad_button(struct sc_gamepad_processor *gp,
         return;
     }
 
-    sc_gamepad_uhid_send_input(gamepad, &hid_input, "gamepad button");
-
+    sc_hid_coalescer_push(&gamepad->coalescer, &hid_input);
 }
 
-void
+bool
 sc_gamepad_uhid_init(struct sc_gamepad_uhid *gamepad,
-                     struct sc_controller *controller) {
+                     struct sc_controller *controller, uint16_t report_rate) {
+    static const struct sc_hid_coalescer_callbacks cbs = {
+        .on_input = sc_gamepad_uhid_on_input,
+    };
+
+    bool ok = sc_hid_coalescer_init(&gamepad->coalescer, report_rate, &cbs,
+                                    gamepad);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_hid_coalescer_start(&gamepad->coalescer);
+    if (!ok) {
+        sc_hid_coalescer_destroy(&gamepad->coalescer);
+        return false;
+    }
+
     sc_hid_gamepad_init(&gamepad->hid);
 
     gamepad->controller = controller;
@@ -142,4 +163,13 @@ sc_gamepad_uhid_init(struct sc_gamepad_uhid *gamepad,
     };
 
     gamepad->gamepad_processor.ops = &ops;
+
+    return true;
+}
+
+void
+sc_gamepad_uhid_destroy(struct sc_gamepad_uhid *gamepad) {
+    sc_hid_coalescer_stop(&gamepad->coalescer);
+    sc_hid_coalescer_join(&gamepad->coalescer);
+    sc_hid_coalescer_destroy(&gamepad->coalescer);
 }
@@ -3,7 +3,11 @@
 
 #include "common.h"
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "controller.h"
+#include "hid/hid_coalescer.h"
 #include "hid/hid_gamepad.h"
 #include "trait/gamepad_processor.h"
 
@@ -11,11 +15,16 @@ struct sc_gamepad_uhid {
     struct sc_gamepad_processor gamepad_processor; // gamepad processor trait
 
     struct sc_hid_gamepad hid;
+    struct sc_hid_coalescer coalescer;
     struct sc_controller *controller;
 };
 
-void
+// report_rate: maximum number of axes reports per second (0 = unlimited)
+bool
 sc_gamepad_uhid_init(struct sc_gamepad_uhid *mouse,
-                     struct sc_controller *controller);
+                     struct sc_controller *controller, uint16_t report_rate);
+
+void
+sc_gamepad_uhid_destroy(struct sc_gamepad_uhid *gamepad);
 
 #endif
@@ -11,9 +11,11 @@
 #define DOWNCAST(MP) container_of(MP, struct sc_mouse_uhid, mouse_processor)
 
 static void
-sc_mouse_uhid_send_input(struct sc_mouse_uhid *mouse,
-                         const struct sc_hid_input *hid_input,
-                         const char *name) {
+sc_mouse_uhid_on_input(struct sc_hid_coalescer *coalescer,
+                       const struct sc_hid_input *hid_input, void *userdata) {
+    (void) coalescer;
+    struct sc_mouse_uhid *mouse = userdata;
+
     struct sc_control_msg msg;
     msg.type = SC_CONTROL_MSG_TYPE_UHID_INPUT;
     msg.uhid_input.id = hid_input->hid_id;
@@ -23,7 +25,7 @@ sc_mouse_uhid_send_input(struct sc_mouse_uhid *mouse,
     msg.uhid_input.size = hid_input->size;
 
     if (!sc_controller_push_msg(mouse->controller, &msg)) {
-        LOGE("Could not push UHID_INPUT message (%s)", name);
+        LOGE("Could not push UHID_INPUT message (mouse)");
     }
 }
 
@@ -35,7 +37,7 @@ sc_mouse_processor_process_mouse_motion(struct sc_mouse_processor *mp,
     struct sc_hid_input hid_input;
     sc_hid_mouse_generate_input_from_motion(&hid_input, event);
 
-    sc_mouse_uhid_send_input(mouse, &hid_input, "mouse motion");
+    sc_hid_coalescer_push(&mouse->coalescer, &hid_input);
 }
 
 static void
@@ -46,7 +48,7 @@ sc_mouse_processor_process_mouse_click(struct sc_mouse_processor *mp,
     struct sc_hid_input hid_input;
     sc_hid_mouse_generate_input_from_click(&hid_input, event);
 
-    sc_mouse_uhid_send_input(mouse, &hid_input, "mouse click");
+    sc_hid_coalescer_push(&mouse->coalescer, &hid_input);
 }
 
 static void
@@ -60,12 +62,27 @@ sc_mouse_processor_process_mouse_scroll(struct sc_mouse_processor *mp,
         return;
     }
 
-    sc_mouse_uhid_send_input(mouse, &hid_input, "mouse scroll");
+    sc_hid_coalescer_push(&mouse->coalescer, &hid_input);
 }
 
 bool
 sc_mouse_uhid_init(struct sc_mouse_uhid *mouse,
-                   struct sc_controller *controller) {
+                   struct sc_controller *controller, uint16_t report_rate) {
+    static const struct sc_hid_coalescer_callbacks cbs = {
+        .on_input = sc_mouse_uhid_on_input,
+    };
+
+    bool ok = sc_hid_coalescer_init(&mouse->coalescer, report_rate, &cbs,
+                                    mouse);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_hid_coalescer_start(&mouse->coalescer);
+    if (!ok) {
+        goto error_destroy_coalescer;
+    }
+
     sc_hid_mouse_init(&mouse->hid);
 
     mouse->controller = controller;
@@ -96,8 +113,23 @@ sc_mouse_uhid_init(struct sc_mouse_uhid *mouse,
     msg.uhid_create.report_desc_size = hid_open.report_desc_size;
     if (!sc_controller_push_msg(controller, &msg)) {
         LOGE("Could not push UHID_CREATE message (mouse)");
-        return false;
+        goto error_stop_coalescer;
     }
 
     return true;
+
+error_stop_coalescer:
+    sc_hid_coalescer_stop(&mouse->coalescer);
+    sc_hid_coalescer_join(&mouse->coalescer);
+error_destroy_coalescer:
+    sc_hid_coalescer_destroy(&mouse->coalescer);
+
+    return false;
+}
+
+void
+sc_mouse_uhid_destroy(struct sc_mouse_uhid *mouse) {
+    sc_hid_coalescer_stop(&mouse->coalescer);
+    sc_hid_coalescer_join(&mouse->coalescer);
+    sc_hid_coalescer_destroy(&mouse->coalescer);
 }
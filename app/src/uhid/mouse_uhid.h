@@ -2,8 +2,10 @@
 #define SC_MOUSE_UHID_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "controller.h"
+#include "hid/hid_coalescer.h"
 #include "hid/hid_mouse.h"
 #include "trait/mouse_processor.h"
 
@@ -11,11 +13,16 @@ struct sc_mouse_uhid {
     struct sc_mouse_processor mouse_processor; // mouse processor trait
 
     struct sc_hid_mouse hid;
+    struct sc_hid_coalescer coalescer;
     struct sc_controller *controller;
 };
 
+// report_rate: maximum number of motion reports per second (0 = unlimited)
 bool
 sc_mouse_uhid_init(struct sc_mouse_uhid *mouse,
-                   struct sc_controller *controller);
+                   struct sc_controller *controller, uint16_t report_rate);
+
+void
+sc_mouse_uhid_destroy(struct sc_mouse_uhid *mouse);
 
 #endif
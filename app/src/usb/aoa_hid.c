@@ -4,10 +4,12 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <libusb-1.0/libusb.h>
 
 #include "events.h"
+#include "hid/hid_mouse.h"
 #include "util/log.h"
 #include "util/str.h"
 #include "util/tick.h"
@@ -23,6 +25,9 @@
 
 // Drop droppable events above this limit
 #define SC_AOA_EVENT_QUEUE_LIMIT 60
+// The capacity (a power of 2) leaves room for non-droppable events above the
+// limit
+#define SC_AOA_EVENT_QUEUE_CAPACITY 128
 
 struct sc_vec_hid_ids SC_VECTOR(uint16_t);
 
@@ -57,46 +62,188 @@ sc_hid_close_log(const struct sc_hid_close *hid_close) {
     LOGV("HID close: [%" PRIu16 "]", hid_close->hid_id);
 }
 
-bool
-sc_aoa_init(struct sc_aoa *aoa, struct sc_usb *usb,
-            struct sc_acksync *acksync) {
-    sc_vecdeque_init(&aoa->queue);
+static int
+sc_aoa_libusb_control(struct sc_aoa *aoa, uint8_t request, uint16_t value,
+                      uint16_t index, unsigned char *data, uint16_t length) {
+    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
+    int result = libusb_control_transfer(aoa->usb->handle, request_type,
+                                         request, value, index, data, length,
+                                         DEFAULT_TIMEOUT);
+    return result < 0 ? result : 0;
+}
+
+static void LIBUSB_CALL
+sc_aoa_libusb_transfer_cb(struct libusb_transfer *transfer) {
+    struct sc_aoa_transfer *aoa_transfer = transfer->user_data;
+
+    int result;
+    switch (transfer->status) {
+        case LIBUSB_TRANSFER_COMPLETED:
+            result = 0;
+            break;
+        case LIBUSB_TRANSFER_TIMED_OUT:
+            result = LIBUSB_ERROR_TIMEOUT;
+            break;
+        case LIBUSB_TRANSFER_CANCELLED:
+            result = LIBUSB_ERROR_INTERRUPTED;
+            break;
+        case LIBUSB_TRANSFER_STALL:
+            result = LIBUSB_ERROR_PIPE;
+            break;
+        case LIBUSB_TRANSFER_NO_DEVICE:
+            result = LIBUSB_ERROR_NO_DEVICE;
+            break;
+        case LIBUSB_TRANSFER_OVERFLOW:
+            result = LIBUSB_ERROR_OVERFLOW;
+            break;
+        default:
+            result = LIBUSB_ERROR_IO;
+            break;
+    }
+
+    sc_aoa_transfer_completed(aoa_transfer, result);
+}
+
+static int
+sc_aoa_libusb_submit(struct sc_aoa *aoa, struct sc_aoa_transfer *transfer) {
+    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
+    uint8_t request = ACCESSORY_SEND_HID_EVENT;
+    // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
+    // value (arg0): accessory assigned ID for the HID device
+    // index (arg1): 0 (unused)
+    const struct sc_hid_input *hid_input = &transfer->hid;
+    uint16_t value = hid_input->hid_id;
+    uint16_t index = 0;
+    uint16_t length = hid_input->size;
+
+    libusb_fill_control_setup(transfer->buffer, request_type, request, value,
+                              index, length);
+    memcpy(transfer->buffer + LIBUSB_CONTROL_SETUP_SIZE, hid_input->data,
+           length);
+    libusb_fill_control_transfer(transfer->transfer, aoa->usb->handle,
+                                 transfer->buffer, sc_aoa_libusb_transfer_cb,
+                                 transfer, DEFAULT_TIMEOUT);
+
+    return libusb_submit_transfer(transfer->transfer);
+}
+
+static void
+sc_aoa_libusb_cancel(struct sc_aoa *aoa, struct sc_aoa_transfer *transfer) {
+    (void) aoa;
+    // If the transfer is already completed, the callback is called anyway
+    libusb_cancel_transfer(transfer->transfer);
+}
+
+static const struct sc_aoa_transport_ops sc_aoa_libusb_ops = {
+    .control = sc_aoa_libusb_control,
+    .submit = sc_aoa_libusb_submit,
+    .cancel = sc_aoa_libusb_cancel,
+};
 
-    // Add 4 to support 4 non-droppable events without re-allocation
-    if (!sc_vecdeque_reserve(&aoa->queue, SC_AOA_EVENT_QUEUE_LIMIT + 4)) {
+static bool
+sc_aoa_init_internal(struct sc_aoa *aoa, struct sc_usb *usb,
+                     const struct sc_aoa_transport_ops *ops,
+                     struct sc_acksync *acksync) {
+    assert(ops && ops->control && ops->submit && ops->cancel);
+
+    if (!sc_mpsc_queue_init(&aoa->queue, SC_AOA_EVENT_QUEUE_CAPACITY,
+                            sizeof(struct sc_aoa_event))) {
         return false;
     }
 
     if (!sc_mutex_init(&aoa->mutex)) {
-        sc_vecdeque_destroy(&aoa->queue);
-        return false;
+        goto error_destroy_queue;
     }
 
-    if (!sc_cond_init(&aoa->event_cond)) {
-        sc_mutex_destroy(&aoa->mutex);
-        sc_vecdeque_destroy(&aoa->queue);
-        return false;
+    if (!sc_notifier_init(&aoa->notifier)) {
+        goto error_destroy_mutex;
+    }
+
+    if (!sc_cond_init(&aoa->transfer_cond)) {
+        goto error_destroy_notifier;
     }
 
-    aoa->stopped = false;
+    unsigned allocated;
+    for (allocated = 0; allocated < SC_AOA_MAX_IN_FLIGHT; ++allocated) {
+        struct sc_aoa_transfer *transfer = &aoa->transfers[allocated];
+        transfer->aoa = aoa;
+        transfer->submitted = false;
+        transfer->transfer = NULL;
+
+        if (usb) {
+            transfer->transfer = libusb_alloc_transfer(0);
+            if (!transfer->transfer) {
+                LOG_OOM();
+                goto error_free_transfers;
+            }
+        }
+    }
+
+    aoa->in_flight = 0;
+    aoa->has_event_thread = false;
+    atomic_init(&aoa->stopped, false);
     aoa->acksync = acksync;
     aoa->usb = usb;
+    aoa->ops = ops;
 
     return true;
+
+error_free_transfers:
+    for (unsigned i = 0; i < allocated; ++i) {
+        libusb_free_transfer(aoa->transfers[i].transfer);
+    }
+    sc_cond_destroy(&aoa->transfer_cond);
+error_destroy_notifier:
+    sc_notifier_destroy(&aoa->notifier);
+error_destroy_mutex:
+    sc_mutex_destroy(&aoa->mutex);
+error_destroy_queue:
+    sc_mpsc_queue_destroy(&aoa->queue);
+
+    return false;
+}
+
+bool
+sc_aoa_init(struct sc_aoa *aoa, struct sc_usb *usb,
+            struct sc_acksync *acksync) {
+    assert(usb);
+    return sc_aoa_init_internal(aoa, usb, &sc_aoa_libusb_ops, acksync);
+}
+
+bool
+sc_aoa_init_with_transport(struct sc_aoa *aoa,
+                           const struct sc_aoa_transport_ops *ops,
+                           struct sc_acksync *acksync) {
+    return sc_aoa_init_internal(aoa, NULL, ops, acksync);
 }
 
 void
 sc_aoa_destroy(struct sc_aoa *aoa) {
-    sc_vecdeque_destroy(&aoa->queue);
+    assert(!aoa->in_flight);
+
+    if (aoa->usb) {
+        for (unsigned i = 0; i < SC_AOA_MAX_IN_FLIGHT; ++i) {
+            libusb_free_transfer(aoa->transfers[i].transfer);
+        }
+    }
 
-    sc_cond_destroy(&aoa->event_cond);
+    sc_mpsc_queue_destroy(&aoa->queue);
+
+    sc_cond_destroy(&aoa->transfer_cond);
+    sc_notifier_destroy(&aoa->notifier);
     sc_mutex_destroy(&aoa->mutex);
 }
 
+static void
+sc_aoa_check_disconnected(struct sc_aoa *aoa, int result) {
+    if (aoa->usb) {
+        sc_usb_check_disconnected(aoa->usb, result);
+    }
+}
+
 static bool
 sc_aoa_register_hid(struct sc_aoa *aoa, uint16_t accessory_id,
                     uint16_t report_desc_size) {
-    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
     uint8_t request = ACCESSORY_REGISTER_HID;
     // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
     // value (arg0): accessory assigned ID for the HID device
@@ -105,12 +252,10 @@ sc_aoa_register_hid(struct sc_aoa *aoa, uint16_t accessory_id,
     uint16_t index = report_desc_size;
     unsigned char *data = NULL;
     uint16_t length = 0;
-    int result = libusb_control_transfer(aoa->usb->handle, request_type,
-                                         request, value, index, data, length,
-                                         DEFAULT_TIMEOUT);
+    int result = aoa->ops->control(aoa, request, value, index, data, length);
     if (result < 0) {
         LOGE("REGISTER_HID: libusb error: %s", libusb_strerror(result));
-        sc_usb_check_disconnected(aoa->usb, result);
+        sc_aoa_check_disconnected(aoa, result);
         return false;
     }
 
@@ -121,7 +266,6 @@ static bool
 sc_aoa_set_hid_report_desc(struct sc_aoa *aoa, uint16_t accessory_id,
                            const uint8_t *report_desc,
                            uint16_t report_desc_size) {
-    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
     uint8_t request = ACCESSORY_SET_HID_REPORT_DESC;
     /**
      * If the HID descriptor is longer than the endpoint zero max packet size,
@@ -139,48 +283,112 @@ sc_aoa_set_hid_report_desc(struct sc_aoa *aoa, uint16_t accessory_id,
     // index (arg1): offset of data in descriptor
     uint16_t value = accessory_id;
     uint16_t index = 0;
-    // libusb_control_transfer expects a pointer to non-const
+    // The transport expects a pointer to non-const
     unsigned char *data = (unsigned char *) report_desc;
     uint16_t length = report_desc_size;
-    int result = libusb_control_transfer(aoa->usb->handle, request_type,
-                                         request, value, index, data, length,
-                                         DEFAULT_TIMEOUT);
+    int result = aoa->ops->control(aoa, request, value, index, data, length);
     if (result < 0) {
         LOGE("SET_HID_REPORT_DESC: libusb error: %s", libusb_strerror(result));
-        sc_usb_check_disconnected(aoa->usb, result);
+        sc_aoa_check_disconnected(aoa, result);
         return false;
     }
 
     return true;
 }
 
+void
+sc_aoa_transfer_completed(struct sc_aoa_transfer *transfer, int result) {
+    struct sc_aoa *aoa = transfer->aoa;
+
+    // A cancelled transfer is not an error (it only happens on stop)
+    if (result < 0 && result != LIBUSB_ERROR_INTERRUPTED) {
+        LOGW("SEND_HID_EVENT: libusb error: %s", libusb_strerror(result));
+        sc_aoa_check_disconnected(aoa, result);
+    }
+
+    sc_mutex_lock(&aoa->mutex);
+    assert(transfer->submitted);
+    assert(aoa->in_flight);
+    transfer->submitted = false;
+    --aoa->in_flight;
+    sc_cond_signal(&aoa->transfer_cond);
+    sc_mutex_unlock(&aoa->mutex);
+}
+
 static bool
-sc_aoa_send_hid_event(struct sc_aoa *aoa,
+sc_aoa_is_stopped(struct sc_aoa *aoa) {
+    return atomic_load_explicit(&aoa->stopped, memory_order_relaxed);
+}
+
+// Wait for a free transfer slot, return NULL if stopped
+static struct sc_aoa_transfer *
+sc_aoa_acquire_transfer(struct sc_aoa *aoa) {
+    sc_mutex_lock(&aoa->mutex);
+    while (!sc_aoa_is_stopped(aoa) && aoa->in_flight == SC_AOA_MAX_IN_FLIGHT) {
+        sc_cond_wait(&aoa->transfer_cond, &aoa->mutex);
+    }
+    if (sc_aoa_is_stopped(aoa)) {
+        sc_mutex_unlock(&aoa->mutex);
+        return NULL;
+    }
+
+    struct sc_aoa_transfer *transfer = NULL;
+    for (unsigned i = 0; i < SC_AOA_MAX_IN_FLIGHT; ++i) {
+        if (!aoa->transfers[i].submitted) {
+            transfer = &aoa->transfers[i];
+            break;
+        }
+    }
+    assert(transfer);
+    transfer->submitted = true;
+    ++aoa->in_flight;
+    sc_mutex_unlock(&aoa->mutex);
+
+    return transfer;
+}
+
+static bool
+sc_aoa_send_hid_event(struct sc_aoa *aoa, struct sc_aoa_transfer *transfer,
                       const struct sc_hid_input *hid_input) {
-    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
-    uint8_t request = ACCESSORY_SEND_HID_EVENT;
-    // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
-    // value (arg0): accessory assigned ID for the HID device
-    // index (arg1): 0 (unused)
-    uint16_t value = hid_input->hid_id;
-    uint16_t index = 0;
-    unsigned char *data = (uint8_t *) hid_input->data; // discard const
-    uint16_t length = hid_input->size;
-    int result = libusb_control_transfer(aoa->usb->handle, request_type,
-                                         request, value, index, data, length,
-                                         DEFAULT_TIMEOUT);
+    transfer->hid = *hid_input;
+
+    // All the requests are sent to the control endpoint, whose transfers are
+    // processed in order, so the events of a HID device remain ordered
+    int result = aoa->ops->submit(aoa, transfer);
     if (result < 0) {
         LOGE("SEND_HID_EVENT: libusb error: %s", libusb_strerror(result));
-        sc_usb_check_disconnected(aoa->usb, result);
+        sc_aoa_check_disconnected(aoa, result);
+
+        sc_mutex_lock(&aoa->mutex);
+        transfer->submitted = false;
+        --aoa->in_flight;
+        sc_mutex_unlock(&aoa->mutex);
         return false;
     }
 
     return true;
 }
 
+// Wait for all the submitted transfers to complete
+static void
+sc_aoa_wait_transfers(struct sc_aoa *aoa, bool cancel) {
+    sc_mutex_lock(&aoa->mutex);
+    if (cancel) {
+        for (unsigned i = 0; i < SC_AOA_MAX_IN_FLIGHT; ++i) {
+            struct sc_aoa_transfer *transfer = &aoa->transfers[i];
+            if (transfer->submitted) {
+                aoa->ops->cancel(aoa, transfer);
+            }
+        }
+    }
+    while (aoa->in_flight) {
+        sc_cond_wait(&aoa->transfer_cond, &aoa->mutex);
+    }
+    sc_mutex_unlock(&aoa->mutex);
+}
+
 static bool
 sc_aoa_unregister_hid(struct sc_aoa *aoa, uint16_t accessory_id) {
-    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
     uint8_t request = ACCESSORY_UNREGISTER_HID;
     // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
     // value (arg0): accessory assigned ID for the HID device
@@ -189,12 +397,10 @@ sc_aoa_unregister_hid(struct sc_aoa *aoa, uint16_t accessory_id) {
     uint16_t index = 0;
     unsigned char *data = NULL;
     uint16_t length = 0;
-    int result = libusb_control_transfer(aoa->usb->handle, request_type,
-                                         request, value, index, data, length,
-                                         DEFAULT_TIMEOUT);
+    int result = aoa->ops->control(aoa, request, value, index, data, length);
     if (result < 0) {
         LOGE("UNREGISTER_HID: libusb error: %s", libusb_strerror(result));
-        sc_usb_check_disconnected(aoa->usb, result);
+        sc_aoa_check_disconnected(aoa, result);
         return false;
     }
 
@@ -221,6 +427,15 @@ sc_aoa_setup_hid(struct sc_aoa *aoa, uint16_t accessory_id,
     return true;
 }
 
+static bool
+sc_aoa_push_event(struct sc_aoa *aoa, const struct sc_aoa_event *event) {
+    bool pushed = sc_mpsc_queue_push(&aoa->queue, event);
+    if (pushed) {
+        sc_notifier_notify(&aoa->notifier);
+    }
+    return pushed;
+}
+
 bool
 sc_aoa_push_input_with_ack_to_wait(struct sc_aoa *aoa,
                                    const struct sc_hid_input *hid_input,
@@ -229,30 +444,22 @@ sc_aoa_push_input_with_ack_to_wait(struct sc_aoa *aoa,
         sc_hid_input_log(hid_input);
     }
 
-    sc_mutex_lock(&aoa->mutex);
-
-    bool pushed = false;
-
-    size_t size = sc_vecdeque_size(&aoa->queue);
-    if (size < SC_AOA_EVENT_QUEUE_LIMIT) {
-        bool was_empty = sc_vecdeque_is_empty(&aoa->queue);
-
-        struct sc_aoa_event *aoa_event =
-            sc_vecdeque_push_hole_noresize(&aoa->queue);
-        aoa_event->type = SC_AOA_EVENT_TYPE_INPUT;
-        aoa_event->input.hid = *hid_input;
-        aoa_event->input.ack_to_wait = ack_to_wait;
-        pushed = true;
-
-        if (was_empty) {
-            sc_cond_signal(&aoa->event_cond);
-        }
+    // The size is approximate if other threads push concurrently, which is
+    // fine for a drop threshold
+    if (sc_mpsc_queue_size(&aoa->queue) >= SC_AOA_EVENT_QUEUE_LIMIT) {
+        // The event is discarded
+        return false;
     }
-    // Otherwise, the event is discarded
 
-    sc_mutex_unlock(&aoa->mutex);
+    struct sc_aoa_event aoa_event = {
+        .type = SC_AOA_EVENT_TYPE_INPUT,
+        .input = {
+            .hid = *hid_input,
+            .ack_to_wait = ack_to_wait,
+        },
+    };
 
-    return pushed;
+    return sc_aoa_push_event(aoa, &aoa_event);
 }
 
 bool
@@ -262,29 +469,22 @@ sc_aoa_push_open(struct sc_aoa *aoa, const struct sc_hid_open *hid_open,
         sc_hid_open_log(hid_open);
     }
 
-    sc_mutex_lock(&aoa->mutex);
-    bool was_empty = sc_vecdeque_is_empty(&aoa->queue);
+    struct sc_aoa_event aoa_event = {
+        .type = SC_AOA_EVENT_TYPE_OPEN,
+        .open = {
+            .hid = *hid_open,
+            .exit_on_error = exit_on_open_error,
+        },
+    };
 
     // an OPEN event is non-droppable, so push it to the queue even above the
     // SC_AOA_EVENT_QUEUE_LIMIT
-    struct sc_aoa_event *aoa_event = sc_vecdeque_push_hole(&aoa->queue);
-    if (!aoa_event) {
-        LOG_OOM();
-        sc_mutex_unlock(&aoa->mutex);
-        return false;
+    bool pushed = sc_aoa_push_event(aoa, &aoa_event);
+    if (!pushed) {
+        LOGW("AOA event queue full, HID open dropped");
     }
 
-    aoa_event->type = SC_AOA_EVENT_TYPE_OPEN;
-    aoa_event->open.hid = *hid_open;
-    aoa_event->open.exit_on_error = exit_on_open_error;
-
-    if (was_empty) {
-        sc_cond_signal(&aoa->event_cond);
-    }
-
-    sc_mutex_unlock(&aoa->mutex);
-
-    return true;
+    return pushed;
 }
 
 bool
@@ -293,28 +493,49 @@ sc_aoa_push_close(struct sc_aoa *aoa, const struct sc_hid_close *hid_close) {
         sc_hid_close_log(hid_close);
     }
 
-    sc_mutex_lock(&aoa->mutex);
-    bool was_empty = sc_vecdeque_is_empty(&aoa->queue);
+    struct sc_aoa_event aoa_event = {
+        .type = SC_AOA_EVENT_TYPE_CLOSE,
+        .close = {
+            .hid = *hid_close,
+        },
+    };
 
     // a CLOSE event is non-droppable, so push it to the queue even above the
     // SC_AOA_EVENT_QUEUE_LIMIT
-    struct sc_aoa_event *aoa_event = sc_vecdeque_push_hole(&aoa->queue);
-    if (!aoa_event) {
-        LOG_OOM();
-        sc_mutex_unlock(&aoa->mutex);
-        return false;
+    bool pushed = sc_aoa_push_event(aoa, &aoa_event);
+    if (!pushed) {
+        LOGW("AOA event queue full, HID close dropped");
     }
 
-    aoa_event->type = SC_AOA_EVENT_TYPE_CLOSE;
-    aoa_event->close.hid = *hid_close;
+    return pushed;
+}
 
-    if (was_empty) {
-        sc_cond_signal(&aoa->event_cond);
+// If the next queued mouse reports have not been submitted yet (the device is
+// slower than the mouse), merge them into the report about to be sent
+static void
+sc_aoa_merge_next_inputs(struct sc_aoa *aoa, struct sc_hid_input *hid_input) {
+    if (hid_input->hid_id != SC_HID_ID_MOUSE) {
+        return;
     }
 
-    sc_mutex_unlock(&aoa->mutex);
+    for (;;) {
+        const struct sc_aoa_event *next = sc_mpsc_queue_peek(&aoa->queue);
+        if (!next
+                || next->type != SC_AOA_EVENT_TYPE_INPUT
+                || next->input.hid.hid_id != SC_HID_ID_MOUSE
+                || next->input.ack_to_wait != SC_SEQUENCE_INVALID) {
+            return;
+        }
 
-    return true;
+        if (!sc_hid_mouse_merge_input(hid_input, &next->input.hid)) {
+            return;
+        }
+
+        struct sc_aoa_event merged;
+        bool ok = sc_mpsc_queue_pop(&aoa->queue, &merged);
+        assert(ok);
+        (void) ok;
+    }
 }
 
 static bool
@@ -346,8 +567,19 @@ sc_aoa_process_event(struct sc_aoa *aoa, struct sc_aoa_event *event,
                 }
             }
 
+            struct sc_aoa_transfer *transfer = sc_aoa_acquire_transfer(aoa);
+            if (!transfer) {
+                // stopped
+                return false;
+            }
+
+            // The transfer may have been acquired after a while, merge the
+            // reports queued meanwhile
             struct sc_hid_input *hid_input = &event->input.hid;
-            bool ok = sc_aoa_send_hid_event(aoa, hid_input);
+            sc_aoa_merge_next_inputs(aoa, hid_input);
+
+            // The completion is handled asynchronously
+            bool ok = sc_aoa_send_hid_event(aoa, transfer, hid_input);
             if (!ok) {
                 LOGW("Could not send HID event to USB device: %" PRIu16,
                      hid_input->hid_id);
@@ -356,6 +588,10 @@ sc_aoa_process_event(struct sc_aoa *aoa, struct sc_aoa_event *event,
             break;
         }
         case SC_AOA_EVENT_TYPE_OPEN: {
+            // Do not register a HID device before the previous events are
+            // sent
+            sc_aoa_wait_transfers(aoa, false);
+
             struct sc_hid_open *hid_open = &event->open.hid;
             bool ok = sc_aoa_setup_hid(aoa, hid_open->hid_id,
                                        hid_open->report_desc,
@@ -380,6 +616,10 @@ sc_aoa_process_event(struct sc_aoa *aoa, struct sc_aoa_event *event,
             break;
         }
         case SC_AOA_EVENT_TYPE_CLOSE: {
+            // Send the pending events of the HID device before unregistering
+            // it
+            sc_aoa_wait_transfers(aoa, false);
+
             struct sc_hid_close *hid_close = &event->close.hid;
             bool ok = sc_aoa_unregister_hid(aoa, hid_close->hid_id);
             if (ok) {
@@ -409,20 +649,23 @@ run_aoa_thread(void *data) {
     struct sc_vec_hid_ids vec_open = SC_VECTOR_INITIALIZER;
 
     for (;;) {
-        sc_mutex_lock(&aoa->mutex);
-        while (!aoa->stopped && sc_vecdeque_is_empty(&aoa->queue)) {
-            sc_cond_wait(&aoa->event_cond, &aoa->mutex);
+        struct sc_aoa_event event;
+        while (!sc_aoa_is_stopped(aoa)
+                && !sc_mpsc_queue_pop(&aoa->queue, &event)) {
+            sc_notifier_prepare_wait(&aoa->notifier);
+            // Check again, an event might have been pushed meanwhile
+            if (sc_aoa_is_stopped(aoa)
+                    || !sc_mpsc_queue_is_empty(&aoa->queue)) {
+                sc_notifier_cancel_wait(&aoa->notifier);
+            } else {
+                sc_notifier_wait(&aoa->notifier);
+            }
         }
-        if (aoa->stopped) {
+        if (sc_aoa_is_stopped(aoa)) {
             // Stop immediately, do not process further events
-            sc_mutex_unlock(&aoa->mutex);
             break;
         }
 
-        assert(!sc_vecdeque_is_empty(&aoa->queue));
-        struct sc_aoa_event event = sc_vecdeque_pop(&aoa->queue);
-        sc_mutex_unlock(&aoa->mutex);
-
         bool cont = sc_aoa_process_event(aoa, &event, &vec_open);
         if (!cont) {
             // stopped
@@ -430,6 +673,10 @@ run_aoa_thread(void *data) {
         }
     }
 
+    // The pending events are dropped on stop, but the transfers must be
+    // completed before exiting
+    sc_aoa_wait_transfers(aoa, true);
+
     // Explicitly unregister all registered HID ids before exiting
     for (size_t i = 0; i < vec_open.size; ++i) {
         uint16_t hid_id = vec_open.data[i];
@@ -444,13 +691,51 @@ run_aoa_thread(void *data) {
     return 0;
 }
 
+static int
+run_aoa_event_handler(void *data) {
+    struct sc_aoa *aoa = data;
+    while (!atomic_load(&aoa->event_thread_stopped)) {
+        // Interrupted by events or by libusb_interrupt_event_handler()
+        libusb_handle_events(aoa->usb->context);
+    }
+    return 0;
+}
+
+static void
+sc_aoa_stop_event_thread(struct sc_aoa *aoa) {
+    assert(aoa->has_event_thread);
+    atomic_store(&aoa->event_thread_stopped, true);
+    libusb_interrupt_event_handler(aoa->usb->context);
+    sc_thread_join(&aoa->event_thread, NULL);
+    aoa->has_event_thread = false;
+}
+
 bool
 sc_aoa_start(struct sc_aoa *aoa) {
+    if (aoa->usb) {
+        // The completion callbacks of the asynchronous transfers are called
+        // from the thread handling the libusb events
+        LOGD("Starting AOA event thread");
+
+        atomic_init(&aoa->event_thread_stopped, false);
+        bool ok = sc_thread_create(&aoa->event_thread, run_aoa_event_handler,
+                                   "scrcpy-aoa-ev", aoa);
+        if (!ok) {
+            LOGE("Could not start AOA event thread");
+            return false;
+        }
+
+        aoa->has_event_thread = true;
+    }
+
     LOGD("Starting AOA thread");
 
     bool ok = sc_thread_create(&aoa->thread, run_aoa_thread, "scrcpy-aoa", aoa);
     if (!ok) {
         LOGE("Could not start AOA thread");
+        if (aoa->has_event_thread) {
+            sc_aoa_stop_event_thread(aoa);
+        }
         return false;
     }
 
@@ -459,11 +744,15 @@ sc_aoa_start(struct sc_aoa *aoa) {
 
 void
 sc_aoa_stop(struct sc_aoa *aoa) {
+    // The stopped flag is also read under the mutex, to not miss the signal
+    // of transfer_cond
     sc_mutex_lock(&aoa->mutex);
-    aoa->stopped = true;
-    sc_cond_signal(&aoa->event_cond);
+    atomic_store_explicit(&aoa->stopped, true, memory_order_relaxed);
+    sc_cond_signal(&aoa->transfer_cond);
     sc_mutex_unlock(&aoa->mutex);
 
+    sc_notifier_notify(&aoa->notifier);
+
     if (aoa->acksync) {
         sc_acksync_interrupt(aoa->acksync);
     }
@@ -472,4 +761,10 @@ sc_aoa_stop(struct sc_aoa *aoa) {
 void
 sc_aoa_join(struct sc_aoa *aoa) {
     sc_thread_join(&aoa->thread, NULL);
+
+    // The AOA thread waits for the completion of its transfers before
+    // exiting, so the event thread is not needed anymore
+    if (aoa->has_event_thread) {
+        sc_aoa_stop_event_thread(aoa);
+    }
 }
@@ -3,14 +3,17 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <libusb-1.0/libusb.h>
 
 #include "hid/hid_event.h"
 #include "usb/usb.h"
 #include "util/acksync.h"
+#include "util/mpsc_queue.h"
+#include "util/notifier.h"
 #include "util/thread.h"
-#include "util/vecdeque.h"
 
 enum sc_aoa_event_type {
     SC_AOA_EVENT_TYPE_OPEN,
@@ -35,15 +38,68 @@ struct sc_aoa_event {
     };
 };
 
-struct sc_aoa_event_queue SC_VECDEQUE(struct sc_aoa_event);
+// Maximum number of HID events submitted to the device at the same time
+#define SC_AOA_MAX_IN_FLIGHT 4
+
+struct sc_aoa;
+
+struct sc_aoa_transfer {
+    struct sc_aoa *aoa;
+    struct sc_hid_input hid;
+    bool submitted; // protected by the sc_aoa mutex
+
+    // Only used by the libusb transport
+    struct libusb_transfer *transfer;
+    // Setup packet followed by the HID report
+    unsigned char buffer[LIBUSB_CONTROL_SETUP_SIZE + SC_HID_MAX_SIZE];
+};
+
+/**
+ * Transport of the AOA requests
+ *
+ * The default transport uses libusb. Another one may be provided to
+ * sc_aoa_init_with_transport() (typically a mock for tests).
+ *
+ * The functions return a libusb error code (negative) on error.
+ */
+struct sc_aoa_transport_ops {
+    // Send a vendor request synchronously
+    int (*control)(struct sc_aoa *aoa, uint8_t request, uint16_t value,
+                   uint16_t index, unsigned char *data, uint16_t length);
+
+    // Submit a HID event asynchronously
+    //
+    // On success, sc_aoa_transfer_completed() must be called exactly once for
+    // this transfer, from another thread.
+    int (*submit)(struct sc_aoa *aoa, struct sc_aoa_transfer *transfer);
+
+    // Request the cancellation of a submitted transfer (its completion must
+    // still be reported, from another thread)
+    void (*cancel)(struct sc_aoa *aoa, struct sc_aoa_transfer *transfer);
+};
 
 struct sc_aoa {
-    struct sc_usb *usb;
+    struct sc_usb *usb; // NULL if the transport is not libusb
+    const struct sc_aoa_transport_ops *ops;
+
     sc_thread thread;
     sc_mutex mutex;
-    sc_cond event_cond;
-    bool stopped;
-    struct sc_aoa_event_queue queue;
+    atomic_bool stopped;
+    // Queue of struct sc_aoa_event, pushed from any thread without locking
+    struct sc_mpsc_queue queue;
+    // Wake up the AOA thread on new event or stop
+    struct sc_notifier notifier;
+
+    // HID events are sent asynchronously, with up to SC_AOA_MAX_IN_FLIGHT
+    // transfers in flight (protected by the mutex)
+    struct sc_aoa_transfer transfers[SC_AOA_MAX_IN_FLIGHT];
+    unsigned in_flight;
+    sc_cond transfer_cond;
+
+    // Thread handling the libusb events, to call the completion callbacks
+    bool has_event_thread;
+    sc_thread event_thread;
+    atomic_bool event_thread_stopped;
 
     struct sc_acksync *acksync;
 };
@@ -51,6 +107,11 @@ struct sc_aoa {
 bool
 sc_aoa_init(struct sc_aoa *aoa, struct sc_usb *usb, struct sc_acksync *acksync);
 
+bool
+sc_aoa_init_with_transport(struct sc_aoa *aoa,
+                           const struct sc_aoa_transport_ops *ops,
+                           struct sc_acksync *acksync);
+
 void
 sc_aoa_destroy(struct sc_aoa *aoa);
 
@@ -63,6 +124,14 @@ sc_aoa_stop(struct sc_aoa *aoa);
 void
 sc_aoa_join(struct sc_aoa *aoa);
 
+/**
+ * Report the completion of a transfer submitted by the transport
+ *
+ * The result is 0 on success, or a libusb error code.
+ */
+void
+sc_aoa_transfer_completed(struct sc_aoa_transfer *transfer, int result);
+
 //bool
 //sc_aoa_setup_hid(struct sc_aoa *aoa, uint16_t accessory_id,
 //              const uint8_t *report_desc, uint16_t report_desc_size);
@@ -8,6 +8,17 @@
 /** Downcast gamepad processor to gamepad_aoa */
 #define DOWNCAST(GP) container_of(GP, struct sc_gamepad_aoa, gamepad_processor)
 
+static void
+sc_gamepad_aoa_on_input(struct sc_hid_coalescer *coalescer,
+                        const struct sc_hid_input *hid_input, void *userdata) {
+    (void) coalescer;
+    struct sc_gamepad_aoa *gamepad = userdata;
+
+    if (!sc_aoa_push_input(gamepad->aoa, hid_input)) {
+        LOGW("Could not push AOA HID input (gamepad)");
+    }
+}
+
 static void
 sc_gamepad_processor_process_gamepad_added(struct sc_gamepad_processor *gp,
                                 const struct sc_gamepad_device_event *event) {
@@ -36,6 +47,9 @@ sc_gamepad_processor_process_gamepad_removed(struct sc_gamepad_processor *gp,
         return;
     }
 
+    // Do not send a pending report after the close
+    sc_hid_coalescer_flush(&gamepad->coalescer, hid_close.hid_id);
+
     if (!sc_aoa_push_close(gamepad->aoa, &hid_close)) {
         LOGW("Could not push AOA HID close (gamepad)");
     }
@@ -52,9 +66,7 @@ sc_gamepad_processor_process_gamepad_axis(struct sc_gamepad_processor *gp,
         return;
     }
 
-    if (!sc_aoa_push_input(gamepad->aoa, &hid_input)) {
-        LOGW("Could not push AOA HID input (gamepad axis)");
-    }
+    sc_hid_coalescer_push(&gamepad->coalescer, &hid_input);
 }
 
 static void
@@ -68,15 +80,30 @@ sc_gamepad_processor_process_gamepad_button(struct sc_gamepad_processor *gp,
         return;
     }
 
-    if (!sc_aoa_push_input(gamepad->aoa, &hid_input)) {
-        LOGW("Could not push AOA HID input (gamepad button)");
-    }
+    sc_hid_coalescer_push(&gamepad->coalescer, &hid_input);
 }
 
-void
-sc_gamepad_aoa_init(struct sc_gamepad_aoa *gamepad, struct sc_aoa *aoa) {
+bool
+sc_gamepad_aoa_init(struct sc_gamepad_aoa *gamepad, struct sc_aoa *aoa,
+                    uint16_t report_rate) {
     gamepad->aoa = aoa;
 
+    static const struct sc_hid_coalescer_callbacks cbs = {
+        .on_input = sc_gamepad_aoa_on_input,
+    };
+
+    bool ok = sc_hid_coalescer_init(&gamepad->coalescer, report_rate, &cbs,
+                                    gamepad);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_hid_coalescer_start(&gamepad->coalescer);
+    if (!ok) {
+        sc_hid_coalescer_destroy(&gamepad->coalescer);
+        return false;
+    }
+
     sc_hid_gamepad_init(&gamepad->hid);
 
     static const struct sc_gamepad_processor_ops ops = {
@@ -87,10 +114,14 @@ sc_gamepad_aoa_init(struct sc_gamepad_aoa *gamepad, struct sc_aoa *aoa) {
     };
 
     gamepad->gamepad_processor.ops = &ops;
+
+    return true;
 }
 
 void
 sc_gamepad_aoa_destroy(struct sc_gamepad_aoa *gamepad) {
-    (void) gamepad;
-    // Do nothing, gamepad->aoa will automatically unregister all devices
+    sc_hid_coalescer_stop(&gamepad->coalescer);
+    sc_hid_coalescer_join(&gamepad->coalescer);
+    sc_hid_coalescer_destroy(&gamepad->coalescer);
+    // gamepad->aoa will automatically unregister all devices
 }
@@ -3,6 +3,10 @@
 
 #include "common.h"
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hid/hid_coalescer.h"
 #include "hid/hid_gamepad.h"
 #include "usb/aoa_hid.h"
 #include "trait/gamepad_processor.h"
@@ -11,11 +15,14 @@ struct sc_gamepad_aoa {
     struct sc_gamepad_processor gamepad_processor; // gamepad processor trait
 
     struct sc_hid_gamepad hid;
+    struct sc_hid_coalescer coalescer;
     struct sc_aoa *aoa;
 };
 
-void
-sc_gamepad_aoa_init(struct sc_gamepad_aoa *gamepad, struct sc_aoa *aoa);
+// report_rate: maximum number of axes reports per second (0 = unlimited)
+bool
+sc_gamepad_aoa_init(struct sc_gamepad_aoa *gamepad, struct sc_aoa *aoa,
+                    uint16_t report_rate);
 
 void
 sc_gamepad_aoa_destroy(struct sc_gamepad_aoa *gamepad);
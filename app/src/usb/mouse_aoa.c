@@ -10,6 +10,17 @@
 /** Downcast mouse processor to mouse_aoa */
 #define DOWNCAST(MP) container_of(MP, struct sc_mouse_aoa, mouse_processor)
 
+static void
+sc_mouse_aoa_on_input(struct sc_hid_coalescer *coalescer,
+                      const struct sc_hid_input *hid_input, void *userdata) {
+    (void) coalescer;
+    struct sc_mouse_aoa *mouse = userdata;
+
+    if (!sc_aoa_push_input(mouse->aoa, hid_input)) {
+        LOGW("Could not push AOA HID input (mouse)");
+    }
+}
+
 static void
 sc_mouse_processor_process_mouse_motion(struct sc_mouse_processor *mp,
                                     const struct sc_mouse_motion_event *event) {
@@ -18,9 +29,7 @@ sc_mouse_processor_process_mouse_motion(struct sc_mouse_processor *mp,
     struct sc_hid_input hid_input;
     sc_hid_mouse_generate_input_from_motion(&hid_input, event);
 
-    if (!sc_aoa_push_input(mouse->aoa, &hid_input)) {
-        LOGW("Could not push AOA HID input (mouse motion)");
-    }
+    sc_hid_coalescer_push(&mouse->coalescer, &hid_input);
 }
 
 static void
@@ -31,9 +40,7 @@ sc_mouse_processor_process_mouse_click(struct sc_mouse_processor *mp,
     struct sc_hid_input hid_input;
     sc_hid_mouse_generate_input_from_click(&hid_input, event);
 
-    if (!sc_aoa_push_input(mouse->aoa, &hid_input)) {
-        LOGW("Could not push AOA HID input (mouse click)");
-    }
+    sc_hid_coalescer_push(&mouse->coalescer, &hid_input);
 }
 
 static void
@@ -47,22 +54,36 @@ sc_mouse_processor_process_mouse_scroll(struct sc_mouse_processor *mp,
         return;
     }
 
-    if (!sc_aoa_push_input(mouse->aoa, &hid_input)) {
-        LOGW("Could not push AOA HID input (mouse scroll)");
-    }
+    sc_hid_coalescer_push(&mouse->coalescer, &hid_input);
 }
 
 bool
-sc_mouse_aoa_init(struct sc_mouse_aoa *mouse, struct sc_aoa *aoa) {
+sc_mouse_aoa_init(struct sc_mouse_aoa *mouse, struct sc_aoa *aoa,
+                  uint16_t report_rate) {
     mouse->aoa = aoa;
 
+    static const struct sc_hid_coalescer_callbacks cbs = {
+        .on_input = sc_mouse_aoa_on_input,
+    };
+
+    bool ok = sc_hid_coalescer_init(&mouse->coalescer, report_rate, &cbs,
+                                    mouse);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_hid_coalescer_start(&mouse->coalescer);
+    if (!ok) {
+        goto error_destroy_coalescer;
+    }
+
     struct sc_hid_open hid_open;
     sc_hid_mouse_generate_open(&hid_open);
 
-    bool ok = sc_aoa_push_open(aoa, &hid_open, true);
+    ok = sc_aoa_push_open(aoa, &hid_open, true);
     if (!ok) {
         LOGW("Could not push AOA HID open (mouse)");
-        return false;
+        goto error_stop_coalescer;
     }
 
     sc_hid_mouse_init(&mouse->hid);
@@ -80,10 +101,20 @@ sc_mouse_aoa_init(struct sc_mouse_aoa *mouse, struct sc_aoa *aoa) {
     mouse->mouse_processor.relative_mode = true;
 
     return true;
+
+error_stop_coalescer:
+    sc_hid_coalescer_stop(&mouse->coalescer);
+    sc_hid_coalescer_join(&mouse->coalescer);
+error_destroy_coalescer:
+    sc_hid_coalescer_destroy(&mouse->coalescer);
+
+    return false;
 }
 
 void
 sc_mouse_aoa_destroy(struct sc_mouse_aoa *mouse) {
-    (void) mouse;
-    // Do nothing, mouse->aoa will automatically unregister all devices
+    sc_hid_coalescer_stop(&mouse->coalescer);
+    sc_hid_coalescer_join(&mouse->coalescer);
+    sc_hid_coalescer_destroy(&mouse->coalescer);
+    // mouse->aoa will automatically unregister all devices
 }
@@ -4,8 +4,10 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "usb/aoa_hid.h"
+#include "hid/hid_coalescer.h"
 #include "hid/hid_mouse.h"
 #include "trait/mouse_processor.h"
 
@@ -13,11 +15,14 @@ struct sc_mouse_aoa {
     struct sc_mouse_processor mouse_processor; // mouse processor trait
 
     struct sc_hid_mouse hid;
+    struct sc_hid_coalescer coalescer;
     struct sc_aoa *aoa;
 };
 
+// report_rate: maximum number of motion reports per second (0 = unlimited)
 bool
-sc_mouse_aoa_init(struct sc_mouse_aoa *mouse, struct sc_aoa *aoa);
+sc_mouse_aoa_init(struct sc_mouse_aoa *mouse, struct sc_aoa *aoa,
+                  uint16_t report_rate);
 
 void
 sc_mouse_aoa_destroy(struct sc_mouse_aoa *mouse);
@@ -15,6 +15,7 @@
 #include "usb/keyboard_aoa.h"
 #include "usb/mouse_aoa.h"
 #include "util/log.h"
+#include "util/thread.h"
 
 struct scrcpy_otg {
     struct sc_usb usb;
@@ -92,6 +93,9 @@ scrcpy_otg(struct scrcpy_options *options) {
 
     atexit(SDL_Quit);
 
+    // The main thread handles the events (see scrcpy())
+    sc_thread_apply_role(SC_THREAD_ROLE_RENDER);
+
     if (!SDL_SetHint(SDL_HINT_MOUSE_FOCUS_CLICKTHROUGH, "1")) {
         LOGW("Could not enable mouse focus clickthrough");
     }
@@ -173,7 +177,8 @@ scrcpy_otg(struct scrcpy_options *options) {
     }
 
     if (enable_mouse) {
-        ok = sc_mouse_aoa_init(&s->mouse, &s->aoa);
+        ok = sc_mouse_aoa_init(&s->mouse, &s->aoa,
+                               options->hid_report_rate);
         if (!ok) {
             goto end;
         }
@@ -181,7 +186,11 @@ scrcpy_otg(struct scrcpy_options *options) {
     }
 
     if (enable_gamepad) {
-        sc_gamepad_aoa_init(&s->gamepad, &s->aoa);
+        ok = sc_gamepad_aoa_init(&s->gamepad, &s->aoa,
+                                 options->hid_report_rate);
+        if (!ok) {
+            goto end;
+        }
         gp = &s->gamepad.gamepad_processor;
     }
 
@@ -4,8 +4,12 @@
 #include "common.h"
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 
+// Maximum size of a varint-encoded 64-bit value
+#define SC_VARINT_MAX_SIZE 10
+
 static inline void
 sc_write16be(uint8_t *buf, uint16_t value) {
     buf[0] = value >> 8;
@@ -56,6 +60,11 @@ sc_read32be(const uint8_t *buf) {
     return ((uint32_t) buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
 }
 
+static inline uint32_t
+sc_read32le(const uint8_t *buf) {
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
+
 static inline uint64_t
 sc_read64be(const uint8_t *buf) {
     uint32_t msb = sc_read32be(buf);
@@ -63,6 +72,55 @@ sc_read64be(const uint8_t *buf) {
     return ((uint64_t) msb << 32) | lsb;
 }
 
+/**
+ * Write an unsigned LEB128 variable-length integer (7 bits per byte, least
+ * significant group first)
+ *
+ * Return the number of bytes written (at most SC_VARINT_MAX_SIZE).
+ */
+static inline size_t
+sc_write_varint(uint8_t *buf, uint64_t value) {
+    size_t i = 0;
+    while (value >= 0x80) {
+        buf[i++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    buf[i++] = value;
+    return i;
+}
+
+/**
+ * Read an unsigned LEB128 variable-length integer from at most len bytes
+ *
+ * Return the number of bytes read, or 0 if the input is truncated or invalid.
+ */
+static inline size_t
+sc_read_varint(const uint8_t *buf, size_t len, uint64_t *value) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < len && i < SC_VARINT_MAX_SIZE; ++i) {
+        result |= (uint64_t) (buf[i] & 0x7f) << (7 * i);
+        if (!(buf[i] & 0x80)) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Map a signed value to an unsigned value, so that values with a small
+ * absolute value have a short varint representation
+ */
+static inline uint64_t
+sc_zigzag_encode(int64_t value) {
+    return ((uint64_t) value << 1) ^ (value < 0 ? UINT64_MAX : 0);
+}
+
+static inline int64_t
+sc_zigzag_decode(uint64_t value) {
+    return (int64_t) ((value >> 1) ^ (value & 1 ? UINT64_MAX : 0));
+}
+
 /**
  * Convert a float between 0 and 1 to an unsigned 16-bit fixed-point value
  */
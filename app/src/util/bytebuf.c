@@ -0,0 +1,66 @@
+#include "bytebuf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/log.h"
+
+bool
+sc_bytebuf_init(struct sc_bytebuf *buf, size_t capacity) {
+    assert(capacity);
+
+    buf->alloc_size = capacity + 1;
+    buf->data = malloc(buf->alloc_size);
+    if (!buf->data) {
+        LOG_OOM();
+        return false;
+    }
+
+    buf->head = 0;
+    buf->tail = 0;
+
+    return true;
+}
+
+void
+sc_bytebuf_destroy(struct sc_bytebuf *buf) {
+    free(buf->data);
+}
+
+uint8_t *
+sc_bytebuf_prepare_write(struct sc_bytebuf *buf, size_t *len) {
+    size_t can_write = sc_bytebuf_can_write(buf);
+    size_t right_len = buf->alloc_size - buf->head;
+    *len = MIN(can_write, right_len);
+    return &buf->data[buf->head];
+}
+
+void
+sc_bytebuf_commit_write(struct sc_bytebuf *buf, size_t len) {
+    assert(len <= sc_bytebuf_can_write(buf));
+    buf->head = (buf->head + len) % buf->alloc_size;
+}
+
+void
+sc_bytebuf_read_parts(struct sc_bytebuf *buf, const uint8_t **part1,
+                      size_t *len1, const uint8_t **part2, size_t *len2) {
+    size_t can_read = sc_bytebuf_can_read(buf);
+    size_t right_len = buf->alloc_size - buf->tail;
+
+    *part1 = &buf->data[buf->tail];
+    if (can_read <= right_len) {
+        *len1 = can_read;
+        *part2 = NULL;
+        *len2 = 0;
+    } else {
+        *len1 = right_len;
+        *part2 = buf->data;
+        *len2 = can_read - right_len;
+    }
+}
+
+void
+sc_bytebuf_skip(struct sc_bytebuf *buf, size_t len) {
+    assert(len <= sc_bytebuf_can_read(buf));
+    buf->tail = (buf->tail + len) % buf->alloc_size;
+}
@@ -0,0 +1,83 @@
+#ifndef SC_BYTEBUF_H
+#define SC_BYTEBUF_H
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Ring buffer of bytes
+ *
+ * Data is written directly into the buffer (typically by recv()) and read in
+ * place, without ever shifting the content. The readable content may be split
+ * in two parts when it wraps around the end of the array.
+ *
+ * It is not thread-safe: the writer and the reader must be the same thread.
+ */
+struct sc_bytebuf {
+    uint8_t *data;
+    // The actual capacity is (alloc_size - 1) so that head == tail is
+    // non-ambiguous
+    size_t alloc_size;
+    size_t head; // writer cursor
+    size_t tail; // reader cursor
+    // empty: tail == head
+    // full: ((tail + 1) % alloc_size) == head
+};
+
+bool
+sc_bytebuf_init(struct sc_bytebuf *buf, size_t capacity);
+
+void
+sc_bytebuf_destroy(struct sc_bytebuf *buf);
+
+/**
+ * Return a pointer to the contiguous writable area, and store its size in
+ * `len`
+ *
+ * The size may be smaller than sc_bytebuf_can_write() if the free space wraps
+ * around the end of the array.
+ *
+ * The written bytes must then be committed by sc_bytebuf_commit_write().
+ */
+uint8_t *
+sc_bytebuf_prepare_write(struct sc_bytebuf *buf, size_t *len);
+
+void
+sc_bytebuf_commit_write(struct sc_bytebuf *buf, size_t len);
+
+/**
+ * Get the readable content, possibly split in two parts
+ *
+ * The second part is empty if the content does not wrap.
+ */
+void
+sc_bytebuf_read_parts(struct sc_bytebuf *buf, const uint8_t **part1,
+                      size_t *len1, const uint8_t **part2, size_t *len2);
+
+/**
+ * Drop `len` bytes (they must be available)
+ */
+void
+sc_bytebuf_skip(struct sc_bytebuf *buf, size_t len);
+
+static inline size_t
+sc_bytebuf_capacity(struct sc_bytebuf *buf) {
+    assert(buf->alloc_size);
+    return buf->alloc_size - 1;
+}
+
+static inline size_t
+sc_bytebuf_can_read(struct sc_bytebuf *buf) {
+    return (buf->alloc_size + buf->head - buf->tail) % buf->alloc_size;
+}
+
+static inline size_t
+sc_bytebuf_can_write(struct sc_bytebuf *buf) {
+    return (buf->alloc_size + buf->tail - buf->head - 1) % buf->alloc_size;
+}
+
+#endif
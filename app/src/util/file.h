@@ -4,6 +4,8 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #ifdef _WIN32
 # define SC_PATH_SEPARATOR '\\'
@@ -55,4 +57,31 @@ sc_file_build_path(const char *dir, const char *filename);
 bool
 sc_file_is_regular(const char *path);
 
+/**
+ * Get the size of a regular file, in bytes
+ *
+ * Return false (without logging any error) if the file is not a regular file.
+ */
+bool
+sc_file_get_size(const char *path, uint64_t *size);
+
+/**
+ * Open a file (like fopen(), but the path is always UTF-8, even on Windows)
+ */
+FILE *
+sc_file_open(const char *path, const char *mode);
+
+/**
+ * Return the path of the scrcpy directory in the user cache directory
+ *
+ * It is $XDG_CACHE_HOME/scrcpy (or ~/.cache/scrcpy if $XDG_CACHE_HOME is not
+ * set), or %LOCALAPPDATA%\scrcpy on Windows. It is created if it does not
+ * exist.
+ *
+ * The result must be freed by the caller using free(). It may return NULL on
+ * error.
+ */
+char *
+sc_file_get_cache_dir(void);
+
 #endif
@@ -0,0 +1,699 @@
+#include "frame_ops.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <SDL3/SDL_cpuinfo.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+# define SC_FRAME_OPS_X86
+# include <immintrin.h>
+// Compile the kernels for the instruction set, independently of the global
+// compiler flags (they are only called if the CPU supports it)
+# define SC_TARGET_SSE2 __attribute__((target("sse2")))
+# define SC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#ifdef __ARM_NEON
+# define SC_FRAME_OPS_NEON
+# include <arm_neon.h>
+#endif
+
+// Size of the blocks transposed at once
+#define SC_TRANSPOSE_BLOCK 16
+
+struct sc_frame_ops_impl {
+    enum sc_simd simd;
+
+    // dst[i] = src[n - 1 - i]
+    void (*reverse_row)(uint8_t *dst, const uint8_t *src, size_t n);
+    // dst[j][i] = src[i][j], for a block of 16x16 pixels
+    void (*transpose_block)(uint8_t *dst, ptrdiff_t dst_stride,
+                            const uint8_t *src, ptrdiff_t src_stride);
+    // dst[i] = average of src0[2i], src0[2i+1], src1[2i] and src1[2i+1]
+    void (*downscale_row)(uint8_t *dst, const uint8_t *src0,
+                          const uint8_t *src1, size_t n);
+    // dst[2i] = u[i], dst[2i+1] = v[i]
+    void (*interleave_row)(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                           size_t n);
+    // u[i] = src[2i], v[i] = src[2i+1]
+    void (*deinterleave_row)(uint8_t *u, uint8_t *v, const uint8_t *src,
+                             size_t n);
+};
+
+static void
+reverse_row_c(uint8_t *dst, const uint8_t *src, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = src[n - 1 - i];
+    }
+}
+
+static void
+transpose_c(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src,
+            ptrdiff_t src_stride, unsigned width, unsigned height) {
+    for (unsigned i = 0; i < height; ++i) {
+        const uint8_t *row = src + (ptrdiff_t) i * src_stride;
+        for (unsigned j = 0; j < width; ++j) {
+            dst[(ptrdiff_t) j * dst_stride + i] = row[j];
+        }
+    }
+}
+
+static void
+transpose_block_c(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src,
+                  ptrdiff_t src_stride) {
+    transpose_c(dst, dst_stride, src, src_stride, SC_TRANSPOSE_BLOCK,
+                SC_TRANSPOSE_BLOCK);
+}
+
+static void
+downscale_row_c(uint8_t *dst, const uint8_t *src0, const uint8_t *src1,
+                size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        unsigned sum = src0[2 * i] + src0[2 * i + 1]
+                     + src1[2 * i] + src1[2 * i + 1];
+        dst[i] = (sum + 2) >> 2;
+    }
+}
+
+static void
+interleave_row_c(uint8_t *dst, const uint8_t *u, const uint8_t *v, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[2 * i] = u[i];
+        dst[2 * i + 1] = v[i];
+    }
+}
+
+static void
+deinterleave_row_c(uint8_t *u, uint8_t *v, const uint8_t *src, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        u[i] = src[2 * i];
+        v[i] = src[2 * i + 1];
+    }
+}
+
+static const struct sc_frame_ops_impl impl_c = {
+    .simd = SC_SIMD_NONE,
+    .reverse_row = reverse_row_c,
+    .transpose_block = transpose_block_c,
+    .downscale_row = downscale_row_c,
+    .interleave_row = interleave_row_c,
+    .deinterleave_row = deinterleave_row_c,
+};
+
+#ifdef SC_FRAME_OPS_X86
+
+SC_TARGET_SSE2 static inline __m128i
+reverse_16_sse2(__m128i x) {
+    // swap the bytes of each 16-bit word, then reverse the words
+    x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+    x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+    x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+    return _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+SC_TARGET_SSE2 static void
+reverse_row_sse2(uint8_t *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (src + n - i - 16));
+        _mm_storeu_si128((__m128i *) (dst + i), reverse_16_sse2(x));
+    }
+    reverse_row_c(dst + i, src, n - i);
+}
+
+SC_TARGET_SSE2 static void
+transpose_block_sse2(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src,
+                     ptrdiff_t src_stride) {
+    __m128i a[16];
+    __m128i b[16];
+
+    for (int i = 0; i < 16; ++i) {
+        a[i] = _mm_loadu_si128((const __m128i *) (src + i * src_stride));
+    }
+
+    // Consider the 8-bit index (row << 4 | column) of each byte: interleaving
+    // the rows i and i + 8 rotates this index by 1 bit to the left. After 4
+    // passes, the rows and the columns are swapped.
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < 8; ++i) {
+            b[2 * i] = _mm_unpacklo_epi8(a[i], a[i + 8]);
+            b[2 * i + 1] = _mm_unpackhi_epi8(a[i], a[i + 8]);
+        }
+        for (int i = 0; i < 8; ++i) {
+            a[2 * i] = _mm_unpacklo_epi8(b[i], b[i + 8]);
+            a[2 * i + 1] = _mm_unpackhi_epi8(b[i], b[i + 8]);
+        }
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        _mm_storeu_si128((__m128i *) (dst + i * dst_stride), a[i]);
+    }
+}
+
+SC_TARGET_SSE2 static inline __m128i
+sum_pairs_sse2(__m128i x) {
+    // 16-bit sums of each pair of adjacent bytes
+    __m128i mask = _mm_set1_epi16(0x00FF);
+    return _mm_add_epi16(_mm_and_si128(x, mask), _mm_srli_epi16(x, 8));
+}
+
+SC_TARGET_SSE2 static void
+downscale_row_sse2(uint8_t *dst, const uint8_t *src0, const uint8_t *src1,
+                   size_t n) {
+    __m128i two = _mm_set1_epi16(2);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i *p0 = (const __m128i *) (src0 + 2 * i);
+        const __m128i *p1 = (const __m128i *) (src1 + 2 * i);
+        __m128i s0 = _mm_add_epi16(sum_pairs_sse2(_mm_loadu_si128(p0)),
+                                   sum_pairs_sse2(_mm_loadu_si128(p1)));
+        __m128i s1 = _mm_add_epi16(sum_pairs_sse2(_mm_loadu_si128(p0 + 1)),
+                                   sum_pairs_sse2(_mm_loadu_si128(p1 + 1)));
+        s0 = _mm_srli_epi16(_mm_add_epi16(s0, two), 2);
+        s1 = _mm_srli_epi16(_mm_add_epi16(s1, two), 2);
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(s0, s1));
+    }
+    downscale_row_c(dst + i, src0 + 2 * i, src1 + 2 * i, n - i);
+}
+
+SC_TARGET_SSE2 static void
+interleave_row_sse2(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                    size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (u + i));
+        __m128i y = _mm_loadu_si128((const __m128i *) (v + i));
+        __m128i *out = (__m128i *) (dst + 2 * i);
+        _mm_storeu_si128(out, _mm_unpacklo_epi8(x, y));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(x, y));
+    }
+    interleave_row_c(dst + 2 * i, u + i, v + i, n - i);
+}
+
+SC_TARGET_SSE2 static void
+deinterleave_row_sse2(uint8_t *u, uint8_t *v, const uint8_t *src, size_t n) {
+    __m128i mask = _mm_set1_epi16(0x00FF);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i *in = (const __m128i *) (src + 2 * i);
+        __m128i x = _mm_loadu_si128(in);
+        __m128i y = _mm_loadu_si128(in + 1);
+        __m128i ru = _mm_packus_epi16(_mm_and_si128(x, mask),
+                                      _mm_and_si128(y, mask));
+        __m128i rv = _mm_packus_epi16(_mm_srli_epi16(x, 8),
+                                      _mm_srli_epi16(y, 8));
+        _mm_storeu_si128((__m128i *) (u + i), ru);
+        _mm_storeu_si128((__m128i *) (v + i), rv);
+    }
+    deinterleave_row_c(u + i, v + i, src + 2 * i, n - i);
+}
+
+static const struct sc_frame_ops_impl impl_sse2 = {
+    .simd = SC_SIMD_SSE2,
+    .reverse_row = reverse_row_sse2,
+    .transpose_block = transpose_block_sse2,
+    .downscale_row = downscale_row_sse2,
+    .interleave_row = interleave_row_sse2,
+    .deinterleave_row = deinterleave_row_sse2,
+};
+
+SC_TARGET_AVX2 static void
+reverse_row_avx2(uint8_t *dst, const uint8_t *src, size_t n) {
+    // reverse the bytes of each 128-bit lane, then swap the lanes
+    __m256i mask = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                    7, 6, 5, 4, 3, 2, 1, 0,
+                                    15, 14, 13, 12, 11, 10, 9, 8,
+                                    7, 6, 5, 4, 3, 2, 1, 0);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (src + n - i - 32));
+        x = _mm256_shuffle_epi8(x, mask);
+        x = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 3, 2));
+        _mm256_storeu_si256((__m256i *) (dst + i), x);
+    }
+    reverse_row_c(dst + i, src, n - i);
+}
+
+SC_TARGET_AVX2 static inline __m256i
+sum_pairs_avx2(__m256i x) {
+    __m256i mask = _mm256_set1_epi16(0x00FF);
+    return _mm256_add_epi16(_mm256_and_si256(x, mask),
+                            _mm256_srli_epi16(x, 8));
+}
+
+SC_TARGET_AVX2 static void
+downscale_row_avx2(uint8_t *dst, const uint8_t *src0, const uint8_t *src1,
+                   size_t n) {
+    __m256i two = _mm256_set1_epi16(2);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i *p0 = (const __m256i *) (src0 + 2 * i);
+        const __m256i *p1 = (const __m256i *) (src1 + 2 * i);
+        __m256i s0 = _mm256_add_epi16(sum_pairs_avx2(_mm256_loadu_si256(p0)),
+                                      sum_pairs_avx2(_mm256_loadu_si256(p1)));
+        __m256i s1 =
+            _mm256_add_epi16(sum_pairs_avx2(_mm256_loadu_si256(p0 + 1)),
+                             sum_pairs_avx2(_mm256_loadu_si256(p1 + 1)));
+        s0 = _mm256_srli_epi16(_mm256_add_epi16(s0, two), 2);
+        s1 = _mm256_srli_epi16(_mm256_add_epi16(s1, two), 2);
+        // packus works within each 128-bit lane: reorder the 64-bit chunks
+        __m256i r = _mm256_packus_epi16(s0, s1);
+        r = _mm256_permute4x64_epi64(r, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *) (dst + i), r);
+    }
+    downscale_row_c(dst + i, src0 + 2 * i, src1 + 2 * i, n - i);
+}
+
+SC_TARGET_AVX2 static void
+interleave_row_avx2(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                    size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (u + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (v + i));
+        // unpack works within each 128-bit lane: reorder the lanes
+        __m256i lo = _mm256_unpacklo_epi8(x, y);
+        __m256i hi = _mm256_unpackhi_epi8(x, y);
+        __m256i *out = (__m256i *) (dst + 2 * i);
+        _mm256_storeu_si256(out, _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    interleave_row_c(dst + 2 * i, u + i, v + i, n - i);
+}
+
+SC_TARGET_AVX2 static void
+deinterleave_row_avx2(uint8_t *u, uint8_t *v, const uint8_t *src, size_t n) {
+    __m256i mask = _mm256_set1_epi16(0x00FF);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i *in = (const __m256i *) (src + 2 * i);
+        __m256i x = _mm256_loadu_si256(in);
+        __m256i y = _mm256_loadu_si256(in + 1);
+        __m256i ru = _mm256_packus_epi16(_mm256_and_si256(x, mask),
+                                         _mm256_and_si256(y, mask));
+        __m256i rv = _mm256_packus_epi16(_mm256_srli_epi16(x, 8),
+                                         _mm256_srli_epi16(y, 8));
+        ru = _mm256_permute4x64_epi64(ru, _MM_SHUFFLE(3, 1, 2, 0));
+        rv = _mm256_permute4x64_epi64(rv, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *) (u + i), ru);
+        _mm256_storeu_si256((__m256i *) (v + i), rv);
+    }
+    deinterleave_row_c(u + i, v + i, src + 2 * i, n - i);
+}
+
+static const struct sc_frame_ops_impl impl_avx2 = {
+    .simd = SC_SIMD_AVX2,
+    .reverse_row = reverse_row_avx2,
+    // The 16x16 transposition would not benefit from 256-bit registers
+    .transpose_block = transpose_block_sse2,
+    .downscale_row = downscale_row_avx2,
+    .interleave_row = interleave_row_avx2,
+    .deinterleave_row = deinterleave_row_avx2,
+};
+
+#endif // SC_FRAME_OPS_X86
+
+#ifdef SC_FRAME_OPS_NEON
+
+static void
+reverse_row_neon(uint8_t *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t x = vrev64q_u8(vld1q_u8(src + n - i - 16));
+        vst1q_u8(dst + i, vcombine_u8(vget_high_u8(x), vget_low_u8(x)));
+    }
+    reverse_row_c(dst + i, src, n - i);
+}
+
+static void
+transpose_block_neon(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src,
+                     ptrdiff_t src_stride) {
+    uint8x16_t a[16];
+    uint8x16_t b[16];
+
+    for (int i = 0; i < 16; ++i) {
+        a[i] = vld1q_u8(src + i * src_stride);
+    }
+
+    // Same algorithm as transpose_block_sse2()
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < 8; ++i) {
+            uint8x16x2_t z = vzipq_u8(a[i], a[i + 8]);
+            b[2 * i] = z.val[0];
+            b[2 * i + 1] = z.val[1];
+        }
+        for (int i = 0; i < 8; ++i) {
+            uint8x16x2_t z = vzipq_u8(b[i], b[i + 8]);
+            a[2 * i] = z.val[0];
+            a[2 * i + 1] = z.val[1];
+        }
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        vst1q_u8(dst + i * dst_stride, a[i]);
+    }
+}
+
+static void
+downscale_row_neon(uint8_t *dst, const uint8_t *src0, const uint8_t *src1,
+                   size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8_t *p0 = src0 + 2 * i;
+        const uint8_t *p1 = src1 + 2 * i;
+        uint16x8_t s0 = vpadalq_u8(vpaddlq_u8(vld1q_u8(p0)), vld1q_u8(p1));
+        uint16x8_t s1 = vpadalq_u8(vpaddlq_u8(vld1q_u8(p0 + 16)),
+                                   vld1q_u8(p1 + 16));
+        // rounding shift: (sum + 2) >> 2
+        vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(s0, 2),
+                                      vrshrn_n_u16(s1, 2)));
+    }
+    downscale_row_c(dst + i, src0 + 2 * i, src1 + 2 * i, n - i);
+}
+
+static void
+interleave_row_neon(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                    size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x2_t uv;
+        uv.val[0] = vld1q_u8(u + i);
+        uv.val[1] = vld1q_u8(v + i);
+        vst2q_u8(dst + 2 * i, uv);
+    }
+    interleave_row_c(dst + 2 * i, u + i, v + i, n - i);
+}
+
+static void
+deinterleave_row_neon(uint8_t *u, uint8_t *v, const uint8_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x2_t uv = vld2q_u8(src + 2 * i);
+        vst1q_u8(u + i, uv.val[0]);
+        vst1q_u8(v + i, uv.val[1]);
+    }
+    deinterleave_row_c(u + i, v + i, src + 2 * i, n - i);
+}
+
+static const struct sc_frame_ops_impl impl_neon = {
+    .simd = SC_SIMD_NEON,
+    .reverse_row = reverse_row_neon,
+    .transpose_block = transpose_block_neon,
+    .downscale_row = downscale_row_neon,
+    .interleave_row = interleave_row_neon,
+    .deinterleave_row = deinterleave_row_neon,
+};
+
+#endif // SC_FRAME_OPS_NEON
+
+static _Atomic(const struct sc_frame_ops_impl *) sc_frame_ops_current;
+
+static const struct sc_frame_ops_impl *
+get_impl_for(enum sc_simd simd) {
+    switch (simd) {
+        case SC_SIMD_NONE:
+            return &impl_c;
+#ifdef SC_FRAME_OPS_X86
+        case SC_SIMD_SSE2:
+            return SDL_HasSSE2() ? &impl_sse2 : NULL;
+        case SC_SIMD_AVX2:
+            return SDL_HasAVX2() ? &impl_avx2 : NULL;
+#endif
+#ifdef SC_FRAME_OPS_NEON
+        case SC_SIMD_NEON:
+            return SDL_HasNEON() ? &impl_neon : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+static const struct sc_frame_ops_impl *
+get_impl(void) {
+    const struct sc_frame_ops_impl *impl =
+        atomic_load_explicit(&sc_frame_ops_current, memory_order_acquire);
+    if (impl) {
+        return impl;
+    }
+
+    // Select the best implementation supported (several threads may do it
+    // concurrently, they all select the same one)
+    static const enum sc_simd candidates[] = {
+        SC_SIMD_AVX2,
+        SC_SIMD_SSE2,
+        SC_SIMD_NEON,
+    };
+    for (size_t i = 0; i < ARRAY_LEN(candidates); ++i) {
+        impl = get_impl_for(candidates[i]);
+        if (impl) {
+            break;
+        }
+    }
+
+    if (!impl) {
+        impl = &impl_c;
+    }
+
+    atomic_store_explicit(&sc_frame_ops_current, impl, memory_order_release);
+    return impl;
+}
+
+enum sc_simd
+sc_frame_ops_get_simd(void) {
+    return get_impl()->simd;
+}
+
+bool
+sc_frame_ops_set_simd(enum sc_simd simd) {
+    const struct sc_frame_ops_impl *impl = get_impl_for(simd);
+    if (!impl) {
+        return false;
+    }
+
+    atomic_store_explicit(&sc_frame_ops_current, impl, memory_order_release);
+    return true;
+}
+
+const char *
+sc_simd_get_name(enum sc_simd simd) {
+    switch (simd) {
+        case SC_SIMD_NONE:
+            return "scalar";
+        case SC_SIMD_SSE2:
+            return "sse2";
+        case SC_SIMD_AVX2:
+            return "avx2";
+        case SC_SIMD_NEON:
+            return "neon";
+        default:
+            return "unknown";
+    }
+}
+
+static void
+transpose(const struct sc_frame_ops_impl *impl, uint8_t *dst,
+          ptrdiff_t dst_stride, const uint8_t *src, ptrdiff_t src_stride,
+          unsigned width, unsigned height) {
+    // Transpose (width x height) pixels of src to (height x width) pixels of
+    // dst, by blocks
+    const unsigned block = SC_TRANSPOSE_BLOCK;
+    unsigned block_width = width - width % block;
+    unsigned block_height = height - height % block;
+
+    for (unsigned y = 0; y < block_height; y += block) {
+        const uint8_t *src_row = src + (ptrdiff_t) y * src_stride;
+        for (unsigned x = 0; x < block_width; x += block) {
+            uint8_t *dst_block = dst + (ptrdiff_t) x * dst_stride + y;
+            impl->transpose_block(dst_block, dst_stride, src_row + x,
+                                  src_stride);
+        }
+    }
+
+    // Right columns
+    transpose_c(dst + (ptrdiff_t) block_width * dst_stride, dst_stride,
+                src + block_width, src_stride, width - block_width, height);
+    // Bottom rows (except the right columns, already transposed)
+    transpose_c(dst + block_height, dst_stride,
+                src + (ptrdiff_t) block_height * src_stride, src_stride,
+                block_width, height - block_height);
+}
+
+void
+sc_plane_transform(uint8_t *dst, int dst_linesize, const uint8_t *src,
+                   int src_linesize, unsigned width, unsigned height,
+                   enum sc_orientation orientation) {
+    const struct sc_frame_ops_impl *impl = get_impl();
+
+    // The orientation is applied as a horizontal flip (if mirror) followed by
+    // a clockwise rotation
+    unsigned rotation = sc_orientation_get_rotation(orientation);
+    bool mirror = sc_orientation_is_mirror(orientation);
+
+    ptrdiff_t src_stride = src_linesize;
+    ptrdiff_t dst_stride = dst_linesize;
+
+    if (!sc_orientation_is_swap(orientation)) {
+        // 0 and 180 degrees: dst[y][x] = src[y or h-1-y][x or w-1-x]
+        bool vflip = rotation == 2;
+        bool hflip = vflip != mirror;
+        if (vflip) {
+            src += (ptrdiff_t) (height - 1) * src_stride;
+            src_stride = -src_stride;
+        }
+        for (unsigned y = 0; y < height; ++y) {
+            uint8_t *dst_row = dst + (ptrdiff_t) y * dst_stride;
+            const uint8_t *src_row = src + (ptrdiff_t) y * src_stride;
+            if (hflip) {
+                impl->reverse_row(dst_row, src_row, width);
+            } else {
+                memcpy(dst_row, src_row, width);
+            }
+        }
+        return;
+    }
+
+    // 90 and 270 degrees: dst[y][x] = src[x or h-1-x][y or w-1-y]
+    //
+    // Reversing the order of the source rows or of the destination rows (via
+    // negative strides) reduces all the cases to a transposition.
+    bool reverse_src_rows = rotation == 1;
+    bool reverse_dst_rows = (rotation == 3) != mirror;
+    if (reverse_src_rows) {
+        src += (ptrdiff_t) (height - 1) * src_stride;
+        src_stride = -src_stride;
+    }
+    if (reverse_dst_rows) {
+        // the destination has width rows
+        dst += (ptrdiff_t) (width - 1) * dst_stride;
+        dst_stride = -dst_stride;
+    }
+    transpose(impl, dst, dst_stride, src, src_stride, width, height);
+}
+
+void
+sc_plane_downscale_2x(uint8_t *dst, int dst_linesize, const uint8_t *src,
+                      int src_linesize, unsigned width, unsigned height) {
+    const struct sc_frame_ops_impl *impl = get_impl();
+
+    unsigned dst_height = (height + 1) / 2;
+    unsigned pairs = width / 2;
+
+    for (unsigned y = 0; y < dst_height; ++y) {
+        uint8_t *dst_row = dst + (ptrdiff_t) y * dst_linesize;
+        const uint8_t *src0 = src + (ptrdiff_t) 2 * y * src_linesize;
+        // Repeat the last row if the height is odd
+        const uint8_t *src1 = 2 * y + 1 < height ? src0 + src_linesize : src0;
+
+        impl->downscale_row(dst_row, src0, src1, pairs);
+        if (width & 1) {
+            // Repeat the last column
+            dst_row[pairs] = (src0[width - 1] + src1[width - 1] + 1) >> 1;
+        }
+    }
+}
+
+void
+sc_plane_interleave(uint8_t *dst, int dst_linesize, const uint8_t *src_u,
+                    int src_u_linesize, const uint8_t *src_v,
+                    int src_v_linesize, unsigned width, unsigned height) {
+    const struct sc_frame_ops_impl *impl = get_impl();
+
+    for (unsigned y = 0; y < height; ++y) {
+        impl->interleave_row(dst + (ptrdiff_t) y * dst_linesize,
+                             src_u + (ptrdiff_t) y * src_u_linesize,
+                             src_v + (ptrdiff_t) y * src_v_linesize, width);
+    }
+}
+
+void
+sc_plane_deinterleave(uint8_t *dst_u, int dst_u_linesize, uint8_t *dst_v,
+                      int dst_v_linesize, const uint8_t *src,
+                      int src_linesize, unsigned width, unsigned height) {
+    const struct sc_frame_ops_impl *impl = get_impl();
+
+    for (unsigned y = 0; y < height; ++y) {
+        impl->deinterleave_row(dst_u + (ptrdiff_t) y * dst_u_linesize,
+                               dst_v + (ptrdiff_t) y * dst_v_linesize,
+                               src + (ptrdiff_t) y * src_linesize, width);
+    }
+}
+
+static inline unsigned
+chroma_size(unsigned size) {
+    return (size + 1) / 2;
+}
+
+void
+sc_yuv420p_crop(struct sc_yuv420p *dst, const struct sc_yuv420p *src,
+                unsigned x, unsigned y, unsigned width, unsigned height) {
+    assert(!(x & 1) && !(y & 1));
+    assert(x + width <= src->width);
+    assert(y + height <= src->height);
+
+    dst->data[0] = src->data[0] + (ptrdiff_t) y * src->linesize[0] + x;
+    for (int i = 1; i < 3; ++i) {
+        dst->data[i] = src->data[i] + (ptrdiff_t) (y / 2) * src->linesize[i]
+                     + x / 2;
+    }
+    memcpy(dst->linesize, src->linesize, sizeof(dst->linesize));
+    dst->width = width;
+    dst->height = height;
+}
+
+void
+sc_yuv420p_transform(const struct sc_yuv420p *dst,
+                     const struct sc_yuv420p *src,
+                     enum sc_orientation orientation) {
+    bool swap = sc_orientation_is_swap(orientation);
+    assert(dst->width == (swap ? src->height : src->width));
+    assert(dst->height == (swap ? src->width : src->height));
+    (void) swap;
+
+    sc_plane_transform(dst->data[0], dst->linesize[0], src->data[0],
+                       src->linesize[0], src->width, src->height,
+                       orientation);
+    for (int i = 1; i < 3; ++i) {
+        sc_plane_transform(dst->data[i], dst->linesize[i], src->data[i],
+                           src->linesize[i], chroma_size(src->width),
+                           chroma_size(src->height), orientation);
+    }
+}
+
+void
+sc_yuv420p_downscale_2x(const struct sc_yuv420p *dst,
+                        const struct sc_yuv420p *src) {
+    assert(dst->width == (src->width + 1) / 2);
+    assert(dst->height == (src->height + 1) / 2);
+
+    sc_plane_downscale_2x(dst->data[0], dst->linesize[0], src->data[0],
+                          src->linesize[0], src->width, src->height);
+    for (int i = 1; i < 3; ++i) {
+        // The destination chroma size is chroma_size((size + 1) / 2), which
+        // is equal to (chroma_size(size) + 1) / 2
+        sc_plane_downscale_2x(dst->data[i], dst->linesize[i], src->data[i],
+                              src->linesize[i], chroma_size(src->width),
+                              chroma_size(src->height));
+    }
+}
+
+void
+sc_yuv420p_to_nv12(uint8_t *dst_y, int dst_y_linesize, uint8_t *dst_uv,
+                   int dst_uv_linesize, const struct sc_yuv420p *src) {
+    sc_plane_transform(dst_y, dst_y_linesize, src->data[0], src->linesize[0],
+                       src->width, src->height, SC_ORIENTATION_0);
+    sc_plane_interleave(dst_uv, dst_uv_linesize, src->data[1],
+                        src->linesize[1], src->data[2], src->linesize[2],
+                        chroma_size(src->width), chroma_size(src->height));
+}
+
+void
+sc_yuv420p_from_nv12(const struct sc_yuv420p *dst, const uint8_t *src_y,
+                     int src_y_linesize, const uint8_t *src_uv,
+                     int src_uv_linesize) {
+    sc_plane_transform(dst->data[0], dst->linesize[0], src_y, src_y_linesize,
+                       dst->width, dst->height, SC_ORIENTATION_0);
+    sc_plane_deinterleave(dst->data[1], dst->linesize[1], dst->data[2],
+                          dst->linesize[2], src_uv, src_uv_linesize,
+                          chroma_size(dst->width), chroma_size(dst->height));
+}
@@ -0,0 +1,143 @@
+#ifndef SC_FRAME_OPS_H
+#define SC_FRAME_OPS_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "options.h"
+
+/**
+ * CPU operations on YUV 4:2:0 frames (crop, rotate/flip, downscale, convert)
+ *
+ * The kernels are vectorized for SSE2, AVX2 or NEON, selected at runtime
+ * according to the CPU features, with a scalar fallback. All the
+ * implementations produce exactly the same output.
+ */
+
+enum sc_simd {
+    SC_SIMD_NONE, // scalar
+    SC_SIMD_SSE2,
+    SC_SIMD_AVX2,
+    SC_SIMD_NEON,
+};
+
+/**
+ * View on a YUV 4:2:0 planar image (the pixels are not owned)
+ *
+ * The chroma planes have a size of ((width + 1) / 2, (height + 1) / 2).
+ */
+struct sc_yuv420p {
+    uint8_t *data[3];
+    int linesize[3];
+    unsigned width;
+    unsigned height;
+};
+
+/**
+ * Return the implementation currently used
+ *
+ * By default, it is the best one supported by the CPU.
+ */
+enum sc_simd
+sc_frame_ops_get_simd(void);
+
+/**
+ * Force the implementation to use (typically for tests and benchmarks)
+ *
+ * Return false if it is not supported by the CPU (or by the build).
+ */
+bool
+sc_frame_ops_set_simd(enum sc_simd simd);
+
+const char *
+sc_simd_get_name(enum sc_simd simd);
+
+/**
+ * Transform a plane of (width x height) pixels according to the orientation
+ *
+ * If the orientation swaps the dimensions, the destination plane has a size of
+ * (height x width). The source and the destination must not overlap.
+ */
+void
+sc_plane_transform(uint8_t *dst, int dst_linesize, const uint8_t *src,
+                   int src_linesize, unsigned width, unsigned height,
+                   enum sc_orientation orientation);
+
+/**
+ * Downscale a plane of (width x height) pixels by 2 in both directions
+ *
+ * Each destination pixel is the (rounded) average of a 2x2 block of source
+ * pixels. The destination plane has a size of ((width + 1) / 2,
+ * (height + 1) / 2): if a dimension is odd, the last source column or row is
+ * repeated.
+ */
+void
+sc_plane_downscale_2x(uint8_t *dst, int dst_linesize, const uint8_t *src,
+                      int src_linesize, unsigned width, unsigned height);
+
+/**
+ * Interleave two planes of (width x height) pixels into a plane of
+ * (2 * width x height) pixels (u0 v0 u1 v1...)
+ */
+void
+sc_plane_interleave(uint8_t *dst, int dst_linesize, const uint8_t *src_u,
+                    int src_u_linesize, const uint8_t *src_v,
+                    int src_v_linesize, unsigned width, unsigned height);
+
+/**
+ * Deinterleave a plane of (2 * width x height) pixels into two planes of
+ * (width x height) pixels
+ */
+void
+sc_plane_deinterleave(uint8_t *dst_u, int dst_u_linesize, uint8_t *dst_v,
+                      int dst_v_linesize, const uint8_t *src,
+                      int src_linesize, unsigned width, unsigned height);
+
+/**
+ * Initialize a view on the area (x, y, width, height) of the source image
+ *
+ * The position must be even (chroma is subsampled). No pixels are copied.
+ */
+void
+sc_yuv420p_crop(struct sc_yuv420p *dst, const struct sc_yuv420p *src,
+                unsigned x, unsigned y, unsigned width, unsigned height);
+
+/**
+ * Transform the image according to the orientation
+ *
+ * The destination size must be the source size, swapped if the orientation
+ * swaps the dimensions.
+ */
+void
+sc_yuv420p_transform(const struct sc_yuv420p *dst,
+                     const struct sc_yuv420p *src,
+                     enum sc_orientation orientation);
+
+/**
+ * Downscale the image by 2 in both directions
+ *
+ * The destination size must be ((width + 1) / 2, (height + 1) / 2).
+ */
+void
+sc_yuv420p_downscale_2x(const struct sc_yuv420p *dst,
+                        const struct sc_yuv420p *src);
+
+/**
+ * Convert the image to NV12 (a luma plane and an interleaved chroma plane)
+ */
+void
+sc_yuv420p_to_nv12(uint8_t *dst_y, int dst_y_linesize, uint8_t *dst_uv,
+                   int dst_uv_linesize, const struct sc_yuv420p *src);
+
+/**
+ * Convert a NV12 image of the destination size to YUV 4:2:0 planar
+ */
+void
+sc_yuv420p_from_nv12(const struct sc_yuv420p *dst, const uint8_t *src_y,
+                     int src_y_linesize, const uint8_t *src_uv,
+                     int src_uv_linesize);
+
+#endif
@@ -0,0 +1,101 @@
+#include "histogram.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+
+void
+sc_histogram_init(struct sc_histogram *histogram) {
+    memset(histogram->buckets, 0, sizeof(histogram->buckets));
+    histogram->count = 0;
+    histogram->sum = 0;
+    histogram->max = 0;
+}
+
+static unsigned
+get_bucket_index(sc_tick value) {
+    unsigned i = 0;
+    sc_tick bound = SC_HISTOGRAM_BASE;
+    while (i < SC_HISTOGRAM_BUCKETS - 1 && value >= bound) {
+        bound <<= 1;
+        ++i;
+    }
+    return i;
+}
+
+void
+sc_histogram_add(struct sc_histogram *histogram, sc_tick value) {
+    if (value < 0) {
+        // The clock is monotonic, but protect against invalid input
+        value = 0;
+    }
+
+    ++histogram->buckets[get_bucket_index(value)];
+    ++histogram->count;
+    histogram->sum += value;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+sc_tick
+sc_histogram_percentile(const struct sc_histogram *histogram,
+                        unsigned percentile) {
+    assert(percentile <= 100);
+
+    if (!histogram->count) {
+        return 0;
+    }
+
+    // Number of values lower than or equal to the percentile (at least 1)
+    uint64_t target = (histogram->count * percentile + 99) / 100;
+    if (!target) {
+        target = 1;
+    }
+
+    uint64_t acc = 0;
+    sc_tick bound = SC_HISTOGRAM_BASE;
+    for (unsigned i = 0; i < SC_HISTOGRAM_BUCKETS - 1; ++i) {
+        acc += histogram->buckets[i];
+        if (acc >= target) {
+            return MIN(bound, histogram->max);
+        }
+        bound <<= 1;
+    }
+
+    return histogram->max;
+}
+
+void
+sc_histogram_log(const struct sc_histogram *histogram, enum sc_log_level level,
+                 const char *name) {
+    if (!histogram->count) {
+        LOG(level, "%s: no values", name);
+        return;
+    }
+
+    sc_tick avg = histogram->sum / (sc_tick) histogram->count;
+    LOG(level, "%s: count=%" PRIu64 " avg=%" PRItick "us p50<=%" PRItick
+               "us p99<=%" PRItick "us max=%" PRItick "us",
+        name, histogram->count, SC_TICK_TO_US(avg),
+        SC_TICK_TO_US(sc_histogram_percentile(histogram, 50)),
+        SC_TICK_TO_US(sc_histogram_percentile(histogram, 99)),
+        SC_TICK_TO_US(histogram->max));
+
+    sc_tick low = 0;
+    sc_tick high = SC_HISTOGRAM_BASE;
+    for (unsigned i = 0; i < SC_HISTOGRAM_BUCKETS; ++i) {
+        uint64_t n = histogram->buckets[i];
+        if (n) {
+            if (i < SC_HISTOGRAM_BUCKETS - 1) {
+                LOG(level, "    [%" PRItick "us, %" PRItick "us): %" PRIu64,
+                    SC_TICK_TO_US(low), SC_TICK_TO_US(high), n);
+            } else {
+                LOG(level, "    [%" PRItick "us, +inf): %" PRIu64,
+                    SC_TICK_TO_US(low), n);
+            }
+        }
+        low = high;
+        high <<= 1;
+    }
+}
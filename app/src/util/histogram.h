@@ -0,0 +1,55 @@
+#ifndef SC_HISTOGRAM_H
+#define SC_HISTOGRAM_H
+
+#include "common.h"
+
+#include <stdint.h>
+
+#include "util/log.h"
+#include "util/tick.h"
+
+#define SC_HISTOGRAM_BUCKETS 16
+
+// Upper bound (exclusive) of the first bucket
+#define SC_HISTOGRAM_BASE SC_TICK_FROM_US(125)
+
+/**
+ * Histogram of durations with exponential buckets
+ *
+ * The bucket i (for i < SC_HISTOGRAM_BUCKETS - 1) contains the values lower
+ * than (SC_HISTOGRAM_BASE << i) and greater than or equal to the upper bound
+ * of bucket (i - 1). The last bucket contains all the remaining values.
+ *
+ * It is not thread-safe.
+ */
+struct sc_histogram {
+    uint64_t buckets[SC_HISTOGRAM_BUCKETS];
+    uint64_t count;
+    sc_tick sum;
+    sc_tick max;
+};
+
+void
+sc_histogram_init(struct sc_histogram *histogram);
+
+void
+sc_histogram_add(struct sc_histogram *histogram, sc_tick value);
+
+/**
+ * Return an upper bound of the given percentile (in [0, 100])
+ *
+ * The result is the upper bound of the bucket containing the percentile (or
+ * the max value if it is lower). It returns 0 if the histogram is empty.
+ */
+sc_tick
+sc_histogram_percentile(const struct sc_histogram *histogram,
+                        unsigned percentile);
+
+/**
+ * Log the histogram content (one line per non-empty bucket)
+ */
+void
+sc_histogram_log(const struct sc_histogram *histogram, enum sc_log_level level,
+                 const char *name);
+
+#endif
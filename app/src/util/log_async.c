@@ -0,0 +1,181 @@
+#include "log_async.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL3/SDL_log.h>
+
+#include "util/log.h"
+#include "util/mpsc_worker.h"
+#include "util/tick.h"
+
+#define SC_LOG_ASYNC_CAPACITY 512 // must be a power of 2
+
+// Longer messages are allocated separately
+#define SC_LOG_ASYNC_INLINE_SIZE 232
+
+// Enough for "[<seconds>.<micros>] "
+#define SC_LOG_ASYNC_DATE_MAX_LEN 32
+
+struct sc_log_record {
+    sc_tick date;
+    SDL_LogPriority priority;
+    int category;
+    char *long_message; // NULL if the message is stored inline
+    char message[SC_LOG_ASYNC_INLINE_SIZE];
+};
+
+struct sc_log_async {
+    struct sc_mpsc_worker worker;
+    atomic_uint dropped;
+
+    // The log output function replaced by the asynchronous one
+    SDL_LogOutputFunction output;
+    void *output_userdata;
+
+    sc_tick start_date;
+};
+
+static struct sc_log_async sc_log_async;
+
+static void
+sc_log_async_write(struct sc_log_async *la,
+                   const struct sc_log_record *record) {
+    const char *message = record->long_message ? record->long_message
+                                               : record->message;
+
+    // The messages are written later, so prefix them with the date they were
+    // logged at (in seconds since the logs became asynchronous)
+    sc_tick date = record->date - la->start_date;
+    char prefix[SC_LOG_ASYNC_DATE_MAX_LEN];
+    int r = snprintf(prefix, sizeof(prefix), "[%" PRItick ".%06" PRItick "] ",
+                     date / SC_TICK_FREQ, date % SC_TICK_FREQ);
+    assert(r > 0 && (size_t) r < sizeof(prefix));
+
+    size_t prefix_len = r;
+    size_t len = strlen(message);
+
+    char buf[SC_LOG_ASYNC_DATE_MAX_LEN + SC_LOG_ASYNC_INLINE_SIZE];
+    char *line = buf;
+    if (prefix_len + len + 1 > sizeof(buf)) {
+        line = malloc(prefix_len + len + 1);
+        if (!line) {
+            // Write the message without its date
+            la->output(la->output_userdata, record->category,
+                       record->priority, message);
+            return;
+        }
+    }
+
+    memcpy(line, prefix, prefix_len);
+    memcpy(line + prefix_len, message, len + 1); // include '\0'
+
+    la->output(la->output_userdata, record->category, record->priority, line);
+
+    if (line != buf) {
+        free(line);
+    }
+}
+
+static void
+sc_log_async_process(void *item, void *userdata) {
+    struct sc_log_async *la = userdata;
+    struct sc_log_record *record = item;
+
+    sc_log_async_write(la, record);
+    free(record->long_message);
+}
+
+static void
+sc_log_async_report_dropped(void *userdata) {
+    struct sc_log_async *la = userdata;
+
+    unsigned dropped = atomic_exchange_explicit(&la->dropped, 0,
+                                                memory_order_relaxed);
+    if (dropped) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "%u log messages dropped", dropped);
+        la->output(la->output_userdata, SDL_LOG_CATEGORY_APPLICATION,
+                   SDL_LOG_PRIORITY_WARN, msg);
+    }
+}
+
+static void SDLCALL
+sc_log_async_output(void *userdata, int category, SDL_LogPriority priority,
+                    const char *message) {
+    struct sc_log_async *la = userdata;
+
+    struct sc_log_record record;
+    record.date = sc_tick_now();
+    record.priority = priority;
+    record.category = category;
+
+    size_t len = strlen(message);
+    if (len < SC_LOG_ASYNC_INLINE_SIZE) {
+        memcpy(record.message, message, len + 1); // include '\0'
+        record.long_message = NULL;
+    } else {
+        record.long_message = strdup(message);
+        if (!record.long_message) {
+            // Do not lose the message
+            la->output(la->output_userdata, category, priority, message);
+            return;
+        }
+    }
+
+    if (!sc_mpsc_worker_push(&la->worker, &record)) {
+        free(record.long_message);
+        if (priority >= SDL_LOG_PRIORITY_WARN) {
+            // Never lose a warning or an error, even if it is out of order
+            la->output(la->output_userdata, category, priority, message);
+        } else {
+            atomic_fetch_add_explicit(&la->dropped, 1, memory_order_relaxed);
+        }
+    }
+}
+
+bool
+sc_log_async_start(void) {
+    struct sc_log_async *la = &sc_log_async;
+
+    static const struct sc_mpsc_worker_ops ops = {
+        .process = sc_log_async_process,
+        .on_drained = sc_log_async_report_dropped,
+    };
+
+    bool ok = sc_mpsc_worker_init(&la->worker, SC_LOG_ASYNC_CAPACITY,
+                                  sizeof(struct sc_log_record), &ops, la);
+    if (!ok) {
+        return false;
+    }
+
+    atomic_init(&la->dropped, 0);
+    la->start_date = sc_tick_now();
+    SDL_GetLogOutputFunction(&la->output, &la->output_userdata);
+    assert(la->output);
+
+    ok = sc_mpsc_worker_start(&la->worker, "scrcpy-log", false);
+    if (!ok) {
+        sc_mpsc_worker_destroy(&la->worker);
+        return false;
+    }
+
+    SDL_SetLogOutputFunction(sc_log_async_output, la);
+
+    return true;
+}
+
+void
+sc_log_async_stop(void) {
+    struct sc_log_async *la = &sc_log_async;
+
+    // The next logs are written synchronously
+    SDL_SetLogOutputFunction(la->output, la->output_userdata);
+
+    sc_mpsc_worker_stop(&la->worker);
+    sc_mpsc_worker_join(&la->worker);
+    sc_mpsc_worker_destroy(&la->worker);
+}
@@ -0,0 +1,36 @@
+#ifndef SC_LOG_ASYNC_H
+#define SC_LOG_ASYNC_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+/**
+ * Asynchronous log output
+ *
+ * Once started, the log messages are stored (with their date) into a
+ * lock-free queue, and written by a background thread. The calling threads
+ * only format the message: they never wait for the terminal or for another
+ * thread holding the output.
+ *
+ * If the queue is full, the verbose, debug and info messages are dropped (and
+ * counted), while the warnings and errors are written synchronously.
+ */
+
+/**
+ * Start writing the logs from a background thread
+ *
+ * On error, the logs remain synchronous.
+ */
+bool
+sc_log_async_start(void);
+
+/**
+ * Write the pending logs and restore the synchronous log output
+ *
+ * It must be called once the other threads have been joined.
+ */
+void
+sc_log_async_stop(void);
+
+#endif
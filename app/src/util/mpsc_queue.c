@@ -0,0 +1,130 @@
+#include "mpsc_queue.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/log.h"
+#include "util/memory.h"
+
+bool
+sc_mpsc_queue_init(struct sc_mpsc_queue *queue, size_t capacity,
+                   size_t item_size) {
+    // The position of a cell is computed by masking
+    assert(capacity && !(capacity & (capacity - 1)));
+    assert(item_size);
+
+    queue->seqs = sc_allocarray(capacity, sizeof(*queue->seqs));
+    if (!queue->seqs) {
+        LOG_OOM();
+        return false;
+    }
+
+    queue->items = sc_allocarray(capacity, item_size);
+    if (!queue->items) {
+        LOG_OOM();
+        free(queue->seqs);
+        return false;
+    }
+
+    // Initially, the cell i may be written by the producer at position i
+    for (size_t i = 0; i < capacity; ++i) {
+        atomic_init(&queue->seqs[i], i);
+    }
+
+    queue->capacity = capacity;
+    queue->item_size = item_size;
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->head, 0);
+
+    return true;
+}
+
+void
+sc_mpsc_queue_destroy(struct sc_mpsc_queue *queue) {
+    free(queue->items);
+    free(queue->seqs);
+}
+
+static inline uint8_t *
+sc_mpsc_queue_item(struct sc_mpsc_queue *queue, size_t pos) {
+    return &queue->items[(pos & (queue->capacity - 1)) * queue->item_size];
+}
+
+bool
+sc_mpsc_queue_push(struct sc_mpsc_queue *queue, const void *item) {
+    size_t mask = queue->capacity - 1;
+    size_t pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    for (;;) {
+        atomic_size_t *seq = &queue->seqs[pos & mask];
+        size_t s = atomic_load_explicit(seq, memory_order_acquire);
+        intptr_t diff = (intptr_t) s - (intptr_t) pos;
+        if (!diff) {
+            // The cell is free, try to own the position
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &pos,
+                                                      pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+            // Another producer owns it, pos has been reloaded
+        } else if (diff < 0) {
+            // The cell has not been read yet since the previous round
+            return false;
+        } else {
+            // Another producer has taken this position
+            pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+
+    memcpy(sc_mpsc_queue_item(queue, pos), item, queue->item_size);
+
+    // Publish the item to the consumer
+    atomic_store_explicit(&queue->seqs[pos & mask], pos + 1,
+                          memory_order_release);
+    return true;
+}
+
+void *
+sc_mpsc_queue_peek(struct sc_mpsc_queue *queue) {
+    // Only the consumer writes head
+    size_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    atomic_size_t *seq = &queue->seqs[pos & (queue->capacity - 1)];
+    size_t s = atomic_load_explicit(seq, memory_order_acquire);
+    if (s != pos + 1) {
+        // Empty (or the producer owning the position has not finished)
+        return NULL;
+    }
+
+    return sc_mpsc_queue_item(queue, pos);
+}
+
+bool
+sc_mpsc_queue_pop(struct sc_mpsc_queue *queue, void *item) {
+    void *src = sc_mpsc_queue_peek(queue);
+    if (!src) {
+        return false;
+    }
+
+    memcpy(item, src, queue->item_size);
+
+    size_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    // Give the cell back to the producers, for the next round
+    atomic_store_explicit(&queue->seqs[pos & (queue->capacity - 1)],
+                          pos + queue->capacity, memory_order_release);
+    atomic_store_explicit(&queue->head, pos + 1, memory_order_relaxed);
+    return true;
+}
+
+size_t
+sc_mpsc_queue_size(struct sc_mpsc_queue *queue) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    // The cursors are read separately, the difference may be transiently out
+    // of bounds
+    if (tail <= head) {
+        return 0;
+    }
+    return MIN(tail - head, queue->capacity);
+}
@@ -0,0 +1,83 @@
+#ifndef SC_MPSC_QUEUE_H
+#define SC_MPSC_QUEUE_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bounded multi-producer single-consumer lock-free queue
+ *
+ * Items of item_size bytes are copied into (and out of) a ring of capacity
+ * cells. Each cell has a sequence number telling whether it may be written by
+ * the producer owning the position, or read by the consumer (Vyukov's bounded
+ * queue), so that producers never block each other nor the consumer.
+ *
+ * Any thread may push, but only one thread (the consumer) may pop or peek.
+ *
+ * The queue does not block: use a sc_notifier to wait for items.
+ */
+struct sc_mpsc_queue {
+    size_t capacity; // power of 2
+    size_t item_size;
+    atomic_size_t *seqs;
+    uint8_t *items;
+
+    // Next position to write, shared by the producers
+    atomic_size_t tail;
+    // Avoid false sharing between the producers and the consumer cursors
+    uint8_t padding[64];
+    // Next position to read, only written by the consumer
+    atomic_size_t head;
+};
+
+bool
+sc_mpsc_queue_init(struct sc_mpsc_queue *queue, size_t capacity,
+                   size_t item_size);
+
+void
+sc_mpsc_queue_destroy(struct sc_mpsc_queue *queue);
+
+/**
+ * Copy an item into the queue
+ *
+ * Return false if the queue is full.
+ */
+bool
+sc_mpsc_queue_push(struct sc_mpsc_queue *queue, const void *item);
+
+/**
+ * Copy the first item out of the queue, and remove it (consumer only)
+ *
+ * Return false if the queue is empty.
+ */
+bool
+sc_mpsc_queue_pop(struct sc_mpsc_queue *queue, void *item);
+
+/**
+ * Return a pointer to the first item, or NULL if the queue is empty (consumer
+ * only)
+ *
+ * The pointer remains valid until the item is popped.
+ */
+void *
+sc_mpsc_queue_peek(struct sc_mpsc_queue *queue);
+
+static inline bool
+sc_mpsc_queue_is_empty(struct sc_mpsc_queue *queue) {
+    return !sc_mpsc_queue_peek(queue);
+}
+
+/**
+ * Return the number of items in the queue
+ *
+ * It may be called from any thread, but the value is only approximate if
+ * other threads push or pop concurrently.
+ */
+size_t
+sc_mpsc_queue_size(struct sc_mpsc_queue *queue);
+
+#endif
@@ -0,0 +1,132 @@
+#include "mpsc_worker.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "util/log.h"
+
+bool
+sc_mpsc_worker_init(struct sc_mpsc_worker *worker, size_t capacity,
+                    size_t item_size, const struct sc_mpsc_worker_ops *ops,
+                    void *userdata) {
+    assert(ops && ops->process);
+
+    worker->item = malloc(item_size);
+    if (!worker->item) {
+        LOG_OOM();
+        return false;
+    }
+
+    bool ok = sc_mpsc_queue_init(&worker->queue, capacity, item_size);
+    if (!ok) {
+        goto error_free_item;
+    }
+
+    ok = sc_notifier_init(&worker->notifier);
+    if (!ok) {
+        goto error_destroy_queue;
+    }
+
+    atomic_init(&worker->stopped, false);
+    worker->background = false;
+    worker->ops = ops;
+    worker->userdata = userdata;
+
+    return true;
+
+error_destroy_queue:
+    sc_mpsc_queue_destroy(&worker->queue);
+error_free_item:
+    free(worker->item);
+
+    return false;
+}
+
+void
+sc_mpsc_worker_destroy(struct sc_mpsc_worker *worker) {
+    assert(sc_mpsc_queue_is_empty(&worker->queue));
+
+    sc_notifier_destroy(&worker->notifier);
+    sc_mpsc_queue_destroy(&worker->queue);
+    free(worker->item);
+}
+
+static bool
+sc_mpsc_worker_is_stopped(struct sc_mpsc_worker *worker) {
+    // Pairs with the release store in sc_mpsc_worker_stop(): the items pushed
+    // before the stop are visible
+    return atomic_load_explicit(&worker->stopped, memory_order_acquire);
+}
+
+static int
+run_mpsc_worker(void *data) {
+    struct sc_mpsc_worker *worker = data;
+
+    if (worker->background) {
+        sc_thread_apply_role(SC_THREAD_ROLE_BACKGROUND);
+    }
+
+    for (;;) {
+        // Read the flag before draining the queue, so that the items pushed
+        // before the stop are processed before exiting
+        bool stopped = sc_mpsc_worker_is_stopped(worker);
+
+        while (sc_mpsc_queue_pop(&worker->queue, worker->item)) {
+            worker->ops->process(worker->item, worker->userdata);
+        }
+
+        if (worker->ops->on_drained) {
+            worker->ops->on_drained(worker->userdata);
+        }
+
+        if (stopped) {
+            break;
+        }
+
+        sc_notifier_prepare_wait(&worker->notifier);
+        if (sc_mpsc_worker_is_stopped(worker)
+                || !sc_mpsc_queue_is_empty(&worker->queue)) {
+            sc_notifier_cancel_wait(&worker->notifier);
+        } else {
+            sc_notifier_wait(&worker->notifier);
+        }
+    }
+
+    return 0;
+}
+
+bool
+sc_mpsc_worker_start(struct sc_mpsc_worker *worker, const char *name,
+                     bool background) {
+    worker->background = background;
+
+    bool ok = sc_thread_create(&worker->thread, run_mpsc_worker, name,
+                               worker);
+    if (!ok) {
+        LOGE("Could not start thread %s", name);
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_mpsc_worker_stop(struct sc_mpsc_worker *worker) {
+    atomic_store_explicit(&worker->stopped, true, memory_order_release);
+    sc_notifier_notify(&worker->notifier);
+}
+
+void
+sc_mpsc_worker_join(struct sc_mpsc_worker *worker) {
+    sc_thread_join(&worker->thread, NULL);
+}
+
+bool
+sc_mpsc_worker_push(struct sc_mpsc_worker *worker, const void *item) {
+    if (!sc_mpsc_queue_push(&worker->queue, item)) {
+        return false;
+    }
+
+    sc_notifier_notify(&worker->notifier);
+    return true;
+}
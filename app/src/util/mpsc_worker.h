@@ -0,0 +1,79 @@
+#ifndef SC_MPSC_WORKER_H
+#define SC_MPSC_WORKER_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "util/mpsc_queue.h"
+#include "util/notifier.h"
+#include "util/thread.h"
+
+/**
+ * Background thread consuming the items pushed into a lock-free queue
+ *
+ * Any thread may push items without blocking (they are rejected if the queue
+ * is full). The worker thread processes them in order, and waits for a
+ * notification once the queue is empty.
+ *
+ * On stop, the items pushed before are processed before the thread exits.
+ */
+struct sc_mpsc_worker_ops {
+    // Called on the worker thread for each item, in order
+    void (*process)(void *item, void *userdata);
+    // Called on the worker thread each time the queue has been drained (may
+    // be NULL)
+    void (*on_drained)(void *userdata);
+};
+
+struct sc_mpsc_worker {
+    struct sc_mpsc_queue queue;
+    struct sc_notifier notifier;
+    atomic_bool stopped;
+    sc_thread thread;
+    bool background; // apply SC_THREAD_ROLE_BACKGROUND to the thread
+
+    void *item; // storage for the item being processed
+
+    const struct sc_mpsc_worker_ops *ops;
+    void *userdata;
+};
+
+bool
+sc_mpsc_worker_init(struct sc_mpsc_worker *worker, size_t capacity,
+                    size_t item_size, const struct sc_mpsc_worker_ops *ops,
+                    void *userdata);
+
+void
+sc_mpsc_worker_destroy(struct sc_mpsc_worker *worker);
+
+/**
+ * Start the worker thread
+ *
+ * If background is true, the thread must not disturb the others (see
+ * SC_THREAD_ROLE_BACKGROUND).
+ */
+bool
+sc_mpsc_worker_start(struct sc_mpsc_worker *worker, const char *name,
+                     bool background);
+
+/**
+ * Request the worker thread to exit once the pending items are processed
+ */
+void
+sc_mpsc_worker_stop(struct sc_mpsc_worker *worker);
+
+void
+sc_mpsc_worker_join(struct sc_mpsc_worker *worker);
+
+/**
+ * Copy an item into the queue and wake up the worker thread
+ *
+ * Return false if the queue is full (the item is not pushed).
+ */
+bool
+sc_mpsc_worker_push(struct sc_mpsc_worker *worker, const void *item);
+
+#endif
@@ -268,6 +268,22 @@ net_close(sc_socket socket) {
 #endif
 }
 
+static bool
+net_setsockopt_int(sc_socket socket, int level, int optname, int value,
+                   const char *name) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    int ret = setsockopt(raw_sock, level, optname, (const void *) &value,
+                         sizeof(value));
+    if (ret == -1) {
+        net_perror(name);
+        return false;
+    }
+
+    assert(ret == 0);
+    return true;
+}
+
 bool
 net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay) {
     sc_raw_socket raw_sock = unwrap(socket);
@@ -284,6 +300,76 @@ net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay) {
     return true;
 }
 
+bool
+net_set_recv_buffer_size(sc_socket socket, int size) {
+    assert(size > 0);
+    return net_setsockopt_int(socket, SOL_SOCKET, SO_RCVBUF, size,
+                              "setsockopt(SO_RCVBUF)");
+}
+
+bool
+net_set_send_buffer_size(sc_socket socket, int size) {
+    assert(size > 0);
+    return net_setsockopt_int(socket, SOL_SOCKET, SO_SNDBUF, size,
+                              "setsockopt(SO_SNDBUF)");
+}
+
+bool
+net_get_recv_buffer_size(sc_socket socket, int *size) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    int value;
+    socklen_t len = sizeof(value);
+    int ret = getsockopt(raw_sock, SOL_SOCKET, SO_RCVBUF, (void *) &value,
+                         &len);
+    if (ret == -1) {
+        net_perror("getsockopt(SO_RCVBUF)");
+        return false;
+    }
+
+    *size = value;
+    return true;
+}
+
+bool
+net_set_recv_lowat(sc_socket socket, int lowat) {
+    assert(lowat > 0);
+#ifndef _WIN32
+    return net_setsockopt_int(socket, SOL_SOCKET, SO_RCVLOWAT, lowat,
+                              "setsockopt(SO_RCVLOWAT)");
+#else
+    (void) socket;
+    LOGW("SO_RCVLOWAT is not supported on this platform");
+    return false;
+#endif
+}
+
+bool
+net_set_busy_poll(sc_socket socket, int usec) {
+    assert(usec >= 0);
+#ifdef SO_BUSY_POLL
+    return net_setsockopt_int(socket, SOL_SOCKET, SO_BUSY_POLL, usec,
+                              "setsockopt(SO_BUSY_POLL)");
+#else
+    (void) socket;
+    LOGW("SO_BUSY_POLL is not supported on this platform");
+    return false;
+#endif
+}
+
+bool
+net_set_tcp_quickack(sc_socket socket, bool quickack) {
+#ifdef TCP_QUICKACK
+    return net_setsockopt_int(socket, IPPROTO_TCP, TCP_QUICKACK,
+                              quickack ? 1 : 0, "setsockopt(TCP_QUICKACK)");
+#else
+    (void) socket;
+    (void) quickack;
+    LOGW("TCP_QUICKACK is not supported on this platform");
+    return false;
+#endif
+}
+
 bool
 net_parse_ipv4(const char *s, uint32_t *ipv4) {
     struct in_addr addr;
@@ -87,6 +87,35 @@ net_close(sc_socket socket);
 bool
 net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay);
 
+// Set the size of the kernel receive buffer (SO_RCVBUF)
+// On Linux, this disables the automatic tuning of the buffer size.
+bool
+net_set_recv_buffer_size(sc_socket socket, int size);
+
+// Set the size of the kernel send buffer (SO_SNDBUF)
+bool
+net_set_send_buffer_size(sc_socket socket, int size);
+
+// Get the actual size of the kernel receive buffer (the kernel may adjust the
+// requested size)
+bool
+net_get_recv_buffer_size(sc_socket socket, int *size);
+
+// Set the minimum number of bytes to be available for recv() to return
+// (SO_RCVLOWAT, not supported on Windows)
+bool
+net_set_recv_lowat(sc_socket socket, int lowat);
+
+// Busy poll the network device queue for up to usec microseconds on blocking
+// receive, instead of waiting for an interrupt (SO_BUSY_POLL, Linux only)
+bool
+net_set_busy_poll(sc_socket socket, int usec);
+
+// Send ACKs immediately rather than delayed (TCP_QUICKACK, Linux only)
+// The flag is not permanent: the kernel may switch back to delayed ACKs.
+bool
+net_set_tcp_quickack(sc_socket socket, bool quickack);
+
 /**
  * Parse `ip` "xxx.xxx.xxx.xxx" to an IPv4 host representation
  */
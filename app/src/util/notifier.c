@@ -0,0 +1,63 @@
+#include "notifier.h"
+
+bool
+sc_notifier_init(struct sc_notifier *notifier) {
+    bool ok = sc_mutex_init(&notifier->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&notifier->cond);
+    if (!ok) {
+        sc_mutex_destroy(&notifier->mutex);
+        return false;
+    }
+
+    atomic_init(&notifier->waiting, false);
+
+    return true;
+}
+
+void
+sc_notifier_destroy(struct sc_notifier *notifier) {
+    sc_cond_destroy(&notifier->cond);
+    sc_mutex_destroy(&notifier->mutex);
+}
+
+void
+sc_notifier_prepare_wait(struct sc_notifier *notifier) {
+    atomic_store_explicit(&notifier->waiting, true, memory_order_relaxed);
+    // Pairs with the fence in sc_notifier_notify(): either the consumer sees
+    // the new condition, or the producer sees the consumer waiting
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void
+sc_notifier_cancel_wait(struct sc_notifier *notifier) {
+    atomic_store_explicit(&notifier->waiting, false, memory_order_relaxed);
+}
+
+void
+sc_notifier_wait(struct sc_notifier *notifier) {
+    sc_mutex_lock(&notifier->mutex);
+    // The flag is reset under the lock by the producer, so the signal cannot
+    // be missed
+    while (atomic_load_explicit(&notifier->waiting, memory_order_relaxed)) {
+        sc_cond_wait(&notifier->cond, &notifier->mutex);
+    }
+    sc_mutex_unlock(&notifier->mutex);
+}
+
+void
+sc_notifier_notify(struct sc_notifier *notifier) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&notifier->waiting, memory_order_relaxed)) {
+        // Fast path: the consumer is busy, it will see the new condition
+        return;
+    }
+
+    sc_mutex_lock(&notifier->mutex);
+    atomic_store_explicit(&notifier->waiting, false, memory_order_relaxed);
+    sc_cond_signal(&notifier->cond);
+    sc_mutex_unlock(&notifier->mutex);
+}
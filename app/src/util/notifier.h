@@ -0,0 +1,63 @@
+#ifndef SC_NOTIFIER_H
+#define SC_NOTIFIER_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "util/thread.h"
+
+/**
+ * Wake up a single consumer waiting for a condition changed by lock-free
+ * producers
+ *
+ * The producers only take the lock when the consumer is actually waiting, so
+ * that notifying a busy consumer costs a fence and an atomic load.
+ *
+ * The consumer must follow this pattern:
+ *
+ *     sc_notifier_prepare_wait(&notifier);
+ *     if (condition) {
+ *         sc_notifier_cancel_wait(&notifier);
+ *     } else {
+ *         sc_notifier_wait(&notifier);
+ *     }
+ *
+ * and the producers must call sc_notifier_notify() after changing the
+ * condition.
+ */
+struct sc_notifier {
+    atomic_bool waiting;
+    sc_mutex mutex;
+    sc_cond cond;
+};
+
+bool
+sc_notifier_init(struct sc_notifier *notifier);
+
+void
+sc_notifier_destroy(struct sc_notifier *notifier);
+
+/**
+ * Announce that the consumer is about to wait
+ *
+ * The condition must be checked again after this call, to not miss a
+ * notification.
+ */
+void
+sc_notifier_prepare_wait(struct sc_notifier *notifier);
+
+void
+sc_notifier_cancel_wait(struct sc_notifier *notifier);
+
+/**
+ * Block until the next notification (since sc_notifier_prepare_wait())
+ */
+void
+sc_notifier_wait(struct sc_notifier *notifier);
+
+void
+sc_notifier_notify(struct sc_notifier *notifier);
+
+#endif
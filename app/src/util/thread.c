@@ -5,11 +5,61 @@
 #include <stdlib.h>
 #include <string.h>
 #include <SDL3/SDL_mutex.h>
+#ifdef __linux__
+# include <errno.h>
+# include <pthread.h>
+# include <sched.h>
+#elif defined(_WIN32)
+# include <windows.h>
+#endif
 
 #include "util/log.h"
 
+// SCHED_FIFO priority of the media threads (1 to 99 on Linux): above the
+// normal threads, but below the system real-time threads (e.g. IRQ handlers)
+#define SC_THREAD_REALTIME_PRIORITY 10
+
 sc_thread_id SC_MAIN_THREAD_ID;
 
+// Written once before any thread is started, then only read
+static struct sc_thread_policy sc_thread_policy = {
+    .sched = SC_THREAD_SCHED_NORMAL,
+    .cpu_affinity = 0,
+};
+
+// Initial CPU affinity of the process, restored on the threads which must not
+// be pinned (a new thread inherits the CPU affinity of its creator)
+#ifdef __linux__
+static cpu_set_t sc_thread_process_cpus;
+#elif defined(_WIN32)
+static DWORD_PTR sc_thread_process_cpus;
+#endif
+
+// Whether the current thread is pinned to the CPUs of the policy
+static _Thread_local bool sc_thread_pinned;
+
+struct sc_thread_start {
+    sc_thread_fn *fn;
+    void *userdata;
+};
+
+static bool
+sc_thread_restore_cpu_affinity(void);
+
+static int
+sc_thread_run(void *data) {
+    struct sc_thread_start *start = data;
+    sc_thread_fn *fn = start->fn;
+    void *userdata = start->userdata;
+    free(start);
+
+    // The creator may be pinned: only the roles which are pinned must run on
+    // the CPUs of the policy
+    sc_thread_restore_cpu_affinity();
+
+    return fn(userdata);
+}
+
 bool
 sc_thread_create(sc_thread *thread, sc_thread_fn fn, const char *name,
                  void *userdata) {
@@ -17,7 +67,25 @@ sc_thread_create(sc_thread *thread, sc_thread_fn fn, const char *name,
     // longer than 16 bytes (including the final '\0')
     assert(strlen(name) <= 15);
 
-    SDL_Thread *sdl_thread = SDL_CreateThread(fn, name, userdata);
+    SDL_Thread *sdl_thread;
+    if (sc_thread_policy.cpu_affinity) {
+        struct sc_thread_start *start = malloc(sizeof(*start));
+        if (!start) {
+            LOG_OOM();
+            return false;
+        }
+
+        start->fn = fn;
+        start->userdata = userdata;
+
+        sdl_thread = SDL_CreateThread(sc_thread_run, name, start);
+        if (!sdl_thread) {
+            free(start);
+        }
+    } else {
+        sdl_thread = SDL_CreateThread(fn, name, userdata);
+    }
+
     if (!sdl_thread) {
         LOG_OOM();
         return false;
@@ -56,6 +124,180 @@ sc_thread_set_priority(enum sc_thread_priority priority) {
     return true;
 }
 
+void
+sc_thread_set_policy(const struct sc_thread_policy *policy) {
+    sc_thread_policy = *policy;
+
+    if (!policy->cpu_affinity) {
+        return;
+    }
+
+    // Save the CPU affinity of the process before any thread is pinned
+#ifdef __linux__
+    if (sched_getaffinity(0, sizeof(sc_thread_process_cpus),
+                          &sc_thread_process_cpus)) {
+        LOGW("Could not get CPU affinity: %s", strerror(errno));
+        sc_thread_policy.cpu_affinity = 0;
+    }
+#elif defined(_WIN32)
+    DWORD_PTR system_cpus;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &sc_thread_process_cpus,
+                                &system_cpus)) {
+        LOGW("Could not get CPU affinity (error %lu)", GetLastError());
+        sc_thread_policy.cpu_affinity = 0;
+    }
+#else
+    LOGW("CPU affinity is not supported on this platform");
+    sc_thread_policy.cpu_affinity = 0;
+#endif
+}
+
+static bool
+sc_thread_set_realtime(void) {
+#ifdef __linux__
+    struct sched_param param = {
+        .sched_priority = SC_THREAD_REALTIME_PRIORITY,
+    };
+    int r = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (r) {
+        // Typically EPERM: requires CAP_SYS_NICE or an RLIMIT_RTPRIO
+        LOGW("Could not set real-time scheduling (%s), fallback to high "
+             "priority", strerror(r));
+        return sc_thread_set_priority(SC_THREAD_PRIORITY_HIGH);
+    }
+
+    return true;
+#else
+    return sc_thread_set_priority(SC_THREAD_PRIORITY_TIME_CRITICAL);
+#endif
+}
+
+static bool
+sc_thread_set_cpu_affinity(uint64_t mask) {
+    assert(mask);
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned i = 0; i < 64; ++i) {
+        if (mask & (UINT64_C(1) << i)) {
+            CPU_SET(i, &set);
+        }
+    }
+
+    // pid 0 is the calling thread
+    if (sched_setaffinity(0, sizeof(set), &set)) {
+        LOGW("Could not set CPU affinity: %s", strerror(errno));
+        return false;
+    }
+
+    return true;
+#elif defined(_WIN32)
+    if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) mask)) {
+        LOGW("Could not set CPU affinity (error %lu)", GetLastError());
+        return false;
+    }
+
+    return true;
+#else
+    // Already reported by sc_thread_set_policy()
+    return false;
+#endif
+}
+
+static bool
+sc_thread_restore_cpu_affinity(void) {
+    if (!sc_thread_policy.cpu_affinity) {
+        // Never changed
+        return true;
+    }
+
+    sc_thread_pinned = false;
+
+#ifdef __linux__
+    if (sched_setaffinity(0, sizeof(sc_thread_process_cpus),
+                          &sc_thread_process_cpus)) {
+        LOGW("Could not restore CPU affinity: %s", strerror(errno));
+        return false;
+    }
+
+    return true;
+#elif defined(_WIN32)
+    if (!SetThreadAffinityMask(GetCurrentThread(), sc_thread_process_cpus)) {
+        LOGW("Could not restore CPU affinity (error %lu)", GetLastError());
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool
+sc_thread_pin(void) {
+    uint64_t mask = sc_thread_policy.cpu_affinity;
+    if (!mask) {
+        return true;
+    }
+
+    bool ok = sc_thread_set_cpu_affinity(mask);
+    if (ok) {
+        sc_thread_pinned = true;
+    }
+    return ok;
+}
+
+bool
+sc_thread_unpin(void) {
+    if (!sc_thread_pinned) {
+        return false;
+    }
+
+    sc_thread_restore_cpu_affinity();
+    return true;
+}
+
+bool
+sc_thread_apply_role(enum sc_thread_role role) {
+    const struct sc_thread_policy *policy = &sc_thread_policy;
+
+    bool ok = true;
+    switch (role) {
+        case SC_THREAD_ROLE_MEDIA:
+            if (policy->sched == SC_THREAD_SCHED_REALTIME) {
+                ok = sc_thread_set_realtime();
+            } else if (policy->sched == SC_THREAD_SCHED_HIGH) {
+                ok = sc_thread_set_priority(SC_THREAD_PRIORITY_HIGH);
+            }
+            break;
+        case SC_THREAD_ROLE_RENDER:
+        case SC_THREAD_ROLE_CONTROL:
+            // The render thread also handles the events, it must never run
+            // with a real-time policy
+            if (policy->sched != SC_THREAD_SCHED_NORMAL) {
+                ok = sc_thread_set_priority(SC_THREAD_PRIORITY_HIGH);
+            }
+            break;
+        case SC_THREAD_ROLE_BACKGROUND:
+            ok = sc_thread_set_priority(SC_THREAD_PRIORITY_LOW);
+            break;
+        default:
+            assert(!"Unknown thread role");
+            return false;
+    }
+
+    bool pinned = role == SC_THREAD_ROLE_MEDIA
+               || role == SC_THREAD_ROLE_RENDER;
+    if (pinned) {
+        ok &= sc_thread_pin();
+    } else {
+        // In case the thread was created by a pinned thread
+        ok &= sc_thread_restore_cpu_affinity();
+    }
+
+    return ok;
+}
+
 void
 sc_thread_join(sc_thread *thread, int *status) {
     SDL_WaitThread(thread->thread, status);
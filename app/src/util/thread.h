@@ -5,6 +5,7 @@
 
 #include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "tick.h"
 
@@ -28,6 +29,35 @@ enum sc_thread_priority {
     SC_THREAD_PRIORITY_TIME_CRITICAL,
 };
 
+// Role of a thread, to apply the scheduling policy
+enum sc_thread_role {
+    // Receive, decode and buffer the streams (demuxers, delay buffers, V4L2)
+    SC_THREAD_ROLE_MEDIA,
+    // Upload and render the frames (the main thread)
+    SC_THREAD_ROLE_RENDER,
+    // Send and receive the control messages
+    SC_THREAD_ROLE_CONTROL,
+    // Tasks which must not disturb the others (recording, file pushing)
+    SC_THREAD_ROLE_BACKGROUND,
+};
+
+enum sc_thread_sched {
+    // Only lower the background threads
+    SC_THREAD_SCHED_NORMAL,
+    // Raise the media, render and control threads
+    SC_THREAD_SCHED_HIGH,
+    // Like HIGH, but run the media threads with a real-time policy
+    // (SCHED_FIFO on Linux)
+    SC_THREAD_SCHED_REALTIME,
+};
+
+struct sc_thread_policy {
+    enum sc_thread_sched sched;
+    // CPUs to run the media and render threads on (bit i for CPU i), 0 to
+    // let the system schedule them
+    uint64_t cpu_affinity;
+};
+
 typedef struct sc_mutex {
     SDL_Mutex *mutex;
 #ifndef NDEBUG
@@ -51,6 +81,46 @@ sc_thread_join(sc_thread *thread, int *status);
 bool
 sc_thread_set_priority(enum sc_thread_priority priority);
 
+/**
+ * Set the scheduling policy of the threads
+ *
+ * It must be called before any thread is started, and is applied by
+ * sc_thread_apply_role().
+ */
+void
+sc_thread_set_policy(const struct sc_thread_policy *policy);
+
+/**
+ * Apply the scheduling policy to the current thread, according to its role
+ *
+ * It is called at the beginning of the thread function. Failures are not
+ * fatal (the thread runs with the default scheduling).
+ */
+bool
+sc_thread_apply_role(enum sc_thread_role role);
+
+/**
+ * Pin the current thread to the CPUs of the policy (if any)
+ *
+ * It is called by sc_thread_apply_role() for the media and render roles.
+ */
+bool
+sc_thread_pin(void);
+
+/**
+ * Run the current thread on the CPUs of the process if it is pinned
+ *
+ * A new thread inherits the CPU affinity of its creator. The threads started
+ * by sc_thread_create() restore the CPU affinity of the process, but a pinned
+ * thread must call this function before creating threads in a library (e.g.
+ * the SDL audio thread).
+ *
+ * Return true if the thread was pinned, so that the caller can call
+ * sc_thread_pin() afterwards.
+ */
+bool
+sc_thread_unpin(void);
+
 bool
 sc_mutex_init(sc_mutex *mutex);
 
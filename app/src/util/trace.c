@@ -0,0 +1,158 @@
+#include "trace.h"
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "util/log.h"
+#include "util/mpsc_worker.h"
+#include "util/thread.h"
+
+#define SC_TRACE_CAPACITY 8192 // must be a power of 2
+
+struct sc_trace_event {
+    const char *name;
+    sc_tick begin;
+    sc_tick duration;
+    sc_thread_id tid;
+};
+
+struct sc_trace {
+    FILE *file;
+    struct sc_mpsc_worker worker;
+    atomic_uint dropped;
+    bool first; // no event written yet, only accessed by the trace thread
+};
+
+static struct sc_trace sc_trace;
+static atomic_bool sc_trace_enabled;
+
+static void
+sc_trace_write(void *item, void *userdata) {
+    struct sc_trace *trace = userdata;
+    const struct sc_trace_event *event = item;
+
+    // Complete events ("ph": "X"), with dates in microseconds
+    fprintf(trace->file,
+            "%s{\"name\":\"%s\",\"cat\":\"scrcpy\",\"ph\":\"X\","
+            "\"ts\":%" PRItick ",\"dur\":%" PRItick ",\"pid\":1,"
+            "\"tid\":%u}",
+            trace->first ? "\n" : ",\n", event->name,
+            SC_TICK_TO_US(event->begin), SC_TICK_TO_US(event->duration),
+            (unsigned) event->tid);
+    trace->first = false;
+}
+
+static void
+sc_trace_flush(void *userdata) {
+    struct sc_trace *trace = userdata;
+    fflush(trace->file);
+}
+
+bool
+sc_trace_start(const char *filename) {
+    struct sc_trace *trace = &sc_trace;
+
+    trace->file = fopen(filename, "w");
+    if (!trace->file) {
+        LOGE("Could not open trace file: %s", filename);
+        return false;
+    }
+
+    static const struct sc_mpsc_worker_ops ops = {
+        .process = sc_trace_write,
+        .on_drained = sc_trace_flush,
+    };
+
+    bool ok = sc_mpsc_worker_init(&trace->worker, SC_TRACE_CAPACITY,
+                                  sizeof(struct sc_trace_event), &ops, trace);
+    if (!ok) {
+        goto error_close_file;
+    }
+
+    atomic_init(&trace->dropped, 0);
+    trace->first = true;
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", trace->file);
+
+    ok = sc_mpsc_worker_start(&trace->worker, "scrcpy-trace", true);
+    if (!ok) {
+        goto error_destroy_worker;
+    }
+
+    atomic_store_explicit(&sc_trace_enabled, true, memory_order_relaxed);
+
+    LOGI("Recording trace to %s", filename);
+
+    return true;
+
+error_destroy_worker:
+    sc_mpsc_worker_destroy(&trace->worker);
+error_close_file:
+    fclose(trace->file);
+
+    return false;
+}
+
+void
+sc_trace_stop(void) {
+    struct sc_trace *trace = &sc_trace;
+
+    atomic_store_explicit(&sc_trace_enabled, false, memory_order_relaxed);
+
+    sc_mpsc_worker_stop(&trace->worker);
+    sc_mpsc_worker_join(&trace->worker);
+
+    fputs("\n]}\n", trace->file);
+    if (fclose(trace->file)) {
+        LOGE("Could not write trace file");
+    }
+
+    unsigned dropped = atomic_load_explicit(&trace->dropped,
+                                            memory_order_relaxed);
+    if (dropped) {
+        LOGW("%u trace events dropped", dropped);
+    }
+
+    sc_mpsc_worker_destroy(&trace->worker);
+}
+
+sc_tick
+sc_trace_begin(void) {
+    if (!atomic_load_explicit(&sc_trace_enabled, memory_order_relaxed)) {
+        return SC_TICK_NONE;
+    }
+
+    return sc_tick_now();
+}
+
+void
+sc_trace_end(const char *name, sc_tick begin) {
+    if (begin == SC_TICK_NONE) {
+        // Tracing was disabled when the span started
+        return;
+    }
+
+    sc_trace_add(name, begin, sc_tick_now() - begin);
+}
+
+void
+sc_trace_add(const char *name, sc_tick begin, sc_tick duration) {
+    if (!atomic_load_explicit(&sc_trace_enabled, memory_order_relaxed)) {
+        return;
+    }
+
+    struct sc_trace *trace = &sc_trace;
+
+    struct sc_trace_event event = {
+        .name = name,
+        .begin = begin,
+        .duration = duration,
+        .tid = sc_thread_get_id(),
+    };
+
+    if (!sc_mpsc_worker_push(&trace->worker, &event)) {
+        // Never block the instrumented threads
+        atomic_fetch_add_explicit(&trace->dropped, 1, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef SC_TRACE_H
+#define SC_TRACE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "util/tick.h"
+
+/**
+ * Trace recording, in the Chrome trace event format
+ *
+ * Once started, the spans of the instrumented stages (from any thread) are
+ * stored into a lock-free queue, and a background thread writes them to the
+ * trace file. The file can be opened in Perfetto (<https://ui.perfetto.dev>)
+ * or chrome://tracing.
+ *
+ * When tracing is disabled, recording a span costs an atomic load.
+ *
+ * Usage:
+ *
+ *     sc_tick trace = sc_trace_begin();
+ *     // ... work ...
+ *     sc_trace_end("stage_name", trace);
+ *
+ * The name must be a string literal (it is written later).
+ */
+
+bool
+sc_trace_start(const char *filename);
+
+/**
+ * Write the pending spans and close the trace file
+ *
+ * It must be called once the other threads have been joined.
+ */
+void
+sc_trace_stop(void);
+
+// Return the current date if tracing is enabled, SC_TICK_NONE otherwise
+sc_tick
+sc_trace_begin(void);
+
+// Record a span started at begin (as returned by sc_trace_begin())
+void
+sc_trace_end(const char *name, sc_tick begin);
+
+// Record a span whose dates are already known
+void
+sc_trace_add(const char *name, sc_tick begin, sc_tick duration);
+
+#endif
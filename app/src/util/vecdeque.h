@@ -378,4 +378,15 @@ sc_vecdeque_growsize_(size_t value)
 #define sc_vecdeque_pop(pv) \
     (*sc_vecdeque_popref(pv))
 
+/**
+ * Return a pointer to the item at the given index (0 is the next item to pop)
+ *
+ * It is an error to call this function with an index out of bounds.
+ */
+#define sc_vecdeque_getref(pv, index) \
+({ \
+    assert((size_t) (index) < (pv)->size); \
+    &(pv)->data[((pv)->origin + (index)) % (pv)->cap]; \
+})
+
 #endif
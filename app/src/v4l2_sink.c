@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "util/frame_ops.h"
 #include "util/log.h"
 #include "util/str.h"
 
@@ -111,10 +112,58 @@ encode_and_write_frame(struct sc_v4l2_sink *vs, const AVFrame *frame) {
     return true;
 }
 
+static void
+sc_v4l2_sink_get_image(struct sc_yuv420p *image, const AVFrame *frame) {
+    for (int i = 0; i < 3; ++i) {
+        image->data[i] = frame->data[i];
+        image->linesize[i] = frame->linesize[i];
+    }
+    image->width = frame->width;
+    image->height = frame->height;
+}
+
+static bool
+sc_v4l2_sink_orient_frame(struct sc_v4l2_sink *vs, const AVFrame *frame) {
+    AVFrame *oriented = vs->oriented_frame;
+    assert(oriented);
+
+    bool swap = sc_orientation_is_swap(vs->orientation);
+    int width = swap ? frame->height : frame->width;
+    int height = swap ? frame->width : frame->height;
+
+    if (oriented->width != width || oriented->height != height) {
+        // First frame or new frame size
+        av_frame_unref(oriented);
+        oriented->format = AV_PIX_FMT_YUV420P;
+        oriented->width = width;
+        oriented->height = height;
+        if (av_frame_get_buffer(oriented, 0) < 0) {
+            LOG_OOM();
+            return false;
+        }
+    } else if (av_frame_make_writable(oriented) < 0) {
+        // The buffers are reused, unless the encoder still references them
+        LOG_OOM();
+        return false;
+    }
+
+    oriented->pts = frame->pts;
+
+    struct sc_yuv420p src;
+    struct sc_yuv420p dst;
+    sc_v4l2_sink_get_image(&src, frame);
+    sc_v4l2_sink_get_image(&dst, oriented);
+    sc_yuv420p_transform(&dst, &src, vs->orientation);
+
+    return true;
+}
+
 static int
 run_v4l2_sink(void *data) {
     struct sc_v4l2_sink *vs = data;
 
+    sc_thread_apply_role(SC_THREAD_ROLE_MEDIA); // errors already logged
+
     for (;;) {
         sc_mutex_lock(&vs->mutex);
 
@@ -132,7 +181,14 @@ run_v4l2_sink(void *data) {
 
         sc_frame_buffer_consume(&vs->fb, vs->frame);
 
-        bool ok = encode_and_write_frame(vs, vs->frame);
+        const AVFrame *frame = vs->frame;
+        bool ok = true;
+        if (vs->oriented_frame) {
+            ok = sc_v4l2_sink_orient_frame(vs, vs->frame);
+            frame = vs->oriented_frame;
+        }
+
+        ok = ok && encode_and_write_frame(vs, frame);
         av_frame_unref(vs->frame);
         if (!ok) {
             LOGE("Could not send frame to v4l2 sink");
@@ -216,6 +272,13 @@ sc_v4l2_sink_open(struct sc_v4l2_sink *vs, const AVCodecContext *ctx,
         goto error_avformat_free_context;
     }
 
+    // The frames are oriented before being encoded
+    bool swap = sc_orientation_is_swap(vs->orientation);
+    int width = swap ? ctx->height : ctx->width;
+    int height = swap ? ctx->width : ctx->height;
+    ostream->codecpar->width = width;
+    ostream->codecpar->height = height;
+
     // The codec is from the v4l2 encoder, not from the decoder
     ostream->codecpar->codec_id = encoder->id;
 
@@ -232,8 +295,8 @@ sc_v4l2_sink_open(struct sc_v4l2_sink *vs, const AVCodecContext *ctx,
         goto error_avio_close;
     }
 
-    vs->encoder_ctx->width = ctx->width;
-    vs->encoder_ctx->height = ctx->height;
+    vs->encoder_ctx->width = width;
+    vs->encoder_ctx->height = height;
     vs->encoder_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
     vs->encoder_ctx->time_base.num = 1;
     vs->encoder_ctx->time_base.den = 1;
@@ -249,6 +312,16 @@ sc_v4l2_sink_open(struct sc_v4l2_sink *vs, const AVCodecContext *ctx,
         goto error_avcodec_free_context;
     }
 
+    vs->oriented_frame = NULL;
+    if (vs->orientation != SC_ORIENTATION_0) {
+        // The buffers are allocated on the first frame
+        vs->oriented_frame = av_frame_alloc();
+        if (!vs->oriented_frame) {
+            LOG_OOM();
+            goto error_av_frame_free;
+        }
+    }
+
     vs->packet = av_packet_alloc();
     if (!vs->packet) {
         LOG_OOM();
@@ -273,6 +346,7 @@ sc_v4l2_sink_open(struct sc_v4l2_sink *vs, const AVCodecContext *ctx,
 error_av_packet_free:
     av_packet_free(&vs->packet);
 error_av_frame_free:
+    av_frame_free(&vs->oriented_frame);
     av_frame_free(&vs->frame);
 error_avcodec_free_context:
     avcodec_free_context(&vs->encoder_ctx);
@@ -300,6 +374,7 @@ sc_v4l2_sink_close(struct sc_v4l2_sink *vs) {
     sc_thread_join(&vs->thread, NULL);
 
     av_packet_free(&vs->packet);
+    av_frame_free(&vs->oriented_frame);
     av_frame_free(&vs->frame);
     avcodec_free_context(&vs->encoder_ctx);
     avio_close(vs->format_ctx->pb);
@@ -347,13 +422,16 @@ sc_v4l2_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
 }
 
 bool
-sc_v4l2_sink_init(struct sc_v4l2_sink *vs, const char *device_name) {
+sc_v4l2_sink_init(struct sc_v4l2_sink *vs, const char *device_name,
+                  enum sc_orientation orientation) {
     vs->device_name = strdup(device_name);
     if (!vs->device_name) {
         LOGE("Could not strdup v4l2 device name");
         return false;
     }
 
+    vs->orientation = orientation;
+
     static const struct sc_frame_sink_ops ops = {
         .open = sc_v4l2_frame_sink_open,
         .close = sc_v4l2_frame_sink_close,
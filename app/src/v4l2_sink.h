@@ -8,6 +8,7 @@
 #include <libavformat/avformat.h>
 
 #include "frame_buffer.h"
+#include "options.h"
 #include "trait/frame_sink.h"
 #include "util/thread.h"
 
@@ -19,6 +20,7 @@ struct sc_v4l2_sink {
     AVCodecContext *encoder_ctx;
 
     char *device_name;
+    enum sc_orientation orientation;
 
     sc_thread thread;
     sc_mutex mutex;
@@ -28,11 +30,13 @@ struct sc_v4l2_sink {
     bool header_written;
 
     AVFrame *frame;
+    AVFrame *oriented_frame; // NULL if the orientation is 0
     AVPacket *packet;
 };
 
 bool
-sc_v4l2_sink_init(struct sc_v4l2_sink *vs, const char *device_name);
+sc_v4l2_sink_init(struct sc_v4l2_sink *vs, const char *device_name,
+                  enum sc_orientation orientation);
 
 void
 sc_v4l2_sink_destroy(struct sc_v4l2_sink *vs);
@@ -0,0 +1,124 @@
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "adb/adb_client.h"
+#include "util/bench.h"
+#include "util/fake_adb_server.h"
+#include "util/file.h"
+#include "util/log.h"
+#include "util/net.h"
+#include "util/tick.h"
+
+/*
+ * Measure the sequence of adb commands executed on startup (except the server
+ * execution) over the native adb client, against a fake adb server.
+ *
+ * Usage: bench_adb_client
+ */
+
+#define BENCH_PORT_FIRST 27330
+#define BENCH_PORT_LAST 27349
+
+#define BENCH_ITERATIONS 200
+
+#define BENCH_PUSH_FILE "bench_adb_client.tmp"
+#define BENCH_PUSH_SIZE (200 * 1024)
+
+static bool
+write_push_file(void) {
+    FILE *file = sc_file_open(BENCH_PUSH_FILE, "wb");
+    if (!file) {
+        return false;
+    }
+    for (size_t i = 0; i < BENCH_PUSH_SIZE; ++i) {
+        fputc((int) (i * 7 % 251), file);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool
+run_startup_sequence(uint16_t port) {
+    unsigned version;
+    enum sc_adb_client_result res =
+        sc_adb_client_version(NULL, port, 0, &version);
+    if (res != SC_ADB_CLIENT_OK) {
+        return false;
+    }
+
+    char *devices;
+    res = sc_adb_client_list_devices(NULL, port, 0, &devices);
+    if (res != SC_ADB_CLIENT_OK) {
+        return false;
+    }
+    free(devices);
+
+    char buf[128];
+    size_t len;
+    res = sc_adb_client_shell(NULL, port, FAKE_ADB_SERIAL,
+                              "getprop ro.build.version.sdk", 0, buf,
+                              sizeof(buf), &len);
+    if (res != SC_ADB_CLIENT_OK) {
+        return false;
+    }
+
+    res = sc_adb_client_push(NULL, port, FAKE_ADB_SERIAL, BENCH_PUSH_FILE,
+                             "/data/local/tmp/server", 0, NULL, NULL);
+    if (res != SC_ADB_CLIENT_OK) {
+        return false;
+    }
+
+    res = sc_adb_client_reverse(NULL, port, FAKE_ADB_SERIAL,
+                                "localabstract:scrcpy", "tcp:27183", 0);
+    return res == SC_ADB_CLIENT_OK;
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_set_log_level(SC_LOG_LEVEL_WARN);
+
+    if (!net_init()) {
+        return BENCH_SKIP;
+    }
+
+    int ret = BENCH_SKIP;
+
+    if (!write_push_file()) {
+        goto end;
+    }
+
+    struct fake_adb_server server;
+    if (!fake_adb_server_start(&server, BENCH_PORT_FIRST, BENCH_PORT_LAST)) {
+        goto remove_file;
+    }
+
+    sc_tick start = sc_tick_now();
+
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+        if (!run_startup_sequence(server.port)) {
+            fprintf(stderr, "adb request failed\n");
+            ret = 1;
+            goto stop_server;
+        }
+    }
+
+    sc_tick elapsed = sc_tick_now() - start;
+
+    printf("adb startup sequence (native, %d KiB push): %.3f ms\n",
+           BENCH_PUSH_SIZE / 1024,
+           (double) elapsed / BENCH_ITERATIONS / SC_TICK_FROM_MS(1));
+    ret = 0;
+
+stop_server:
+    fake_adb_server_stop(&server);
+remove_file:
+    remove(BENCH_PUSH_FILE);
+end:
+    net_cleanup();
+
+    return ret;
+}
@@ -0,0 +1,316 @@
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <SDL3/SDL.h>
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+
+#include "compositor.h"
+#include "events.h"
+#include "util/bench.h"
+#include "util/log.h"
+#include "util/tick.h"
+
+/*
+ * Measure the cost of each additional tile of the video wall.
+ *
+ * The same stream is replayed to all the tiles: either the video stream of a
+ * recording passed as argument (e.g. recorded by "scrcpy --record=file.mkv"),
+ * or synthetic frames.
+ *
+ * Usage: bench_compositor [recording]
+ */
+
+#define BENCH_ITERATIONS 300
+#define BENCH_MAX_REPLAY_FRAMES 60
+#define BENCH_SYNTHETIC_WIDTH 720
+#define BENCH_SYNTHETIC_HEIGHT 1600
+
+static const unsigned bench_tile_counts[] = {1, 2, 4, 8, 16};
+
+struct bench_frames {
+    AVFrame *frames[BENCH_MAX_REPLAY_FRAMES];
+    unsigned count;
+};
+
+struct bench_result {
+    sc_tick wall_time;
+    sc_tick cpu_time;
+    sc_tick upload_time;
+    sc_tick render_time;
+};
+
+static void
+bench_frames_destroy(struct bench_frames *bf) {
+    for (unsigned i = 0; i < bf->count; ++i) {
+        av_frame_free(&bf->frames[i]);
+    }
+}
+
+static bool
+bench_frames_synthesize(struct bench_frames *bf) {
+    bf->count = 0;
+
+    // A few frames are sufficient, they are uploaded again on each iteration
+    for (unsigned i = 0; i < 4; ++i) {
+        AVFrame *frame = av_frame_alloc();
+        if (!frame) {
+            goto error;
+        }
+        bf->frames[bf->count++] = frame;
+
+        frame->format = AV_PIX_FMT_YUV420P;
+        frame->width = BENCH_SYNTHETIC_WIDTH;
+        frame->height = BENCH_SYNTHETIC_HEIGHT;
+        if (av_frame_get_buffer(frame, 0)) {
+            goto error;
+        }
+
+        for (int y = 0; y < frame->height; ++y) {
+            uint8_t *line = frame->data[0] + y * frame->linesize[0];
+            for (int x = 0; x < frame->width; ++x) {
+                line[x] = (uint8_t) (x + y + i * 16);
+            }
+        }
+        for (int plane = 1; plane < 3; ++plane) {
+            memset(frame->data[plane], 0x80,
+                   frame->linesize[plane] * (frame->height / 2));
+        }
+    }
+
+    return true;
+
+error:
+    fprintf(stderr, "Could not synthesize frames\n");
+    bench_frames_destroy(bf);
+    return false;
+}
+
+static bool
+bench_frames_load(struct bench_frames *bf, const char *filename) {
+    bf->count = 0;
+
+    AVFormatContext *format_ctx = NULL;
+    if (avformat_open_input(&format_ctx, filename, NULL, NULL)) {
+        fprintf(stderr, "Could not open %s\n", filename);
+        return false;
+    }
+
+    AVCodecContext *codec_ctx = NULL;
+    AVPacket *packet = NULL;
+    AVFrame *frame = NULL;
+
+    if (avformat_find_stream_info(format_ctx, NULL) < 0) {
+        fprintf(stderr, "Could not find stream info\n");
+        goto end;
+    }
+
+    const AVCodec *codec;
+    int stream_index = av_find_best_stream(format_ctx, AVMEDIA_TYPE_VIDEO, -1,
+                                           -1, &codec, 0);
+    if (stream_index < 0) {
+        fprintf(stderr, "No video stream in %s\n", filename);
+        goto end;
+    }
+
+    codec_ctx = avcodec_alloc_context3(codec);
+    packet = av_packet_alloc();
+    frame = av_frame_alloc();
+    if (!codec_ctx || !packet || !frame) {
+        goto end;
+    }
+
+    AVStream *stream = format_ctx->streams[stream_index];
+    if (avcodec_parameters_to_context(codec_ctx, stream->codecpar) < 0
+            || avcodec_open2(codec_ctx, codec, NULL) < 0) {
+        fprintf(stderr, "Could not open the decoder\n");
+        goto end;
+    }
+
+    while (bf->count < BENCH_MAX_REPLAY_FRAMES
+            && !av_read_frame(format_ctx, packet)) {
+        if (packet->stream_index != stream_index
+                || avcodec_send_packet(codec_ctx, packet) < 0) {
+            av_packet_unref(packet);
+            continue;
+        }
+        av_packet_unref(packet);
+
+        while (bf->count < BENCH_MAX_REPLAY_FRAMES
+                && !avcodec_receive_frame(codec_ctx, frame)) {
+            if (frame->format != AV_PIX_FMT_YUV420P) {
+                fprintf(stderr, "Unsupported pixel format: %d\n",
+                        frame->format);
+                goto end;
+            }
+
+            // Keep a reference to the decoded frame
+            AVFrame *replay_frame = av_frame_alloc();
+            if (!replay_frame || av_frame_ref(replay_frame, frame)) {
+                av_frame_free(&replay_frame);
+                goto end;
+            }
+            bf->frames[bf->count++] = replay_frame;
+            av_frame_unref(frame);
+        }
+    }
+
+end:
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avcodec_free_context(&codec_ctx);
+    avformat_close_input(&format_ctx);
+
+    if (!bf->count) {
+        fprintf(stderr, "No frames decoded from %s\n", filename);
+        return false;
+    }
+
+    return true;
+}
+
+static sc_tick
+bench_cpu_time(void) {
+    return (sc_tick) clock() * SC_TICK_FREQ / CLOCKS_PER_SEC;
+}
+
+static bool
+bench_run(unsigned tile_count, struct bench_frames *bf,
+          struct bench_result *result) {
+    struct sc_compositor_params params = {
+        .window_title = "bench_compositor",
+        .tile_count = tile_count,
+        .always_on_top = false,
+        .window_x = SC_WINDOW_POSITION_UNDEFINED,
+        .window_y = SC_WINDOW_POSITION_UNDEFINED,
+        .window_width = 1280,
+        .window_height = 720,
+        .window_borderless = false,
+        .orientation = SC_ORIENTATION_0,
+        .mipmaps = false,
+        .fullscreen = false,
+    };
+
+    struct sc_compositor compositor;
+    if (!sc_compositor_init(&compositor, &params)) {
+        return false;
+    }
+
+    // Ignore the initialization
+    compositor.render_count = 0;
+    compositor.upload_time = 0;
+    compositor.render_time = 0;
+
+    sc_tick start = sc_tick_now();
+    sc_tick cpu_start = bench_cpu_time();
+
+    for (unsigned i = 0; i < BENCH_ITERATIONS; ++i) {
+        AVFrame *frame = bf->frames[i % bf->count];
+
+        // Simulate the decoders (the frame sinks do not need to be opened)
+        for (unsigned j = 0; j < tile_count; ++j) {
+            struct sc_frame_sink *sink =
+                sc_compositor_get_frame_sink(&compositor, j);
+            bool ok = sink->ops->push(sink, frame);
+            assert(ok);
+            (void) ok;
+        }
+
+        // Handle the events like the event loop
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SC_EVENT_NEW_TILE_FRAME) {
+                sc_compositor_handle_event(&compositor, &event);
+            }
+        }
+    }
+
+    result->wall_time = sc_tick_now() - start;
+    result->cpu_time = bench_cpu_time() - cpu_start;
+    result->upload_time = compositor.upload_time;
+    result->render_time = compositor.render_time;
+
+    sc_compositor_destroy(&compositor);
+    return true;
+}
+
+static bool
+bench_init_sdl(void) {
+    if (SDL_Init(SDL_INIT_VIDEO)) {
+        return true;
+    }
+
+    // Headless environment
+    fprintf(stderr, "Could not initialize SDL video (%s), retry offscreen\n",
+            SDL_GetError());
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    return SDL_Init(SDL_INIT_VIDEO);
+}
+
+int main(int argc, char *argv[]) {
+    sc_set_log_level(SC_LOG_LEVEL_WARN);
+
+    if (!bench_init_sdl()) {
+        fprintf(stderr, "Could not initialize SDL video: %s\n",
+                SDL_GetError());
+        return BENCH_SKIP;
+    }
+
+    struct bench_frames bf;
+    bool ok = argc > 1 ? bench_frames_load(&bf, argv[1])
+                       : bench_frames_synthesize(&bf);
+    if (!ok) {
+        SDL_Quit();
+        return 1;
+    }
+
+    printf("%u frames of %dx%d, %u iterations\n", bf.count,
+           bf.frames[0]->width, bf.frames[0]->height, BENCH_ITERATIONS);
+    printf("tiles   wall ms   cpu ms   upload ms   render ms"
+           "   (per iteration)\n");
+
+    struct bench_result first;
+    unsigned first_count = 0;
+
+    int ret = 0;
+    for (unsigned i = 0; i < ARRAY_LEN(bench_tile_counts); ++i) {
+        unsigned count = bench_tile_counts[i];
+
+        struct bench_result result;
+        if (!bench_run(count, &bf, &result)) {
+            fprintf(stderr, "Could not run the benchmark for %u tiles\n",
+                    count);
+            ret = BENCH_SKIP;
+            break;
+        }
+
+#define PER_ITERATION(T) ((double) (T) / 1000 / BENCH_ITERATIONS)
+        printf("%5u  %8.3f  %7.3f  %10.3f  %10.3f\n", count,
+               PER_ITERATION(result.wall_time),
+               PER_ITERATION(result.cpu_time),
+               PER_ITERATION(result.upload_time),
+               PER_ITERATION(result.render_time));
+
+        if (!first_count) {
+            first = result;
+            first_count = count;
+        } else {
+            unsigned additional = count - first_count;
+            printf("       per additional tile: %.3f ms wall, %.3f ms cpu\n",
+                   PER_ITERATION(result.wall_time - first.wall_time)
+                        / additional,
+                   PER_ITERATION(result.cpu_time - first.cpu_time)
+                        / additional);
+        }
+#undef PER_ITERATION
+    }
+
+    bench_frames_destroy(&bf);
+    SDL_Quit();
+
+    return ret;
+}
@@ -0,0 +1,191 @@
+#include "common.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "controller.h"
+#include "util/bench.h"
+#include "util/log.h"
+#include "util/net.h"
+#include "util/socket_pair.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/*
+ * Measure the throughput of the controller for bursts of input events (like
+ * multi-touch gestures or text injection).
+ *
+ * Each burst is pushed at once, then the benchmark waits for all its events
+ * to be received on the other end of the control socket before pushing the
+ * next one.
+ *
+ * Usage: bench_controller
+ */
+
+#define BENCH_PORT_FIRST 27320
+#define BENCH_PORT_LAST 27329
+
+#define BENCH_BURST_COUNT 5000
+// Must not exceed the controller queue limit, so that no event is dropped
+#define BENCH_BURST_SIZE 50
+
+// Size of a serialized touch event
+#define BENCH_MSG_SIZE 32
+
+struct bench_reader {
+    sc_socket socket;
+    sc_mutex mutex;
+    sc_cond cond;
+    uint64_t msg_count;
+};
+
+static void
+on_controller_ended(struct sc_controller *controller, bool error,
+                    void *userdata) {
+    (void) controller;
+    (void) error;
+    (void) userdata;
+}
+
+static int
+run_bench_reader(void *data) {
+    struct bench_reader *reader = data;
+
+    uint8_t buf[4096];
+    size_t head = 0;
+
+    for (;;) {
+        ssize_t r = net_recv(reader->socket, buf + head, sizeof(buf) - head);
+        if (r <= 0) {
+            return 0;
+        }
+        head += r;
+
+        size_t count = head / BENCH_MSG_SIZE;
+        size_t consumed = count * BENCH_MSG_SIZE;
+        head -= consumed;
+        memmove(buf, &buf[consumed], head);
+
+        sc_mutex_lock(&reader->mutex);
+        reader->msg_count += count;
+        sc_cond_signal(&reader->cond);
+        sc_mutex_unlock(&reader->mutex);
+    }
+}
+
+static bool
+bench_push_touch(struct sc_controller *controller, int32_t x, int32_t y) {
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = AMOTION_EVENT_ACTION_MOVE,
+            .pointer_id = SC_POINTER_ID_GENERIC_FINGER,
+            .position = {
+                .point = {x, y},
+                .screen_size = {1080, 1920},
+            },
+            .pressure = 1.0f,
+        },
+    };
+    return sc_controller_push_msg(controller, &msg);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_set_log_level(SC_LOG_LEVEL_WARN);
+
+    if (!net_init()) {
+        return BENCH_SKIP;
+    }
+
+    int ret = BENCH_SKIP;
+
+    sc_socket sock;
+    sc_socket peer;
+    if (!create_socket_pair(&sock, &peer, BENCH_PORT_FIRST,
+                            BENCH_PORT_LAST)) {
+        goto end;
+    }
+
+    static const struct sc_controller_callbacks controller_cbs = {
+        .on_ended = on_controller_ended,
+    };
+
+    struct sc_controller controller;
+    if (!sc_controller_init(&controller, sock, &controller_cbs, NULL)) {
+        goto close_sockets;
+    }
+
+    struct bench_reader reader = {
+        .socket = peer,
+        .msg_count = 0,
+    };
+    if (!sc_mutex_init(&reader.mutex)) {
+        goto destroy_controller;
+    }
+    if (!sc_cond_init(&reader.cond)) {
+        goto destroy_mutex;
+    }
+
+    sc_thread thread;
+    if (!sc_thread_create(&thread, run_bench_reader, "bench-reader",
+                          &reader)) {
+        goto destroy_cond;
+    }
+
+    if (!sc_controller_start(&controller)) {
+        goto join_reader;
+    }
+
+    sc_tick start = sc_tick_now();
+
+    uint64_t total = 0;
+    for (int i = 0; i < BENCH_BURST_COUNT; ++i) {
+        for (int j = 0; j < BENCH_BURST_SIZE; ++j) {
+            if (!bench_push_touch(&controller, i, j)) {
+                fprintf(stderr, "Event dropped\n");
+                ret = 1;
+                goto stop_controller;
+            }
+        }
+        total += BENCH_BURST_SIZE;
+
+        sc_mutex_lock(&reader.mutex);
+        while (reader.msg_count < total) {
+            sc_cond_wait(&reader.cond, &reader.mutex);
+        }
+        sc_mutex_unlock(&reader.mutex);
+    }
+
+    sc_tick elapsed = sc_tick_now() - start;
+
+    double secs = (double) elapsed / SC_TICK_FREQ;
+    printf("%" PRIu64 " msgs in %.3fs (bursts of %d): %.0f msgs/s\n", total,
+           secs, BENCH_BURST_SIZE, secs > 0 ? total / secs : 0);
+    ret = 0;
+
+stop_controller:
+    sc_controller_stop(&controller);
+    // Also wake up the controller receiver
+    net_interrupt(sock);
+    sc_controller_join(&controller);
+join_reader:
+    net_interrupt(peer);
+    sc_thread_join(&thread, NULL);
+destroy_cond:
+    sc_cond_destroy(&reader.cond);
+destroy_mutex:
+    sc_mutex_destroy(&reader.mutex);
+destroy_controller:
+    sc_controller_destroy(&controller);
+close_sockets:
+    net_close(sock);
+    net_close(peer);
+end:
+    net_cleanup();
+
+    return ret;
+}
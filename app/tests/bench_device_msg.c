@@ -0,0 +1,170 @@
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "device_msg.h"
+#include "util/bench.h"
+#include "util/binary.h"
+#include "util/bytebuf.h"
+#include "util/tick.h"
+
+/*
+ * Compare the parsing of large clipboard messages received in chunks, in place
+ * from a ring buffer (as the receiver does) and from a linear buffer shifted
+ * with memmove() after each parsing (the previous implementation).
+ *
+ * This is not expected to be faster: the time is dominated by the copy of the
+ * text into each message, while the memmove() only shifts the tail of the last
+ * received chunk.
+ *
+ * Usage: bench_device_msg
+ */
+
+#define BENCH_MSG_COUNT 200
+#define BENCH_MSG_TEXT_LENGTH 200000
+#define BENCH_RECV_SIZE 65536
+
+// Parse all the complete messages available in the ring buffer
+static size_t
+parse_bytebuf(struct sc_bytebuf *buf) {
+    size_t count = 0;
+    for (;;) {
+        const uint8_t *part1;
+        const uint8_t *part2;
+        size_t len1;
+        size_t len2;
+        sc_bytebuf_read_parts(buf, &part1, &len1, &part2, &len2);
+
+        struct sc_device_msg msg;
+        ssize_t r = sc_device_msg_deserialize_split(part1, len1, part2, len2,
+                                                    &msg);
+        if (r <= 0) {
+            return count;
+        }
+
+        sc_device_msg_destroy(&msg);
+        sc_bytebuf_skip(buf, r);
+        ++count;
+    }
+}
+
+// Parse all the complete messages available in the linear buffer, then shift
+// the remaining data
+static size_t
+parse_linear(uint8_t *buf, size_t *head) {
+    size_t count = 0;
+    size_t consumed = 0;
+    for (;;) {
+        struct sc_device_msg msg;
+        ssize_t r = sc_device_msg_deserialize(&buf[consumed],
+                                              *head - consumed, &msg);
+        if (r <= 0) {
+            break;
+        }
+        sc_device_msg_destroy(&msg);
+        consumed += r;
+        ++count;
+    }
+
+    if (consumed) {
+        *head -= consumed;
+        memmove(buf, &buf[consumed], *head);
+    }
+
+    return count;
+}
+
+static bool
+bench_ring(const uint8_t *msg, size_t msg_len, sc_tick *duration) {
+    struct sc_bytebuf buf;
+    if (!sc_bytebuf_init(&buf, DEVICE_MSG_MAX_SIZE)) {
+        return false;
+    }
+
+    sc_tick start = sc_tick_now();
+    size_t count = 0;
+    size_t offset = 0;
+    for (int i = 0; i < BENCH_MSG_COUNT;) {
+        size_t len;
+        uint8_t *ptr = sc_bytebuf_prepare_write(&buf, &len);
+        size_t n = MIN(MIN(len, BENCH_RECV_SIZE), msg_len - offset);
+        memcpy(ptr, &msg[offset], n);
+        sc_bytebuf_commit_write(&buf, n);
+        offset += n;
+        if (offset == msg_len) {
+            offset = 0;
+            ++i;
+        }
+        count += parse_bytebuf(&buf);
+    }
+    *duration = sc_tick_now() - start;
+
+    sc_bytebuf_destroy(&buf);
+
+    return count == BENCH_MSG_COUNT;
+}
+
+static bool
+bench_linear(const uint8_t *msg, size_t msg_len, sc_tick *duration) {
+    uint8_t *buf = malloc(DEVICE_MSG_MAX_SIZE);
+    if (!buf) {
+        return false;
+    }
+
+    sc_tick start = sc_tick_now();
+    size_t count = 0;
+    size_t offset = 0;
+    size_t head = 0;
+    for (int i = 0; i < BENCH_MSG_COUNT;) {
+        size_t len = DEVICE_MSG_MAX_SIZE - head;
+        size_t n = MIN(MIN(len, BENCH_RECV_SIZE), msg_len - offset);
+        memcpy(&buf[head], &msg[offset], n);
+        head += n;
+        offset += n;
+        if (offset == msg_len) {
+            offset = 0;
+            ++i;
+        }
+        count += parse_linear(buf, &head);
+    }
+    *duration = sc_tick_now() - start;
+
+    free(buf);
+
+    return count == BENCH_MSG_COUNT;
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    size_t msg_len = 5 + BENCH_MSG_TEXT_LENGTH;
+    uint8_t *msg = malloc(msg_len);
+    if (!msg) {
+        return BENCH_SKIP;
+    }
+    msg[0] = DEVICE_MSG_TYPE_CLIPBOARD;
+    sc_write32be(&msg[1], BENCH_MSG_TEXT_LENGTH);
+    memset(&msg[5], 'a', BENCH_MSG_TEXT_LENGTH);
+
+    sc_tick ring_duration;
+    sc_tick linear_duration;
+    if (!bench_ring(msg, msg_len, &ring_duration)
+            || !bench_linear(msg, msg_len, &linear_duration)) {
+        fprintf(stderr, "Could not run the benchmark\n");
+        free(msg);
+        return 1;
+    }
+
+    free(msg);
+
+    double mb = (double) BENCH_MSG_COUNT * msg_len / (1024 * 1024);
+    printf("%.0f MB of clipboard messages in %d-byte chunks\n", mb,
+           BENCH_RECV_SIZE);
+    printf("ring buffer:   %.3fs\n", (double) ring_duration / SC_TICK_FREQ);
+    printf("linear buffer: %.3fs\n", (double) linear_duration / SC_TICK_FREQ);
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include "common.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util/bench.h"
+#include "util/frame_ops.h"
+#include "util/tick.h"
+
+/*
+ * Measure the throughput of the frame operations, for each implementation
+ * supported by the CPU.
+ *
+ * The operations are applied to a YUV 4:2:0 frame of the size of a typical
+ * device screen. The throughput is expressed in source frames per second.
+ *
+ * Usage: bench_frame_ops
+ */
+
+#define BENCH_WIDTH 1080
+#define BENCH_HEIGHT 2400
+#define BENCH_ITERATIONS 50
+
+struct bench_image {
+    struct sc_yuv420p image;
+    uint8_t *buffer;
+};
+
+enum bench_op {
+    BENCH_OP_ROTATE_90,
+    BENCH_OP_ROTATE_180,
+    BENCH_OP_FLIP_0,
+    BENCH_OP_DOWNSCALE_2X,
+    BENCH_OP_TO_NV12,
+    BENCH_OP_FROM_NV12,
+};
+
+static const char *const bench_op_names[] = {
+    [BENCH_OP_ROTATE_90] = "rotate 90",
+    [BENCH_OP_ROTATE_180] = "rotate 180",
+    [BENCH_OP_FLIP_0] = "flip",
+    [BENCH_OP_DOWNSCALE_2X] = "downscale 2x",
+    [BENCH_OP_TO_NV12] = "to nv12",
+    [BENCH_OP_FROM_NV12] = "from nv12",
+};
+
+static const enum sc_simd bench_simd[] = {
+    SC_SIMD_NONE,
+    SC_SIMD_SSE2,
+    SC_SIMD_AVX2,
+    SC_SIMD_NEON,
+};
+
+static bool
+bench_image_init(struct bench_image *bi, unsigned width, unsigned height) {
+    unsigned chroma_width = (width + 1) / 2;
+    unsigned chroma_height = (height + 1) / 2;
+
+    // Align the lines on 64 bytes, like av_frame_get_buffer()
+    int linesize = (width + 63) & ~63;
+    int chroma_linesize = (chroma_width + 63) & ~63;
+
+    size_t luma_size = (size_t) linesize * height;
+    size_t chroma_size = (size_t) chroma_linesize * chroma_height;
+
+    bi->buffer = malloc(luma_size + 2 * chroma_size);
+    if (!bi->buffer) {
+        return false;
+    }
+
+    for (size_t i = 0; i < luma_size + 2 * chroma_size; ++i) {
+        bi->buffer[i] = (uint8_t) (i * 7);
+    }
+
+    bi->image.data[0] = bi->buffer;
+    bi->image.data[1] = bi->buffer + luma_size;
+    bi->image.data[2] = bi->buffer + luma_size + chroma_size;
+    bi->image.linesize[0] = linesize;
+    bi->image.linesize[1] = chroma_linesize;
+    bi->image.linesize[2] = chroma_linesize;
+    bi->image.width = width;
+    bi->image.height = height;
+    return true;
+}
+
+static void
+bench_image_destroy(struct bench_image *bi) {
+    free(bi->buffer);
+}
+
+static void
+bench_run_op(enum bench_op op, const struct sc_yuv420p *src,
+             const struct sc_yuv420p *swapped,
+             const struct sc_yuv420p *same, const struct sc_yuv420p *half) {
+    switch (op) {
+        case BENCH_OP_ROTATE_90:
+            sc_yuv420p_transform(swapped, src, SC_ORIENTATION_90);
+            break;
+        case BENCH_OP_ROTATE_180:
+            sc_yuv420p_transform(same, src, SC_ORIENTATION_180);
+            break;
+        case BENCH_OP_FLIP_0:
+            sc_yuv420p_transform(same, src, SC_ORIENTATION_FLIP_0);
+            break;
+        case BENCH_OP_DOWNSCALE_2X:
+            sc_yuv420p_downscale_2x(half, src);
+            break;
+        case BENCH_OP_TO_NV12:
+            // The chroma planes of "same" are contiguous: use them as a
+            // single interleaved plane
+            sc_yuv420p_to_nv12(same->data[0], same->linesize[0],
+                               same->data[1], 2 * same->linesize[1], src);
+            break;
+        case BENCH_OP_FROM_NV12:
+            sc_yuv420p_from_nv12(same, src->data[0], src->linesize[0],
+                                 src->data[1], 2 * src->linesize[1]);
+            break;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    struct bench_image src;
+    struct bench_image swapped;
+    struct bench_image same;
+    struct bench_image half;
+
+    if (!bench_image_init(&src, BENCH_WIDTH, BENCH_HEIGHT)) {
+        return BENCH_SKIP;
+    }
+    if (!bench_image_init(&swapped, BENCH_HEIGHT, BENCH_WIDTH)) {
+        bench_image_destroy(&src);
+        return BENCH_SKIP;
+    }
+    if (!bench_image_init(&same, BENCH_WIDTH, BENCH_HEIGHT)) {
+        bench_image_destroy(&swapped);
+        bench_image_destroy(&src);
+        return BENCH_SKIP;
+    }
+    if (!bench_image_init(&half, (BENCH_WIDTH + 1) / 2,
+                          (BENCH_HEIGHT + 1) / 2)) {
+        bench_image_destroy(&same);
+        bench_image_destroy(&swapped);
+        bench_image_destroy(&src);
+        return BENCH_SKIP;
+    }
+
+    printf("%ux%u frames, %u iterations (frames per second)\n", BENCH_WIDTH,
+           BENCH_HEIGHT, BENCH_ITERATIONS);
+    printf("%-14s", "operation");
+    for (size_t i = 0; i < ARRAY_LEN(bench_simd); ++i) {
+        printf(" %9s", sc_simd_get_name(bench_simd[i]));
+    }
+    printf("\n");
+
+    enum sc_simd initial_simd = sc_frame_ops_get_simd();
+
+    for (unsigned op = 0; op < ARRAY_LEN(bench_op_names); ++op) {
+        printf("%-14s", bench_op_names[op]);
+        for (size_t i = 0; i < ARRAY_LEN(bench_simd); ++i) {
+            if (!sc_frame_ops_set_simd(bench_simd[i])) {
+                printf(" %9s", "-");
+                continue;
+            }
+
+            // Warm up the caches
+            bench_run_op(op, &src.image, &swapped.image, &same.image,
+                         &half.image);
+
+            sc_tick start = sc_tick_now();
+            for (unsigned j = 0; j < BENCH_ITERATIONS; ++j) {
+                bench_run_op(op, &src.image, &swapped.image, &same.image,
+                             &half.image);
+            }
+            sc_tick duration = sc_tick_now() - start;
+
+            double fps = (double) BENCH_ITERATIONS * SC_TICK_FREQ
+                       / MAX(duration, 1);
+            printf(" %9.1f", fps);
+        }
+        printf("\n");
+    }
+
+    printf("default implementation: %s\n", sc_simd_get_name(initial_simd));
+
+    bench_image_destroy(&half);
+    bench_image_destroy(&same);
+    bench_image_destroy(&swapped);
+    bench_image_destroy(&src);
+
+    return 0;
+}
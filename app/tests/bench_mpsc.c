@@ -0,0 +1,256 @@
+#include "common.h"
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util/bench.h"
+#include "util/log.h"
+#include "util/mpsc_queue.h"
+#include "util/notifier.h"
+#include "util/thread.h"
+#include "util/tick.h"
+#include "util/vecdeque.h"
+
+/*
+ * Compare the lock-free MPSC queue (with a notifier) to a mutex, a condition
+ * variable and a vecdeque (the pattern previously used by the controller and
+ * the AOA thread), under contention.
+ *
+ * Several producer threads push small messages as fast as possible to a
+ * single consumer thread. The queues are bounded: a producer retries while
+ * the queue is full. For each number of producers, the benchmark reports the
+ * throughput and the maximum time spent in a single push.
+ *
+ * Usage: bench_mpsc
+ */
+
+#define BENCH_ITEMS_PER_PRODUCER 100000
+#define BENCH_CAPACITY 256
+#define BENCH_MAX_PRODUCERS 8
+
+struct bench_item {
+    uint64_t value;
+    sc_tick date;
+};
+
+struct bench_item_queue SC_VECDEQUE(struct bench_item);
+
+struct bench_locked {
+    sc_mutex mutex;
+    sc_cond cond;
+    struct bench_item_queue queue;
+};
+
+struct bench_lockfree {
+    struct sc_mpsc_queue queue;
+    struct sc_notifier notifier;
+};
+
+struct bench {
+    bool lockfree;
+    struct bench_locked locked;
+    struct bench_lockfree lockfree_queue;
+    unsigned producers;
+    uint64_t sum; // checksum computed by the consumer
+};
+
+struct bench_producer {
+    struct bench *bench;
+    sc_tick max_push_duration;
+};
+
+static bool
+bench_locked_push(struct bench_locked *locked, const struct bench_item *item) {
+    sc_mutex_lock(&locked->mutex);
+    bool full = sc_vecdeque_is_full(&locked->queue);
+    if (!full) {
+        bool was_empty = sc_vecdeque_is_empty(&locked->queue);
+        sc_vecdeque_push_noresize(&locked->queue, *item);
+        if (was_empty) {
+            sc_cond_signal(&locked->cond);
+        }
+    }
+    sc_mutex_unlock(&locked->mutex);
+    return !full;
+}
+
+static bool
+bench_lockfree_push(struct bench_lockfree *lockfree,
+                    const struct bench_item *item) {
+    bool pushed = sc_mpsc_queue_push(&lockfree->queue, item);
+    if (pushed) {
+        sc_notifier_notify(&lockfree->notifier);
+    }
+    return pushed;
+}
+
+static int
+run_producer(void *data) {
+    struct bench_producer *producer = data;
+    struct bench *bench = producer->bench;
+
+    for (uint64_t i = 0; i < BENCH_ITEMS_PER_PRODUCER; ++i) {
+        struct bench_item item = {
+            .value = i,
+        };
+        bool pushed;
+        do {
+            item.date = sc_tick_now();
+            pushed = bench->lockfree
+                   ? bench_lockfree_push(&bench->lockfree_queue, &item)
+                   : bench_locked_push(&bench->locked, &item);
+        } while (!pushed); // full, retry
+
+        sc_tick duration = sc_tick_now() - item.date;
+        if (duration > producer->max_push_duration) {
+            producer->max_push_duration = duration;
+        }
+    }
+
+    return 0;
+}
+
+static void
+bench_consume_locked(struct bench *bench, uint64_t count) {
+    struct bench_locked *locked = &bench->locked;
+    while (count) {
+        sc_mutex_lock(&locked->mutex);
+        while (sc_vecdeque_is_empty(&locked->queue)) {
+            sc_cond_wait(&locked->cond, &locked->mutex);
+        }
+        while (!sc_vecdeque_is_empty(&locked->queue)) {
+            struct bench_item item = sc_vecdeque_pop(&locked->queue);
+            bench->sum += item.value;
+            --count;
+        }
+        sc_mutex_unlock(&locked->mutex);
+    }
+}
+
+static void
+bench_consume_lockfree(struct bench *bench, uint64_t count) {
+    struct bench_lockfree *lockfree = &bench->lockfree_queue;
+    while (count) {
+        struct bench_item item;
+        if (sc_mpsc_queue_pop(&lockfree->queue, &item)) {
+            bench->sum += item.value;
+            --count;
+            continue;
+        }
+
+        sc_notifier_prepare_wait(&lockfree->notifier);
+        if (!sc_mpsc_queue_is_empty(&lockfree->queue)) {
+            sc_notifier_cancel_wait(&lockfree->notifier);
+        } else {
+            sc_notifier_wait(&lockfree->notifier);
+        }
+    }
+}
+
+static bool
+bench_run(struct bench *bench, sc_tick *duration, sc_tick *max_push) {
+    struct bench_producer producers[BENCH_MAX_PRODUCERS];
+    sc_thread threads[BENCH_MAX_PRODUCERS];
+
+    bench->sum = 0;
+    sc_tick start = sc_tick_now();
+
+    unsigned started;
+    for (started = 0; started < bench->producers; ++started) {
+        producers[started].bench = bench;
+        producers[started].max_push_duration = 0;
+        if (!sc_thread_create(&threads[started], run_producer,
+                              "bench-producer", &producers[started])) {
+            break;
+        }
+    }
+
+    if (started != bench->producers) {
+        // The started producers would block forever on a full queue
+        fprintf(stderr, "Could not start the producers\n");
+        exit(BENCH_SKIP);
+    }
+
+    uint64_t count = (uint64_t) bench->producers * BENCH_ITEMS_PER_PRODUCER;
+    if (bench->lockfree) {
+        bench_consume_lockfree(bench, count);
+    } else {
+        bench_consume_locked(bench, count);
+    }
+
+    *duration = sc_tick_now() - start;
+
+    *max_push = 0;
+    for (unsigned i = 0; i < started; ++i) {
+        sc_thread_join(&threads[i], NULL);
+        *max_push = MAX(*max_push, producers[i].max_push_duration);
+    }
+
+    uint64_t n = BENCH_ITEMS_PER_PRODUCER;
+    uint64_t expected = bench->producers * (n * (n - 1) / 2);
+    return bench->sum == expected;
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_set_log_level(SC_LOG_LEVEL_WARN);
+
+    struct bench *bench = malloc(sizeof(*bench));
+    if (!bench) {
+        return 1;
+    }
+
+    struct bench_locked *locked = &bench->locked;
+    struct bench_lockfree *lockfree = &bench->lockfree_queue;
+    sc_vecdeque_init(&locked->queue);
+    if (!sc_vecdeque_reserve(&locked->queue, BENCH_CAPACITY)
+            || !sc_mutex_init(&locked->mutex)
+            || !sc_cond_init(&locked->cond)
+            || !sc_mpsc_queue_init(&lockfree->queue, BENCH_CAPACITY,
+                                   sizeof(struct bench_item))
+            || !sc_notifier_init(&lockfree->notifier)) {
+        // Resources are released on exit
+        return 1;
+    }
+
+    printf("%d items per producer, capacity %d\n", BENCH_ITEMS_PER_PRODUCER,
+           BENCH_CAPACITY);
+    printf("%-10s %9s %12s %14s\n", "queue", "producers", "items/ms",
+           "max push us");
+
+    int ret = 0;
+    for (unsigned producers = 1; producers <= BENCH_MAX_PRODUCERS;
+            producers *= 2) {
+        for (int lf = 0; lf < 2; ++lf) {
+            bench->lockfree = lf;
+            bench->producers = producers;
+
+            sc_tick duration;
+            sc_tick max_push;
+            if (!bench_run(bench, &duration, &max_push)) {
+                fprintf(stderr, "Items lost\n");
+                ret = 1;
+                goto end;
+            }
+
+            uint64_t items = (uint64_t) producers * BENCH_ITEMS_PER_PRODUCER;
+            uint64_t per_ms = items * SC_TICK_FROM_MS(1) / MAX(duration, 1);
+            printf("%-10s %9u %12" PRIu64 " %14" PRItick "\n",
+                   lf ? "lock-free" : "mutex", producers, per_ms, max_push);
+        }
+    }
+
+end:
+    sc_notifier_destroy(&lockfree->notifier);
+    sc_mpsc_queue_destroy(&lockfree->queue);
+    sc_cond_destroy(&locked->cond);
+    sc_mutex_destroy(&locked->mutex);
+    sc_vecdeque_destroy(&locked->queue);
+    free(bench);
+
+    return ret;
+}
@@ -0,0 +1,326 @@
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "util/bench.h"
+#include "util/binary.h"
+#include "util/log.h"
+#include "util/net.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/*
+ * Measure the effect of the socket tuning options on a loopback stream
+ * shaped like a high bit rate video stream: large key frames (bursts) at
+ * regular intervals between smaller frames.
+ *
+ * Each packet is sent with the header used by the video stream (8-byte PTS
+ * followed by the 4-byte packet size); the PTS field carries the send date,
+ * so that the receiver can measure the latency of each packet.
+ *
+ * Usage: bench_net
+ */
+
+#define BENCH_PORT 27300
+#define BENCH_DURATION SC_TICK_FROM_SEC(2)
+#define BENCH_FPS 60
+#define BENCH_BIT_RATE 200000000 // 200 Mbps
+#define BENCH_KEY_FRAME_INTERVAL 60 // one key frame per second
+#define BENCH_KEY_FRAME_SIZE (2 * 1024 * 1024)
+#define BENCH_HEADER_SIZE 12
+
+struct bench_config {
+    const char *name;
+    int recv_buffer_size; // 0 for default
+    int recv_lowat; // 0 for default
+    int busy_poll; // 0 for default
+    bool quickack;
+};
+
+static const struct bench_config bench_configs[] = {
+    {"default", 0, 0, 0, false},
+    {"rcvbuf=256K", 256000, 0, 0, false},
+    {"rcvbuf=4M", 4000000, 0, 0, false},
+    {"rcvbuf=4M,quickack", 4000000, 0, 0, true},
+    {"rcvbuf=4M,rcvlowat=12", 4000000, BENCH_HEADER_SIZE, 0, false},
+    {"rcvbuf=4M,busy-poll=50", 4000000, 0, 50, false},
+};
+
+struct bench_sender {
+    uint16_t port;
+    uint8_t *buf;
+    uint64_t sent_bytes;
+    bool ok;
+};
+
+struct bench_result {
+    sc_tick duration;
+    uint64_t bytes;
+    unsigned packets;
+    sc_tick total_latency;
+    sc_tick max_latency;
+    sc_tick max_key_frame_latency;
+    int effective_rcvbuf;
+};
+
+static uint32_t
+bench_get_frame_size(unsigned index) {
+    if (index % BENCH_KEY_FRAME_INTERVAL == 0) {
+        return BENCH_KEY_FRAME_SIZE;
+    }
+
+    // Distribute the remaining bit rate over the other frames
+    uint64_t bytes_per_sec = BENCH_BIT_RATE / 8;
+    uint64_t remaining = bytes_per_sec
+                       - BENCH_KEY_FRAME_SIZE * BENCH_FPS
+                            / BENCH_KEY_FRAME_INTERVAL;
+    return remaining / (BENCH_FPS - BENCH_FPS / BENCH_KEY_FRAME_INTERVAL);
+}
+
+static int
+run_sender(void *data) {
+    struct bench_sender *sender = data;
+
+    sender->ok = false;
+    sender->sent_bytes = 0;
+
+    sc_socket socket = net_socket();
+    if (socket == SC_SOCKET_NONE) {
+        return 0;
+    }
+
+    if (!net_connect(socket, IPV4_LOCALHOST, sender->port)) {
+        net_close(socket);
+        return 0;
+    }
+
+    // Like the device, send each packet immediately
+    net_set_tcp_nodelay(socket, true);
+
+    sc_tick start = sc_tick_now();
+    sc_tick frame_duration = SC_TICK_FREQ / BENCH_FPS;
+    for (unsigned i = 0;; ++i) {
+        sc_tick deadline = start + i * frame_duration;
+        if (deadline - start >= BENCH_DURATION) {
+            break;
+        }
+
+        sc_tick now = sc_tick_now();
+        if (now < deadline) {
+            sc_tick delay = deadline - now;
+            struct timespec ts = {
+                .tv_sec = delay / SC_TICK_FREQ,
+                .tv_nsec = (delay % SC_TICK_FREQ) * 1000,
+            };
+            nanosleep(&ts, NULL);
+        }
+
+        uint32_t size = bench_get_frame_size(i);
+        uint8_t *header = sender->buf;
+        sc_write64be(header, sc_tick_now());
+        sc_write32be(&header[8], size);
+
+        ssize_t w = net_send_all(socket, sender->buf,
+                                 BENCH_HEADER_SIZE + size);
+        if (w != (ssize_t) (BENCH_HEADER_SIZE + size)) {
+            net_close(socket);
+            return 0;
+        }
+
+        sender->sent_bytes += w;
+    }
+
+    net_close(socket);
+    sender->ok = true;
+    return 0;
+}
+
+static bool
+bench_tune(sc_socket socket, const struct bench_config *config) {
+    bool ok = true;
+    if (config->recv_buffer_size) {
+        ok &= net_set_recv_buffer_size(socket, config->recv_buffer_size);
+    }
+    if (config->recv_lowat) {
+        ok &= net_set_recv_lowat(socket, config->recv_lowat);
+    }
+    if (config->busy_poll) {
+        ok &= net_set_busy_poll(socket, config->busy_poll);
+    }
+    if (config->quickack) {
+        ok &= net_set_tcp_quickack(socket, true);
+    }
+    return ok;
+}
+
+static bool
+bench_receive(sc_socket socket, uint8_t *buf,
+              const struct bench_config *config,
+              struct bench_result *result) {
+    memset(result, 0, sizeof(*result));
+
+    sc_tick start = 0;
+    for (;;) {
+        uint8_t header[BENCH_HEADER_SIZE];
+        ssize_t r = net_recv_all(socket, header, BENCH_HEADER_SIZE);
+        if (r == 0) {
+            // end of stream
+            break;
+        }
+        if (r != BENCH_HEADER_SIZE) {
+            return false;
+        }
+
+        sc_tick send_date = sc_read64be(header);
+        uint32_t size = sc_read32be(&header[8]);
+        if (size > BENCH_KEY_FRAME_SIZE) {
+            return false;
+        }
+
+        r = net_recv_all(socket, buf, size);
+        if (r != (ssize_t) size) {
+            return false;
+        }
+
+        sc_tick now = sc_tick_now();
+        if (!start) {
+            start = send_date;
+        }
+
+        sc_tick latency = now - send_date;
+        result->total_latency += latency;
+        result->max_latency = MAX(result->max_latency, latency);
+        if (size == BENCH_KEY_FRAME_SIZE) {
+            result->max_key_frame_latency =
+                MAX(result->max_key_frame_latency, latency);
+        }
+
+        result->bytes += BENCH_HEADER_SIZE + size;
+        ++result->packets;
+
+        // Quick-ack mode is not permanent, re-enable it after each read (as
+        // it would be for a long-running stream)
+        if (config->quickack) {
+            net_set_tcp_quickack(socket, true);
+        }
+    }
+
+    result->duration = sc_tick_now() - start;
+    return result->packets > 0;
+}
+
+static bool
+bench_run(unsigned index, const struct bench_config *config, uint8_t *buf,
+          struct bench_result *result) {
+    uint16_t port = BENCH_PORT + index;
+
+    sc_socket server_socket = net_socket();
+    if (server_socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    bool ok = net_listen(server_socket, IPV4_LOCALHOST, port, 1);
+    if (!ok) {
+        net_close(server_socket);
+        return false;
+    }
+
+    struct bench_sender sender = {
+        .port = port,
+        .buf = buf,
+    };
+
+    sc_thread thread;
+    ok = sc_thread_create(&thread, run_sender, "bench-sender", &sender);
+    if (!ok) {
+        net_close(server_socket);
+        return false;
+    }
+
+    sc_socket socket = net_accept(server_socket);
+    net_close(server_socket);
+    if (socket == SC_SOCKET_NONE) {
+        sc_thread_join(&thread, NULL);
+        return false;
+    }
+
+    if (!bench_tune(socket, config)) {
+        fprintf(stderr, "Some socket options are not supported (%s)\n",
+                config->name);
+    }
+
+    int rcvbuf = 0;
+    net_get_recv_buffer_size(socket, &rcvbuf);
+
+    // The receiver uses its own buffer (the sender buffer content does not
+    // matter, but it must not be written concurrently)
+    uint8_t *recv_buf = malloc(BENCH_KEY_FRAME_SIZE);
+    if (!recv_buf) {
+        net_interrupt(socket);
+        sc_thread_join(&thread, NULL);
+        net_close(socket);
+        return false;
+    }
+
+    ok = bench_receive(socket, recv_buf, config, result);
+    result->effective_rcvbuf = rcvbuf;
+
+    free(recv_buf);
+    net_interrupt(socket);
+    sc_thread_join(&thread, NULL);
+    net_close(socket);
+
+    return ok && sender.ok && sender.sent_bytes == result->bytes;
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_set_log_level(SC_LOG_LEVEL_WARN);
+
+    if (!net_init()) {
+        return BENCH_SKIP;
+    }
+
+    uint8_t *buf = malloc(BENCH_HEADER_SIZE + BENCH_KEY_FRAME_SIZE);
+    if (!buf) {
+        net_cleanup();
+        return 1;
+    }
+    memset(buf, 0x42, BENCH_HEADER_SIZE + BENCH_KEY_FRAME_SIZE);
+
+    printf("%d Mbps, %d fps, %d KiB key frames every %d frames, %.1f s\n",
+           BENCH_BIT_RATE / 1000000, BENCH_FPS, BENCH_KEY_FRAME_SIZE / 1024,
+           BENCH_KEY_FRAME_INTERVAL, (double) BENCH_DURATION / SC_TICK_FREQ);
+    printf("%-24s %9s %7s %9s %9s %9s\n", "config", "rcvbuf", "Mbps",
+           "avg ms", "max ms", "key ms");
+
+    int ret = 0;
+    for (unsigned i = 0; i < ARRAY_LEN(bench_configs); ++i) {
+        const struct bench_config *config = &bench_configs[i];
+
+        struct bench_result result;
+        if (!bench_run(i, config, buf, &result)) {
+            fprintf(stderr, "Could not run the benchmark (%s)\n",
+                    config->name);
+            ret = BENCH_SKIP;
+            break;
+        }
+
+        double mbps = (double) result.bytes * 8 / result.duration;
+        printf("%-24s %9d %7.1f %9.3f %9.3f %9.3f\n", config->name,
+               result.effective_rcvbuf, mbps,
+               (double) result.total_latency / result.packets / 1000,
+               (double) result.max_latency / 1000,
+               (double) result.max_key_frame_latency / 1000);
+    }
+
+    free(buf);
+    net_cleanup();
+
+    return ret;
+}
@@ -0,0 +1,192 @@
+#include "common.h"
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL3/SDL_cpuinfo.h>
+
+#include "util/bench.h"
+#include "util/log.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/*
+ * Measure the wakeup jitter of a periodic media thread under CPU load, for
+ * each scheduling policy.
+ *
+ * The media thread wakes up every millisecond (like a demuxer receiving
+ * packets at a high rate) while busy threads (twice the number of CPUs)
+ * compete for the CPUs. The wakeup delay is the difference between the
+ * actual and the expected wakeup dates.
+ *
+ * The real-time policy typically requires privileges (CAP_SYS_NICE or
+ * RLIMIT_RTPRIO on Linux): without them, it falls back to a high priority.
+ *
+ * Usage: bench_sched
+ */
+
+#define BENCH_PERIOD SC_TICK_FROM_MS(1)
+#define BENCH_ITERATIONS 2000
+#define BENCH_MAX_LOAD_THREADS 64
+
+struct bench_config {
+    const char *name;
+    enum sc_thread_sched sched;
+    bool pin; // pin the media thread to the last CPU
+};
+
+static const struct bench_config bench_configs[] = {
+    {"normal", SC_THREAD_SCHED_NORMAL, false},
+    {"high", SC_THREAD_SCHED_HIGH, false},
+    {"realtime", SC_THREAD_SCHED_REALTIME, false},
+    {"realtime+affinity", SC_THREAD_SCHED_REALTIME, true},
+};
+
+struct bench_media {
+    sc_mutex mutex;
+    sc_cond cond; // never signaled, only used for timed waits
+    sc_tick delays[BENCH_ITERATIONS];
+};
+
+static atomic_bool bench_stopped;
+
+static int
+run_load(void *data) {
+    (void) data;
+
+    // Burn CPU until the end of the measure
+    volatile uint64_t counter = 0;
+    while (!atomic_load_explicit(&bench_stopped, memory_order_relaxed)) {
+        ++counter;
+    }
+
+    return 0;
+}
+
+static int
+run_media(void *data) {
+    struct bench_media *media = data;
+
+    sc_thread_apply_role(SC_THREAD_ROLE_MEDIA);
+
+    sc_tick deadline = sc_tick_now();
+    sc_mutex_lock(&media->mutex);
+    for (unsigned i = 0; i < BENCH_ITERATIONS; ++i) {
+        deadline += BENCH_PERIOD;
+        while (sc_cond_timedwait(&media->cond, &media->mutex, deadline))
+            ; // spurious wakeup
+        media->delays[i] = sc_tick_now() - deadline;
+    }
+    sc_mutex_unlock(&media->mutex);
+
+    return 0;
+}
+
+static int
+bench_compare_ticks(const void *a, const void *b) {
+    sc_tick ta = *(const sc_tick *) a;
+    sc_tick tb = *(const sc_tick *) b;
+    return (ta > tb) - (ta < tb);
+}
+
+static bool
+bench_run(const struct bench_config *config, unsigned load_threads,
+          struct bench_media *media) {
+    struct sc_thread_policy policy = {
+        .sched = config->sched,
+        .cpu_affinity = 0,
+    };
+    if (config->pin) {
+        unsigned last_cpu = MIN(SDL_GetNumLogicalCPUCores(), 64) - 1;
+        policy.cpu_affinity = UINT64_C(1) << last_cpu;
+    }
+    sc_thread_set_policy(&policy);
+
+    sc_thread loads[BENCH_MAX_LOAD_THREADS];
+    atomic_store(&bench_stopped, false);
+
+    unsigned started;
+    for (started = 0; started < load_threads; ++started) {
+        if (!sc_thread_create(&loads[started], run_load, "bench-load",
+                              NULL)) {
+            break;
+        }
+    }
+
+    bool ok = started == load_threads;
+    if (ok) {
+        sc_thread media_thread;
+        ok = sc_thread_create(&media_thread, run_media, "bench-media", media);
+        if (ok) {
+            sc_thread_join(&media_thread, NULL);
+        }
+    }
+
+    atomic_store(&bench_stopped, true);
+    for (unsigned i = 0; i < started; ++i) {
+        sc_thread_join(&loads[i], NULL);
+    }
+
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    // Report the fallbacks, but not the debug logs
+    sc_set_log_level(SC_LOG_LEVEL_WARN);
+
+    struct bench_media *media = malloc(sizeof(*media));
+    if (!media) {
+        return 1;
+    }
+
+    if (!sc_mutex_init(&media->mutex)) {
+        free(media);
+        return 1;
+    }
+
+    if (!sc_cond_init(&media->cond)) {
+        sc_mutex_destroy(&media->mutex);
+        free(media);
+        return 1;
+    }
+
+    int cpus = SDL_GetNumLogicalCPUCores();
+    unsigned load_threads = MIN(2 * cpus, BENCH_MAX_LOAD_THREADS);
+
+    printf("%d CPUs, %u busy threads, %d wakeups every %" PRItick " us\n",
+           cpus, load_threads, BENCH_ITERATIONS, BENCH_PERIOD);
+    printf("%-20s %9s %9s %9s\n", "policy", "avg us", "p99 us", "max us");
+
+    int ret = 0;
+    for (unsigned i = 0; i < ARRAY_LEN(bench_configs); ++i) {
+        const struct bench_config *config = &bench_configs[i];
+        if (!bench_run(config, load_threads, media)) {
+            fprintf(stderr, "Could not run the benchmark (%s)\n",
+                    config->name);
+            ret = BENCH_SKIP;
+            break;
+        }
+
+        sc_tick total = 0;
+        for (unsigned j = 0; j < BENCH_ITERATIONS; ++j) {
+            total += media->delays[j];
+        }
+        qsort(media->delays, BENCH_ITERATIONS, sizeof(media->delays[0]),
+              bench_compare_ticks);
+
+        printf("%-20s %9" PRItick " %9" PRItick " %9" PRItick "\n",
+               config->name, total / BENCH_ITERATIONS,
+               media->delays[BENCH_ITERATIONS * 99 / 100],
+               media->delays[BENCH_ITERATIONS - 1]);
+    }
+
+    sc_cond_destroy(&media->cond);
+    sc_mutex_destroy(&media->mutex);
+    free(media);
+
+    return ret;
+}
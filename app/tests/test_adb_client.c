@@ -0,0 +1,235 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adb/adb.h"
+#include "adb/adb_client.h"
+#include "adb/adb_parser.h"
+#include "util/fake_adb_server.h"
+#include "util/file.h"
+#include "util/net.h"
+
+#define TEST_PORT_FIRST 27260
+#define TEST_PORT_LAST 27279
+
+#define TEST_PUSH_FILE "test_adb_client.tmp"
+#define TEST_PUSH_SIZE (200 * 1024)
+
+static void test_version_and_devices(struct fake_adb_server *server) {
+    unsigned version;
+    enum sc_adb_client_result res =
+        sc_adb_client_version(NULL, server->port, 0, &version);
+    assert(res == SC_ADB_CLIENT_OK);
+    assert(version == 41);
+
+    char *devices;
+    res = sc_adb_client_list_devices(NULL, server->port, 0, &devices);
+    assert(res == SC_ADB_CLIENT_OK);
+
+    struct sc_vec_adb_devices vec = SC_VECTOR_INITIALIZER;
+    bool ok = sc_adb_parse_devices(devices, &vec);
+    assert(ok);
+    assert(vec.size == 1);
+    assert(!strcmp(vec.data[0].serial, FAKE_ADB_SERIAL));
+    assert(!strcmp(vec.data[0].state, "device"));
+    assert(!strcmp(vec.data[0].model, "Pixel_8"));
+
+    sc_adb_devices_destroy(&vec);
+    free(devices);
+}
+
+static void test_shell(struct fake_adb_server *server) {
+    char buf[128];
+    size_t len;
+    enum sc_adb_client_result res =
+        sc_adb_client_shell(NULL, server->port, FAKE_ADB_SERIAL,
+                            "getprop ro.build.version.sdk", 0, buf,
+                            sizeof(buf) - 1, &len);
+    assert(res == SC_ADB_CLIENT_OK);
+    assert(len == 3);
+    assert(!memcmp(buf, "34\n", 3));
+
+    res = sc_adb_client_shell(NULL, server->port, FAKE_ADB_SERIAL, "ip route", 0,
+                              buf, sizeof(buf) - 1, &len);
+    assert(res == SC_ADB_CLIENT_OK);
+    buf[len] = '\0';
+    char *ip = sc_adb_parse_device_ip(buf);
+    assert(ip);
+    assert(!strcmp(ip, "192.168.1.42"));
+    free(ip);
+}
+
+static void
+write_push_file(void) {
+    FILE *file = sc_file_open(TEST_PUSH_FILE, "wb");
+    assert(file);
+    for (size_t i = 0; i < TEST_PUSH_SIZE; ++i) {
+        fputc((int) (i * 7 % 251), file);
+    }
+    fclose(file);
+}
+
+static void test_push(struct fake_adb_server *server) {
+    write_push_file();
+
+    enum sc_adb_client_result res =
+        sc_adb_client_push(NULL, server->port, FAKE_ADB_SERIAL, TEST_PUSH_FILE,
+                           "/data/local/tmp/scrcpy-server.jar", 0, NULL, NULL);
+    assert(res == SC_ADB_CLIENT_OK);
+
+    assert(!strcmp(server->push_path,
+                   "/data/local/tmp/scrcpy-server.jar,33188"));
+    assert(server->push_len == TEST_PUSH_SIZE);
+    for (size_t i = 0; i < TEST_PUSH_SIZE; ++i) {
+        assert(server->push_data[i] == i * 7 % 251);
+    }
+
+    remove(TEST_PUSH_FILE);
+}
+
+struct push_progress {
+    uint64_t last;
+    unsigned calls;
+};
+
+static void
+on_push_progress(uint64_t sent, void *userdata) {
+    struct push_progress *progress = userdata;
+    // The number of bytes sent must increase on every call
+    assert(sent > progress->last);
+    progress->last = sent;
+    ++progress->calls;
+}
+
+static void test_push_progress(struct fake_adb_server *server) {
+    write_push_file();
+
+    struct push_progress progress = {
+        .last = 0,
+        .calls = 0,
+    };
+
+    enum sc_adb_client_result res =
+        sc_adb_client_push(NULL, server->port, FAKE_ADB_SERIAL, TEST_PUSH_FILE,
+                           "/data/local/tmp/scrcpy-server.jar", 0,
+                           on_push_progress, &progress);
+    assert(res == SC_ADB_CLIENT_OK);
+
+    // The file is larger than a sync packet, so it is sent in several chunks
+    assert(progress.calls > 1);
+    assert(progress.last == TEST_PUSH_SIZE);
+    assert(server->push_len == TEST_PUSH_SIZE);
+
+    remove(TEST_PUSH_FILE);
+}
+
+static void test_push_to_dir(struct fake_adb_server *server) {
+    write_push_file();
+
+    // With a trailing '/', the remote is a directory
+    enum sc_adb_client_result res =
+        sc_adb_client_push(NULL, server->port, FAKE_ADB_SERIAL, TEST_PUSH_FILE,
+                           FAKE_ADB_DIR "/", 0, NULL, NULL);
+    assert(res == SC_ADB_CLIENT_OK);
+    assert(!strcmp(server->push_path,
+                   FAKE_ADB_DIR "/" TEST_PUSH_FILE ",33188"));
+    assert(server->push_len == TEST_PUSH_SIZE);
+
+    // Without a trailing '/', STAT tells that the remote is a directory
+    memset(server->push_path, 0, sizeof(server->push_path));
+    res = sc_adb_client_push(NULL, server->port, FAKE_ADB_SERIAL, TEST_PUSH_FILE,
+                             FAKE_ADB_DIR, 0, NULL, NULL);
+    assert(res == SC_ADB_CLIENT_OK);
+    assert(!strcmp(server->push_path,
+                   FAKE_ADB_DIR "/" TEST_PUSH_FILE ",33188"));
+    assert(server->push_len == TEST_PUSH_SIZE);
+
+    remove(TEST_PUSH_FILE);
+
+    // A local directory must be pushed by the adb process
+    res = sc_adb_client_push(NULL, server->port, FAKE_ADB_SERIAL, ".",
+                             FAKE_ADB_DIR "/", 0, NULL, NULL);
+    assert(res == SC_ADB_CLIENT_UNAVAILABLE);
+}
+
+static void test_forward_reverse(struct fake_adb_server *server) {
+    enum sc_adb_client_result res =
+        sc_adb_client_forward(NULL, server->port, FAKE_ADB_SERIAL, "tcp:27183",
+                              "localabstract:scrcpy_1234", 0);
+    assert(res == SC_ADB_CLIENT_OK);
+    assert(!strcmp(server->forward,
+                   "forward:tcp:27183;localabstract:scrcpy_1234"));
+
+    res = sc_adb_client_forward_remove(NULL, server->port, FAKE_ADB_SERIAL,
+                                       "tcp:27183", 0);
+    assert(res == SC_ADB_CLIENT_OK);
+    assert(!strcmp(server->forward, "killforward:tcp:27183"));
+
+    res = sc_adb_client_reverse(NULL, server->port, FAKE_ADB_SERIAL,
+                                "localabstract:scrcpy_1234", "tcp:27183", 0);
+    assert(res == SC_ADB_CLIENT_OK);
+    assert(!strcmp(server->reverse,
+                   "forward:localabstract:scrcpy_1234;tcp:27183"));
+
+    res = sc_adb_client_reverse_remove(NULL, server->port, FAKE_ADB_SERIAL,
+                                       "localabstract:scrcpy_1234", 0);
+    assert(res == SC_ADB_CLIENT_OK);
+    assert(!strcmp(server->reverse, "killforward:localabstract:scrcpy_1234"));
+}
+
+static void test_errors(struct fake_adb_server *server) {
+    char buf[16];
+    size_t len;
+
+    // Unknown device: the request fails, the caller must not fall back
+    enum sc_adb_client_result res =
+        sc_adb_client_shell(NULL, server->port, "unknown", "true",
+                            SC_ADB_NO_LOGERR, buf, sizeof(buf), &len);
+    assert(res == SC_ADB_CLIENT_ERROR);
+
+    // No adb server: the caller may fall back to the adb executable
+    sc_socket socket = net_socket();
+    assert(socket != SC_SOCKET_NONE);
+    uint16_t port;
+    for (port = TEST_PORT_FIRST; port <= TEST_PORT_LAST; ++port) {
+        if (port != server->port
+                && net_listen(socket, IPV4_LOCALHOST, port, 1)) {
+            break;
+        }
+    }
+    assert(port <= TEST_PORT_LAST);
+    // Close it, so that nothing listens on this port
+    net_close(socket);
+
+    unsigned version;
+    res = sc_adb_client_version(NULL, port, SC_ADB_NO_LOGERR, &version);
+    assert(res == SC_ADB_CLIENT_UNAVAILABLE);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = net_init();
+    assert(ok);
+
+    struct fake_adb_server server;
+    ok = fake_adb_server_start(&server, TEST_PORT_FIRST, TEST_PORT_LAST);
+    assert(ok);
+
+    test_version_and_devices(&server);
+    test_shell(&server);
+    test_push(&server);
+    test_push_progress(&server);
+    test_push_to_dir(&server);
+    test_forward_reverse(&server);
+    test_errors(&server);
+
+    fake_adb_server_stop(&server);
+
+    net_cleanup();
+    return 0;
+}
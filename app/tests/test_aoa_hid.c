@@ -0,0 +1,449 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "hid/hid_keyboard.h"
+#include "hid/hid_mouse.h"
+#include "usb/aoa_hid.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define ACCESSORY_REGISTER_HID 54
+#define ACCESSORY_UNREGISTER_HID 55
+#define ACCESSORY_SET_HID_REPORT_DESC 56
+#define ACCESSORY_SEND_HID_EVENT 57
+
+#define MOCK_MAX_RECORDS 64
+
+struct mock_record {
+    uint8_t request;
+    uint16_t value;
+    uint8_t data[SC_HID_MAX_SIZE];
+    uint8_t size;
+};
+
+/**
+ * Mock USB transport
+ *
+ * The submitted transfers are completed in order by a separate thread (like
+ * the libusb event thread), only when the test allows it (or on cancel).
+ */
+static struct {
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+
+    struct mock_record records[MOCK_MAX_RECORDS];
+    unsigned record_count;
+
+    struct sc_aoa_transfer *pending[SC_AOA_MAX_IN_FLIGHT];
+    unsigned pending_count;
+    unsigned max_pending_count;
+    bool cancelled;
+
+    unsigned credits; // number of transfers allowed to complete
+    unsigned completed;
+    unsigned cancelled_count;
+} mock;
+
+static void
+mock_record(uint8_t request, uint16_t value, const uint8_t *data,
+            uint8_t size) {
+    assert(mock.record_count < MOCK_MAX_RECORDS);
+    struct mock_record *record = &mock.records[mock.record_count++];
+    record->request = request;
+    record->value = value;
+    record->size = size;
+    if (data) {
+        memcpy(record->data, data, size);
+    }
+}
+
+static int
+mock_control(struct sc_aoa *aoa, uint8_t request, uint16_t value,
+             uint16_t index, unsigned char *data, uint16_t length) {
+    (void) aoa;
+    (void) index;
+    // The report descriptor is not recorded
+    (void) data;
+    (void) length;
+
+    sc_mutex_lock(&mock.mutex);
+    mock_record(request, value, NULL, 0);
+    sc_cond_broadcast(&mock.cond);
+    sc_mutex_unlock(&mock.mutex);
+    return 0;
+}
+
+static int
+mock_submit(struct sc_aoa *aoa, struct sc_aoa_transfer *transfer) {
+    (void) aoa;
+
+    sc_mutex_lock(&mock.mutex);
+    assert(mock.pending_count < SC_AOA_MAX_IN_FLIGHT);
+    mock.pending[mock.pending_count++] = transfer;
+    if (mock.pending_count > mock.max_pending_count) {
+        mock.max_pending_count = mock.pending_count;
+    }
+    mock_record(ACCESSORY_SEND_HID_EVENT, transfer->hid.hid_id,
+                transfer->hid.data, transfer->hid.size);
+    sc_cond_broadcast(&mock.cond);
+    sc_mutex_unlock(&mock.mutex);
+    return 0;
+}
+
+static void
+mock_cancel(struct sc_aoa *aoa, struct sc_aoa_transfer *transfer) {
+    (void) aoa;
+    (void) transfer;
+
+    sc_mutex_lock(&mock.mutex);
+    mock.cancelled = true;
+    sc_cond_broadcast(&mock.cond);
+    sc_mutex_unlock(&mock.mutex);
+}
+
+static const struct sc_aoa_transport_ops mock_ops = {
+    .control = mock_control,
+    .submit = mock_submit,
+    .cancel = mock_cancel,
+};
+
+static int
+run_mock(void *data) {
+    (void) data;
+
+    sc_mutex_lock(&mock.mutex);
+    for (;;) {
+        while (!mock.stopped && !(mock.pending_count
+                && (mock.credits || mock.cancelled))) {
+            sc_cond_wait(&mock.cond, &mock.mutex);
+        }
+        if (mock.stopped) {
+            break;
+        }
+
+        struct sc_aoa_transfer *transfer = mock.pending[0];
+        memmove(mock.pending, mock.pending + 1,
+                --mock.pending_count * sizeof(mock.pending[0]));
+        int result;
+        if (mock.cancelled) {
+            ++mock.cancelled_count;
+            result = LIBUSB_ERROR_INTERRUPTED;
+        } else {
+            --mock.credits;
+            ++mock.completed;
+            result = 0;
+        }
+        sc_cond_broadcast(&mock.cond);
+
+        // Complete outside the lock, like libusb
+        sc_mutex_unlock(&mock.mutex);
+        sc_aoa_transfer_completed(transfer, result);
+        sc_mutex_lock(&mock.mutex);
+    }
+    sc_mutex_unlock(&mock.mutex);
+
+    return 0;
+}
+
+static void
+mock_start(void) {
+    memset(&mock, 0, sizeof(mock));
+
+    bool ok = sc_mutex_init(&mock.mutex);
+    assert(ok);
+    ok = sc_cond_init(&mock.cond);
+    assert(ok);
+    ok = sc_thread_create(&mock.thread, run_mock, "test-mock", NULL);
+    assert(ok);
+}
+
+static void
+mock_stop(void) {
+    sc_mutex_lock(&mock.mutex);
+    mock.stopped = true;
+    sc_cond_broadcast(&mock.cond);
+    sc_mutex_unlock(&mock.mutex);
+
+    sc_thread_join(&mock.thread, NULL);
+    sc_cond_destroy(&mock.cond);
+    sc_mutex_destroy(&mock.mutex);
+}
+
+static void
+mock_allow(unsigned count) {
+    sc_mutex_lock(&mock.mutex);
+    mock.credits += count;
+    sc_cond_broadcast(&mock.cond);
+    sc_mutex_unlock(&mock.mutex);
+}
+
+static void
+mock_wait_pending(unsigned count) {
+    sc_mutex_lock(&mock.mutex);
+    while (mock.pending_count != count) {
+        sc_cond_wait(&mock.cond, &mock.mutex);
+    }
+    sc_mutex_unlock(&mock.mutex);
+}
+
+static void
+mock_wait_records(unsigned count) {
+    sc_mutex_lock(&mock.mutex);
+    while (mock.record_count < count) {
+        sc_cond_wait(&mock.cond, &mock.mutex);
+    }
+    sc_mutex_unlock(&mock.mutex);
+}
+
+static void
+mock_wait_completed(unsigned count) {
+    sc_mutex_lock(&mock.mutex);
+    while (mock.completed < count) {
+        sc_cond_wait(&mock.cond, &mock.mutex);
+    }
+    sc_mutex_unlock(&mock.mutex);
+}
+
+static const uint8_t report_desc[] = {0x05, 0x01, 0x09, 0x06};
+
+static void
+push_open(struct sc_aoa *aoa, uint16_t hid_id) {
+    struct sc_hid_open hid_open = {
+        .hid_id = hid_id,
+        .report_desc = report_desc,
+        .report_desc_size = sizeof(report_desc),
+    };
+    bool ok = sc_aoa_push_open(aoa, &hid_open, false);
+    assert(ok);
+}
+
+static void
+push_close(struct sc_aoa *aoa, uint16_t hid_id) {
+    struct sc_hid_close hid_close = {
+        .hid_id = hid_id,
+    };
+    bool ok = sc_aoa_push_close(aoa, &hid_close);
+    assert(ok);
+}
+
+static void
+push_keyboard(struct sc_aoa *aoa, uint8_t key) {
+    struct sc_hid_input hid_input = {
+        .hid_id = SC_HID_ID_KEYBOARD,
+        .data = {0, 0, key},
+        .size = 8,
+    };
+    bool ok = sc_aoa_push_input(aoa, &hid_input);
+    assert(ok);
+}
+
+static void
+push_mouse(struct sc_aoa *aoa, uint8_t buttons, int8_t x, int8_t y) {
+    struct sc_hid_input hid_input = {
+        .hid_id = SC_HID_ID_MOUSE,
+        .data = {buttons, (uint8_t) x, (uint8_t) y},
+        .size = 5,
+    };
+    bool ok = sc_aoa_push_input(aoa, &hid_input);
+    assert(ok);
+}
+
+static void
+assert_record(unsigned index, uint8_t request, uint16_t value) {
+    assert(index < mock.record_count);
+    assert(mock.records[index].request == request);
+    assert(mock.records[index].value == value);
+}
+
+static void test_in_flight_window(void) {
+    mock_start();
+
+    struct sc_aoa aoa;
+    bool ok = sc_aoa_init_with_transport(&aoa, &mock_ops, NULL);
+    assert(ok);
+
+    ok = sc_aoa_start(&aoa);
+    assert(ok);
+
+    push_open(&aoa, SC_HID_ID_KEYBOARD);
+    for (unsigned i = 0; i < 10; ++i) {
+        push_keyboard(&aoa, 4 + i);
+    }
+
+    // Several transfers are submitted without waiting for the previous ones
+    mock_wait_pending(SC_AOA_MAX_IN_FLIGHT);
+    sc_tick deadline = sc_tick_now() + SC_TICK_FROM_MS(20);
+    sc_mutex_lock(&mock.mutex);
+    while (sc_cond_timedwait(&mock.cond, &mock.mutex, deadline))
+        ;
+    // But never more than the window
+    assert(mock.pending_count == SC_AOA_MAX_IN_FLIGHT);
+    sc_mutex_unlock(&mock.mutex);
+
+    mock_allow(10);
+    mock_wait_completed(10);
+
+    // The device is unregistered only once its events are sent
+    push_close(&aoa, SC_HID_ID_KEYBOARD);
+    mock_wait_records(13);
+
+    assert(mock.record_count == 13);
+    assert_record(0, ACCESSORY_REGISTER_HID, SC_HID_ID_KEYBOARD);
+    assert_record(1, ACCESSORY_SET_HID_REPORT_DESC, SC_HID_ID_KEYBOARD);
+    for (unsigned i = 0; i < 10; ++i) {
+        // In order
+        assert_record(2 + i, ACCESSORY_SEND_HID_EVENT, SC_HID_ID_KEYBOARD);
+        assert(mock.records[2 + i].data[2] == 4 + i);
+    }
+    assert_record(12, ACCESSORY_UNREGISTER_HID, SC_HID_ID_KEYBOARD);
+    assert(mock.max_pending_count == SC_AOA_MAX_IN_FLIGHT);
+
+    sc_aoa_stop(&aoa);
+    sc_aoa_join(&aoa);
+    sc_aoa_destroy(&aoa);
+
+    mock_stop();
+}
+
+static void test_coalesce_mouse(void) {
+    mock_start();
+
+    struct sc_aoa aoa;
+    bool ok = sc_aoa_init_with_transport(&aoa, &mock_ops, NULL);
+    assert(ok);
+
+    ok = sc_aoa_start(&aoa);
+    assert(ok);
+
+    push_open(&aoa, SC_HID_ID_KEYBOARD);
+    push_open(&aoa, SC_HID_ID_MOUSE);
+
+    // Fill the window, and block the AOA thread on the next event
+    for (unsigned i = 0; i < SC_AOA_MAX_IN_FLIGHT + 1; ++i) {
+        push_keyboard(&aoa, 4 + i);
+    }
+    mock_wait_pending(SC_AOA_MAX_IN_FLIGHT);
+
+    // The mouse reports are queued, so they are merged when possible
+    push_mouse(&aoa, 0, 10, 5);
+    push_mouse(&aoa, 0, 20, -3); // merged
+    push_mouse(&aoa, 1, 0, 0); // button pressed: not merged
+    push_mouse(&aoa, 1, 1, 1); // merged
+    push_mouse(&aoa, 0, 0, 0); // button released: not merged
+    push_mouse(&aoa, 0, 100, 0); // merged
+    push_mouse(&aoa, 0, 100, 0); // overflow: not merged
+    // Only consecutive mouse reports may be merged
+    push_keyboard(&aoa, 42);
+    push_mouse(&aoa, 0, -1, 0);
+
+    unsigned events = SC_AOA_MAX_IN_FLIGHT + 1 + 4 + 1 + 1;
+    mock_allow(events);
+    mock_wait_completed(events);
+
+    // 2 devices opened (2 records each)
+    unsigned first = 4 + SC_AOA_MAX_IN_FLIGHT + 1;
+    assert(mock.record_count == first + 6);
+
+    static const int8_t expected[][3] = {
+        {0, 30, 2},
+        {1, 1, 1},
+        {0, 100, 0},
+        {0, 100, 0},
+    };
+    for (unsigned i = 0; i < ARRAY_LEN(expected); ++i) {
+        const struct mock_record *record = &mock.records[first + i];
+        assert(record->request == ACCESSORY_SEND_HID_EVENT);
+        assert(record->value == SC_HID_ID_MOUSE);
+        assert(record->size == 5);
+        assert(record->data[0] == (uint8_t) expected[i][0]);
+        assert((int8_t) record->data[1] == expected[i][1]);
+        assert((int8_t) record->data[2] == expected[i][2]);
+    }
+    assert_record(first + 4, ACCESSORY_SEND_HID_EVENT, SC_HID_ID_KEYBOARD);
+    assert(mock.records[first + 4].data[2] == 42);
+    assert_record(first + 5, ACCESSORY_SEND_HID_EVENT, SC_HID_ID_MOUSE);
+    assert((int8_t) mock.records[first + 5].data[1] == -1);
+
+    sc_aoa_stop(&aoa);
+    sc_aoa_join(&aoa);
+    sc_aoa_destroy(&aoa);
+
+    mock_stop();
+}
+
+static void test_stop_in_flight(void) {
+    mock_start();
+
+    struct sc_aoa aoa;
+    bool ok = sc_aoa_init_with_transport(&aoa, &mock_ops, NULL);
+    assert(ok);
+
+    ok = sc_aoa_start(&aoa);
+    assert(ok);
+
+    push_open(&aoa, SC_HID_ID_KEYBOARD);
+    for (unsigned i = 0; i < 8; ++i) {
+        push_keyboard(&aoa, 4 + i);
+    }
+    mock_wait_pending(SC_AOA_MAX_IN_FLIGHT);
+
+    // The device never completes the transfers: they must be cancelled
+    sc_aoa_stop(&aoa);
+    sc_aoa_join(&aoa);
+
+    assert(mock.cancelled_count == SC_AOA_MAX_IN_FLIGHT);
+    assert(!mock.completed);
+    // The device is unregistered on exit
+    assert_record(mock.record_count - 1, ACCESSORY_UNREGISTER_HID,
+                  SC_HID_ID_KEYBOARD);
+
+    sc_aoa_destroy(&aoa);
+
+    mock_stop();
+}
+
+static void test_merge_mouse_input(void) {
+    struct sc_hid_input a = {
+        .hid_id = SC_HID_ID_MOUSE,
+        .data = {0, (uint8_t) -100, 0, 1, 0},
+        .size = 5,
+    };
+    struct sc_hid_input b = {
+        .hid_id = SC_HID_ID_MOUSE,
+        .data = {0, (uint8_t) -27, 3, 1, (uint8_t) -1},
+        .size = 5,
+    };
+
+    bool ok = sc_hid_mouse_merge_input(&a, &b);
+    assert(ok);
+    assert((int8_t) a.data[1] == -127);
+    assert(a.data[2] == 3);
+    assert(a.data[3] == 2);
+    assert((int8_t) a.data[4] == -1);
+
+    // -128 is not a valid value
+    ok = sc_hid_mouse_merge_input(&a, &b);
+    assert(!ok);
+    assert((int8_t) a.data[1] == -127);
+    assert(a.data[2] == 3);
+
+    b.data[0] = 1;
+    b.data[1] = 0;
+    ok = sc_hid_mouse_merge_input(&a, &b);
+    assert(!ok);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_in_flight_window();
+    test_coalesce_mouse();
+    test_stop_in_flight();
+    test_merge_mouse_input();
+    return 0;
+}
@@ -135,6 +135,48 @@ static void test_float_to_i16fp(void) {
     assert(sc_float_to_i16fp(-1.0f) == -0x8000);
 }
 
+static void test_varint(void) {
+    uint8_t buf[SC_VARINT_MAX_SIZE];
+
+    size_t len = sc_write_varint(buf, 0);
+    assert(len == 1);
+    assert(buf[0] == 0);
+
+    len = sc_write_varint(buf, 300);
+    assert(len == 2);
+    assert(buf[0] == 0xAC);
+    assert(buf[1] == 0x02);
+
+    uint64_t value;
+    size_t r = sc_read_varint(buf, len, &value);
+    assert(r == 2);
+    assert(value == 300);
+
+    // Truncated
+    r = sc_read_varint(buf, 1, &value);
+    assert(r == 0);
+
+    len = sc_write_varint(buf, UINT64_MAX);
+    assert(len == SC_VARINT_MAX_SIZE);
+    r = sc_read_varint(buf, len, &value);
+    assert(r == SC_VARINT_MAX_SIZE);
+    assert(value == UINT64_MAX);
+}
+
+static void test_zigzag(void) {
+    assert(sc_zigzag_encode(0) == 0);
+    assert(sc_zigzag_encode(-1) == 1);
+    assert(sc_zigzag_encode(1) == 2);
+    assert(sc_zigzag_encode(-2) == 3);
+    assert(sc_zigzag_encode(INT64_MAX) == UINT64_MAX - 1);
+    assert(sc_zigzag_encode(INT64_MIN) == UINT64_MAX);
+
+    int64_t values[] = {0, 1, -1, 63, -64, 64, INT32_MIN, INT64_MAX, INT64_MIN};
+    for (size_t i = 0; i < ARRAY_LEN(values); ++i) {
+        assert(sc_zigzag_decode(sc_zigzag_encode(values[i])) == values[i]);
+    }
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -152,5 +194,8 @@ int main(int argc, char *argv[]) {
 
     test_float_to_u16fp();
     test_float_to_i16fp();
+
+    test_varint();
+    test_zigzag();
     return 0;
 }
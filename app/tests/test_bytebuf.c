@@ -0,0 +1,107 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/bytebuf.h"
+
+static void
+write_all(struct sc_bytebuf *buf, const uint8_t *data, size_t len) {
+    while (len) {
+        size_t can_write;
+        uint8_t *ptr = sc_bytebuf_prepare_write(buf, &can_write);
+        assert(can_write);
+        size_t n = MIN(len, can_write);
+        memcpy(ptr, data, n);
+        sc_bytebuf_commit_write(buf, n);
+        data += n;
+        len -= n;
+    }
+}
+
+static void test_bytebuf_simple(void) {
+    struct sc_bytebuf buf;
+
+    bool ok = sc_bytebuf_init(&buf, 20);
+    assert(ok);
+    assert(sc_bytebuf_capacity(&buf) == 20);
+    assert(sc_bytebuf_can_read(&buf) == 0);
+    assert(sc_bytebuf_can_write(&buf) == 20);
+
+    const uint8_t data[] = "hello";
+    write_all(&buf, data, 5);
+    assert(sc_bytebuf_can_read(&buf) == 5);
+    assert(sc_bytebuf_can_write(&buf) == 15);
+
+    const uint8_t *part1;
+    const uint8_t *part2;
+    size_t len1;
+    size_t len2;
+    sc_bytebuf_read_parts(&buf, &part1, &len1, &part2, &len2);
+    assert(len1 == 5);
+    assert(!memcmp(part1, "hello", 5));
+    assert(len2 == 0);
+
+    sc_bytebuf_skip(&buf, 2);
+    assert(sc_bytebuf_can_read(&buf) == 3);
+
+    sc_bytebuf_read_parts(&buf, &part1, &len1, &part2, &len2);
+    assert(len1 == 3);
+    assert(!memcmp(part1, "llo", 3));
+    assert(len2 == 0);
+
+    sc_bytebuf_destroy(&buf);
+}
+
+static void test_bytebuf_boundaries(void) {
+    struct sc_bytebuf buf;
+
+    bool ok = sc_bytebuf_init(&buf, 20);
+    assert(ok);
+
+    const uint8_t data[] = "0123456789abcdefghij";
+    write_all(&buf, data, 15);
+    sc_bytebuf_skip(&buf, 15);
+    assert(sc_bytebuf_can_read(&buf) == 0);
+
+    // The contiguous writable area stops at the end of the array
+    size_t len;
+    sc_bytebuf_prepare_write(&buf, &len);
+    assert(len == 6);
+
+    // Fill the buffer, wrapping around the end of the array
+    write_all(&buf, data, 20);
+    assert(sc_bytebuf_can_read(&buf) == 20);
+    assert(sc_bytebuf_can_write(&buf) == 0);
+
+    sc_bytebuf_prepare_write(&buf, &len);
+    assert(len == 0);
+
+    const uint8_t *part1;
+    const uint8_t *part2;
+    size_t len1;
+    size_t len2;
+    sc_bytebuf_read_parts(&buf, &part1, &len1, &part2, &len2);
+    assert(len1 == 6);
+    assert(!memcmp(part1, "012345", 6));
+    assert(len2 == 14);
+    assert(!memcmp(part2, "6789abcdefghij", 14));
+
+    sc_bytebuf_skip(&buf, 10);
+    sc_bytebuf_read_parts(&buf, &part1, &len1, &part2, &len2);
+    assert(len1 == 10);
+    assert(!memcmp(part1, "abcdefghij", 10));
+    assert(len2 == 0);
+
+    sc_bytebuf_destroy(&buf);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_bytebuf_simple();
+    test_bytebuf_boundaries();
+
+    return 0;
+}
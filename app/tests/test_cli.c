@@ -121,6 +121,74 @@ static void test_options2(void) {
     assert(opts->record_format == SC_RECORD_FORMAT_MP4);
 }
 
+static void test_serials(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {
+        "scrcpy",
+        "--serials", "0123456789abcdef,192.168.1.2:5555",
+    };
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(!strcmp(args.opts.serials, "0123456789abcdef,192.168.1.2:5555"));
+    assert(!args.opts.serial);
+
+    // Empty serial
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--serials", "0123456789abcdef,"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+
+    // Incompatible with a device selector
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--serials", "abc,def", "-s", "abc"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+
+    // Incompatible with recording
+    args.opts = scrcpy_options_default;
+    char *argv4[] = {"scrcpy", "--serials", "abc,def", "--record", "f.mp4"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv4), argv4);
+    assert(!ok);
+
+    // Incompatible with frame pacing
+    args.opts = scrcpy_options_default;
+    char *argv8[] = {"scrcpy", "--serials", "abc,def", "--frame-pacing=50"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv8), argv8);
+    assert(!ok);
+
+    // Incompatible with late latching
+    args.opts = scrcpy_options_default;
+    char *argv9[] = {"scrcpy", "--serials", "abc,def", "--late-latch"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv9), argv9);
+    assert(!ok);
+
+    // Video wall
+    args.opts = scrcpy_options_default;
+    char *argv5[] = {"scrcpy", "--serials", "abc,def", "--video-wall"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv5), argv5);
+    assert(ok);
+    assert(args.opts.video_wall);
+
+    // The video wall requires --serials
+    args.opts = scrcpy_options_default;
+    char *argv6[] = {"scrcpy", "--video-wall"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv6), argv6);
+    assert(!ok);
+
+    // The video wall requires video playback
+    args.opts = scrcpy_options_default;
+    char *argv7[] = {"scrcpy", "--serials", "abc,def", "--video-wall",
+                     "--no-window"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv7), argv7);
+    assert(!ok);
+}
+
 static void test_parse_shortcut_mods(void) {
     uint8_t mods;
     bool ok;
@@ -149,6 +217,87 @@ static void test_parse_shortcut_mods(void) {
     assert(!ok);
 }
 
+static void test_parse_socket_tuning(void) {
+    struct sc_socket_tuning tuning;
+    bool ok;
+
+    ok = sc_parse_socket_tuning("rcvbuf=4M", &tuning);
+    assert(ok);
+    assert(tuning.recv_buffer_size == 4000000);
+    assert(!tuning.send_buffer_size);
+    assert(!tuning.recv_lowat);
+    assert(!tuning.busy_poll);
+    assert(!tuning.quickack);
+
+    ok = sc_parse_socket_tuning("sndbuf=64K,rcvlowat=1024,busy-poll=50,"
+                                "quickack", &tuning);
+    assert(ok);
+    assert(!tuning.recv_buffer_size);
+    assert(tuning.send_buffer_size == 64000);
+    assert(tuning.recv_lowat == 1024);
+    assert(tuning.busy_poll == 50);
+    assert(tuning.quickack);
+
+    ok = sc_parse_socket_tuning("", &tuning);
+    assert(!ok);
+
+    ok = sc_parse_socket_tuning("rcvbuf", &tuning);
+    assert(!ok);
+
+    ok = sc_parse_socket_tuning("rcvbuf=", &tuning);
+    assert(!ok);
+
+    ok = sc_parse_socket_tuning("rcvbuf=0", &tuning);
+    assert(!ok);
+
+    ok = sc_parse_socket_tuning("quickack=1", &tuning);
+    assert(!ok);
+
+    ok = sc_parse_socket_tuning("busy-poll=1K", &tuning);
+    assert(!ok);
+
+    ok = sc_parse_socket_tuning("rcvbuf=1M,", &tuning);
+    assert(!ok);
+
+    ok = sc_parse_socket_tuning("nodelay", &tuning);
+    assert(!ok);
+}
+
+static void test_parse_cpu_affinity(void) {
+    uint64_t mask;
+    bool ok;
+
+    ok = sc_parse_cpu_affinity("0", &mask);
+    assert(ok);
+    assert(mask == 0x1);
+
+    ok = sc_parse_cpu_affinity("2,4-7", &mask);
+    assert(ok);
+    assert(mask == 0xF4);
+
+    ok = sc_parse_cpu_affinity("63,1-1", &mask);
+    assert(ok);
+    assert(mask == (UINT64_C(1) << 63 | 0x2));
+
+    ok = sc_parse_cpu_affinity("", &mask);
+    assert(!ok);
+
+    ok = sc_parse_cpu_affinity("1,", &mask);
+    assert(!ok);
+
+    ok = sc_parse_cpu_affinity("64", &mask);
+    assert(!ok);
+
+    ok = sc_parse_cpu_affinity("3-1", &mask);
+    assert(!ok);
+
+    ok = sc_parse_cpu_affinity("1-", &mask);
+    assert(!ok);
+
+    ok = sc_parse_cpu_affinity("a", &mask);
+    assert(!ok);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -157,6 +306,9 @@ int main(int argc, char *argv[]) {
     test_flag_help();
     test_options();
     test_options2();
+    test_serials();
     test_parse_shortcut_mods();
+    test_parse_socket_tuning();
+    test_parse_cpu_affinity();
     return 0;
 }
@@ -2,9 +2,11 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "control_msg.h"
+#include "util/binary.h"
 
 static void test_serialize_inject_keycode(void) {
     struct sc_control_msg msg = {
@@ -495,6 +497,317 @@ static void test_serialize_camera_zoom_out(void) {
     assert(!memcmp(buf, expected, sizeof(expected)));
 }
 
+static void test_serialize_latency_probe(void) {
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_LATENCY_PROBE,
+        .latency_probe = {
+            .sequence = UINT64_C(0x0102030405060708),
+        },
+    };
+
+    uint8_t buf[SC_CONTROL_MSG_MAX_SIZE];
+    size_t size = sc_control_msg_serialize(&msg, buf);
+    assert(size == 9);
+
+    const uint8_t expected[] = {
+        SC_CONTROL_MSG_TYPE_LATENCY_PROBE,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // sequence
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static struct sc_control_msg
+make_touch_msg(enum android_motionevent_action action, uint64_t pointer_id,
+               int32_t x, int32_t y) {
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = action,
+            .pointer_id = pointer_id,
+            .position = {
+                .point = {
+                    .x = x,
+                    .y = y,
+                },
+                .screen_size = {
+                    .width = 1080,
+                    .height = 1920,
+                },
+            },
+            .pressure = action == AMOTION_EVENT_ACTION_UP ? 0.0f : 1.0f,
+            .action_button = 0,
+            .buttons = 0,
+        },
+    };
+    return msg;
+}
+
+static void test_serialize_inject_touch_event_compact(void) {
+    struct sc_control_msg_encoder encoder;
+    sc_control_msg_encoder_init(&encoder);
+
+    struct sc_control_msg msg =
+        make_touch_msg(AMOTION_EVENT_ACTION_DOWN, -42, 100, 200);
+    msg.inject_touch_event.action_button = AMOTION_EVENT_BUTTON_PRIMARY;
+    msg.inject_touch_event.buttons = AMOTION_EVENT_BUTTON_PRIMARY;
+
+    uint8_t buf[SC_CONTROL_MSG_MAX_SIZE];
+    size_t size = sc_control_msg_serialize_compact(&msg, &encoder, buf);
+    assert(size == 16);
+
+    const uint8_t expected_down[] = {
+        SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT_COMPACT,
+        0xf0 | AMOTION_EVENT_ACTION_DOWN, // all flags
+        0x00, // slot
+        83, // pointer id -42 (zigzag)
+        0xc8, 0x01, 0x90, 0x03, // dx = 100, dy = 200
+        0xb8, 0x08, 0x80, 0x0f, // 1080x1920
+        0xff, 0xff, // pressure
+        0x01, 0x01, // action button, buttons
+    };
+    assert(!memcmp(buf, expected_down, sizeof(expected_down)));
+
+    msg = make_touch_msg(AMOTION_EVENT_ACTION_MOVE, -42, 103, 195);
+    msg.inject_touch_event.action_button = AMOTION_EVENT_BUTTON_PRIMARY;
+    msg.inject_touch_event.buttons = AMOTION_EVENT_BUTTON_PRIMARY;
+
+    size = sc_control_msg_serialize_compact(&msg, &encoder, buf);
+    assert(size == 5);
+
+    const uint8_t expected_move[] = {
+        SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT_COMPACT,
+        AMOTION_EVENT_ACTION_MOVE,
+        0x00, // slot
+        6, 9, // dx = 3, dy = -5
+    };
+    assert(!memcmp(buf, expected_move, sizeof(expected_move)));
+
+    // Other messages are serialized normally
+    msg.type = SC_CONTROL_MSG_TYPE_ROTATE_DEVICE;
+    size = sc_control_msg_serialize_compact(&msg, &encoder, buf);
+    assert(size == 1);
+    assert(buf[0] == SC_CONTROL_MSG_TYPE_ROTATE_DEVICE);
+}
+
+struct compact_decoder {
+    struct sc_control_msg_pointer_state pointers[
+        SC_CONTROL_MSG_COMPACT_POINTERS];
+};
+
+static size_t
+read_varint(const uint8_t *buf, size_t len, uint64_t *value) {
+    size_t r = sc_read_varint(buf, len, value);
+    assert(r);
+    return r;
+}
+
+// Decode a compact touch event, like the server
+static size_t
+decode_compact(struct compact_decoder *decoder, const uint8_t *buf, size_t len,
+               struct sc_control_msg *msg) {
+    assert(len >= 3);
+    assert(buf[0] == SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT_COMPACT);
+    uint8_t header = buf[1];
+    uint8_t slot = buf[2];
+    assert(slot < SC_CONTROL_MSG_COMPACT_POINTERS);
+    size_t i = 3;
+
+    struct sc_control_msg_pointer_state *state = &decoder->pointers[slot];
+    uint64_t v;
+    if (header & 0x10) {
+        memset(state, 0, sizeof(*state));
+        i += read_varint(&buf[i], len - i, &v);
+        state->pointer_id = (uint64_t) sc_zigzag_decode(v);
+    }
+    i += read_varint(&buf[i], len - i, &v);
+    state->x += (int32_t) sc_zigzag_decode(v);
+    i += read_varint(&buf[i], len - i, &v);
+    state->y += (int32_t) sc_zigzag_decode(v);
+    if (header & 0x20) {
+        i += read_varint(&buf[i], len - i, &v);
+        state->screen_width = v;
+        i += read_varint(&buf[i], len - i, &v);
+        state->screen_height = v;
+    }
+    if (header & 0x40) {
+        assert(len - i >= 2);
+        state->pressure = sc_read16be(&buf[i]);
+        i += 2;
+    }
+    if (header & 0x80) {
+        i += read_varint(&buf[i], len - i, &v);
+        state->action_button = v;
+        i += read_varint(&buf[i], len - i, &v);
+        state->buttons = v;
+    }
+
+    msg->type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT;
+    msg->inject_touch_event.action = header & 0x0f;
+    msg->inject_touch_event.pointer_id = state->pointer_id;
+    msg->inject_touch_event.position.point.x = state->x;
+    msg->inject_touch_event.position.point.y = state->y;
+    msg->inject_touch_event.position.screen_size.width = state->screen_width;
+    msg->inject_touch_event.position.screen_size.height = state->screen_height;
+    msg->inject_touch_event.pressure =
+        state->pressure == 0xffff ? 1.0f : state->pressure / 65536.0f;
+    msg->inject_touch_event.action_button = state->action_button;
+    msg->inject_touch_event.buttons = state->buttons;
+
+    return i;
+}
+
+static void
+assert_compact_round_trip(struct sc_control_msg_encoder *encoder,
+                          struct compact_decoder *decoder,
+                          const struct sc_control_msg *msg, size_t *full_size,
+                          size_t *compact_size) {
+    uint8_t buf[SC_CONTROL_MSG_MAX_SIZE];
+    *full_size += sc_control_msg_serialize(msg, buf);
+
+    size_t size = sc_control_msg_serialize_compact(msg, encoder, buf);
+    *compact_size += size;
+
+    struct sc_control_msg decoded;
+    size_t r = decode_compact(decoder, buf, size, &decoded);
+    assert(r == size);
+
+#define ASSERT_FIELD_EQ(FIELD) \
+    assert(msg->inject_touch_event.FIELD == decoded.inject_touch_event.FIELD)
+    ASSERT_FIELD_EQ(action);
+    ASSERT_FIELD_EQ(pointer_id);
+    ASSERT_FIELD_EQ(position.point.x);
+    ASSERT_FIELD_EQ(position.point.y);
+    ASSERT_FIELD_EQ(position.screen_size.width);
+    ASSERT_FIELD_EQ(position.screen_size.height);
+    ASSERT_FIELD_EQ(pressure);
+    ASSERT_FIELD_EQ(action_button);
+    ASSERT_FIELD_EQ(buttons);
+#undef ASSERT_FIELD_EQ
+}
+
+static void test_compact_multi_touch_gesture(void) {
+    struct sc_control_msg_encoder encoder;
+    sc_control_msg_encoder_init(&encoder);
+    struct compact_decoder decoder;
+    memset(&decoder, 0, sizeof(decoder));
+
+    size_t full_size = 0;
+    size_t compact_size = 0;
+    unsigned count = 0;
+
+    // A pinch-to-zoom gesture with two fingers
+    struct sc_control_msg msg;
+    msg = make_touch_msg(AMOTION_EVENT_ACTION_DOWN,
+                         SC_POINTER_ID_GENERIC_FINGER, 540, 960);
+    assert_compact_round_trip(&encoder, &decoder, &msg, &full_size,
+                              &compact_size);
+    msg = make_touch_msg(AMOTION_EVENT_ACTION_DOWN,
+                         SC_POINTER_ID_VIRTUAL_FINGER, 540, 960);
+    assert_compact_round_trip(&encoder, &decoder, &msg, &full_size,
+                              &compact_size);
+    count += 2;
+
+    for (int i = 1; i <= 100; ++i) {
+        msg = make_touch_msg(AMOTION_EVENT_ACTION_MOVE,
+                             SC_POINTER_ID_GENERIC_FINGER, 540 - 3 * i,
+                             960 - 5 * i);
+        assert_compact_round_trip(&encoder, &decoder, &msg, &full_size,
+                                  &compact_size);
+        msg = make_touch_msg(AMOTION_EVENT_ACTION_MOVE,
+                             SC_POINTER_ID_VIRTUAL_FINGER, 540 + 3 * i,
+                             960 + 5 * i);
+        assert_compact_round_trip(&encoder, &decoder, &msg, &full_size,
+                                  &compact_size);
+        count += 2;
+    }
+
+    msg = make_touch_msg(AMOTION_EVENT_ACTION_UP,
+                         SC_POINTER_ID_GENERIC_FINGER, 240, 460);
+    assert_compact_round_trip(&encoder, &decoder, &msg, &full_size,
+                              &compact_size);
+    msg = make_touch_msg(AMOTION_EVENT_ACTION_UP,
+                         SC_POINTER_ID_VIRTUAL_FINGER, 840, 1460);
+    assert_compact_round_trip(&encoder, &decoder, &msg, &full_size,
+                              &compact_size);
+    count += 2;
+
+    assert(full_size == count * 32);
+    // A move event of a few pixels takes 5 bytes
+    assert(compact_size < full_size / 5);
+
+    fprintf(stderr, "Touch events: %.1f bytes/event (compact) vs %.1f "
+                    "bytes/event (full)\n",
+            (double) compact_size / count, (double) full_size / count);
+}
+
+static void test_compact_many_pointers(void) {
+    struct sc_control_msg_encoder encoder;
+    sc_control_msg_encoder_init(&encoder);
+    struct compact_decoder decoder;
+    memset(&decoder, 0, sizeof(decoder));
+
+    size_t full_size = 0;
+    size_t compact_size = 0;
+
+    // More pointers than slots: the slots are reused
+    for (int i = 0; i < 3 * SC_CONTROL_MSG_COMPACT_POINTERS; ++i) {
+        struct sc_control_msg msg =
+            make_touch_msg(AMOTION_EVENT_ACTION_MOVE, i, 10 * i, -i);
+        assert_compact_round_trip(&encoder, &decoder, &msg, &full_size,
+                                  &compact_size);
+        msg = make_touch_msg(AMOTION_EVENT_ACTION_MOVE, i, 10 * i + 1, -i);
+        assert_compact_round_trip(&encoder, &decoder, &msg, &full_size,
+                                  &compact_size);
+    }
+
+    assert(encoder.pointer_count == SC_CONTROL_MSG_COMPACT_POINTERS);
+}
+
+static void test_serialize_fragment(void) {
+    const uint8_t data[] = {0x01, 0x02, 0x03};
+
+    uint8_t buf[SC_CONTROL_MSG_FRAGMENT_MAX_SIZE];
+    size_t size = sc_control_msg_serialize_fragment(data, sizeof(data), true,
+                                                    buf);
+    assert(size == 7);
+
+    const uint8_t expected[] = {
+        SC_CONTROL_MSG_TYPE_FRAGMENT,
+        0x01, // last
+        0x00, 0x03, // length
+        0x01, 0x02, 0x03, // payload
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_is_bulk(void) {
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_SET_CLIPBOARD,
+        .set_clipboard = {
+            .sequence = 0,
+            .text = "hello",
+            .paste = true,
+        },
+    };
+    // Pasted on the device without acknowledgement
+    assert(!sc_control_msg_is_bulk(&msg));
+
+    msg.set_clipboard.sequence = 1;
+    assert(sc_control_msg_is_bulk(&msg));
+
+    msg.set_clipboard.sequence = 0;
+    msg.set_clipboard.paste = false;
+    assert(sc_control_msg_is_bulk(&msg));
+
+    msg.type = SC_CONTROL_MSG_TYPE_INJECT_TEXT;
+    msg.inject_text.text = "hello";
+    assert(!sc_control_msg_is_bulk(&msg));
+
+    msg.type = SC_CONTROL_MSG_TYPE_START_APP;
+    msg.start_app.name = "firefox";
+    assert(sc_control_msg_is_bulk(&msg));
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -522,5 +835,11 @@ int main(int argc, char *argv[]) {
     test_serialize_camera_set_torch();
     test_serialize_camera_zoom_in();
     test_serialize_camera_zoom_out();
+    test_serialize_latency_probe();
+    test_serialize_inject_touch_event_compact();
+    test_compact_multi_touch_gesture();
+    test_compact_many_pointers();
+    test_serialize_fragment();
+    test_is_bulk();
     return 0;
 }
@@ -0,0 +1,342 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "controller.h"
+#include "util/binary.h"
+#include "util/net.h"
+#include "util/socket_pair.h"
+
+#define TEST_PORT_FIRST 27220
+#define TEST_PORT_LAST 27239
+
+static void
+on_controller_ended(struct sc_controller *controller, bool error,
+                    void *userdata) {
+    (void) controller;
+    (void) error;
+    (void) userdata;
+}
+
+static const struct sc_controller_callbacks controller_cbs = {
+    .on_ended = on_controller_ended,
+};
+
+static struct sc_control_msg
+make_touch_msg(int32_t x, int32_t y) {
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = AMOTION_EVENT_ACTION_MOVE,
+            .pointer_id = SC_POINTER_ID_GENERIC_FINGER,
+            .position = {
+                .point = {
+                    .x = x,
+                    .y = y,
+                },
+                .screen_size = {
+                    .width = 1080,
+                    .height = 1920,
+                },
+            },
+            .pressure = 1.0f,
+            .action_button = 0,
+            .buttons = 0,
+        },
+    };
+    return msg;
+}
+
+static void
+start_controller(struct sc_controller *controller, sc_socket socket) {
+    bool ok = sc_controller_init(controller, socket, &controller_cbs, NULL);
+    assert(ok);
+
+    ok = sc_controller_start(controller);
+    assert(ok);
+}
+
+static void
+stop_controller(struct sc_controller *controller, sc_socket socket) {
+    sc_controller_stop(controller);
+    // Also wake up the receiver
+    net_interrupt(socket);
+    sc_controller_join(controller);
+    sc_controller_destroy(controller);
+}
+
+static void test_batch_order(void) {
+    sc_socket sock;
+    sc_socket peer;
+    bool ok = create_socket_pair(&sock, &peer, TEST_PORT_FIRST,
+                                 TEST_PORT_LAST);
+    assert(ok);
+
+    struct sc_controller controller;
+    start_controller(&controller, sock);
+
+    // Keep a copy of the expected serialized stream
+    size_t expected_len = 0;
+    uint8_t *expected = malloc(4 * SC_CONTROL_MSG_MAX_SIZE);
+    assert(expected);
+
+    // A burst of small messages, a large one (which does not fit in the
+    // current batch), then small messages again
+    for (int i = 0; i < 40; ++i) {
+        struct sc_control_msg msg;
+        if (i == 20) {
+            size_t len = SC_CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH;
+            char *text = malloc(len + 1);
+            assert(text);
+            memset(text, 'a' + i % 26, len);
+            text[len] = '\0';
+
+            // With the paste flag but without sequence, SET_CLIPBOARD is not
+            // a bulk message (it must not be reordered)
+            msg.type = SC_CONTROL_MSG_TYPE_SET_CLIPBOARD;
+            msg.set_clipboard.sequence = SC_SEQUENCE_INVALID;
+            msg.set_clipboard.text = text;
+            msg.set_clipboard.paste = true;
+        } else {
+            msg = make_touch_msg(i, 2 * i);
+        }
+
+        expected_len +=
+            sc_control_msg_serialize(&msg, &expected[expected_len]);
+
+        // The queue limit is never reached, so no message may be dropped
+        ok = sc_controller_push_msg(&controller, &msg);
+        assert(ok);
+    }
+
+    uint8_t *received = malloc(expected_len);
+    assert(received);
+
+    ssize_t r = net_recv_all(peer, received, expected_len);
+    assert(r == (ssize_t) expected_len);
+    assert(!memcmp(received, expected, expected_len));
+
+    free(received);
+    free(expected);
+
+    stop_controller(&controller, sock);
+    net_close(sock);
+    net_close(peer);
+}
+
+static void test_bulk_interleaving(void) {
+    sc_socket sock;
+    sc_socket peer;
+    bool ok = create_socket_pair(&sock, &peer, TEST_PORT_FIRST,
+                                 TEST_PORT_LAST);
+    assert(ok);
+
+    struct sc_controller controller;
+    ok = sc_controller_init(&controller, sock, &controller_cbs, NULL);
+    assert(ok);
+
+    size_t text_len = SC_CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH;
+    char *text = malloc(text_len + 1);
+    assert(text);
+    for (size_t i = 0; i < text_len; ++i) {
+        text[i] = 'a' + i % 26;
+    }
+    text[text_len] = '\0';
+
+    struct sc_control_msg clipboard_msg = {
+        .type = SC_CONTROL_MSG_TYPE_SET_CLIPBOARD,
+        .set_clipboard = {
+            .sequence = 42,
+            .text = text,
+            .paste = true,
+        },
+    };
+    assert(sc_control_msg_is_bulk(&clipboard_msg));
+
+    uint8_t *expected = malloc(SC_CONTROL_MSG_MAX_SIZE);
+    assert(expected);
+    size_t expected_len = sc_control_msg_serialize(&clipboard_msg, expected);
+
+    // Push the messages before starting the controller, so that they are all
+    // pending on the first iteration
+    ok = sc_controller_push_msg(&controller, &clipboard_msg);
+    assert(ok);
+
+    struct sc_control_msg touch_msg = make_touch_msg(100, 200);
+    ok = sc_controller_push_msg(&controller, &touch_msg);
+    assert(ok);
+
+    ok = sc_controller_start(&controller);
+    assert(ok);
+
+    // The touch event, pushed after the clipboard, must be received first
+    uint8_t touch[32];
+    ssize_t r = net_recv_all(peer, touch, sizeof(touch));
+    assert(r == sizeof(touch));
+    assert(touch[0] == SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+
+    uint8_t *reassembled = malloc(SC_CONTROL_MSG_MAX_SIZE);
+    assert(reassembled);
+    size_t reassembled_len = 0;
+
+    unsigned fragment_count = 0;
+    bool last = false;
+    while (!last) {
+        uint8_t header[4];
+        r = net_recv_all(peer, header, sizeof(header));
+        assert(r == sizeof(header));
+        assert(header[0] == SC_CONTROL_MSG_TYPE_FRAGMENT);
+
+        last = header[1];
+        size_t len = sc_read16be(&header[2]);
+        assert(len <= SC_CONTROL_MSG_FRAGMENT_MAX_PAYLOAD_SIZE);
+        assert(reassembled_len + len <= expected_len);
+
+        r = net_recv_all(peer, &reassembled[reassembled_len], len);
+        assert(r == (ssize_t) len);
+        reassembled_len += len;
+        ++fragment_count;
+    }
+
+    assert(fragment_count > 1);
+    assert(reassembled_len == expected_len);
+    assert(!memcmp(reassembled, expected, expected_len));
+
+    free(reassembled);
+    free(expected);
+
+    stop_controller(&controller, sock);
+    net_close(sock);
+    net_close(peer);
+}
+
+static void test_paste_order(void) {
+    sc_socket sock;
+    sc_socket peer;
+    bool ok = create_socket_pair(&sock, &peer, TEST_PORT_FIRST,
+                                 TEST_PORT_LAST);
+    assert(ok);
+
+    struct sc_controller controller;
+    ok = sc_controller_init(&controller, sock, &controller_cbs, NULL);
+    assert(ok);
+
+    char *text = strdup("hello");
+    assert(text);
+
+    // Paste without waiting for the device acknowledgement
+    struct sc_control_msg clipboard_msg = {
+        .type = SC_CONTROL_MSG_TYPE_SET_CLIPBOARD,
+        .set_clipboard = {
+            .sequence = SC_SEQUENCE_INVALID,
+            .text = text,
+            .paste = true,
+        },
+    };
+
+    // Both serialized messages are small
+    uint8_t expected[64];
+    size_t expected_len = sc_control_msg_serialize(&clipboard_msg, expected);
+
+    struct sc_control_msg touch_msg = make_touch_msg(100, 200);
+    expected_len +=
+        sc_control_msg_serialize(&touch_msg, &expected[expected_len]);
+
+    // Push the messages before starting the controller, so that they are all
+    // pending on the first iteration
+    ok = sc_controller_push_msg(&controller, &clipboard_msg);
+    assert(ok);
+    ok = sc_controller_push_msg(&controller, &touch_msg);
+    assert(ok);
+
+    ok = sc_controller_start(&controller);
+    assert(ok);
+
+    // The clipboard must be set before the next input event is injected
+    uint8_t received[64];
+    ssize_t r = net_recv_all(peer, received, expected_len);
+    assert(r == (ssize_t) expected_len);
+    assert(!memcmp(received, expected, expected_len));
+
+    stop_controller(&controller, sock);
+    net_close(sock);
+    net_close(peer);
+}
+
+static void test_non_droppable_overflow(void) {
+    sc_socket sock;
+    sc_socket peer;
+    bool ok = create_socket_pair(&sock, &peer, TEST_PORT_FIRST,
+                                 TEST_PORT_LAST);
+    assert(ok);
+
+    struct sc_controller controller;
+    ok = sc_controller_init(&controller, sock, &controller_cbs, NULL);
+    assert(ok);
+
+    // Much more than the queue capacity
+    size_t count = 1000;
+    uint8_t *expected = malloc(count * SC_CONTROL_MSG_MAX_SIZE);
+    assert(expected);
+    size_t expected_len = 0;
+
+    // Fill the lane before starting the controller, so that nothing is
+    // consumed meanwhile
+    for (size_t i = 0; i < count; ++i) {
+        struct sc_control_msg msg = {
+            .type = SC_CONTROL_MSG_TYPE_UHID_DESTROY,
+            .uhid_destroy = {
+                .id = i,
+            },
+        };
+        assert(!sc_control_msg_is_droppable(&msg));
+
+        expected_len +=
+            sc_control_msg_serialize(&msg, &expected[expected_len]);
+
+        // A non-droppable message is never dropped
+        ok = sc_controller_push_msg(&controller, &msg);
+        assert(ok);
+    }
+
+    // A droppable message is dropped above the limit
+    struct sc_control_msg touch_msg = make_touch_msg(100, 200);
+    ok = sc_controller_push_msg(&controller, &touch_msg);
+    assert(!ok);
+
+    ok = sc_controller_start(&controller);
+    assert(ok);
+
+    // All the messages are received, in order
+    uint8_t *received = malloc(expected_len);
+    assert(received);
+
+    ssize_t r = net_recv_all(peer, received, expected_len);
+    assert(r == (ssize_t) expected_len);
+    assert(!memcmp(received, expected, expected_len));
+
+    free(received);
+    free(expected);
+
+    stop_controller(&controller, sock);
+    net_close(sock);
+    net_close(peer);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = net_init();
+    assert(ok);
+
+    test_batch_order();
+    test_bulk_interleaving();
+    test_paste_order();
+    test_non_droppable_overflow();
+
+    net_cleanup();
+    return 0;
+}
@@ -3,9 +3,17 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "device_msg.h"
+#include "util/binary.h"
+#include "util/bytebuf.h"
+#include "util/rand.h"
+
+#define FUZZ_MSG_COUNT 20000
+#define FUZZ_BUFFER_CAPACITY 4096
+#define FUZZ_MAX_PAYLOAD_SIZE 1500
 
 static void test_deserialize_clipboard(void) {
     const uint8_t input[] = {
@@ -61,6 +69,25 @@ static void test_deserialize_ack_set_clipboard(void) {
     assert(msg.ack_clipboard.sequence == UINT64_C(0x0102030405060708));
 }
 
+static void test_deserialize_latency_probe_ack(void) {
+    const uint8_t input[] = {
+        DEVICE_MSG_TYPE_LATENCY_PROBE_ACK,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // sequence
+        0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, // timestamp
+    };
+
+    struct sc_device_msg msg;
+    ssize_t r = sc_device_msg_deserialize(input, sizeof(input) - 1, &msg);
+    assert(r == 0); // incomplete
+
+    r = sc_device_msg_deserialize(input, sizeof(input), &msg);
+    assert(r == 17);
+
+    assert(msg.type == DEVICE_MSG_TYPE_LATENCY_PROBE_ACK);
+    assert(msg.latency_probe_ack.sequence == UINT64_C(0x0102030405060708));
+    assert(msg.latency_probe_ack.timestamp == UINT64_C(0x0102030405));
+}
+
 static void test_deserialize_uhid_output(void) {
     const uint8_t input[] = {
         DEVICE_MSG_TYPE_UHID_OUTPUT,
@@ -83,6 +110,201 @@ static void test_deserialize_uhid_output(void) {
     sc_device_msg_destroy(&msg);
 }
 
+static void test_deserialize_split(void) {
+    const uint8_t input[] = {
+        DEVICE_MSG_TYPE_CLIPBOARD,
+        0x00, 0x00, 0x00, 0x03, // text length
+        0x41, 0x42, 0x43, // "ABC"
+        DEVICE_MSG_TYPE_UHID_OUTPUT,
+        0, 42, // id
+        0, 3, // size
+        0x01, 0x02, 0x03, // data
+    };
+
+    // Split at every possible position
+    for (size_t i = 0; i <= sizeof(input); ++i) {
+        const uint8_t *buf2 = &input[i];
+        size_t len2 = sizeof(input) - i;
+
+        struct sc_device_msg msg;
+        ssize_t r = sc_device_msg_deserialize_split(input, i, buf2, len2,
+                                                    &msg);
+        assert(r == 8);
+        assert(msg.type == DEVICE_MSG_TYPE_CLIPBOARD);
+        assert(!strcmp("ABC", msg.clipboard.text));
+        sc_device_msg_destroy(&msg);
+
+        // Parse the second message from the remaining parts
+        const uint8_t *rem1;
+        size_t rem_len1;
+        const uint8_t *rem2;
+        size_t rem_len2;
+        if (i >= 8) {
+            rem1 = &input[8];
+            rem_len1 = i - 8;
+            rem2 = buf2;
+            rem_len2 = len2;
+        } else {
+            rem1 = &buf2[8 - i];
+            rem_len1 = len2 - (8 - i);
+            rem2 = NULL;
+            rem_len2 = 0;
+        }
+
+        r = sc_device_msg_deserialize_split(rem1, rem_len1, rem2, rem_len2,
+                                            &msg);
+        assert(r == 8);
+        assert(msg.type == DEVICE_MSG_TYPE_UHID_OUTPUT);
+        assert(msg.uhid_output.id == 42);
+        assert(msg.uhid_output.size == 3);
+        assert(!memcmp(msg.uhid_output.data, &input[13], 3));
+        sc_device_msg_destroy(&msg);
+
+        // An incomplete message must not be consumed
+        r = sc_device_msg_deserialize_split(input, MIN(i, 7), buf2,
+                                            i < 7 ? 7 - i : 0, &msg);
+        assert(r == 0);
+    }
+}
+
+// Append a random message to the stream, return its size
+static size_t
+write_random_msg(struct sc_rand *rand, uint8_t *buf) {
+    uint32_t type = sc_rand_u32(rand) % 4;
+    buf[0] = type;
+    switch (type) {
+        case DEVICE_MSG_TYPE_CLIPBOARD: {
+            size_t len = sc_rand_u32(rand) % FUZZ_MAX_PAYLOAD_SIZE;
+            sc_write32be(&buf[1], len);
+            for (size_t i = 0; i < len; ++i) {
+                // Any non-zero byte
+                buf[5 + i] = 1 + sc_rand_u32(rand) % 255;
+            }
+            return 5 + len;
+        }
+        case DEVICE_MSG_TYPE_ACK_CLIPBOARD:
+            sc_write64be(&buf[1], sc_rand_u64(rand));
+            return 9;
+        case DEVICE_MSG_TYPE_LATENCY_PROBE_ACK:
+            sc_write64be(&buf[1], sc_rand_u64(rand));
+            sc_write64be(&buf[9], sc_rand_u64(rand));
+            return 17;
+        default: {
+            assert(type == DEVICE_MSG_TYPE_UHID_OUTPUT);
+            size_t size = sc_rand_u32(rand) % 64;
+            sc_write16be(&buf[1], sc_rand_u32(rand));
+            sc_write16be(&buf[3], size);
+            for (size_t i = 0; i < size; ++i) {
+                buf[5 + i] = sc_rand_u32(rand);
+            }
+            return 5 + size;
+        }
+    }
+}
+
+// Check that msg matches the serialized message at buf, return its size
+static size_t
+check_msg(const struct sc_device_msg *msg, const uint8_t *buf) {
+    assert(msg->type == buf[0]);
+    switch (msg->type) {
+        case DEVICE_MSG_TYPE_CLIPBOARD: {
+            size_t len = sc_read32be(&buf[1]);
+            assert(strlen(msg->clipboard.text) == len);
+            assert(!memcmp(msg->clipboard.text, &buf[5], len));
+            return 5 + len;
+        }
+        case DEVICE_MSG_TYPE_ACK_CLIPBOARD:
+            assert(msg->ack_clipboard.sequence == sc_read64be(&buf[1]));
+            return 9;
+        case DEVICE_MSG_TYPE_LATENCY_PROBE_ACK:
+            assert(msg->latency_probe_ack.sequence == sc_read64be(&buf[1]));
+            assert(msg->latency_probe_ack.timestamp == sc_read64be(&buf[9]));
+            return 17;
+        default: {
+            assert(msg->type == DEVICE_MSG_TYPE_UHID_OUTPUT);
+            size_t size = sc_read16be(&buf[3]);
+            assert(msg->uhid_output.id == sc_read16be(&buf[1]));
+            assert(msg->uhid_output.size == size);
+            assert(!memcmp(msg->uhid_output.data, &buf[5], size));
+            return 5 + size;
+        }
+    }
+}
+
+// Parse all the complete messages available in the ring buffer
+static size_t
+parse_bytebuf(struct sc_bytebuf *buf, const uint8_t *expected,
+              size_t *expected_head) {
+    size_t count = 0;
+    for (;;) {
+        const uint8_t *part1;
+        const uint8_t *part2;
+        size_t len1;
+        size_t len2;
+        sc_bytebuf_read_parts(buf, &part1, &len1, &part2, &len2);
+
+        struct sc_device_msg msg;
+        ssize_t r = sc_device_msg_deserialize_split(part1, len1, part2, len2,
+                                                    &msg);
+        assert(r != -1);
+        if (!r) {
+            return count;
+        }
+
+        size_t len = check_msg(&msg, &expected[*expected_head]);
+        assert(len == (size_t) r);
+        *expected_head += len;
+
+        sc_device_msg_destroy(&msg);
+        sc_bytebuf_skip(buf, r);
+        ++count;
+    }
+}
+
+static void test_deserialize_fragmented_stream(void) {
+    struct sc_rand rand = {
+        .xsubi = {0x1234, 0x5678, 0x9abc}, // deterministic
+    };
+
+    uint8_t *stream =
+        malloc(FUZZ_MSG_COUNT * (5 + FUZZ_MAX_PAYLOAD_SIZE));
+    assert(stream);
+
+    size_t stream_len = 0;
+    for (int i = 0; i < FUZZ_MSG_COUNT; ++i) {
+        stream_len += write_random_msg(&rand, &stream[stream_len]);
+    }
+
+    // Use a small ring buffer so that many messages span the wrap
+    struct sc_bytebuf buf;
+    bool ok = sc_bytebuf_init(&buf, FUZZ_BUFFER_CAPACITY);
+    assert(ok);
+
+    size_t written = 0;
+    size_t expected_head = 0;
+    size_t count = 0;
+    while (written < stream_len) {
+        // Simulate a recv() of random size
+        size_t len;
+        uint8_t *ptr = sc_bytebuf_prepare_write(&buf, &len);
+        assert(len);
+        size_t n = 1 + sc_rand_u32(&rand) % len;
+        n = MIN(n, stream_len - written);
+        memcpy(ptr, &stream[written], n);
+        sc_bytebuf_commit_write(&buf, n);
+        written += n;
+
+        count += parse_bytebuf(&buf, stream, &expected_head);
+    }
+
+    assert(count == FUZZ_MSG_COUNT);
+    assert(expected_head == stream_len);
+    assert(sc_bytebuf_can_read(&buf) == 0);
+
+    sc_bytebuf_destroy(&buf);
+    free(stream);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -90,6 +312,9 @@ int main(int argc, char *argv[]) {
     test_deserialize_clipboard();
     test_deserialize_clipboard_big();
     test_deserialize_ack_set_clipboard();
+    test_deserialize_latency_probe_ack();
     test_deserialize_uhid_output();
+    test_deserialize_split();
+    test_deserialize_fragmented_stream();
     return 0;
 }
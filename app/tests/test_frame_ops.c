@@ -0,0 +1,346 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/frame_ops.h"
+
+struct plane {
+    uint8_t *data;
+    int linesize;
+    unsigned width;
+    unsigned height;
+};
+
+static const enum sc_simd all_simd[] = {
+    SC_SIMD_NONE,
+    SC_SIMD_SSE2,
+    SC_SIMD_AVX2,
+    SC_SIMD_NEON,
+};
+
+// Include sizes smaller than, equal to and not multiple of the SIMD widths
+static const unsigned sizes[][2] = {
+    {1, 1}, {3, 5}, {16, 16}, {17, 33}, {64, 48}, {100, 37}, {161, 90},
+};
+
+static uint32_t rand_state = 42;
+
+static uint8_t
+rand_u8(void) {
+    // xorshift32
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state >> 24;
+}
+
+static void
+plane_init(struct plane *p, unsigned width, unsigned height) {
+    // Add some padding to check that the linesize is respected
+    p->linesize = width + 7;
+    p->width = width;
+    p->height = height;
+    p->data = malloc(p->linesize * height);
+    assert(p->data);
+    for (int i = 0; i < p->linesize * (int) height; ++i) {
+        p->data[i] = rand_u8();
+    }
+}
+
+static void
+plane_destroy(struct plane *p) {
+    free(p->data);
+}
+
+static uint8_t
+plane_at(const struct plane *p, unsigned x, unsigned y) {
+    assert(x < p->width && y < p->height);
+    return p->data[y * p->linesize + x];
+}
+
+static bool
+plane_equals(const struct plane *a, const struct plane *b) {
+    if (a->width != b->width || a->height != b->height) {
+        return false;
+    }
+    for (unsigned y = 0; y < a->height; ++y) {
+        if (memcmp(a->data + y * a->linesize, b->data + y * b->linesize,
+                   a->width)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void
+ref_hflip(struct plane *dst, const struct plane *src) {
+    plane_init(dst, src->width, src->height);
+    for (unsigned y = 0; y < src->height; ++y) {
+        for (unsigned x = 0; x < src->width; ++x) {
+            dst->data[y * dst->linesize + x] =
+                plane_at(src, src->width - 1 - x, y);
+        }
+    }
+}
+
+static void
+ref_rotate_90(struct plane *dst, const struct plane *src) {
+    plane_init(dst, src->height, src->width);
+    for (unsigned y = 0; y < dst->height; ++y) {
+        for (unsigned x = 0; x < dst->width; ++x) {
+            dst->data[y * dst->linesize + x] =
+                plane_at(src, y, src->height - 1 - x);
+        }
+    }
+}
+
+static void
+ref_transform(struct plane *dst, const struct plane *src,
+              enum sc_orientation orientation) {
+    // A horizontal flip (if mirror), then clockwise rotations by 90 degrees
+    struct plane current;
+    if (sc_orientation_is_mirror(orientation)) {
+        ref_hflip(&current, src);
+    } else {
+        plane_init(&current, src->width, src->height);
+        for (unsigned y = 0; y < src->height; ++y) {
+            memcpy(current.data + y * current.linesize,
+                   src->data + y * src->linesize, src->width);
+        }
+    }
+
+    unsigned rotation = sc_orientation_get_rotation(orientation);
+    for (unsigned i = 0; i < rotation; ++i) {
+        struct plane rotated;
+        ref_rotate_90(&rotated, &current);
+        plane_destroy(&current);
+        current = rotated;
+    }
+
+    *dst = current;
+}
+
+static void test_transform_semantics(void) {
+    // a b c
+    // d e f
+    uint8_t src[] = {'a', 'b', 'c', 'd', 'e', 'f'};
+    uint8_t dst[6];
+
+    sc_plane_transform(dst, 2, src, 3, 3, 2, SC_ORIENTATION_90);
+    assert(!memcmp(dst, "daebfc", 6));
+
+    sc_plane_transform(dst, 2, src, 3, 3, 2, SC_ORIENTATION_270);
+    assert(!memcmp(dst, "cfbead", 6));
+
+    sc_plane_transform(dst, 3, src, 3, 3, 2, SC_ORIENTATION_180);
+    assert(!memcmp(dst, "fedcba", 6));
+
+    sc_plane_transform(dst, 3, src, 3, 3, 2, SC_ORIENTATION_FLIP_0);
+    assert(!memcmp(dst, "cbafed", 6));
+
+    // The flip is applied before the rotation
+    sc_plane_transform(dst, 2, src, 3, 3, 2, SC_ORIENTATION_FLIP_90);
+    assert(!memcmp(dst, "fcebda", 6));
+
+    sc_plane_transform(dst, 3, src, 3, 3, 2, SC_ORIENTATION_FLIP_180);
+    assert(!memcmp(dst, "defabc", 6));
+
+    sc_plane_transform(dst, 2, src, 3, 3, 2, SC_ORIENTATION_FLIP_270);
+    assert(!memcmp(dst, "adbecf", 6));
+}
+
+static void test_transform(void) {
+    for (size_t i = 0; i < ARRAY_LEN(sizes); ++i) {
+        struct plane src;
+        plane_init(&src, sizes[i][0], sizes[i][1]);
+
+        for (unsigned o = 0; o < 8; ++o) {
+            enum sc_orientation orientation = o;
+
+            struct plane expected;
+            ref_transform(&expected, &src, orientation);
+
+            struct plane dst;
+            plane_init(&dst, expected.width, expected.height);
+            sc_plane_transform(dst.data, dst.linesize, src.data, src.linesize,
+                               src.width, src.height, orientation);
+            assert(plane_equals(&dst, &expected));
+
+            plane_destroy(&dst);
+            plane_destroy(&expected);
+        }
+
+        plane_destroy(&src);
+    }
+}
+
+static void test_downscale(void) {
+    for (size_t i = 0; i < ARRAY_LEN(sizes); ++i) {
+        struct plane src;
+        plane_init(&src, sizes[i][0], sizes[i][1]);
+
+        struct plane dst;
+        plane_init(&dst, (src.width + 1) / 2, (src.height + 1) / 2);
+        sc_plane_downscale_2x(dst.data, dst.linesize, src.data, src.linesize,
+                              src.width, src.height);
+
+        for (unsigned y = 0; y < dst.height; ++y) {
+            for (unsigned x = 0; x < dst.width; ++x) {
+                // The last column and row are repeated if necessary
+                unsigned x1 = MIN(2 * x + 1, src.width - 1);
+                unsigned y1 = MIN(2 * y + 1, src.height - 1);
+                unsigned sum = plane_at(&src, 2 * x, 2 * y)
+                             + plane_at(&src, x1, 2 * y)
+                             + plane_at(&src, 2 * x, y1)
+                             + plane_at(&src, x1, y1);
+                assert(plane_at(&dst, x, y) == (sum + 2) / 4);
+            }
+        }
+
+        plane_destroy(&dst);
+        plane_destroy(&src);
+    }
+}
+
+static void test_interleave(void) {
+    for (size_t i = 0; i < ARRAY_LEN(sizes); ++i) {
+        unsigned width = sizes[i][0];
+        unsigned height = sizes[i][1];
+
+        struct plane u;
+        struct plane v;
+        plane_init(&u, width, height);
+        plane_init(&v, width, height);
+
+        struct plane uv;
+        plane_init(&uv, 2 * width, height);
+        sc_plane_interleave(uv.data, uv.linesize, u.data, u.linesize, v.data,
+                            v.linesize, width, height);
+
+        for (unsigned y = 0; y < height; ++y) {
+            for (unsigned x = 0; x < width; ++x) {
+                assert(plane_at(&uv, 2 * x, y) == plane_at(&u, x, y));
+                assert(plane_at(&uv, 2 * x + 1, y) == plane_at(&v, x, y));
+            }
+        }
+
+        struct plane u2;
+        struct plane v2;
+        plane_init(&u2, width, height);
+        plane_init(&v2, width, height);
+        sc_plane_deinterleave(u2.data, u2.linesize, v2.data, v2.linesize,
+                              uv.data, uv.linesize, width, height);
+        assert(plane_equals(&u2, &u));
+        assert(plane_equals(&v2, &v));
+
+        plane_destroy(&v2);
+        plane_destroy(&u2);
+        plane_destroy(&uv);
+        plane_destroy(&v);
+        plane_destroy(&u);
+    }
+}
+
+static void
+yuv420p_init(struct sc_yuv420p *image, struct plane planes[3], unsigned width,
+             unsigned height) {
+    plane_init(&planes[0], width, height);
+    plane_init(&planes[1], (width + 1) / 2, (height + 1) / 2);
+    plane_init(&planes[2], (width + 1) / 2, (height + 1) / 2);
+    for (int i = 0; i < 3; ++i) {
+        image->data[i] = planes[i].data;
+        image->linesize[i] = planes[i].linesize;
+    }
+    image->width = width;
+    image->height = height;
+}
+
+static void test_yuv420p_crop_transform(void) {
+    struct plane planes[3];
+    struct sc_yuv420p src;
+    yuv420p_init(&src, planes, 101, 67);
+
+    struct sc_yuv420p cropped;
+    sc_yuv420p_crop(&cropped, &src, 10, 4, 37, 51);
+    assert(cropped.width == 37);
+    assert(cropped.height == 51);
+    assert(cropped.data[0] == src.data[0] + 4 * src.linesize[0] + 10);
+    assert(cropped.data[1] == src.data[1] + 2 * src.linesize[1] + 5);
+    assert(cropped.data[2] == src.data[2] + 2 * src.linesize[2] + 5);
+
+    struct plane dst_planes[3];
+    struct sc_yuv420p dst;
+    yuv420p_init(&dst, dst_planes, 51, 37);
+    sc_yuv420p_transform(&dst, &cropped, SC_ORIENTATION_FLIP_90);
+
+    for (int i = 0; i < 3; ++i) {
+        // The chroma planes of odd sizes are also transformed entirely
+        struct plane view = {
+            .data = cropped.data[i],
+            .linesize = cropped.linesize[i],
+            .width = i ? 19 : 37,
+            .height = i ? 26 : 51,
+        };
+        struct plane expected;
+        ref_transform(&expected, &view, SC_ORIENTATION_FLIP_90);
+        assert(plane_equals(&dst_planes[i], &expected));
+        plane_destroy(&expected);
+
+        plane_destroy(&dst_planes[i]);
+        plane_destroy(&planes[i]);
+    }
+}
+
+static void test_yuv420p_nv12(void) {
+    struct plane planes[3];
+    struct sc_yuv420p src;
+    yuv420p_init(&src, planes, 75, 41);
+
+    struct plane y;
+    struct plane uv;
+    plane_init(&y, 75, 41);
+    plane_init(&uv, 2 * 38, 21);
+    sc_yuv420p_to_nv12(y.data, y.linesize, uv.data, uv.linesize, &src);
+    assert(plane_equals(&y, &planes[0]));
+
+    struct plane dst_planes[3];
+    struct sc_yuv420p dst;
+    yuv420p_init(&dst, dst_planes, 75, 41);
+    sc_yuv420p_from_nv12(&dst, y.data, y.linesize, uv.data, uv.linesize);
+
+    for (int i = 0; i < 3; ++i) {
+        assert(plane_equals(&dst_planes[i], &planes[i]));
+        plane_destroy(&dst_planes[i]);
+        plane_destroy(&planes[i]);
+    }
+    plane_destroy(&uv);
+    plane_destroy(&y);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    // The scalar implementation is always available
+    assert(sc_frame_ops_set_simd(SC_SIMD_NONE));
+    assert(sc_frame_ops_get_simd() == SC_SIMD_NONE);
+
+    // Run all the tests with every implementation supported by the CPU
+    for (size_t i = 0; i < ARRAY_LEN(all_simd); ++i) {
+        if (!sc_frame_ops_set_simd(all_simd[i])) {
+            continue;
+        }
+
+        test_transform_semantics();
+        test_transform();
+        test_downscale();
+        test_interleave();
+        test_yuv420p_crop_transform();
+        test_yuv420p_nv12();
+    }
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "common.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include "frame_pacer.h"
+#include "util/tick.h"
+
+static void test_next_vsync_unknown(void) {
+    // Without vsync phase or refresh interval, the date is unchanged
+    assert(sc_frame_pacer_next_vsync(1000, 0, 16000) == 1000);
+    assert(sc_frame_pacer_next_vsync(1000, 500, 0) == 1000);
+}
+
+static void test_next_vsync(void) {
+    sc_tick vsync = 100000;
+    sc_tick interval = 16000;
+
+    // Exactly on a vsync
+    assert(sc_frame_pacer_next_vsync(vsync, vsync, interval) == vsync);
+    assert(sc_frame_pacer_next_vsync(vsync + 2 * interval, vsync, interval)
+            == vsync + 2 * interval);
+
+    // Just after a vsync: the next one
+    assert(sc_frame_pacer_next_vsync(vsync + 1, vsync, interval)
+            == vsync + interval);
+    assert(sc_frame_pacer_next_vsync(vsync + interval - 1, vsync, interval)
+            == vsync + interval);
+
+    // Before the reference vsync
+    assert(sc_frame_pacer_next_vsync(vsync - 1, vsync, interval) == vsync);
+    assert(sc_frame_pacer_next_vsync(vsync - interval, vsync, interval)
+            == vsync - interval);
+    assert(sc_frame_pacer_next_vsync(vsync - interval - 1, vsync, interval)
+            == vsync - interval);
+    assert(sc_frame_pacer_next_vsync(vsync - 2 * interval, vsync, interval)
+            == vsync - 2 * interval);
+}
+
+static void test_select_vsync(void) {
+    sc_tick vsync = 100000;
+    sc_tick interval = 16000;
+
+    // No previous frame
+    assert(sc_frame_pacer_select_vsync(vsync + 1, vsync, interval,
+                                       SC_TICK_NONE, -1) == vsync + interval);
+
+    // 30 fps on a 60 Hz display: keep presenting every 2 vsyncs, even if the
+    // target is slightly early or late
+    sc_tick last = vsync + 10 * interval;
+    sc_tick pts_interval = 33000;
+    sc_tick expected = last + 2 * interval;
+    assert(sc_frame_pacer_select_vsync(expected - 5000, vsync, interval, last,
+                                       pts_interval) == expected);
+    assert(sc_frame_pacer_select_vsync(expected + 5000, vsync, interval, last,
+                                       pts_interval) == expected);
+
+    // Drifted too far: realign on the target
+    sc_tick target = expected + 2 * interval + 1;
+    assert(sc_frame_pacer_select_vsync(target, vsync, interval, last,
+                                       pts_interval)
+            == expected + 3 * interval);
+}
+
+static void test_intervals_steady(void) {
+    struct sc_frame_intervals fi;
+    sc_frame_intervals_init(&fi);
+
+    assert(sc_frame_intervals_get_stddev(&fi) == 0);
+
+    for (int i = 0; i < 10; ++i) {
+        sc_frame_intervals_add(&fi, 5000 + i * 16000);
+    }
+
+    // 10 dates, 9 intervals
+    assert(fi.count == 9);
+    assert(fi.mean == 16000);
+    assert(fi.max == 16000);
+    assert(sc_frame_intervals_get_stddev(&fi) == 0);
+}
+
+static void test_intervals_judder(void) {
+    struct sc_frame_intervals fi;
+    sc_frame_intervals_init(&fi);
+
+    // Intervals: 10, 20, 10, 20 (ms)
+    sc_frame_intervals_add(&fi, SC_TICK_FROM_MS(0));
+    sc_frame_intervals_add(&fi, SC_TICK_FROM_MS(10));
+    sc_frame_intervals_add(&fi, SC_TICK_FROM_MS(30));
+    sc_frame_intervals_add(&fi, SC_TICK_FROM_MS(40));
+    sc_frame_intervals_add(&fi, SC_TICK_FROM_MS(60));
+
+    assert(fi.count == 4);
+    assert(fi.mean == SC_TICK_FROM_MS(15));
+    assert(fi.max == SC_TICK_FROM_MS(20));
+
+    // Sample variance: 4 * 5^2 / 3
+    double expected = sqrt(4 * 25.0 / 3) * SC_TICK_FROM_MS(1);
+    double stddev = sc_frame_intervals_get_stddev(&fi);
+    assert(fabs(stddev - expected) < 1e-6 * expected);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_next_vsync_unknown();
+    test_next_vsync();
+    test_select_vsync();
+    test_intervals_steady();
+    test_intervals_judder();
+
+    return 0;
+}
@@ -0,0 +1,352 @@
+#include "common.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <libavutil/frame.h>
+#include <SDL3/SDL.h>
+
+#include "gl_scaler.h"
+#include "texture.h"
+#include "util/log.h"
+
+#define FRAME_WIDTH 64
+#define FRAME_HEIGHT 48
+#define OUTPUT_SIZE 40
+
+static bool
+near(float a, float b) {
+    return fabsf(a - b) < 0.005f;
+}
+
+static void
+yuv_to_rgb(enum AVColorSpace color_space, enum AVColorRange color_range,
+           float y, float u, float v, float rgb[3]) {
+    float m[9];
+    float offset[3];
+    sc_gl_scaler_get_yuv_to_rgb(color_space, color_range, m, offset);
+
+    float yuv[3] = {y - offset[0], u - offset[1], v - offset[2]};
+    for (unsigned i = 0; i < 3; ++i) {
+        rgb[i] = m[3 * i] * yuv[0] + m[3 * i + 1] * yuv[1]
+               + m[3 * i + 2] * yuv[2];
+    }
+}
+
+static void test_yuv_to_rgb(void) {
+    float rgb[3];
+
+    // Limited range: white and black
+    yuv_to_rgb(AVCOL_SPC_BT709, AVCOL_RANGE_MPEG, 235 / 255.f, 128 / 255.f,
+               128 / 255.f, rgb);
+    assert(near(rgb[0], 1) && near(rgb[1], 1) && near(rgb[2], 1));
+
+    yuv_to_rgb(AVCOL_SPC_BT709, AVCOL_RANGE_MPEG, 16 / 255.f, 128 / 255.f,
+               128 / 255.f, rgb);
+    assert(near(rgb[0], 0) && near(rgb[1], 0) && near(rgb[2], 0));
+
+    // Full range BT.601 red: Y = 0.299, Cb = 0.5 - 0.1687, Cr = 0.5 + 0.5
+    yuv_to_rgb(AVCOL_SPC_SMPTE170M, AVCOL_RANGE_JPEG, 0.299f,
+               128 / 255.f - 0.168736f, 128 / 255.f + 0.5f, rgb);
+    assert(near(rgb[0], 1) && near(rgb[1], 0) && near(rgb[2], 0));
+
+    // Full range BT.709 blue: Y = 0.0722, Cb = 0.5 + 0.5, Cr = 0.5 - 0.0458
+    yuv_to_rgb(AVCOL_SPC_BT709, AVCOL_RANGE_JPEG, 0.0722f,
+               128 / 255.f + 0.5f, 128 / 255.f - 0.045847f, rgb);
+    assert(near(rgb[0], 0) && near(rgb[1], 0) && near(rgb[2], 1));
+}
+
+static void
+assert_corner(const float *texcoords, unsigned corner, float x, float y) {
+    assert(texcoords[2 * corner] == x);
+    assert(texcoords[2 * corner + 1] == y);
+}
+
+static void test_texcoords(void) {
+    float tc[8];
+
+    sc_gl_scaler_get_texcoords(SC_ORIENTATION_0, tc);
+    assert_corner(tc, 0, 0, 0);
+    assert_corner(tc, 1, 1, 0);
+    assert_corner(tc, 2, 0, 1);
+    assert_corner(tc, 3, 1, 1);
+
+    // Rotated clockwise: the top-left corner of the content is the
+    // bottom-left corner of the texture
+    sc_gl_scaler_get_texcoords(SC_ORIENTATION_90, tc);
+    assert_corner(tc, 0, 0, 1);
+    assert_corner(tc, 1, 0, 0);
+    assert_corner(tc, 2, 1, 1);
+    assert_corner(tc, 3, 1, 0);
+
+    sc_gl_scaler_get_texcoords(SC_ORIENTATION_180, tc);
+    assert_corner(tc, 0, 1, 1);
+    assert_corner(tc, 3, 0, 0);
+
+    sc_gl_scaler_get_texcoords(SC_ORIENTATION_270, tc);
+    assert_corner(tc, 0, 1, 0);
+    assert_corner(tc, 3, 0, 1);
+
+    // Flipped horizontally
+    sc_gl_scaler_get_texcoords(SC_ORIENTATION_FLIP_0, tc);
+    assert_corner(tc, 0, 1, 0);
+    assert_corner(tc, 1, 0, 0);
+
+    // Flipped horizontally, then rotated clockwise
+    sc_gl_scaler_get_texcoords(SC_ORIENTATION_FLIP_90, tc);
+    assert_corner(tc, 0, 1, 1);
+    assert_corner(tc, 3, 0, 0);
+}
+
+static double
+ref_kernel(double x, enum sc_downscale_filter filter) {
+    x = fabs(x);
+    if (filter == SC_DOWNSCALE_FILTER_LANCZOS) {
+        if (x < 1e-5) {
+            return 1;
+        }
+        if (x >= 3) {
+            return 0;
+        }
+        double px = M_PI * x;
+        return 3 * sin(px) * sin(px / 3) / (px * px);
+    }
+
+    // Catmull-Rom
+    if (x < 1) {
+        return (1.5 * x - 2.5) * x * x + 1;
+    }
+    if (x < 2) {
+        return ((-0.5 * x + 2.5) * x - 4) * x + 2;
+    }
+    return 0;
+}
+
+// Reference implementation of the shader, for one plane
+static double
+ref_sample(const AVFrame *frame, unsigned plane, double s, double t,
+           double ratio_x, double ratio_y, enum sc_downscale_filter filter) {
+    int w = plane ? (frame->width + 1) / 2 : frame->width;
+    int h = plane ? (frame->height + 1) / 2 : frame->height;
+    double radius = filter == SC_DOWNSCALE_FILTER_LANCZOS ? 3 : 2;
+
+    double scale_x = ratio_x * w / frame->width;
+    double scale_y = ratio_y * h / frame->height;
+    scale_x = scale_x < 1 ? 1 : scale_x > 4 ? 4 : scale_x;
+    scale_y = scale_y < 1 ? 1 : scale_y > 4 ? 4 : scale_y;
+
+    double pos_x = s * w - 0.5;
+    double pos_y = t * h - 0.5;
+    int first_x = (int) floor(pos_x - radius * scale_x) + 1;
+    int last_x = (int) floor(pos_x + radius * scale_x);
+    int first_y = (int) floor(pos_y - radius * scale_y) + 1;
+    int last_y = (int) floor(pos_y + radius * scale_y);
+
+    double sum = 0;
+    double weight_sum = 0;
+    for (int y = first_y; y <= last_y; ++y) {
+        double wy = ref_kernel((y - pos_y) / scale_y, filter);
+        int ty = y < 0 ? 0 : y >= h ? h - 1 : y;
+        const uint8_t *line = frame->data[plane] + ty * frame->linesize[plane];
+        for (int x = first_x; x <= last_x; ++x) {
+            double weight = wy * ref_kernel((x - pos_x) / scale_x, filter);
+            int tx = x < 0 ? 0 : x >= w ? w - 1 : x;
+            sum += weight * line[tx] / 255.0;
+            weight_sum += weight;
+        }
+    }
+
+    return sum / weight_sum;
+}
+
+static AVFrame *
+create_frame(void) {
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = FRAME_WIDTH;
+    frame->height = FRAME_HEIGHT;
+    frame->colorspace = AVCOL_SPC_BT709;
+    frame->color_range = AVCOL_RANGE_MPEG;
+    int r = av_frame_get_buffer(frame, 0);
+    assert(!r);
+    (void) r;
+
+    // High frequencies (aliased by a naive downscaling) on a gradient
+    for (int y = 0; y < FRAME_HEIGHT; ++y) {
+        uint8_t *line = frame->data[0] + y * frame->linesize[0];
+        for (int x = 0; x < FRAME_WIDTH; ++x) {
+            line[x] = (x + y) & 1 ? 200 : 40 + x;
+        }
+    }
+    for (int y = 0; y < FRAME_HEIGHT / 2; ++y) {
+        uint8_t *u = frame->data[1] + y * frame->linesize[1];
+        uint8_t *v = frame->data[2] + y * frame->linesize[2];
+        for (int x = 0; x < FRAME_WIDTH / 2; ++x) {
+            u[x] = 64 + 4 * x;
+            v[x] = 200 - 5 * y;
+        }
+    }
+
+    return frame;
+}
+
+static bool
+init_sdl_video(void) {
+    if (SDL_Init(SDL_INIT_VIDEO)) {
+        return true;
+    }
+
+    // Headless environment (e.g. llvmpipe through EGL)
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    return SDL_Init(SDL_INIT_VIDEO);
+}
+
+// Return the maximal difference with the reference, or -1 if not supported
+static int
+render(SDL_Renderer *renderer, const AVFrame *frame,
+       enum sc_downscale_filter filter, enum sc_orientation orientation) {
+    struct sc_texture tex;
+    bool ok = sc_texture_init(&tex, renderer, false, filter);
+    assert(ok);
+    if (!tex.gl_scaler_enabled) {
+        sc_texture_destroy(&tex);
+        return -1;
+    }
+
+    ok = sc_texture_set_from_frame(&tex, frame);
+    assert(ok);
+
+    bool swap = sc_orientation_is_swap(orientation);
+    SDL_FRect geometry = swap ? (SDL_FRect) {4, 6, 12, 16}
+                              : (SDL_FRect) {4, 6, 16, 12};
+
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    ok = sc_texture_render(&tex, &geometry, orientation);
+    assert(ok);
+
+    SDL_Surface *surface = SDL_RenderReadPixels(renderer, NULL);
+    assert(surface);
+    SDL_Surface *rgba = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+    assert(rgba);
+    SDL_DestroySurface(surface);
+
+    sc_texture_destroy(&tex);
+
+    float m[9];
+    float offset[3];
+    sc_gl_scaler_get_yuv_to_rgb(frame->colorspace, frame->color_range, m,
+                                offset);
+    float tc[8];
+    sc_gl_scaler_get_texcoords(orientation, tc);
+
+    double ratio_x = frame->width / (swap ? geometry.h : geometry.w);
+    double ratio_y = frame->height / (swap ? geometry.w : geometry.h);
+
+    int max_diff = 0;
+    for (int oy = 0; oy < geometry.h; ++oy) {
+        for (int ox = 0; ox < geometry.w; ++ox) {
+            // Interpolate the texture coordinates of the corners
+            double u = (ox + 0.5) / geometry.w;
+            double v = (oy + 0.5) / geometry.h;
+            double s = (1 - u) * (1 - v) * tc[0] + u * (1 - v) * tc[2]
+                     + (1 - u) * v * tc[4] + u * v * tc[6];
+            double t = (1 - u) * (1 - v) * tc[1] + u * (1 - v) * tc[3]
+                     + (1 - u) * v * tc[5] + u * v * tc[7];
+
+            double yuv[3];
+            for (unsigned p = 0; p < 3; ++p) {
+                yuv[p] = ref_sample(frame, p, s, t, ratio_x, ratio_y, filter)
+                       - offset[p];
+            }
+
+            int px = geometry.x + ox;
+            int py = geometry.y + oy;
+            const uint8_t *pixel = (const uint8_t *) rgba->pixels
+                                 + py * rgba->pitch + px * 4;
+            for (unsigned c = 0; c < 3; ++c) {
+                double value = m[3 * c] * yuv[0] + m[3 * c + 1] * yuv[1]
+                             + m[3 * c + 2] * yuv[2];
+                value = value < 0 ? 0 : value > 1 ? 1 : value;
+                int expected = (int) lround(value * 255);
+                int diff = abs(expected - pixel[c]);
+                max_diff = MAX(max_diff, diff);
+            }
+        }
+    }
+
+    // The pixels outside the geometry are not touched
+    const uint8_t *pixel = rgba->pixels;
+    assert(!pixel[0] && !pixel[1] && !pixel[2]);
+
+    SDL_DestroySurface(rgba);
+
+    return max_diff;
+}
+
+static void test_render(void) {
+    if (!init_sdl_video()) {
+        fprintf(stderr, "Could not initialize SDL video (%s), skipped\n",
+                SDL_GetError());
+        return;
+    }
+
+    SDL_Window *window = SDL_CreateWindow("test", OUTPUT_SIZE, OUTPUT_SIZE,
+                                          SDL_WINDOW_HIDDEN
+                                          | SDL_WINDOW_OPENGL);
+    SDL_Renderer *renderer = NULL;
+    if (window) {
+        renderer = SDL_CreateRenderer(window, "opengl");
+        if (!renderer) {
+            renderer = SDL_CreateRenderer(window, "opengles2");
+        }
+    }
+    if (!renderer) {
+        fprintf(stderr, "No OpenGL renderer (%s), skipped\n", SDL_GetError());
+        if (window) {
+            SDL_DestroyWindow(window);
+        }
+        SDL_Quit();
+        return;
+    }
+
+    AVFrame *frame = create_frame();
+
+    static const enum sc_downscale_filter filters[] = {
+        SC_DOWNSCALE_FILTER_BICUBIC,
+        SC_DOWNSCALE_FILTER_LANCZOS,
+    };
+    for (unsigned i = 0; i < ARRAY_LEN(filters); ++i) {
+        for (unsigned orientation = 0; orientation < 8; ++orientation) {
+            int diff = render(renderer, frame, filters[i], orientation);
+            if (diff == -1) {
+                fprintf(stderr, "Shaders not supported, skipped\n");
+                goto end;
+            }
+            // Tolerate rounding errors
+            assert(diff <= 2);
+        }
+    }
+
+end:
+    av_frame_free(&frame);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_set_log_level(SC_LOG_LEVEL_WARN);
+
+    test_yuv_to_rgb();
+    test_texcoords();
+    test_render();
+
+    return 0;
+}
@@ -0,0 +1,357 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hid/hid_coalescer.h"
+#include "hid/hid_gamepad.h"
+#include "hid/hid_mouse.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define MOUSE_REPORT_SIZE 5
+#define GAMEPAD_REPORT_SIZE 15
+
+#define MAX_OUTPUTS 4096
+
+static struct {
+    sc_mutex mutex;
+    sc_cond cond;
+    struct sc_hid_input inputs[MAX_OUTPUTS];
+    unsigned count;
+} output;
+
+static void
+on_input(struct sc_hid_coalescer *coalescer,
+         const struct sc_hid_input *hid_input, void *userdata) {
+    (void) coalescer;
+    (void) userdata;
+
+    sc_mutex_lock(&output.mutex);
+    assert(output.count < MAX_OUTPUTS);
+    output.inputs[output.count++] = *hid_input;
+    sc_cond_signal(&output.cond);
+    sc_mutex_unlock(&output.mutex);
+}
+
+static const struct sc_hid_coalescer_callbacks cbs = {
+    .on_input = on_input,
+};
+
+static void
+output_reset(void) {
+    output.count = 0;
+}
+
+static uint32_t
+rand_next(uint32_t *state) {
+    // Deterministic LCG, the test must be reproducible
+    *state = *state * 1103515245 + 12345;
+    return (*state >> 16) & 0x7FFF;
+}
+
+static struct sc_hid_input
+mouse_input(uint8_t buttons, int8_t dx, int8_t dy) {
+    struct sc_hid_input hid_input = {
+        .hid_id = SC_HID_ID_MOUSE,
+        .size = MOUSE_REPORT_SIZE,
+    };
+    hid_input.data[0] = buttons;
+    hid_input.data[1] = (uint8_t) dx;
+    hid_input.data[2] = (uint8_t) dy;
+    hid_input.data[3] = 0;
+    hid_input.data[4] = 0;
+    return hid_input;
+}
+
+static struct sc_hid_input
+gamepad_input(uint16_t hid_id, uint16_t axis, uint16_t buttons) {
+    struct sc_hid_input hid_input = {
+        .hid_id = hid_id,
+        .size = GAMEPAD_REPORT_SIZE,
+    };
+    memset(hid_input.data, 0, GAMEPAD_REPORT_SIZE);
+    hid_input.data[0] = axis & 0xFF;
+    hid_input.data[1] = axis >> 8;
+    hid_input.data[12] = buttons & 0xFF;
+    hid_input.data[13] = buttons >> 8;
+    return hid_input;
+}
+
+static void test_disabled(void) {
+    struct sc_hid_coalescer coalescer;
+    bool ok = sc_hid_coalescer_init(&coalescer, 0, &cbs, NULL);
+    assert(ok);
+
+    output_reset();
+
+    for (int i = 0; i < 10; ++i) {
+        struct sc_hid_input hid_input = mouse_input(0, 1, -1);
+        sc_hid_coalescer_push_at(&coalescer, &hid_input, 0);
+    }
+
+    // Nothing is delayed
+    assert(output.count == 10);
+    assert(sc_hid_coalescer_process_at(&coalescer, 0) == SC_TICK_NONE);
+
+    sc_hid_coalescer_destroy(&coalescer);
+}
+
+static void test_mouse_coalescing(void) {
+    struct sc_hid_coalescer coalescer;
+    // 100 reports per second: period of 10 ms
+    bool ok = sc_hid_coalescer_init(&coalescer, 100, &cbs, NULL);
+    assert(ok);
+
+    output_reset();
+
+    sc_tick now = SC_TICK_FROM_SEC(1);
+
+    // The first report is emitted immediately
+    struct sc_hid_input hid_input = mouse_input(0, 3, 4);
+    sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+    assert(output.count == 1);
+
+    // The next ones are accumulated until the end of the period
+    for (int i = 0; i < 5; ++i) {
+        now += SC_TICK_FROM_MS(1);
+        hid_input = mouse_input(0, 10, -2);
+        sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+    }
+    assert(output.count == 1);
+
+    sc_tick next = sc_hid_coalescer_process_at(&coalescer, now);
+    assert(next == SC_TICK_FROM_SEC(1) + SC_TICK_FROM_MS(10));
+    assert(output.count == 1);
+
+    sc_hid_coalescer_process_at(&coalescer, next);
+    assert(output.count == 2);
+    assert(output.inputs[1].data[0] == 0);
+    assert((int8_t) output.inputs[1].data[1] == 50);
+    assert((int8_t) output.inputs[1].data[2] == -10);
+
+    // Nothing is pending anymore
+    assert(sc_hid_coalescer_process_at(&coalescer, next) == SC_TICK_NONE);
+
+    // A pending report is emitted before a button change
+    now = next + SC_TICK_FROM_MS(1);
+    hid_input = mouse_input(0, 7, 0);
+    sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+    assert(output.count == 2);
+
+    hid_input = mouse_input(1, 0, 0);
+    sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+    assert(output.count == 4);
+    assert(output.inputs[2].data[0] == 0);
+    assert((int8_t) output.inputs[2].data[1] == 7);
+    assert(output.inputs[3].data[0] == 1);
+
+    // A pending report is flushed on request
+    now += SC_TICK_FROM_MS(1);
+    hid_input = mouse_input(1, -5, 0);
+    sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+    assert(output.count == 4);
+    sc_hid_coalescer_flush(&coalescer, SC_HID_ID_MOUSE);
+    assert(output.count == 5);
+    assert((int8_t) output.inputs[4].data[1] == -5);
+
+    sc_hid_coalescer_destroy(&coalescer);
+}
+
+static unsigned
+count_transitions(const struct sc_hid_input *inputs, unsigned count,
+                  uint8_t *transitions, unsigned max) {
+    // Record the successive buttons states of the mouse reports
+    unsigned n = 0;
+    uint8_t state = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        uint8_t buttons = inputs[i].data[0];
+        if (buttons != state) {
+            assert(n < max);
+            transitions[n++] = buttons;
+            state = buttons;
+        }
+    }
+    return n;
+}
+
+static void test_mouse_no_button_transition_lost(void) {
+    struct sc_hid_coalescer coalescer;
+    // 125 reports per second: period of 8 ms
+    bool ok = sc_hid_coalescer_init(&coalescer, 125, &cbs, NULL);
+    assert(ok);
+
+    output_reset();
+
+    static struct sc_hid_input inputs[2000];
+    uint32_t rand_state = 42;
+    uint8_t buttons = 0;
+    int32_t sum_x = 0;
+    int32_t sum_y = 0;
+
+    sc_tick now = 0;
+    for (unsigned i = 0; i < ARRAY_LEN(inputs); ++i) {
+        now += SC_TICK_FROM_US(rand_next(&rand_state) % 3000);
+
+        if (rand_next(&rand_state) % 8 == 0) {
+            // Press or release a random button (possibly several times
+            // within the same report period)
+            buttons ^= 1 << (rand_next(&rand_state) % 3);
+            inputs[i] = mouse_input(buttons, 0, 0);
+        } else {
+            int8_t dx = (int8_t) (rand_next(&rand_state) % 81) - 40;
+            int8_t dy = (int8_t) (rand_next(&rand_state) % 81) - 40;
+            inputs[i] = mouse_input(buttons, dx, dy);
+            sum_x += dx;
+            sum_y += dy;
+        }
+
+        sc_hid_coalescer_push_at(&coalescer, &inputs[i], now);
+        sc_hid_coalescer_process_at(&coalescer, now);
+    }
+
+    // Emit the last pending report
+    sc_hid_coalescer_process_at(&coalescer, now + SC_TICK_FROM_SEC(1));
+    assert(sc_hid_coalescer_process_at(&coalescer, now + SC_TICK_FROM_SEC(1))
+            == SC_TICK_NONE);
+
+    // The motion has been coalesced
+    assert(output.count < ARRAY_LEN(inputs));
+
+    // No motion is lost
+    int32_t out_x = 0;
+    int32_t out_y = 0;
+    for (unsigned i = 0; i < output.count; ++i) {
+        out_x += (int8_t) output.inputs[i].data[1];
+        out_y += (int8_t) output.inputs[i].data[2];
+    }
+    assert(out_x == sum_x);
+    assert(out_y == sum_y);
+
+    // All the button transitions are preserved, in order
+    static uint8_t in_transitions[2000];
+    static uint8_t out_transitions[2000];
+    unsigned in_count = count_transitions(inputs, ARRAY_LEN(inputs),
+                                          in_transitions, 2000);
+    unsigned out_count = count_transitions(output.inputs, output.count,
+                                           out_transitions, 2000);
+    assert(in_count > 100);
+    assert(in_count == out_count);
+    assert(!memcmp(in_transitions, out_transitions, in_count));
+
+    sc_hid_coalescer_destroy(&coalescer);
+}
+
+static void test_gamepad(void) {
+    struct sc_hid_coalescer coalescer;
+    bool ok = sc_hid_coalescer_init(&coalescer, 100, &cbs, NULL);
+    assert(ok);
+
+    output_reset();
+
+    uint16_t gp1 = SC_HID_ID_GAMEPAD_FIRST;
+    uint16_t gp2 = SC_HID_ID_GAMEPAD_FIRST + 1;
+
+    sc_tick now = SC_TICK_FROM_SEC(1);
+
+    struct sc_hid_input hid_input = gamepad_input(gp1, 100, 0);
+    sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+    hid_input = gamepad_input(gp2, 500, 0);
+    sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+    assert(output.count == 2);
+
+    // The axes states are replaced, independently for each gamepad
+    for (uint16_t axis = 101; axis <= 110; ++axis) {
+        hid_input = gamepad_input(gp1, axis, 0);
+        sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+    }
+    hid_input = gamepad_input(gp2, 501, 0);
+    sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+    assert(output.count == 2);
+
+    // Press and release a button within the same period
+    hid_input = gamepad_input(gp1, 111, 0x0001);
+    sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+    hid_input = gamepad_input(gp1, 112, 0x0001);
+    sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+    hid_input = gamepad_input(gp1, 113, 0);
+    sc_hid_coalescer_push_at(&coalescer, &hid_input, now);
+
+    // pending (110), press (111) immediately, then (112) replaced by the
+    // release (113) immediately
+    assert(output.count == 6);
+    assert(output.inputs[2].data[0] == 110);
+    assert(output.inputs[3].data[0] == 111);
+    assert(output.inputs[3].data[12] == 0x01);
+    assert(output.inputs[4].data[0] == 112);
+    assert(output.inputs[4].data[12] == 0x01);
+    assert(output.inputs[5].data[0] == 113);
+    assert(output.inputs[5].data[12] == 0);
+
+    sc_hid_coalescer_process_at(&coalescer, now + SC_TICK_FROM_MS(10));
+    assert(output.count == 7);
+    assert(output.inputs[6].hid_id == gp2);
+    assert(output.inputs[6].data[0] == (501 & 0xFF));
+
+    sc_hid_coalescer_destroy(&coalescer);
+}
+
+static void test_thread(void) {
+    struct sc_hid_coalescer coalescer;
+    bool ok = sc_hid_coalescer_init(&coalescer, 100, &cbs, NULL);
+    assert(ok);
+
+    ok = sc_hid_coalescer_start(&coalescer);
+    assert(ok);
+
+    sc_mutex_lock(&output.mutex);
+    output_reset();
+    sc_mutex_unlock(&output.mutex);
+
+    for (int i = 0; i < 20; ++i) {
+        struct sc_hid_input hid_input = mouse_input(0, 1, 0);
+        sc_hid_coalescer_push(&coalescer, &hid_input);
+    }
+
+    // The coalescer thread must emit the pending motion by itself
+    sc_tick deadline = sc_tick_now() + SC_TICK_FROM_SEC(5);
+    int32_t total = 0;
+    sc_mutex_lock(&output.mutex);
+    while (total != 20) {
+        bool signaled =
+            sc_cond_timedwait(&output.cond, &output.mutex, deadline);
+        assert(signaled);
+
+        total = 0;
+        for (unsigned i = 0; i < output.count; ++i) {
+            total += (int8_t) output.inputs[i].data[1];
+        }
+    }
+    assert(output.count < 20);
+    sc_mutex_unlock(&output.mutex);
+
+    sc_hid_coalescer_stop(&coalescer);
+    sc_hid_coalescer_join(&coalescer);
+    sc_hid_coalescer_destroy(&coalescer);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = sc_mutex_init(&output.mutex);
+    assert(ok);
+    ok = sc_cond_init(&output.cond);
+    assert(ok);
+
+    test_disabled();
+    test_mouse_coalescing();
+    test_mouse_no_button_transition_lost();
+    test_gamepad();
+    test_thread();
+
+    sc_cond_destroy(&output.cond);
+    sc_mutex_destroy(&output.mutex);
+    return 0;
+}
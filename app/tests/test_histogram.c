@@ -0,0 +1,48 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "util/histogram.h"
+
+static void test_histogram_buckets(void) {
+    struct sc_histogram histogram;
+    sc_histogram_init(&histogram);
+
+    assert(sc_histogram_percentile(&histogram, 50) == 0);
+
+    sc_histogram_add(&histogram, SC_TICK_FROM_US(10));
+    sc_histogram_add(&histogram, SC_TICK_FROM_US(124));
+    sc_histogram_add(&histogram, SC_TICK_FROM_US(125));
+    sc_histogram_add(&histogram, SC_TICK_FROM_MS(3));
+
+    assert(histogram.count == 4);
+    assert(histogram.buckets[0] == 2); // [0, 125us)
+    assert(histogram.buckets[1] == 1); // [125us, 250us)
+    assert(histogram.buckets[5] == 1); // [2ms, 4ms)
+    assert(histogram.max == SC_TICK_FROM_MS(3));
+    assert(histogram.sum == SC_TICK_FROM_US(10 + 124 + 125 + 3000));
+
+    assert(sc_histogram_percentile(&histogram, 50) == SC_TICK_FROM_US(125));
+    assert(sc_histogram_percentile(&histogram, 75) == SC_TICK_FROM_US(250));
+    // Never greater than the max
+    assert(sc_histogram_percentile(&histogram, 100) == SC_TICK_FROM_MS(3));
+}
+
+static void test_histogram_overflow(void) {
+    struct sc_histogram histogram;
+    sc_histogram_init(&histogram);
+
+    sc_histogram_add(&histogram, SC_TICK_FROM_SEC(3600));
+    assert(histogram.buckets[SC_HISTOGRAM_BUCKETS - 1] == 1);
+    assert(sc_histogram_percentile(&histogram, 99) == SC_TICK_FROM_SEC(3600));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_histogram_buckets();
+    test_histogram_overflow();
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "late_latch.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+static void test_adapt_margin(void) {
+    sc_tick interval = SC_TICK_FROM_MS(16);
+    sc_tick vsync = SC_TICK_FROM_MS(1000);
+    sc_tick margin = SC_TICK_FROM_MS(4);
+
+    // Presented on the targeted vsync: slowly decrease
+    sc_tick m = sc_late_latch_adapt_margin(margin, vsync,
+                                           vsync + SC_TICK_FROM_US(200),
+                                           interval);
+    assert(m < margin);
+    assert(m > margin - SC_TICK_FROM_MS(1));
+
+    // Missed: increase
+    m = sc_late_latch_adapt_margin(margin, vsync, vsync + interval, interval);
+    assert(m > margin);
+
+    // Never lower than 1ms
+    m = sc_late_latch_adapt_margin(SC_TICK_FROM_MS(1), vsync, vsync,
+                                   interval);
+    assert(m == SC_TICK_FROM_MS(1));
+
+    // Never higher than the refresh interval
+    m = sc_late_latch_adapt_margin(interval, vsync, vsync + interval,
+                                   interval);
+    assert(m == interval);
+
+    // Unknown refresh interval: unchanged
+    m = sc_late_latch_adapt_margin(margin, vsync, vsync + interval, 0);
+    assert(m == margin);
+}
+
+static struct {
+    sc_mutex mutex;
+    sc_cond cond;
+    unsigned count;
+    sc_tick date;
+} latched;
+
+static void
+on_latch(struct sc_late_latch *latch, void *userdata) {
+    (void) latch;
+    (void) userdata;
+
+    sc_mutex_lock(&latched.mutex);
+    ++latched.count;
+    latched.date = sc_tick_now();
+    sc_cond_signal(&latched.cond);
+    sc_mutex_unlock(&latched.mutex);
+}
+
+static sc_tick wait_latched(unsigned count) {
+    sc_mutex_lock(&latched.mutex);
+    while (latched.count < count) {
+        sc_cond_wait(&latched.cond, &latched.mutex);
+    }
+    sc_tick date = latched.date;
+    sc_mutex_unlock(&latched.mutex);
+    return date;
+}
+
+static void test_latch(void) {
+    bool ok = sc_mutex_init(&latched.mutex);
+    assert(ok);
+    ok = sc_cond_init(&latched.cond);
+    assert(ok);
+    latched.count = 0;
+
+    static const struct sc_late_latch_callbacks cbs = {
+        .on_latch = on_latch,
+    };
+
+    struct sc_late_latch latch;
+    ok = sc_late_latch_start(&latch, &cbs, NULL);
+    assert(ok);
+
+    // The vsync is unknown: latched immediately
+    sc_late_latch_notify_frame(&latch);
+    wait_latched(1);
+
+    sc_tick interval = SC_TICK_FROM_MS(20);
+    sc_late_latch_set_refresh_interval(&latch, interval);
+    sc_tick vsync = sc_tick_now();
+    sc_late_latch_on_present(&latch, vsync);
+
+    sc_late_latch_notify_frame(&latch);
+    sc_tick date = wait_latched(2);
+
+    // Not latched immediately, but shortly before the next vsync (the margin
+    // is initially a few milliseconds)
+    assert(date - vsync >= interval / 2);
+
+    sc_late_latch_interrupt(&latch);
+    sc_late_latch_join(&latch);
+    sc_late_latch_destroy(&latch);
+
+    sc_cond_destroy(&latched.cond);
+    sc_mutex_destroy(&latched.mutex);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_adapt_margin();
+    test_latch();
+
+    return 0;
+}
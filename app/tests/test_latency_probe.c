@@ -0,0 +1,327 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "controller.h"
+#include "device_msg.h"
+#include "latency_probe.h"
+#include "util/binary.h"
+#include "util/net.h"
+#include "util/socket_pair.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define TEST_PORT_FIRST 27240
+#define TEST_PORT_LAST 27259
+
+// Offset of the fake device clock
+#define FAKE_DEVICE_CLOCK_ORIGIN UINT64_C(1000000000)
+// Fake delay between injection and capture on the device
+#define FAKE_CAPTURE_DELAY 500
+
+static void test_simple(void) {
+    struct sc_latency_probe probe;
+    bool ok = sc_latency_probe_init(&probe);
+    assert(ok);
+
+    // The first frame is the reference
+    sc_latency_probe_push_frame(&probe, 0x42, -1, 500);
+
+    uint64_t seq = sc_latency_probe_push_input(&probe, 1000);
+    sc_latency_probe_ack(&probe, seq, 100000, 3000);
+    assert(probe.ack_latency.count == 1);
+    assert(probe.ack_latency.sum == 2000);
+
+    // Same content, not the result of the event
+    sc_latency_probe_push_frame(&probe, 0x42, 100100, 4000);
+    assert(probe.frame_latency.count == 0);
+
+    sc_latency_probe_push_frame(&probe, 0x43, 100800, 9000);
+    assert(probe.frame_latency.count == 1);
+    assert(probe.frame_latency.sum == 8000);
+    assert(probe.device_latency.count == 1);
+    assert(probe.device_latency.sum == 800);
+    assert(probe.count == 0);
+    assert(probe.lost == 0);
+
+    sc_latency_probe_destroy(&probe);
+}
+
+static void test_frame_before_ack(void) {
+    struct sc_latency_probe probe;
+    bool ok = sc_latency_probe_init(&probe);
+    assert(ok);
+
+    sc_latency_probe_push_frame(&probe, 1, -1, 0);
+
+    uint64_t seq = sc_latency_probe_push_input(&probe, 1000);
+
+    // A changed frame received before the event is injected cannot be its
+    // result
+    sc_latency_probe_push_frame(&probe, 2, -1, 2000);
+    assert(probe.frame_latency.count == 0);
+
+    sc_latency_probe_ack(&probe, seq, 50000, 3000);
+
+    // A changed frame captured before the injection either
+    sc_latency_probe_push_frame(&probe, 3, 49000, 4000);
+    assert(probe.frame_latency.count == 0);
+
+    sc_latency_probe_push_frame(&probe, 4, 51000, 5000);
+    assert(probe.frame_latency.count == 1);
+    assert(probe.frame_latency.sum == 4000);
+
+    sc_latency_probe_destroy(&probe);
+}
+
+static void test_several_events(void) {
+    struct sc_latency_probe probe;
+    bool ok = sc_latency_probe_init(&probe);
+    assert(ok);
+
+    sc_latency_probe_push_frame(&probe, 1, -1, 0);
+
+    uint64_t seq1 = sc_latency_probe_push_input(&probe, 1000);
+    uint64_t seq2 = sc_latency_probe_push_input(&probe, 2000);
+    uint64_t seq3 = sc_latency_probe_push_input(&probe, 3000);
+    assert(seq2 == seq1 + 1);
+    assert(seq3 == seq2 + 1);
+
+    sc_latency_probe_ack(&probe, seq1, 0, 4000);
+    sc_latency_probe_ack(&probe, seq2, 0, 5000);
+
+    // Only the acknowledged events are resolved
+    sc_latency_probe_push_frame(&probe, 2, -1, 6000);
+    assert(probe.frame_latency.count == 2);
+    assert(probe.frame_latency.sum == 5000 + 4000);
+    assert(probe.count == 1);
+
+    sc_latency_probe_ack(&probe, seq3, 0, 7000);
+    sc_latency_probe_push_frame(&probe, 3, -1, 8000);
+    assert(probe.frame_latency.count == 3);
+    assert(probe.count == 0);
+
+    // Unknown sequence
+    sc_latency_probe_ack(&probe, seq3 + 10, 0, 9000);
+    assert(probe.ack_latency.count == 3);
+
+    sc_latency_probe_destroy(&probe);
+}
+
+static void test_timeout_and_cancel(void) {
+    struct sc_latency_probe probe;
+    bool ok = sc_latency_probe_init(&probe);
+    assert(ok);
+
+    sc_latency_probe_push_frame(&probe, 1, -1, 0);
+
+    uint64_t seq = sc_latency_probe_push_input(&probe, 1000);
+    sc_latency_probe_ack(&probe, seq, 0, 2000);
+
+    // The event has no visible effect, it must not be associated to an
+    // unrelated change much later
+    sc_tick late = 1000 + SC_LATENCY_PROBE_TIMEOUT;
+    sc_latency_probe_push_frame(&probe, 2, -1, late);
+    assert(probe.frame_latency.count == 0);
+    assert(probe.lost == 1);
+    assert(probe.count == 0);
+
+    seq = sc_latency_probe_push_input(&probe, late);
+    assert(probe.count == 1);
+    sc_latency_probe_cancel_input(&probe, seq);
+    assert(probe.count == 0);
+
+    // Overflow
+    for (unsigned i = 0; i < SC_LATENCY_PROBE_MAX_PENDING + 3; ++i) {
+        sc_latency_probe_push_input(&probe, late);
+    }
+    assert(probe.count == SC_LATENCY_PROBE_MAX_PENDING);
+    assert(probe.lost == 4);
+
+    sc_latency_probe_destroy(&probe);
+}
+
+static uint64_t
+fake_device_timestamp(uint64_t sequence) {
+    return FAKE_DEVICE_CLOCK_ORIGIN + sequence * 1000;
+}
+
+// Minimal server: "inject" touch events and acknowledge latency probes
+static int
+run_fake_server(void *data) {
+    sc_socket socket = *(sc_socket *) data;
+
+    for (;;) {
+        uint8_t buf[32];
+        ssize_t r = net_recv_all(socket, buf, 1);
+        if (r <= 0) {
+            return 0;
+        }
+
+        if (buf[0] == SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT) {
+            r = net_recv_all(socket, &buf[1], 31);
+            if (r <= 0) {
+                return 0;
+            }
+            continue;
+        }
+
+        assert(buf[0] == SC_CONTROL_MSG_TYPE_LATENCY_PROBE);
+        r = net_recv_all(socket, &buf[1], 8);
+        if (r <= 0) {
+            return 0;
+        }
+
+        uint64_t sequence = sc_read64be(&buf[1]);
+
+        uint8_t ack[17];
+        ack[0] = DEVICE_MSG_TYPE_LATENCY_PROBE_ACK;
+        sc_write64be(&ack[1], sequence);
+        sc_write64be(&ack[9], fake_device_timestamp(sequence));
+        r = net_send_all(socket, ack, sizeof(ack));
+        if (r <= 0) {
+            return 0;
+        }
+    }
+}
+
+static void
+on_controller_ended(struct sc_controller *controller, bool error,
+                    void *userdata) {
+    (void) controller;
+    (void) error;
+    (void) userdata;
+}
+
+static void
+wait_acks(struct sc_latency_probe *probe, uint64_t count) {
+    // The ack is processed asynchronously by the receiver
+    sc_mutex mutex;
+    sc_cond cond;
+    bool ok = sc_mutex_init(&mutex);
+    assert(ok);
+    ok = sc_cond_init(&cond);
+    assert(ok);
+
+    sc_tick deadline = sc_tick_now() + SC_TICK_FROM_SEC(5);
+    for (;;) {
+        sc_mutex_lock(&probe->mutex);
+        uint64_t acked = probe->ack_latency.count;
+        sc_mutex_unlock(&probe->mutex);
+        if (acked >= count) {
+            break;
+        }
+
+        sc_tick now = sc_tick_now();
+        assert(now < deadline);
+
+        sc_mutex_lock(&mutex);
+        sc_cond_timedwait(&cond, &mutex, now + SC_TICK_FROM_MS(1));
+        sc_mutex_unlock(&mutex);
+    }
+
+    sc_cond_destroy(&cond);
+    sc_mutex_destroy(&mutex);
+}
+
+static void test_fake_server(void) {
+    sc_socket sock;
+    sc_socket peer;
+    bool ok = create_socket_pair(&sock, &peer, TEST_PORT_FIRST,
+                                 TEST_PORT_LAST);
+    assert(ok);
+
+    sc_thread thread;
+    ok = sc_thread_create(&thread, run_fake_server, "test-server", &peer);
+    assert(ok);
+
+    struct sc_latency_probe probe;
+    ok = sc_latency_probe_init(&probe);
+    assert(ok);
+
+    static const struct sc_controller_callbacks cbs = {
+        .on_ended = on_controller_ended,
+    };
+
+    struct sc_controller controller;
+    ok = sc_controller_init(&controller, sock, &cbs, NULL);
+    assert(ok);
+    sc_controller_configure(&controller, NULL, NULL, &probe);
+    ok = sc_controller_start(&controller);
+    assert(ok);
+
+    sc_latency_probe_push_frame(&probe, 0, -1, sc_tick_now());
+
+    for (uint64_t i = 0; i < 10; ++i) {
+        // Like the input manager: the input event, then the probe
+        struct sc_control_msg msg = {
+            .type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+            .inject_touch_event = {
+                .action = AMOTION_EVENT_ACTION_DOWN,
+                .pointer_id = SC_POINTER_ID_GENERIC_FINGER,
+                .position = {
+                    .point = {
+                        .x = 100,
+                        .y = 200,
+                    },
+                    .screen_size = {
+                        .width = 1080,
+                        .height = 1920,
+                    },
+                },
+                .pressure = 1.0f,
+            },
+        };
+        ok = sc_controller_push_msg(&controller, &msg);
+        assert(ok);
+
+        uint64_t seq = sc_latency_probe_push_input(&probe, sc_tick_now());
+        msg.type = SC_CONTROL_MSG_TYPE_LATENCY_PROBE;
+        msg.latency_probe.sequence = seq;
+        ok = sc_controller_push_msg(&controller, &msg);
+        assert(ok);
+
+        wait_acks(&probe, i + 1);
+
+        // A frame captured on the device after the injection
+        int64_t pts = fake_device_timestamp(seq) + FAKE_CAPTURE_DELAY;
+        sc_latency_probe_push_frame(&probe, i + 1, pts, sc_tick_now());
+        assert(probe.frame_latency.count == i + 1);
+    }
+
+    assert(probe.device_latency.count == 10);
+    assert(probe.device_latency.max == FAKE_CAPTURE_DELAY);
+    assert(probe.lost == 0);
+
+    sc_latency_probe_log_stats(&probe);
+
+    sc_controller_stop(&controller);
+    net_interrupt(sock);
+    sc_controller_join(&controller);
+    sc_controller_destroy(&controller);
+
+    net_interrupt(peer);
+    sc_thread_join(&thread, NULL);
+
+    sc_latency_probe_destroy(&probe);
+    net_close(sock);
+    net_close(peer);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = net_init();
+    assert(ok);
+
+    test_simple();
+    test_frame_before_ack();
+    test_several_events();
+    test_timeout_and_cancel();
+    test_fake_server();
+
+    net_cleanup();
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL3/SDL_log.h>
+
+#include "util/log.h"
+#include "util/log_async.h"
+#include "util/thread.h"
+
+#define THREADS 4
+#define MESSAGES_PER_THREAD 100
+#define MAX_RECORDS (THREADS * MESSAGES_PER_THREAD + 16)
+
+struct record {
+    SDL_LogPriority priority;
+    char *message;
+};
+
+static struct {
+    sc_mutex mutex;
+    struct record records[MAX_RECORDS];
+    unsigned count;
+} capture;
+
+static void SDLCALL
+capture_output(void *userdata, int category, SDL_LogPriority priority,
+               const char *message) {
+    (void) userdata;
+    (void) category;
+
+    sc_mutex_lock(&capture.mutex);
+    assert(capture.count < MAX_RECORDS);
+    struct record *record = &capture.records[capture.count++];
+    record->priority = priority;
+    record->message = strdup(message);
+    assert(record->message);
+    sc_mutex_unlock(&capture.mutex);
+}
+
+static void capture_start(void) {
+    bool ok = sc_mutex_init(&capture.mutex);
+    assert(ok);
+    capture.count = 0;
+    SDL_SetLogOutputFunction(capture_output, NULL);
+}
+
+static void capture_stop(void) {
+    for (unsigned i = 0; i < capture.count; ++i) {
+        free(capture.records[i].message);
+    }
+    sc_mutex_destroy(&capture.mutex);
+}
+
+// Return the message without its date prefix
+static const char *strip_date(const char *message) {
+    assert(message[0] == '[');
+    const char *end = strstr(message, "] ");
+    assert(end);
+    // The date is formatted as <seconds>.<6 digits>
+    assert(end - message >= 9);
+    assert(end[-7] == '.');
+    return end + 2;
+}
+
+static void test_order(void) {
+    capture_start();
+
+    bool ok = sc_log_async_start();
+    assert(ok);
+
+    LOGI("first");
+    LOGW("second %d", 2);
+
+    // Longer than the inline storage
+    char long_message[1000];
+    memset(long_message, 'x', sizeof(long_message) - 1);
+    long_message[sizeof(long_message) - 1] = '\0';
+    LOGI("%s", long_message);
+
+    LOGE("last");
+
+    sc_log_async_stop();
+
+    // Written synchronously
+    LOGI("sync");
+
+    assert(capture.count == 5);
+    assert(capture.records[0].priority == SDL_LOG_PRIORITY_INFO);
+    assert(!strcmp(strip_date(capture.records[0].message), "first"));
+    assert(capture.records[1].priority == SDL_LOG_PRIORITY_WARN);
+    assert(!strcmp(strip_date(capture.records[1].message), "second 2"));
+    assert(!strcmp(strip_date(capture.records[2].message), long_message));
+    assert(capture.records[3].priority == SDL_LOG_PRIORITY_ERROR);
+    assert(!strcmp(strip_date(capture.records[3].message), "last"));
+    assert(!strcmp(capture.records[4].message, "sync"));
+
+    capture_stop();
+}
+
+static int
+run_logger(void *data) {
+    unsigned id = *(unsigned *) data;
+    for (unsigned i = 0; i < MESSAGES_PER_THREAD; ++i) {
+        // Warnings are never dropped
+        LOGW("%u %u", id, i);
+    }
+    return 0;
+}
+
+static void test_threads(void) {
+    capture_start();
+
+    bool ok = sc_log_async_start();
+    assert(ok);
+
+    sc_thread threads[THREADS];
+    unsigned ids[THREADS];
+    for (unsigned i = 0; i < THREADS; ++i) {
+        ids[i] = i;
+        ok = sc_thread_create(&threads[i], run_logger, "test-logger",
+                              &ids[i]);
+        assert(ok);
+    }
+
+    for (unsigned i = 0; i < THREADS; ++i) {
+        sc_thread_join(&threads[i], NULL);
+    }
+
+    sc_log_async_stop();
+
+    // Every message is written exactly once
+    bool seen[THREADS][MESSAGES_PER_THREAD] = {0};
+    assert(capture.count == THREADS * MESSAGES_PER_THREAD);
+    for (unsigned i = 0; i < capture.count; ++i) {
+        const char *message = capture.records[i].message;
+        if (message[0] == '[') {
+            message = strip_date(message);
+        } // else written synchronously because the queue was full
+
+        unsigned id;
+        unsigned index;
+        int r = sscanf(message, "%u %u", &id, &index);
+        assert(r == 2);
+        assert(id < THREADS);
+        assert(index < MESSAGES_PER_THREAD);
+        assert(!seen[id][index]);
+        seen[id][index] = true;
+    }
+
+    capture_stop();
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_set_log_level(SC_LOG_LEVEL_INFO);
+
+    test_order();
+    test_threads();
+
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "metrics_server.h"
+#include "util/net.h"
+#include "util/strbuf.h"
+#include "util/tick.h"
+
+#define TEST_PORT_FIRST 27310
+#define TEST_PORT_LAST 27319
+
+static void push_packet(struct sc_stream_metrics *sm, int size, int64_t pts,
+                        bool key) {
+    AVPacket packet = {
+        .size = size,
+        .pts = pts,
+        .flags = key ? AV_PKT_FLAG_KEY : 0,
+    };
+    bool ok = sm->packet_sink.ops->push(&sm->packet_sink, &packet);
+    assert(ok);
+}
+
+static char *format_metrics(struct sc_metrics *metrics) {
+    struct sc_strbuf buf;
+    bool ok = sc_strbuf_init(&buf, 64);
+    assert(ok);
+
+    ok = sc_metrics_format(metrics, &buf);
+    assert(ok);
+
+    ok = sc_strbuf_append_char(&buf, '\0');
+    assert(ok);
+
+    return buf.s;
+}
+
+static void test_counters(void) {
+    struct sc_metrics metrics;
+    bool ok = sc_metrics_init(&metrics, true, false);
+    assert(ok);
+
+    struct sc_stream_metrics *video = &metrics.video;
+
+    // config packet
+    push_packet(video, 30, AV_NOPTS_VALUE, false);
+    push_packet(video, 50000, 0, true);
+    push_packet(video, 2000, 16666, false);
+    push_packet(video, 3000, 33333, false);
+    push_packet(video, 40000, 2000000, true);
+
+    assert(atomic_load(&video->packets) == 5);
+    assert(atomic_load(&video->bytes) == 95030);
+    assert(atomic_load(&video->key_frames) == 2);
+    assert(atomic_load(&video->key_frame_interval) == 2000000);
+    assert(atomic_load(&video->max_packet_size) == 50000);
+
+    sc_stream_metrics_add_decoded_frame(video, 1500);
+    sc_stream_metrics_add_decoded_frame(video, 2500);
+    sc_metrics_add_rendered_frame(&metrics, 3000, 20000);
+    sc_metrics_add_skipped_frame(&metrics);
+
+    // Aggregate over 2 seconds
+    sc_metrics_aggregate(&metrics,
+                         metrics.last_aggregation_date + SC_TICK_FROM_SEC(2));
+    assert(metrics.video_rates.packets_per_second == 2.5);
+    assert(metrics.video_rates.bytes_per_second == 47515);
+    assert(metrics.video_rates.max_packet_size == 50000);
+    // The maximum is reset on each aggregation
+    assert(atomic_load(&video->max_packet_size) == 0);
+
+    char *s = format_metrics(&metrics);
+    assert(strstr(s, "# TYPE scrcpy_stream_bytes_total counter\n"));
+    assert(strstr(s, "\nscrcpy_stream_bytes_total{stream=\"video\"} 95030\n"));
+    assert(strstr(s, "\nscrcpy_stream_packets_per_second{stream=\"video\"} "
+                     "2.5\n"));
+    assert(strstr(s, "\nscrcpy_stream_max_packet_size_bytes{stream=\"video\"} "
+                     "50000\n"));
+    assert(strstr(s, "\nscrcpy_stream_key_frame_interval_seconds"
+                     "{stream=\"video\"} 2.000\n"));
+    assert(strstr(s, "\nscrcpy_decoded_frames_total{stream=\"video\"} 2\n"));
+    assert(strstr(s, "\nscrcpy_decode_seconds_total{stream=\"video\"} "
+                     "0.004000\n"));
+    assert(strstr(s, "\nscrcpy_rendered_frames_total 1\n"));
+    assert(strstr(s, "\nscrcpy_frame_age_seconds_total 0.020000\n"));
+    assert(strstr(s, "\nscrcpy_skipped_frames_total 1\n"));
+    // audio is disabled
+    assert(!strstr(s, "stream=\"audio\""));
+    assert(!strstr(s, "scrcpy_audio_underflows_total"));
+    free(s);
+
+    sc_metrics_destroy(&metrics);
+}
+
+static void test_no_packet(void) {
+    struct sc_metrics metrics;
+    bool ok = sc_metrics_init(&metrics, true, true);
+    assert(ok);
+
+    sc_metrics_add_audio_underflow(&metrics, 480);
+    sc_metrics_add_audio_underflow(&metrics, 960);
+
+    char *s = format_metrics(&metrics);
+    assert(strstr(s, "\nscrcpy_stream_last_packet_age_seconds"
+                     "{stream=\"audio\"} -1.000\n"));
+    assert(strstr(s, "\nscrcpy_audio_underflows_total 2\n"));
+    assert(strstr(s, "\nscrcpy_audio_underflow_samples_total 1440\n"));
+    free(s);
+
+    sc_metrics_destroy(&metrics);
+}
+
+static char *http_get(uint16_t port, const char *request) {
+    sc_socket socket = net_socket();
+    assert(socket != SC_SOCKET_NONE);
+
+    bool ok = net_connect(socket, IPV4_LOCALHOST, port);
+    assert(ok);
+
+    size_t len = strlen(request);
+    ssize_t w = net_send_all(socket, request, len);
+    assert(w == (ssize_t) len);
+
+    // The server closes the connection after the response
+    struct sc_strbuf buf;
+    ok = sc_strbuf_init(&buf, 4096);
+    assert(ok);
+
+    char chunk[1024];
+    ssize_t r;
+    while ((r = net_recv(socket, chunk, sizeof(chunk))) > 0) {
+        ok = sc_strbuf_append(&buf, chunk, r);
+        assert(ok);
+    }
+
+    ok = sc_strbuf_append_char(&buf, '\0');
+    assert(ok);
+
+    net_close(socket);
+    return buf.s;
+}
+
+static void test_server(void) {
+    struct sc_metrics metrics;
+    bool ok = sc_metrics_init(&metrics, true, true);
+    assert(ok);
+
+    ok = sc_metrics_start(&metrics);
+    assert(ok);
+
+    push_packet(&metrics.audio, 200, 0, true);
+
+    struct sc_metrics_server server;
+    uint16_t port;
+    for (port = TEST_PORT_FIRST; port <= TEST_PORT_LAST; ++port) {
+        if (sc_metrics_server_init(&server, &metrics, port)) {
+            break;
+        }
+    }
+    assert(port <= TEST_PORT_LAST);
+
+    ok = sc_metrics_server_start(&server);
+    assert(ok);
+
+    char *s = http_get(port, "GET /metrics HTTP/1.1\r\n"
+                             "Host: localhost\r\n\r\n");
+    assert(!strncmp(s, "HTTP/1.1 200 OK\r\n", 17));
+    assert(strstr(s, "Content-Type: text/plain; version=0.0.4"));
+    assert(strstr(s, "\nscrcpy_stream_bytes_total{stream=\"audio\"} 200\n"));
+    free(s);
+
+    s = http_get(port, "GET /other HTTP/1.1\r\n\r\n");
+    assert(!strncmp(s, "HTTP/1.1 404 Not Found\r\n", 24));
+    free(s);
+
+    // A client which never sends its request must not block the stop
+    sc_socket idle = net_socket();
+    assert(idle != SC_SOCKET_NONE);
+    ok = net_connect(idle, IPV4_LOCALHOST, port);
+    assert(ok);
+
+    sc_metrics_server_stop(&server);
+    sc_metrics_server_join(&server);
+    sc_metrics_server_destroy(&server);
+    net_close(idle);
+
+    sc_metrics_stop(&metrics);
+    sc_metrics_join(&metrics);
+    sc_metrics_destroy(&metrics);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = net_init();
+    assert(ok);
+
+    test_counters();
+    test_no_packet();
+    test_server();
+
+    net_cleanup();
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "util/mpsc_queue.h"
+#include "util/notifier.h"
+#include "util/thread.h"
+
+#define STRESS_PRODUCERS 4
+#define STRESS_ITEMS_PER_PRODUCER 100000
+
+struct item {
+    uint32_t producer;
+    uint32_t index;
+};
+
+static void test_mpsc_queue_push_pop(void) {
+    struct sc_mpsc_queue queue;
+    bool ok = sc_mpsc_queue_init(&queue, 4, sizeof(int));
+    assert(ok);
+
+    assert(sc_mpsc_queue_is_empty(&queue));
+    assert(sc_mpsc_queue_size(&queue) == 0);
+    assert(!sc_mpsc_queue_peek(&queue));
+
+    int v = 5;
+    ok = sc_mpsc_queue_push(&queue, &v);
+    assert(ok);
+    v = 12;
+    ok = sc_mpsc_queue_push(&queue, &v);
+    assert(ok);
+    assert(sc_mpsc_queue_size(&queue) == 2);
+
+    int *p = sc_mpsc_queue_peek(&queue);
+    assert(p);
+    assert(*p == 5);
+    // peek does not remove the item
+    assert(sc_mpsc_queue_size(&queue) == 2);
+
+    ok = sc_mpsc_queue_pop(&queue, &v);
+    assert(ok);
+    assert(v == 5);
+    ok = sc_mpsc_queue_pop(&queue, &v);
+    assert(ok);
+    assert(v == 12);
+
+    assert(sc_mpsc_queue_is_empty(&queue));
+    ok = sc_mpsc_queue_pop(&queue, &v);
+    assert(!ok);
+
+    sc_mpsc_queue_destroy(&queue);
+}
+
+static void test_mpsc_queue_full(void) {
+    struct sc_mpsc_queue queue;
+    bool ok = sc_mpsc_queue_init(&queue, 4, sizeof(int));
+    assert(ok);
+
+    // Wrap around several times
+    int next_push = 0;
+    int next_pop = 0;
+    for (int round = 0; round < 5; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            ok = sc_mpsc_queue_push(&queue, &next_push);
+            assert(ok);
+            ++next_push;
+        }
+        assert(sc_mpsc_queue_size(&queue) == 4);
+
+        int v = 42;
+        ok = sc_mpsc_queue_push(&queue, &v);
+        assert(!ok); // full
+
+        for (int i = 0; i < 3; ++i) {
+            ok = sc_mpsc_queue_pop(&queue, &v);
+            assert(ok);
+            assert(v == next_pop);
+            ++next_pop;
+        }
+        assert(sc_mpsc_queue_size(&queue) == 1);
+
+        ok = sc_mpsc_queue_pop(&queue, &v);
+        assert(ok);
+        assert(v == next_pop);
+        ++next_pop;
+    }
+
+    assert(sc_mpsc_queue_is_empty(&queue));
+
+    sc_mpsc_queue_destroy(&queue);
+}
+
+struct stress {
+    struct sc_mpsc_queue queue;
+    struct sc_notifier notifier;
+};
+
+struct producer {
+    struct stress *stress;
+    uint32_t id;
+};
+
+static int
+run_producer(void *data) {
+    struct producer *producer = data;
+    struct stress *stress = producer->stress;
+
+    for (uint32_t i = 0; i < STRESS_ITEMS_PER_PRODUCER; ++i) {
+        struct item item = {
+            .producer = producer->id,
+            .index = i,
+        };
+        while (!sc_mpsc_queue_push(&stress->queue, &item)) {
+            // Full, retry until the consumer catches up
+            sc_notifier_notify(&stress->notifier);
+        }
+        sc_notifier_notify(&stress->notifier);
+    }
+
+    return 0;
+}
+
+static void test_mpsc_queue_stress(void) {
+    struct stress stress;
+    bool ok = sc_mpsc_queue_init(&stress.queue, 64, sizeof(struct item));
+    assert(ok);
+    ok = sc_notifier_init(&stress.notifier);
+    assert(ok);
+
+    sc_thread threads[STRESS_PRODUCERS];
+    struct producer producers[STRESS_PRODUCERS];
+    for (uint32_t i = 0; i < STRESS_PRODUCERS; ++i) {
+        producers[i].stress = &stress;
+        producers[i].id = i;
+        ok = sc_thread_create(&threads[i], run_producer, "test-producer",
+                              &producers[i]);
+        assert(ok);
+    }
+
+    uint32_t next[STRESS_PRODUCERS] = {0};
+    unsigned remaining = STRESS_PRODUCERS * STRESS_ITEMS_PER_PRODUCER;
+    while (remaining) {
+        struct item item;
+        if (sc_mpsc_queue_pop(&stress.queue, &item)) {
+            // Nothing is lost nor duplicated, and the items of each producer
+            // are received in order
+            assert(item.producer < STRESS_PRODUCERS);
+            assert(item.index == next[item.producer]);
+            ++next[item.producer];
+            --remaining;
+            continue;
+        }
+
+        sc_notifier_prepare_wait(&stress.notifier);
+        if (!sc_mpsc_queue_is_empty(&stress.queue)) {
+            sc_notifier_cancel_wait(&stress.notifier);
+        } else {
+            sc_notifier_wait(&stress.notifier);
+        }
+    }
+
+    for (uint32_t i = 0; i < STRESS_PRODUCERS; ++i) {
+        sc_thread_join(&threads[i], NULL);
+        assert(next[i] == STRESS_ITEMS_PER_PRODUCER);
+    }
+
+    assert(sc_mpsc_queue_is_empty(&stress.queue));
+
+    sc_notifier_destroy(&stress.notifier);
+    sc_mpsc_queue_destroy(&stress.queue);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_mpsc_queue_push_pop();
+    test_mpsc_queue_full();
+    test_mpsc_queue_stress();
+
+    return 0;
+}
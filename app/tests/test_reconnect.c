@@ -0,0 +1,365 @@
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "demuxer.h"
+#include "link_monitor.h"
+#include "util/binary.h"
+#include "util/net.h"
+#include "util/socket_pair.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define TEST_PORT_FIRST 27280
+#define TEST_PORT_LAST 27299
+
+#define TEST_CODEC_ID_RAW UINT32_C(0x00726177) // "raw" in ASCII
+#define TEST_MAX_PACKETS 16
+#define TEST_TIMEOUT SC_TICK_FROM_SEC(5)
+
+struct test_state {
+    struct sc_packet_sink packet_sink; // packet sink trait
+
+    sc_mutex mutex;
+    sc_cond cond;
+
+    unsigned open_count;
+    unsigned close_count;
+    unsigned packet_count;
+    int64_t pts[TEST_MAX_PACKETS];
+    int64_t dts[TEST_MAX_PACKETS];
+
+    unsigned interrupted_count;
+    bool ended;
+    enum sc_demuxer_status status;
+
+    unsigned stalled_count;
+    unsigned retry_count;
+};
+
+#define DOWNCAST(SINK) container_of(SINK, struct test_state, packet_sink)
+
+static bool
+test_sink_open(struct sc_packet_sink *sink, AVCodecContext *ctx,
+               const struct sc_stream_session *session) {
+    (void) ctx;
+    (void) session;
+
+    struct test_state *state = DOWNCAST(sink);
+    sc_mutex_lock(&state->mutex);
+    ++state->open_count;
+    sc_mutex_unlock(&state->mutex);
+    return true;
+}
+
+static void
+test_sink_close(struct sc_packet_sink *sink) {
+    struct test_state *state = DOWNCAST(sink);
+    sc_mutex_lock(&state->mutex);
+    ++state->close_count;
+    sc_mutex_unlock(&state->mutex);
+}
+
+static bool
+test_sink_push(struct sc_packet_sink *sink, const AVPacket *packet) {
+    struct test_state *state = DOWNCAST(sink);
+    sc_mutex_lock(&state->mutex);
+    assert(state->packet_count < TEST_MAX_PACKETS);
+    state->pts[state->packet_count] = packet->pts;
+    state->dts[state->packet_count] = packet->dts;
+    ++state->packet_count;
+    sc_cond_broadcast(&state->cond);
+    sc_mutex_unlock(&state->mutex);
+    return true;
+}
+
+static void
+on_demuxer_ended(struct sc_demuxer *demuxer, enum sc_demuxer_status status,
+                 void *userdata) {
+    (void) demuxer;
+
+    struct test_state *state = userdata;
+    sc_mutex_lock(&state->mutex);
+    state->ended = true;
+    state->status = status;
+    sc_cond_broadcast(&state->cond);
+    sc_mutex_unlock(&state->mutex);
+}
+
+static void
+on_demuxer_interrupted(struct sc_demuxer *demuxer, void *userdata) {
+    (void) demuxer;
+
+    struct test_state *state = userdata;
+    sc_mutex_lock(&state->mutex);
+    ++state->interrupted_count;
+    sc_cond_broadcast(&state->cond);
+    sc_mutex_unlock(&state->mutex);
+}
+
+static const struct sc_demuxer_callbacks demuxer_cbs = {
+    .on_ended = on_demuxer_ended,
+    .on_interrupted = on_demuxer_interrupted,
+};
+
+static void
+on_link_stalled(struct sc_link_monitor *monitor, sc_tick elapsed,
+                void *userdata) {
+    (void) monitor;
+    (void) elapsed;
+
+    struct test_state *state = userdata;
+    sc_mutex_lock(&state->mutex);
+    ++state->stalled_count;
+    sc_cond_broadcast(&state->cond);
+    sc_mutex_unlock(&state->mutex);
+}
+
+static void
+on_link_retry(struct sc_link_monitor *monitor, void *userdata) {
+    (void) monitor;
+
+    struct test_state *state = userdata;
+    sc_mutex_lock(&state->mutex);
+    ++state->retry_count;
+    sc_cond_broadcast(&state->cond);
+    sc_mutex_unlock(&state->mutex);
+}
+
+static const struct sc_link_monitor_callbacks link_monitor_cbs = {
+    .on_stalled = on_link_stalled,
+    .on_retry = on_link_retry,
+};
+
+static void
+test_state_init(struct test_state *state) {
+    static const struct sc_packet_sink_ops ops = {
+        .open = test_sink_open,
+        .close = test_sink_close,
+        .push = test_sink_push,
+    };
+
+    memset(state, 0, sizeof(*state));
+    state->packet_sink.ops = &ops;
+
+    bool ok = sc_mutex_init(&state->mutex);
+    assert(ok);
+    ok = sc_cond_init(&state->cond);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+test_state_destroy(struct test_state *state) {
+    sc_cond_destroy(&state->cond);
+    sc_mutex_destroy(&state->mutex);
+}
+
+// Wait until the counter reaches the expected value
+static void
+test_state_wait(struct test_state *state, const unsigned *counter,
+                unsigned expected) {
+    sc_tick deadline = sc_tick_now() + TEST_TIMEOUT;
+
+    sc_mutex_lock(&state->mutex);
+    while (*counter < expected) {
+        bool ok = sc_cond_timedwait(&state->cond, &state->mutex, deadline);
+        assert(ok || *counter >= expected);
+        (void) ok;
+    }
+    sc_mutex_unlock(&state->mutex);
+}
+
+// Write the stream header, like the server on the device
+static void
+device_send_codec_id(sc_socket socket) {
+    uint8_t buf[4];
+    sc_write32be(buf, TEST_CODEC_ID_RAW);
+    ssize_t w = net_send_all(socket, buf, sizeof(buf));
+    assert(w == sizeof(buf));
+    (void) w;
+}
+
+static void
+device_send_packet(sc_socket socket, uint64_t pts) {
+    uint8_t buf[12 + 4];
+    sc_write64be(buf, pts);
+    sc_write32be(&buf[8], 4);
+    memset(&buf[12], 0, 4);
+    ssize_t w = net_send_all(socket, buf, sizeof(buf));
+    assert(w == sizeof(buf));
+    (void) w;
+}
+
+static void test_resume_after_disconnection(void) {
+    struct test_state state;
+    test_state_init(&state);
+
+    sc_socket sock;
+    sc_socket peer;
+    bool ok = create_socket_pair(&sock, &peer, TEST_PORT_FIRST,
+                                 TEST_PORT_LAST);
+    assert(ok);
+
+    struct sc_demuxer demuxer;
+    sc_demuxer_init(&demuxer, "test", sock, &demuxer_cbs, &state);
+    sc_packet_source_add_sink(&demuxer.packet_source, &state.packet_sink);
+    ok = sc_demuxer_enable_resume(&demuxer);
+    assert(ok);
+    ok = sc_demuxer_start(&demuxer);
+    assert(ok);
+
+    device_send_codec_id(peer);
+    device_send_packet(peer, 0);
+    device_send_packet(peer, 20000);
+    device_send_packet(peer, 40000);
+    test_state_wait(&state, &state.packet_count, 3);
+
+    // Kill the device connection in the middle of a packet header
+    uint8_t partial[6] = {0};
+    ssize_t w = net_send_all(peer, partial, sizeof(partial));
+    assert(w == sizeof(partial));
+    (void) w;
+    net_close(peer);
+
+    test_state_wait(&state, &state.interrupted_count, 1);
+    assert(sc_demuxer_is_interrupted(&demuxer));
+    net_close(sock);
+
+    // Simulate the time to restart the server
+    sc_tick resume_date = sc_tick_now() + SC_TICK_FROM_MS(50);
+    while (sc_tick_now() < resume_date) {
+        sc_mutex_lock(&state.mutex);
+        sc_cond_timedwait(&state.cond, &state.mutex, resume_date);
+        sc_mutex_unlock(&state.mutex);
+    }
+
+    // The new server restarts the PTS from 0
+    ok = create_socket_pair(&sock, &peer, TEST_PORT_FIRST, TEST_PORT_LAST);
+    assert(ok);
+    device_send_codec_id(peer);
+    device_send_packet(peer, 0);
+    device_send_packet(peer, 20000);
+    sc_demuxer_resume(&demuxer, sock);
+
+    test_state_wait(&state, &state.packet_count, 5);
+    assert(!sc_demuxer_is_interrupted(&demuxer));
+
+    // The sinks are not reopened
+    assert(state.open_count == 1);
+    assert(state.close_count == 0);
+    assert(!state.ended);
+    assert(demuxer.resume_count == 1);
+
+    // The PTS remain monotonic, and the interruption is preserved
+    assert(state.pts[1] - state.pts[0] == 20000);
+    assert(state.pts[2] - state.pts[1] == 20000);
+    assert(state.pts[3] - state.pts[2] >= 50000);
+    assert(state.pts[4] - state.pts[3] == 20000);
+    for (unsigned i = 0; i < 5; ++i) {
+        assert(state.dts[i] == state.pts[i]);
+    }
+
+    // Disconnect again, then stop while waiting for a new connection
+    net_close(peer);
+    test_state_wait(&state, &state.interrupted_count, 2);
+    sc_demuxer_stop(&demuxer);
+    sc_demuxer_join(&demuxer);
+    net_close(sock);
+
+    assert(state.ended);
+    assert(state.status == SC_DEMUXER_STATUS_EOS);
+    assert(state.open_count == 1);
+    assert(state.close_count == 1);
+    assert(state.packet_count == 5);
+
+    test_state_destroy(&state);
+}
+
+static void test_stall_detection(void) {
+    struct test_state state;
+    test_state_init(&state);
+
+    sc_socket sock;
+    sc_socket peer;
+    bool ok = create_socket_pair(&sock, &peer, TEST_PORT_FIRST,
+                                 TEST_PORT_LAST);
+    assert(ok);
+
+    struct sc_demuxer demuxer;
+    sc_demuxer_init(&demuxer, "test", sock, &demuxer_cbs, &state);
+    sc_packet_source_add_sink(&demuxer.packet_source, &state.packet_sink);
+    ok = sc_demuxer_enable_resume(&demuxer);
+    assert(ok);
+
+    struct sc_link_monitor monitor;
+    ok = sc_link_monitor_init(&monitor, SC_TICK_FROM_MS(200),
+                              &link_monitor_cbs, &state);
+    assert(ok);
+    sc_link_monitor_add_demuxer(&monitor, &demuxer);
+
+    ok = sc_demuxer_start(&demuxer);
+    assert(ok);
+    ok = sc_link_monitor_start(&monitor);
+    assert(ok);
+    sc_link_monitor_arm(&monitor);
+
+    device_send_codec_id(peer);
+    device_send_packet(peer, 0);
+    test_state_wait(&state, &state.packet_count, 1);
+    sc_tick last_packet_date = sc_tick_now();
+
+    // The connection is open, but the device does not send anything anymore
+    test_state_wait(&state, &state.stalled_count, 1);
+    assert(sc_tick_now() - last_packet_date >= SC_TICK_FROM_MS(150));
+    assert(state.interrupted_count == 0);
+
+    // The retries are scheduled by the monitor
+    sc_link_monitor_schedule_retry(&monitor,
+                                   sc_tick_now() + SC_TICK_FROM_MS(20));
+    test_state_wait(&state, &state.retry_count, 1);
+
+    sc_link_monitor_stop(&monitor);
+    sc_link_monitor_join(&monitor);
+
+    // A stall is reported only once per arming
+    assert(state.stalled_count == 1);
+
+    // Like on reconnection, interrupt the socket to release the demuxer
+    net_interrupt(sock);
+    test_state_wait(&state, &state.interrupted_count, 1);
+    sc_demuxer_stop(&demuxer);
+    sc_demuxer_join(&demuxer);
+    sc_link_monitor_destroy(&monitor);
+
+    net_close(sock);
+    net_close(peer);
+    test_state_destroy(&state);
+}
+
+static void test_retry_delay(void) {
+    assert(sc_link_monitor_get_retry_delay(0) == SC_TICK_FROM_SEC(1));
+    assert(sc_link_monitor_get_retry_delay(1) == SC_TICK_FROM_SEC(2));
+    assert(sc_link_monitor_get_retry_delay(2) == SC_TICK_FROM_SEC(4));
+    assert(sc_link_monitor_get_retry_delay(4) == SC_TICK_FROM_SEC(16));
+    assert(sc_link_monitor_get_retry_delay(5) == SC_TICK_FROM_SEC(16));
+    assert(sc_link_monitor_get_retry_delay(1000) == SC_TICK_FROM_SEC(16));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = net_init();
+    assert(ok);
+
+    test_resume_after_disconnection();
+    test_stall_detection();
+    test_retry_delay();
+
+    net_cleanup();
+    return 0;
+}
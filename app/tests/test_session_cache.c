@@ -0,0 +1,149 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "session_cache.h"
+
+#define CACHE_PATH "test_session_cache.tmp"
+
+#define CODEC_H264 UINT32_C(0x68323634)
+#define CODEC_H265 UINT32_C(0x68323635)
+
+static void test_session_cache_load_save(void) {
+    remove(CACHE_PATH);
+
+    struct sc_session_hint hint;
+    // No file yet
+    assert(!sc_session_cache_load(CACHE_PATH, "0123456789abcdef", &hint));
+
+    struct sc_session_hint hint1 = {
+        .codec_id = CODEC_H264,
+        .width = 1080,
+        .height = 2400,
+        .color_space = 1,
+        .color_range = 1,
+    };
+    struct sc_session_hint hint2 = {
+        .codec_id = CODEC_H265,
+        .width = 1920,
+        .height = 1080,
+        .color_space = 0,
+        .color_range = 0,
+    };
+
+    bool ok = sc_session_cache_save(CACHE_PATH, "0123456789abcdef", &hint1);
+    assert(ok);
+    ok = sc_session_cache_save(CACHE_PATH, "192.168.1.1:5555", &hint2);
+    assert(ok);
+
+    ok = sc_session_cache_load(CACHE_PATH, "0123456789abcdef", &hint);
+    assert(ok);
+    assert(!memcmp(&hint, &hint1, sizeof(hint)));
+
+    ok = sc_session_cache_load(CACHE_PATH, "192.168.1.1:5555", &hint);
+    assert(ok);
+    assert(!memcmp(&hint, &hint2, sizeof(hint)));
+
+    assert(!sc_session_cache_load(CACHE_PATH, "unknown", &hint));
+
+    // Replace an entry (the device has been rotated)
+    hint1.width = 2400;
+    hint1.height = 1080;
+    ok = sc_session_cache_save(CACHE_PATH, "0123456789abcdef", &hint1);
+    assert(ok);
+
+    ok = sc_session_cache_load(CACHE_PATH, "0123456789abcdef", &hint);
+    assert(ok);
+    assert(hint.width == 2400);
+    assert(hint.height == 1080);
+
+    // The other entry is preserved
+    ok = sc_session_cache_load(CACHE_PATH, "192.168.1.1:5555", &hint);
+    assert(ok);
+    assert(!memcmp(&hint, &hint2, sizeof(hint)));
+
+    // Serials containing spaces cannot be stored
+    assert(!sc_session_cache_save(CACHE_PATH, "a b", &hint1));
+
+    remove(CACHE_PATH);
+}
+
+static void test_session_cache_invalid_lines(void) {
+    FILE *file = fopen(CACHE_PATH, "w");
+    assert(file);
+    fputs("garbage\n", file);
+    fputs("serial1 68323634 0 1080 0 0\n", file); // invalid width
+    fputs("serial2 68323634 1080 2400 1 2", file); // no final '\n'
+    fclose(file);
+
+    struct sc_session_hint hint;
+    assert(!sc_session_cache_load(CACHE_PATH, "garbage", &hint));
+    assert(!sc_session_cache_load(CACHE_PATH, "serial1", &hint));
+
+    bool ok = sc_session_cache_load(CACHE_PATH, "serial2", &hint);
+    assert(ok);
+    assert(hint.codec_id == CODEC_H264);
+    assert(hint.width == 1080);
+    assert(hint.height == 2400);
+    assert(hint.color_space == 1);
+    assert(hint.color_range == 2);
+
+    // Saving drops the invalid lines, and terminates the last line
+    struct sc_session_hint hint3 = {
+        .codec_id = CODEC_H265,
+        .width = 720,
+        .height = 1280,
+    };
+    ok = sc_session_cache_save(CACHE_PATH, "serial3", &hint3);
+    assert(ok);
+
+    ok = sc_session_cache_load(CACHE_PATH, "serial2", &hint);
+    assert(ok);
+    assert(hint.color_range == 2);
+    ok = sc_session_cache_load(CACHE_PATH, "serial3", &hint);
+    assert(ok);
+    assert(hint.width == 720);
+
+    remove(CACHE_PATH);
+}
+
+static void test_session_cache_max_entries(void) {
+    remove(CACHE_PATH);
+
+    struct sc_session_hint hint = {
+        .codec_id = CODEC_H264,
+        .width = 1080,
+        .height = 2400,
+    };
+
+    char serial[16];
+    for (unsigned i = 0; i < SC_SESSION_CACHE_MAX_ENTRIES + 2; ++i) {
+        sprintf(serial, "device%u", i);
+        bool ok = sc_session_cache_save(CACHE_PATH, serial, &hint);
+        assert(ok);
+    }
+
+    // The 2 oldest entries are forgotten
+    struct sc_session_hint out;
+    assert(!sc_session_cache_load(CACHE_PATH, "device0", &out));
+    assert(!sc_session_cache_load(CACHE_PATH, "device1", &out));
+    for (unsigned i = 2; i < SC_SESSION_CACHE_MAX_ENTRIES + 2; ++i) {
+        sprintf(serial, "device%u", i);
+        assert(sc_session_cache_load(CACHE_PATH, serial, &out));
+    }
+
+    remove(CACHE_PATH);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_session_cache_load_save();
+    test_session_cache_invalid_lines();
+    test_session_cache_max_entries();
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "tile_layout.h"
+
+static void test_grid_single(void) {
+    struct sc_size render = {1920, 1080};
+    struct sc_size content = {1080, 2400};
+
+    struct sc_tile_grid grid = sc_tile_grid_compute(render, 1, content);
+    assert(grid.columns == 1);
+    assert(grid.rows == 1);
+}
+
+static void test_grid_portrait_contents(void) {
+    // Portrait devices in a landscape window: a single row
+    struct sc_size render = {1920, 1080};
+    struct sc_size content = {1080, 2400};
+
+    struct sc_tile_grid grid = sc_tile_grid_compute(render, 4, content);
+    assert(grid.columns == 4);
+    assert(grid.rows == 1);
+
+    // Too many devices for a single row
+    grid = sc_tile_grid_compute(render, 16, content);
+    assert(grid.columns == 8);
+    assert(grid.rows == 2);
+}
+
+static void test_grid_landscape_contents(void) {
+    // Landscape contents in a landscape window: a square grid
+    struct sc_size render = {1920, 1080};
+    struct sc_size content = {1920, 1080};
+
+    struct sc_tile_grid grid = sc_tile_grid_compute(render, 4, content);
+    assert(grid.columns == 2);
+    assert(grid.rows == 2);
+
+    grid = sc_tile_grid_compute(render, 3, content);
+    assert(grid.columns == 2);
+    assert(grid.rows == 2);
+}
+
+static void test_cells(void) {
+    struct sc_size render = {1000, 600};
+    struct sc_tile_grid grid = {
+        .columns = 4,
+        .rows = 2,
+    };
+
+    SDL_FRect cell;
+    sc_tile_grid_get_cell(grid, render, 0, &cell);
+    assert(cell.x == 0);
+    assert(cell.y == 0);
+    assert(cell.w == 250);
+    assert(cell.h == 300);
+
+    sc_tile_grid_get_cell(grid, render, 6, &cell);
+    assert(cell.x == 500);
+    assert(cell.y == 300);
+    assert(cell.w == 250);
+    assert(cell.h == 300);
+}
+
+static void test_fit(void) {
+    SDL_FRect cell = {
+        .x = 500,
+        .y = 300,
+        .w = 250,
+        .h = 300,
+    };
+
+    // Portrait content: the height is preserved
+    struct sc_size content = {500, 1000};
+    SDL_FRect rect;
+    sc_tile_fit(&cell, content, &rect);
+    assert(rect.x == 550);
+    assert(rect.y == 300);
+    assert(rect.w == 150);
+    assert(rect.h == 300);
+
+    // Landscape content: the width is preserved
+    content.width = 1000;
+    content.height = 500;
+    sc_tile_fit(&cell, content, &rect);
+    assert(rect.x == 500);
+    assert(rect.y == 387.5f);
+    assert(rect.w == 250);
+    assert(rect.h == 125);
+}
+
+static void test_index_at(void) {
+    struct sc_size render = {1000, 600};
+    struct sc_tile_grid grid = {
+        .columns = 4,
+        .rows = 2,
+    };
+
+    assert(sc_tile_grid_get_index_at(grid, render, 7, 0, 0) == 0);
+    assert(sc_tile_grid_get_index_at(grid, render, 7, 260, 10) == 1);
+    assert(sc_tile_grid_get_index_at(grid, render, 7, 999, 10) == 3);
+    assert(sc_tile_grid_get_index_at(grid, render, 7, 10, 300) == 4);
+    assert(sc_tile_grid_get_index_at(grid, render, 7, 600, 599) == 6);
+
+    // Empty cell
+    assert(sc_tile_grid_get_index_at(grid, render, 7, 999, 599) == -1);
+
+    // Out of the window
+    assert(sc_tile_grid_get_index_at(grid, render, 7, -1, 10) == -1);
+    assert(sc_tile_grid_get_index_at(grid, render, 7, 10, 600) == -1);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_grid_single();
+    test_grid_portrait_contents();
+    test_grid_landscape_contents();
+    test_cells();
+    test_fit();
+    test_index_at();
+
+    return 0;
+}
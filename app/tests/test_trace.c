@@ -0,0 +1,132 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/thread.h"
+#include "util/tick.h"
+#include "util/trace.h"
+
+#define TRACE_PATH "test_trace.tmp.json"
+
+#define THREADS 4
+#define SPANS_PER_THREAD 100
+
+static char *read_file(const char *path) {
+    FILE *file = fopen(path, "rb");
+    assert(file);
+
+    int r = fseek(file, 0, SEEK_END);
+    assert(!r);
+    long size = ftell(file);
+    assert(size >= 0);
+    rewind(file);
+
+    char *data = malloc(size + 1);
+    assert(data);
+    size_t read = fread(data, 1, size, file);
+    assert(read == (size_t) size);
+    data[size] = '\0';
+
+    fclose(file);
+    return data;
+}
+
+static unsigned count_occurrences(const char *s, const char *needle) {
+    unsigned count = 0;
+    size_t len = strlen(needle);
+    while ((s = strstr(s, needle))) {
+        ++count;
+        s += len;
+    }
+    return count;
+}
+
+static void test_disabled(void) {
+    // Nothing is recorded before the trace is started
+    assert(sc_trace_begin() == SC_TICK_NONE);
+    sc_trace_end("ignored", SC_TICK_NONE);
+    sc_trace_add("ignored", 0, 1);
+}
+
+static void test_spans(void) {
+    bool ok = sc_trace_start(TRACE_PATH);
+    assert(ok);
+
+    sc_tick trace = sc_trace_begin();
+    assert(trace != SC_TICK_NONE);
+    sc_trace_end("first", trace);
+
+    sc_trace_add("second", 1000, 42);
+
+    sc_trace_stop();
+
+    // Not recorded anymore
+    assert(sc_trace_begin() == SC_TICK_NONE);
+
+    char *data = read_file(TRACE_PATH);
+    assert(!strncmp(data, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[",
+                    strlen("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[")));
+    assert(!strcmp(data + strlen(data) - 4, "\n]}\n"));
+
+    const char *first = strstr(data, "{\"name\":\"first\",");
+    const char *second = strstr(data, "{\"name\":\"second\",\"cat\":\"scrcpy\","
+                                      "\"ph\":\"X\",\"ts\":1000,\"dur\":42,");
+    assert(first);
+    assert(second);
+    // In order, separated by a comma
+    assert(first < second);
+    assert(count_occurrences(data, "},\n{") == 1);
+
+    free(data);
+    remove(TRACE_PATH);
+}
+
+static int
+run_spans(void *data) {
+    (void) data;
+
+    for (unsigned i = 0; i < SPANS_PER_THREAD; ++i) {
+        sc_tick trace = sc_trace_begin();
+        sc_trace_end("span", trace);
+    }
+
+    return 0;
+}
+
+static void test_threads(void) {
+    bool ok = sc_trace_start(TRACE_PATH);
+    assert(ok);
+
+    sc_thread threads[THREADS];
+    for (unsigned i = 0; i < THREADS; ++i) {
+        ok = sc_thread_create(&threads[i], run_spans, "test-trace", NULL);
+        assert(ok);
+    }
+
+    for (unsigned i = 0; i < THREADS; ++i) {
+        sc_thread_join(&threads[i], NULL);
+    }
+
+    sc_trace_stop();
+
+    char *data = read_file(TRACE_PATH);
+    // The queue is large enough, no event is dropped
+    assert(count_occurrences(data, "{\"name\":\"span\",")
+            == THREADS * SPANS_PER_THREAD);
+    free(data);
+    remove(TRACE_PATH);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_disabled();
+    test_spans();
+    test_threads();
+
+    return 0;
+}
@@ -184,6 +184,46 @@ static void test_vecdeque_push_hole(void) {
     sc_vecdeque_destroy(&vdq);
 }
 
+static void test_vecdeque_getref(void) {
+    struct SC_VECDEQUE(int) vdq = SC_VECDEQUE_INITIALIZER;
+
+    bool ok = sc_vecdeque_reserve(&vdq, 10);
+    assert(ok);
+
+    for (int i = 0; i < 8; ++i) {
+        ok = sc_vecdeque_push(&vdq, i);
+        assert(ok);
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        int v = sc_vecdeque_pop(&vdq);
+        assert(v == i);
+    }
+
+    // Wrap around the end of the buffer
+    for (int i = 8; i < 14; ++i) {
+        ok = sc_vecdeque_push(&vdq, i);
+        assert(ok);
+    }
+
+    assert(vdq.cap == 10);
+    assert(sc_vecdeque_size(&vdq) == 9);
+
+    for (int i = 0; i < 9; ++i) {
+        int *p = sc_vecdeque_getref(&vdq, i);
+        assert(*p == i + 5);
+    }
+
+    *(int *) sc_vecdeque_getref(&vdq, 8) = 42;
+    for (int i = 5; i < 13; ++i) {
+        int v = sc_vecdeque_pop(&vdq);
+        assert(v == i);
+    }
+    assert(sc_vecdeque_pop(&vdq) == 42);
+
+    sc_vecdeque_destroy(&vdq);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -192,6 +232,7 @@ int main(int argc, char *argv[]) {
     test_vecdeque_reserve();
     test_vecdeque_grow();
     test_vecdeque_push_hole();
+    test_vecdeque_getref();
 
     return 0;
 }
@@ -0,0 +1,9 @@
+#ifndef SC_TEST_BENCH_H
+#define SC_TEST_BENCH_H
+
+#include "common.h"
+
+// Exit code to report a skipped test to meson
+#define BENCH_SKIP 77
+
+#endif
@@ -0,0 +1,224 @@
+#include "fake_adb_server.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/binary.h"
+
+static bool
+recv_request(sc_socket socket, char *service, size_t len) {
+    char hex[5];
+    if (net_recv_all(socket, hex, 4) != 4) {
+        return false;
+    }
+    hex[4] = '\0';
+
+    size_t service_len = strtoul(hex, NULL, 16);
+    assert(service_len < len);
+    if (net_recv_all(socket, service, service_len) != (ssize_t) service_len) {
+        return false;
+    }
+    service[service_len] = '\0';
+    return true;
+}
+
+static void
+send_string(sc_socket socket, const char *s) {
+    char hex[5];
+    int r = snprintf(hex, sizeof(hex), "%04x", (unsigned) strlen(s));
+    assert(r == 4);
+    (void) r;
+    net_send_all(socket, hex, 4);
+    net_send_all(socket, s, strlen(s));
+}
+
+static void
+send_okay(sc_socket socket) {
+    net_send_all(socket, "OKAY", 4);
+}
+
+static void
+send_fail(sc_socket socket, const char *msg) {
+    net_send_all(socket, "FAIL", 4);
+    send_string(socket, msg);
+}
+
+static void
+handle_sync(struct fake_adb_server *server, sc_socket socket) {
+    for (;;) {
+        uint8_t header[8];
+        if (net_recv_all(socket, header, sizeof(header)) != sizeof(header)) {
+            return;
+        }
+
+        uint32_t len = sc_read32le(&header[4]);
+        if (!memcmp(header, "STAT", 4)) {
+            char path[256];
+            assert(len < sizeof(path));
+            ssize_t r = net_recv_all(socket, path, len);
+            assert(r == (ssize_t) len);
+            path[len] = '\0';
+
+            // Only FAKE_ADB_DIR exists (mode 0 means "does not exist")
+            uint32_t mode = strcmp(path, FAKE_ADB_DIR) ? 0 : 040755;
+            uint8_t stat[16] = {'S', 'T', 'A', 'T'};
+            sc_write32le(&stat[4], mode);
+            net_send_all(socket, stat, sizeof(stat));
+        } else if (!memcmp(header, "SEND", 4)) {
+            assert(len < sizeof(server->push_path));
+            ssize_t r = net_recv_all(socket, server->push_path, len);
+            assert(r == (ssize_t) len);
+            server->push_path[len] = '\0';
+            server->push_len = 0;
+        } else if (!memcmp(header, "DATA", 4)) {
+            assert(len <= 64 * 1024);
+            assert(server->push_len + len <= FAKE_ADB_PUSH_MAX_SIZE);
+            ssize_t r = net_recv_all(socket,
+                                     &server->push_data[server->push_len],
+                                     len);
+            assert(r == (ssize_t) len);
+            server->push_len += len;
+        } else if (!memcmp(header, "DONE", 4)) {
+            uint8_t okay[8] = {'O', 'K', 'A', 'Y', 0, 0, 0, 0};
+            net_send_all(socket, okay, sizeof(okay));
+        } else {
+            assert(!memcmp(header, "QUIT", 4));
+            return;
+        }
+    }
+}
+
+static void
+handle_connection(struct fake_adb_server *server, sc_socket socket) {
+    bool transport = false;
+    char service[1024];
+    while (recv_request(socket, service, sizeof(service))) {
+        if (!strcmp(service, "host:version")) {
+            send_okay(socket);
+            send_string(socket, "0029");
+            return;
+        }
+
+        if (!strcmp(service, "host:devices-l")) {
+            send_okay(socket);
+            send_string(socket, FAKE_ADB_SERIAL "         device usb:1-1 "
+                                "product:p model:Pixel_8 device:d "
+                                "transport_id:1\n");
+            return;
+        }
+
+        if (!strncmp(service, "host:transport:", 15)) {
+            if (strcmp(&service[15], FAKE_ADB_SERIAL)) {
+                send_fail(socket, "device not found");
+                return;
+            }
+            send_okay(socket);
+            transport = true;
+            continue;
+        }
+
+        if (!strncmp(service, "host-serial:" FAKE_ADB_SERIAL ":", 29)) {
+            // forward or killforward: connected, then the result
+            strcpy(server->forward, &service[29]);
+            send_okay(socket);
+            send_okay(socket);
+            return;
+        }
+
+        if (transport && !strncmp(service, "shell:", 6)) {
+            send_okay(socket);
+            const char *command = &service[6];
+            if (!strcmp(command, "getprop ro.build.version.sdk")) {
+                net_send_all(socket, "34\n", 3);
+            } else if (!strcmp(command, "ip route")) {
+                const char *route = "192.168.1.0/24 dev wlan0 proto kernel "
+                                    "scope link src 192.168.1.42\n";
+                net_send_all(socket, route, strlen(route));
+            }
+            return;
+        }
+
+        if (transport && !strncmp(service, "reverse:", 8)) {
+            strcpy(server->reverse, &service[8]);
+            send_okay(socket);
+            send_okay(socket);
+            return;
+        }
+
+        if (transport && !strcmp(service, "sync:")) {
+            send_okay(socket);
+            handle_sync(server, socket);
+            return;
+        }
+
+        send_fail(socket, "unknown service");
+        return;
+    }
+}
+
+static int
+run_fake_adb_server(void *data) {
+    struct fake_adb_server *server = data;
+
+    for (;;) {
+        sc_socket socket = net_accept(server->server_socket);
+        if (socket == SC_SOCKET_NONE) {
+            return 0;
+        }
+
+        ++server->connections;
+        handle_connection(server, socket);
+        net_close(socket);
+    }
+}
+
+bool
+fake_adb_server_start(struct fake_adb_server *server, uint16_t port_first,
+                      uint16_t port_last) {
+    memset(server, 0, sizeof(*server));
+
+    server->server_socket = SC_SOCKET_NONE;
+    for (uint16_t port = port_first; port <= port_last; ++port) {
+        sc_socket socket = net_socket();
+        if (socket == SC_SOCKET_NONE) {
+            return false;
+        }
+        if (net_listen(socket, IPV4_LOCALHOST, port, 8)) {
+            server->server_socket = socket;
+            server->port = port;
+            break;
+        }
+        net_close(socket);
+    }
+
+    if (server->server_socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    server->push_data = malloc(FAKE_ADB_PUSH_MAX_SIZE);
+    if (!server->push_data) {
+        net_close(server->server_socket);
+        return false;
+    }
+
+    bool ok = sc_thread_create(&server->thread, run_fake_adb_server,
+                               "test-adb", server);
+    if (!ok) {
+        free(server->push_data);
+        net_close(server->server_socket);
+        return false;
+    }
+
+    return true;
+}
+
+void
+fake_adb_server_stop(struct fake_adb_server *server) {
+    net_interrupt(server->server_socket);
+    sc_thread_join(&server->thread, NULL);
+    net_close(server->server_socket);
+    free(server->push_data);
+}
+
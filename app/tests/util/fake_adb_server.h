@@ -0,0 +1,49 @@
+#ifndef SC_TEST_FAKE_ADB_SERVER_H
+#define SC_TEST_FAKE_ADB_SERVER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/net.h"
+#include "util/thread.h"
+
+// The only device connected to the fake adb server
+#define FAKE_ADB_SERIAL "0123456789abcdef"
+// The only directory on the fake device
+#define FAKE_ADB_DIR "/sdcard/Download"
+// The maximum size of a pushed file
+#define FAKE_ADB_PUSH_MAX_SIZE (256 * 1024)
+
+/**
+ * Minimal stand-in for the adb server (host protocol on localhost)
+ */
+struct fake_adb_server {
+    sc_socket server_socket;
+    uint16_t port;
+    sc_thread thread;
+
+    // Written by the server thread, read by the test once the request is
+    // completed
+    char forward[256];
+    char reverse[256];
+    char push_path[256];
+    uint8_t *push_data;
+    size_t push_len;
+    unsigned connections;
+};
+
+/**
+ * Listen on the first available port in [port_first, port_last], and serve
+ * the connections from a separate thread
+ */
+bool
+fake_adb_server_start(struct fake_adb_server *server, uint16_t port_first,
+                      uint16_t port_last);
+
+void
+fake_adb_server_stop(struct fake_adb_server *server);
+
+#endif
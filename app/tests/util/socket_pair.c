@@ -0,0 +1,39 @@
+#include "socket_pair.h"
+
+#include <assert.h>
+
+bool
+create_socket_pair(sc_socket *psock1, sc_socket *psock2, uint16_t port_first,
+                   uint16_t port_last) {
+    sc_socket server_socket = SC_SOCKET_NONE;
+    uint16_t port;
+    for (port = port_first; port <= port_last; ++port) {
+        server_socket = net_socket();
+        if (server_socket == SC_SOCKET_NONE) {
+            return false;
+        }
+        if (net_listen(server_socket, IPV4_LOCALHOST, port, 1)) {
+            break;
+        }
+        net_close(server_socket);
+        server_socket = SC_SOCKET_NONE;
+    }
+
+    if (server_socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    sc_socket sock1 = net_socket();
+    assert(sock1 != SC_SOCKET_NONE);
+    bool ok = net_connect(sock1, IPV4_LOCALHOST, port);
+    assert(ok);
+    (void) ok;
+
+    sc_socket sock2 = net_accept(server_socket);
+    assert(sock2 != SC_SOCKET_NONE);
+    net_close(server_socket);
+
+    *psock1 = sock1;
+    *psock2 = sock2;
+    return true;
+}
@@ -0,0 +1,22 @@
+#ifndef SC_TEST_SOCKET_PAIR_H
+#define SC_TEST_SOCKET_PAIR_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/net.h"
+
+/**
+ * Create a pair of connected sockets over the loopback interface
+ *
+ * The server socket listens on the first available port in the range
+ * [port_first, port_last]. Each test uses its own range, so that tests may run
+ * in parallel.
+ */
+bool
+create_socket_pair(sc_socket *psock1, sc_socket *psock2, uint16_t port_first,
+                   uint16_t port_last);
+
+#endif
@@ -60,6 +60,7 @@ public class Options {
     private String audioEncoder;
     private boolean powerOffScreenOnClose;
     private boolean clipboardAutosync = true;
+    private boolean compactControl;
     private boolean downsizeOnError = true;
     private boolean cleanup = true;
     private boolean powerOn = true;
@@ -230,6 +231,10 @@ public class Options {
         return clipboardAutosync;
     }
 
+    public boolean getCompactControl() {
+        return compactControl;
+    }
+
     public boolean getDownsizeOnError() {
         return downsizeOnError;
     }
@@ -438,6 +443,9 @@ public class Options {
                 case "clipboard_autosync":
                     options.clipboardAutosync = Boolean.parseBoolean(value);
                     break;
+                case "compact_control":
+                    options.compactControl = Boolean.parseBoolean(value);
+                    break;
                 case "downsize_on_error":
                     options.downsizeOnError = Boolean.parseBoolean(value);
                     break;
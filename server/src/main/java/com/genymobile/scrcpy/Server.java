@@ -113,6 +113,7 @@ public final class Server {
 
             if (control) {
                 ControlChannel controlChannel = connection.getControlChannel();
+                controlChannel.setCompactEncoding(options.getCompactControl());
                 controller = new Controller(controlChannel, cleanUp, options);
                 asyncProcessors.add(controller);
             }
@@ -14,6 +14,10 @@ public final class ControlChannel {
         writer = new DeviceMessageWriter(controlSocket.getOutputStream());
     }
 
+    public void setCompactEncoding(boolean compact) {
+        reader.setCompactEncoding(compact);
+    }
+
     public ControlMessage recv() throws IOException {
         return reader.read();
     }
@@ -28,6 +28,11 @@ public final class ControlMessage {
     public static final int TYPE_CAMERA_SET_TORCH = 18;
     public static final int TYPE_CAMERA_ZOOM_IN = 19;
     public static final int TYPE_CAMERA_ZOOM_OUT = 20;
+    // Fragment of a serialized message (never returned by ControlMessageReader)
+    public static final int TYPE_FRAGMENT = 21;
+    public static final int TYPE_LATENCY_PROBE = 22;
+    // Touch event relative to the previous one of the same pointer (returned as TYPE_INJECT_TOUCH_EVENT by ControlMessageReader)
+    public static final int TYPE_INJECT_TOUCH_EVENT_COMPACT = 23;
 
     public static final long SEQUENCE_INVALID = 0;
 
@@ -169,6 +174,13 @@ public final class ControlMessage {
         return msg;
     }
 
+    public static ControlMessage createLatencyProbe(long sequence) {
+        ControlMessage msg = new ControlMessage();
+        msg.type = TYPE_LATENCY_PROBE;
+        msg.sequence = sequence;
+        return msg;
+    }
+
     public static ControlMessage createCameraSetTorch(boolean on) {
         ControlMessage msg = new ControlMessage();
         msg.type = TYPE_CAMERA_SET_TORCH;
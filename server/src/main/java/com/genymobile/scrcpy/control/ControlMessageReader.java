@@ -4,6 +4,8 @@ import com.genymobile.scrcpy.device.Position;
 import com.genymobile.scrcpy.util.Binary;
 
 import java.io.BufferedInputStream;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
 import java.io.DataInputStream;
 import java.io.IOException;
 import java.io.InputStream;
@@ -16,14 +18,76 @@ public class ControlMessageReader {
     public static final int CLIPBOARD_TEXT_MAX_LENGTH = MESSAGE_MAX_SIZE - 14; // type: 1 byte; sequence: 8 bytes; paste flag: 1 byte; length: 4 bytes
     public static final int INJECT_TEXT_MAX_LENGTH = 300;
 
+    // Must match the client
+    public static final int COMPACT_POINTERS = 16;
+    private static final int COMPACT_ACTION_MASK = 0x0f;
+    private static final int COMPACT_FLAG_NEW_POINTER = 0x10;
+    private static final int COMPACT_FLAG_SCREEN_SIZE = 0x20;
+    private static final int COMPACT_FLAG_PRESSURE = 0x40;
+    private static final int COMPACT_FLAG_BUTTONS = 0x80;
+
+    // State of a pointer slot for the compact encoding of touch events
+    private static final class CompactPointer {
+        private long pointerId;
+        private int x;
+        private int y;
+        private int screenWidth;
+        private int screenHeight;
+        private short pressure;
+        private int actionButton;
+        private int buttons;
+
+        private void reset(long pointerId) {
+            this.pointerId = pointerId;
+            x = 0;
+            y = 0;
+            screenWidth = 0;
+            screenHeight = 0;
+            pressure = 0;
+            actionButton = 0;
+            buttons = 0;
+        }
+    }
+
     private final DataInputStream dis;
 
+    // Reassembly buffer for fragmented messages, which may be interleaved with other messages
+    private final ByteArrayOutputStream fragments = new ByteArrayOutputStream();
+
+    // Only allocated if the compact encoding is enabled
+    private CompactPointer[] compactPointers;
+
     public ControlMessageReader(InputStream rawInputStream) {
         dis = new DataInputStream(new BufferedInputStream(rawInputStream));
     }
 
+    public void setCompactEncoding(boolean compact) {
+        if (compact) {
+            compactPointers = new CompactPointer[COMPACT_POINTERS];
+            for (int i = 0; i < COMPACT_POINTERS; ++i) {
+                compactPointers[i] = new CompactPointer();
+            }
+        } else {
+            compactPointers = null;
+        }
+    }
+
     public ControlMessage read() throws IOException {
-        int type = dis.readUnsignedByte();
+        for (;;) {
+            int type = dis.readUnsignedByte();
+            if (type == ControlMessage.TYPE_FRAGMENT) {
+                ControlMessage msg = parseFragment();
+                if (msg != null) {
+                    return msg;
+                }
+                // The fragmented message is not complete yet
+                continue;
+            }
+            return parse(type);
+        }
+    }
+
+    private ControlMessage parse(int type) throws IOException {
         switch (type) {
             case ControlMessage.TYPE_INJECT_KEYCODE:
                 return parseInjectKeycode();
@@ -60,11 +124,37 @@ public class ControlMessageReader {
                 return parseStartApp();
             case ControlMessage.TYPE_CAMERA_SET_TORCH:
                 return parseCameraSetTorch();
+            case ControlMessage.TYPE_LATENCY_PROBE:
+                return parseLatencyProbe();
+            case ControlMessage.TYPE_INJECT_TOUCH_EVENT_COMPACT:
+                return parseInjectTouchEventCompact();
             default:
                 throw new ControlProtocolException("Unknown event type: " + type);
         }
     }
 
+    private ControlMessage parseFragment() throws IOException {
+        boolean last = dis.readByte() != 0;
+        byte[] data = parseByteArray(2);
+        if (fragments.size() + data.length > MESSAGE_MAX_SIZE) {
+            throw new ControlProtocolException("Fragmented message too large");
+        }
+        fragments.write(data, 0, data.length);
+        if (!last) {
+            return null;
+        }
+
+        byte[] message = fragments.toByteArray();
+        fragments.reset();
+
+        if (message.length == 0 || (message[0] & 0xff) == ControlMessage.TYPE_FRAGMENT) {
+            throw new ControlProtocolException("Invalid fragmented message");
+        }
+
+        ControlMessageReader reader = new ControlMessageReader(new ByteArrayInputStream(message));
+        return reader.read();
+    }
+
     private ControlMessage parseInjectKeycode() throws IOException {
         int action = dis.readUnsignedByte();
         int keycode = dis.readInt();
@@ -114,6 +204,55 @@ public class ControlMessageReader {
         return ControlMessage.createInjectTouchEvent(action, pointerId, position, pressure, actionButton, buttons);
     }
 
+    private ControlMessage parseInjectTouchEventCompact() throws IOException {
+        if (compactPointers == null) {
+            throw new ControlProtocolException("Compact encoding not enabled");
+        }
+
+        int header = dis.readUnsignedByte();
+        int slot = dis.readUnsignedByte();
+        if (slot >= COMPACT_POINTERS) {
+            throw new ControlProtocolException("Invalid pointer slot: " + slot);
+        }
+
+        CompactPointer pointer = compactPointers[slot];
+        if ((header & COMPACT_FLAG_NEW_POINTER) != 0) {
+            pointer.reset(Binary.zigzagDecode(parseVarint()));
+        }
+
+        pointer.x += (int) Binary.zigzagDecode(parseVarint());
+        pointer.y += (int) Binary.zigzagDecode(parseVarint());
+
+        if ((header & COMPACT_FLAG_SCREEN_SIZE) != 0) {
+            pointer.screenWidth = (int) parseVarint() & 0xffff;
+            pointer.screenHeight = (int) parseVarint() & 0xffff;
+        }
+        if ((header & COMPACT_FLAG_PRESSURE) != 0) {
+            pointer.pressure = dis.readShort();
+        }
+        if ((header & COMPACT_FLAG_BUTTONS) != 0) {
+            pointer.actionButton = (int) parseVarint();
+            pointer.buttons = (int) parseVarint();
+        }
+
+        int action = header & COMPACT_ACTION_MASK;
+        Position position = new Position(pointer.x, pointer.y, pointer.screenWidth, pointer.screenHeight);
+        float pressure = Binary.u16FixedPointToFloat(pointer.pressure);
+        return ControlMessage.createInjectTouchEvent(action, pointer.pointerId, position, pressure, pointer.actionButton, pointer.buttons);
+    }
+
+    private long parseVarint() throws IOException {
+        long value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int b = dis.readUnsignedByte();
+            value |= (long) (b & 0x7f) << shift;
+            if ((b & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw new ControlProtocolException("Invalid varint");
+    }
+
     private ControlMessage parseInjectScrollEvent() throws IOException {
         Position position = parsePosition();
         // Binary.i16FixedPointToFloat() decodes values assuming the full range is [-1, 1], but the actual range is [-16, 16].
@@ -175,6 +314,11 @@ public class ControlMessageReader {
         return ControlMessage.createCameraSetTorch(on);
     }
 
+    private ControlMessage parseLatencyProbe() throws IOException {
+        long sequence = dis.readLong();
+        return ControlMessage.createLatencyProbe(sequence);
+    }
+
     private Position parsePosition() throws IOException {
         int x = dis.readInt();
         int y = dis.readInt();
@@ -366,6 +366,10 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
                 case ControlMessage.TYPE_START_APP:
                     startAppAsync(msg.getText());
                     return true;
+                case ControlMessage.TYPE_LATENCY_PROBE:
+                    // The previous events have been injected, report the time in the same time base as the video PTS
+                    sender.send(DeviceMessage.createLatencyProbeAck(msg.getSequence(), System.nanoTime() / 1000));
+                    return true;
                 default:
                     // fall through
             }
@@ -5,12 +5,14 @@ public final class DeviceMessage {
     public static final int TYPE_CLIPBOARD = 0;
     public static final int TYPE_ACK_CLIPBOARD = 1;
     public static final int TYPE_UHID_OUTPUT = 2;
+    public static final int TYPE_LATENCY_PROBE_ACK = 3;
 
     private int type;
     private String text;
     private long sequence;
     private int id;
     private byte[] data;
+    private long timestampUs;
 
     private DeviceMessage() {
     }
@@ -37,6 +39,14 @@ public final class DeviceMessage {
         return event;
     }
 
+    public static DeviceMessage createLatencyProbeAck(long sequence, long timestampUs) {
+        DeviceMessage event = new DeviceMessage();
+        event.type = TYPE_LATENCY_PROBE_ACK;
+        event.sequence = sequence;
+        event.timestampUs = timestampUs;
+        return event;
+    }
+
     public int getType() {
         return type;
     }
@@ -56,4 +66,8 @@ public final class DeviceMessage {
     public byte[] getData() {
         return data;
     }
+
+    public long getTimestampUs() {
+        return timestampUs;
+    }
 }
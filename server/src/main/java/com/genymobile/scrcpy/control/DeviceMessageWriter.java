@@ -39,6 +39,10 @@ public class DeviceMessageWriter {
                 dos.writeShort(data.length);
                 dos.write(data);
                 break;
+            case DeviceMessage.TYPE_LATENCY_PROBE_ACK:
+                dos.writeLong(msg.getSequence());
+                dos.writeLong(msg.getTimestampUs());
+                break;
             default:
                 throw new ControlProtocolException("Unknown event type: " + type);
         }
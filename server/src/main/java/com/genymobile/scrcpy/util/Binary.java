@@ -13,6 +13,16 @@ public final class Binary {
         return value & 0xff;
     }
 
+    /**
+     * Decode a zigzag-encoded value (small negative values are encoded as small unsigned values)
+     *
+     * @param value encoded value
+     * @return Signed value
+     */
+    public static long zigzagDecode(long value) {
+        return (value >>> 1) ^ -(value & 1);
+    }
+
     /**
      * Convert unsigned 16-bit fixed-point to a float between 0 and 1
      *
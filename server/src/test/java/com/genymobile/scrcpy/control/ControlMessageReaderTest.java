@@ -422,6 +422,105 @@ public class ControlMessageReaderTest {
         Assert.assertEquals(-1, bis.read()); // EOS
     }
 
+    @Test
+    public void testParseLatencyProbe() throws IOException {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_LATENCY_PROBE);
+        dos.writeLong(0x0102030405060708L);
+        byte[] packet = bos.toByteArray();
+
+        ByteArrayInputStream bis = new ByteArrayInputStream(packet);
+        ControlMessageReader reader = new ControlMessageReader(bis);
+
+        ControlMessage event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_LATENCY_PROBE, event.getType());
+        Assert.assertEquals(0x0102030405060708L, event.getSequence());
+
+        Assert.assertEquals(-1, bis.read()); // EOS
+    }
+
+    @Test
+    public void testParseTouchEventCompact() throws IOException {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+
+        // New pointer, all fields present
+        dos.writeByte(ControlMessage.TYPE_INJECT_TOUCH_EVENT_COMPACT);
+        dos.writeByte(MotionEvent.ACTION_DOWN | 0xf0); // all flags
+        dos.writeByte(0); // slot
+        dos.writeByte(83); // pointerId -42 (zigzag varint)
+        dos.write(new byte[] {(byte) 0xc8, 0x01}); // dx = 100
+        dos.write(new byte[] {(byte) 0x90, 0x03}); // dy = 200
+        dos.write(new byte[] {(byte) 0xb8, 0x08}); // 1080
+        dos.write(new byte[] {(byte) 0x80, 0x0f}); // 1920
+        dos.writeShort(0xffff); // pressure
+        dos.writeByte(MotionEvent.BUTTON_PRIMARY); // action button
+        dos.writeByte(MotionEvent.BUTTON_PRIMARY); // buttons
+
+        // Move of the same pointer, only the position delta
+        dos.writeByte(ControlMessage.TYPE_INJECT_TOUCH_EVENT_COMPACT);
+        dos.writeByte(MotionEvent.ACTION_MOVE);
+        dos.writeByte(0); // slot
+        dos.writeByte(6); // dx = 3
+        dos.writeByte(9); // dy = -5
+
+        byte[] packet = bos.toByteArray();
+
+        ByteArrayInputStream bis = new ByteArrayInputStream(packet);
+        ControlMessageReader reader = new ControlMessageReader(bis);
+        reader.setCompactEncoding(true);
+
+        ControlMessage event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_INJECT_TOUCH_EVENT, event.getType());
+        Assert.assertEquals(MotionEvent.ACTION_DOWN, event.getAction());
+        Assert.assertEquals(-42, event.getPointerId());
+        Assert.assertEquals(100, event.getPosition().getPoint().getX());
+        Assert.assertEquals(200, event.getPosition().getPoint().getY());
+        Assert.assertEquals(1080, event.getPosition().getScreenSize().getWidth());
+        Assert.assertEquals(1920, event.getPosition().getScreenSize().getHeight());
+        Assert.assertEquals(1f, event.getPressure(), 0f); // must be exact
+        Assert.assertEquals(MotionEvent.BUTTON_PRIMARY, event.getActionButton());
+        Assert.assertEquals(MotionEvent.BUTTON_PRIMARY, event.getButtons());
+
+        event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_INJECT_TOUCH_EVENT, event.getType());
+        Assert.assertEquals(MotionEvent.ACTION_MOVE, event.getAction());
+        Assert.assertEquals(-42, event.getPointerId());
+        Assert.assertEquals(103, event.getPosition().getPoint().getX());
+        Assert.assertEquals(195, event.getPosition().getPoint().getY());
+        Assert.assertEquals(1080, event.getPosition().getScreenSize().getWidth());
+        Assert.assertEquals(1920, event.getPosition().getScreenSize().getHeight());
+        Assert.assertEquals(1f, event.getPressure(), 0f);
+        Assert.assertEquals(MotionEvent.BUTTON_PRIMARY, event.getActionButton());
+        Assert.assertEquals(MotionEvent.BUTTON_PRIMARY, event.getButtons());
+
+        Assert.assertEquals(-1, bis.read()); // EOS
+    }
+
+    @Test
+    public void testParseTouchEventCompactNotEnabled() throws IOException {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_INJECT_TOUCH_EVENT_COMPACT);
+        dos.writeByte(MotionEvent.ACTION_MOVE);
+        dos.writeByte(0); // slot
+        dos.writeByte(0); // dx
+        dos.writeByte(0); // dy
+
+        byte[] packet = bos.toByteArray();
+
+        ByteArrayInputStream bis = new ByteArrayInputStream(packet);
+        ControlMessageReader reader = new ControlMessageReader(bis);
+
+        try {
+            reader.read();
+            Assert.fail("Compact touch event must be rejected");
+        } catch (ControlProtocolException e) {
+            // expected
+        }
+    }
+
     @Test
     public void testParseCameraSetTorch() throws IOException {
         ByteArrayOutputStream bos = new ByteArrayOutputStream();
@@ -472,6 +571,57 @@ public class ControlMessageReaderTest {
         Assert.assertEquals(-1, bis.read()); // EOS
     }
 
+    @Test
+    public void testParseFragmentedSetClipboard() throws IOException {
+        ByteArrayOutputStream msgBos = new ByteArrayOutputStream();
+        DataOutputStream msgDos = new DataOutputStream(msgBos);
+        msgDos.writeByte(ControlMessage.TYPE_SET_CLIPBOARD);
+        msgDos.writeLong(0x0102030405060708L); // sequence
+        msgDos.writeByte(1); // paste
+        byte[] text = new byte[20000];
+        Arrays.fill(text, (byte) 'a');
+        msgDos.writeInt(text.length);
+        msgDos.write(text);
+        byte[] msg = msgBos.toByteArray();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+
+        int fragmentSize = 8192;
+        for (int offset = 0; offset < msg.length; offset += fragmentSize) {
+            int len = Math.min(fragmentSize, msg.length - offset);
+            boolean last = offset + len == msg.length;
+            dos.writeByte(ControlMessage.TYPE_FRAGMENT);
+            dos.writeByte(last ? 1 : 0);
+            dos.writeShort(len);
+            dos.write(msg, offset, len);
+
+            if (offset == 0) {
+                // Interleave an interactive message
+                dos.writeByte(ControlMessage.TYPE_BACK_OR_SCREEN_ON);
+                dos.writeByte(KeyEvent.ACTION_UP);
+            }
+        }
+
+        byte[] packet = bos.toByteArray();
+
+        ByteArrayInputStream bis = new ByteArrayInputStream(packet);
+        ControlMessageReader reader = new ControlMessageReader(bis);
+
+        // The interleaved message is returned first
+        ControlMessage event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_BACK_OR_SCREEN_ON, event.getType());
+        Assert.assertEquals(KeyEvent.ACTION_UP, event.getAction());
+
+        event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_SET_CLIPBOARD, event.getType());
+        Assert.assertEquals(0x0102030405060708L, event.getSequence());
+        Assert.assertEquals(new String(text, StandardCharsets.US_ASCII), event.getText());
+        Assert.assertTrue(event.getPaste());
+
+        Assert.assertEquals(-1, bis.read()); // EOS
+    }
+
     @Test
     public void testMultiEvents() throws IOException {
         ByteArrayOutputStream bos = new ByteArrayOutputStream();
@@ -39,4 +39,14 @@ public class BinaryTest {
         Assert.assertEquals(-0.75f, Binary.i16FixedPointToFloat((short) -0x6000), delta);
         Assert.assertEquals(-1.0f, Binary.i16FixedPointToFloat((short) -0x8000), delta);
     }
+
+    @Test
+    public void testZigzagDecode() {
+        Assert.assertEquals(0, Binary.zigzagDecode(0));
+        Assert.assertEquals(-1, Binary.zigzagDecode(1));
+        Assert.assertEquals(1, Binary.zigzagDecode(2));
+        Assert.assertEquals(-2, Binary.zigzagDecode(3));
+        Assert.assertEquals(Long.MAX_VALUE, Binary.zigzagDecode(-2));
+        Assert.assertEquals(Long.MIN_VALUE, Binary.zigzagDecode(-1));
+    }
 }